@@ -87,6 +87,8 @@ typedef struct sgw_pdn_connection_s {
   ip_address_t         s_gw_address_in_use_up;         ///< The IP address of the S-GW currently used for sending user plane traffic. (For PMIP-based S5/S8 only)
   // NOT NEEDED s_gw_gre_key_for_dl_traffic_up         ///< user plane for downlink traffic. (For PMIP-based S5/S8 only)
   ebi_t                default_bearer;                 ///< Identifies the default bearer within the PDN connection by its EPS Bearer Id. (For PMIP based S5/S8.)
+  pdn_type_t           pdn_type;                       ///< PDN type requested in the Create Session Request.
+  ambr_t               apn_ambr;                       ///< APN-AMBR enforced by the collocated PDN GW on the non-GBR bearers.
 
   // eps bearers
   sgw_eps_bearer_ctxt_t *sgw_eps_bearers_array[BEARERS_PER_UE];
@@ -122,7 +124,8 @@ typedef struct sgw_eps_bearer_context_information_s {
 
   void                  *trxn;
   // TODO change this saved_message (add procedure/transaction)
-  itti_s11_create_session_request_t saved_message;
+  // Only kept until the Create Session Response is built
+  itti_s11_create_session_request_t *saved_message;
   LIST_HEAD(pending_procedures_s, pgw_base_proc_s) *pending_procedures;
 
 } sgw_eps_bearer_context_information_t;
@@ -132,6 +135,15 @@ typedef struct sgw_eps_bearer_context_information_s {
 //------------------------------------------------------------------------------
 
 
+//For each APN in use:
+typedef struct pgw_apn_s {
+  APN_t                apn_in_use;                     ///< The APN currently used, as received from the S-GW.
+  ambr_t               apn_ambr;                       ///<  The maximum aggregated uplink and downlink MBR values to be shared across all Non-GBR bearers,
+  ///   which are established for this APN.
+  obj_hash_table_t    *pdn_connections;                ///<  For each PDN Connection within the APN
+} pgw_apn_t;
+
+
 // The PDN GW maintains the following EPS bearer context information for UEs.
 // For emergency attached UEs which are not authenticated, IMEI is stored in context.
 typedef struct pgw_eps_bearer_context_information_s {
@@ -147,19 +159,11 @@ typedef struct pgw_eps_bearer_context_information_s {
   // NOT NEEDED OMC identity                           ///< Identifies the OMC that shall receive the trace record(s).
 
   // TO BE CONTINUED...
-  obj_hash_table_t    *apns;
+  uint8_t              num_apns;
+  pgw_apn_t            apns[MAX_APN_PER_UE];
 } pgw_eps_bearer_context_information_t;
 
 
-//For each APN in use:
-typedef struct pgw_apn_s {
-  APN_t                apn_in_use;                     ///< The APN currently used, as received from the S-GW.
-  ambr_t               apn_ambr;                       ///<  The maximum aggregated uplink and downlink MBR values to be shared across all Non-GBR bearers,
-  ///   which are established for this APN.
-  obj_hash_table_t    *pdn_connections;                ///<  For each PDN Connection within the APN
-} pgw_apn_t;
-
-
 typedef struct pgw_pdn_connection_s {
   //ip_addresses;                                       ///< IPv4 address and/or IPv6 prefix
   pdn_type_t           pdn_type;                       ///< IPv4, IPv6, or IPv4v6
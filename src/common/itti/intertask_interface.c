@@ -474,10 +474,11 @@ itti_send_msg_to_task (
   return 0;
 }
 
-void
-itti_subscribe_event_fd (
+static void
+itti_subscribe_event_fd_data (
   task_id_t task_id,
-  int fd)
+  int fd,
+  epoll_data_t data)
 {
   thread_id_t                             thread_id;
   struct epoll_event                      event;
@@ -490,8 +491,7 @@ itti_subscribe_event_fd (
    */
   itti_desc.threads[thread_id].events = realloc (itti_desc.threads[thread_id].events, itti_desc.threads[thread_id].nb_events * sizeof (struct epoll_event));
   event.events = EPOLLIN | EPOLLERR;
-  event.data.u64 = 0;
-  event.data.fd = fd;
+  event.data = data;
 
   /*
    * Add the event fd to the list of monitored events
@@ -506,6 +506,32 @@ itti_subscribe_event_fd (
   ITTI_DEBUG (ITTI_DEBUG_EVEN_FD, " Successfully subscribed fd %d for task %s\n", fd, itti_get_task_name (task_id));
 }
 
+void
+itti_subscribe_event_fd (
+  task_id_t task_id,
+  int fd)
+{
+  epoll_data_t                            data;
+
+  data.u64 = 0;
+  data.fd = fd;
+  itti_subscribe_event_fd_data (task_id, fd, data);
+}
+
+void
+itti_subscribe_event_fd_ptr (
+  task_id_t task_id,
+  int fd,
+  void *ptr)
+{
+  epoll_data_t                            data;
+
+  AssertFatal (ptr != NULL, "NULL user pointer for fd %d!\n", fd);
+  data.u64 = 0;
+  data.ptr = ptr;
+  itti_subscribe_event_fd_data (task_id, fd, data);
+}
+
 void
 itti_unsubscribe_event_fd (
   task_id_t task_id,
@@ -592,9 +618,10 @@ itti_receive_msg_internal_event_fd (
 
   for (i = 0; i < epoll_ret; i++) {
     /*
-     * Check if there is an event for ITTI for the event fd
+     * Check if there is an event for ITTI for the event fd, compared on the
+     * whole epoll data as other fds may have been subscribed with a pointer
      */
-    if ((itti_desc.threads[thread_id].events[i].events & EPOLLIN) && (itti_desc.threads[thread_id].events[i].data.fd == itti_desc.threads[thread_id].task_event_fd)) {
+    if ((itti_desc.threads[thread_id].events[i].events & EPOLLIN) && (itti_desc.threads[thread_id].events[i].data.u64 == (uint64_t)itti_desc.threads[thread_id].task_event_fd)) {
       struct message_list_s                  *message = NULL;
       eventfd_t                               sem_counter;
       ssize_t                                 read_ret;
@@ -648,8 +675,18 @@ itti_poll_msg (
     struct message_list_s                  *message;
 
     if (lfds710_queue_bmm_dequeue (&itti_desc.tasks[task_id].message_queue, NULL, (void **)&message) == 1) {
+      thread_id_t                             thread_id = TASK_GET_THREAD_ID (task_id);
+      eventfd_t                               sem_counter;
+      ssize_t                                 read_ret;
       int                                     result;
 
+      /*
+       * Consume the event of the message, else a later itti_receive_msg()
+       * would wake up for a message already taken. The sender writes it right
+       * after the enqueue, the read does not wait long if at all.
+       */
+      read_ret = read (itti_desc.threads[thread_id].task_event_fd, &sem_counter, sizeof (sem_counter));
+      AssertFatal (read_ret == sizeof (sem_counter), "Read from task message FD (%d) failed (%d/%d)!\n", thread_id, (int)read_ret, (int)sizeof (sem_counter));
       *received_msg = message->msg;
       result = itti_free (ITTI_MSG_ORIGIN_ID (*received_msg), message);
       AssertFatal (result == EXIT_SUCCESS, "Failed to free memory (%d)!\n", result);
@@ -124,6 +124,14 @@ int itti_send_msg_to_task(task_id_t task_id, instance_t instance, MessageDef *me
  **/
 void itti_subscribe_event_fd(task_id_t task_id, int fd);
 
+/** \brief Add a new fd to monitor, the events returned by itti_get_events()
+ *  for this fd carry ptr in data.ptr instead of the fd in data.fd.
+ *  \param task_id Task ID of the receiving task
+ *  \param fd The file descriptor to monitor
+ *  \param ptr User pointer associated with the fd, must not be NULL
+ **/
+void itti_subscribe_event_fd_ptr(task_id_t task_id, int fd, void *ptr);
+
 /** \brief Remove a fd from the list of fd to monitor
  *  \param task_id Task ID of the task
  *  \param fd The file descriptor to remove
@@ -62,7 +62,14 @@ typedef union items_group_positions_u {
   } ind;
 } items_group_positions_t;
 
+/*
+ * The free list is taken by the ITTI tasks of all threads. A get that finds
+ * an index not written yet by a concurrent put steps back over the gets done
+ * meanwhile, the item is then skipped and its slot found in use when the puts
+ * wrap. The positions are only moved under a spin lock.
+ */
 typedef struct items_group_s {
+  volatile int                            lock;
   items_group_position_t                  number_plus_one;
   volatile uint32_t                       minimum;
   volatile items_group_positions_t        positions;
@@ -139,6 +146,24 @@ static const pool_start_mark_t          POOL_START_MARK = CHARS_TO_UINT32 ('P',
 static const pools_start_mark_t         POOLS_START_MARK = CHARS_TO_UINT32 ('P', 'S', 's', 't');
 
 /*------------------------------------------------------------------------------*/
+static inline void
+items_group_lock (
+  items_group_t * items_group)
+{
+  while (__sync_lock_test_and_set (&items_group->lock, 1)) {
+    while (items_group->lock);
+  }
+}
+
+//------------------------------------------------------------------------------
+static inline void
+items_group_unlock (
+  items_group_t * items_group)
+{
+  __sync_lock_release (&items_group->lock);
+}
+
+//------------------------------------------------------------------------------
 static inline                           uint32_t
 items_group_number_items (
   items_group_t * items_group)
@@ -171,6 +196,7 @@ items_group_get_free_item (
   items_group_position_t                  free_items;
   items_group_index_t                     index = ITEMS_GROUP_INDEX_INVALID;
 
+  items_group_lock (items_group);
   /*
    * Get current put position
    */
@@ -220,6 +246,7 @@ items_group_get_free_item (
       items_group->indexes[get] = ITEMS_GROUP_INDEX_INVALID;
     }
   }
+  items_group_unlock (items_group);
 
   return (index);
 }
@@ -233,6 +260,7 @@ items_group_put_free_item (
   items_group_position_t                  put_raw;
   items_group_position_t                  put;
 
+  items_group_lock (items_group);
   /*
    * Get current put position and increase it
    */
@@ -246,11 +274,12 @@ items_group_put_free_item (
     __sync_fetch_and_sub (&items_group->positions.ind.put, items_group->number_plus_one);
   }
 
-  AssertError (items_group->indexes[put] <= ITEMS_GROUP_INDEX_INVALID, return (EXIT_FAILURE), "Index at current put position (%d) is not marked as free (%d)!\n", put, items_group->number_plus_one);
+  AssertError (items_group->indexes[put] <= ITEMS_GROUP_INDEX_INVALID, items_group_unlock (items_group); return (EXIT_FAILURE), "Index at current put position (%d) is not marked as free (%d)!\n", put, items_group->number_plus_one);
   /*
    * Save freed item index at current put position
    */
   items_group->indexes[put] = index;
+  items_group_unlock (items_group);
   return (EXIT_SUCCESS);
 }
 
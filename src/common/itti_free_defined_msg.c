@@ -182,6 +182,7 @@ void itti_free_msg_content (MessageDef * const message_p)
 
   case S11_RELEASE_ACCESS_BEARERS_REQUEST:
   case S11_RELEASE_ACCESS_BEARERS_RESPONSE:
+  case S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH:
     // DO nothing (trxn)
     break;
 
@@ -234,8 +235,12 @@ void itti_free_msg_content (MessageDef * const message_p)
 
   case UDP_INIT:
   case UDP_DATA_REQ:
+    // DO nothing, UDP_DATA_REQ buffer belongs to the requesting task
+   break;
+
   case UDP_DATA_IND:
-    // TODO
+    // receive buffer handed over by the UDP task
+    free_wrapper ((void**)&message_p->ittiMsg.udp_data_ind.buffer);
    break;
   default:
     ;
@@ -48,6 +48,8 @@
 #define S11_DELETE_SESSION_RESPONSE(mSGpTR)        (mSGpTR)->ittiMsg.s11_delete_session_response
 #define S11_RELEASE_ACCESS_BEARERS_REQUEST(mSGpTR) (mSGpTR)->ittiMsg.s11_release_access_bearers_request
 #define S11_RELEASE_ACCESS_BEARERS_RESPONSE(mSGpTR) (mSGpTR)->ittiMsg.s11_release_access_bearers_response
+#define S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH(mSGpTR) (mSGpTR)->ittiMsg.s11_release_access_bearers_request_batch
+#define S11_PATH_STATE_IND(mSGpTR)                 (mSGpTR)->ittiMsg.s11_path_state_ind
 
 //-----------------------------------------------------------------------------
 /** @struct itti_s11_create_session_request_t
@@ -1009,6 +1011,7 @@ typedef struct itti_s11_delete_session_request_s {
  */
 typedef struct itti_s11_delete_session_response_s {
   teid_t         teid;                ///< Remote Tunnel Endpoint Identifier
+  teid_t         local_teid;          ///< S11 S-GW Tunnel Endpoint Identifier of the deleted session
   gtpv2c_cause_t  cause;
   //recovery_t recovery;              ///< This IE shall be included on the S5/S8, S4/S11 and S2b
                                       ///< interfaces if contacting the peer for the first time
@@ -1052,6 +1055,21 @@ typedef struct itti_s11_release_access_bearers_request_s {
   struct in_addr  peer_ip;
 } itti_s11_release_access_bearers_request_t;
 
+#define S11_RELEASE_ACCESS_BEARERS_BATCH_MAX 64
+
+//-----------------------------------------------------------------------------
+/** @struct itti_s11_release_access_bearers_request_batch_t
+ *  @brief Release Access Bearers Requests of several UEs
+ *
+ * Not a GTPv2-C message: used between MME_APP and S11 on eNB-wide releases
+ * (S1 Reset, SCTP shutdown) and between S11 and SPGW_APP when several requests
+ * are received in a row, so that one ITTI message carries many UEs.
+ */
+typedef struct itti_s11_release_access_bearers_request_batch_s {
+  uint32_t                                  nb_requests;
+  itti_s11_release_access_bearers_request_t request[S11_RELEASE_ACCESS_BEARERS_BATCH_MAX];
+} itti_s11_release_access_bearers_request_batch_t;
+
 
 //-----------------------------------------------------------------------------
 /** @struct itti_s11_release_access_bearers_response_t
@@ -1096,5 +1114,19 @@ typedef struct itti_s11_delete_bearer_command_s {
   struct in_addr  peer_ip;
 } itti_s11_delete_bearer_command_s;
 
+//-----------------------------------------------------------------------------
+/** @struct itti_s11_path_state_ind_t
+ *  @brief Path state towards a S-GW changed
+ *
+ * Not a GTPv2-C message: sent by S11 to MME_APP when Echo Requests towards a
+ * S-GW are not answered anymore (path failure), are answered again, or when the
+ * S-GW restart counter changed (3GPP TS 23.007).
+ */
+typedef struct itti_s11_path_state_ind_s {
+  struct in_addr  peer_ip;                ///< S-GW S11 address
+  bool            path_up;
+  bool            peer_restarted;         ///< Restart counter of the S-GW changed
+} itti_s11_path_state_ind_t;
+
 #endif
 /* FILE_S11_MESSAGES_TYPES_SEEN */
@@ -71,6 +71,7 @@ typedef struct sctp_data_ind_s {
   sctp_stream_id_t   stream;           ///< Stream number on which data had been received
   uint16_t           instreams;        ///< Number of input streams for the SCTP connection between peers
   uint16_t           outstreams;       ///< Number of output streams for the SCTP connection between peers
+  uint64_t           enqueue_time_us;  ///< Time at which the PDU has been queued to S1AP (overload control)
 } sctp_data_ind_t;
 
 typedef struct sctp_init_s {
@@ -41,6 +41,10 @@ TASK_DEF(TASK_MME_APP,  TASK_PRIORITY_MED, 256)
 TASK_DEF(TASK_NAS_MME,  TASK_PRIORITY_MED, 256)
 /// S11 task
 TASK_DEF(TASK_S11,      TASK_PRIORITY_MED, 256)
+/// Additional S-GW S11 GTPv2-C stack instances, TASK_S11 is the first one
+TASK_DEF(TASK_S11_1,    TASK_PRIORITY_MED, 256)
+TASK_DEF(TASK_S11_2,    TASK_PRIORITY_MED, 256)
+TASK_DEF(TASK_S11_3,    TASK_PRIORITY_MED, 256)
 /// S1AP task
 TASK_DEF(TASK_S1AP,     TASK_PRIORITY_MED, 256)
 /// S6a task
@@ -49,6 +53,10 @@ TASK_DEF(TASK_S6A,      TASK_PRIORITY_MED, 256)
 TASK_DEF(TASK_SCTP,     TASK_PRIORITY_MED, 256)
 /// Serving and Proxy Gateway Application task
 TASK_DEF(TASK_SPGW_APP, TASK_PRIORITY_MED, 256)
+/// Additional SPGW application shards, TASK_SPGW_APP is the first one
+TASK_DEF(TASK_SPGW_APP_1, TASK_PRIORITY_MED, 256)
+TASK_DEF(TASK_SPGW_APP_2, TASK_PRIORITY_MED, 256)
+TASK_DEF(TASK_SPGW_APP_3, TASK_PRIORITY_MED, 256)
 /// UDP task
 TASK_DEF(TASK_UDP,      TASK_PRIORITY_MED, 256)
 //LOGGING TXT TASK
@@ -37,9 +37,16 @@
 
 #define UDP_INIT(mSGpTR)    (mSGpTR)->ittiMsg.udp_init
 
+/* Optional dispatching of received datagrams over several tasks, returns
+ * the task id that has to receive the datagram, or a negative value for the
+ * task that requested the endpoint. Called by the UDP threads.
+ */
+typedef int (*udp_steer_cb_t) (const uint8_t * const buffer, const uint32_t length);
+
 typedef struct {
   struct in_addr  address;
   uint16_t        port;
+  udp_steer_cb_t  steer;
 } udp_init_t;
 
 typedef struct {
@@ -1,10 +1,19 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/gtp.h>
 
 #include <libgtpnl/gtp.h>
 #include <libgtpnl/gtpnl.h>
@@ -13,19 +22,152 @@
 
 #include "log.h"
 #include "common_defs.h"
+#include "common_types.h"
 #include "gtpv1u.h"
 #include "gtpv1u_sgw_defs.h"
 
 extern struct gtp_tunnel_ops gtp_tunnel_ops;
 
+#ifndef SOL_NETLINK
+#define SOL_NETLINK                 270
+#endif
+
+/*
+ * Tunnels are not set with the synchronous libgtpnl calls: GTP_CMD_NEWPDP and
+ * GTP_CMD_DELPDP requests are queued in a batch sent with one sendmsg() on a
+ * socket of its own. The kernel applies the whole batch before sendmsg()
+ * returns, the acknowledgements are read later when the socket is readable.
+ * Each thread has its own batch, socket and sequence numbers: the SPGW_APP
+ * shards queue, send and acknowledge their changes without sharing anything.
+ */
+#define GTP_NL_BATCH_MSG_MAX        256
+// NEWPDP with its 6 attributes
+#define GTP_NL_MSG_SIZE             128
+// unacknowledged changes, the acknowledgements must fit in the receive buffer
+#define GTP_NL_INFLIGHT_MAX         8192
+#define GTP_NL_RCV_BUFFER_SIZE      (8 * 1024 * 1024)
+// threads changing tunnels: the SPGW_APP shards
+#define GTP_NL_BATCHES_MAX          8
+
+typedef struct gtp_nl_batch_s {
+  int                 fd;
+  uint32_t            seq;        // last change queued
+  uint32_t            sent_seq;   // last change sent
+  uint32_t            acked_seq;  // last change acknowledged
+  uint8_t             batch[GTP_NL_BATCH_MSG_MAX * GTP_NL_MSG_SIZE];
+  size_t              batch_len;
+  uint32_t            nb_msg;
+  // to report the failed changes
+  uint8_t             inflight_cmd[GTP_NL_INFLIGHT_MAX];
+  uint32_t            inflight_tei[GTP_NL_INFLIGHT_MAX];
+} gtp_nl_batch_t;
+
 static struct {
+  pthread_mutex_t     lock;       // only taken to open a batch
   int                 genl_id;
   struct mnl_socket  *nl;
   bool                is_enabled;
-} gtp_nl;
+  unsigned int        ifindex;
+  gtp_nl_batch_t     *batches[GTP_NL_BATCHES_MAX];
+  uint32_t            nb_batches;
+} gtp_nl = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+// batch of the calling thread
+static __thread gtp_nl_batch_t *gtp_nl_batch = NULL;
+
+static int libgtpnl_send_batch(gtp_nl_batch_t *b);
+static int libgtpnl_read_acks(gtp_nl_batch_t *b, uint32_t *acked_seq);
+
+static gtp_nl_batch_t *libgtpnl_open_batch(void)
+{
+  gtp_nl_batch_t *b;
+  int rcvbuf = GTP_NL_RCV_BUFFER_SIZE;
+  int one = 1;
+
+  if (!(b = calloc(1, sizeof(*b)))) {
+    return NULL;
+  }
+  b->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_GENERIC);
+  if (b->fd < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot create netlink socket for the GTP tunnels: %s\n", strerror(errno));
+    free(b);
+    return NULL;
+  }
+  // no copy of the request in the acknowledgements of the failed ones
+  setsockopt(b->fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+  if (setsockopt(b->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0) {
+    setsockopt(b->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  }
+  pthread_mutex_lock(&gtp_nl.lock);
+  if (GTP_NL_BATCHES_MAX == gtp_nl.nb_batches) {
+    pthread_mutex_unlock(&gtp_nl.lock);
+    OAILOG_ERROR (LOG_GTPV1U, "More than %u threads change GTP tunnels\n", GTP_NL_BATCHES_MAX);
+    close(b->fd);
+    free(b);
+    return NULL;
+  }
+  gtp_nl.batches[gtp_nl.nb_batches++] = b;
+  pthread_mutex_unlock(&gtp_nl.lock);
+  return b;
+}
+
+// batch of the calling thread, opened on first use
+static gtp_nl_batch_t *libgtpnl_batch(void)
+{
+  if ((!gtp_nl_batch) && (gtp_nl.is_enabled)) {
+    gtp_nl_batch = libgtpnl_open_batch();
+  }
+  return gtp_nl_batch;
+}
 
+static void libgtpnl_put_attr(struct nlmsghdr *nlh, uint16_t type, const void *data, uint16_t len)
+{
+  struct nlattr *nla = (struct nlattr *)((uint8_t *)nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+
+  nla->nla_type = type;
+  nla->nla_len = NLA_HDRLEN + len;
+  memcpy((uint8_t *)nla + NLA_HDRLEN, data, len);
+  memset((uint8_t *)nla + NLA_HDRLEN + len, 0, NLA_ALIGN(len) - len);
+  nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + NLA_ALIGN(nla->nla_len);
+}
+
+static struct nlmsghdr *libgtpnl_msg_start(gtp_nl_batch_t *b, uint8_t cmd, uint32_t i_tei, uint32_t o_tei)
+{
+  struct nlmsghdr *nlh;
+  struct genlmsghdr *genl;
+  uint32_t version = GTP_V1;
+  uint32_t slot;
+
+  if (GTP_NL_BATCH_MSG_MAX == b->nb_msg) {
+    libgtpnl_send_batch(b);
+  }
+  nlh = (struct nlmsghdr *)&b->batch[b->batch_len];
+  memset(nlh, 0, NLMSG_HDRLEN + GENL_HDRLEN);
+  nlh->nlmsg_len = NLMSG_HDRLEN + GENL_HDRLEN;
+  nlh->nlmsg_type = gtp_nl.genl_id;
+  nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  nlh->nlmsg_seq = ++b->seq;
+  genl = (struct genlmsghdr *)NLMSG_DATA(nlh);
+  genl->cmd = cmd;
+  genl->version = 0;
+
+  libgtpnl_put_attr(nlh, GTPA_LINK, &gtp_nl.ifindex, sizeof(gtp_nl.ifindex));
+  libgtpnl_put_attr(nlh, GTPA_VERSION, &version, sizeof(version));
+  libgtpnl_put_attr(nlh, GTPA_I_TEI, &i_tei, sizeof(i_tei));
+  libgtpnl_put_attr(nlh, GTPA_O_TEI, &o_tei, sizeof(o_tei));
+
+  slot = nlh->nlmsg_seq % GTP_NL_INFLIGHT_MAX;
+  b->inflight_cmd[slot] = cmd;
+  b->inflight_tei[slot] = i_tei;
+  return nlh;
+}
+
+static void libgtpnl_msg_end(gtp_nl_batch_t *b, struct nlmsghdr *nlh)
+{
+  b->batch_len += NLMSG_ALIGN(nlh->nlmsg_len);
+  b->nb_msg += 1;
+}
 
-#define GTP_DEVNAME "gtp0"
 
 int libgtpnl_init(struct in_addr *ue_net, uint32_t mask, int mtu, int *fd0, int *fd1u)
 {
@@ -63,6 +205,7 @@ int libgtpnl_init(struct in_addr *ue_net, uint32_t mask, int mtu, int *fd0, int
     return RETURNerror;
   }
   gtp_nl.is_enabled = true;
+  gtp_nl.ifindex = if_nametoindex(GTP_DEVNAME);
 
   gtp_nl.nl = genl_socket_open();
   if (gtp_nl.nl == NULL) {
@@ -114,6 +257,16 @@ int libgtpnl_uninit(void)
   if (!gtp_nl.is_enabled)
     return -1;
 
+  // the threads that changed tunnels are done
+  pthread_mutex_lock(&gtp_nl.lock);
+  for (uint32_t i = 0; i < gtp_nl.nb_batches; i++) {
+    close(gtp_nl.batches[i]->fd);
+    free(gtp_nl.batches[i]);
+  }
+  gtp_nl.nb_batches = 0;
+  gtp_nl.is_enabled = false;
+  pthread_mutex_unlock(&gtp_nl.lock);
+  gtp_nl_batch = NULL;
   return gtp_dev_destroy(GTP_DEVNAME);
 }
 
@@ -127,61 +280,152 @@ int libgtpnl_reset(void)
 
 int libgtpnl_add_tunnel(struct in_addr ue, struct in_addr enb, uint32_t i_tei, uint32_t o_tei)
 {
-  struct gtp_tunnel *t;
-  int ret;
+  gtp_nl_batch_t *b;
+  struct nlmsghdr *nlh;
 
   if (!gtp_nl.is_enabled)
     return RETURNok;
-
-  t = gtp_tunnel_alloc();
-  if (t == NULL)
+  if (!(b = libgtpnl_batch()))
     return RETURNerror;
 
-
-  gtp_tunnel_set_ifidx(t, if_nametoindex(GTP_DEVNAME));
-  gtp_tunnel_set_version(t, 1);
-  gtp_tunnel_set_ms_ip4(t, &ue);
-  gtp_tunnel_set_sgsn_ip4(t, &enb);
-  gtp_tunnel_set_i_tei(t, i_tei);
-  gtp_tunnel_set_o_tei(t, o_tei);
-
-  ret = gtp_add_tunnel(gtp_nl.genl_id, gtp_nl.nl, t);
-  gtp_tunnel_free(t);
-
-  return ret;
+  nlh = libgtpnl_msg_start(b, GTP_CMD_NEWPDP, i_tei, o_tei);
+  libgtpnl_put_attr(nlh, GTPA_MS_ADDRESS, &ue.s_addr, sizeof(ue.s_addr));
+  libgtpnl_put_attr(nlh, GTPA_PEER_ADDRESS, &enb.s_addr, sizeof(enb.s_addr));
+  libgtpnl_msg_end(b, nlh);
+  return RETURNok;
 }
 
 int libgtpnl_del_tunnel(uint32_t i_tei, uint32_t o_tei)
 {
-  struct gtp_tunnel *t;
-  int ret;
+  gtp_nl_batch_t *b;
+  struct nlmsghdr *nlh;
 
   if (!gtp_nl.is_enabled)
     return RETURNok;
-
-  t = gtp_tunnel_alloc();
-  if (t == NULL)
+  if (!(b = libgtpnl_batch()))
     return RETURNerror;
 
-  gtp_tunnel_set_ifidx(t, if_nametoindex(GTP_DEVNAME));
-  gtp_tunnel_set_version(t, 1);
-  // looking at kernel/drivers/net/gtp.c: not needed gtp_tunnel_set_ms_ip4(t, &ue);
-  // looking at kernel/drivers/net/gtp.c: not needed gtp_tunnel_set_sgsn_ip4(t, &enb);
-  gtp_tunnel_set_i_tei(t, i_tei);
-  gtp_tunnel_set_o_tei(t, o_tei);
+  // looking at kernel/drivers/net/gtp.c: the UE and eNB addresses are not needed
+  nlh = libgtpnl_msg_start(b, GTP_CMD_DELPDP, i_tei, o_tei);
+  libgtpnl_msg_end(b, nlh);
+  return RETURNok;
+}
 
-  ret = gtp_del_tunnel(gtp_nl.genl_id, gtp_nl.nl, t);
-  gtp_tunnel_free(t);
+static uint32_t libgtpnl_last_seq(void)
+{
+  return (gtp_nl_batch) ? gtp_nl_batch->seq : 0;
+}
 
+static int libgtpnl_send_batch(gtp_nl_batch_t *b)
+{
+  struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+  struct iovec iov = {.iov_base = b->batch, .iov_len = b->batch_len};
+  struct msghdr msg = {.msg_name = &kernel, .msg_namelen = sizeof(kernel), .msg_iov = &iov, .msg_iovlen = 1};
+  uint32_t acked_seq;
+  int ret = RETURNok;
+
+  if (!b->nb_msg)
+    return RETURNok;
+
+  // make room for the acknowledgements of this batch
+  while ((b->sent_seq - b->acked_seq) > (GTP_NL_INFLIGHT_MAX - GTP_NL_BATCH_MSG_MAX)) {
+    struct pollfd pfd = {.fd = b->fd, .events = POLLIN};
+
+    if ((poll(&pfd, 1, 1000) <= 0) || (libgtpnl_read_acks(b, &acked_seq) < 0)) {
+      OAILOG_WARNING (LOG_GTPV1U, "No acknowledgement for GTP tunnels %u..%u\n", b->acked_seq + 1, b->sent_seq);
+      b->acked_seq = b->sent_seq;
+    }
+  }
+  while (sendmsg(b->fd, &msg, 0) < 0) {
+    if (EINTR == errno)
+      continue;
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot send %u GTP tunnel changes: %s\n", b->nb_msg, strerror(errno));
+    // nothing will acknowledge them
+    b->acked_seq = b->seq;
+    ret = RETURNerror;
+    break;
+  }
+  b->sent_seq = b->seq;
+  b->batch_len = 0;
+  b->nb_msg = 0;
   return ret;
 }
 
+static int libgtpnl_flush(void)
+{
+  return (gtp_nl_batch) ? libgtpnl_send_batch(gtp_nl_batch) : RETURNok;
+}
+
+static int libgtpnl_get_ack_fd(void)
+{
+  gtp_nl_batch_t *b = libgtpnl_batch();
+
+  return (b) ? b->fd : -1;
+}
+
+static int libgtpnl_read_acks(gtp_nl_batch_t *b, uint32_t *acked_seq)
+{
+  uint8_t rcv[8192];
+  int nb_acks = 0;
+
+  while (true) {
+    ssize_t len = recv(b->fd, rcv, sizeof(rcv), MSG_DONTWAIT);
+
+    if (len < 0) {
+      if (EINTR == errno)
+        continue;
+      if (ENOBUFS == errno) {
+        // acknowledgements lost, the changes were applied during sendmsg() anyway
+        OAILOG_WARNING (LOG_GTPV1U, "GTP tunnel acknowledgements lost up to %u\n", b->sent_seq);
+        nb_acks += b->sent_seq - b->acked_seq;
+        b->acked_seq = b->sent_seq;
+        continue;
+      }
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+        OAILOG_ERROR (LOG_GTPV1U, "Cannot receive GTP tunnel acknowledgements: %s\n", strerror(errno));
+        nb_acks = RETURNerror;
+      }
+      break;
+    }
+    for (struct nlmsghdr *nlh = (struct nlmsghdr *)rcv; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+      const struct nlmsgerr *err = (const struct nlmsgerr *)NLMSG_DATA(nlh);
+      uint32_t slot = nlh->nlmsg_seq % GTP_NL_INFLIGHT_MAX;
+
+      if ((NLMSG_ERROR != nlh->nlmsg_type) || ((int32_t)(nlh->nlmsg_seq - b->acked_seq) <= 0)
+          || ((int32_t)(nlh->nlmsg_seq - b->sent_seq) > 0)) {
+        continue;
+      }
+      if (err->error) {
+        OAILOG_ERROR (LOG_GTPV1U, "Cannot %s GTP tunnel " TEID_FMT ": %s\n", (GTP_CMD_NEWPDP == b->inflight_cmd[slot]) ? "add" : "delete",
+            b->inflight_tei[slot], strerror(-err->error));
+      }
+      nb_acks += nlh->nlmsg_seq - b->acked_seq;
+      b->acked_seq = nlh->nlmsg_seq;
+    }
+  }
+  *acked_seq = b->acked_seq;
+  return nb_acks;
+}
+
+static int libgtpnl_process_acks(uint32_t *acked_seq)
+{
+  if (!gtp_nl_batch) {
+    *acked_seq = 0;
+    return 0;
+  }
+  return libgtpnl_read_acks(gtp_nl_batch, acked_seq);
+}
+
 static const struct gtp_tunnel_ops libgtpnl_ops = {
   .init         = libgtpnl_init,
   .uninit       = libgtpnl_uninit,
   .reset        = libgtpnl_reset,
   .add_tunnel   = libgtpnl_add_tunnel,
   .del_tunnel   = libgtpnl_del_tunnel,
+  .last_seq     = libgtpnl_last_seq,
+  .flush        = libgtpnl_flush,
+  .get_ack_fd   = libgtpnl_get_ack_fd,
+  .process_acks = libgtpnl_process_acks,
 };
 
 const struct gtp_tunnel_ops *gtp_tunnel_ops_init(void) {
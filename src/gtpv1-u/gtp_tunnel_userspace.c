@@ -0,0 +1,1209 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file gtp_tunnel_userspace.c
+* \brief Userspace GTP-U fast path, alternative to the gtp kernel module
+* \author
+* \company
+* \email:
+*/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#include "bstrlib.h"
+#include "log.h"
+#include "common_defs.h"
+#include "gtpv1u.h"
+#include "gtpv1u_sgw_defs.h"
+#include "gtp_tunnel_userspace.h"
+#include "pgw_sdf_classifier.h"
+
+#define GTPU_US_TABLE_BITS_MIN      12
+#define GTPU_US_COUNTERS_MIN        4096
+#define GTPU_US_SOCKET_BUFFER_SIZE  (4 * 1024 * 1024)
+#define GTPU_US_SDF_BEARERS_MAX     16
+
+#define GTPU_HEADER_LENGTH          8
+#define GTPU_FLAGS_V1_PT            0x30
+#define GTPU_FLAG_E                 0x04
+#define GTPU_FLAGS_E_S_PN           0x07
+#define GTPU_IE_RECOVERY            14
+
+#define GTPU_US_UL                  0
+#define GTPU_US_DL                  1
+
+// SDFs steered to the dedicated bearers of a UE
+typedef struct gtpu_us_sdf_bearers_s {
+  uint32_t           nb;
+  uint32_t           sdf_id[GTPU_US_SDF_BEARERS_MAX];
+  uint32_t           i_tei[GTPU_US_SDF_BEARERS_MAX];
+} gtpu_us_sdf_bearers_t;
+
+typedef struct gtpu_us_tunnel_s {
+  uint32_t           i_tei;        // S-GW TEID, key of the uplink table
+  uint32_t           o_tei;        // eNB TEID
+  struct in_addr     ue;           // key of the downlink table
+  struct in_addr     enb;
+  uint32_t           counter_id;   // index in the per bearer counters of the workers
+  gtpu_us_sdf_bearers_t *sdf;      // downlink table only, NULL until the UE has a dedicated bearer
+} gtpu_us_tunnel_t;
+
+// Token bucket in virtual scheduling form: it is full when tat_ns is in the past
+typedef struct gtpu_us_meter_s {
+  uint64_t           tat_ns;       // theoretical arrival time of the next packet at the rate
+  uint64_t           ps_per_byte;  // 0 for no limit
+  uint64_t           tolerance_ns; // depth of the bucket
+} gtpu_us_meter_t;
+
+// Shared by the workers, one cache line pair per bearer
+typedef struct gtpu_us_qos_s {
+  gtpu_us_meter_t    mbr[2];       // GBR bearer, by direction
+  gtpu_us_meter_t    ambr[2];      // APN-AMBR of the UE, only looked at on its downlink tunnel
+  bool               in_ambr;      // non-GBR bearer, counted in the APN-AMBR of the UE
+} __attribute__((aligned(128))) gtpu_us_qos_t;
+
+typedef struct gtpu_us_usage_s {
+  uint32_t           i_tei;
+  uint32_t           o_tei;
+  struct in_addr     ue;
+  gtpu_us_counters_t counters;
+} gtpu_us_usage_t;
+
+typedef struct gtpu_us_usage_list_s {
+  gtpu_us_usage_t   *usages;
+  uint32_t           nb;
+  uint32_t           max;
+} gtpu_us_usage_list_t;
+
+// Linear probing, no tombstones: a zero key is a free slot, removal shifts the following slots back
+typedef struct gtpu_us_table_s {
+  gtpu_us_tunnel_t  *slots;
+  uint32_t           bits;
+  uint32_t           mask;
+  uint32_t           nb_used;
+  bool               by_ue;
+} gtpu_us_table_t;
+
+typedef struct gtpu_us_worker_s {
+  pthread_t          thread;
+  uint32_t           id;
+  int                s1u_fd;
+  int                tun_fd;
+  gtpu_us_stats_t    stats;
+  gtpu_us_pkt_t      pkts[GTPU_US_BURST_SIZE];
+  struct mmsghdr     msgs[GTPU_US_BURST_SIZE];
+  struct iovec       iovs[GTPU_US_BURST_SIZE];
+  struct sockaddr_in addrs[GTPU_US_BURST_SIZE];
+  uint8_t            buffers[GTPU_US_BURST_SIZE][GTPU_US_BUFFER_SIZE];
+} gtpu_us_worker_t;
+
+static struct {
+  pthread_rwlock_t   lock;         // workers read the tables, the SPGW_APP task writes them
+  gtpu_us_table_t    ul;
+  gtpu_us_table_t    dl;
+  pgw_sdf_classifier_t *sdf_classifier;
+  bool               is_enabled;
+
+  struct in_addr     s1u;
+  uint32_t           nb_workers;
+  uint32_t           first_core;
+  gtpu_us_worker_t  *workers;
+  volatile bool      running;
+
+  // counter ids, the counter arrays of the workers have nb_counters entries
+  uint32_t           nb_counters;
+  uint32_t           next_counter_id;
+  uint32_t          *free_counter_ids;
+  uint32_t           nb_free_counter_ids;
+  gtpu_us_qos_t     *qos;          // rates of the bearers, by counter id
+
+  struct {
+    pthread_t             thread;
+    FILE                 *file;
+    uint32_t              period_sec;
+    gtpu_us_usage_list_t  snapshot;   // owned by the report thread
+    pthread_mutex_t       closed_lock;
+    gtpu_us_usage_list_t  closed;     // last counters of the deleted tunnels
+  } usage;
+} gtpu_us;
+
+//------------------------------------------------------------------------------
+static inline uint32_t gtpu_us_table_key (const gtpu_us_table_t * const table, const gtpu_us_tunnel_t * const tunnel)
+{
+  return (table->by_ue) ? tunnel->ue.s_addr : tunnel->i_tei;
+}
+
+//------------------------------------------------------------------------------
+static inline uint32_t gtpu_us_table_hash (const gtpu_us_table_t * const table, const uint32_t key)
+{
+  // Fibonacci hashing, the high bits of the product depend on all the bits of the key
+  return (key * 2654435769u) >> (32 - table->bits);
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_table_init (gtpu_us_table_t * const table, const uint32_t bits, const bool by_ue)
+{
+  table->slots = calloc ((size_t)1 << bits, sizeof (gtpu_us_tunnel_t));
+  if (!table->slots) {
+    return RETURNerror;
+  }
+  table->bits = bits;
+  table->mask = (1u << bits) - 1;
+  table->nb_used = 0;
+  table->by_ue = by_ue;
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static inline gtpu_us_tunnel_t *gtpu_us_table_get (const gtpu_us_table_t * const table, const uint32_t key)
+{
+  uint32_t                                i = gtpu_us_table_hash (table, key);
+
+  // the load factor stays below 3/4, there is always a free slot to stop on
+  for (;;) {
+    const uint32_t                        k = gtpu_us_table_key (table, &table->slots[i]);
+
+    if (k == key) {
+      return &table->slots[i];
+    }
+    if (k == 0) {
+      return NULL;
+    }
+    i = (i + 1) & table->mask;
+  }
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_table_insert (gtpu_us_table_t * const table, const gtpu_us_tunnel_t * const tunnel)
+{
+  uint32_t                                i = gtpu_us_table_hash (table, gtpu_us_table_key (table, tunnel));
+
+  while (gtpu_us_table_key (table, &table->slots[i])) {
+    i = (i + 1) & table->mask;
+  }
+  table->slots[i] = *tunnel;
+  table->nb_used += 1;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_table_put (gtpu_us_table_t * const table, const gtpu_us_tunnel_t * const tunnel)
+{
+  if (4 * (table->nb_used + 1) > 3 * (table->mask + 1)) {
+    gtpu_us_table_t                       grown = {0};
+
+    if (RETURNok != gtpu_us_table_init (&grown, table->bits + 1, table->by_ue)) {
+      return RETURNerror;
+    }
+    for (uint32_t i = 0; i <= table->mask; i++) {
+      if (gtpu_us_table_key (table, &table->slots[i])) {
+        gtpu_us_table_insert (&grown, &table->slots[i]);
+      }
+    }
+    free (table->slots);
+    *table = grown;
+  }
+  gtpu_us_table_insert (table, tunnel);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_table_remove (gtpu_us_table_t * const table, gtpu_us_tunnel_t * const slot)
+{
+  uint32_t                                hole = slot - table->slots;
+  uint32_t                                j = hole;
+
+  for (;;) {
+    uint32_t                              key = 0;
+    uint32_t                              home = 0;
+
+    j = (j + 1) & table->mask;
+    key = gtpu_us_table_key (table, &table->slots[j]);
+    if (!key) {
+      break;
+    }
+    home = gtpu_us_table_hash (table, key);
+    // the entry can fill the hole if its home slot is not between the hole and itself
+    if (((j - home) & table->mask) >= ((j - hole) & table->mask)) {
+      table->slots[hole] = table->slots[j];
+      hole = j;
+    }
+  }
+  memset (&table->slots[hole], 0, sizeof (table->slots[hole]));
+  table->nb_used -= 1;
+}
+
+//------------------------------------------------------------------------------
+static inline bool gtpu_us_meter_take (gtpu_us_meter_t * const meter, const uint64_t cost_ns, const uint64_t now_ns)
+{
+  uint64_t                                tat = meter->tat_ns;
+
+  for (;;) {
+    const uint64_t                        start = (tat > now_ns) ? tat : now_ns;
+    uint64_t                              prev = 0;
+
+    if (start - now_ns > meter->tolerance_ns) {
+      return false;
+    }
+    prev = __sync_val_compare_and_swap (&meter->tat_ns, tat, start + cost_ns);
+    if (prev == tat) {
+      return true;
+    }
+    tat = prev;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Called in a burst: the MBR of the bearer, then the APN-AMBR of the UE kept on ue_tunnel, looked up if NULL
+static inline bool gtpu_us_police (const gtpu_us_tunnel_t * const tunnel, const gtpu_us_tunnel_t * ue_tunnel, const int dir, const uint32_t len, const uint64_t now_ns)
+{
+  gtpu_us_qos_t                          *qos = &gtpu_us.qos[tunnel->counter_id];
+  gtpu_us_meter_t                        *mbr = &qos->mbr[dir];
+  gtpu_us_meter_t                        *ambr = NULL;
+  uint64_t                                mbr_cost_ns = 0;
+
+  if ((!mbr->ps_per_byte) && (!qos->in_ambr)) {
+    return true;
+  }
+  if (mbr->ps_per_byte) {
+    mbr_cost_ns = (len * mbr->ps_per_byte) / 1000;
+    if (!gtpu_us_meter_take (mbr, mbr_cost_ns, now_ns)) {
+      return false;
+    }
+  }
+  if (qos->in_ambr) {
+    ue_tunnel = (ue_tunnel) ? ue_tunnel : gtpu_us_table_get (&gtpu_us.dl, tunnel->ue.s_addr);
+    ambr = (ue_tunnel) ? &gtpu_us.qos[ue_tunnel->counter_id].ambr[dir] : NULL;
+    if ((ambr) && (ambr->ps_per_byte) && (!gtpu_us_meter_take (ambr, (len * ambr->ps_per_byte) / 1000, now_ns))) {
+      // not sent, give the tokens back to the bearer
+      if (mbr_cost_ns) {
+        __sync_fetch_and_sub (&mbr->tat_ns, mbr_cost_ns);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static inline gtpu_us_verdict_t gtpu_us_uplink_pkt (gtpu_us_pkt_t * const pkt, const uint64_t now_ns, gtpu_us_stats_t * const stats)
+{
+  uint8_t                                *gtpu = pkt->data;
+  uint32_t                                hdr_len = GTPU_HEADER_LENGTH;
+  uint32_t                                msg_len = 0;
+  uint32_t                                teid = 0;
+  uint32_t                                ue = 0;
+  const gtpu_us_tunnel_t                 *tunnel = NULL;
+
+  // version 1, protocol type GTP
+  if ((pkt->len < GTPU_HEADER_LENGTH) || ((gtpu[0] & 0xF0) != GTPU_FLAGS_V1_PT)) {
+    return GTPU_US_DROP;
+  }
+  msg_len = GTPU_HEADER_LENGTH + ((gtpu[2] << 8) | gtpu[3]);
+  if (msg_len > pkt->len) {
+    return GTPU_US_DROP;
+  }
+  if (gtpu[0] & GTPU_FLAGS_E_S_PN) {
+    hdr_len += 4;
+    if (hdr_len > msg_len) {
+      return GTPU_US_DROP;
+    }
+    if (gtpu[0] & GTPU_FLAG_E) {
+      uint8_t                             next_type = gtpu[hdr_len - 1];
+
+      // extension headers: length in 4 octets units, next type in the last octet
+      while (next_type) {
+        uint32_t                          ext_len = 0;
+
+        if (hdr_len >= msg_len) {
+          return GTPU_US_DROP;
+        }
+        ext_len = 4 * gtpu[hdr_len];
+        if ((!ext_len) || (hdr_len + ext_len > msg_len)) {
+          return GTPU_US_DROP;
+        }
+        next_type = gtpu[hdr_len + ext_len - 1];
+        hdr_len += ext_len;
+      }
+    }
+  }
+
+  if (gtpu[1] == GTPU_ECHO_REQUEST) {
+    // same sequence number, recovery with a null restart counter (29.281 section 7.2.2)
+    if (!(gtpu[0] & GTPU_FLAGS_E_S_PN)) {
+      memset (&gtpu[8], 0, 4);
+    }
+    gtpu[0] = GTPU_FLAGS_V1_PT | 0x02;
+    gtpu[1] = GTPU_ECHO_RESPONSE;
+    gtpu[2] = 0;
+    gtpu[3] = 6;
+    memset (&gtpu[4], 0, 4);
+    gtpu[10] = 0;
+    gtpu[11] = 0;
+    gtpu[12] = GTPU_IE_RECOVERY;
+    gtpu[13] = 0;
+    pkt->len = 14;
+    return GTPU_US_TO_S1U;
+  }
+  if (gtpu[1] != GTPU_G_PDU) {
+    return GTPU_US_DROP;
+  }
+
+  memcpy (&teid, &gtpu[4], sizeof (teid));
+  tunnel = gtpu_us_table_get (&gtpu_us.ul, ntohl (teid));
+  if (!tunnel) {
+    return GTPU_US_DROP;
+  }
+  // IPv4 only, and from the UE the tunnel belongs to
+  if ((msg_len - hdr_len < 20) || ((gtpu[hdr_len] >> 4) != 4)) {
+    return GTPU_US_DROP;
+  }
+  memcpy (&ue, &gtpu[hdr_len + 12], sizeof (ue));
+  if (ue != tunnel->ue.s_addr) {
+    return GTPU_US_DROP;
+  }
+  if (!gtpu_us_police (tunnel, NULL, GTPU_US_UL, msg_len - hdr_len, now_ns)) {
+    stats->policed += 1;
+    return GTPU_US_DROP;
+  }
+  pkt->data = &gtpu[hdr_len];
+  pkt->len = msg_len - hdr_len;
+  stats->ul_packets += 1;
+  stats->ul_bytes += pkt->len;
+  if (stats->bearers) {
+    stats->bearers[tunnel->counter_id].ul_packets += 1;
+    stats->bearers[tunnel->counter_id].ul_bytes += pkt->len;
+  }
+  return GTPU_US_TO_SGI;
+}
+
+//------------------------------------------------------------------------------
+// Tunnel of the dedicated bearer the packet falls in, the first tunnel of the UE otherwise
+static inline const gtpu_us_tunnel_t *gtpu_us_sdf_steer (const gtpu_us_tunnel_t * const ue_tunnel, const gtpu_us_pkt_t * const pkt)
+{
+  const gtpu_us_sdf_bearers_t            *sdf = ue_tunnel->sdf;
+  pgw_sdf_flow_t                          flow;
+  uint32_t                                sdf_id = PGW_SDF_NO_MATCH;
+
+  if ((!gtpu_us.sdf_classifier) || (RETURNok != pgw_sdf_flow_from_ipv4 (pkt->data, pkt->len, true, &flow))) {
+    return ue_tunnel;
+  }
+  sdf_id = pgw_sdf_classify (gtpu_us.sdf_classifier, &flow);
+  for (uint32_t i = 0; (PGW_SDF_NO_MATCH != sdf_id) && (i < sdf->nb); i++) {
+    if (sdf->sdf_id[i] == sdf_id) {
+      const gtpu_us_tunnel_t             *tunnel = gtpu_us_table_get (&gtpu_us.ul, sdf->i_tei[i]);
+
+      return ((tunnel) && (tunnel->ue.s_addr == ue_tunnel->ue.s_addr)) ? tunnel : ue_tunnel;
+    }
+  }
+  return ue_tunnel;
+}
+
+//------------------------------------------------------------------------------
+static inline gtpu_us_verdict_t gtpu_us_downlink_pkt (gtpu_us_pkt_t * const pkt, const uint64_t now_ns, gtpu_us_stats_t * const stats)
+{
+  uint8_t                                *gtpu = NULL;
+  uint32_t                                ue = 0;
+  uint32_t                                teid = 0;
+  const gtpu_us_tunnel_t                 *ue_tunnel = NULL;
+  const gtpu_us_tunnel_t                 *tunnel = NULL;
+
+  if ((pkt->len < 20) || ((pkt->data[0] >> 4) != 4)) {
+    return GTPU_US_DROP;
+  }
+  memcpy (&ue, &pkt->data[16], sizeof (ue));
+  ue_tunnel = gtpu_us_table_get (&gtpu_us.dl, ue);
+  if (!ue_tunnel) {
+    return GTPU_US_DROP;
+  }
+  // only the UEs with dedicated bearers pay for the classification
+  tunnel = (ue_tunnel->sdf) ? gtpu_us_sdf_steer (ue_tunnel, pkt) : ue_tunnel;
+  if (!gtpu_us_police (tunnel, ue_tunnel, GTPU_US_DL, pkt->len, now_ns)) {
+    stats->policed += 1;
+    return GTPU_US_DROP;
+  }
+  stats->dl_packets += 1;
+  stats->dl_bytes += pkt->len;
+  if (stats->bearers) {
+    stats->bearers[tunnel->counter_id].dl_packets += 1;
+    stats->bearers[tunnel->counter_id].dl_bytes += pkt->len;
+  }
+
+  gtpu = pkt->data - GTPU_HEADER_LENGTH;
+  gtpu[0] = GTPU_FLAGS_V1_PT;
+  gtpu[1] = GTPU_G_PDU;
+  gtpu[2] = pkt->len >> 8;
+  gtpu[3] = pkt->len & 0xFF;
+  teid = htonl (tunnel->o_tei);
+  memcpy (&gtpu[4], &teid, sizeof (teid));
+  pkt->data = gtpu;
+  pkt->len += GTPU_HEADER_LENGTH;
+  pkt->peer = tunnel->enb;
+  return GTPU_US_TO_S1U;
+}
+
+//------------------------------------------------------------------------------
+void gtpu_us_uplink_burst (gtpu_us_pkt_t * const pkts, const uint32_t nb_pkts, const uint64_t now_ns, gtpu_us_stats_t * const stats)
+{
+  pthread_rwlock_rdlock (&gtpu_us.lock);
+  for (uint32_t i = 0; i < nb_pkts; i++) {
+    pkts[i].verdict = gtpu_us_uplink_pkt (&pkts[i], now_ns, stats);
+    stats->drops += (pkts[i].verdict == GTPU_US_DROP);
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+}
+
+//------------------------------------------------------------------------------
+void gtpu_us_downlink_burst (gtpu_us_pkt_t * const pkts, const uint32_t nb_pkts, const uint64_t now_ns, gtpu_us_stats_t * const stats)
+{
+  pthread_rwlock_rdlock (&gtpu_us.lock);
+  for (uint32_t i = 0; i < nb_pkts; i++) {
+    pkts[i].verdict = gtpu_us_downlink_pkt (&pkts[i], now_ns, stats);
+    stats->drops += (pkts[i].verdict == GTPU_US_DROP);
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_counters_grow (const uint32_t nb_counters)
+{
+  uint32_t                               *free_ids = realloc (gtpu_us.free_counter_ids, nb_counters * sizeof (uint32_t));
+  gtpu_us_qos_t                          *qos = NULL;
+
+  if (!free_ids) {
+    return RETURNerror;
+  }
+  gtpu_us.free_counter_ids = free_ids;
+  // realloc does not keep the alignment
+  if (posix_memalign ((void **)&qos, sizeof (gtpu_us_qos_t), nb_counters * sizeof (gtpu_us_qos_t))) {
+    return RETURNerror;
+  }
+  memset (qos, 0, nb_counters * sizeof (gtpu_us_qos_t));
+  if (gtpu_us.qos) {
+    memcpy (qos, gtpu_us.qos, gtpu_us.nb_counters * sizeof (gtpu_us_qos_t));
+    free (gtpu_us.qos);
+  }
+  gtpu_us.qos = qos;
+  for (uint32_t i = 0; i < gtpu_us.nb_workers && gtpu_us.workers; i++) {
+    gtpu_us_counters_t                   *counters = realloc (gtpu_us.workers[i].stats.bearers, nb_counters * sizeof (gtpu_us_counters_t));
+
+    if (!counters) {
+      return RETURNerror;
+    }
+    memset (&counters[gtpu_us.nb_counters], 0, (nb_counters - gtpu_us.nb_counters) * sizeof (gtpu_us_counters_t));
+    gtpu_us.workers[i].stats.bearers = counters;
+  }
+  gtpu_us.nb_counters = nb_counters;
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+// Called with the tables write locked, the workers are out of their bursts
+static int gtpu_us_counter_alloc (uint32_t * const counter_id)
+{
+  if (gtpu_us.nb_free_counter_ids) {
+    *counter_id = gtpu_us.free_counter_ids[--gtpu_us.nb_free_counter_ids];
+  } else {
+    if ((gtpu_us.next_counter_id == gtpu_us.nb_counters) && (RETURNok != gtpu_us_counters_grow (2 * gtpu_us.nb_counters))) {
+      return RETURNerror;
+    }
+    *counter_id = gtpu_us.next_counter_id++;
+  }
+  for (uint32_t i = 0; i < gtpu_us.nb_workers && gtpu_us.workers; i++) {
+    memset (&gtpu_us.workers[i].stats.bearers[*counter_id], 0, sizeof (gtpu_us_counters_t));
+  }
+  memset (&gtpu_us.qos[*counter_id], 0, sizeof (gtpu_us_qos_t));
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_counter_free (const uint32_t counter_id)
+{
+  gtpu_us.free_counter_ids[gtpu_us.nb_free_counter_ids++] = counter_id;
+}
+
+//------------------------------------------------------------------------------
+// Called with the tables locked, the workers may be counting: 64 bits loads and stores are not torn
+static void gtpu_us_counter_sum (const gtpu_us_tunnel_t * const tunnel, gtpu_us_usage_t * const usage)
+{
+  memset (usage, 0, sizeof (*usage));
+  usage->i_tei = tunnel->i_tei;
+  usage->o_tei = tunnel->o_tei;
+  usage->ue = tunnel->ue;
+  for (uint32_t i = 0; i < gtpu_us.nb_workers && gtpu_us.workers; i++) {
+    const gtpu_us_counters_t             *counters = &gtpu_us.workers[i].stats.bearers[tunnel->counter_id];
+
+    usage->counters.ul_packets += counters->ul_packets;
+    usage->counters.ul_bytes += counters->ul_bytes;
+    usage->counters.dl_packets += counters->dl_packets;
+    usage->counters.dl_bytes += counters->dl_bytes;
+  }
+}
+
+//------------------------------------------------------------------------------
+static gtpu_us_usage_t *gtpu_us_usage_list_add (gtpu_us_usage_list_t * const list)
+{
+  if (list->nb == list->max) {
+    const uint32_t                        max = (list->max) ? 2 * list->max : GTPU_US_COUNTERS_MIN;
+    gtpu_us_usage_t                      *usages = realloc (list->usages, max * sizeof (gtpu_us_usage_t));
+
+    if (!usages) {
+      return NULL;
+    }
+    list->usages = usages;
+    list->max = max;
+  }
+  return &list->usages[list->nb++];
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_usage_write (const gtpu_us_usage_list_t * const list, const time_t now, const char * const state)
+{
+  for (uint32_t i = 0; i < list->nb; i++) {
+    const gtpu_us_usage_t                *usage = &list->usages[i];
+
+    fprintf (gtpu_us.usage.file, "%ld,%u,%u,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%s\n", (long)now, usage->i_tei, usage->o_tei,
+        inet_ntoa (usage->ue), usage->counters.ul_packets, usage->counters.ul_bytes, usage->counters.dl_packets, usage->counters.dl_bytes, state);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_usage_report (void)
+{
+  gtpu_us_usage_list_t                   *snapshot = &gtpu_us.usage.snapshot;
+  gtpu_us_usage_list_t                    closed = {0};
+  const time_t                            now = time (NULL);
+
+  // copy the counters under the lock, format them after
+  snapshot->nb = 0;
+  pthread_rwlock_rdlock (&gtpu_us.lock);
+  for (uint32_t i = 0; i <= gtpu_us.ul.mask; i++) {
+    gtpu_us_usage_t                      *usage = NULL;
+
+    if ((gtpu_us.ul.slots[i].i_tei) && ((usage = gtpu_us_usage_list_add (snapshot)))) {
+      gtpu_us_counter_sum (&gtpu_us.ul.slots[i], usage);
+    }
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  pthread_mutex_lock (&gtpu_us.usage.closed_lock);
+  closed = gtpu_us.usage.closed;
+  memset (&gtpu_us.usage.closed, 0, sizeof (gtpu_us.usage.closed));
+  pthread_mutex_unlock (&gtpu_us.usage.closed_lock);
+
+  gtpu_us_usage_write (snapshot, now, "active");
+  gtpu_us_usage_write (&closed, now, "closed");
+  fflush (gtpu_us.usage.file);
+  free (closed.usages);
+}
+
+//------------------------------------------------------------------------------
+static void *gtpu_us_usage_thread (void *args)
+{
+  uint64_t                                elapsed_ms = 0;
+
+  while (gtpu_us.running) {
+    usleep (GTPU_US_POLL_TIMEOUT_MS * 1000);
+    elapsed_ms += GTPU_US_POLL_TIMEOUT_MS;
+    if (elapsed_ms >= (uint64_t)gtpu_us.usage.period_sec * 1000) {
+      gtpu_us_usage_report ();
+      elapsed_ms = 0;
+    }
+  }
+  // the traffic since the last period
+  gtpu_us_usage_report ();
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+int gtpu_us_usage_report_start (const char * const path, const uint32_t period_sec)
+{
+  if ((!gtpu_us.running) || (!period_sec) || (gtpu_us.usage.file)) {
+    return RETURNerror;
+  }
+  gtpu_us.usage.file = fopen (path, "a");
+  if (!gtpu_us.usage.file) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot open usage report file %s: %s\n", path, strerror (errno));
+    return RETURNerror;
+  }
+  if (0 == ftell (gtpu_us.usage.file)) {
+    fprintf (gtpu_us.usage.file, "time,i_tei,o_tei,ue,ul_packets,ul_bytes,dl_packets,dl_bytes,state\n");
+  }
+  gtpu_us.usage.period_sec = period_sec;
+  if (pthread_create (&gtpu_us.usage.thread, NULL, gtpu_us_usage_thread, NULL)) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot start the usage report thread: %s\n", strerror (errno));
+    gtpu_us.usage.thread = 0;
+    fclose (gtpu_us.usage.file);
+    gtpu_us.usage.file = NULL;
+    return RETURNerror;
+  }
+  OAILOG_NOTICE (LOG_GTPV1U, "Per bearer usage reported in %s every %u s\n", path, period_sec);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static inline uint64_t gtpu_us_now_ns (void)
+{
+  struct timespec                         ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_worker_send (gtpu_us_worker_t * const worker, const uint32_t nb_msgs)
+{
+  uint32_t                                sent = 0;
+
+  while (sent < nb_msgs) {
+    int                                   rc = sendmmsg (worker->s1u_fd, &worker->msgs[sent], nb_msgs - sent, 0);
+
+    if (rc <= 0) {
+      if ((rc < 0) && (errno == EINTR)) {
+        continue;
+      }
+      worker->stats.drops += nb_msgs - sent;
+      return;
+    }
+    sent += rc;
+  }
+}
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_us_worker_uplink (gtpu_us_worker_t * const worker)
+{
+  uint32_t                                nb_tx = 0;
+  int                                     nb_rx = 0;
+
+  for (int i = 0; i < GTPU_US_BURST_SIZE; i++) {
+    worker->iovs[i].iov_base = worker->buffers[i];
+    worker->iovs[i].iov_len = GTPU_US_BUFFER_SIZE;
+    worker->msgs[i].msg_hdr.msg_name = &worker->addrs[i];
+    worker->msgs[i].msg_hdr.msg_namelen = sizeof (worker->addrs[i]);
+    worker->msgs[i].msg_hdr.msg_iov = &worker->iovs[i];
+    worker->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  nb_rx = recvmmsg (worker->s1u_fd, worker->msgs, GTPU_US_BURST_SIZE, MSG_DONTWAIT, NULL);
+  if (nb_rx <= 0) {
+    return 0;
+  }
+  for (int i = 0; i < nb_rx; i++) {
+    worker->pkts[i].data = worker->buffers[i];
+    worker->pkts[i].len = worker->msgs[i].msg_len;
+    worker->pkts[i].peer = worker->addrs[i].sin_addr;
+  }
+  gtpu_us_uplink_burst (worker->pkts, nb_rx, gtpu_us_now_ns (), &worker->stats);
+
+  for (int i = 0; i < nb_rx; i++) {
+    if (worker->pkts[i].verdict == GTPU_US_TO_SGI) {
+      if (write (worker->tun_fd, worker->pkts[i].data, worker->pkts[i].len) < 0) {
+        worker->stats.drops += 1;
+      }
+    } else if (worker->pkts[i].verdict == GTPU_US_TO_S1U) {
+      // echo responses go back where the requests came from
+      worker->iovs[nb_tx].iov_base = worker->pkts[i].data;
+      worker->iovs[nb_tx].iov_len = worker->pkts[i].len;
+      worker->msgs[nb_tx].msg_hdr.msg_name = &worker->addrs[i];
+      worker->msgs[nb_tx].msg_hdr.msg_namelen = sizeof (worker->addrs[i]);
+      nb_tx++;
+    }
+  }
+  if (nb_tx) {
+    gtpu_us_worker_send (worker, nb_tx);
+  }
+  return nb_rx;
+}
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_us_worker_downlink (gtpu_us_worker_t * const worker)
+{
+  uint32_t                                nb_tx = 0;
+  uint32_t                                nb_rx = 0;
+
+  while (nb_rx < GTPU_US_BURST_SIZE) {
+    ssize_t                               len = read (worker->tun_fd, &worker->buffers[nb_rx][GTPU_US_HEADROOM], GTPU_US_BUFFER_SIZE - GTPU_US_HEADROOM);
+
+    if (len <= 0) {
+      break;
+    }
+    worker->pkts[nb_rx].data = &worker->buffers[nb_rx][GTPU_US_HEADROOM];
+    worker->pkts[nb_rx].len = len;
+    nb_rx++;
+  }
+  if (!nb_rx) {
+    return 0;
+  }
+  gtpu_us_downlink_burst (worker->pkts, nb_rx, gtpu_us_now_ns (), &worker->stats);
+
+  for (uint32_t i = 0; i < nb_rx; i++) {
+    if (worker->pkts[i].verdict == GTPU_US_TO_S1U) {
+      worker->addrs[nb_tx].sin_family = AF_INET;
+      worker->addrs[nb_tx].sin_port = htons (GTPV1U_UDP_PORT);
+      worker->addrs[nb_tx].sin_addr = worker->pkts[i].peer;
+      worker->iovs[nb_tx].iov_base = worker->pkts[i].data;
+      worker->iovs[nb_tx].iov_len = worker->pkts[i].len;
+      worker->msgs[nb_tx].msg_hdr.msg_name = &worker->addrs[nb_tx];
+      worker->msgs[nb_tx].msg_hdr.msg_namelen = sizeof (worker->addrs[nb_tx]);
+      worker->msgs[nb_tx].msg_hdr.msg_iov = &worker->iovs[nb_tx];
+      worker->msgs[nb_tx].msg_hdr.msg_iovlen = 1;
+      nb_tx++;
+    }
+  }
+  if (nb_tx) {
+    gtpu_us_worker_send (worker, nb_tx);
+  }
+  return nb_rx;
+}
+
+//------------------------------------------------------------------------------
+static void *gtpu_us_worker_thread (void *args)
+{
+  gtpu_us_worker_t                       *worker = (gtpu_us_worker_t *)args;
+  struct pollfd                           pfds[2] = {{.fd = worker->s1u_fd, .events = POLLIN}, {.fd = worker->tun_fd, .events = POLLIN}};
+
+  // run to completion, only wait when both directions are idle
+  while (gtpu_us.running) {
+    uint32_t                              nb_pkts = gtpu_us_worker_uplink (worker);
+
+    nb_pkts += gtpu_us_worker_downlink (worker);
+    if (!nb_pkts) {
+      poll (pfds, 2, GTPU_US_POLL_TIMEOUT_MS);
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_worker_open (gtpu_us_worker_t * const worker)
+{
+  struct ifreq                            ifr = {0};
+  int                                     on = 1;
+  int                                     bufsize = GTPU_US_SOCKET_BUFFER_SIZE;
+  struct sockaddr_in                      addr = {
+    .sin_family = AF_INET,
+    .sin_port = htons (GTPV1U_UDP_PORT),
+    .sin_addr = gtpu_us.s1u,
+  };
+
+  // one S1-U socket per worker, the kernel spreads the eNBs over them
+  worker->s1u_fd = socket (AF_INET, SOCK_DGRAM, 0);
+  if (worker->s1u_fd < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot create S1-U socket: %s\n", strerror (errno));
+    return RETURNerror;
+  }
+  if (setsockopt (worker->s1u_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on)) < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "SO_REUSEPORT on S1-U socket: %s\n", strerror (errno));
+    return RETURNerror;
+  }
+  setsockopt (worker->s1u_fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof (bufsize));
+  setsockopt (worker->s1u_fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof (bufsize));
+  if (bind (worker->s1u_fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "bind S1U port %s:%u: %s\n", inet_ntoa (gtpu_us.s1u), GTPV1U_UDP_PORT, strerror (errno));
+    return RETURNerror;
+  }
+
+  // one queue of the TUN device per worker, the kernel spreads the UE flows over them
+  worker->tun_fd = open ("/dev/net/tun", O_RDWR | O_NONBLOCK);
+  if (worker->tun_fd < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot open /dev/net/tun: %s\n", strerror (errno));
+    return RETURNerror;
+  }
+  ifr.ifr_flags = IFF_TUN | IFF_NO_PI | IFF_MULTI_QUEUE;
+  strncpy (ifr.ifr_name, GTP_DEVNAME, IFNAMSIZ - 1);
+  if (ioctl (worker->tun_fd, TUNSETIFF, &ifr) < 0) {
+    OAILOG_ERROR (LOG_GTPV1U, "Cannot attach to TUN device %s: %s\n", GTP_DEVNAME, strerror (errno));
+    return RETURNerror;
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_system (bstring system_cmd)
+{
+  int                                     ret = system ((const char *)system_cmd->data);
+
+  if (ret) {
+    OAILOG_ERROR (LOG_GTPV1U, "ERROR in system command %s: %d at %s:%u\n", bdata(system_cmd), ret, __FILE__, __LINE__);
+  }
+  bdestroy(system_cmd);
+  return (ret) ? RETURNerror : RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_uninit (void)
+{
+  gtpu_us_stats_t                         total = {0};
+
+  if (!gtpu_us.is_enabled) {
+    return RETURNerror;
+  }
+  gtpu_us.running = false;
+  for (uint32_t i = 0; i < gtpu_us.nb_workers && gtpu_us.workers; i++) {
+    gtpu_us_worker_t                     *worker = &gtpu_us.workers[i];
+
+    if (worker->thread) {
+      pthread_join (worker->thread, NULL);
+    }
+    if (worker->s1u_fd >= 0) {
+      close (worker->s1u_fd);
+    }
+    if (worker->tun_fd >= 0) {
+      close (worker->tun_fd);
+    }
+    total.ul_packets += worker->stats.ul_packets;
+    total.ul_bytes += worker->stats.ul_bytes;
+    total.dl_packets += worker->stats.dl_packets;
+    total.dl_bytes += worker->stats.dl_bytes;
+    total.drops += worker->stats.drops;
+    total.policed += worker->stats.policed;
+  }
+  if (gtpu_us.usage.thread) {
+    pthread_join (gtpu_us.usage.thread, NULL);
+  }
+  if (gtpu_us.usage.file) {
+    fclose (gtpu_us.usage.file);
+  }
+  free (gtpu_us.usage.snapshot.usages);
+  free (gtpu_us.usage.closed.usages);
+  pthread_mutex_destroy (&gtpu_us.usage.closed_lock);
+  for (uint32_t i = 0; i < gtpu_us.nb_workers && gtpu_us.workers; i++) {
+    free (gtpu_us.workers[i].stats.bearers);
+  }
+  free (gtpu_us.free_counter_ids);
+  free (gtpu_us.qos);
+  if (gtpu_us.workers) {
+    OAILOG_INFO (LOG_GTPV1U, "GTP-U userspace: UL %" PRIu64 " packets %" PRIu64 " bytes, DL %" PRIu64 " packets %" PRIu64 " bytes, %" PRIu64 " dropped (%" PRIu64 " over their rate)\n",
+        total.ul_packets, total.ul_bytes, total.dl_packets, total.dl_bytes, total.drops, total.policed);
+  }
+  free (gtpu_us.workers);
+  for (uint32_t i = 0; (gtpu_us.dl.slots) && (i <= gtpu_us.dl.mask); i++) {
+    free (gtpu_us.dl.slots[i].sdf);
+  }
+  free (gtpu_us.ul.slots);
+  free (gtpu_us.dl.slots);
+  pthread_rwlock_destroy (&gtpu_us.lock);
+  memset (&gtpu_us, 0, sizeof (gtpu_us));
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_init (struct in_addr *ue_net, uint32_t mask, int mtu, int *fd0, int *fd1u)
+{
+  struct in_addr                          ue_gw = {.s_addr = ue_net->s_addr | htonl (1)};
+
+  if (mtu + GTPU_US_HEADROOM > GTPU_US_BUFFER_SIZE) {
+    OAILOG_ERROR (LOG_GTPV1U, "MTU %d too large for the GTP-U userspace buffers\n", mtu);
+    return RETURNerror;
+  }
+  gtpu_us.workers = calloc (gtpu_us.nb_workers, sizeof (gtpu_us_worker_t));
+  if (!gtpu_us.workers) {
+    return RETURNerror;
+  }
+  for (uint32_t i = 0; i < gtpu_us.nb_workers; i++) {
+    gtpu_us.workers[i].id = i;
+    gtpu_us.workers[i].s1u_fd = -1;
+    gtpu_us.workers[i].tun_fd = -1;
+    gtpu_us.workers[i].stats.bearers = calloc (gtpu_us.nb_counters, sizeof (gtpu_us_counters_t));
+    if (!gtpu_us.workers[i].stats.bearers) {
+      return RETURNerror;
+    }
+  }
+  for (uint32_t i = 0; i < gtpu_us.nb_workers; i++) {
+    if (RETURNok != gtpu_us_worker_open (&gtpu_us.workers[i])) {
+      return RETURNerror;
+    }
+  }
+
+  if ((RETURNok != gtpu_us_system (bformat ("ip link set dev %s mtu %u up", GTP_DEVNAME, mtu)))
+      || (RETURNok != gtpu_us_system (bformat ("ip addr add %s/%u dev %s", inet_ntoa (ue_gw), mask, GTP_DEVNAME)))) {
+    return RETURNerror;
+  }
+
+  gtpu_us.running = true;
+  for (uint32_t i = 0; i < gtpu_us.nb_workers; i++) {
+    gtpu_us_worker_t                     *worker = &gtpu_us.workers[i];
+    cpu_set_t                             cpuset;
+
+    if (pthread_create (&worker->thread, NULL, gtpu_us_worker_thread, worker)) {
+      OAILOG_ERROR (LOG_GTPV1U, "Cannot start GTP-U worker %u: %s\n", i, strerror (errno));
+      worker->thread = 0;
+      return RETURNerror;
+    }
+    CPU_ZERO (&cpuset);
+    CPU_SET (gtpu_us.first_core + i, &cpuset);
+    if (pthread_setaffinity_np (worker->thread, sizeof (cpuset), &cpuset)) {
+      OAILOG_WARNING (LOG_GTPV1U, "Cannot pin GTP-U worker %u on core %u\n", i, gtpu_us.first_core + i);
+    }
+  }
+  // no GTPv0, and the S1-U socket belongs to the workers
+  *fd0 = -1;
+  *fd1u = gtpu_us.workers[0].s1u_fd;
+  OAILOG_NOTICE (LOG_GTPV1U, "Using the GTP userspace mode, %u worker(s) on %s:%u\n", gtpu_us.nb_workers, inet_ntoa (gtpu_us.s1u), GTPV1U_UDP_PORT);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_reset (void)
+{
+  // the TUN device is not persistent, it is gone with the previous process
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_add_tunnel (struct in_addr ue, struct in_addr enb, uint32_t i_tei, uint32_t o_tei)
+{
+  gtpu_us_tunnel_t                        tunnel = {.i_tei = i_tei, .o_tei = o_tei, .ue = ue, .enb = enb};
+  gtpu_us_tunnel_t                       *current = NULL;
+  int                                     rc = RETURNok;
+
+  if ((!i_tei) || (!ue.s_addr)) {
+    return RETURNerror;
+  }
+  pthread_rwlock_wrlock (&gtpu_us.lock);
+  current = gtpu_us_table_get (&gtpu_us.ul, i_tei);
+  if (current) {
+    // eNB side changed (handover, idle mode exit), the bearer keeps counting
+    tunnel.counter_id = current->counter_id;
+    *current = tunnel;
+  } else if (RETURNok == (rc = gtpu_us_counter_alloc (&tunnel.counter_id))) {
+    rc = gtpu_us_table_put (&gtpu_us.ul, &tunnel);
+    if (RETURNok != rc) {
+      gtpu_us_counter_free (tunnel.counter_id);
+    }
+  }
+  // downlink goes to the first bearer of the UE, or to the bearers set by add_sdf_bearer
+  current = gtpu_us_table_get (&gtpu_us.dl, ue.s_addr);
+  if (current) {
+    if (current->i_tei == i_tei) {
+      tunnel.sdf = current->sdf;
+      *current = tunnel;
+    }
+  } else if (RETURNok == rc) {
+    rc = gtpu_us_table_put (&gtpu_us.dl, &tunnel);
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_del_tunnel (uint32_t i_tei, uint32_t o_tei)
+{
+  gtpu_us_tunnel_t                       *current = NULL;
+  struct in_addr                          ue = {.s_addr = 0};
+
+  pthread_rwlock_wrlock (&gtpu_us.lock);
+  current = gtpu_us_table_get (&gtpu_us.ul, i_tei);
+  if (!current) {
+    pthread_rwlock_unlock (&gtpu_us.lock);
+    return RETURNerror;
+  }
+  ue = current->ue;
+  if (gtpu_us.usage.file) {
+    gtpu_us_usage_t                      *usage = NULL;
+
+    pthread_mutex_lock (&gtpu_us.usage.closed_lock);
+    if ((usage = gtpu_us_usage_list_add (&gtpu_us.usage.closed))) {
+      gtpu_us_counter_sum (current, usage);
+    }
+    pthread_mutex_unlock (&gtpu_us.usage.closed_lock);
+  }
+  gtpu_us_counter_free (current->counter_id);
+  gtpu_us_table_remove (&gtpu_us.ul, current);
+  current = gtpu_us_table_get (&gtpu_us.dl, ue.s_addr);
+  if ((current) && (current->i_tei == i_tei)) {
+    free (current->sdf);
+    gtpu_us_table_remove (&gtpu_us.dl, current);
+  } else if ((current) && (current->sdf)) {
+    gtpu_us_sdf_bearers_t                *sdf = current->sdf;
+
+    for (uint32_t i = 0; i < sdf->nb; ) {
+      if (sdf->i_tei[i] == i_tei) {
+        sdf->nb -= 1;
+        sdf->sdf_id[i] = sdf->sdf_id[sdf->nb];
+        sdf->i_tei[i] = sdf->i_tei[sdf->nb];
+      } else {
+        i++;
+      }
+    }
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_add_sdf_bearer (struct in_addr ue, uint32_t sdf_id, uint32_t i_tei)
+{
+  gtpu_us_tunnel_t                       *ue_tunnel = NULL;
+  gtpu_us_sdf_bearers_t                  *sdf = NULL;
+  int                                     rc = RETURNerror;
+
+  if (PGW_SDF_NO_MATCH == sdf_id) {
+    return RETURNerror;
+  }
+  pthread_rwlock_wrlock (&gtpu_us.lock);
+  ue_tunnel = gtpu_us_table_get (&gtpu_us.dl, ue.s_addr);
+  if ((ue_tunnel) && (!ue_tunnel->sdf)) {
+    ue_tunnel->sdf = calloc (1, sizeof (gtpu_us_sdf_bearers_t));
+  }
+  if ((ue_tunnel) && ((sdf = ue_tunnel->sdf))) {
+    uint32_t                              i = 0;
+
+    while ((i < sdf->nb) && (sdf->sdf_id[i] != sdf_id)) {
+      i++;
+    }
+    if (i < GTPU_US_SDF_BEARERS_MAX) {
+      sdf->sdf_id[i] = sdf_id;
+      sdf->i_tei[i] = i_tei;
+      sdf->nb += (i == sdf->nb);
+      rc = RETURNok;
+    }
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_del_sdf_bearer (struct in_addr ue, uint32_t sdf_id)
+{
+  gtpu_us_tunnel_t                       *ue_tunnel = NULL;
+  gtpu_us_sdf_bearers_t                  *sdf = NULL;
+  int                                     rc = RETURNerror;
+
+  pthread_rwlock_wrlock (&gtpu_us.lock);
+  ue_tunnel = gtpu_us_table_get (&gtpu_us.dl, ue.s_addr);
+  if ((ue_tunnel) && ((sdf = ue_tunnel->sdf))) {
+    for (uint32_t i = 0; i < sdf->nb; i++) {
+      if (sdf->sdf_id[i] == sdf_id) {
+        sdf->nb -= 1;
+        sdf->sdf_id[i] = sdf->sdf_id[sdf->nb];
+        sdf->i_tei[i] = sdf->i_tei[sdf->nb];
+        rc = RETURNok;
+        break;
+      }
+    }
+    if (!sdf->nb) {
+      free (sdf);
+      ue_tunnel->sdf = NULL;
+    }
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_us_meter_set (gtpu_us_meter_t * const meter, const uint64_t kbps)
+{
+  // 8e9 ps per byte at 1 kbps, 80 at 100 Gbps
+  const uint64_t                          ps_per_byte = (kbps) ? 8000000000 / kbps : 0;
+
+  if (meter->ps_per_byte != ps_per_byte) {
+    meter->ps_per_byte = ps_per_byte;
+    meter->tolerance_ns = (uint64_t)GTPU_US_QOS_BURST_MS * 1000000;
+    meter->tat_ns = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+static int gtpu_us_set_qos (uint32_t i_tei, uint64_t mbr_ul, uint64_t mbr_dl, uint64_t ambr_ul, uint64_t ambr_dl)
+{
+  const gtpu_us_tunnel_t                 *tunnel = NULL;
+  const gtpu_us_tunnel_t                 *ue_tunnel = NULL;
+  gtpu_us_qos_t                          *qos = NULL;
+
+  pthread_rwlock_wrlock (&gtpu_us.lock);
+  tunnel = gtpu_us_table_get (&gtpu_us.ul, i_tei);
+  if (!tunnel) {
+    pthread_rwlock_unlock (&gtpu_us.lock);
+    return RETURNerror;
+  }
+  qos = &gtpu_us.qos[tunnel->counter_id];
+  gtpu_us_meter_set (&qos->mbr[GTPU_US_UL], mbr_ul);
+  gtpu_us_meter_set (&qos->mbr[GTPU_US_DL], mbr_dl);
+  qos->in_ambr = (ambr_ul) || (ambr_dl);
+  // the APN-AMBR is kept on the tunnel the downlink of the UE goes to
+  ue_tunnel = gtpu_us_table_get (&gtpu_us.dl, tunnel->ue.s_addr);
+  if ((qos->in_ambr) && (ue_tunnel)) {
+    gtpu_us_meter_set (&gtpu_us.qos[ue_tunnel->counter_id].ambr[GTPU_US_UL], ambr_ul);
+    gtpu_us_meter_set (&gtpu_us.qos[ue_tunnel->counter_id].ambr[GTPU_US_DL], ambr_dl);
+  }
+  pthread_rwlock_unlock (&gtpu_us.lock);
+  return RETURNok;
+}
+
+static const struct gtp_tunnel_ops gtpu_us_ops = {
+  .init         = gtpu_us_init,
+  .uninit       = gtpu_us_uninit,
+  .reset        = gtpu_us_reset,
+  .add_tunnel   = gtpu_us_add_tunnel,
+  .del_tunnel   = gtpu_us_del_tunnel,
+  .set_qos      = gtpu_us_set_qos,
+  .add_sdf_bearer = gtpu_us_add_sdf_bearer,
+  .del_sdf_bearer = gtpu_us_del_sdf_bearer,
+};
+
+//------------------------------------------------------------------------------
+const struct gtp_tunnel_ops *gtp_tunnel_ops_userspace_init (const struct in_addr s1u, const uint32_t nb_workers, const uint32_t first_core,
+                                                            pgw_sdf_classifier_t * const sdf_classifier)
+{
+  pthread_rwlockattr_t                    attr;
+
+  if ((gtpu_us.is_enabled) || (!nb_workers)) {
+    return NULL;
+  }
+  // tunnel updates must not wait behind a continuous flow of bursts
+  pthread_rwlockattr_init (&attr);
+  pthread_rwlockattr_setkind_np (&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init (&gtpu_us.lock, &attr);
+  pthread_rwlockattr_destroy (&attr);
+  pthread_mutex_init (&gtpu_us.usage.closed_lock, NULL);
+  if ((RETURNok != gtpu_us_table_init (&gtpu_us.ul, GTPU_US_TABLE_BITS_MIN, false))
+      || (RETURNok != gtpu_us_table_init (&gtpu_us.dl, GTPU_US_TABLE_BITS_MIN, true))
+      || (RETURNok != gtpu_us_counters_grow (GTPU_US_COUNTERS_MIN))) {
+    free (gtpu_us.ul.slots);
+    free (gtpu_us.dl.slots);
+    pthread_rwlock_destroy (&gtpu_us.lock);
+    pthread_mutex_destroy (&gtpu_us.usage.closed_lock);
+    memset (&gtpu_us, 0, sizeof (gtpu_us));
+    return NULL;
+  }
+  gtpu_us.s1u = s1u;
+  gtpu_us.nb_workers = nb_workers;
+  gtpu_us.first_core = first_core;
+  gtpu_us.sdf_classifier = sdf_classifier;
+  gtpu_us.is_enabled = true;
+  return &gtpu_us_ops;
+}
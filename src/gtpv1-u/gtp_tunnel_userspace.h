@@ -0,0 +1,114 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file gtp_tunnel_userspace.h
+* \brief Userspace GTP-U fast path, alternative to the gtp kernel module
+* \author
+* \company
+* \email:
+*/
+
+#ifndef FILE_GTP_TUNNEL_USERSPACE_SEEN
+#define FILE_GTP_TUNNEL_USERSPACE_SEEN
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include "gtpv1u.h"
+#include "pgw_sdf_classifier.h"
+
+#define GTPU_US_BURST_SIZE          32
+#define GTPU_US_HEADROOM            16     // room for the G-PDU header in front of the downlink packets
+#define GTPU_US_BUFFER_SIZE         2048
+#define GTPU_US_POLL_TIMEOUT_MS     100    // idle workers check for termination at this pace
+#define GTPU_US_QOS_BURST_MS        50     // depth of the token buckets, in time at their rate
+
+#define GTPU_ECHO_REQUEST           1
+#define GTPU_ECHO_RESPONSE          2
+#define GTPU_G_PDU                  255
+
+typedef enum {
+  GTPU_US_DROP = 0,
+  GTPU_US_TO_SGI,                  // decapsulated, to the TUN device
+  GTPU_US_TO_S1U,                  // encapsulated or echo response, to pkt->peer
+} gtpu_us_verdict_t;
+
+typedef struct gtpu_us_pkt_s {
+  uint8_t           *data;
+  uint32_t           len;
+  struct in_addr     peer;         // eNB the packet comes from or goes to
+  gtpu_us_verdict_t  verdict;
+} gtpu_us_pkt_t;
+
+typedef struct gtpu_us_counters_s {
+  uint64_t           ul_packets;
+  uint64_t           ul_bytes;
+  uint64_t           dl_packets;
+  uint64_t           dl_bytes;
+} gtpu_us_counters_t;
+
+typedef struct gtpu_us_stats_s {
+  uint64_t           ul_packets;
+  uint64_t           ul_bytes;
+  uint64_t           dl_packets;
+  uint64_t           dl_bytes;
+  uint64_t           drops;
+  uint64_t           policed;      // dropped over the MBR or the APN-AMBR, also in drops
+  gtpu_us_counters_t *bearers;     // per bearer counters of the worker, by tunnel counter id, may be NULL
+} gtpu_us_stats_t;
+
+/*
+ * Each worker runs to completion on its own core: it takes a burst of S1-U
+ * datagrams from its SO_REUSEPORT socket and a burst of IP packets from its
+ * queue of the multi queue TUN device, processes them with the functions
+ * below and sends them. Tunnels are kept in flat open addressing tables, by
+ * S-GW TEID for the uplink and by UE IPv4 address for the downlink; workers
+ * read them under a lock taken once per burst. The downlink of a UE with
+ * dedicated bearers (add_sdf_bearer) is classified against the SDF filters
+ * of sdf_classifier to pick the bearer, the others skip the classification.
+ */
+const struct gtp_tunnel_ops *gtp_tunnel_ops_userspace_init (const struct in_addr s1u, const uint32_t nb_workers, const uint32_t first_core,
+                                                            pgw_sdf_classifier_t * const sdf_classifier);
+
+/*
+ * Each worker counts the traffic of the bearers in its own array, without
+ * atomics. A reporting thread adds up the arrays every period_sec seconds and
+ * appends one CSV line per bearer to the file at path:
+ *   time,i_tei,o_tei,ue,ul_packets,ul_bytes,dl_packets,dl_bytes,state
+ * Counters are totals since the tunnel was set, state is "closed" for the
+ * last line of a deleted tunnel.
+ */
+int gtpu_us_usage_report_start (const char * const path, const uint32_t period_sec);
+
+/*
+ * Rates are enforced with one token bucket per direction for the MBR of each
+ * GBR bearer and one for the APN-AMBR of each UE, shared by its non-GBR
+ * bearers. A bucket is kept in its virtual scheduling form, the time at which
+ * it will be full again, so that workers update it with a single compare and
+ * swap. now_ns is the CLOCK_MONOTONIC time of the burst.
+ */
+// Decapsulate G-PDUs, answer echo requests, in place
+void gtpu_us_uplink_burst (gtpu_us_pkt_t * const pkts, const uint32_t nb_pkts, const uint64_t now_ns, gtpu_us_stats_t * const stats);
+
+// Encapsulate IP packets, GTPU_US_HEADROOM bytes must be available in front of pkts[i].data
+void gtpu_us_downlink_burst (gtpu_us_pkt_t * const pkts, const uint32_t nb_pkts, const uint64_t now_ns, gtpu_us_stats_t * const stats);
+
+#endif /* FILE_GTP_TUNNEL_USERSPACE_SEEN */
@@ -33,6 +33,8 @@
 
 #define GTPU_HEADER_OVERHEAD_MAX 64
 
+#define GTP_DEVNAME "gtp0"
+
 /*
  * This structure defines the management hooks for GTP tunnels.
  * The following hooks can be defined; unless noted otherwise, they are
@@ -65,6 +67,47 @@
  *     Delete a gtp tunnel.
  *         @i_tei: RX GTP Tunnel ID
  *         @o_tei: TX GTP Tunnel ID.
+ *
+ * int (*set_qos)(uint32_t i_tei, uint64_t mbr_ul, uint64_t mbr_dl, uint64_t ambr_ul, uint64_t ambr_dl);
+ *     Enforce the rates of the bearer of an existing tunnel, in kbps, 0 for no
+ *     limit. Defined by data paths that police the traffic.
+ *         @i_tei: RX GTP Tunnel ID
+ *         @mbr_ul, @mbr_dl: MBR of a GBR bearer.
+ *         @ambr_ul, @ambr_dl: APN-AMBR of the UE, shared by its non-GBR bearers.
+ *
+ * int (*add_sdf_bearer)(struct in_addr ue, uint32_t sdf_id, uint32_t i_tei);
+ *     Send the downlink packets of the UE that fall in the SDF to the tunnel of
+ *     a dedicated bearer, the others go to the first tunnel of the UE. Defined
+ *     by data paths that classify the packets themselves.
+ *         @ue: UE IP address
+ *         @sdf_id: SDF identifier of the PCC rule
+ *         @i_tei: RX GTP Tunnel ID of the dedicated bearer
+ *
+ * int (*del_sdf_bearer)(struct in_addr ue, uint32_t sdf_id);
+ *     Undo add_sdf_bearer, the packets of the SDF go back to the first tunnel.
+ *         @ue: UE IP address
+ *         @sdf_id: SDF identifier of the PCC rule
+ *
+ * The following hooks are defined by asynchronous implementations only, where
+ * add_tunnel and del_tunnel queue the change and return at once. Each change
+ * gets a sequence number, the data path acknowledges them in order. Queues and
+ * sequence numbers belong to the calling thread: the hooks below only see the
+ * changes that thread made.
+ *
+ * uint32_t (*last_seq)(void);
+ *     Returns the sequence number of the last change queued.
+ *
+ * int (*flush)(void);
+ *     Sends the queued changes, in as few messages as possible.
+ *
+ * int (*get_ack_fd)(void);
+ *     Returns the file descriptor that is readable when acknowledgements are
+ *     pending, to be watched by the task that owns the tunnels.
+ *
+ * int (*process_acks)(uint32_t *acked_seq);
+ *     Reads the pending acknowledgements without blocking, failed changes are
+ *     logged. Returns the number of changes acknowledged.
+ *         @acked_seq: set to the sequence number of the last change acknowledged.
  */
 struct gtp_tunnel_ops {
   int  (*init)(struct in_addr *ue_net, uint32_t mask, int mtu, int *fd0, int *fd1u);
@@ -72,10 +115,15 @@ struct gtp_tunnel_ops {
   int  (*reset)(void);
   int  (*add_tunnel)(struct in_addr ue, struct in_addr enb, uint32_t i_tei, uint32_t o_tei);
   int  (*del_tunnel)(uint32_t i_tei, uint32_t o_tei);
+  int  (*set_qos)(uint32_t i_tei, uint64_t mbr_ul, uint64_t mbr_dl, uint64_t ambr_ul, uint64_t ambr_dl);
+  int  (*add_sdf_bearer)(struct in_addr ue, uint32_t sdf_id, uint32_t i_tei);
+  int  (*del_sdf_bearer)(struct in_addr ue, uint32_t sdf_id);
+  uint32_t (*last_seq)(void);
+  int  (*flush)(void);
+  int  (*get_ack_fd)(void);
+  int  (*process_acks)(uint32_t *acked_seq);
 };
 
-uint32_t gtpv1u_new_teid(void);
-
 const struct gtp_tunnel_ops *gtp_tunnel_ops_init(void);
 
 #endif /* FILE_GTPV1_U_SEEN */
@@ -50,6 +50,7 @@
 #include "common_defs.h"
 #include "intertask_interface.h"
 #include "gtpv1u.h"
+#include "gtp_tunnel_userspace.h"
 #include "sgw_config.h"
 #include "pgw_config.h"
 #include "spgw_config.h"
@@ -57,6 +58,7 @@
 #include "sgw.h"
 
 extern sgw_app_t sgw_app;
+extern pgw_app_t pgw_app;
 
 const struct gtp_tunnel_ops *gtp_tunnel_ops;
 
@@ -108,7 +110,12 @@ int gtpv1u_init (spgw_config_t *spgw_config)
   // START-GTP quick integration only for evaluation purpose
 
   OAILOG_DEBUG (LOG_GTPV1U , "Initializing gtp_tunnel_ops\n");
-  gtp_tunnel_ops = gtp_tunnel_ops_init();
+  if (spgw_config->pgw_config.use_gtp_userspace) {
+    gtp_tunnel_ops = gtp_tunnel_ops_userspace_init (spgw_config->sgw_config.ipv4.S1u_S12_S4_up,
+        spgw_config->pgw_config.gtp_userspace_workers, spgw_config->pgw_config.gtp_userspace_first_core, &pgw_app.sdf_classifier);
+  } else {
+    gtp_tunnel_ops = gtp_tunnel_ops_init();
+  }
   if (gtp_tunnel_ops == NULL) {
     OAILOG_CRITICAL (LOG_GTPV1U, "ERROR in initializing gtp_tunnel_ops\n");
     return -1;
@@ -123,9 +130,18 @@ int gtpv1u_init (spgw_config_t *spgw_config)
   AssertFatal(spgw_config->pgw_config.num_ue_pool == 1, "No more than 1 UE pool allowed actually");
   for (int i = 0; i < spgw_config->pgw_config.num_ue_pool; i++) {
     // GTP device uses the same MTU as SGi.
-    gtp_tunnel_ops->init(&spgw_config->pgw_config.ue_pool_addr[i],
+    rv = gtp_tunnel_ops->init(&spgw_config->pgw_config.ue_pool_addr[i],
                          spgw_config->pgw_config.ue_pool_mask[i], spgw_config->pgw_config.ipv4.mtu_SGI,
                          &sgw_app.gtpv1u_data.fd0, &sgw_app.gtpv1u_data.fd1u);
+    if (rv != RETURNok) {
+      OAILOG_CRITICAL (LOG_GTPV1U, "ERROR in initializing the GTP device\n");
+      gtp_tunnel_ops->uninit();
+      return -1;
+    }
+  }
+  if ((spgw_config->pgw_config.use_gtp_userspace) && (spgw_config->pgw_config.usage_report_period_sec)
+      && (RETURNok != gtpu_us_usage_report_start (bdata (spgw_config->pgw_config.usage_report_file), spgw_config->pgw_config.usage_report_period_sec))) {
+    OAILOG_WARNING (LOG_GTPV1U, "No per bearer usage report\n");
   }
   // END-GTP quick integration only for evaluation purpose
 
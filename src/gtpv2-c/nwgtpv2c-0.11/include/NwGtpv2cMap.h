@@ -0,0 +1,129 @@
+/*----------------------------------------------------------------------------*
+ *                                                                            *
+ *                              n w - g t p v 2 c                             *
+ *    G P R S   T u n n e l i n g    P r o t o c o l   v 2 c    S t a c k     *
+ *                                                                            *
+ *                                                                            *
+ * Copyright (c) 2010-2011 Amit Chawre                                        *
+ * All rights reserved.                                                       *
+ *                                                                            *
+ * Redistribution and use in source and binary forms, with or without         *
+ * modification, are permitted provided that the following conditions         *
+ * are met:                                                                   *
+ *                                                                            *
+ * 1. Redistributions of source code must retain the above copyright          *
+ *    notice, this list of conditions and the following disclaimer.           *
+ * 2. Redistributions in binary form must reproduce the above copyright       *
+ *    notice, this list of conditions and the following disclaimer in the     *
+ *    documentation and/or other materials provided with the distribution.    *
+ * 3. The name of the author may not be used to endorse or promote products   *
+ *    derived from this software without specific prior written permission.   *
+ *                                                                            *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR       *
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES  *
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.    *
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,           *
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT   *
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,  *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY      *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT        *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF   *
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.          *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __NW_GTPV2C_MAP_H__
+#define __NW_GTPV2C_MAP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+
+/**
+ * @file NwGtpv2cMap.h
+ * @brief Intrusive hash map used to index tunnels and outstanding transactions.
+ *
+ * Elements are linked in their bucket through a pointer field of the element
+ * itself, so that insertion and removal never allocate: elements come from the
+ * tunnel and transaction pools. The bucket array doubles when the number of
+ * elements exceeds the number of buckets.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct nw_gtpv2c_map_s {
+  void                        **bucket;
+  uint32_t                      mask;                                   /**< Number of buckets - 1, power of 2  */
+  uint32_t                      count;
+  size_t                        nextOffset;                             /**< Offset of the bucket link in elements */
+  uint32_t                    (*hash)(const void *elm);
+  int                         (*equal)(const void *a, const void *b);
+} nw_gtpv2c_map_t;
+
+/**
+ * Initialize a map.
+ *
+ * @param[out] thiz : Map.
+ * @param[in] initialSize : Initial number of buckets, rounded up to a power of 2.
+ * @param[in] nextOffset : offsetof() the bucket link pointer in elements.
+ * @param[in] hash : Hash of the key of an element.
+ * @param[in] equal : Returns non zero if the keys of two elements are equal.
+ */
+
+nw_rc_t
+nwGtpv2cMapInit(nw_gtpv2c_map_t *thiz,
+                uint32_t initialSize,
+                size_t nextOffset,
+                uint32_t (*hash)(const void *elm),
+                int (*equal)(const void *a, const void *b));
+
+nw_rc_t
+nwGtpv2cMapFinalize(nw_gtpv2c_map_t *thiz);
+
+/**
+ * Insert an element.
+ *
+ * @return NULL on success, or the element already in the map with the same key (as RB_INSERT).
+ */
+
+void*
+nwGtpv2cMapInsert(nw_gtpv2c_map_t *thiz, void *elm);
+
+/**
+ * Find the element having the same key as key.
+ */
+
+void*
+nwGtpv2cMapFind(nw_gtpv2c_map_t *thiz, const void *key);
+
+/**
+ * Remove an element.
+ *
+ * @return elm, or NULL if it was not in the map.
+ */
+
+void*
+nwGtpv2cMapRemove(nw_gtpv2c_map_t *thiz, void *elm);
+
+/**
+ * Hash functions for the map keys.
+ */
+
+static inline uint32_t
+nwGtpv2cMapHash64(uint64_t key)
+{
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NW_GTPV2C_MAP_H__ */
+
+/*--------------------------------------------------------------------------*
+ *                      E N D     O F    F I L E                            *
+ *--------------------------------------------------------------------------*/
@@ -35,6 +35,7 @@
 #define __NW_GTPV2C_PRIVATE_H__
 
 #include <sys/time.h>
+#include <stdbool.h>
 
 #include "assertions.h"
 #include "tree.h"
@@ -47,6 +48,7 @@
 #include "NwGtpv2cMsg.h"
 #include "NwGtpv2cMsgIeParseInfo.h"
 #include "NwGtpv2cTunnel.h"
+#include "NwGtpv2cMap.h"
 
 /**
  * @file NwGtpv2cPrivate.h
@@ -84,6 +86,41 @@ extern "C" {
     }                                                                   \
   } while (0)
 
+#define NW_GTPV2C_MSG_BUF_CLASSES                                       (4)
+
+/**
+ * Initial number of buckets of the tunnel and transaction maps, they grow with the load
+ */
+#define NW_GTPV2C_TUNNEL_MAP_INITIAL_SIZE                               (1024)
+#define NW_GTPV2C_TRXN_MAP_INITIAL_SIZE                                 (256)
+
+/**
+ * Timer wheel: tick period and number of slots (power of 2), a turn is 51.2s.
+ * Longer timers stay in their slot for several turns.
+ */
+#define NW_GTPV2C_TMR_WHEEL_TICK_MS                                     (100)
+#define NW_GTPV2C_TMR_WHEEL_SLOTS                                       (512)
+
+/*--------------------------------------------------------------------------*
+ * Timeout Info Type Definition
+ *--------------------------------------------------------------------------*/
+
+/**
+ * gtpv2c timeout info
+ */
+
+typedef struct nw_gtpv2c_timeout_info_s {
+  nw_gtpv2c_stack_handle_t          hStack;
+  uint64_t                          expiryTick;                        /**< Wheel tick the timer expires on    */
+  uint32_t                          tmrType;
+  void*                             timeoutArg;
+  nw_rc_t                         (*timeoutCallbackFunc)(void*);
+  nw_gtpv2c_timer_handle_t          hTimer;
+  struct nw_gtpv2c_timeout_info_s **ppSlot;                            /**< Head of the wheel slot, NULL if not armed */
+  struct nw_gtpv2c_timeout_info_s  *prev;
+  struct nw_gtpv2c_timeout_info_s  *next;
+} nw_gtpv2c_timeout_info_t;
+
 /*--------------------------------------------------------------------------*
  *  G T P V 2 C   S T A C K   O B J E C T   T Y P E    D E F I N I T I O N  *
  *--------------------------------------------------------------------------*/
@@ -105,42 +142,41 @@ typedef struct nw_gtpv2c_stack_s {
   uint32_t                        restartCounter;
 
   nw_gtpv2c_msg_ie_parse_info_t       *pGtpv2cMsgIeParseInfo[NW_GTP_MSG_END];
-  struct nw_gtpv2c_timeout_info_s    *activeTimerInfo;
 
-  RB_HEAD( NwGtpv2cTunnelMap, nw_gtpv2c_tunnel_s                ) tunnelMap;
-  RB_HEAD( NwGtpv2cOutstandingTxSeqNumTrxnMap, nw_gtpv2c_trxn_s ) outstandingTxSeqNumMap;
-  RB_HEAD( NwGtpv2cOutstandingRxSeqNumTrxnMap, nw_gtpv2c_trxn_s ) outstandingRxSeqNumMap;
-  RB_HEAD( NwGtpv2cActiveTimerList, nw_gtpv2c_timeout_info_s     ) activeTimerList;
-  NwPtrT                        hTmrMinHeap;
+  nw_gtpv2c_map_t               tunnelMap;                              /**< Tunnels by (teid, peer)            */
+  nw_gtpv2c_map_t               outstandingTxSeqNumMap;                 /**< TX transactions by (seq, peer)     */
+  nw_gtpv2c_map_t               outstandingRxSeqNumMap;                 /**< RX transactions by (seq, peer, port) */
+
+  nw_gtpv2c_timeout_info_t     *tmrWheel[NW_GTPV2C_TMR_WHEEL_SLOTS];   /**< Armed timers by expiry tick        */
+  nw_gtpv2c_timeout_info_t      tmrWheelTickInfo;                       /**< Periodic tick of the ULP timer manager */
+  uint64_t                      tmrWheelTick;                           /**< Last tick processed                */
+  uint32_t                      tmrWheelCount;                          /**< Number of armed timers             */
+  bool                          tmrWheelRunning;
+
+  /*
+   * Free-lists are owned by the stack instance, not shared: several instances
+   * can run in parallel, one per thread, without any locking.
+   */
+  struct nw_gtpv2c_msg_s            *msgPool;
+  uint8_t                           *msgBufPool[NW_GTPV2C_MSG_BUF_CLASSES]; /**< Free encoding buffers by size class */
+  struct nw_gtpv2c_trxn_s           *trxnPool;
+  struct nw_gtpv2c_timeout_info_s   *timeoutInfoPool;
+  struct nw_gtpv2c_tunnel_s         *tunnelPool;
 } nw_gtpv2c_stack_t;
 
 
-/*--------------------------------------------------------------------------*
- * Timeout Info Type Definition
- *--------------------------------------------------------------------------*/
-
-/**
- * gtpv2c timeout info
- */
-
-typedef struct nw_gtpv2c_timeout_info_s {
-  nw_gtpv2c_stack_handle_t          hStack;
-  struct timeval                    tvTimeout;
-  uint32_t                          tmrType;
-  void*                             timeoutArg;
-  nw_rc_t                         (*timeoutCallbackFunc)(void*);
-  nw_gtpv2c_timer_handle_t          hTimer;
-  RB_ENTRY (nw_gtpv2c_timeout_info_s)       activeTimerListRbtNode;            /**< RB Tree Data Structure Node        */
-  uint32_t                          timerMinHeapIndex;
-  struct nw_gtpv2c_timeout_info_s  *next;
-} nw_gtpv2c_timeout_info_t;
-
-
 /*---------------------------------------------------------------------------
  * GTPv2c Message Container Definition
  *--------------------------------------------------------------------------*/
 
-#define NW_GTPV2C_MAX_MSG_LEN                                    (1024)  /**< Maximum supported gtpv2c packet length including header */
+/**
+ * Encoding buffers come in size classes, a message starts in the smallest one
+ * and moves to the next one when an IE does not fit. Received messages are
+ * parsed in place, in the buffer given to nwGtpv2cProcessUdpReq().
+ */
+#define NW_GTPV2C_MSG_BUF_CLASS_SIZE(_class)                            (256 << (2 * (_class)))  /**< 256, 1024, 4096, 16384 bytes */
+#define NW_GTPV2C_MSG_BUF_BORROWED                                      (NW_GTPV2C_MSG_BUF_CLASSES) /**< Buffer not owned by the message */
+#define NW_GTPV2C_MAX_MSG_LEN                                           (NW_GTPV2C_MSG_BUF_CLASS_SIZE(NW_GTPV2C_MSG_BUF_CLASSES - 1))  /**< Maximum supported gtpv2c packet length including header */
 
 /**
  * NwGtpv2cMsgT holds gtpv2c messages to/from the peer.
@@ -162,7 +198,9 @@ typedef struct nw_gtpv2c_msg_s {
 
   bool                          isIeValid[NW_GTPV2C_IE_TYPE_MAXIMUM][NW_GTPV2C_IE_INSTANCE_MAXIMUM];
   uint8_t                      *pIe[NW_GTPV2C_IE_TYPE_MAXIMUM][NW_GTPV2C_IE_INSTANCE_MAXIMUM];
-  uint8_t                       msgBuf[NW_GTPV2C_MAX_MSG_LEN];
+  uint8_t                      *msgBuf;                                 /**< Encoding buffer or received buffer */
+  uint32_t                      msgBufSize;
+  uint8_t                       msgBufClass;                            /**< Size class or NW_GTPV2C_MSG_BUF_BORROWED */
   nw_gtpv2c_stack_handle_t      hStack;
   struct nw_gtpv2c_msg_s*       next;
 } nw_gtpv2c_msg_t;
@@ -182,8 +220,8 @@ typedef struct nw_gtpv2c_trxn_s {
   nw_gtpv2c_timer_handle_t      hRspTmr;                                /**< Handle to reponse timer            */
   nw_gtpv2c_tunnel_handle_t     hTunnel;                                /**< Handle to local tunnel context     */
   nw_gtpv2c_ulp_trxn_handle_t   hUlpTrxn;                               /**< Handle to ULP tunnel context       */
-  RB_ENTRY (nw_gtpv2c_trxn_s)   outstandingTxSeqNumMapRbtNode;          /**< RB Tree Data Structure Node        */
-  RB_ENTRY (nw_gtpv2c_trxn_s)   outstandingRxSeqNumMapRbtNode;          /**< RB Tree Data Structure Node        */
+  struct nw_gtpv2c_trxn_s*      outstandingTxSeqNumMapNext;             /**< TX transaction map bucket link     */
+  struct nw_gtpv2c_trxn_s*      outstandingRxSeqNumMapNext;             /**< RX transaction map bucket link     */
   struct nw_gtpv2c_trxn_s*      next;
 } nw_gtpv2c_trxn_t;
 
@@ -202,13 +240,8 @@ typedef struct NwGtpv2cPathS {
 } NwGtpv2cPathT;
 
 
-RB_PROTOTYPE(NwGtpv2cTunnelMap, nw_gtpv2c_tunnel_s, tunnelMapRbtNode, nwGtpv2cCompareTunnel)
-RB_PROTOTYPE(NwGtpv2cOutstandingTxSeqNumTrxnMap, nw_gtpv2c_trxn_s, outstandingTxSeqNumMapRbtNode, nwGtpv2cCompareSeqNum)
-RB_PROTOTYPE(NwGtpv2cOutstandingRxSeqNumTrxnMap, nw_gtpv2c_trxn_s, outstandingRxSeqNumMapRbtNode, nwGtpv2cCompareSeqNum)
-RB_PROTOTYPE(NwGtpv2cActiveTimerList, nw_gtpv2c_timeout_info_s, activeTimerListRbtNode, nwGtpv2cCompareOutstandingTxRexmitTime)
-
 /**
- * Start Timer with ULP Timer Manager
+ * Start Timer on the stack timer wheel
  */
 
 nw_rc_t
@@ -222,7 +255,7 @@ nwGtpv2cStartTimer(nw_gtpv2c_stack_t* thiz,
 
 
 /**
- * Stop Timer with ULP Timer Manager
+ * Stop Timer on the stack timer wheel
  */
 
 nw_rc_t
@@ -54,7 +54,7 @@ typedef struct nw_gtpv2c_tunnel_s {
   uint32_t                      teid;
   struct in_addr                ipv4AddrRemote;
   nw_gtpv2c_ulp_tunnel_handle_t      hUlpTunnel;
-  RB_ENTRY (nw_gtpv2c_tunnel_s)     tunnelMapRbtNode;            /**< RB Tree Data Structure Node        */
+  struct nw_gtpv2c_tunnel_s*        tunnelMapNext;               /**< Tunnel map bucket link             */
   struct nw_gtpv2c_tunnel_s*        next;
 } nw_gtpv2c_tunnel_t;
 
@@ -279,6 +279,8 @@ typedef struct nw_gtpv2c_triggered_rsp_ind_info_s {
 typedef struct nw_gtpv2c_rsp_failure_ind_info_s {
   NW_IN    nw_gtpv2c_ulp_trxn_handle_t       hUlpTrxn;
   NW_IN    nw_gtpv2c_ulp_tunnel_handle_t     hUlpTunnel;
+  NW_IN    nw_gtpv2c_msg_type_t              msgType;        /**< Type of the request that got no response           */
+  NW_IN    struct in_addr                    peerIp;         /**< Peer the request was sent to                       */
 } nw_gtpv2c_rsp_failure_ind_info_t;
 
 /**
@@ -563,6 +565,33 @@ nwGtpv2cProcessUlpReq( NW_IN nw_gtpv2c_stack_handle_t hGtpcStackHandle,
 nw_rc_t
 nwGtpv2cProcessTimeout( NW_IN void* timeoutArg);
 
+/**
+ Get the stack instance a transaction belongs to, when several stack
+ instances run in parallel.
+
+ @param[in] hTrxn : Transaction handle.
+ @return Stack instance handle, 0 if hTrxn is 0.
+ */
+
+nw_gtpv2c_stack_handle_t
+nwGtpv2cTrxnGetStackHandle( NW_IN nw_gtpv2c_trxn_handle_t hTrxn);
+
+/**
+ Fail all outstanding requests sent to a peer, once the ULP detected path
+ failure towards it. A NW_GTPV2C_ULP_API_RSP_FAILURE_IND is given to the ULP
+ for each of them, without waiting for their own N3 retransmissions.
+
+ @param[in] hGtpcStackHandle : Stack handle
+ @param[in] peerIp : Peer address.
+ @param[out] pCount : Optional, number of failed requests.
+ @return NW_OK on success.
+ */
+
+nw_rc_t
+nwGtpv2cProcessPeerFailure( NW_IN nw_gtpv2c_stack_handle_t hGtpcStackHandle,
+                            NW_IN const struct in_addr * const peerIp,
+                            NW_OUT uint32_t * const pCount);
+
 
 #ifdef __cplusplus
 }
@@ -60,6 +60,48 @@ typedef struct nw_gtpv2c_msg_parser_s {
   uint8_t *pIe[NW_GTPV2C_IE_TYPE_MAXIMUM][NW_GTPV2C_IE_INSTANCE_MAXIMUM];
 } nw_gtpv2c_msg_parser_t;
 
+/**
+ * IE expected in a message parsed with a parser template. The callback
+ * argument is not stored in the template but computed for each message from
+ * the parse context given to nwGtpv2cMsgParserTemplateRun(), so that one
+ * template built at init serves all messages of its type.
+ */
+#define NW_GTPV2C_MSG_PARSER_IE_ARG_NONE                                ((size_t)-1)
+#define NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM                        (32)
+
+typedef struct nw_gtpv2c_msg_parser_ie_s {
+  uint8_t ieType;
+  uint8_t ieInstance;
+  uint8_t iePresence;
+  nw_rc_t (*ieReadCallback) (uint8_t ieType, uint8_t ieLength, uint8_t ieInstance,  uint8_t* ieValue, void* ieReadCallbackArg);
+  size_t  ieReadCallbackArgOffset;    /**< Offset of the callback argument in the parse context, or NW_GTPV2C_MSG_PARSER_IE_ARG_NONE */
+} nw_gtpv2c_msg_parser_ie_t;
+
+typedef struct nw_gtpv2c_msg_parser_template_s {
+  uint16_t msgType;
+  uint8_t  ieCount;
+  uint32_t mandatoryIeMask;           /**< Bit i set if ie[i] is mandatory */
+  nw_rc_t (*ieReadCallback) (uint8_t ieType, uint8_t ieLength, uint8_t ieInstance,  uint8_t* ieValue, void* ieReadCallbackArg);
+  uint8_t  ieIndex[NW_GTPV2C_IE_TYPE_MAXIMUM][NW_GTPV2C_IE_INSTANCE_MAXIMUM]; /**< 1 + index in ie[], 0 if not expected */
+  nw_gtpv2c_msg_parser_ie_t ie[NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM];
+} nw_gtpv2c_msg_parser_template_t;
+
+/**
+ * State of a walk of a message with a parser template. The walk yields the
+ * expected IEs one by one with their index in the template, so that a
+ * decoder can dispatch on the index instead of an IE callback.
+ */
+typedef struct nw_gtpv2c_msg_parser_walk_s {
+  uint8_t  *pIeStart;
+  uint8_t  *pIeEnd;
+  uint32_t  receivedIeMask;
+  uint8_t   ieType;
+  uint8_t   ieInstance;
+  uint16_t  ieLength;
+  uint8_t   ieIndex;                  /**< Index of the current IE in ie[] of the template */
+  uint8_t  *pIeValue;                 /**< Value of the current IE, NULL once the walk is over */
+} nw_gtpv2c_msg_parser_walk_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -140,6 +182,75 @@ nwGtpv2cMsgParserRun( NW_IN nw_gtpv2c_msg_parser_t *thiz,
                       NW_OUT uint8_t             *pOffendingIeInstance,
                       NW_OUT uint16_t            *pOffendingIeLength);
 
+/**
+ * Build a gtpv2c message parser template, no memory is allocated.
+ *
+ * @param[out] thiz : Parser template to build.
+ * @param[in] msgType : Message type for this message parser.
+ * @param[in] ieReadCallback : Callback for IEs declared without callback.
+ * @param[in] pIe : IEs expected in the message.
+ * @param[in] ieCount : Number of IEs, up to NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM.
+ */
+
+nw_rc_t
+nwGtpv2cMsgParserTemplateInit( NW_OUT nw_gtpv2c_msg_parser_template_t *thiz,
+                               NW_IN uint8_t     msgType,
+                               NW_IN nw_rc_t (*ieReadCallback) (uint8_t ieType,
+                                   uint8_t ieLength,
+                                   uint8_t ieInstance,
+                                   uint8_t* ieValue,
+                                   void* ieReadCallbackArg),
+                               NW_IN const nw_gtpv2c_msg_parser_ie_t *pIe,
+                               NW_IN uint8_t     ieCount);
+
+/**
+ * Parse a message with a parser template, equivalent to nwGtpv2cMsgParserRun()
+ * without per message allocation.
+ *
+ * @param[in] thiz : Parser template.
+ * @param[in] hMsg : Message to parse.
+ * @param[in] pCtx : Parse context, base of the IE callback argument offsets.
+ */
+
+nw_rc_t
+nwGtpv2cMsgParserTemplateRun( NW_IN const nw_gtpv2c_msg_parser_template_t *thiz,
+                              NW_IN nw_gtpv2c_msg_handle_t  hMsg,
+                              NW_IN void                *pCtx,
+                              NW_OUT uint8_t             *pOffendingIeType,
+                              NW_OUT uint8_t             *pOffendingIeInstance,
+                              NW_OUT uint16_t            *pOffendingIeLength);
+
+/**
+ * Start a walk of a message with a parser template.
+ *
+ * @param[in] thiz : Parser template.
+ * @param[in] hMsg : Message to walk.
+ * @param[out] pWalk : Walk state.
+ */
+
+void
+nwGtpv2cMsgParserWalkStart( NW_IN const nw_gtpv2c_msg_parser_template_t *thiz,
+                            NW_IN nw_gtpv2c_msg_handle_t  hMsg,
+                            NW_OUT nw_gtpv2c_msg_parser_walk_t *pWalk);
+
+/**
+ * Move a walk to the next IE expected by the parser template, unexpected IEs
+ * are skipped. Once the last IE is passed pWalk->pIeValue is NULL and the
+ * mandatory IEs are checked.
+ *
+ * @param[in] thiz : Parser template.
+ * @param[in,out] pWalk : Walk state.
+ * @return NW_OK, NW_GTPV2C_MSG_MALFORMED or NW_GTPV2C_MANDATORY_IE_MISSING
+ * with the offending IE.
+ */
+
+nw_rc_t
+nwGtpv2cMsgParserWalkNext( NW_IN const nw_gtpv2c_msg_parser_template_t *thiz,
+                           NW_INOUT nw_gtpv2c_msg_parser_walk_t *pWalk,
+                           NW_OUT uint8_t             *pOffendingIeType,
+                           NW_OUT uint8_t             *pOffendingIeInstance,
+                           NW_OUT uint16_t            *pOffendingIeLength);
+
 #ifdef __cplusplus
 }
 #endif
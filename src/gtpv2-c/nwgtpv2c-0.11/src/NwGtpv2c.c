@@ -34,8 +34,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "bstrlib.h"
 
@@ -51,40 +53,6 @@
 #include "gcc_diag.h"
 #include "log.h"
 
-#ifdef _NWGTPV2C_HAVE_TIMERADD
-#  define NW_GTPV2C_TIMER_ADD(tvp, uvp, vvp) timeradd((tvp), (uvp), (vvp))
-#  define NW_GTPV2C_TIMER_SUB(tvp, uvp, vvp) timersub((tvp), (uvp), (vvp))
-#  define NW_GTPV2C_TIMER_CMP_P(a, b, CMP)   timercmp(a, b, CMP)
-#else
-
-#  define NW_GTPV2C_TIMER_ADD(tvp, uvp, vvp)                               \
-  do {                                                                  \
-    (vvp)->tv_sec = (tvp)->tv_sec + (uvp)->tv_sec;                      \
-    (vvp)->tv_usec = (tvp)->tv_usec + (uvp)->tv_usec;                   \
-    if ((vvp)->tv_usec >= 1000000) {                                    \
-      (vvp)->tv_sec++;                                                  \
-      (vvp)->tv_usec -= 1000000;                                        \
-    }                                                                   \
-  } while (0)
-
-#  define NW_GTPV2C_TIMER_SUB(tvp, uvp, vvp)                               \
-  do {                                                                  \
-    (vvp)->tv_sec = (tvp)->tv_sec - (uvp)->tv_sec;                      \
-    (vvp)->tv_usec = (tvp)->tv_usec - (uvp)->tv_usec;                   \
-    if ((vvp)->tv_usec < 0) {                                           \
-      (vvp)->tv_sec--;                                                  \
-      (vvp)->tv_usec += 1000000;                                        \
-    }                                                                   \
-  } while (0)
-
-#  define NW_GTPV2C_TIMER_CMP_P(a, b, CMP)                                \
-  (((a)->tv_sec == (b)->tv_sec) ?                                       \
-   ((a)->tv_usec CMP (b)->tv_usec) :                                    \
-   ((a)->tv_sec CMP (b)->tv_sec))
-
-#endif
-
-
 #define NW_GTPV2C_INIT_MSG_IE_PARSE_INFO(__thiz, __msgType)             \
   do {                                                                \
     __thiz->pGtpv2cMsgIeParseInfo[__msgType] =                        \
@@ -97,119 +65,102 @@
 extern                                  "C" {
 #endif
 
-  static nw_gtpv2c_timeout_info_t            *gpGtpv2cTimeoutInfoPool = NULL;
-
-  typedef struct {
-    int                                     currSize;
-    int                                     maxSize;
-    nw_gtpv2c_timeout_info_t                  **pHeap;
-  } NwGtpv2cTmrMinHeapT;
+/*---------------------------------------------------------------------------
+   Timer wheel.
 
-#define NW_HEAP_PARENT_INDEX(__child)           ( ( (__child) - 1 ) / 2 )
+   All timers of a stack instance hang off a wheel of
+   NW_GTPV2C_TMR_WHEEL_SLOTS slots of NW_GTPV2C_TMR_WHEEL_TICK_MS each,
+   driven by a single periodic timer of the ULP timer manager. Starting or
+   stopping a transaction timer never reaches the ULP timer manager.
+  --------------------------------------------------------------------------*/
 
+  static uint64_t                           nwGtpv2cTmrWheelNowMs (
+  void) {
+    struct timespec                         ts = {0};
 
-  NwGtpv2cTmrMinHeapT                    *nwGtpv2cTmrMinHeapNew (
-  int maxSize) {
-    NwGtpv2cTmrMinHeapT                    *thiz = (NwGtpv2cTmrMinHeapT *) malloc (sizeof (NwGtpv2cTmrMinHeapT));
+    NW_ASSERT (clock_gettime (CLOCK_MONOTONIC, &ts) == 0);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  }
 
-    if (thiz) {
-      thiz->currSize = 0;
-      thiz->maxSize = maxSize;
-      thiz->pHeap = (nw_gtpv2c_timeout_info_t **) malloc (maxSize * sizeof (nw_gtpv2c_timeout_info_t *));
-    }
+  static void                               nwGtpv2cTmrWheelLink (
+  nw_gtpv2c_timeout_info_t ** ppSlot,
+  nw_gtpv2c_timeout_info_t * timeoutInfo) {
+    timeoutInfo->ppSlot = ppSlot;
+    timeoutInfo->prev = NULL;
+    timeoutInfo->next = *ppSlot;
 
-    return                                  thiz;
-  }
+    if (*ppSlot)
+      (*ppSlot)->prev = timeoutInfo;
 
-  void
-                                          nwGtpv2cTmrMinHeapDelete (
-  NwGtpv2cTmrMinHeapT * thiz) {
-    free_wrapper ((void**)&thiz->pHeap);
-    free_wrapper ((void**)&thiz);
+    *ppSlot = timeoutInfo;
   }
 
-  static nw_rc_t                            nwGtpv2cTmrMinHeapInsert (
-  NwGtpv2cTmrMinHeapT * thiz,
-  nw_gtpv2c_timeout_info_t * pTimerEvent) {
-    int                                     holeIndex = thiz->currSize++;
-
-    NW_ASSERT (thiz->currSize < thiz->maxSize);
+  static void                               nwGtpv2cTmrWheelUnlink (
+  nw_gtpv2c_timeout_info_t * timeoutInfo) {
+    if (timeoutInfo->prev)
+      timeoutInfo->prev->next = timeoutInfo->next;
+    else
+      *(timeoutInfo->ppSlot) = timeoutInfo->next;
 
-    while ((holeIndex > 0) && NW_GTPV2C_TIMER_CMP_P (&(thiz->pHeap[NW_HEAP_PARENT_INDEX (holeIndex)])->tvTimeout, &(pTimerEvent->tvTimeout), >)) {
-      thiz->pHeap[holeIndex] = thiz->pHeap[NW_HEAP_PARENT_INDEX (holeIndex)];
-      thiz->pHeap[holeIndex]->timerMinHeapIndex = holeIndex;
-      holeIndex = NW_HEAP_PARENT_INDEX (holeIndex);
-    }
+    if (timeoutInfo->next)
+      timeoutInfo->next->prev = timeoutInfo->prev;
 
-    thiz->pHeap[holeIndex] = pTimerEvent;
-    pTimerEvent->timerMinHeapIndex = holeIndex;
-    return holeIndex;
+    timeoutInfo->ppSlot = NULL;
+    timeoutInfo->prev = NULL;
+    timeoutInfo->next = NULL;
   }
 
-#define NW_MIN_HEAP_INDEX_INVALID                       (0xFFFFFFFF)
-  static nw_rc_t                            nwGtpv2cTmrMinHeapRemove (
-  NwGtpv2cTmrMinHeapT * thiz,
-  int minHeapIndex) {
-    nw_gtpv2c_timeout_info_t                   *pTimerEvent = NULL;
-    int                                     holeIndex = minHeapIndex;
-    int                                     minChild = 0,
-                                            maxChild = 0;
-
-    //printf("- Trying Removing %p from index %u, currSize %u, minChild %u, maxChild %u\n", thiz->pHeap[minHeapIndex], minHeapIndex, thiz->currSize, minChild, maxChild);
-    if (minHeapIndex == NW_MIN_HEAP_INDEX_INVALID)
-      return NW_FAILURE;
-
-    if (minHeapIndex < thiz->currSize) {
-      thiz->pHeap[minHeapIndex]->timerMinHeapIndex = NW_MIN_HEAP_INDEX_INVALID;
-      thiz->currSize--;
-      pTimerEvent = thiz->pHeap[thiz->currSize];
-      holeIndex = minHeapIndex;
-      minChild = (2 * holeIndex) + 1;
-      maxChild = minChild + 1;
-
-      //printf("- Removing %p from index %u, currSize %u, minChild %u, maxChild %u\n", thiz->pHeap[minHeapIndex], minHeapIndex, thiz->currSize, minChild, maxChild);
+/**
+   Fire all timers expired since the last tick.
 
-      while ((maxChild) <= thiz->currSize) {
-        if (NW_GTPV2C_TIMER_CMP_P (&(thiz->pHeap[minChild]->tvTimeout), &(thiz->pHeap[maxChild]->tvTimeout), >))
-          minChild = maxChild;
+   @param[in] thiz : Pointer to stack.
+*/
+  static void                               nwGtpv2cTmrWheelAdvance (
+  nw_gtpv2c_stack_t * thiz) {
+    const uint64_t                          nowTick = nwGtpv2cTmrWheelNowMs () / NW_GTPV2C_TMR_WHEEL_TICK_MS;
+    uint64_t                                nbTicks = nowTick - thiz->tmrWheelTick;
+    uint64_t                                tick = thiz->tmrWheelTick;
 
-        if (NW_GTPV2C_TIMER_CMP_P (&(pTimerEvent->tvTimeout), &(thiz->pHeap[minChild]->tvTimeout), <)) {
-          break;
-        }
+    /*
+     * Ticks may be late or coalesced by the ULP timer manager, one turn
+     * visits every slot.
+     */
+    if (nbTicks > NW_GTPV2C_TMR_WHEEL_SLOTS)
+      nbTicks = NW_GTPV2C_TMR_WHEEL_SLOTS;
 
-        thiz->pHeap[holeIndex] = thiz->pHeap[minChild];
-        thiz->pHeap[holeIndex]->timerMinHeapIndex = holeIndex;
-        holeIndex = minChild;
-        minChild = (2 * holeIndex) + 1;
-        maxChild = minChild + 1;
-      }
+    while (nbTicks--) {
+      nw_gtpv2c_timeout_info_t                *expiring = NULL;
+      nw_gtpv2c_timeout_info_t                *timeoutInfo = NULL;
 
-      while ((holeIndex > 0) && NW_GTPV2C_TIMER_CMP_P (&((thiz->pHeap[NW_HEAP_PARENT_INDEX (holeIndex)])->tvTimeout), &(pTimerEvent->tvTimeout), >)) {
-        thiz->pHeap[holeIndex] = thiz->pHeap[NW_HEAP_PARENT_INDEX (holeIndex)];
-        thiz->pHeap[holeIndex]->timerMinHeapIndex = holeIndex;
-        holeIndex = NW_HEAP_PARENT_INDEX (holeIndex);
-      }
+      tick++;
+      /*
+       * Move the slot aside: callbacks may start or stop any timer, including
+       * the ones still to be processed in this slot.
+       */
+      expiring = thiz->tmrWheel[tick & (NW_GTPV2C_TMR_WHEEL_SLOTS - 1)];
+      thiz->tmrWheel[tick & (NW_GTPV2C_TMR_WHEEL_SLOTS - 1)] = NULL;
 
-      if (holeIndex < thiz->currSize) {
-        thiz->pHeap[holeIndex] = pTimerEvent;
-        pTimerEvent->timerMinHeapIndex = holeIndex;
-      }
+      for (timeoutInfo = expiring; timeoutInfo; timeoutInfo = timeoutInfo->next)
+        timeoutInfo->ppSlot = &expiring;
 
-      thiz->pHeap[thiz->currSize] = NULL;
-      return NW_OK;
-    }
+      while (expiring) {
+        timeoutInfo = expiring;
+        nwGtpv2cTmrWheelUnlink (timeoutInfo);
 
-    return NW_FAILURE;
-  }
+        if (timeoutInfo->expiryTick > nowTick) {
+          // Expires on a later turn of the wheel
+          nwGtpv2cTmrWheelLink (&thiz->tmrWheel[timeoutInfo->expiryTick & (NW_GTPV2C_TMR_WHEEL_SLOTS - 1)], timeoutInfo);
+          continue;
+        }
 
-  static nw_gtpv2c_timeout_info_t            *nwGtpv2cTmrMinHeapPeek (
-  NwGtpv2cTmrMinHeapT * thiz) {
-    if (thiz->currSize) {
-      //printf("- Peek Returning %p at index %u(%u)\n", thiz->pHeap[0], thiz->pHeap[0]->timerMinHeapIndex, thiz->currSize);
-      return thiz->pHeap[0];
+        thiz->tmrWheelCount--;
+        timeoutInfo->next = thiz->timeoutInfoPool;
+        thiz->timeoutInfoPool = timeoutInfo;
+        ((timeoutInfo)->timeoutCallbackFunc) (timeoutInfo->timeoutArg);
+      }
     }
 
-    return NULL;
+    thiz->tmrWheelTick = nowTick;
   }
 /*--------------------------------------------------------------------------*
                       P R I V A T E    F U N C T I O N S
@@ -255,127 +206,141 @@ extern                                  "C" {
   }
 
 /*---------------------------------------------------------------------------
-   Tunnel RBTree Search Data Structure
+   Tunnel Hash Map Search Data Structure
   --------------------------------------------------------------------------*/
 
 /**
-  Comparator funtion for comparing two sequence number transactions.
+  Hash and equality functions of the tunnel map, keyed by (teid, peer IP).
 
-  @param[in] a: Pointer to session a.
-  @param[in] b: Pointer to session b.
-  @return  An integer greater than, equal to or less than zero according to whether the
-  object pointed to by a is greater than, equal to or less than the object pointed to by b.
+  @param[in] a: Pointer to tunnel a.
+  @param[in] b: Pointer to tunnel b.
+  @return  Non zero if both tunnels have the same key.
 */
 
-  static inline int32_t                    nwGtpv2cCompareTunnel (
-  struct nw_gtpv2c_tunnel_s *a,
-  struct nw_gtpv2c_tunnel_s *b) {
-    if (a->teid > b->teid)
-      return 1;
-
-    if (a->teid < b->teid)
-      return -1;
+  static uint32_t                           nwGtpv2cHashTunnel (
+  const void *elm) {
+    const struct nw_gtpv2c_tunnel_s        *a = (const struct nw_gtpv2c_tunnel_s *)elm;
 
-    if (a->ipv4AddrRemote.s_addr > b->ipv4AddrRemote.s_addr)
-      return 1;
+    return nwGtpv2cMapHash64 (((uint64_t) a->teid << 32) | a->ipv4AddrRemote.s_addr);
+  }
 
-    if (a->ipv4AddrRemote.s_addr < b->ipv4AddrRemote.s_addr)
-      return -1;
+  static int                                nwGtpv2cEqualTunnel (
+  const void *elmA,
+  const void *elmB) {
+    const struct nw_gtpv2c_tunnel_s        *a = (const struct nw_gtpv2c_tunnel_s *)elmA;
+    const struct nw_gtpv2c_tunnel_s        *b = (const struct nw_gtpv2c_tunnel_s *)elmB;
 
-    return 0;
+    return (a->teid == b->teid) && (a->ipv4AddrRemote.s_addr == b->ipv4AddrRemote.s_addr);
   }
 
-  RB_GENERATE (NwGtpv2cTunnelMap, nw_gtpv2c_tunnel_s, tunnelMapRbtNode, nwGtpv2cCompareTunnel)
-
 /*---------------------------------------------------------------------------
-   Transaction RBTree Search Data Structure
+   Transaction Hash Map Search Data Structure
   --------------------------------------------------------------------------*/
+
 /**
-  Comparator funtion for comparing two outstancing TX transactions.
+  Hash and equality functions of the outstanding TX transaction map, keyed by
+  (sequence number, peer IP).
 
-  @param[in] a: Pointer to session a.
-  @param[in] b: Pointer to session b.
-  @return  An integer greater than, equal to or less than zero according to whether the
-  object pointed to by a is greater than, equal to or less than the object pointed to by b.
+  @param[in] a: Pointer to transaction a.
+  @param[in] b: Pointer to transaction b.
+  @return  Non zero if both transactions have the same key.
 */
-  static inline int32_t                    nwGtpv2cCompareOutstandingTxSeqNumTrxn (
-  struct nw_gtpv2c_trxn_s *a,
-  struct nw_gtpv2c_trxn_s *b) {
-    if (a->seqNum > b->seqNum)
-      return 1;
 
-    if (a->seqNum < b->seqNum)
-      return -1;
+  static uint32_t                           nwGtpv2cHashOutstandingTxSeqNumTrxn (
+  const void *elm) {
+    const struct nw_gtpv2c_trxn_s          *a = (const struct nw_gtpv2c_trxn_s *)elm;
 
-    if (a->peerIp.s_addr > b->peerIp.s_addr)
-      return 1;
+    return nwGtpv2cMapHash64 (((uint64_t) a->seqNum << 32) | a->peerIp.s_addr);
+  }
 
-    if (a->peerIp.s_addr < b->peerIp.s_addr)
-      return -1;
+  static int                                nwGtpv2cEqualOutstandingTxSeqNumTrxn (
+  const void *elmA,
+  const void *elmB) {
+    const struct nw_gtpv2c_trxn_s          *a = (const struct nw_gtpv2c_trxn_s *)elmA;
+    const struct nw_gtpv2c_trxn_s          *b = (const struct nw_gtpv2c_trxn_s *)elmB;
 
-    return 0;
+    return (a->seqNum == b->seqNum) && (a->peerIp.s_addr == b->peerIp.s_addr);
   }
 
-  RB_GENERATE (NwGtpv2cOutstandingTxSeqNumTrxnMap, nw_gtpv2c_trxn_s, outstandingTxSeqNumMapRbtNode, nwGtpv2cCompareOutstandingTxSeqNumTrxn)
-
 /**
-  Comparator funtion for comparing outstanding RX transactions.
+  Hash and equality functions of the outstanding RX transaction map, keyed by
+  (sequence number, peer IP, peer port).
 
-  @param[in] a: Pointer to session a.
-  @param[in] b: Pointer to session b.
-  @return  An integer greater than, equal to or less than zero according to whether the
-  object pointed to by a is greater than, equal to or less than the object pointed to by b.
+  @param[in] a: Pointer to transaction a.
+  @param[in] b: Pointer to transaction b.
+  @return  Non zero if both transactions have the same key.
 */
-  static inline int32_t                    nwGtpv2cCompareOutstandingRxSeqNumTrxn (
-  struct nw_gtpv2c_trxn_s *a,
-  struct nw_gtpv2c_trxn_s *b) {
-    if (a->seqNum > b->seqNum)
-      return 1;
-
-    if (a->seqNum < b->seqNum)
-      return -1;
 
-    if (a->peerIp.s_addr > b->peerIp.s_addr)
-      return 1;
+  static uint32_t                           nwGtpv2cHashOutstandingRxSeqNumTrxn (
+  const void *elm) {
+    const struct nw_gtpv2c_trxn_s          *a = (const struct nw_gtpv2c_trxn_s *)elm;
 
-    if (a->peerIp.s_addr < b->peerIp.s_addr)
-      return -1;
-
-    if (a->peerPort > b->peerPort)
-      return 1;
+    return nwGtpv2cMapHash64 ((((uint64_t) a->seqNum << 32) | a->peerIp.s_addr) ^ ((uint64_t) a->peerPort << 56));
+  }
 
-    if (a->peerPort < b->peerPort)
-      return -1;
+  static int                                nwGtpv2cEqualOutstandingRxSeqNumTrxn (
+  const void *elmA,
+  const void *elmB) {
+    const struct nw_gtpv2c_trxn_s          *a = (const struct nw_gtpv2c_trxn_s *)elmA;
+    const struct nw_gtpv2c_trxn_s          *b = (const struct nw_gtpv2c_trxn_s *)elmB;
 
-    return 0;
+    return (a->seqNum == b->seqNum) && (a->peerIp.s_addr == b->peerIp.s_addr) && (a->peerPort == b->peerPort);
   }
 
-  RB_GENERATE (NwGtpv2cOutstandingRxSeqNumTrxnMap, nw_gtpv2c_trxn_s, outstandingRxSeqNumMapRbtNode, nwGtpv2cCompareOutstandingRxSeqNumTrxn)
 
-/*---------------------------------------------------------------------------
-   Timer RB-tree data structure.
-  --------------------------------------------------------------------------*/
 /**
-  Comparator funtion for comparing two outstancing TX transactions.
+   Release the free-lists and the armed timers of a stack instance.
 
-  @param[in] a: Pointer to session a.
-  @param[in] b: Pointer to session b.
-  @return  An integer greater than, equal to or less than zero according to whether the
-  object pointed to by a is greater than, equal to or less than the object pointed to by b.
+   @param[in] thiz : Pointer to stack.
 */
-  static inline int32_t                    nwGtpv2cCompareOutstandingTxRexmitTime (
-  struct nw_gtpv2c_timeout_info_s *a,
-  struct nw_gtpv2c_timeout_info_s *b) {
-    if (NW_GTPV2C_TIMER_CMP_P (&a->tvTimeout, &b->tvTimeout, >))
-      return 1;
+  static void                               nwGtpv2cPurgePools (
+  NW_IN nw_gtpv2c_stack_t * thiz) {
+    while (thiz->msgPool) {
+      nw_gtpv2c_msg_t                         *pMsg = thiz->msgPool;
 
-    if (NW_GTPV2C_TIMER_CMP_P (&a->tvTimeout, &b->tvTimeout, <))
-      return -1;
+      thiz->msgPool = pMsg->next;
+      NW_GTPV2C_FREE (thiz, pMsg);
+    }
 
-    return 0;
-  }
+    while (thiz->trxnPool) {
+      nw_gtpv2c_trxn_t                        *pTrxn = thiz->trxnPool;
+
+      thiz->trxnPool = pTrxn->next;
+      NW_GTPV2C_FREE (thiz, pTrxn);
+    }
+
+    for (int slot = 0; slot < NW_GTPV2C_TMR_WHEEL_SLOTS; slot++) {
+      while (thiz->tmrWheel[slot]) {
+        nw_gtpv2c_timeout_info_t                *timeoutInfo = thiz->tmrWheel[slot];
+
+        nwGtpv2cTmrWheelUnlink (timeoutInfo);
+        NW_GTPV2C_FREE (thiz, timeoutInfo);
+      }
+    }
 
-  RB_GENERATE (NwGtpv2cActiveTimerList, nw_gtpv2c_timeout_info_s, activeTimerListRbtNode, nwGtpv2cCompareOutstandingTxRexmitTime)
+    while (thiz->timeoutInfoPool) {
+      nw_gtpv2c_timeout_info_t                *timeoutInfo = thiz->timeoutInfoPool;
+
+      thiz->timeoutInfoPool = timeoutInfo->next;
+      NW_GTPV2C_FREE (thiz, timeoutInfo);
+    }
+
+    while (thiz->tunnelPool) {
+      nw_gtpv2c_tunnel_t                      *pTunnel = thiz->tunnelPool;
+
+      thiz->tunnelPool = pTunnel->next;
+      NW_GTPV2C_FREE (thiz, pTunnel);
+    }
+
+    for (int bufClass = 0; bufClass < NW_GTPV2C_MSG_BUF_CLASSES; bufClass++) {
+      while (thiz->msgBufPool[bufClass]) {
+        uint8_t                                 *pBuf = thiz->msgBufPool[bufClass];
+
+        thiz->msgBufPool[bufClass] = *((uint8_t **) pBuf);
+        NW_GTPV2C_FREE (thiz, pBuf);
+      }
+    }
+  }
 
 
 
@@ -484,7 +449,7 @@ static nw_rc_t nwGtpv2cCreateLocalTunnel (
     pTunnel = nwGtpv2cTunnelNew (thiz, teid, ipv4Remote, hUlpTunnel);
 
     if (pTunnel) {
-      pCollision = RB_INSERT (NwGtpv2cTunnelMap, &(thiz->tunnelMap), pTunnel);
+      pCollision = nwGtpv2cMapInsert (&(thiz->tunnelMap), pTunnel);
 
       if (pCollision) {
         rc = nwGtpv2cTunnelDelete (thiz, pTunnel);
@@ -517,7 +482,7 @@ static nw_rc_t nwGtpv2cCreateLocalTunnel (
     char                                    ipv4[INET_ADDRSTRLEN];
 
     OAILOG_FUNC_IN (LOG_GTPV2C);
-    pTunnel = RB_REMOVE (NwGtpv2cTunnelMap, &(thiz->tunnelMap), (nw_gtpv2c_tunnel_t *) hTunnel);
+    pTunnel = nwGtpv2cMapRemove (&(thiz->tunnelMap), (nw_gtpv2c_tunnel_t *) hTunnel);
     NW_ASSERT (pTunnel == (nw_gtpv2c_tunnel_t *) hTunnel);
     inet_ntop (AF_INET, (void*)&pTunnel->ipv4AddrRemote, ipv4, INET_ADDRSTRLEN);
     OAILOG_DEBUG (LOG_GTPV2C, "Deleting local tunnel with teid '0x%x' and peer IP %s\n", pTunnel->teid, ipv4);
@@ -551,17 +516,29 @@ static nw_rc_t nwGtpv2cCreateLocalTunnel (
     pTrxn = nwGtpv2cTrxnNew (thiz);
 
     if (pTrxn) {
-      if (!pUlpReq->u_api_info.initialReqInfo.hTunnel) {
-        rc = nwGtpv2cCreateLocalTunnel (thiz, pUlpReq->u_api_info.initialReqInfo.teidLocal, &pUlpReq->u_api_info.initialReqInfo.peerIp,
-            pUlpReq->u_api_info.initialReqInfo.hUlpTunnel,
-            &pUlpReq->u_api_info.initialReqInfo.hTunnel);
+      pTrxn->pMsg = (nw_gtpv2c_msg_t *) pUlpReq->hMsg;
+
+      if (NW_GTP_ECHO_REQ == pTrxn->pMsg->msgType) {
+        /*
+         * Path management, not sent on a tunnel
+         */
+        rc = nwGtpv2cMsgAddIeTV1 (pUlpReq->hMsg, NW_GTPV2C_IE_RECOVERY, 0, thiz->restartCounter);
         NW_ASSERT (NW_OK == rc);
+        pTrxn->hTunnel = 0;
+        pTrxn->peerIp = pUlpReq->u_api_info.initialReqInfo.peerIp;
+      } else {
+        if (!pUlpReq->u_api_info.initialReqInfo.hTunnel) {
+          rc = nwGtpv2cCreateLocalTunnel (thiz, pUlpReq->u_api_info.initialReqInfo.teidLocal, &pUlpReq->u_api_info.initialReqInfo.peerIp,
+              pUlpReq->u_api_info.initialReqInfo.hUlpTunnel,
+              &pUlpReq->u_api_info.initialReqInfo.hTunnel);
+          NW_ASSERT (NW_OK == rc);
+        }
+
+        pTrxn->hTunnel = pUlpReq->u_api_info.initialReqInfo.hTunnel;
+        pTrxn->peerIp = ((nw_gtpv2c_tunnel_t *) (pTrxn->hTunnel))->ipv4AddrRemote;
       }
 
-      pTrxn->pMsg = (nw_gtpv2c_msg_t *) pUlpReq->hMsg;
-      pTrxn->hTunnel = pUlpReq->u_api_info.initialReqInfo.hTunnel;
       pTrxn->hUlpTrxn = pUlpReq->u_api_info.initialReqInfo.hUlpTrxn;
-      pTrxn->peerIp = ((nw_gtpv2c_tunnel_t *) (pTrxn->hTunnel))->ipv4AddrRemote;
       pTrxn->peerPort = NW_GTPV2C_UDP_PORT;
 
       if (pUlpReq->apiType & NW_GTPV2C_ULP_API_FLAG_IS_COMMAND_MESSAGE) {
@@ -579,7 +556,7 @@ static nw_rc_t nwGtpv2cCreateLocalTunnel (
         /*
          * Insert into search tree
          */
-        pTrxn = RB_INSERT (NwGtpv2cOutstandingTxSeqNumTrxnMap, &(thiz->outstandingTxSeqNumMap), pTrxn);
+        pTrxn = nwGtpv2cMapInsert (&(thiz->outstandingTxSeqNumMap), pTrxn);
         NW_ASSERT (pTrxn == NULL);
       } else {
         rc = nwGtpv2cTrxnDelete (&pTrxn);
@@ -630,7 +607,7 @@ static nw_rc_t nwGtpv2cCreateLocalTunnel (
         /*
          * Insert into search tree
          */
-        RB_INSERT (NwGtpv2cOutstandingTxSeqNumTrxnMap, &(thiz->outstandingTxSeqNumMap), pTrxn);
+        nwGtpv2cMapInsert (&(thiz->outstandingTxSeqNumMap), pTrxn);
 
         if (!pUlpReq->u_api_info.triggeredReqInfo.hTunnel) {
           rc = nwGtpv2cCreateLocalTunnel (thiz, pUlpReq->u_api_info.triggeredReqInfo.teidLocal, &pReqTrxn->peerIp,
@@ -707,7 +684,7 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
                               &pUlpReq->u_api_info.createLocalTunnelInfo.peerIp,
                               pUlpReq->u_api_info.triggeredRspInfo.hUlpTunnel);
   NW_ASSERT (pTunnel);
-  pCollision = RB_INSERT (NwGtpv2cTunnelMap, &(thiz->tunnelMap), pTunnel);
+  pCollision = nwGtpv2cMapInsert (&(thiz->tunnelMap), pTunnel);
 
   if (pCollision) {
     rc = nwGtpv2cTunnelDelete (thiz, pTunnel);
@@ -779,8 +756,8 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
   static nw_rc_t                            nwGtpv2cSendTriggeredRspIndToUlp (
   NW_IN nw_gtpv2c_stack_t * thiz,
   NW_IN nw_gtpv2c_error_t * pError,
-  NW_IN uint32_t hUlpTrxn,
-  NW_IN uint32_t hUlpTunnel,
+  NW_IN nw_gtpv2c_ulp_trxn_handle_t hUlpTrxn,
+  NW_IN nw_gtpv2c_ulp_tunnel_handle_t hUlpTunnel,
   NW_IN uint32_t msgType,
   NW_IN nw_gtpv2c_msg_handle_t hMsg) {
     nw_rc_t                                   rc = NW_FAILURE;
@@ -866,7 +843,7 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
     if (teidLocal) {
       keyTunnel.teid = ntohl (teidLocal);
       keyTunnel.ipv4AddrRemote.s_addr = peerIp->s_addr;
-      pLocalTunnel = RB_FIND (NwGtpv2cTunnelMap, &(thiz->tunnelMap), &keyTunnel);
+      pLocalTunnel = nwGtpv2cMapFind (&(thiz->tunnelMap), &keyTunnel);
 
       if (!pLocalTunnel) {
         OAILOG_WARNING (LOG_GTPV2C,  "Request message received on non-existent teid 0x%x from peer %s received! Discarding.\n", ntohl (teidLocal), ipv4);
@@ -918,15 +895,15 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
 
     keyTrxn.seqNum = ntohl (*((uint32_t *) (msgBuf + (((*msgBuf) & 0x08) ? 8 : 4)))) >> 8;;
     keyTrxn.peerIp.s_addr = peerIp->s_addr;
-    pTrxn = RB_FIND (NwGtpv2cOutstandingTxSeqNumTrxnMap, &(thiz->outstandingTxSeqNumMap), &keyTrxn);
+    pTrxn = nwGtpv2cMapFind (&(thiz->outstandingTxSeqNumMap), &keyTrxn);
 
     if (pTrxn) {
-      uint32_t                                hUlpTrxn;
-      uint32_t                                hUlpTunnel;
+      nw_gtpv2c_ulp_trxn_handle_t             hUlpTrxn;
+      nw_gtpv2c_ulp_tunnel_handle_t           hUlpTunnel;
 
       hUlpTrxn = pTrxn->hUlpTrxn;
       hUlpTunnel = (pTrxn->hTunnel ? ((nw_gtpv2c_tunnel_t *) (pTrxn->hTunnel))->hUlpTunnel : 0);
-      RB_REMOVE (NwGtpv2cOutstandingTxSeqNumTrxnMap, &(thiz->outstandingTxSeqNumMap), pTrxn);
+      nwGtpv2cMapRemove (&(thiz->outstandingTxSeqNumMap), pTrxn);
       rc = nwGtpv2cTrxnDelete (&pTrxn);
       NW_ASSERT (NW_OK == rc);
       NW_ASSERT (msgBuf && msgBufLen);
@@ -970,13 +947,15 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
       thiz->id = (uint32_t) thiz;
       thiz->seqNum = ((uint32_t) thiz) & 0x0000FFFF;
       OAI_GCC_DIAG_ON(pointer-to-int-cast);
-      RB_INIT (&(thiz->tunnelMap));
-      RB_INIT (&(thiz->outstandingTxSeqNumMap));
-      RB_INIT (&(thiz->outstandingRxSeqNumMap));
-      RB_INIT (&(thiz->activeTimerList));
-      OAI_GCC_DIAG_OFF(pointer-to-int-cast);
-      thiz->hTmrMinHeap = (NwPtrT) nwGtpv2cTmrMinHeapNew (10000);
-      OAI_GCC_DIAG_ON(pointer-to-int-cast);
+      rc = nwGtpv2cMapInit (&(thiz->tunnelMap), NW_GTPV2C_TUNNEL_MAP_INITIAL_SIZE,
+          offsetof (nw_gtpv2c_tunnel_t, tunnelMapNext), nwGtpv2cHashTunnel, nwGtpv2cEqualTunnel);
+      NW_ASSERT (NW_OK == rc);
+      rc = nwGtpv2cMapInit (&(thiz->outstandingTxSeqNumMap), NW_GTPV2C_TRXN_MAP_INITIAL_SIZE,
+          offsetof (nw_gtpv2c_trxn_t, outstandingTxSeqNumMapNext), nwGtpv2cHashOutstandingTxSeqNumTrxn, nwGtpv2cEqualOutstandingTxSeqNumTrxn);
+      NW_ASSERT (NW_OK == rc);
+      rc = nwGtpv2cMapInit (&(thiz->outstandingRxSeqNumMap), NW_GTPV2C_TRXN_MAP_INITIAL_SIZE,
+          offsetof (nw_gtpv2c_trxn_t, outstandingRxSeqNumMapNext), nwGtpv2cHashOutstandingRxSeqNumTrxn, nwGtpv2cEqualOutstandingRxSeqNumTrxn);
+      NW_ASSERT (NW_OK == rc);
       NW_GTPV2C_INIT_MSG_IE_PARSE_INFO (thiz, NW_GTP_ECHO_RSP);
       /*
        * For S11 interface
@@ -1050,9 +1029,15 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
 //    nwGtpv2cMsgIeParseInfoDelete(((NwGtpv2cStackT*)hGtpcStackHandle)->pGtpv2cMsgIeParseInfo[NW_GTP_IDENTIFICATION_REQ]);
 //    nwGtpv2cMsgIeParseInfoDelete(((NwGtpv2cStackT*)hGtpcStackHandle)->pGtpv2cMsgIeParseInfo[NW_GTP_IDENTIFICATION_RSP]);
 
-    OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-    nwGtpv2cTmrMinHeapDelete((NwGtpv2cTmrMinHeapT*)((nw_gtpv2c_stack_t*)hGtpcStackHandle)->hTmrMinHeap);
-    OAI_GCC_DIAG_ON(int-to-pointer-cast);
+    if (((nw_gtpv2c_stack_t*)hGtpcStackHandle)->tmrWheelRunning) {
+      ((nw_gtpv2c_stack_t*)hGtpcStackHandle)->tmrMgr.tmrStopCallback (((nw_gtpv2c_stack_t*)hGtpcStackHandle)->tmrMgr.tmrMgrHandle,
+                                                                      ((nw_gtpv2c_stack_t*)hGtpcStackHandle)->tmrWheelTickInfo.hTimer);
+    }
+
+    nwGtpv2cPurgePools ((nw_gtpv2c_stack_t*)hGtpcStackHandle);
+    nwGtpv2cMapFinalize (&((nw_gtpv2c_stack_t*)hGtpcStackHandle)->tunnelMap);
+    nwGtpv2cMapFinalize (&((nw_gtpv2c_stack_t*)hGtpcStackHandle)->outstandingTxSeqNumMap);
+    nwGtpv2cMapFinalize (&((nw_gtpv2c_stack_t*)hGtpcStackHandle)->outstandingRxSeqNumMap);
 
     free_wrapper ((void**)&hGtpcStackHandle);
     return NW_OK;
@@ -1306,210 +1291,123 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
    Process Timer timeout Request from Timer ULP Manager
 */
 
-  nw_rc_t                                   nwGtpv2cProcessTimeoutOld (
+  nw_rc_t                                   nwGtpv2cProcessTimeout (
   void *arg) {
-    nw_rc_t                                   rc = NW_FAILURE;
+    nw_rc_t                                   rc = NW_OK;
     nw_gtpv2c_stack_t                         *thiz = NULL;
     nw_gtpv2c_timeout_info_t                   *timeoutInfo = (nw_gtpv2c_timeout_info_t *) arg;
-    nw_gtpv2c_timeout_info_t                   *pNextTimeoutInfo = NULL;
-    struct timeval                          tv = {0};
 
     NW_ASSERT (timeoutInfo != NULL);
-    thiz = (nw_gtpv2c_stack_t *) (((nw_gtpv2c_timeout_info_t *) timeoutInfo)->hStack);
+    thiz = (nw_gtpv2c_stack_t *) (timeoutInfo->hStack);
     NW_ASSERT (thiz != NULL);
     OAILOG_FUNC_IN (LOG_GTPV2C);
 
-    if (thiz->activeTimerInfo == timeoutInfo) {
-      thiz->activeTimerInfo = NULL;
-      RB_REMOVE (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-      timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = timeoutInfo;
-      rc = ((timeoutInfo)->timeoutCallbackFunc) (timeoutInfo->timeoutArg);
-    } else {
-      OAILOG_WARNING (LOG_GTPV2C,  "Received timeout event from ULP for non-existent timeoutInfo 0x%p and activeTimer 0x%p!\n", timeoutInfo, thiz->activeTimerInfo);
+    if (timeoutInfo != &thiz->tmrWheelTickInfo) {
+      OAILOG_WARNING (LOG_GTPV2C,  "Received timeout event from ULP for non-existent timeoutInfo 0x%p!\n", timeoutInfo);
       OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
     }
 
-    NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-
-    for ((timeoutInfo) = RB_MIN (NwGtpv2cActiveTimerList, &(thiz->activeTimerList)); (timeoutInfo) != NULL;) {
-      if (NW_GTPV2C_TIMER_CMP_P (&timeoutInfo->tvTimeout, &tv, >))
-        break;
-
-      pNextTimeoutInfo = RB_NEXT (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-      RB_REMOVE (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-      timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = timeoutInfo;
-      rc = ((timeoutInfo)->timeoutCallbackFunc) (timeoutInfo->timeoutArg);
-      timeoutInfo = pNextTimeoutInfo;
-    }
+    nwGtpv2cTmrWheelAdvance (thiz);
 
     /*
-     * activeTimerInfo may be reset by the timeoutCallbackFunc call above
+     * The tick is only kept running while timers are armed. It is stopped here
+     * rather than in nwGtpv2cStopTimer() so that a stack with a low transaction
+     * rate does not restart it for each transaction.
      */
-    if (thiz->activeTimerInfo == NULL) {
-      timeoutInfo = RB_MIN (NwGtpv2cActiveTimerList, &(thiz->activeTimerList));
+    if ((0 == thiz->tmrWheelCount) && (thiz->tmrWheelRunning)) {
+      rc = thiz->tmrMgr.tmrStopCallback (thiz->tmrMgr.tmrMgrHandle, thiz->tmrWheelTickInfo.hTimer);
+      thiz->tmrWheelRunning = false;
 
-      if (timeoutInfo) {
-        NW_GTPV2C_TIMER_SUB (&timeoutInfo->tvTimeout, &tv, &tv);
-        rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, tv.tv_sec, tv.tv_usec, timeoutInfo->tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-        NW_ASSERT (NW_OK == rc);
-        thiz->activeTimerInfo = timeoutInfo;
+      if (NW_OK != rc) {
+        OAILOG_INFO (LOG_GTPV2C, "Stopping timer wheel tick 0x%" PRIxPTR " failed!\n", thiz->tmrWheelTickInfo.hTimer);
       }
     }
 
-    OAILOG_FUNC_RETURN (LOG_GTPV2C, rc);
+    OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
   }
 
-  nw_rc_t                                   nwGtpv2cProcessTimeout (
-  void *arg) {
-    nw_rc_t                                   rc = NW_FAILURE;
-    nw_gtpv2c_stack_t                         *thiz = NULL;
-    nw_gtpv2c_timeout_info_t                   *timeoutInfo = (nw_gtpv2c_timeout_info_t *) arg;
-    struct timeval                          tv = {0};
-
-    NW_ASSERT (timeoutInfo != NULL);
-    thiz = (nw_gtpv2c_stack_t *) (timeoutInfo->hStack);
-    NW_ASSERT (thiz != NULL);
-    OAILOG_FUNC_IN (LOG_GTPV2C);
-
-    if (thiz->activeTimerInfo == timeoutInfo) {
-      thiz->activeTimerInfo = NULL;
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      rc = nwGtpv2cTmrMinHeapRemove ((NwGtpv2cTmrMinHeapT*)thiz->hTmrMinHeap, timeoutInfo->timerMinHeapIndex);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
-      timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = timeoutInfo;
-      rc = ((timeoutInfo)->timeoutCallbackFunc) (timeoutInfo->timeoutArg);
-    } else {
-      OAILOG_WARNING (LOG_GTPV2C,  "Received timeout event from ULP for " "non-existent timeoutInfo 0x%p and activeTimer 0x%p!\n", timeoutInfo, thiz->activeTimerInfo);
-      OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
-    }
-
-    NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-    //printf("------ Start -------\n");
-    OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-    timeoutInfo = nwGtpv2cTmrMinHeapPeek ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap);
-    OAI_GCC_DIAG_ON(int-to-pointer-cast);
-
-    while ((timeoutInfo) != NULL) {
-      if (NW_GTPV2C_TIMER_CMP_P (&timeoutInfo->tvTimeout, &tv, >))
-        break;
-
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      rc = nwGtpv2cTmrMinHeapRemove ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap, timeoutInfo->timerMinHeapIndex);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
-      timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = timeoutInfo;
-      rc = ((timeoutInfo)->timeoutCallbackFunc) (timeoutInfo->timeoutArg);
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      timeoutInfo = nwGtpv2cTmrMinHeapPeek ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
-    }
+/*---------------------------------------------------------------------------
+   Transaction owner
+  --------------------------------------------------------------------------*/
 
+  nw_gtpv2c_stack_handle_t                  nwGtpv2cTrxnGetStackHandle (
+  NW_IN nw_gtpv2c_trxn_handle_t hTrxn) {
     /*
-     * activeTimerInfo may be reset by the timeoutCallbackFunc call above
+     * Transactions go back to the free-list of the instance that allocated
+     * them, so pStack of a transaction never changes once set.
      */
-    if (thiz->activeTimerInfo == NULL) {
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      timeoutInfo = nwGtpv2cTmrMinHeapPeek ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
-
-      if (timeoutInfo) {
-        NW_GTPV2C_TIMER_SUB (&timeoutInfo->tvTimeout, &tv, &tv);
-        rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, tv.tv_sec, tv.tv_usec, timeoutInfo->tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-        NW_ASSERT (NW_OK == rc);
-        thiz->activeTimerInfo = timeoutInfo;
-      }
-    }
-
-    OAILOG_FUNC_RETURN (LOG_GTPV2C, rc);
+    return (hTrxn) ? (nw_gtpv2c_stack_handle_t) ((nw_gtpv2c_trxn_t *) hTrxn)->pStack : 0;
   }
 
-/**
-   Start Timer with ULP Timer Manager
-*/
-
-
-
-
+/*---------------------------------------------------------------------------
+   Path failure
+  --------------------------------------------------------------------------*/
 
-  nw_rc_t                                   nwGtpv2cStartTimer (
-  nw_gtpv2c_stack_t * thiz,
-  uint32_t timeoutSec,
-  uint32_t timeoutUsec,
-  uint32_t tmrType,
-  nw_rc_t                                   (*timeoutCallbackFunc) (void *),
-  void *timeoutCallbackArg,
-  nw_gtpv2c_timer_handle_t * phTimer) {
+  nw_rc_t                                   nwGtpv2cProcessPeerFailure (
+  NW_IN nw_gtpv2c_stack_handle_t hGtpcStackHandle,
+  NW_IN const struct in_addr * const peerIp,
+  NW_OUT uint32_t * const pCount) {
     nw_rc_t                                   rc = NW_OK;
-    struct timeval                          tv = { 0 };
-    nw_gtpv2c_timeout_info_t                   *timeoutInfo = NULL;
+    nw_gtpv2c_stack_t                         *thiz = (nw_gtpv2c_stack_t *) hGtpcStackHandle;
+    nw_gtpv2c_trxn_t                          *pFailed = NULL;
+    nw_gtpv2c_trxn_t                          *pTrxn = NULL;
+    uint32_t                                  count = 0;
 
+    NW_ASSERT (thiz);
+    NW_ASSERT (peerIp);
     OAILOG_FUNC_IN (LOG_GTPV2C);
 
-    if (gpGtpv2cTimeoutInfoPool) {
-      timeoutInfo = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = gpGtpv2cTimeoutInfoPool->next;
-    } else {
-      NW_GTPV2C_MALLOC (thiz, sizeof (nw_gtpv2c_timeout_info_t), timeoutInfo, nw_gtpv2c_timeout_info_t *);
-    }
-
-    if (timeoutInfo) {
-      timeoutInfo->tmrType = tmrType;
-      timeoutInfo->timeoutArg = timeoutCallbackArg;
-      timeoutInfo->timeoutCallbackFunc = timeoutCallbackFunc;
-      timeoutInfo->hStack = (nw_gtpv2c_stack_handle_t) thiz;
-      NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-      NW_ASSERT (gettimeofday (&timeoutInfo->tvTimeout, NULL) == 0);
-      timeoutInfo->tvTimeout.tv_sec = timeoutSec;
-      timeoutInfo->tvTimeout.tv_usec = timeoutUsec;
-      NW_GTPV2C_TIMER_ADD (&tv, &timeoutInfo->tvTimeout, &timeoutInfo->tvTimeout);
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      rc = nwGtpv2cTmrMinHeapInsert ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap, timeoutInfo);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
-#if 0
-
-      do {
-        collision = RB_INSERT (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-
-        if (!collision)
-          break;
-
-        OAILOG_WARNING (LOG_GTPV2C,  "timer collision!\n");
-        timeoutInfo->tvTimeout.tv_usec++;       /* HACK: In case there is a collision, schedule this event 1 usec later */
-
-        if (timeoutInfo->tvTimeout.tv_usec > (999999 /*1000000 - 1 */ )) {
-          timeoutInfo->tvTimeout.tv_usec = 0;
-          timeoutInfo->tvTimeout.tv_sec++;
-        }
-      } while (1);
+    /*
+     * Unlink all of them first: the ULP may send new requests to another peer
+     * from the failure indications, that would modify the map.
+     */
+    for (uint32_t i = 0; i <= thiz->outstandingTxSeqNumMap.mask; i++) {
+      pTrxn = (nw_gtpv2c_trxn_t *) thiz->outstandingTxSeqNumMap.bucket[i];
 
-#endif
+      while (pTrxn) {
+        nw_gtpv2c_trxn_t                         *pNext = pTrxn->outstandingTxSeqNumMapNext;
 
-      if (thiz->activeTimerInfo) {
-        if (NW_GTPV2C_TIMER_CMP_P (&(thiz->activeTimerInfo->tvTimeout), &(timeoutInfo->tvTimeout), >)) {
-          OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", thiz->activeTimerInfo->hTimer, thiz->activeTimerInfo);
-          rc = thiz->tmrMgr.tmrStopCallback (thiz->tmrMgr.tmrMgrHandle, thiz->activeTimerInfo->hTimer);
-          NW_ASSERT (NW_OK == rc);
-        } else {
-          OAILOG_DEBUG (LOG_GTPV2C, "Already Started timer 0x%" PRIxPTR " for info 0x%p!\n", thiz->activeTimerInfo->hTimer, thiz->activeTimerInfo);
-          *phTimer = (nw_gtpv2c_timer_handle_t) timeoutInfo;
-          OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
+        if (pTrxn->peerIp.s_addr == peerIp->s_addr) {
+          nwGtpv2cMapRemove (&thiz->outstandingTxSeqNumMap, pTrxn);
+          pTrxn->next = pFailed;
+          pFailed = pTrxn;
         }
+
+        pTrxn = pNext;
       }
+    }
 
-      rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, timeoutSec, timeoutUsec, tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-      OAILOG_DEBUG (LOG_GTPV2C, "Started timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
+    while (pFailed) {
+      nw_gtpv2c_ulp_api_t                       ulpApi;
+
+      pTrxn = pFailed;
+      pFailed = pTrxn->next;
+      ulpApi.hMsg = 0;
+      ulpApi.apiType = NW_GTPV2C_ULP_API_RSP_FAILURE_IND;
+      ulpApi.u_api_info.rspFailureInfo.hUlpTrxn = pTrxn->hUlpTrxn;
+      ulpApi.u_api_info.rspFailureInfo.hUlpTunnel = ((pTrxn->hTunnel) ? ((nw_gtpv2c_tunnel_t *) (pTrxn->hTunnel))->hUlpTunnel : 0);
+      ulpApi.u_api_info.rspFailureInfo.msgType = pTrxn->pMsg->msgType;
+      ulpApi.u_api_info.rspFailureInfo.peerIp = pTrxn->peerIp;
+      // stops the T3 timer
+      rc = nwGtpv2cTrxnDelete (&pTrxn);
       NW_ASSERT (NW_OK == rc);
-      thiz->activeTimerInfo = timeoutInfo;
+      rc = thiz->ulp.ulpReqCallback (thiz->ulp.hUlp, &ulpApi);
+      count++;
     }
 
-    *phTimer = (nw_gtpv2c_timer_handle_t) timeoutInfo;
-    OAILOG_FUNC_RETURN (LOG_GTPV2C, rc);
+    OAILOG_WARNING (LOG_GTPV2C, "Path failure towards peer %s, failed %u outstanding transactions\n", inet_ntoa (*peerIp), count);
+
+    if (pCount) {
+      *pCount = count;
+    }
+
+    OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
   }
 
-  nw_rc_t                                   nwGtpv2cStartTimerOld (
+/**
+   Start Timer on the stack timer wheel
+*/
+  nw_rc_t                                   nwGtpv2cStartTimer (
   nw_gtpv2c_stack_t * thiz,
   uint32_t timeoutSec,
   uint32_t timeoutUsec,
@@ -1518,16 +1416,25 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
   void *timeoutCallbackArg,
   nw_gtpv2c_timer_handle_t * phTimer) {
     nw_rc_t                                   rc = NW_OK;
-    struct timeval                          tv;
-    nw_gtpv2c_timeout_info_t                   *timeoutInfo;
-    nw_gtpv2c_timeout_info_t                   *collision;
+    nw_gtpv2c_timeout_info_t                   *timeoutInfo = NULL;
+    uint64_t                                expiryTick = 0;
 
     NW_ASSERT (thiz != NULL);
     OAILOG_FUNC_IN (LOG_GTPV2C);
 
-    if (gpGtpv2cTimeoutInfoPool) {
-      timeoutInfo = gpGtpv2cTimeoutInfoPool;
-      gpGtpv2cTimeoutInfoPool = gpGtpv2cTimeoutInfoPool->next;
+    if (!thiz->tmrWheelRunning) {
+      thiz->tmrWheelTickInfo.hStack = (nw_gtpv2c_stack_handle_t) thiz;
+      thiz->tmrWheelTick = nwGtpv2cTmrWheelNowMs () / NW_GTPV2C_TMR_WHEEL_TICK_MS;
+      rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, 0, NW_GTPV2C_TMR_WHEEL_TICK_MS * 1000, NW_GTPV2C_TMR_TYPE_REPETITIVE,
+                                          (void *)&thiz->tmrWheelTickInfo, &thiz->tmrWheelTickInfo.hTimer);
+      NW_ASSERT (NW_OK == rc);
+      OAILOG_DEBUG (LOG_GTPV2C, "Started timer wheel tick 0x%" PRIxPTR "!\n", thiz->tmrWheelTickInfo.hTimer);
+      thiz->tmrWheelRunning = true;
+    }
+
+    if (thiz->timeoutInfoPool) {
+      timeoutInfo = thiz->timeoutInfoPool;
+      thiz->timeoutInfoPool = thiz->timeoutInfoPool->next;
     } else {
       NW_GTPV2C_MALLOC (thiz, sizeof (nw_gtpv2c_timeout_info_t), timeoutInfo, nw_gtpv2c_timeout_info_t *);
     }
@@ -1537,43 +1444,14 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
       timeoutInfo->timeoutArg = timeoutCallbackArg;
       timeoutInfo->timeoutCallbackFunc = timeoutCallbackFunc;
       timeoutInfo->hStack = (nw_gtpv2c_stack_handle_t) thiz;
-      NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-      NW_ASSERT (gettimeofday (&timeoutInfo->tvTimeout, NULL) == 0);
-      timeoutInfo->tvTimeout.tv_sec = timeoutSec;
-      timeoutInfo->tvTimeout.tv_usec = timeoutUsec;
-      NW_GTPV2C_TIMER_ADD (&tv, &timeoutInfo->tvTimeout, &timeoutInfo->tvTimeout);
-
-      do {
-        collision = RB_INSERT (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-
-        if (!collision)
-          break;
-
-        OAILOG_WARNING (LOG_GTPV2C,  "timer collision!\n");
-        timeoutInfo->tvTimeout.tv_usec++;       /* HACK: In case there is a collision, schedule this event 1 usec later */
-
-        if (timeoutInfo->tvTimeout.tv_usec > (999999 /*1000000 - 1 */ )) {
-          timeoutInfo->tvTimeout.tv_usec = 0;
-          timeoutInfo->tvTimeout.tv_sec++;
-        }
-      } while (1);
-
-      if (thiz->activeTimerInfo) {
-        if (NW_GTPV2C_TIMER_CMP_P (&(thiz->activeTimerInfo->tvTimeout), &(timeoutInfo->tvTimeout), >)) {
-          OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", thiz->activeTimerInfo->hTimer, thiz->activeTimerInfo);
-          rc = thiz->tmrMgr.tmrStopCallback (thiz->tmrMgr.tmrMgrHandle, thiz->activeTimerInfo->hTimer);
-          NW_ASSERT (NW_OK == rc);
-        } else {
-          OAILOG_DEBUG (LOG_GTPV2C, "Already Started timer 0x%" PRIxPTR " for info 0x%p!\n", thiz->activeTimerInfo->hTimer, thiz->activeTimerInfo);
-          *phTimer = (nw_gtpv2c_timer_handle_t) timeoutInfo;
-          OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
-        }
-      }
-
-      rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, timeoutSec, timeoutUsec, tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-      OAILOG_DEBUG (LOG_GTPV2C, "Started timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-      NW_ASSERT (NW_OK == rc);
-      thiz->activeTimerInfo = timeoutInfo;
+      timeoutInfo->hTimer = (nw_gtpv2c_timer_handle_t) timeoutInfo;
+      // Rounded up to the next tick, a timer never expires early
+      expiryTick = (nwGtpv2cTmrWheelNowMs () + (uint64_t) timeoutSec * 1000 + (timeoutUsec + 999) / 1000 + NW_GTPV2C_TMR_WHEEL_TICK_MS - 1) / NW_GTPV2C_TMR_WHEEL_TICK_MS;
+      timeoutInfo->expiryTick = (expiryTick > thiz->tmrWheelTick) ? expiryTick : thiz->tmrWheelTick + 1;
+      nwGtpv2cTmrWheelLink (&thiz->tmrWheel[timeoutInfo->expiryTick & (NW_GTPV2C_TMR_WHEEL_SLOTS - 1)], timeoutInfo);
+      thiz->tmrWheelCount++;
+    } else {
+      rc = NW_FAILURE;
     }
 
     *phTimer = (nw_gtpv2c_timer_handle_t) timeoutInfo;
@@ -1581,96 +1459,27 @@ static nw_rc_t nwGtpv2cHandleUlpCreateLocalTunnel (NW_IN nw_gtpv2c_stack_t * thi
   }
 
 /**
-   Stop Timer with ULP Timer Manager
+   Stop Timer on the stack timer wheel
 */
   nw_rc_t                                   nwGtpv2cStopTimer (
   nw_gtpv2c_stack_t * thiz,
   nw_gtpv2c_timer_handle_t hTimer) {
-    nw_rc_t                                   rc = NW_OK;
-    struct timeval                          tv;
-    nw_gtpv2c_timeout_info_t                   *timeoutInfo;
+    nw_gtpv2c_timeout_info_t                   *timeoutInfo = (nw_gtpv2c_timeout_info_t *) hTimer;
 
     NW_ASSERT (thiz != NULL);
     OAILOG_FUNC_IN (LOG_GTPV2C);
-    timeoutInfo = (nw_gtpv2c_timeout_info_t *) hTimer;
-    OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-    rc = nwGtpv2cTmrMinHeapRemove ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap, timeoutInfo->timerMinHeapIndex);
-    OAI_GCC_DIAG_ON(int-to-pointer-cast);
-    timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-    gpGtpv2cTimeoutInfoPool = timeoutInfo;
-    OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-
-    if (thiz->activeTimerInfo == timeoutInfo) {
-      OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-      rc = thiz->tmrMgr.tmrStopCallback (thiz->tmrMgr.tmrMgrHandle, timeoutInfo->hTimer);
-      thiz->activeTimerInfo = NULL;
-      if (NW_OK != rc) {
-        OAILOG_INFO (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p failed!\n", timeoutInfo->hTimer, timeoutInfo);
-      }
-      OAI_GCC_DIAG_OFF(int-to-pointer-cast);
-      timeoutInfo = nwGtpv2cTmrMinHeapPeek ((NwGtpv2cTmrMinHeapT *)thiz->hTmrMinHeap);
-      OAI_GCC_DIAG_ON(int-to-pointer-cast);
 
-      if (timeoutInfo) {
-        NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-
-        if (NW_GTPV2C_TIMER_CMP_P (&timeoutInfo->tvTimeout, &tv, <)) {
-          thiz->activeTimerInfo = timeoutInfo;
-          rc = nwGtpv2cProcessTimeout (timeoutInfo);
-          NW_ASSERT (NW_OK == rc);
-        } else {
-          NW_GTPV2C_TIMER_SUB (&timeoutInfo->tvTimeout, &tv, &tv);
-          rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, tv.tv_sec, tv.tv_usec, timeoutInfo->tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-          NW_ASSERT (NW_OK == rc);
-          OAILOG_DEBUG (LOG_GTPV2C, "Started timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-          thiz->activeTimerInfo = timeoutInfo;
-        }
-      }
+    if ((!timeoutInfo) || (!timeoutInfo->ppSlot)) {
+      // Already expired or stopped
+      OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_FAILURE);
     }
 
-    OAILOG_FUNC_RETURN (LOG_GTPV2C, rc);
-  }
-
-  nw_rc_t                                   nwGtpv2cStopTimerOld (
-  nw_gtpv2c_stack_t * thiz,
-  nw_gtpv2c_timer_handle_t hTimer) {
-    nw_rc_t                                   rc = NW_OK;
-    struct timeval                          tv;
-    nw_gtpv2c_timeout_info_t                   *timeoutInfo;
-
-    NW_ASSERT (thiz != NULL);
-    OAILOG_FUNC_IN (LOG_GTPV2C);
-    timeoutInfo = (nw_gtpv2c_timeout_info_t *) hTimer;
-    RB_REMOVE (NwGtpv2cActiveTimerList, &(thiz->activeTimerList), timeoutInfo);
-    timeoutInfo->next = gpGtpv2cTimeoutInfoPool;
-    gpGtpv2cTimeoutInfoPool = timeoutInfo;
-    OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-
-    if (thiz->activeTimerInfo == timeoutInfo) {
-      OAILOG_DEBUG (LOG_GTPV2C, "Stopping active timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-      rc = thiz->tmrMgr.tmrStopCallback (thiz->tmrMgr.tmrMgrHandle, timeoutInfo->hTimer);
-      thiz->activeTimerInfo = NULL;
-      NW_ASSERT (NW_OK == rc);
-      timeoutInfo = RB_MIN (NwGtpv2cActiveTimerList, &(thiz->activeTimerList));
-
-      if (timeoutInfo) {
-        NW_ASSERT (gettimeofday (&tv, NULL) == 0);
-
-        if (NW_GTPV2C_TIMER_CMP_P (&timeoutInfo->tvTimeout, &tv, <)) {
-          thiz->activeTimerInfo = timeoutInfo;
-          rc = nwGtpv2cProcessTimeout (timeoutInfo);
-          NW_ASSERT (NW_OK == rc);
-        } else {
-          NW_GTPV2C_TIMER_SUB (&timeoutInfo->tvTimeout, &tv, &tv);
-          rc = thiz->tmrMgr.tmrStartCallback (thiz->tmrMgr.tmrMgrHandle, tv.tv_sec, tv.tv_usec, timeoutInfo->tmrType, (void *)timeoutInfo, &timeoutInfo->hTimer);
-          NW_ASSERT (NW_OK == rc);
-          OAILOG_DEBUG (LOG_GTPV2C, "Started timer 0x%" PRIxPTR " for info 0x%p!\n", timeoutInfo->hTimer, timeoutInfo);
-          thiz->activeTimerInfo = timeoutInfo;
-        }
-      }
-    }
-
-    OAILOG_FUNC_RETURN (LOG_GTPV2C, rc);
+    OAILOG_DEBUG (LOG_GTPV2C, "Stopping timer for info 0x%p!\n", timeoutInfo);
+    nwGtpv2cTmrWheelUnlink (timeoutInfo);
+    thiz->tmrWheelCount--;
+    timeoutInfo->next = thiz->timeoutInfoPool;
+    thiz->timeoutInfoPool = timeoutInfo;
+    OAILOG_FUNC_RETURN (LOG_GTPV2C, NW_OK);
   }
 
 #ifdef __cplusplus
@@ -0,0 +1,168 @@
+/*----------------------------------------------------------------------------*
+ *                                                                            *
+                                n w - g t p v 2 c
+      G P R S   T u n n e l i n g    P r o t o c o l   v 2 c    S t a c k
+ *                                                                            *
+ *                                                                            *
+   Copyright (c) 2010-2011 Amit Chawre
+   All rights reserved.
+ *                                                                            *
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+ *                                                                            *
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. The name of the author may not be used to endorse or promote products
+      derived from this software without specific prior written permission.
+ *                                                                            *
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  ----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2cMap.h"
+
+#ifdef __cplusplus
+extern                                  "C" {
+#endif
+
+#define NW_GTPV2C_MAP_NEXT(_map, _elm)  (*((void **)((uint8_t *)(_elm) + (_map)->nextOffset)))
+
+//------------------------------------------------------------------------------
+static void nwGtpv2cMapGrow (nw_gtpv2c_map_t * thiz)
+{
+  uint32_t                                size = (thiz->mask + 1) << 1;
+  void                                  **bucket = calloc (size, sizeof (void *));
+
+  if (!bucket) {
+    // Keep the current buckets, longer chains
+    return;
+  }
+
+  for (uint32_t i = 0; i <= thiz->mask; i++) {
+    void                                   *elm = thiz->bucket[i];
+
+    while (elm) {
+      void                                   *next = NW_GTPV2C_MAP_NEXT (thiz, elm);
+      uint32_t                                b = thiz->hash (elm) & (size - 1);
+
+      NW_GTPV2C_MAP_NEXT (thiz, elm) = bucket[b];
+      bucket[b] = elm;
+      elm = next;
+    }
+  }
+
+  free (thiz->bucket);
+  thiz->bucket = bucket;
+  thiz->mask = size - 1;
+}
+
+//------------------------------------------------------------------------------
+nw_rc_t nwGtpv2cMapInit (nw_gtpv2c_map_t * thiz,
+      uint32_t initialSize,
+      size_t nextOffset,
+      uint32_t (*hash)(const void *elm),
+      int (*equal)(const void *a, const void *b))
+{
+  uint32_t                                size = 1;
+
+  while (size < initialSize) {
+    size <<= 1;
+  }
+
+  memset (thiz, 0, sizeof (nw_gtpv2c_map_t));
+  thiz->bucket = calloc (size, sizeof (void *));
+
+  if (!thiz->bucket) {
+    return NW_FAILURE;
+  }
+
+  thiz->mask = size - 1;
+  thiz->nextOffset = nextOffset;
+  thiz->hash = hash;
+  thiz->equal = equal;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+nw_rc_t nwGtpv2cMapFinalize (nw_gtpv2c_map_t * thiz)
+{
+  free (thiz->bucket);
+  thiz->bucket = NULL;
+  thiz->mask = 0;
+  thiz->count = 0;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+void *nwGtpv2cMapInsert (nw_gtpv2c_map_t * thiz, void *elm)
+{
+  uint32_t                                b = thiz->hash (elm) & thiz->mask;
+
+  for (void *cur = thiz->bucket[b]; cur; cur = NW_GTPV2C_MAP_NEXT (thiz, cur)) {
+    if (thiz->equal (cur, elm)) {
+      return cur;
+    }
+  }
+
+  NW_GTPV2C_MAP_NEXT (thiz, elm) = thiz->bucket[b];
+  thiz->bucket[b] = elm;
+
+  if (++thiz->count > thiz->mask + 1) {
+    nwGtpv2cMapGrow (thiz);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+void *nwGtpv2cMapFind (nw_gtpv2c_map_t * thiz, const void *key)
+{
+  for (void *cur = thiz->bucket[thiz->hash (key) & thiz->mask]; cur; cur = NW_GTPV2C_MAP_NEXT (thiz, cur)) {
+    if (thiz->equal (cur, key)) {
+      return cur;
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+void *nwGtpv2cMapRemove (nw_gtpv2c_map_t * thiz, void *elm)
+{
+  void                                  **pp = &thiz->bucket[thiz->hash (elm) & thiz->mask];
+
+  while (*pp) {
+    if (*pp == elm) {
+      *pp = NW_GTPV2C_MAP_NEXT (thiz, elm);
+      NW_GTPV2C_MAP_NEXT (thiz, elm) = NULL;
+      thiz->count--;
+      return elm;
+    }
+    pp = &NW_GTPV2C_MAP_NEXT (thiz, *pp);
+  }
+  return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/*--------------------------------------------------------------------------*
+                        E N D     O F    F I L E
+  --------------------------------------------------------------------------*/
@@ -53,12 +53,77 @@
 extern                                  "C" {
 #endif
 
-
 /*----------------------------------------------------------------------------*
                        P R I V A T E     F U N C T I O N S
   ----------------------------------------------------------------------------*/
 
-  static nw_gtpv2c_msg_t                    *gpGtpv2cMsgPool = NULL;
+  static uint8_t                           *nwGtpv2cMsgBufAlloc (
+  NW_IN nw_gtpv2c_stack_t * pStack,
+  NW_IN uint8_t bufClass) {
+    uint8_t                                *pBuf = pStack->msgBufPool[bufClass];
+
+    if (pBuf) {
+      // free buffers are linked through their first bytes
+      pStack->msgBufPool[bufClass] = *((uint8_t **) pBuf);
+    } else {
+      NW_GTPV2C_MALLOC (pStack, NW_GTPV2C_MSG_BUF_CLASS_SIZE (bufClass), pBuf, uint8_t *);
+    }
+    return pBuf;
+  }
+
+  static void                               nwGtpv2cMsgBufFree (
+  NW_IN nw_gtpv2c_stack_t * pStack,
+  NW_IN nw_gtpv2c_msg_t * pMsg) {
+    if ((pMsg->msgBuf) && (pMsg->msgBufClass < NW_GTPV2C_MSG_BUF_BORROWED)) {
+      *((uint8_t **) pMsg->msgBuf) = pStack->msgBufPool[pMsg->msgBufClass];
+      pStack->msgBufPool[pMsg->msgBufClass] = pMsg->msgBuf;
+    }
+    pMsg->msgBuf = NULL;
+    pMsg->msgBufSize = 0;
+  }
+
+/**
+   Make room for length more bytes at the end of the message, moving it to a
+   buffer of a larger size class if needed.
+*/
+  static nw_rc_t                            nwGtpv2cMsgReserve (
+  NW_IN nw_gtpv2c_msg_t * pMsg,
+  NW_IN uint32_t length) {
+    nw_gtpv2c_stack_t                         *pStack = (nw_gtpv2c_stack_t *) pMsg->hStack;
+    uint8_t                                 bufClass = pMsg->msgBufClass;
+    uint8_t                                *pBuf = NULL;
+
+    if (pMsg->msgLen + length <= pMsg->msgBufSize) {
+      return NW_OK;
+    }
+
+    if (NW_GTPV2C_MSG_BUF_BORROWED == bufClass) {
+      OAILOG_ERROR (LOG_GTPV2C, "Cannot add IE to received message %p!\n", pMsg);
+      return NW_FAILURE;
+    }
+
+    while ((bufClass < NW_GTPV2C_MSG_BUF_CLASSES) && (pMsg->msgLen + length > NW_GTPV2C_MSG_BUF_CLASS_SIZE (bufClass))) {
+      bufClass++;
+    }
+
+    if ((bufClass == NW_GTPV2C_MSG_BUF_CLASSES) || (!(pBuf = nwGtpv2cMsgBufAlloc (pStack, bufClass)))) {
+      OAILOG_ERROR (LOG_GTPV2C, "Message %p of type %u exceeds %u bytes!\n", pMsg, pMsg->msgType, NW_GTPV2C_MAX_MSG_LEN);
+      return NW_FAILURE;
+    }
+
+    memcpy (pBuf, pMsg->msgBuf, pMsg->msgLen);
+
+    // grouped IEs being encoded are referenced by address
+    for (int i = 0; i < pMsg->groupedIeEncodeStack.top; i++) {
+      pMsg->groupedIeEncodeStack.pIe[i] = (nw_gtpv2c_ie_tlv_t *) (pBuf + ((uint8_t *) pMsg->groupedIeEncodeStack.pIe[i] - pMsg->msgBuf));
+    }
+
+    nwGtpv2cMsgBufFree (pStack, pMsg);
+    pMsg->msgBuf = pBuf;
+    pMsg->msgBufSize = NW_GTPV2C_MSG_BUF_CLASS_SIZE (bufClass);
+    pMsg->msgBufClass = bufClass;
+    return NW_OK;
+  }
 
 /*----------------------------------------------------------------------------*
                          P U B L I C   F U N C T I O N S
@@ -76,14 +141,22 @@ extern                                  "C" {
                                             NW_ASSERT (
   pStack);
 
-    if (gpGtpv2cMsgPool) {
-      pMsg = gpGtpv2cMsgPool;
-      gpGtpv2cMsgPool = gpGtpv2cMsgPool->next;
+    if (pStack->msgPool) {
+      pMsg = pStack->msgPool;
+      pStack->msgPool = pStack->msgPool->next;
     } else {
       NW_GTPV2C_MALLOC (pStack, sizeof (nw_gtpv2c_msg_t), pMsg, nw_gtpv2c_msg_t *);
     }
 
+    if ((pMsg) && (!(pMsg->msgBuf = nwGtpv2cMsgBufAlloc (pStack, 0)))) {
+      pMsg->next = pStack->msgPool;
+      pStack->msgPool = pMsg;
+      pMsg = NULL;
+    }
+
     if (pMsg) {
+      pMsg->msgBufSize = NW_GTPV2C_MSG_BUF_CLASS_SIZE (0);
+      pMsg->msgBufClass = 0;
       pMsg->version = NW_GTP_VERSION;
       pMsg->teidPresent = teidPresent;
       pMsg->msgType = msgType;
@@ -110,16 +183,19 @@ extern                                  "C" {
 
     NW_ASSERT (pStack);
 
-    if (gpGtpv2cMsgPool) {
-      pMsg = gpGtpv2cMsgPool;
-      gpGtpv2cMsgPool = gpGtpv2cMsgPool->next;
+    if (pStack->msgPool) {
+      pMsg = pStack->msgPool;
+      pStack->msgPool = pStack->msgPool->next;
     } else {
       NW_GTPV2C_MALLOC (pStack, sizeof (nw_gtpv2c_msg_t), pMsg, nw_gtpv2c_msg_t *);
     }
 
     if (pMsg) {
       *phMsg = (nw_gtpv2c_msg_handle_t) pMsg;
-      memcpy (pMsg->msgBuf, pBuf, bufLen);
+      // parsed in place, pBuf has to stay valid until the message is deleted
+      pMsg->msgBuf = pBuf;
+      pMsg->msgBufSize = bufLen;
+      pMsg->msgBufClass = NW_GTPV2C_MSG_BUF_BORROWED;
       pMsg->msgLen = bufLen;
       pMsg->version = ((*pBuf) & 0xE0) >> 5;
       pMsg->teidPresent = ((*pBuf) & 0x08) >> 3;
@@ -145,11 +221,13 @@ extern                                  "C" {
   nw_rc_t                                   nwGtpv2cMsgDelete (
   NW_IN nw_gtpv2c_stack_handle_t hGtpcStackHandle,
   NW_IN nw_gtpv2c_msg_handle_t hMsg) {
-    // warning: unused variable ‘pStack’ [-Wunused-variable]: NwGtpv2cStackT                         *pStack = (NwGtpv2cStackT *) hGtpcStackHandle;
+    // back to the pool of the instance that allocated it
+    nw_gtpv2c_stack_t                         *pStack = (nw_gtpv2c_stack_t *) ((nw_gtpv2c_msg_t *) hMsg)->hStack;
 
     OAILOG_DEBUG (LOG_GTPV2C, "Purging message %" PRIxPTR "!\n", hMsg);
-    ((nw_gtpv2c_msg_t *) hMsg)->next = gpGtpv2cMsgPool;
-    gpGtpv2cMsgPool = (nw_gtpv2c_msg_t *) hMsg;
+    nwGtpv2cMsgBufFree (pStack, (nw_gtpv2c_msg_t *) hMsg);
+    ((nw_gtpv2c_msg_t *) hMsg)->next = pStack->msgPool;
+    pStack->msgPool = (nw_gtpv2c_msg_t *) hMsg;
     return NW_OK;
   }
 
@@ -275,6 +353,9 @@ extern                                  "C" {
     nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
     nw_gtpv2c_ie_tv1_t                         *pIe;
 
+    if (NW_OK != nwGtpv2cMsgReserve (pMsg, sizeof (nw_gtpv2c_ie_tv1_t))) {
+      return NW_FAILURE;
+    }
     pIe = (nw_gtpv2c_ie_tv1_t *) (pMsg->msgBuf + pMsg->msgLen);
     pIe->t = type;
     pIe->l = htons (0x0001);
@@ -292,6 +373,9 @@ extern                                  "C" {
     nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
     nw_gtpv2c_ie_tv2_t                         *pIe;
 
+    if (NW_OK != nwGtpv2cMsgReserve (pMsg, sizeof (nw_gtpv2c_ie_tv2_t))) {
+      return NW_FAILURE;
+    }
     pIe = (nw_gtpv2c_ie_tv2_t *) (pMsg->msgBuf + pMsg->msgLen);
     pIe->t = type;
     pIe->l = htons (0x0002);
@@ -309,6 +393,9 @@ extern                                  "C" {
     nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
     nw_gtpv2c_ie_tv4_t                         *pIe;
 
+    if (NW_OK != nwGtpv2cMsgReserve (pMsg, sizeof (nw_gtpv2c_ie_tv4_t))) {
+      return NW_FAILURE;
+    }
     pIe = (nw_gtpv2c_ie_tv4_t *) (pMsg->msgBuf + pMsg->msgLen);
     pIe->t = type;
     pIe->l = htons (0x0004);
@@ -327,6 +414,9 @@ extern                                  "C" {
     nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
     nw_gtpv2c_ie_tlv_t                         *pIe;
 
+    if (NW_OK != nwGtpv2cMsgReserve (pMsg, 4 + length)) {
+      return NW_FAILURE;
+    }
     pIe = (nw_gtpv2c_ie_tlv_t *) (pMsg->msgBuf + pMsg->msgLen);
     pIe->t = type;
     pIe->l = htons (length);
@@ -343,6 +433,9 @@ extern                                  "C" {
     nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
     nw_gtpv2c_ie_tlv_t                         *pIe;
 
+    if (NW_OK != nwGtpv2cMsgReserve (pMsg, 4)) {
+      return NW_FAILURE;
+    }
     pIe = (nw_gtpv2c_ie_tlv_t *) (pMsg->msgBuf + pMsg->msgLen);
     pIe->t = type;
     pIe->i = instance & 0x00ff;
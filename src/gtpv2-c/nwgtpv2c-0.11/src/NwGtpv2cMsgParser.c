@@ -266,6 +266,152 @@ extern                                  "C" {
     return rc;
   }
 
+  nw_rc_t                                   nwGtpv2cMsgParserTemplateInit (
+  NW_OUT nw_gtpv2c_msg_parser_template_t * thiz,
+  NW_IN uint8_t msgType,
+  NW_IN nw_rc_t                             (*ieReadCallback) (uint8_t ieType,
+                                                             uint8_t ieLength,
+                                                             uint8_t ieInstance,
+                                                             uint8_t * ieValue,
+                                                             void *ieReadCallbackArg),
+  NW_IN const nw_gtpv2c_msg_parser_ie_t * pIe,
+  NW_IN uint8_t ieCount) {
+    NW_ASSERT (thiz);
+    NW_ASSERT (ieCount <= NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM);
+    memset (thiz, 0, sizeof (nw_gtpv2c_msg_parser_template_t));
+    thiz->msgType = msgType;
+    thiz->ieReadCallback = ieReadCallback;
+
+    for (uint8_t i = 0; i < ieCount; i++) {
+      NW_ASSERT (pIe[i].ieInstance < NW_GTPV2C_IE_INSTANCE_MAXIMUM);
+
+      if (thiz->ieIndex[pIe[i].ieType][pIe[i].ieInstance]) {
+        OAILOG_ERROR (LOG_GTPV2C, "Cannot add IE to parser template for type %u and instance %u. IE info already exists!\n", pIe[i].ieType, pIe[i].ieInstance);
+        return NW_FAILURE;
+      }
+
+      thiz->ie[thiz->ieCount] = pIe[i];
+
+      if (pIe[i].iePresence == NW_GTPV2C_IE_PRESENCE_MANDATORY) {
+        thiz->mandatoryIeMask |= (1U << thiz->ieCount);
+      }
+
+      thiz->ieIndex[pIe[i].ieType][pIe[i].ieInstance] = ++thiz->ieCount;
+    }
+
+    return NW_OK;
+  }
+
+  void                                      nwGtpv2cMsgParserWalkStart (
+  NW_IN const nw_gtpv2c_msg_parser_template_t * thiz,
+  NW_IN nw_gtpv2c_msg_handle_t hMsg,
+  NW_OUT nw_gtpv2c_msg_parser_walk_t * pWalk) {
+    uint8_t                                 flags;
+    nw_gtpv2c_msg_t                           *pMsg = (nw_gtpv2c_msg_t *) hMsg;
+
+    NW_ASSERT (pMsg);
+    NW_ASSERT (thiz);
+    memset (pWalk, 0, sizeof (nw_gtpv2c_msg_parser_walk_t));
+    flags = *((uint8_t *) (pMsg->msgBuf));
+    pWalk->pIeStart = (uint8_t *) (pMsg->msgBuf + (flags & 0x08 ? 12 : 8));
+    pWalk->pIeEnd = (uint8_t *) (pMsg->msgBuf + pMsg->msgLen);
+  }
+
+  nw_rc_t                                   nwGtpv2cMsgParserWalkNext (
+  NW_IN const nw_gtpv2c_msg_parser_template_t * thiz,
+  NW_INOUT nw_gtpv2c_msg_parser_walk_t * pWalk,
+  NW_OUT uint8_t * pOffendingIeType,
+  NW_OUT uint8_t * pOffendingIeInstance,
+  NW_OUT uint16_t * pOffendingIeLength) {
+    nw_gtpv2c_ie_tlv_t                         *pIe;
+    uint16_t                                ieLength;
+    uint8_t                                 ieInstance;
+    uint8_t                                 index;
+
+    while (pWalk->pIeStart < pWalk->pIeEnd) {
+      if (pWalk->pIeStart + 4 > pWalk->pIeEnd) {
+        // truncated IE header
+        *pOffendingIeType = 0;
+        *pOffendingIeLength = 0;
+        *pOffendingIeInstance = 0;
+        return NW_GTPV2C_MSG_MALFORMED;
+      }
+
+      pIe = (nw_gtpv2c_ie_tlv_t *) pWalk->pIeStart;
+      ieLength = ntohs (pIe->l);
+      ieInstance = pIe->i & 0x0F;
+
+      if (pWalk->pIeStart + 4 + ieLength > pWalk->pIeEnd) {
+        *pOffendingIeType = pIe->t;
+        *pOffendingIeLength = pIe->l;
+        *pOffendingIeInstance = pIe->i;
+        return NW_GTPV2C_MSG_MALFORMED;
+      }
+
+      index = (ieInstance < NW_GTPV2C_IE_INSTANCE_MAXIMUM) ? thiz->ieIndex[pIe->t][ieInstance] : 0;
+      pWalk->pIeStart += (ieLength + 4);
+
+      if (index) {
+        OAILOG_DEBUG (LOG_GTPV2C,  "Received IE %u of length %u!\n", pIe->t, ieLength);
+        pWalk->ieType = pIe->t;
+        pWalk->ieInstance = ieInstance;
+        pWalk->ieLength = ieLength;
+        pWalk->ieIndex = index - 1;
+        pWalk->pIeValue = ((uint8_t *) pIe) + 4;
+        pWalk->receivedIeMask |= (1U << (index - 1));
+        return NW_OK;
+      }
+
+      OAILOG_WARNING (LOG_GTPV2C,  "Unexpected IE %u of length %u received in msg %u!\n", pIe->t, ieLength, thiz->msgType);
+    }
+
+    pWalk->pIeValue = NULL;
+
+    if ((pWalk->receivedIeMask & thiz->mandatoryIeMask) != thiz->mandatoryIeMask) {
+      index = __builtin_ctz (thiz->mandatoryIeMask & ~pWalk->receivedIeMask);
+      *pOffendingIeType = thiz->ie[index].ieType;
+      *pOffendingIeInstance = thiz->ie[index].ieInstance;
+      *pOffendingIeLength = 0;
+      return NW_GTPV2C_MANDATORY_IE_MISSING;
+    }
+
+    return NW_OK;
+  }
+
+  nw_rc_t                                   nwGtpv2cMsgParserTemplateRun (
+  NW_IN const nw_gtpv2c_msg_parser_template_t * thiz,
+  NW_IN nw_gtpv2c_msg_handle_t hMsg,
+  NW_IN void *pCtx,
+  NW_OUT uint8_t * pOffendingIeType,
+  NW_OUT uint8_t * pOffendingIeInstance,
+  NW_OUT uint16_t * pOffendingIeLength) {
+    nw_rc_t                                   rc = NW_OK;
+    nw_gtpv2c_msg_parser_walk_t               walk;
+
+    nwGtpv2cMsgParserWalkStart (thiz, hMsg, &walk);
+
+    while ((NW_OK == (rc = nwGtpv2cMsgParserWalkNext (thiz, &walk, pOffendingIeType, pOffendingIeInstance, pOffendingIeLength))) && (walk.pIeValue)) {
+      const nw_gtpv2c_msg_parser_ie_t        *pIeInfo = &thiz->ie[walk.ieIndex];
+      void                                   *pArg = (pIeInfo->ieReadCallbackArgOffset == NW_GTPV2C_MSG_PARSER_IE_ARG_NONE) ?
+                                                      NULL : ((uint8_t *) pCtx) + pIeInfo->ieReadCallbackArgOffset;
+
+      if (pIeInfo->ieReadCallback) {
+        rc = pIeInfo->ieReadCallback (walk.ieType, walk.ieLength, walk.ieInstance, walk.pIeValue, pArg);
+      } else if (thiz->ieReadCallback) {
+        rc = thiz->ieReadCallback (walk.ieType, walk.ieLength, walk.ieInstance, walk.pIeValue, pArg);
+      } else {
+        OAILOG_WARNING (LOG_GTPV2C,  "No parse method defined for received IE type %u of length %u in message %u!\n", walk.ieType, walk.ieLength, thiz->msgType);
+      }
+
+      if (NW_OK != rc) {
+        OAILOG_ERROR (LOG_GTPV2C, "Error while parsing IE %u with instance %u and length %u!\n", walk.ieType, walk.ieInstance, walk.ieLength);
+        return rc;
+      }
+    }
+
+    return rc;
+  }
+
 #ifdef __cplusplus
 }
 #endif
@@ -54,8 +54,6 @@
 extern                                  "C" {
 #endif
 
-  static nw_gtpv2c_trxn_t                   *gpGtpv2cTrxnPool = NULL;
-
 /*--------------------------------------------------------------------------*
                      P R I V A T E      F U N C T I O N S
   --------------------------------------------------------------------------*/
@@ -95,8 +93,10 @@ extern                                  "C" {
       ulpApi.apiType = NW_GTPV2C_ULP_API_RSP_FAILURE_IND;
       ulpApi.u_api_info.rspFailureInfo.hUlpTrxn = thiz->hUlpTrxn;
       ulpApi.u_api_info.rspFailureInfo.hUlpTunnel = ((thiz->hTunnel) ? ((nw_gtpv2c_tunnel_t *) (thiz->hTunnel))->hUlpTunnel : 0);
+      ulpApi.u_api_info.rspFailureInfo.msgType = thiz->pMsg->msgType;
+      ulpApi.u_api_info.rspFailureInfo.peerIp = thiz->peerIp;
       OAILOG_ERROR (LOG_GTPV2C, "N3 retries expired for transaction 0x%p\n", thiz);
-      RB_REMOVE (NwGtpv2cOutstandingTxSeqNumTrxnMap, &(pStack->outstandingTxSeqNumMap), thiz);
+      nwGtpv2cMapRemove (&(pStack->outstandingTxSeqNumMap), thiz);
       rc = nwGtpv2cTrxnDelete (&thiz);
       rc = pStack->ulp.ulpReqCallback (pStack->ulp.hUlp, &ulpApi);
     }
@@ -116,7 +116,7 @@ extern                                  "C" {
     NW_ASSERT (pStack);
     OAILOG_DEBUG (LOG_GTPV2C,  "Duplicate request hold timer expired for transaction 0x%p\n", thiz);
     thiz->hRspTmr = 0;
-    RB_REMOVE (NwGtpv2cOutstandingRxSeqNumTrxnMap, &(pStack->outstandingRxSeqNumMap), thiz);
+    nwGtpv2cMapRemove (&(pStack->outstandingRxSeqNumMap), thiz);
     rc = nwGtpv2cTrxnDelete (&thiz);
     NW_ASSERT (NW_OK == rc);
     return rc;
@@ -185,9 +185,9 @@ extern                                  "C" {
   NW_IN nw_gtpv2c_stack_t * thiz) {
     nw_gtpv2c_trxn_t                          *pTrxn;
 
-    if (gpGtpv2cTrxnPool) {
-      pTrxn = gpGtpv2cTrxnPool;
-      gpGtpv2cTrxnPool = gpGtpv2cTrxnPool->next;
+    if (thiz->trxnPool) {
+      pTrxn = thiz->trxnPool;
+      thiz->trxnPool = thiz->trxnPool->next;
     } else {
       NW_GTPV2C_MALLOC (thiz, sizeof (nw_gtpv2c_trxn_t), pTrxn, nw_gtpv2c_trxn_t *);
     }
@@ -223,9 +223,9 @@ extern                                  "C" {
   NW_IN uint32_t seqNum) {
     nw_gtpv2c_trxn_t                          *pTrxn;
 
-    if (gpGtpv2cTrxnPool) {
-      pTrxn = gpGtpv2cTrxnPool;
-      gpGtpv2cTrxnPool = gpGtpv2cTrxnPool->next;
+    if (thiz->trxnPool) {
+      pTrxn = thiz->trxnPool;
+      thiz->trxnPool = thiz->trxnPool->next;
     } else {
       NW_GTPV2C_MALLOC (thiz, sizeof (nw_gtpv2c_trxn_t), pTrxn, nw_gtpv2c_trxn_t *);
     }
@@ -265,9 +265,9 @@ extern                                  "C" {
     nw_gtpv2c_trxn_t                          *pTrxn,
                                            *pCollision;
 
-    if (gpGtpv2cTrxnPool) {
-      pTrxn = gpGtpv2cTrxnPool;
-      gpGtpv2cTrxnPool = gpGtpv2cTrxnPool->next;
+    if (thiz->trxnPool) {
+      pTrxn = thiz->trxnPool;
+      thiz->trxnPool = thiz->trxnPool->next;
     } else {
       NW_GTPV2C_MALLOC (thiz, sizeof (nw_gtpv2c_trxn_t), pTrxn, nw_gtpv2c_trxn_t *);
     }
@@ -281,7 +281,7 @@ extern                                  "C" {
       pTrxn->peerPort = peerPort;
       pTrxn->pMsg = NULL;
       pTrxn->hRspTmr = 0;
-      pCollision = RB_INSERT (NwGtpv2cOutstandingRxSeqNumTrxnMap, &(thiz->outstandingRxSeqNumMap), pTrxn);
+      pCollision = nwGtpv2cMapInsert (&(thiz->outstandingRxSeqNumMap), pTrxn);
 
       if (pCollision) {
         OAILOG_WARNING (LOG_GTPV2C,  "Duplicate request message received for seq num 0x%x!\n", (uint32_t) seqNum);
@@ -334,8 +334,8 @@ extern                                  "C" {
     }
 
     OAILOG_DEBUG (LOG_GTPV2C,  "Purging  transaction 0x%p\n", thiz);
-    thiz->next = gpGtpv2cTrxnPool;
-    gpGtpv2cTrxnPool = thiz;
+    thiz->next = pStack->trxnPool;
+    pStack->trxnPool = thiz;
     *pthiz = NULL;
     return rc;
   }
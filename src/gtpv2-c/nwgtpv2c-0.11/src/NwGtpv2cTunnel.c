@@ -46,7 +46,6 @@
 extern                                  "C" {
 #endif
 
-static nw_gtpv2c_tunnel_t                 *gpGtpv2cTunnelPool = NULL;
 
 //------------------------------------------------------------------------------
 nw_gtpv2c_tunnel_t  *nwGtpv2cTunnelNew (struct nw_gtpv2c_stack_s *pStack,
@@ -56,9 +55,9 @@ nw_gtpv2c_tunnel_t  *nwGtpv2cTunnelNew (struct nw_gtpv2c_stack_s *pStack,
 {
   nw_gtpv2c_tunnel_t                        *thiz;
 
-  if (gpGtpv2cTunnelPool) {
-    thiz = gpGtpv2cTunnelPool;
-    gpGtpv2cTunnelPool = gpGtpv2cTunnelPool->next;
+  if (pStack->tunnelPool) {
+    thiz = pStack->tunnelPool;
+    pStack->tunnelPool = pStack->tunnelPool->next;
   } else {
     NW_GTPV2C_MALLOC (pStack, sizeof (nw_gtpv2c_tunnel_t), thiz, nw_gtpv2c_tunnel_t *);
   }
@@ -73,10 +72,10 @@ nw_gtpv2c_tunnel_t  *nwGtpv2cTunnelNew (struct nw_gtpv2c_stack_s *pStack,
 }
 
 //------------------------------------------------------------------------------
-nw_rc_t nwGtpv2cTunnelDelete (__attribute__ ((unused)) struct nw_gtpv2c_stack_s * pStack, nw_gtpv2c_tunnel_t * thiz)
+nw_rc_t nwGtpv2cTunnelDelete (struct nw_gtpv2c_stack_s * pStack, nw_gtpv2c_tunnel_t * thiz)
 {
-  thiz->next = gpGtpv2cTunnelPool;
-  gpGtpv2cTunnelPool = thiz;
+  thiz->next = pStack->tunnelPool;
+  pStack->tunnelPool = thiz;
   return NW_OK;
 }
 
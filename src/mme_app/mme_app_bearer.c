@@ -498,12 +498,30 @@ mme_app_handle_create_sess_resp (
    */
 
   if (create_sess_resp_pP->cause.cause_value != REQUEST_ACCEPTED) {
+    bearer_id = create_sess_resp_pP->bearer_contexts_created.bearer_contexts[0].eps_bearer_id /* - 5 */ ;
+    current_bearer_p = mme_app_get_bearer_context(ue_context_p, bearer_id);
+
+    if ((REMOTE_PEER_NOT_RESPONDING == create_sess_resp_pP->cause.cause_value) && (current_bearer_p)) {
+      struct in_addr                          sgw_in_addr = {.s_addr = 0};
+
+      /*
+       * The S-GW did not answer: try once more on another S-GW serving the TA, if any is up.
+       * The failed S-GW was reported down before if its path failed, it is not selected again.
+       */
+      mme_app_select_sgw(&ue_context_p->emm_context.originating_tai, &sgw_in_addr);
+      if ((sgw_in_addr.s_addr) && (sgw_in_addr.s_addr != create_sess_resp_pP->peer_ip.s_addr) && (mme_app_sgw_path_is_up(&sgw_in_addr))) {
+        OAILOG_INFO (LOG_MME_APP, "S-GW %s not responding, retrying Create Session Request on S-GW %s for ue_id " MME_UE_S1AP_ID_FMT "\n",
+            inet_ntoa (create_sess_resp_pP->peer_ip), inet_ntoa (sgw_in_addr), ue_context_p->mme_ue_s1ap_id);
+        rc = mme_app_send_s11_create_session_req (ue_context_p, current_bearer_p->pdn_cx_id);
+        unlock_ue_contexts(ue_context_p);
+        OAILOG_FUNC_RETURN (LOG_MME_APP, rc);
+      }
+    }
+
     // Send PDN CONNECTIVITY FAIL message  to NAS layer
     message_p = itti_alloc_new_message (TASK_MME_APP, NAS_PDN_CONNECTIVITY_FAIL);
     itti_nas_pdn_connectivity_fail_t *nas_pdn_connectivity_fail = &message_p->ittiMsg.nas_pdn_connectivity_fail;
     memset ((void *)nas_pdn_connectivity_fail, 0, sizeof (itti_nas_pdn_connectivity_fail_t));
-    bearer_id = create_sess_resp_pP->bearer_contexts_created.bearer_contexts[0].eps_bearer_id /* - 5 */ ;
-    current_bearer_p = mme_app_get_bearer_context(ue_context_p, bearer_id);
     if (current_bearer_p) {
       transaction_identifier = current_bearer_p->transaction_identifier;
     }
@@ -543,6 +561,11 @@ mme_app_handle_create_sess_resp (
        */
       AssertFatal((pdn_cx_id >= 0) && (pdn_cx_id < MAX_APN_PER_UE), "Bad pdn id for bearer");
       ue_context_p->pdn_contexts[pdn_cx_id]->s_gw_teid_s11_s4 = create_sess_resp_pP->s11_sgw_fteid.teid;
+      if (create_sess_resp_pP->s11_sgw_fteid.ipv4) {
+        // the S-GW selected at the time of the request, later S11 requests go there
+        ue_context_p->pdn_contexts[pdn_cx_id]->s_gw_address_s11_s4.pdn_type = IPv4;
+        ue_context_p->pdn_contexts[pdn_cx_id]->s_gw_address_s11_s4.address.ipv4_address = create_sess_resp_pP->s11_sgw_fteid.ipv4_address;
+      }
       transaction_identifier = current_bearer_p->transaction_identifier;
     }
 
@@ -1112,12 +1112,15 @@ mme_app_handle_s1ap_ue_context_release_req (
 //------------------------------------------------------------------------------
 void
 mme_app_handle_enb_deregister_ind(const itti_s1ap_eNB_deregistered_ind_t const * eNB_deregistered_ind) {
+  // All UEs of the eNB are released at once, group their S11 Release Access Bearers Requests
+  mme_app_s11_release_access_bearers_batch_start ();
   for (int i = 0; i < eNB_deregistered_ind->nb_ue_to_deregister; i++) {
     _mme_app_handle_s1ap_ue_context_release(eNB_deregistered_ind->mme_ue_s1ap_id[i],
                                             eNB_deregistered_ind->enb_ue_s1ap_id[i],
                                             eNB_deregistered_ind->enb_id,
                                             S1AP_SCTP_SHUTDOWN_OR_RESET);
   }
+  mme_app_s11_release_access_bearers_batch_flush ();
 } 
 
 //------------------------------------------------------------------------------
@@ -1128,6 +1131,7 @@ mme_app_handle_enb_reset_req (const itti_s1ap_enb_initiated_reset_req_t const *
   MessageDef *message_p;
   OAILOG_DEBUG (LOG_MME_APP, " eNB Reset request received. eNB id = %d, reset_type  %d \n ", enb_reset_req->enb_id, enb_reset_req->s1ap_reset_type); 
   DevAssert (enb_reset_req->ue_to_reset_list != NULL);
+  mme_app_s11_release_access_bearers_batch_start ();
   if (enb_reset_req->s1ap_reset_type == RESET_ALL) {
   // Full Reset. Trigger UE Context release release for all the connected UEs.
     for (int i = 0; i < enb_reset_req->num_ue; i++) {
@@ -1150,6 +1154,7 @@ mme_app_handle_enb_reset_req (const itti_s1ap_enb_initiated_reset_req_t const *
     } 
       
   }
+  mme_app_s11_release_access_bearers_batch_flush ();
   // Send Reset Ack to S1AP module
 
   message_p = itti_alloc_new_message (TASK_MME_APP, S1AP_ENB_INITIATED_RESET_ACK);
@@ -45,30 +45,45 @@
 static obj_hash_table_t * g_e_dns_entries = NULL;
 
 //------------------------------------------------------------------------------
-struct in_addr* mme_app_edns_get_sgw_entry(bstring id)
+const mme_app_edns_sgw_entry_t* mme_app_edns_get_sgw_entry(bstring id)
 {
-  struct in_addr *in_addr = NULL;
+  mme_app_edns_sgw_entry_t *entry = NULL;
   obj_hashtable_get (g_e_dns_entries, bdata(id), blength(id),
-    (void **)&in_addr);
+    (void **)&entry);
 
-  return in_addr;
+  return entry;
 }
 
 
 //------------------------------------------------------------------------------
 int mme_app_edns_add_sgw_entry(bstring id, struct in_addr in_addr)
 {
+  mme_app_edns_sgw_entry_t *entry = NULL;
+
+  // several S-GWs may serve the same TAs
+  obj_hashtable_get (g_e_dns_entries, bdata(id), blength(id), (void **)&entry);
+  if (entry) {
+    if (MME_CONFIG_MAX_SGW > entry->nb_addr) {
+      entry->addr[entry->nb_addr++].s_addr = in_addr.s_addr;
+      return RETURNok;
+    }
+    return RETURNerror;
+  }
+
   char * cid = calloc(1, blength(id)+1);
   if (cid) {
     strncpy(cid, (const char *)id->data, blength(id));
 
-    struct in_addr *data = malloc(sizeof(struct in_addr));
-    if (data) {
-      data->s_addr = in_addr.s_addr;
+    entry = calloc(1, sizeof(mme_app_edns_sgw_entry_t));
+    if (entry) {
+      entry->addr[0].s_addr = in_addr.s_addr;
+      entry->nb_addr = 1;
 
-      hashtable_rc_t rc = obj_hashtable_insert (g_e_dns_entries, cid, strlen(cid), data);
+      hashtable_rc_t rc = obj_hashtable_insert (g_e_dns_entries, cid, strlen(cid), entry);
       if (HASH_TABLE_OK == rc) return RETURNok;
+      free_wrapper((void**)&entry);
     }
+    free_wrapper((void**)&cid);
   }
   return RETURNerror;
 }
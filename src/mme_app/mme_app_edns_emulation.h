@@ -30,7 +30,12 @@
   \email: lionel.gauthier@eurecom.fr
 */
 
-struct in_addr* mme_app_edns_get_sgw_entry(bstring id);
+typedef struct mme_app_edns_sgw_entry_s {
+  int            nb_addr;
+  struct in_addr addr[MME_CONFIG_MAX_SGW];  ///< in configuration order
+} mme_app_edns_sgw_entry_t;
+
+const mme_app_edns_sgw_entry_t* mme_app_edns_get_sgw_entry(bstring id);
 int mme_app_edns_add_sgw_entry(bstring id, struct in_addr in_addr);
 int  mme_app_edns_init (const mme_config_t * mme_config_p);
 void  mme_app_edns_exit (void);
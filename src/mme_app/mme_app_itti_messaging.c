@@ -73,6 +73,31 @@ void mme_app_itti_ue_context_release(struct ue_mm_context_s *ue_context_p, enum
   OAILOG_FUNC_OUT (LOG_MME_APP);
 }
 
+// Release Access Bearers Requests being gathered for an eNB-wide release, MME_APP task only
+static MessageDef                        *mme_app_rab_batch_p = NULL;
+static bool                               mme_app_rab_batching = false;
+
+//------------------------------------------------------------------------------
+void mme_app_s11_release_access_bearers_batch_start (void)
+{
+  mme_app_rab_batching = true;
+}
+
+//------------------------------------------------------------------------------
+int mme_app_s11_release_access_bearers_batch_flush (void)
+{
+  int                                     rc = RETURNok;
+
+  if (mme_app_rab_batch_p) {
+    MSC_LOG_TX_MESSAGE (MSC_MMEAPP_MME, MSC_S11_MME, NULL, 0, "0 S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH %u requests",
+                        S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (mme_app_rab_batch_p).nb_requests);
+    rc = itti_send_msg_to_task (TASK_S11, INSTANCE_DEFAULT, mme_app_rab_batch_p);
+    mme_app_rab_batch_p = NULL;
+  }
+  mme_app_rab_batching = false;
+  return rc;
+}
+
 //------------------------------------------------------------------------------
 int mme_app_send_s11_release_access_bearers_req (struct ue_mm_context_s *const ue_mm_context, const pdn_cid_t pdn_index)
 {
@@ -85,8 +110,18 @@ int mme_app_send_s11_release_access_bearers_req (struct ue_mm_context_s *const u
   int                                     rc = RETURNok;
 
   DevAssert (ue_mm_context );
-  message_p = itti_alloc_new_message (TASK_MME_APP, S11_RELEASE_ACCESS_BEARERS_REQUEST);
-  release_access_bearers_request_p = &message_p->ittiMsg.s11_release_access_bearers_request;
+  if (mme_app_rab_batching) {
+    if (!mme_app_rab_batch_p) {
+      mme_app_rab_batch_p = itti_alloc_new_message (TASK_MME_APP, S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH);
+      S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (mme_app_rab_batch_p).nb_requests = 0;
+    }
+    itti_s11_release_access_bearers_request_batch_t *batch_p = &S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (mme_app_rab_batch_p);
+    release_access_bearers_request_p = &batch_p->request[batch_p->nb_requests++];
+    memset (release_access_bearers_request_p, 0, sizeof (*release_access_bearers_request_p));
+  } else {
+    message_p = itti_alloc_new_message (TASK_MME_APP, S11_RELEASE_ACCESS_BEARERS_REQUEST);
+    release_access_bearers_request_p = &message_p->ittiMsg.s11_release_access_bearers_request;
+  }
   release_access_bearers_request_p->local_teid = ue_mm_context->mme_teid_s11;
   pdn_context_t * pdn_connection = ue_mm_context->pdn_contexts[pdn_index];
   release_access_bearers_request_p->teid = pdn_connection->s_gw_teid_s11_s4;
@@ -94,6 +129,13 @@ int mme_app_send_s11_release_access_bearers_req (struct ue_mm_context_s *const u
 
   release_access_bearers_request_p->originating_node = NODE_TYPE_MME;
 
+  if (!message_p) {
+    if (S11_RELEASE_ACCESS_BEARERS_BATCH_MAX == S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (mme_app_rab_batch_p).nb_requests) {
+      rc = mme_app_s11_release_access_bearers_batch_flush ();
+      mme_app_rab_batching = true;
+    }
+    OAILOG_FUNC_RETURN (LOG_MME_APP, rc);
+  }
 
   MSC_LOG_TX_MESSAGE (MSC_MMEAPP_MME, MSC_S11_MME, NULL, 0, "0 S11_RELEASE_ACCESS_BEARERS_REQUEST teid %u", release_access_bearers_request_p->teid);
   rc = itti_send_msg_to_task (TASK_S11, INSTANCE_DEFAULT, message_p);
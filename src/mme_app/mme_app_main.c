@@ -50,6 +50,7 @@
 #include "mme_app_statistics.h"
 #include "common_defs.h"
 #include "mme_app_edns_emulation.h"
+#include "mme_app_sgw_selection.h"
 #include "nas_proc.h"
 
 mme_app_desc_t                          mme_app_desc = {.rw_lock = PTHREAD_RWLOCK_INITIALIZER, 0} ;
@@ -181,6 +182,11 @@ void *mme_app_thread (void *args)
       }
       break;
 
+    case S11_PATH_STATE_IND:{
+        mme_app_handle_s11_path_state_ind (&received_message_p->ittiMsg.s11_path_state_ind);
+      }
+      break;
+
     case S1AP_E_RAB_SETUP_RSP:{
         mme_app_handle_e_rab_setup_rsp (&S1AP_E_RAB_SETUP_RSP (received_message_p));
       }
@@ -36,13 +36,92 @@
 #include "bstrlib.h"
 
 #include "log.h"
+#include "assertions.h"
 #include "common_defs.h"
+#include "common_types.h"
 #include "dynamic_memory_check.h"
 #include "TrackingAreaIdentity.h"
 #include "mme_config.h"
+#include "intertask_interface.h"
+#include "mme_app_ue_context.h"
+#include "mme_app_defs.h"
 #include "mme_app_sgw_selection.h"
 #include "mme_app_edns_emulation.h"
 
+/*
+ * S-GWs reported down by S11 path management, MME_APP task only.
+ */
+static struct in_addr                   mme_app_sgw_down[MME_CONFIG_MAX_SGW];
+static int                              mme_app_nb_sgw_down = 0;
+
+//------------------------------------------------------------------------------
+bool mme_app_sgw_path_is_up(const struct in_addr * const sgw_in_addr)
+{
+  for (int i = 0; i < mme_app_nb_sgw_down; i++) {
+    if (mme_app_sgw_down[i].s_addr == sgw_in_addr->s_addr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool mme_app_sgw_restarted_detach_ue(
+  const hash_key_t keyP,
+  void *const ue_mm_context_pP,
+  void *sgw_in_addr_pP,
+  void** unused_result_pP)
+{
+  struct ue_mm_context_s           *const ue_mm_context = (struct ue_mm_context_s *)ue_mm_context_pP;
+  const struct in_addr             *const sgw_in_addr = (const struct in_addr *)sgw_in_addr_pP;
+  MessageDef                             *message_p = NULL;
+
+  if (!ue_mm_context) {
+    return false;
+  }
+  for (pdn_cid_t pdn_cid = 0; pdn_cid < MAX_APN_PER_UE; pdn_cid++) {
+    pdn_context_t         *pdn_context = ue_mm_context->pdn_contexts[pdn_cid];
+    if ((pdn_context) && (pdn_context->s_gw_address_s11_s4.address.ipv4_address.s_addr == sgw_in_addr->s_addr)) {
+      // The S-GW lost the sessions, the UE is detached and will re-attach (3GPP TS 23.007, 16.1.1)
+      OAILOG_INFO (LOG_MME_APP, "Implicit detach of UE " MME_UE_S1AP_ID_FMT ", its S-GW restarted\n", ue_mm_context->mme_ue_s1ap_id);
+      message_p = itti_alloc_new_message (TASK_MME_APP, NAS_IMPLICIT_DETACH_UE_IND);
+      DevAssert (message_p != NULL);
+      message_p->ittiMsg.nas_implicit_detach_ue_ind.ue_id = ue_mm_context->mme_ue_s1ap_id;
+      itti_send_msg_to_task (TASK_NAS_MME, INSTANCE_DEFAULT, message_p);
+      break;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void mme_app_handle_s11_path_state_ind(const itti_s11_path_state_ind_t * const ind)
+{
+  int i = 0;
+
+  for (i = 0; i < mme_app_nb_sgw_down; i++) {
+    if (mme_app_sgw_down[i].s_addr == ind->peer_ip.s_addr) {
+      break;
+    }
+  }
+  if (ind->path_up) {
+    if (i < mme_app_nb_sgw_down) {
+      mme_app_sgw_down[i] = mme_app_sgw_down[--mme_app_nb_sgw_down];
+    }
+    OAILOG_INFO (LOG_MME_APP, "S-GW %s available\n", inet_ntoa (ind->peer_ip));
+  } else {
+    if ((i == mme_app_nb_sgw_down) && (MME_CONFIG_MAX_SGW > mme_app_nb_sgw_down)) {
+      mme_app_sgw_down[mme_app_nb_sgw_down++] = ind->peer_ip;
+    }
+    OAILOG_WARNING (LOG_MME_APP, "S-GW %s not available anymore\n", inet_ntoa (ind->peer_ip));
+  }
+  if (ind->peer_restarted) {
+    OAILOG_WARNING (LOG_MME_APP, "S-GW %s restarted, releasing its PDN connections\n", inet_ntoa (ind->peer_ip));
+    hashtable_ts_apply_callback_on_elements (mme_app_desc.mme_ue_contexts.mme_ue_s1ap_id_ue_context_htbl,
+        mme_app_sgw_restarted_detach_ue, (void *)&ind->peer_ip, NULL);
+  }
+}
+
 //------------------------------------------------------------------------------
 void mme_app_select_sgw(const tai_t * const tai, struct in_addr * const sgw_in_addr)
 {
@@ -88,10 +167,17 @@ void mme_app_select_sgw(const tai_t * const tai, struct in_addr * const sgw_in_a
   }
   bcatcstr(application_unique_string, ".3gppnetwork.org");
 
-  struct in_addr* entry = mme_app_edns_get_sgw_entry(application_unique_string);
+  const mme_app_edns_sgw_entry_t* entry = mme_app_edns_get_sgw_entry(application_unique_string);
 
   if (entry) {
-    sgw_in_addr->s_addr = entry->s_addr;
+    // first S-GW with a path up, or the first one if none
+    sgw_in_addr->s_addr = entry->addr[0].s_addr;
+    for (int i = 0; i < entry->nb_addr; i++) {
+      if (mme_app_sgw_path_is_up(&entry->addr[i])) {
+        sgw_in_addr->s_addr = entry->addr[i].s_addr;
+        break;
+      }
+    }
   }
   OAILOG_DEBUG (LOG_MME_APP, "SGW lookup %s returned %s\n", application_unique_string->data, inet_ntoa (*sgw_in_addr));
   bdestroy_wrapper(&application_unique_string);
@@ -32,4 +32,8 @@
 
 void mme_app_select_sgw(const tai_t * const tai, struct in_addr * const sgw_in_addr);
 
+bool mme_app_sgw_path_is_up(const struct in_addr * const sgw_in_addr);
+
+void mme_app_handle_s11_path_state_ind(const itti_s11_path_state_ind_t * const ind);
+
 #endif
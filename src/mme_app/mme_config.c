@@ -145,6 +145,7 @@ static void mme_config_init (mme_config_t * config_pP)
   config_pP->ipv4.if_name_s11 = NULL;
   config_pP->ipv4.s11.s_addr = INADDR_ANY;
   config_pP->ipv4.port_s11 = 2123;
+  config_pP->s11_config.echo_interval_sec = S11_ECHO_INTERVAL_DEFAULT;
   config_pP->s6a_config.conf_file = bfromcstr(S6A_CONF_FILE);
   config_pP->itti_config.queue_size = ITTI_QUEUE_MAX_ELEMENTS;
   config_pP->itti_config.log_file = NULL;
@@ -188,6 +189,10 @@ static void mme_config_init (mme_config_t * config_pP)
   config_pP->served_tai.plmn_mnc_len[0] = PLMN_MNC_LEN;
   config_pP->served_tai.tac[0] = PLMN_TAC;
   config_pP->s1ap_config.outcome_drop_timer_sec = S1AP_OUTCOME_TIMER_DEFAULT;
+  config_pP->s1ap_config.overload_max_pending = S1AP_OVERLOAD_MAX_PENDING_DEFAULT;
+  config_pP->s1ap_config.overload_initial_ue_max_pending = S1AP_OVERLOAD_INITIAL_UE_MAX_PENDING_DEFAULT;
+  config_pP->s1ap_config.overload_start_latency_ms = S1AP_OVERLOAD_START_LATENCY_DEFAULT;
+  config_pP->s1ap_config.overload_stop_latency_ms = S1AP_OVERLOAD_STOP_LATENCY_DEFAULT;
 }
 
 //------------------------------------------------------------------------------
@@ -455,6 +460,22 @@ static int mme_config_parse_file (mme_config_t * config_pP)
       if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S1AP_PORT, &aint))) {
         config_pP->s1ap_config.port_number = (uint16_t) aint;
       }
+
+      if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S1AP_OVERLOAD_MAX_PENDING, &aint))) {
+        config_pP->s1ap_config.overload_max_pending = (uint32_t) aint;
+      }
+
+      if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S1AP_OVERLOAD_INITIAL_UE_MAX_PENDING, &aint))) {
+        config_pP->s1ap_config.overload_initial_ue_max_pending = (uint32_t) aint;
+      }
+
+      if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S1AP_OVERLOAD_START_LATENCY, &aint))) {
+        config_pP->s1ap_config.overload_start_latency_ms = (uint32_t) aint;
+      }
+
+      if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S1AP_OVERLOAD_STOP_LATENCY, &aint))) {
+        config_pP->s1ap_config.overload_stop_latency_ms = (uint32_t) aint;
+      }
     }
     // TAI list setting
     setting = config_setting_get_member (setting_mme, MME_CONFIG_STRING_TAI_LIST);
@@ -644,6 +665,14 @@ static int mme_config_parse_file (mme_config_t * config_pP)
                        inet_ntoa (in_addr_var), config_pP->ipv4.netmask_s11, bdata(config_pP->ipv4.if_name_s11));
       }
     }
+    // S11 SETTING
+    setting = config_setting_get_member (setting_mme, MME_CONFIG_STRING_S11_CONFIG);
+
+    if (setting != NULL) {
+      if ((config_setting_lookup_int (setting, MME_CONFIG_STRING_S11_ECHO_INTERVAL, &aint))) {
+        config_pP->s11_config.echo_interval_sec = (uint32_t) aint;
+      }
+    }
     // NAS SETTING
     setting = config_setting_get_member (setting_mme, MME_CONFIG_STRING_NAS_CONFIG);
 
@@ -826,12 +855,18 @@ static void mme_config_display (mme_config_t * config_pP)
   OAILOG_INFO (LOG_CONFIG, "- Statistics timer .....................: %u (seconds)\n\n", config_pP->mme_statistic_timer);
   OAILOG_INFO (LOG_CONFIG, "- S1-MME:\n");
   OAILOG_INFO (LOG_CONFIG, "    port number ......: %d\n", config_pP->s1ap_config.port_number);
+  OAILOG_INFO (LOG_CONFIG, "    overload queue ...: %u PDUs (InitialUEMessage %u PDUs)\n",
+      config_pP->s1ap_config.overload_max_pending, config_pP->s1ap_config.overload_initial_ue_max_pending);
+  OAILOG_INFO (LOG_CONFIG, "    overload latency .: start %u ms stop %u ms\n",
+      config_pP->s1ap_config.overload_start_latency_ms, config_pP->s1ap_config.overload_stop_latency_ms);
   OAILOG_INFO (LOG_CONFIG, "- IP:\n");
   OAILOG_INFO (LOG_CONFIG, "    s1-MME iface .....: %s\n", bdata(config_pP->ipv4.if_name_s1_mme));
   OAILOG_INFO (LOG_CONFIG, "    s1-MME ip ........: %s\n", inet_ntoa (*((struct in_addr *)&config_pP->ipv4.s1_mme)));
   OAILOG_INFO (LOG_CONFIG, "    s11 MME iface ....: %s\n", bdata(config_pP->ipv4.if_name_s11));
   OAILOG_INFO (LOG_CONFIG, "    s11 MME port .....: %d\n", config_pP->ipv4.port_s11);
   OAILOG_INFO (LOG_CONFIG, "    s11 MME ip .......: %s\n", inet_ntoa (*((struct in_addr *)&config_pP->ipv4.s11)));
+  OAILOG_INFO (LOG_CONFIG, "- S11:\n");
+  OAILOG_INFO (LOG_CONFIG, "    echo interval ....: %u (seconds)\n", config_pP->s11_config.echo_interval_sec);
   OAILOG_INFO (LOG_CONFIG, "- ITTI:\n");
   OAILOG_INFO (LOG_CONFIG, "    queue size .......: %u (bytes)\n", config_pP->itti_config.queue_size);
   OAILOG_INFO (LOG_CONFIG, "    log file .........: %s\n", bdata(config_pP->itti_config.log_file));
@@ -79,6 +79,10 @@
 #define MME_CONFIG_STRING_S1AP_CONFIG                    "S1AP"
 #define MME_CONFIG_STRING_S1AP_OUTCOME_TIMER             "S1AP_OUTCOME_TIMER"
 #define MME_CONFIG_STRING_S1AP_PORT                      "S1AP_PORT"
+#define MME_CONFIG_STRING_S1AP_OVERLOAD_MAX_PENDING      "S1AP_OVERLOAD_MAX_PENDING"
+#define MME_CONFIG_STRING_S1AP_OVERLOAD_INITIAL_UE_MAX_PENDING "S1AP_OVERLOAD_INITIAL_UE_MAX_PENDING"
+#define MME_CONFIG_STRING_S1AP_OVERLOAD_START_LATENCY    "S1AP_OVERLOAD_START_LATENCY"
+#define MME_CONFIG_STRING_S1AP_OVERLOAD_STOP_LATENCY     "S1AP_OVERLOAD_STOP_LATENCY"
 
 #define MME_CONFIG_STRING_GUMMEI_LIST                    "GUMMEI_LIST"
 #define MME_CONFIG_STRING_MME_CODE                       "MME_CODE"
@@ -95,6 +99,9 @@
 #define MME_CONFIG_STRING_IPV4_ADDRESS_FOR_S11_MME       "MME_IPV4_ADDRESS_FOR_S11_MME"
 #define MME_CONFIG_STRING_MME_PORT_FOR_S11               "MME_PORT_FOR_S11_MME"
 
+#define MME_CONFIG_STRING_S11_CONFIG                     "S11"
+#define MME_CONFIG_STRING_S11_ECHO_INTERVAL              "S11_ECHO_INTERVAL"
+
 
 #define MME_CONFIG_STRING_NAS_CONFIG                     "NAS"
 #define MME_CONFIG_STRING_NAS_SUPPORTED_INTEGRITY_ALGORITHM_LIST  "ORDERED_SUPPORTED_INTEGRITY_ALGORITHM_LIST"
@@ -174,6 +181,10 @@ typedef struct mme_config_s {
   struct {
     uint16_t port_number;
     uint8_t  outcome_drop_timer_sec;
+    uint32_t overload_max_pending;
+    uint32_t overload_initial_ue_max_pending;
+    uint32_t overload_start_latency_ms;
+    uint32_t overload_stop_latency_ms;
   } s1ap_config;
 
   struct {
@@ -188,6 +199,10 @@ typedef struct mme_config_s {
 
   } ipv4;
 
+  struct {
+    uint32_t echo_interval_sec;
+  } s11_config;
+
   struct {
     bstring conf_file;
     bstring hss_host_name;
@@ -29,8 +29,11 @@
 #include <errno.h>
 #include <error.h>
 #include <inttypes.h>
+#include <semaphore.h>
 
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
 
 #include "hss_config.h"
 #include "db_proto.h"
@@ -45,6 +48,65 @@ extern void                             ComputeOPc (
 
 database_t                             *db_desc;
 
+/*
+ * Key, OPc and RAND stored by the last reservation of an IMSI, direct mapped
+ * on the IMSI. A resync needs them to derive SQN_MS before the reservation.
+ */
+#define HSS_DB_AIR_CACHE_SIZE (4096)
+
+typedef struct hss_db_air_cache_entry_s {
+  volatile int lock;
+  char         imsi[IMSI_LENGTH_MAX + 1];
+  uint8_t      key[KEY_LENGTH];
+  uint8_t      opc[KEY_LENGTH];
+  uint8_t      rand[RAND_LENGTH];
+} hss_db_air_cache_entry_t;
+
+static hss_db_air_cache_entry_t         hss_db_air_cache[HSS_DB_AIR_CACHE_SIZE];
+
+/*
+ * Prepared once per connection of the pool, in the order of hss_db_stmt_id_t.
+ * The serving MME is joined to the user so that a request runs on a single
+ * connection.
+ */
+static const char                      *hss_db_stmt_queries[HSS_DB_STMT_MAX] = {
+  [HSS_DB_STMT_GET_USER] = "SELECT `imsi` FROM `users` WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_AUTH_INFO] = "SELECT `key`,`sqn`,`rand`,`OPc` FROM `users` WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_PUSH_RAND_SQN] = "UPDATE `users` SET `rand`=?,`sqn`=? WHERE `users`.`imsi`=?",
+  /*
+   * + 32 = 2 ^ sizeof(IND) (see 3GPP TS. 33.102)
+   */
+  [HSS_DB_STMT_INCREMENT_SQN] = "UPDATE `users` SET `sqn`=`sqn`+32 WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_UPDATE_LOC] = "SELECT `access_restriction`,`mmeidentity_idmmeidentity`,`msisdn`,`ue_ambr_ul`,`ue_ambr_dl`,`rau_tau_timer`,"
+    "`mmeidentity`.`idmmeidentity`,`mmeidentity`.`mmehost`,`mmeidentity`.`mmerealm` FROM `users` "
+    "LEFT JOIN `mmeidentity` ON `mmeidentity`.`idmmeidentity`=`users`.`mmeidentity_idmmeidentity` WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_PUSH_MME_IDENTITY] = "INSERT INTO `mmeidentity` (`mmehost`,`mmerealm`) SELECT ?,? FROM `mmeidentity` WHERE NOT "
+    "EXISTS (SELECT * FROM `mmeidentity` WHERE `mmehost`=? AND `mmerealm`=?) LIMIT 1",
+  [HSS_DB_STMT_PUSH_UP_LOC] = "UPDATE `users`,`mmeidentity` SET `imei`=COALESCE(?,`imei`),`imei_sv`=COALESCE(?,`imei_sv`),"
+    "`users`.`mmeidentity_idmmeidentity`=`mmeidentity`.`idmmeidentity`,`users`.`ms_ps_status`=\"NOT_PURGED\" "
+    "WHERE `users`.`imsi`=? AND `mmeidentity`.`mmehost`=? AND `mmeidentity`.`mmerealm`=?",
+  [HSS_DB_STMT_PUSH_UP_LOC_NO_MME] = "UPDATE `users` SET `imei`=COALESCE(?,`imei`),`imei_sv`=COALESCE(?,`imei_sv`) WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_PURGE_UE] = "UPDATE `users` SET `users`.`ms_ps_status`=\"PURGED\" WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_SERVING_MME] = "SELECT `users`.`mmeidentity_idmmeidentity`,`mmeidentity`.`idmmeidentity`,`mmeidentity`.`mmehost`,"
+    "`mmeidentity`.`mmerealm` FROM `users` LEFT JOIN `mmeidentity` ON `mmeidentity`.`idmmeidentity`=`users`.`mmeidentity_idmmeidentity` "
+    "WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_QUERY_MME_IDENTITY] = "SELECT `mmehost`,`mmerealm` FROM `mmeidentity` WHERE `mmeidentity`.`idmmeidentity`=?",
+  [HSS_DB_STMT_CHECK_EPC_EQUIPMENT] = "SELECT `idmmeidentity` FROM `mmeidentity` WHERE `mmeidentity`.`mmehost`=?",
+  [HSS_DB_STMT_QUERY_PDNS] = "SELECT `apn`,`pdn_type`,`pdn_ipv4`,`pdn_ipv6`,`aggregate_ambr_ul`,`aggregate_ambr_dl`,`qci`,"
+    "`priority_level`,`pre_emp_cap`,`pre_emp_vul` FROM `pdn` WHERE `pdn`.`users_imsi`=? LIMIT 10",
+  [HSS_DB_STMT_UPDATE_OPC] = "UPDATE `users` SET `OPc`=? WHERE `users`.`imsi`=?",
+  [HSS_DB_STMT_AIR_RESERVE] = "CALL `hss_air_reserve_sqn`(?,?,?,?)",
+  /*
+   * LAST_INSERT_ID(expr) hands the SQN before the update back to the client,
+   * the reservation is atomic without a transaction
+   */
+  [HSS_DB_STMT_RESERVE_SQN] = "UPDATE `users` SET `sqn`=LAST_INSERT_ID(COALESCE(?+32,`sqn`))+32*?,`rand`=? WHERE `users`.`imsi`=?",
+};
+
+/* Where the thread looks first for a free connection, the last one it used */
+static __thread int                     conn_hint = -1;
+static int                              conn_next_hint = 0;
+
 static void
 print_buffer (
   const char *prefix,
@@ -62,11 +124,81 @@ print_buffer (
   fprintf (stdout, "\n");
 }
 
+//------------------------------------------------------------------------------
+static void
+hss_mysql_conn_close (
+  hss_db_conn_t * conn)
+{
+  int                                     i;
+
+  for (i = 0; i < HSS_DB_STMT_MAX; i++) {
+    if (conn->stmts[i]) {
+      mysql_stmt_close (conn->stmts[i]);
+      conn->stmts[i] = NULL;
+    }
+  }
+
+  if (conn->db_conn) {
+    mysql_close (conn->db_conn);
+    conn->db_conn = NULL;
+  }
+}
+
+//------------------------------------------------------------------------------
+static int
+hss_mysql_conn_open (
+  hss_db_conn_t * conn)
+{
+  int                                     i;
+
+  hss_mysql_conn_close (conn);
+
+  if ((conn->db_conn = mysql_init (NULL)) == NULL) {
+    FPRINTF_ERROR ("An error occured on mysql_init\n");
+    return ENOMEM;
+  }
+
+  /*
+   * Try to connect to database
+   */
+  if (!mysql_real_connect (conn->db_conn, db_desc->server, db_desc->user, db_desc->password, db_desc->database, 0, NULL, CLIENT_MULTI_RESULTS)) {
+    FPRINTF_ERROR ("An error occured while connecting to db: %s\n", mysql_error (conn->db_conn));
+    hss_mysql_conn_close (conn);
+    return EINVAL;
+  }
+
+  for (i = 0; i < HSS_DB_STMT_MAX; i++) {
+    if ((conn->stmts[i] = mysql_stmt_init (conn->db_conn)) == NULL) {
+      FPRINTF_ERROR ("An error occured on mysql_stmt_init\n");
+      hss_mysql_conn_close (conn);
+      return ENOMEM;
+    }
+
+    if (mysql_stmt_prepare (conn->stmts[i], hss_db_stmt_queries[i], strlen (hss_db_stmt_queries[i]))) {
+      if (i == HSS_DB_STMT_AIR_RESERVE) {
+        /*
+         * Database created before the procedure, AIR takes two round trips
+         */
+        FPRINTF_NOTICE ("%s, AIR falls back to %s\n", mysql_stmt_error (conn->stmts[i]), hss_db_stmt_queries[HSS_DB_STMT_RESERVE_SQN]);
+        mysql_stmt_close (conn->stmts[i]);
+        conn->stmts[i] = NULL;
+        continue;
+      }
+
+      FPRINTF_ERROR ("Statement preparation failed: %s\n%s\n", mysql_stmt_error (conn->stmts[i]), hss_db_stmt_queries[i]);
+      hss_mysql_conn_close (conn);
+      return EINVAL;
+    }
+  }
+
+  return 0;
+}
+
 int
 hss_mysql_connect (
   const hss_config_t * hss_config_p)
 {
-  const int                               mysql_reconnect_val = 1;
+  int                                     i;
 
   if ((hss_config_p->mysql_server == NULL) || (hss_config_p->mysql_user == NULL) || (hss_config_p->mysql_password == NULL) || (hss_config_p->mysql_database == NULL)) {
     FPRINTF_ERROR ( "An empty name is not allowed\n");
@@ -74,14 +206,13 @@ hss_mysql_connect (
   }
 
   FPRINTF_DEBUG ("Initializing db layer\n");
-  db_desc = malloc (sizeof (database_t));
+  db_desc = calloc (1, sizeof (database_t));
 
   if (db_desc == NULL) {
     FPRINTF_DEBUG ("An error occured on MALLOC\n");
     return errno;
   }
 
-  pthread_mutex_init (&db_desc->db_cs_mutex, NULL);
   /*
    * Copy database configuration from static hss config
    */
@@ -89,26 +220,34 @@ hss_mysql_connect (
   db_desc->user = strdup (hss_config_p->mysql_user);
   db_desc->password = strdup (hss_config_p->mysql_password);
   db_desc->database = strdup (hss_config_p->mysql_database);
-  /*
-   * Init mySQL client
-   */
-  db_desc->db_conn = mysql_init (NULL);
-  mysql_options (db_desc->db_conn, MYSQL_OPT_RECONNECT, &mysql_reconnect_val);
+  db_desc->nb_conns = (hss_config_p->mysql_pool_size > 0) ? hss_config_p->mysql_pool_size : HSS_MYSQL_POOL_SIZE_DEFAULT;
+  sem_init (&db_desc->free_conns, 0, 0);
 
   /*
-   * Try to connect to database
+   * Init mySQL client, before any thread can call mysql_init
    */
-  if (!mysql_real_connect (db_desc->db_conn, db_desc->server, db_desc->user, db_desc->password, db_desc->database, 0, NULL, 0)) {
-    FPRINTF_ERROR ("An error occured while connecting to db: %s\n", mysql_error (db_desc->db_conn));
-    mysql_thread_end();
+  if (mysql_library_init (0, NULL, NULL)) {
+    FPRINTF_ERROR ("An error occured on mysql_library_init\n");
+    hss_mysql_disconnect ();
     return -1;
   }
 
-  /*
-   * Set the multi statement ON
-   */
-  mysql_set_server_option (db_desc->db_conn, MYSQL_OPTION_MULTI_STATEMENTS_ON);
-  FPRINTF_DEBUG ("Initializing db layer: DONE\n");
+  if ((db_desc->conns = calloc (db_desc->nb_conns, sizeof (hss_db_conn_t))) == NULL) {
+    FPRINTF_DEBUG ("An error occured on MALLOC\n");
+    hss_mysql_disconnect ();
+    return ENOMEM;
+  }
+
+  for (i = 0; i < db_desc->nb_conns; i++) {
+    if (hss_mysql_conn_open (&db_desc->conns[i]) != 0) {
+      hss_mysql_disconnect ();
+      return -1;
+    }
+
+    sem_post (&db_desc->free_conns);
+  }
+
+  FPRINTF_DEBUG ("Initializing db layer: DONE, %d connections\n", db_desc->nb_conns);
   return 0;
 }
 
@@ -116,8 +255,138 @@ void
 hss_mysql_disconnect (
   void)
 {
-  mysql_close (db_desc->db_conn);
-  mysql_thread_end();
+  int                                     i;
+
+  if (db_desc == NULL) {
+    return;
+  }
+
+  if (db_desc->conns) {
+    for (i = 0; i < db_desc->nb_conns; i++) {
+      hss_mysql_conn_close (&db_desc->conns[i]);
+    }
+
+    free (db_desc->conns);
+  }
+
+  sem_destroy (&db_desc->free_conns);
+  free (db_desc->server);
+  free (db_desc->user);
+  free (db_desc->password);
+  free (db_desc->database);
+  free (db_desc);
+  db_desc = NULL;
+  mysql_library_end ();
+}
+
+//------------------------------------------------------------------------------
+hss_db_conn_t *
+hss_mysql_conn_get (
+  void)
+{
+  hss_db_conn_t                          *conn;
+  int                                     i;
+
+  if ((db_desc == NULL) || (db_desc->conns == NULL)) {
+    return NULL;
+  }
+
+  while (sem_wait (&db_desc->free_conns) != 0) {
+    if (errno != EINTR) {
+      return NULL;
+    }
+  }
+
+  if (conn_hint < 0) {
+    conn_hint = __sync_fetch_and_add (&conn_next_hint, 1) % db_desc->nb_conns;
+  }
+
+  /*
+   * The semaphore reserved one of the free connections for us, the scan ends
+   * on it at the latest
+   */
+  for (i = conn_hint;; i = (i + 1) % db_desc->nb_conns) {
+    conn = &db_desc->conns[i];
+
+    if ((conn->in_use == 0) && __sync_bool_compare_and_swap (&conn->in_use, 0, 1)) {
+      conn_hint = i;
+      return conn;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+void
+hss_mysql_conn_put (
+  hss_db_conn_t * conn)
+{
+  __sync_lock_release (&conn->in_use);
+  sem_post (&db_desc->free_conns);
+}
+
+//------------------------------------------------------------------------------
+void
+hss_mysql_bind (
+  MYSQL_BIND * bind,
+  enum enum_field_types type,
+  void *buffer,
+  unsigned long buffer_length,
+  unsigned long *length,
+  hss_db_bool_t * is_null)
+{
+  memset (bind, 0, sizeof (MYSQL_BIND));
+  bind->buffer_type = type;
+  bind->buffer = buffer;
+  bind->buffer_length = buffer_length;
+  bind->length = length;
+  bind->is_null = is_null;
+  bind->is_unsigned = 1;
+}
+
+//------------------------------------------------------------------------------
+MYSQL_STMT *
+hss_mysql_stmt_execute (
+  hss_db_conn_t * conn,
+  const hss_db_stmt_id_t stmt_id,
+  MYSQL_BIND * params,
+  MYSQL_BIND * results)
+{
+  MYSQL_STMT                             *stmt;
+  unsigned int                            err;
+  int                                     attempt;
+
+  for (attempt = 0; attempt < 2; attempt++) {
+    if ((conn->db_conn == NULL) && (hss_mysql_conn_open (conn) != 0)) {
+      return NULL;
+    }
+
+    if ((stmt = conn->stmts[stmt_id]) == NULL) {
+      return NULL;
+    }
+
+    conn->nb_round_trips++;
+
+    if (((params == NULL) || (mysql_stmt_bind_param (stmt, params) == 0))
+        && (mysql_stmt_execute (stmt) == 0)
+        && ((results == NULL) || ((mysql_stmt_bind_result (stmt, results) == 0) && (mysql_stmt_store_result (stmt) == 0)))) {
+      return stmt;
+    }
+
+    err = mysql_stmt_errno (stmt);
+    FPRINTF_ERROR ("Statement execution failed: %s\n", mysql_stmt_error (stmt));
+
+    if ((err != CR_SERVER_GONE_ERROR) && (err != CR_SERVER_LOST)) {
+      break;
+    }
+
+    /*
+     * The prepared statements went away with the connection, reopen it on the
+     * next attempt
+     */
+    hss_mysql_conn_close (conn);
+  }
+
+  return NULL;
 }
 
 int
@@ -125,12 +394,22 @@ hss_mysql_update_loc (
   const char *imsi,
   mysql_ul_ans_t * mysql_ul_ans)
 {
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[9];
+  unsigned long                           length[9];
+  hss_db_bool_t                           is_null[9];
+  uint32_t                                access_restriction = 0;
+  uint32_t                                mme_id = 0;
+  uint32_t                                id_mme_identity = 0;
+  uint64_t                                aggr_ul = 0;
+  uint64_t                                aggr_dl = 0;
+  uint32_t                                rau_tau = 0;
+  int                                     rc;
   int                                     ret = 0;
 
-  if ((db_desc->db_conn == NULL) || (mysql_ul_ans == NULL)) {
+  if (mysql_ul_ans == NULL) {
     return EINVAL;
   }
 
@@ -138,48 +417,59 @@ hss_mysql_update_loc (
     return EINVAL;
   }
 
-  sprintf (query, "SELECT `access_restriction`,`mmeidentity_idmmeidentity`," "`msisdn`,`ue_ambr_ul`,`ue_ambr_dl`,`rau_tau_timer` " "FROM `users` WHERE `users`.`imsi`='%s' ", imsi);
   memcpy (mysql_ul_ans->imsi, imsi, strlen (imsi) + 1);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  memset (mysql_ul_ans->msisdn, 0, sizeof (mysql_ul_ans->msisdn));
+  memset (&mysql_ul_ans->mme_identity, 0, sizeof (mysql_mme_identity_t));
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_LONG, &access_restriction, sizeof (access_restriction), &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_LONG, &mme_id, sizeof (mme_id), &length[1], &is_null[1]);
+  hss_mysql_bind (&result[2], MYSQL_TYPE_STRING, mysql_ul_ans->msisdn, sizeof (mysql_ul_ans->msisdn) - 1, &length[2], &is_null[2]);
+  hss_mysql_bind (&result[3], MYSQL_TYPE_LONGLONG, &aggr_ul, sizeof (aggr_ul), &length[3], &is_null[3]);
+  hss_mysql_bind (&result[4], MYSQL_TYPE_LONGLONG, &aggr_dl, sizeof (aggr_dl), &length[4], &is_null[4]);
+  hss_mysql_bind (&result[5], MYSQL_TYPE_LONG, &rau_tau, sizeof (rau_tau), &length[5], &is_null[5]);
+  hss_mysql_bind (&result[6], MYSQL_TYPE_LONG, &id_mme_identity, sizeof (id_mme_identity), &length[6], &is_null[6]);
+  hss_mysql_bind (&result[7], MYSQL_TYPE_STRING, mysql_ul_ans->mme_identity.mme_host, sizeof (mysql_ul_ans->mme_identity.mme_host) - 1, &length[7], &is_null[7]);
+  hss_mysql_bind (&result[8], MYSQL_TYPE_STRING, mysql_ul_ans->mme_identity.mme_realm, sizeof (mysql_ul_ans->mme_identity.mme_realm) - 1, &length[8], &is_null[8]);
+
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_UPDATE_LOC, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
 
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    int                                     mme_id;
+  rc = mysql_stmt_fetch (stmt);
 
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
     /*
      * MSISDN may be NULL
      */
-    mysql_ul_ans->access_restriction = atoi (row[0]);
+    mysql_ul_ans->access_restriction = access_restriction;
 
-    if ((mme_id = atoi (row[1])) > 0) {
-      ret = hss_mysql_query_mmeidentity (mme_id, &mysql_ul_ans->mme_identity);
+    if (mme_id > 0) {
+      /*
+       * The serving MME must be known
+       */
+      if (is_null[6]) {
+        ret = EINVAL;
+      }
     } else {
       mysql_ul_ans->mme_identity.mme_host[0] = '\0';
       mysql_ul_ans->mme_identity.mme_realm[0] = '\0';
     }
 
-    if (row[2] != 0) {
-      memcpy (mysql_ul_ans->msisdn, row[2], strlen (row[2]));
-    }
-
-    mysql_ul_ans->aggr_ul = atoi (row[3]);
-    mysql_ul_ans->aggr_dl = atoi (row[4]);
-    mysql_ul_ans->rau_tau = atoi (row[5]);
+    mysql_ul_ans->aggr_ul = aggr_ul;
+    mysql_ul_ans->aggr_dl = aggr_dl;
+    mysql_ul_ans->rau_tau = rau_tau;
+  } else if (rc != MYSQL_NO_DATA) {
+    FPRINTF_ERROR ("Fetch failed: %s\n", mysql_stmt_error (stmt));
+    ret = EINVAL;
   }
 
-  mysql_free_result (res);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
   return ret;
 }
 
@@ -188,12 +478,18 @@ hss_mysql_purge_ue (
   mysql_pu_req_t * mysql_pu_req,
   mysql_pu_ans_t * mysql_pu_ans)
 {
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[4];
+  unsigned long                           length[4];
+  hss_db_bool_t                           is_null[4];
+  uint32_t                                mme_id = 0;
+  uint32_t                                id_mme_identity = 0;
+  int                                     rc;
   int                                     ret = 0;
 
-  if ((db_desc->db_conn == NULL) || (mysql_pu_req == NULL) || (mysql_pu_ans == NULL)) {
+  if ((mysql_pu_req == NULL) || (mysql_pu_ans == NULL)) {
     return EINVAL;
   }
 
@@ -201,76 +497,80 @@ hss_mysql_purge_ue (
     return EINVAL;
   }
 
+  memset (mysql_pu_ans, 0, sizeof (mysql_pu_ans_t));
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, mysql_pu_req->imsi, strlen (mysql_pu_req->imsi), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_LONG, &mme_id, sizeof (mme_id), &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_LONG, &id_mme_identity, sizeof (id_mme_identity), &length[1], &is_null[1]);
+  hss_mysql_bind (&result[2], MYSQL_TYPE_STRING, mysql_pu_ans->mme_host, sizeof (mysql_pu_ans->mme_host) - 1, &length[2], &is_null[2]);
+  hss_mysql_bind (&result[3], MYSQL_TYPE_STRING, mysql_pu_ans->mme_realm, sizeof (mysql_pu_ans->mme_realm) - 1, &length[3], &is_null[3]);
 
-  sprintf (query, "UPDATE `users` SET `users`.`ms_ps_status`=\"PURGED\" " "WHERE `users`.`imsi`='%s'; " "SELECT `users`.`mmeidentity_idmmeidentity` FROM `users` " "WHERE `users`.`imsi`='%s' ", mysql_pu_req->imsi, mysql_pu_req->imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
+  if (hss_mysql_stmt_execute (conn, HSS_DB_STMT_PURGE_UE, param, NULL) == NULL) {
+    hss_mysql_conn_put (conn);
+    return EINVAL;
+  }
 
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_SERVING_MME, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
 
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    int                                     mme_id;
+  rc = mysql_stmt_fetch (stmt);
 
-    if ((mme_id = atoi (row[0])) > 0) {
-      ret = hss_mysql_query_mmeidentity (mme_id, mysql_pu_ans);
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
+    if (mme_id > 0) {
+      if (is_null[1]) {
+        ret = EINVAL;
+      }
     } else {
       mysql_pu_ans->mme_host[0] = '\0';
       mysql_pu_ans->mme_realm[0] = '\0';
     }
-
-    mysql_free_result (res);
-    return ret;
+  } else {
+    ret = EINVAL;
   }
 
-  mysql_free_result (res);
-  return EINVAL;
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
+  return ret;
 }
 
 int
 hss_mysql_get_user (
   const char *imsi)
 {
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
-
-  if (db_desc->db_conn == NULL) {
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[1];
+  char                                    imsi_db[IMSI_LENGTH_MAX + 1];
+  unsigned long                           length;
+  hss_db_bool_t                           is_null;
+  int                                     rc;
+
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_STRING, imsi_db, sizeof (imsi_db), &length, &is_null);
+
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-
-  sprintf (query, "SELECT `imsi` FROM `users` WHERE `users`.`imsi`='%s' ", imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_GET_USER, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
+  rc = mysql_stmt_fetch (stmt);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
 
-  if ( res == NULL )
-    return EINVAL;
-
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    mysql_free_result (res);
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
     return 0;
   }
 
-  mysql_free_result (res);
   return EINVAL;
 }
 
@@ -278,84 +578,58 @@ int
 mysql_push_up_loc (
   mysql_ul_push_t * ul_push_p)
 {
-  MYSQL_RES                              *res;
-  char                                    query[1000];
-  int                                     query_length = 0;
-  int                                     status;
+  hss_db_conn_t                          *conn;
+  MYSQL_BIND                              param[5];
+  MYSQL_BIND                              mme_param[4];
+  hss_db_stmt_id_t                        stmt_id;
+  int                                     ret = 0;
 
-  if ((db_desc->db_conn == NULL) || (ul_push_p == NULL)) {
+  if (ul_push_p == NULL) {
     return EINVAL;
   }
-  // TODO: multi-statement check results
 
-  if (ul_push_p->mme_identity_present == MME_IDENTITY_PRESENT) {
-    query_length += sprintf (&query[query_length], "INSERT INTO `mmeidentity`"
-                             " (`mmehost`,`mmerealm`) SELECT '%s','%s' FROM `mmeidentity` WHERE NOT"
-                             " EXISTS (SELECT * FROM `mmeidentity` WHERE `mmehost`='%s'"
-                             " AND `mmerealm`='%s') LIMIT 1;", ul_push_p->mme_identity.mme_host, ul_push_p->mme_identity.mme_realm, ul_push_p->mme_identity.mme_host, ul_push_p->mme_identity.mme_realm);
+  if ((ul_push_p->mme_identity_present != MME_IDENTITY_PRESENT) && (ul_push_p->imei_present != IMEI_PRESENT) && (ul_push_p->sv_present != SV_PRESENT)) {
+    return 0;
   }
 
-  query_length += sprintf (&query[query_length], "UPDATE `users`%s SET ", ul_push_p->mme_identity_present == MME_IDENTITY_PRESENT ? ",`mmeidentity`" : "");
-
+  /*
+   * IMEI and IMEISV are left unchanged when bound to NULL
+   */
   if (ul_push_p->imei_present == IMEI_PRESENT) {
-    query_length += sprintf (&query[query_length], "`imei`='%s',", ul_push_p->imei);
+    hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, ul_push_p->imei, strlen (ul_push_p->imei), NULL, NULL);
+  } else {
+    hss_mysql_bind (&param[0], MYSQL_TYPE_NULL, NULL, 0, NULL, NULL);
   }
 
   if (ul_push_p->sv_present == SV_PRESENT) {
-    query_length += sprintf (&query[query_length], "`imeisv`='%*s',", 2, ul_push_p->software_version);
-  }
-
-  if (ul_push_p->mme_identity_present == MME_IDENTITY_PRESENT) {
-    query_length += sprintf (&query[query_length], "`users`.`mmeidentity_idmmeidentity`=`mmeidentity`.`idmmeidentity`, " "`users`.`ms_ps_status`=\"NOT_PURGED\"");
+    hss_mysql_bind (&param[1], MYSQL_TYPE_STRING, ul_push_p->software_version, strnlen (ul_push_p->software_version, 2), NULL, NULL);
+  } else {
+    hss_mysql_bind (&param[1], MYSQL_TYPE_NULL, NULL, 0, NULL, NULL);
   }
 
-  query_length += sprintf (&query[query_length], " WHERE `users`.`imsi`='%s'", ul_push_p->imsi);
+  hss_mysql_bind (&param[2], MYSQL_TYPE_STRING, ul_push_p->imsi, strlen (ul_push_p->imsi), NULL, NULL);
+  stmt_id = HSS_DB_STMT_PUSH_UP_LOC_NO_MME;
 
   if (ul_push_p->mme_identity_present == MME_IDENTITY_PRESENT) {
-    query_length += sprintf (&query[query_length], " AND `mmeidentity`.`mmehost`='%s'" " AND `mmeidentity`.`mmerealm`='%s'", ul_push_p->mme_identity.mme_host, ul_push_p->mme_identity.mme_realm);
+    hss_mysql_bind (&param[3], MYSQL_TYPE_STRING, ul_push_p->mme_identity.mme_host, strlen (ul_push_p->mme_identity.mme_host), NULL, NULL);
+    hss_mysql_bind (&param[4], MYSQL_TYPE_STRING, ul_push_p->mme_identity.mme_realm, strlen (ul_push_p->mme_identity.mme_realm), NULL, NULL);
+    memcpy (&mme_param[0], &param[3], 2 * sizeof (MYSQL_BIND));
+    memcpy (&mme_param[2], &param[3], 2 * sizeof (MYSQL_BIND));
+    stmt_id = HSS_DB_STMT_PUSH_UP_LOC;
   }
 
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    fprintf (stderr, "Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  /*
-   * process each statement result
-   */
-  do {
-    /*
-     * did current statement return data?
-     */
-    res = mysql_store_result (db_desc->db_conn);
-
-    if (res) {
-      /*
-       * yes; process rows and free the result set
-       */
-      mysql_free_result (res);
-    } else {                    /* no result set or error */
-      if (mysql_field_count (db_desc->db_conn) == 0) {
-        FPRINTF_ERROR ( "%lld rows affected\n", mysql_affected_rows (db_desc->db_conn));
-      } else {                  /* some error occurred */
-        FPRINTF_ERROR ( "Could not retrieve result set\n");
-        break;
-      }
-    }
-
-    /*
-     * more results? -1 = no, >0 = error, 0 = yes (keep looping)
-     */
-    if ((status = mysql_next_result (db_desc->db_conn)) > 0)
-      FPRINTF_ERROR ( "Could not execute statement\n");
-  } while (status == 0);
+  if ((stmt_id == HSS_DB_STMT_PUSH_UP_LOC) && (hss_mysql_stmt_execute (conn, HSS_DB_STMT_PUSH_MME_IDENTITY, mme_param, NULL) == NULL)) {
+    ret = EINVAL;
+  } else if (hss_mysql_stmt_execute (conn, stmt_id, param, NULL) == NULL) {
+    ret = EINVAL;
+  }
 
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-  return 0;
+  hss_mysql_conn_put (conn);
+  return ret;
 }
 
 int
@@ -364,135 +638,260 @@ hss_mysql_push_rand_sqn (
   uint8_t * rand_p,
   uint8_t * sqn)
 {
-  int                                     status = 0,
-    i;
-  MYSQL_RES                              *res;
-  char                                    query[1000];
-  int                                     query_length = 0;
+  hss_db_conn_t                          *conn;
+  MYSQL_BIND                              param[3];
   uint64_t                                sqn_decimal = 0;
+  int                                     ret = 0;
 
-  if (db_desc->db_conn == NULL) {
+  if (rand_p == NULL || sqn == NULL) {
     return EINVAL;
   }
 
-  if (rand_p == NULL || sqn == NULL) {
+  sqn_decimal = ((uint64_t) sqn[0] << 40) | ((uint64_t) sqn[1] << 32) | ((uint64_t) sqn[2] << 24) | (sqn[3] << 16) | (sqn[4] << 8) | sqn[5];
+  hss_mysql_bind (&param[0], MYSQL_TYPE_BLOB, rand_p, RAND_LENGTH, NULL, NULL);
+  hss_mysql_bind (&param[1], MYSQL_TYPE_LONGLONG, &sqn_decimal, sizeof (sqn_decimal), NULL, NULL);
+  hss_mysql_bind (&param[2], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  sqn_decimal = ((uint64_t) sqn[0] << 40) | ((uint64_t) sqn[1] << 32) | ((uint64_t) sqn[2] << 24) | (sqn[3] << 16) | (sqn[4] << 8) | sqn[5];
-  query_length = sprintf (query, "UPDATE `users` SET `rand`=UNHEX('");
+  if (hss_mysql_stmt_execute (conn, HSS_DB_STMT_PUSH_RAND_SQN, param, NULL) == NULL) {
+    ret = EINVAL;
+  }
+
+  hss_mysql_conn_put (conn);
+  return ret;
+}
 
-  for (i = 0; i < RAND_LENGTH; i++) {
-    query_length += sprintf (&query[query_length], "%02x", rand_p[i]);
+int
+hss_mysql_increment_sqn (
+  const char *imsi)
+{
+  hss_db_conn_t                          *conn;
+  MYSQL_BIND                              param[1];
+  int                                     ret = 0;
+
+  if (imsi == NULL) {
+    return EINVAL;
   }
 
-  query_length += sprintf (&query[query_length], "'),`sqn`=%" PRIu64, sqn_decimal);
-  query_length += sprintf (&query[query_length], " WHERE `users`.`imsi`='%s'", imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
 
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  /*
-   * process each statement result
-   */
-  do {
-    /*
-     * did current statement return data?
-     */
-    res = mysql_store_result (db_desc->db_conn);
+  if (hss_mysql_stmt_execute (conn, HSS_DB_STMT_INCREMENT_SQN, param, NULL) == NULL) {
+    ret = EINVAL;
+  }
 
-    if (res) {
-      /*
-       * yes; process rows and free the result set
-       */
-      mysql_free_result (res);
-    } else {                    /* no result set or error */
-      if (mysql_field_count (db_desc->db_conn) == 0) {
-        FPRINTF_ERROR ( "%lld rows affected\n", mysql_affected_rows (db_desc->db_conn));
-      } else {                  /* some error occurred */
-        FPRINTF_ERROR ( "Could not retrieve result set\n");
-        break;
-      }
-    }
+  hss_mysql_conn_put (conn);
+  return ret;
+}
 
-    /*
-     * more results? -1 = no, >0 = error, 0 = yes (keep looping)
-     */
-    if ((status = mysql_next_result (db_desc->db_conn)) > 0)
-      FPRINTF_ERROR ( "Could not execute statement\n");
-  } while (status == 0);
+//------------------------------------------------------------------------------
+static hss_db_air_cache_entry_t        *
+hss_mysql_air_cache_lock (
+  const char *imsi)
+{
+  hss_db_air_cache_entry_t               *entry;
 
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-  return 0;
+  entry = &hss_db_air_cache[strtoull (imsi, NULL, 10) % HSS_DB_AIR_CACHE_SIZE];
+
+  while (__sync_lock_test_and_set (&entry->lock, 1)) {
+    while (entry->lock);
+  }
+
+  return entry;
+}
+
+//------------------------------------------------------------------------------
+static void
+hss_mysql_air_cache_put (
+  const char *imsi,
+  const mysql_auth_info_resp_t * auth_info_resp)
+{
+  hss_db_air_cache_entry_t               *entry = hss_mysql_air_cache_lock (imsi);
+
+  strncpy (entry->imsi, imsi, IMSI_LENGTH_MAX);
+  memcpy (entry->key, auth_info_resp->key, KEY_LENGTH);
+  memcpy (entry->opc, auth_info_resp->opc, KEY_LENGTH);
+  memcpy (entry->rand, auth_info_resp->rand, RAND_LENGTH);
+  __sync_lock_release (&entry->lock);
 }
 
 int
-hss_mysql_increment_sqn (
-  const char *imsi)
+hss_mysql_air_cache_get (
+  const char *imsi,
+  mysql_auth_info_resp_t * auth_info_resp)
 {
-  int                                     status;
-  MYSQL_RES                              *res;
-  char                                    query[1000];
+  hss_db_air_cache_entry_t               *entry;
+  int                                     ret = -1;
 
-  if (db_desc->db_conn == NULL) {
+  if ((imsi == NULL) || (auth_info_resp == NULL)) {
     return EINVAL;
   }
 
-  if (imsi == NULL) {
+  entry = hss_mysql_air_cache_lock (imsi);
+
+  if (strncmp (entry->imsi, imsi, IMSI_LENGTH_MAX) == 0) {
+    memcpy (auth_info_resp->key, entry->key, KEY_LENGTH);
+    memcpy (auth_info_resp->opc, entry->opc, KEY_LENGTH);
+    memcpy (auth_info_resp->rand, entry->rand, RAND_LENGTH);
+    ret = 0;
+  }
+
+  __sync_lock_release (&entry->lock);
+  return ret;
+}
+
+int
+hss_mysql_air_reserve_sqn (
+  const char *imsi,
+  uint8_t * rand_p,
+  const uint32_t nb_sqn,
+  const uint8_t * resync_sqn,
+  mysql_auth_info_resp_t * auth_info_resp)
+{
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[4];
+  MYSQL_BIND                              result[4];
+  unsigned long                           length[4];
+  hss_db_bool_t                           is_null[4];
+  uint8_t                                 rand_db[RAND_LENGTH];
+  uint64_t                                sqn_ms = 0;
+  uint64_t                                sqn = 0;
+  uint64_t                                sqn_db = 0;
+  uint32_t                                nb = nb_sqn;
+  int                                     rc;
+  int                                     ret = 0;
+
+  if ((imsi == NULL) || (rand_p == NULL) || (nb_sqn == 0) || (auth_info_resp == NULL)) {
     return EINVAL;
   }
 
-  /*
-   * + 32 = 2 ^ sizeof(IND) (see 3GPP TS. 33.102)
-   */
-  sprintf (query, "UPDATE `users` SET `sqn` = `sqn` + 32 WHERE `users`.`imsi`='%s'", imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+  hss_mysql_bind (&param[1], MYSQL_TYPE_BLOB, rand_p, RAND_LENGTH, NULL, NULL);
+  hss_mysql_bind (&param[2], MYSQL_TYPE_LONG, &nb, sizeof (nb), NULL, NULL);
 
-  pthread_mutex_lock(&db_desc->db_cs_mutex);
+  if (resync_sqn) {
+    sqn_ms = ((uint64_t) resync_sqn[0] << 40) | ((uint64_t) resync_sqn[1] << 32) | ((uint64_t) resync_sqn[2] << 24) |
+      (resync_sqn[3] << 16) | (resync_sqn[4] << 8) | resync_sqn[5];
+    hss_mysql_bind (&param[3], MYSQL_TYPE_LONGLONG, &sqn_ms, sizeof (sqn_ms), NULL, NULL);
+  } else {
+    hss_mysql_bind (&param[3], MYSQL_TYPE_NULL, NULL, 0, NULL, NULL);
+  }
+
+  hss_mysql_bind (&result[0], MYSQL_TYPE_BLOB, auth_info_resp->key, KEY_LENGTH, &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_BLOB, auth_info_resp->opc, KEY_LENGTH, &length[1], &is_null[1]);
+  hss_mysql_bind (&result[2], MYSQL_TYPE_LONGLONG, &sqn, sizeof (sqn), &length[2], &is_null[2]);
 
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  /*
-   * process each statement result
-   */
-  do {
-    /*
-     * did current statement return data?
-     */
-    res = mysql_store_result (db_desc->db_conn);
+  if (conn->stmts[HSS_DB_STMT_AIR_RESERVE] != NULL) {
+    if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_AIR_RESERVE, param, result)) != NULL) {
+      rc = mysql_stmt_fetch (stmt);
+      mysql_stmt_free_result (stmt);
 
-    if (res) {
       /*
-       * yes; process rows and free the result set
+       * The status of the CALL follows the result set
        */
-      mysql_free_result (res);
-    } else {                    /* no result set or error */
-      if (mysql_field_count (db_desc->db_conn) == 0) {
-        FPRINTF_ERROR ( "%lld rows affected\n", mysql_affected_rows (db_desc->db_conn));
-      } else {                  /* some error occurred */
-        FPRINTF_ERROR ( "Could not retrieve result set\n");
-        break;
+      while (mysql_stmt_next_result (stmt) == 0) {
+        mysql_stmt_free_result (stmt);
       }
+
+      if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
+        ret = (is_null[0] || is_null[1] || is_null[2]) ? EINVAL : 0;
+      } else if (rc == MYSQL_NO_DATA) {
+        ret = DIAMETER_ERROR_USER_UNKNOWN;
+      } else {
+        ret = EINVAL;
+      }
+
+      goto done;
+    }
+
+    if ((conn->stmts[HSS_DB_STMT_AIR_RESERVE] == NULL) || (mysql_stmt_errno (conn->stmts[HSS_DB_STMT_AIR_RESERVE]) != ER_SP_DOES_NOT_EXIST)) {
+      hss_mysql_conn_put (conn);
+      return EINVAL;
     }
 
     /*
-     * more results? -1 = no, >0 = error, 0 = yes (keep looping)
+     * The procedure was dropped after the connection was opened
      */
-    if ((status = mysql_next_result (db_desc->db_conn)) > 0)
-      FPRINTF_ERROR ( "Could not execute statement\n");
-  } while (status == 0);
+    mysql_stmt_close (conn->stmts[HSS_DB_STMT_AIR_RESERVE]);
+    conn->stmts[HSS_DB_STMT_AIR_RESERVE] = NULL;
+  }
 
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-  return 0;
+  /*
+   * Without the procedure: reserve, then read the key and OPc
+   */
+  param[0] = param[3];
+  hss_mysql_bind (&param[3], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+  hss_mysql_bind (&param[1], MYSQL_TYPE_LONG, &nb, sizeof (nb), NULL, NULL);
+  hss_mysql_bind (&param[2], MYSQL_TYPE_BLOB, rand_p, RAND_LENGTH, NULL, NULL);
+
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_RESERVE_SQN, param, NULL)) == NULL) {
+    ret = EINVAL;
+  } else if (mysql_stmt_affected_rows (stmt) == 0) {
+    ret = DIAMETER_ERROR_USER_UNKNOWN;
+  } else {
+    sqn = mysql_stmt_insert_id (stmt);
+    hss_mysql_bind (&result[1], MYSQL_TYPE_LONGLONG, &sqn_db, sizeof (sqn_db), &length[1], &is_null[1]);
+    hss_mysql_bind (&result[2], MYSQL_TYPE_BLOB, rand_db, RAND_LENGTH, &length[2], &is_null[2]);
+    hss_mysql_bind (&result[3], MYSQL_TYPE_BLOB, auth_info_resp->opc, KEY_LENGTH, &length[3], &is_null[3]);
+
+    if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_AUTH_INFO, &param[3], result)) == NULL) {
+      ret = EINVAL;
+    } else {
+      rc = mysql_stmt_fetch (stmt);
+      mysql_stmt_free_result (stmt);
+
+      if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
+        ret = (is_null[0] || is_null[3]) ? EINVAL : 0;
+      } else {
+        ret = DIAMETER_ERROR_USER_UNKNOWN;
+      }
+    }
+  }
+
+done:
+  hss_mysql_conn_put (conn);
+
+  if (ret == 0) {
+    memcpy (auth_info_resp->rand, rand_p, RAND_LENGTH);
+    hss_mysql_air_cache_put (imsi, auth_info_resp);
+    auth_info_resp->sqn[0] = (sqn & (255UL << 40)) >> 40;
+    auth_info_resp->sqn[1] = (sqn & (255UL << 32)) >> 32;
+    auth_info_resp->sqn[2] = (sqn & (255UL << 24)) >> 24;
+    auth_info_resp->sqn[3] = (sqn & (255UL << 16)) >> 16;
+    auth_info_resp->sqn[4] = (sqn & (255UL << 8)) >> 8;
+    auth_info_resp->sqn[5] = (sqn & 0xFF);
+  }
+
+  return ret;
+}
+
+uint64_t
+hss_mysql_round_trips (
+  void)
+{
+  uint64_t                                nb_round_trips = 0;
+  int                                     i;
+
+  if ((db_desc == NULL) || (db_desc->conns == NULL)) {
+    return 0;
+  }
+
+  for (i = 0; i < db_desc->nb_conns; i++) {
+    nb_round_trips += db_desc->conns[i].nb_round_trips;
+  }
+
+  return nb_round_trips;
 }
 
 int
@@ -500,76 +899,58 @@ hss_mysql_auth_info (
   mysql_auth_info_req_t * auth_info_req,
   mysql_auth_info_resp_t * auth_info_resp)
 {
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[4];
+  unsigned long                           length[4];
+  hss_db_bool_t                           is_null[4];
+  uint64_t                                sqn = 0;
+  int                                     rc;
   int                                     ret = 0;
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
-
-  if (db_desc->db_conn == NULL) {
-    return EINVAL;
-  }
 
   if ((auth_info_req == NULL) || (auth_info_resp == NULL)) {
     return EINVAL;
   }
 
-  sprintf (query, "SELECT `key`,`sqn`,`rand`,`OPc` FROM `users` WHERE `users`.`imsi`='%s' ", auth_info_req->imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, auth_info_req->imsi, strlen (auth_info_req->imsi), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_BLOB, auth_info_resp->key, KEY_LENGTH, &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_LONGLONG, &sqn, sizeof (sqn), &length[1], &is_null[1]);
+  hss_mysql_bind (&result[2], MYSQL_TYPE_BLOB, auth_info_resp->rand, RAND_LENGTH, &length[2], &is_null[2]);
+  hss_mysql_bind (&result[3], MYSQL_TYPE_BLOB, auth_info_resp->opc, KEY_LENGTH, &length[3], &is_null[3]);
 
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_AUTH_INFO, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
 
-  ret = 0;
+  rc = mysql_stmt_fetch (stmt);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
 
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    if (row[0] == NULL || row[1] == NULL || row[2] == NULL || row[3] == NULL) {
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
+    if (is_null[0] || is_null[1] || is_null[2] || is_null[3]) {
       ret = EINVAL;
     }
 
-    if (row[0] != NULL) {
-      print_buffer ("Key: ", (uint8_t *) row[0], KEY_LENGTH);
-      memcpy (auth_info_resp->key, row[0], KEY_LENGTH);
-    }
-
-    if (row[1] != NULL) {
-      uint64_t                                sqn = 0;
-
-      sqn = atoll (row[1]);
-      printf ("Received SQN %s converted to %" PRIu64 "\n", row[1], sqn);
+    if (!is_null[1]) {
       auth_info_resp->sqn[0] = (sqn & (255UL << 40)) >> 40;
       auth_info_resp->sqn[1] = (sqn & (255UL << 32)) >> 32;
       auth_info_resp->sqn[2] = (sqn & (255UL << 24)) >> 24;
       auth_info_resp->sqn[3] = (sqn & (255UL << 16)) >> 16;
       auth_info_resp->sqn[4] = (sqn & (255UL << 8)) >> 8;
       auth_info_resp->sqn[5] = (sqn & 0xFF);
-      print_buffer ("SQN: ", auth_info_resp->sqn, SQN_LENGTH);
-    }
-
-    if (row[2] != NULL) {
-      print_buffer ("RAND: ", (uint8_t *) row[2], RAND_LENGTH);
-      memcpy (auth_info_resp->rand, row[2], RAND_LENGTH);
-    }
-
-    if (row[3] != NULL) {
-      print_buffer ("OPc: ", (uint8_t *) row[3], KEY_LENGTH);
-      memcpy (auth_info_resp->opc, row[3], KEY_LENGTH);
     }
-
-  } else {
+  } else if (rc == MYSQL_NO_DATA) {
     ret =  DIAMETER_ERROR_USER_UNKNOWN;
+  } else {
+    ret = EINVAL;
   }
 
-  mysql_free_result (res);
   return ret;
 }
 
@@ -578,114 +959,67 @@ hss_mysql_check_opc_keys (
   const uint8_t const opP[16])
 {
   int                                     ret = 0;
+  hss_db_conn_t                          *conn;
   MYSQL_RES                              *res = NULL;
-  MYSQL_RES                              *res2 = NULL;
   MYSQL_ROW                               row;
-  char                                    query[1000];
-  char                                    update[1000];
+  MYSQL_BIND                              param[2];
+  unsigned long                          *lengths;
   uint8_t                                 k[16];
   uint8_t                                 opc[16];
-  int                                     update_length = 0;
-  int                                     status = 0;
   int                                     i;
 
-  if (db_desc->db_conn == NULL) {
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  sprintf (query, "SELECT `imsi`,`key`,`OPc` FROM `users` ");
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ( "Query execution failed: %s\n", mysql_error (db_desc->db_conn));
-    mysql_thread_end ();
+  /*
+   * Startup scan of the whole table, the text protocol is fine here
+   */
+  if (mysql_query (conn->db_conn, "SELECT `imsi`,`key`,`OPc` FROM `users` ")) {
+    FPRINTF_ERROR ( "Query execution failed: %s\n", mysql_error (conn->db_conn));
+    hss_mysql_conn_put (conn);
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
+  if ((res = mysql_store_result (conn->db_conn)) == NULL) {
+    hss_mysql_conn_put (conn);
+    return EINVAL;
+  }
 
   while ((row = mysql_fetch_row (res))) {
-    if (row[0] == NULL || row[1] == NULL) {
-      FPRINTF_ERROR ( "Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+    lengths = mysql_fetch_lengths (res);
+
+    if (row[0] == NULL || row[1] == NULL || lengths[1] < KEY_LENGTH) {
+      FPRINTF_ERROR ( "Bad key for IMSI %s\n", (row[0] == NULL) ? "NULL" : row[0]);
       ret = EINVAL;
-    } else {
-      if (row[0] != NULL) {
-        printf ("IMSI: %s", (uint8_t *) row[0]);
-      }
+      continue;
+    }
+
+    printf ("IMSI: %s", row[0]);
+    print_buffer ("Key: ", (uint8_t *) row[1], KEY_LENGTH);
+    memcpy (k, row[1], KEY_LENGTH);
+    ComputeOPc (k, opP, opc);
+    hss_mysql_bind (&param[0], MYSQL_TYPE_BLOB, opc, KEY_LENGTH, NULL, NULL);
+    hss_mysql_bind (&param[1], MYSQL_TYPE_STRING, row[0], lengths[0], NULL, NULL);
 
-      if (row[1] != NULL) {
-        print_buffer ("Key: ", (uint8_t *) row[1], KEY_LENGTH);
-        memcpy (k, row[1], KEY_LENGTH);
+    if (hss_mysql_stmt_execute (conn, HSS_DB_STMT_UPDATE_OPC, param, NULL) != NULL) {
+      printf ("IMSI %s Updated OPc ", row[0]);
+
+      for (i = 0; (row[2] != NULL) && (i < lengths[2]); i++) {
+        printf ("%02x", (uint8_t) (row[2][i]));
       }
-      //if (row[3] != NULL)
-      {
-        print_buffer ("OPc: ", (uint8_t *) row[2], KEY_LENGTH);
-        //} else {
-        ComputeOPc (k, opP, opc);
-        update_length = sprintf (update, "UPDATE `users` SET `OPc`=UNHEX('");
-
-        for (i = 0; i < KEY_LENGTH; i++) {
-          update_length += sprintf (&update[update_length], "%02x", opc[i]);
-        }
-
-        update_length += sprintf (&update[update_length], "') WHERE `users`.`imsi`='%s'", (uint8_t *) row[0]);
-        FPRINTF_DEBUG ("Query: %s\n", update);
-
-        if (mysql_query (db_desc->db_conn, update)) {
-          FPRINTF_ERROR ( "Query execution failed: %s\n", mysql_error (db_desc->db_conn));
-        } else {
-          printf ("IMSI %s Updated OPc ", (uint8_t *) row[0]);
-
-          for (i = 0; i < KEY_LENGTH; i++) {
-            printf ("%02x", (uint8_t) (row[2][i]));
-          }
-
-          printf (" -> ");
-
-          for (i = 0; i < KEY_LENGTH; i++) {
-            printf ("%02x", opc[i]);
-          }
-
-          printf ("\n");
-
-          /*
-           * process each statement result
-           */
-          do {
-            /*
-             * did current statement return data?
-             */
-            res2 = mysql_store_result (db_desc->db_conn);
-
-            if (res2) {
-              /*
-               * yes; process rows and free the result set
-               */
-              mysql_free_result (res2);
-            } else {            /* no result set or error */
-              if (mysql_field_count (db_desc->db_conn) == 0) {
-                FPRINTF_ERROR ( "%lld rows affected\n", mysql_affected_rows (db_desc->db_conn));
-              } else {          /* some error occurred */
-                FPRINTF_ERROR ( "Could not retrieve result set\n");
-                break;
-              }
-            }
-
-            /*
-             * more results? -1 = no, >0 = error, 0 = yes (keep looping)
-             */
-            if ((status = mysql_next_result (db_desc->db_conn)) > 0)
-              FPRINTF_ERROR ( "Could not execute statement\n");
-          } while (status == 0);
-        }
+
+      printf (" -> ");
+
+      for (i = 0; i < KEY_LENGTH; i++) {
+        printf ("%02x", opc[i]);
       }
+
+      printf ("\n");
     }
   }
 
   mysql_free_result (res);
-  mysql_thread_end ();
+  hss_mysql_conn_put (conn);
   return ret;
 }
@@ -39,49 +39,44 @@ hss_mysql_query_mmeidentity (
   const int id_mme_identity,
   mysql_mme_identity_t * mme_identity_p)
 {
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
-
-  if ((db_desc->db_conn == NULL) || (mme_identity_p == NULL)) {
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[2];
+  unsigned long                           length[2];
+  hss_db_bool_t                           is_null[2];
+  uint32_t                                id = id_mme_identity;
+  int                                     rc;
+
+  if (mme_identity_p == NULL) {
     return EINVAL;
   }
 
+  /*
+   * A NULL host or realm is left empty
+   */
   memset (mme_identity_p, 0, sizeof (mysql_mme_identity_t));
-  sprintf (query, "SELECT mmehost,mmerealm FROM mmeidentity WHERE " "mmeidentity.idmmeidentity='%d' ", id_mme_identity);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
+  hss_mysql_bind (&param[0], MYSQL_TYPE_LONG, &id, sizeof (id), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_STRING, mme_identity_p->mme_host, sizeof (mme_identity_p->mme_host) - 1, &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_STRING, mme_identity_p->mme_realm, sizeof (mme_identity_p->mme_realm) - 1, &length[1], &is_null[1]);
 
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_QUERY_MME_IDENTITY, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
 
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    if (row[0] != NULL) {
-      memcpy (mme_identity_p->mme_host, row[0], strlen (row[0]));
-    } else {
-      mme_identity_p->mme_host[0] = '\0';
-    }
-
-    if (row[1] != NULL) {
-      memcpy (mme_identity_p->mme_realm, row[1], strlen (row[1]));
-    } else {
-      mme_identity_p->mme_realm[0] = '\0';
-    }
+  rc = mysql_stmt_fetch (stmt);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
 
-    mysql_free_result (res);
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
     return 0;
   }
 
-  mysql_free_result (res);
   return EINVAL;
 }
 
@@ -89,35 +84,38 @@ int
 hss_mysql_check_epc_equipment (
   mysql_mme_identity_t * mme_identity_p)
 {
-  MYSQL_RES                              *res;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
-
-  if ((db_desc->db_conn == NULL) || (mme_identity_p == NULL)) {
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[1];
+  uint32_t                                id_mme_identity;
+  unsigned long                           length;
+  hss_db_bool_t                           is_null;
+  int                                     rc;
+
+  if (mme_identity_p == NULL) {
     return EINVAL;
   }
 
-  sprintf (query, "SELECT idmmeidentity FROM mmeidentity WHERE mmeidentity.mmehost='%s' ", mme_identity_p->mme_host);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, mme_identity_p->mme_host, strlen (mme_identity_p->mme_host), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_LONG, &id_mme_identity, sizeof (id_mme_identity), &length, &is_null);
 
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    FPRINTF_ERROR ("Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_CHECK_EPC_EQUIPMENT, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
+
+  rc = mysql_stmt_fetch (stmt);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
 
-  if ((row = mysql_fetch_row (res)) != NULL) {
-    mysql_free_result (res);
+  if ((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) {
     return 0;
   }
 
-  mysql_free_result (res);
   return EINVAL;
 }
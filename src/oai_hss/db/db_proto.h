@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <mysql/mysql.h>
 
 #include <netinet/in.h> /* To provide internet addresses strings helpers */
@@ -30,15 +31,54 @@
 #ifndef DB_PROTO_H_
 #define DB_PROTO_H_
 
-typedef struct {
+/* Statements prepared on each connection of the pool */
+typedef enum {
+  HSS_DB_STMT_GET_USER = 0,
+  HSS_DB_STMT_AUTH_INFO,
+  HSS_DB_STMT_PUSH_RAND_SQN,
+  HSS_DB_STMT_INCREMENT_SQN,
+  HSS_DB_STMT_UPDATE_LOC,
+  HSS_DB_STMT_PUSH_MME_IDENTITY,
+  HSS_DB_STMT_PUSH_UP_LOC,
+  HSS_DB_STMT_PUSH_UP_LOC_NO_MME,
+  HSS_DB_STMT_PURGE_UE,
+  HSS_DB_STMT_SERVING_MME,
+  HSS_DB_STMT_QUERY_MME_IDENTITY,
+  HSS_DB_STMT_CHECK_EPC_EQUIPMENT,
+  HSS_DB_STMT_QUERY_PDNS,
+  HSS_DB_STMT_UPDATE_OPC,
+  HSS_DB_STMT_AIR_RESERVE,   /* optional, needs the hss_air_reserve_sqn procedure */
+  HSS_DB_STMT_RESERVE_SQN,
+  HSS_DB_STMT_MAX,
+} hss_db_stmt_id_t;
+
+/* my_bool with MariaDB and MySQL < 8.0, bool after */
+typedef __typeof__ (*((MYSQL_BIND *) 0)->is_null) hss_db_bool_t;
+
+typedef struct hss_db_conn_s {
   /* The mysql reference connector object */
-  MYSQL *db_conn;
+  MYSQL      *db_conn;
+  MYSQL_STMT *stmts[HSS_DB_STMT_MAX];
+  /* Set by the thread that checked the connection out */
+  volatile int in_use;
+  /* Statements executed on the connection */
+  uint64_t     nb_round_trips;
+} hss_db_conn_t;
+
+typedef struct {
   char  *server;
   char  *user;
   char  *password;
   char  *database;
 
-  pthread_mutex_t db_cs_mutex;
+  /*
+   * Pool of connections. A thread checks out a connection for the time of one
+   * request: the semaphore counts the connections nobody uses, the thread then
+   * claims one of them with a CAS on its in_use flag.
+   */
+  int            nb_conns;
+  hss_db_conn_t *conns;
+  sem_t          free_conns;
 } database_t;
 
 extern database_t *db_desc;
@@ -166,6 +206,28 @@ int hss_mysql_connect(const hss_config_t *hss_config_p);
 
 void hss_mysql_disconnect(void);
 
+/* Blocks until a connection of the pool is free, NULL if the db layer is down */
+hss_db_conn_t *hss_mysql_conn_get(void);
+
+void hss_mysql_conn_put(hss_db_conn_t *conn);
+
+/*
+ * Integers are bound unsigned. An input parameter with a NULL length uses
+ * buffer_length, MYSQL_TYPE_NULL binds a NULL value.
+ */
+void hss_mysql_bind(MYSQL_BIND *bind, enum enum_field_types type,
+                    void *buffer, unsigned long buffer_length,
+                    unsigned long *length, hss_db_bool_t *is_null);
+
+/*
+ * Executes the statement with the parameters and, for a query, binds and
+ * buffers its result set: the caller fetches the rows and frees the result.
+ * The statement runs again once on a new connection when the server went
+ * away. Returns NULL on error.
+ */
+MYSQL_STMT *hss_mysql_stmt_execute(hss_db_conn_t *conn, const hss_db_stmt_id_t stmt_id,
+                                   MYSQL_BIND *params, MYSQL_BIND *results);
+
 int hss_mysql_get_user(const char *imsi);
 
 int hss_mysql_update_loc(const char *imsi, mysql_ul_ans_t *mysql_ul_ans);
@@ -191,6 +253,26 @@ int hss_mysql_push_rand_sqn(const char *imsi, uint8_t *rand_p, uint8_t *sqn);
 
 int hss_mysql_increment_sqn(const char *imsi);
 
+/*
+ * Authentication-Information-Request in one round trip: stores the RAND of the
+ * last vector, reads the key and OPc and reserves nb_sqn SQNs, 32 apart. With
+ * resync_sqn (SQN_MS) the block starts right after it. The first reserved SQN
+ * is returned in auth_info_resp->sqn.
+ */
+int hss_mysql_air_reserve_sqn(const char *imsi, uint8_t *rand_p, const uint32_t nb_sqn,
+                              const uint8_t *resync_sqn, mysql_auth_info_resp_t *auth_info_resp);
+
+/*
+ * Key, OPc and RAND of the last reservation made by this HSS for the IMSI,
+ * without a round trip. Another HSS on the same database may have stored a
+ * newer RAND since: the caller checks MAC-S and falls back to
+ * hss_mysql_auth_info. Returns 0 when the IMSI was found.
+ */
+int hss_mysql_air_cache_get(const char *imsi, mysql_auth_info_resp_t *auth_info_resp);
+
+/* Statements executed on all the connections of the pool */
+uint64_t hss_mysql_round_trips(void);
+
 int hss_mysql_check_opc_keys(const uint8_t const opP[16]);
 
 
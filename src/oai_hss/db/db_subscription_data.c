@@ -39,118 +39,126 @@ hss_mysql_query_pdns (
   mysql_pdn_t ** pdns_p,
   uint8_t * nb_pdns)
 {
-  int                                     ret;
-  MYSQL_RES                              *res = NULL;
-  MYSQL_ROW                               row;
-  char                                    query[1000];
+  int                                     ret = 0;
+  int                                     rc;
+  hss_db_conn_t                          *conn;
+  MYSQL_STMT                             *stmt;
+  MYSQL_BIND                              param[1];
+  MYSQL_BIND                              result[10];
+  unsigned long                           length[10];
+  hss_db_bool_t                           is_null[10];
+  mysql_pdn_t                             pdn;
+  char                                    pdn_type[16];
+  char                                    pre_emp_cap[16];
+  char                                    pre_emp_vul[16];
+  uint32_t                                qci;
+  uint32_t                                priority_level;
   mysql_pdn_t                            *pdn_array = NULL;
-
-  if (db_desc->db_conn == NULL) {
-    return EINVAL;
-  }
+  uint64_t                                nb_rows;
 
   if (nb_pdns == NULL || pdns_p == NULL) {
     return EINVAL;
   }
 
-  sprintf (query, "SELECT * FROM `pdn` WHERE " "`pdn`.`users_imsi`=%s LIMIT 10; ", imsi);
-  FPRINTF_DEBUG ("Query: %s\n", query);
-  pthread_mutex_lock (&db_desc->db_cs_mutex);
-
-  if (mysql_query (db_desc->db_conn, query)) {
-    pthread_mutex_unlock (&db_desc->db_cs_mutex);
-    fprintf (stderr, "Query execution failed: %s\n", mysql_error (db_desc->db_conn));
+  hss_mysql_bind (&param[0], MYSQL_TYPE_STRING, (char *)imsi, strlen (imsi), NULL, NULL);
+  hss_mysql_bind (&result[0], MYSQL_TYPE_STRING, pdn.apn, sizeof (pdn.apn) - 1, &length[0], &is_null[0]);
+  hss_mysql_bind (&result[1], MYSQL_TYPE_STRING, pdn_type, sizeof (pdn_type) - 1, &length[1], &is_null[1]);
+  hss_mysql_bind (&result[2], MYSQL_TYPE_STRING, pdn.pdn_address.ipv4_address, sizeof (pdn.pdn_address.ipv4_address) - 1, &length[2], &is_null[2]);
+  hss_mysql_bind (&result[3], MYSQL_TYPE_STRING, pdn.pdn_address.ipv6_address, sizeof (pdn.pdn_address.ipv6_address) - 1, &length[3], &is_null[3]);
+  hss_mysql_bind (&result[4], MYSQL_TYPE_LONG, &pdn.aggr_ul, sizeof (pdn.aggr_ul), &length[4], &is_null[4]);
+  hss_mysql_bind (&result[5], MYSQL_TYPE_LONG, &pdn.aggr_dl, sizeof (pdn.aggr_dl), &length[5], &is_null[5]);
+  hss_mysql_bind (&result[6], MYSQL_TYPE_LONG, &qci, sizeof (qci), &length[6], &is_null[6]);
+  hss_mysql_bind (&result[7], MYSQL_TYPE_LONG, &priority_level, sizeof (priority_level), &length[7], &is_null[7]);
+  hss_mysql_bind (&result[8], MYSQL_TYPE_STRING, pre_emp_cap, sizeof (pre_emp_cap) - 1, &length[8], &is_null[8]);
+  hss_mysql_bind (&result[9], MYSQL_TYPE_STRING, pre_emp_vul, sizeof (pre_emp_vul) - 1, &length[9], &is_null[9]);
+
+  if ((conn = hss_mysql_conn_get ()) == NULL) {
     return EINVAL;
   }
 
-  res = mysql_store_result (db_desc->db_conn);
-  pthread_mutex_unlock (&db_desc->db_cs_mutex);
-
-  if ( res == NULL )
+  if ((stmt = hss_mysql_stmt_execute (conn, HSS_DB_STMT_QUERY_PDNS, param, result)) == NULL) {
+    hss_mysql_conn_put (conn);
     return EINVAL;
+  }
 
   *nb_pdns = 0;
 
-  while ((row = mysql_fetch_row (res)) != NULL) {
-    mysql_pdn_t                            *pdn_elm;    /* Local PDN element in array */
-    unsigned long                          *lengths;
-
-    lengths = mysql_fetch_lengths (res);
-    *nb_pdns += 1;
-
-    if (*nb_pdns == 1) {
-      /*
-       * First row, must malloc
-       */
-      pdn_array = malloc (sizeof (mysql_pdn_t));
-    } else {
-      pdn_array = realloc (pdn_array, *nb_pdns * sizeof (mysql_pdn_t));
-    }
-
-    if (pdn_array == NULL) {
+  /*
+   * The result set is buffered, its size is known
+   */
+  if ((nb_rows = mysql_stmt_num_rows (stmt)) > 0) {
+    if ((pdn_array = calloc (nb_rows, sizeof (mysql_pdn_t))) == NULL) {
       /*
        * Error on malloc
        */
       ret = ENOMEM;
       goto err;
     }
+  }
+
+  while (*nb_pdns < nb_rows) {
+    mysql_pdn_t                            *pdn_elm;    /* Local PDN element in array */
+
+    memset (&pdn, 0, sizeof (mysql_pdn_t));
+    memset (pdn_type, 0, sizeof (pdn_type));
+    memset (pre_emp_cap, 0, sizeof (pre_emp_cap));
+    memset (pre_emp_vul, 0, sizeof (pre_emp_vul));
+    rc = mysql_stmt_fetch (stmt);
+
+    if ((rc != 0) && (rc != MYSQL_DATA_TRUNCATED)) {
+      break;
+    }
 
-    pdn_elm = &pdn_array[*nb_pdns - 1];
+    pdn_elm = &pdn_array[*nb_pdns];
+    *nb_pdns += 1;
     /*
      * Copying the APN
      */
-    memset (pdn_elm, 0, sizeof (mysql_pdn_t));
-    memcpy (pdn_elm->apn, row[1], lengths[1]);
+    memcpy (pdn_elm->apn, pdn.apn, sizeof (pdn.apn));
 
     /*
      * PDN Type + PDN address
      */
-    if (strcmp (row[2], "IPv6") == 0) {
+    if (strcmp (pdn_type, "IPv6") == 0) {
       pdn_elm->pdn_type = IPV6;
-      memcpy (pdn_elm->pdn_address.ipv6_address, row[4], lengths[4]);
-      pdn_elm->pdn_address.ipv6_address[lengths[4]] = '\0';
-    } else if (strcmp (row[2], "IPv4v6") == 0) {
+      memcpy (pdn_elm->pdn_address.ipv6_address, pdn.pdn_address.ipv6_address, sizeof (pdn.pdn_address.ipv6_address));
+    } else if (strcmp (pdn_type, "IPv4v6") == 0) {
       pdn_elm->pdn_type = IPV4V6;
-      memcpy (pdn_elm->pdn_address.ipv4_address, row[3], lengths[3]);
-      pdn_elm->pdn_address.ipv4_address[lengths[3]] = '\0';
-      memcpy (pdn_elm->pdn_address.ipv6_address, row[4], lengths[4]);
-      pdn_elm->pdn_address.ipv6_address[lengths[4]] = '\0';
-    } else if (strcmp (row[2], "IPv4_or_IPv6") == 0) {
+      memcpy (&pdn_elm->pdn_address, &pdn.pdn_address, sizeof (pdn_address_t));
+    } else if (strcmp (pdn_type, "IPv4_or_IPv6") == 0) {
       pdn_elm->pdn_type = IPV4_OR_IPV6;
-      memcpy (pdn_elm->pdn_address.ipv4_address, row[3], lengths[3]);
-      pdn_elm->pdn_address.ipv4_address[lengths[3]] = '\0';
-      memcpy (pdn_elm->pdn_address.ipv6_address, row[4], lengths[4]);
-      pdn_elm->pdn_address.ipv6_address[lengths[4]] = '\0';
+      memcpy (&pdn_elm->pdn_address, &pdn.pdn_address, sizeof (pdn_address_t));
     } else {
       pdn_elm->pdn_type = IPV4;
-      memcpy (pdn_elm->pdn_address.ipv4_address, row[3], lengths[3]);
-      pdn_elm->pdn_address.ipv4_address[lengths[3]] = '\0';
+      memcpy (pdn_elm->pdn_address.ipv4_address, pdn.pdn_address.ipv4_address, sizeof (pdn.pdn_address.ipv4_address));
     }
 
-    pdn_elm->aggr_ul = atoi (row[5]);
-    pdn_elm->aggr_dl = atoi (row[6]);
-    pdn_elm->qci = atoi (row[9]);
-    pdn_elm->priority_level = atoi (row[10]);
+    pdn_elm->aggr_ul = pdn.aggr_ul;
+    pdn_elm->aggr_dl = pdn.aggr_dl;
+    pdn_elm->qci = qci;
+    pdn_elm->priority_level = priority_level;
 
-    if (strcmp (row[11], "ENABLED") == 0) {
+    if (strcmp (pre_emp_cap, "ENABLED") == 0) {
       pdn_elm->pre_emp_cap = 0;
     } else {
       pdn_elm->pre_emp_cap = 1;
     }
 
-    if (strcmp (row[12], "DISABLED") == 0) {
+    if (strcmp (pre_emp_vul, "DISABLED") == 0) {
       pdn_elm->pre_emp_vul = 1;
     } else {
       pdn_elm->pre_emp_vul = 0;
     }
   }
 
-  mysql_free_result (res);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
 
   /*
    * We did not find any APN for the requested IMSI
    */
   if (*nb_pdns == 0) {
+    free (pdn_array);
     return EINVAL;
   } else {
     *pdns_p = pdn_array;
@@ -166,6 +174,7 @@ err:
   pdn_array = NULL;
   *pdns_p = pdn_array;
   *nb_pdns = 0;
-  mysql_free_result (res);
+  mysql_stmt_free_result (stmt);
+  hss_mysql_conn_put (conn);
   return ret;
 }
@@ -232,77 +232,85 @@ s6a_auth_info_cb (
     goto out;
   }
 
+  if (num_vectors == 0) {
+    num_vectors = 1;
+  }
+
   /*
-   * Fetch User data
+   * The RANDs do not depend on the subscriber data, pick them first so that a
+   * single statement stores the last one, reads the key and OPc and reserves
+   * one SQN per vector
    */
-  int rc = hss_mysql_auth_info (&auth_info_req, &auth_info_resp);
-  if (rc != 0) {
-    result_code = rc;
-    /*
-     * Database query failed...
-     */
-    if (DIAMETER_ERROR_USER_UNKNOWN == result_code) {
-      experimental = 1;
-      goto out;
-    }
-    result_code = DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE;
-    experimental = 1;
-    goto out;
+  for (int i = 0; i < num_vectors; i++) {
+    generate_random (vector[i].rand, RAND_LENGTH);
   }
 
   if (auts != NULL) {
     /*
-     * Try to derive SQN_MS from previous RAND
+     * SQN_MS = Conc(SQN_MS) ^ f5*(K, OPc, RAND) is needed before the SQNs can
+     * be reserved after it, and the database cannot run f5*. The key, OPc and
+     * RAND of the last reservation made here are kept by the db layer, so a
+     * resync usually takes the reservation only. When they are unknown or
+     * stale (another HSS answered the last AIR, the key changed), MAC-S does
+     * not match and they are read from the database first.
      */
-    sqn = sqn_ms_derive (auth_info_resp.opc, auth_info_resp.key, auts, auth_info_resp.rand);
-
-    if (sqn != NULL) {
-      /*
-       * We succeeded to verify SQN_MS...
-       */
-      /*
-       * Pick a new RAND and store SQN_MS + RAND in the HSS
-       */
-      generate_random (vector[0].rand, RAND_LENGTH);
-      hss_mysql_push_rand_sqn (auth_info_req.imsi, vector[0].rand, sqn);
-      hss_mysql_increment_sqn (auth_info_req.imsi);
-      free (sqn);
+    if (hss_mysql_air_cache_get (auth_info_req.imsi, &auth_info_resp) == 0) {
+      sqn = sqn_ms_derive (auth_info_resp.opc, auth_info_resp.key, auts, auth_info_resp.rand);
     }
 
-    /*
-     * Fetch new user data
-     */
-    if (hss_mysql_auth_info (&auth_info_req, &auth_info_resp) != 0) {
+    if (sqn == NULL) {
+      int rc = hss_mysql_auth_info (&auth_info_req, &auth_info_resp);
+
+      if (rc != 0) {
+        result_code = (DIAMETER_ERROR_USER_UNKNOWN == rc) ? DIAMETER_ERROR_USER_UNKNOWN : DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE;
+        experimental = 1;
+        goto out;
+      }
+
       /*
-       * Database query failed...
+       * On success the SQNs are reserved after SQN_MS
        */
-      result_code = DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE;
-      experimental = 1;
-      goto out;
+      sqn = sqn_ms_derive (auth_info_resp.opc, auth_info_resp.key, auts, auth_info_resp.rand);
     }
+  }
 
-    sqn = auth_info_resp.sqn;
-    for (int i = 0; i < num_vectors; i++) {
-      generate_random (vector[i].rand, RAND_LENGTH);
-      generate_vector (auth_info_resp.opc, imsi, auth_info_resp.key, hdr->avp_value->os.data, sqn, &vector[i]);
-    }
-    hss_mysql_push_rand_sqn (auth_info_req.imsi, vector[num_vectors-1].rand, sqn);
-  } else {
+  int rc = hss_mysql_air_reserve_sqn (auth_info_req.imsi, vector[num_vectors - 1].rand, num_vectors, sqn, &auth_info_resp);
+
+  if (sqn != NULL) {
+    free (sqn);
+  }
+
+  if (rc != 0) {
     /*
-     * Pick a new RAND and store SQN_MS + RAND in the HSS
+     * Database query failed...
      */
+    result_code = (DIAMETER_ERROR_USER_UNKNOWN == rc) ? DIAMETER_ERROR_USER_UNKNOWN : DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE;
+    experimental = 1;
+    goto out;
+  }
+
+  {
+    uint64_t                                sqn_base;
+    uint64_t                                sqn_vector;
+    uint8_t                                 sqn_bytes[SQN_LENGTH];
+
+    sqn_base = ((uint64_t) auth_info_resp.sqn[0] << 40) | ((uint64_t) auth_info_resp.sqn[1] << 32) | ((uint64_t) auth_info_resp.sqn[2] << 24) |
+      (auth_info_resp.sqn[3] << 16) | (auth_info_resp.sqn[4] << 8) | auth_info_resp.sqn[5];
+
     for (int i = 0; i < num_vectors; i++) {
-      generate_random (vector[i].rand, RAND_LENGTH);
-      sqn = auth_info_resp.sqn;
       /*
-       * Generate authentication vector
+       * Generate authentication vector, the reserved SQNs are 32 apart
        */
-      generate_vector (auth_info_resp.opc, imsi, auth_info_resp.key, hdr->avp_value->os.data, sqn, &vector[i]);
+      sqn_vector = sqn_base + 32 * i;
+
+      for (int j = 0; j < SQN_LENGTH; j++) {
+        sqn_bytes[j] = (sqn_vector >> (8 * (SQN_LENGTH - 1 - j))) & 0xFF;
+      }
+
+      generate_vector (auth_info_resp.opc, imsi, auth_info_resp.key, hdr->avp_value->os.data, sqn_bytes, &vector[i]);
     }
-    hss_mysql_push_rand_sqn (auth_info_req.imsi, vector[num_vectors-1].rand, sqn);
   }
 
-  hss_mysql_increment_sqn (auth_info_req.imsi);
   /*
    * We add the vector
    */
@@ -0,0 +1,357 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under 
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.  
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Replays the database side of the S6a AIR and ULR procedures against a
+ * populated oai_db, as the freeDiameter worker threads do, with as many
+ * connections in the pool as threads. For each pool size, one phase per
+ * procedure measures requests/s, latency and DB round trips per request:
+ *   AIR/3: hss_mysql_auth_info, hss_mysql_push_rand_sqn, hss_mysql_increment_sqn
+ *   AIR:   hss_mysql_air_reserve_sqn
+ *   AIR/R: resync, hss_mysql_air_cache_get (hss_mysql_auth_info when the IMSI
+ *          is not cached), hss_mysql_air_reserve_sqn after SQN_MS
+ *   ULR:   hss_mysql_update_loc, mysql_push_up_loc, hss_mysql_query_pdns
+ * Linked with hss_db_emu.c instead of the client library, it runs without a
+ * server: the numbers then only show how the pool scales with the round trips.
+ * Fails if a request failed.
+ *
+ * hss_db_bench <server> <user> <password> <database> <first imsi> <nb imsi> [max threads] [seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hss_config.h"
+#include "db_proto.h"
+
+#define BENCH_VECTORS           (3)
+/* Latency histogram, 10 us buckets up to 50 ms */
+#define BENCH_LAT_BUCKET_NS     (10000)
+#define BENCH_LAT_BUCKETS       (5000)
+
+typedef enum {
+  BENCH_AIR_3_QUERIES = 0,
+  BENCH_AIR,
+  BENCH_AIR_RESYNC,
+  BENCH_ULR,
+  BENCH_MAX,
+} bench_phase_t;
+
+static const char                      *bench_phase_names[BENCH_MAX] = {
+  [BENCH_AIR_3_QUERIES] = "AIR/3",
+  [BENCH_AIR] = "AIR",
+  [BENCH_AIR_RESYNC] = "AIR/R",
+  [BENCH_ULR] = "ULR",
+};
+
+typedef struct bench_thread_s {
+  pthread_t                               thread;
+  bench_phase_t                           phase;
+  unsigned int                            seed;
+  uint64_t                                nb_requests;
+  uint64_t                                nb_errors;
+  uint64_t                                lat_sum_ns;
+  uint32_t                                lat_hist[BENCH_LAT_BUCKETS + 1];
+} bench_thread_t;
+
+static uint64_t                         first_imsi;
+static uint64_t                         nb_imsi;
+static volatile int                     running;
+
+//------------------------------------------------------------------------------
+static uint64_t
+bench_now_ns (
+  void)
+{
+  struct timespec                         ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static int
+bench_air_3_queries (
+  bench_thread_t * bt,
+  const char *imsi)
+{
+  mysql_auth_info_req_t                   req;
+  mysql_auth_info_resp_t                  resp;
+  uint8_t                                 rand_p[RAND_LENGTH];
+  int                                     i;
+
+  memcpy (req.imsi, imsi, IMSI_LENGTH_MAX + 1);
+
+  if (hss_mysql_auth_info (&req, &resp) != 0) {
+    return -1;
+  }
+
+  for (i = 0; i < RAND_LENGTH; i++) {
+    rand_p[i] = rand_r (&bt->seed);
+  }
+
+  if (hss_mysql_push_rand_sqn (imsi, rand_p, resp.sqn) != 0) {
+    return -1;
+  }
+
+  return hss_mysql_increment_sqn (imsi);
+}
+
+//------------------------------------------------------------------------------
+static int
+bench_air (
+  bench_thread_t * bt,
+  const char *imsi)
+{
+  mysql_auth_info_resp_t                  resp;
+  uint8_t                                 rand_p[RAND_LENGTH];
+  int                                     i;
+
+  for (i = 0; i < RAND_LENGTH; i++) {
+    rand_p[i] = rand_r (&bt->seed);
+  }
+
+  return hss_mysql_air_reserve_sqn (imsi, rand_p, BENCH_VECTORS, NULL, &resp);
+}
+
+//------------------------------------------------------------------------------
+static int
+bench_air_resync (
+  bench_thread_t * bt,
+  const char *imsi)
+{
+  mysql_auth_info_req_t                   req;
+  mysql_auth_info_resp_t                  resp;
+  uint8_t                                 rand_p[RAND_LENGTH];
+  uint8_t                                 sqn_ms[SQN_LENGTH] = {0, 0, 0, 0, 0x10, 0};
+  int                                     i;
+
+  if (hss_mysql_air_cache_get (imsi, &resp) != 0) {
+    memcpy (req.imsi, imsi, IMSI_LENGTH_MAX + 1);
+
+    if (hss_mysql_auth_info (&req, &resp) != 0) {
+      return -1;
+    }
+  }
+
+  for (i = 0; i < RAND_LENGTH; i++) {
+    rand_p[i] = rand_r (&bt->seed);
+  }
+
+  return hss_mysql_air_reserve_sqn (imsi, rand_p, BENCH_VECTORS, sqn_ms, &resp);
+}
+
+//------------------------------------------------------------------------------
+static int
+bench_ulr (
+  const char *imsi)
+{
+  mysql_ul_ans_t                          ans;
+  mysql_ul_push_t                         push;
+  mysql_pdn_t                            *pdns = NULL;
+  uint8_t                                 nb_pdns = 0;
+
+  memset (&ans, 0, sizeof (ans));
+
+  if (hss_mysql_update_loc (imsi, &ans) != 0) {
+    return -1;
+  }
+
+  memset (&push, 0, sizeof (push));
+  memcpy (push.imsi, imsi, IMSI_LENGTH_MAX + 1);
+  push.mme_identity_present = MME_IDENTITY_PRESENT;
+  strcpy (push.mme_identity.mme_host, "bench-mme.openair4G.eur");
+  strcpy (push.mme_identity.mme_realm, "openair4G.eur");
+
+  if (mysql_push_up_loc (&push) != 0) {
+    return -1;
+  }
+
+  if (hss_mysql_query_pdns (imsi, &pdns, &nb_pdns) != 0) {
+    return -1;
+  }
+
+  free (pdns);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+static void                            *
+bench_thread (
+  void *arg)
+{
+  bench_thread_t                         *bt = (bench_thread_t *) arg;
+  char                                    imsi[IMSI_LENGTH_MAX + 1];
+  uint64_t                                start;
+  uint64_t                                lat;
+  int                                     rc;
+
+  while (running) {
+    snprintf (imsi, sizeof (imsi), "%015" PRIu64, first_imsi + rand_r (&bt->seed) % nb_imsi);
+    start = bench_now_ns ();
+
+    switch (bt->phase) {
+    case BENCH_AIR_3_QUERIES:
+      rc = bench_air_3_queries (bt, imsi);
+      break;
+
+    case BENCH_AIR:
+      rc = bench_air (bt, imsi);
+      break;
+
+    case BENCH_AIR_RESYNC:
+      rc = bench_air_resync (bt, imsi);
+      break;
+
+    default:
+      rc = bench_ulr (imsi);
+      break;
+    }
+
+    lat = bench_now_ns () - start;
+
+    if (rc != 0) {
+      bt->nb_errors++;
+      continue;
+    }
+
+    bt->nb_requests++;
+    bt->lat_sum_ns += lat;
+    bt->lat_hist[(lat / BENCH_LAT_BUCKET_NS < BENCH_LAT_BUCKETS) ? lat / BENCH_LAT_BUCKET_NS : BENCH_LAT_BUCKETS]++;
+  }
+
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static int
+bench_run (
+  const int nb_threads,
+  const bench_phase_t phase,
+  const int seconds)
+{
+  bench_thread_t                         *threads;
+  uint32_t                                lat_hist[BENCH_LAT_BUCKETS + 1] = {0};
+  uint64_t                                nb_requests = 0, nb_errors = 0, lat_sum_ns = 0;
+  uint64_t                                round_trips, start, seen;
+  double                                  elapsed;
+  int                                     i, b;
+
+  threads = calloc (nb_threads, sizeof (bench_thread_t));
+  round_trips = hss_mysql_round_trips ();
+  running = 1;
+  start = bench_now_ns ();
+
+  for (i = 0; i < nb_threads; i++) {
+    threads[i].phase = phase;
+    threads[i].seed = i + 1;
+    pthread_create (&threads[i].thread, NULL, bench_thread, &threads[i]);
+  }
+
+  sleep (seconds);
+  running = 0;
+
+  for (i = 0; i < nb_threads; i++) {
+    pthread_join (threads[i].thread, NULL);
+    nb_requests += threads[i].nb_requests;
+    nb_errors += threads[i].nb_errors;
+    lat_sum_ns += threads[i].lat_sum_ns;
+
+    for (b = 0; b <= BENCH_LAT_BUCKETS; b++) {
+      lat_hist[b] += threads[i].lat_hist[b];
+    }
+  }
+
+  elapsed = (bench_now_ns () - start) / 1e9;
+  round_trips = hss_mysql_round_trips () - round_trips;
+
+  for (b = 0, seen = 0; (b < BENCH_LAT_BUCKETS) && (seen < nb_requests - nb_requests / 100); b++) {
+    seen += lat_hist[b];
+  }
+
+  printf ("pool %3d %-5s: %9.0f requests/s, latency avg %7.1f us p99 %6d us, %4.2f round trips/request (%" PRIu64 " errors)\n",
+          nb_threads, bench_phase_names[phase], nb_requests / elapsed,
+          nb_requests ? lat_sum_ns / 1e3 / nb_requests : 0.0, b * BENCH_LAT_BUCKET_NS / 1000,
+          (nb_requests + nb_errors) ? (double)round_trips / (nb_requests + nb_errors) : 0.0, nb_errors);
+  free (threads);
+  return ((nb_errors == 0) && (nb_requests > 0)) ? 0 : -1;
+}
+
+int
+main (
+  int argc,
+  char *argv[])
+{
+  hss_config_t                            hss_config;
+  int                                     max_threads = 16;
+  int                                     seconds = 5;
+  int                                     n;
+  int                                     rc = 0;
+  bench_phase_t                           phase;
+
+  if (argc < 7) {
+    fprintf (stderr, "Usage: %s <server> <user> <password> <database> <first imsi> <nb imsi> [max threads] [seconds]\n", argv[0]);
+    return 1;
+  }
+
+  memset (&hss_config, 0, sizeof (hss_config));
+  hss_config.mysql_server = argv[1];
+  hss_config.mysql_user = argv[2];
+  hss_config.mysql_password = argv[3];
+  hss_config.mysql_database = argv[4];
+  first_imsi = strtoull (argv[5], NULL, 10);
+  nb_imsi = strtoull (argv[6], NULL, 10);
+
+  if (argc > 7) {
+    max_threads = atoi (argv[7]);
+  }
+
+  if (argc > 8) {
+    seconds = atoi (argv[8]);
+  }
+
+  if ((nb_imsi == 0) || (max_threads < 1) || (max_threads > HSS_MYSQL_POOL_SIZE_MAX) || (seconds < 1)) {
+    fprintf (stderr, "Bad arguments\n");
+    return 1;
+  }
+
+  for (n = 1; n <= max_threads; n *= 2) {
+    hss_config.mysql_pool_size = n;
+
+    if (hss_mysql_connect (&hss_config) != 0) {
+      return 1;
+    }
+
+    for (phase = 0; phase < BENCH_MAX; phase++) {
+      rc |= bench_run (n, phase, seconds);
+    }
+
+    hss_mysql_disconnect ();
+  }
+
+  return (rc == 0) ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Client library calls of the db layer, answered without a server so that
+ * hss_db_bench can run where no MySQL server is installed. Each statement
+ * execution costs one round trip of HSS_DB_EMU_RTT_US microseconds (default
+ * 200) on its connection, connections overlap as they would on a server with
+ * enough cores. A SELECT or CALL returns one row with all columns set, an
+ * UPDATE or INSERT touches one row.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <mysql/mysql.h>
+
+#include "hss_config.h"
+#include "db_proto.h"
+
+#define HSS_DB_EMU_RTT_US_DEFAULT (200)
+
+typedef struct hss_db_emu_stmt_s {
+  const char                             *query;
+  MYSQL_BIND                             *results;
+  int                                     nb_results;
+  int                                     nb_rows;
+} hss_db_emu_stmt_t;
+
+static long                             hss_db_emu_rtt_ns = -1;
+
+//------------------------------------------------------------------------------
+static void
+hss_db_emu_round_trip (
+  void)
+{
+  struct timespec                         ts;
+  const char                             *rtt_us;
+
+  if (hss_db_emu_rtt_ns < 0) {
+    rtt_us = getenv ("HSS_DB_EMU_RTT_US");
+    hss_db_emu_rtt_ns = 1000L * ((rtt_us) ? atol (rtt_us) : HSS_DB_EMU_RTT_US_DEFAULT);
+  }
+
+  ts.tv_sec = hss_db_emu_rtt_ns / 1000000000L;
+  ts.tv_nsec = hss_db_emu_rtt_ns % 1000000000L;
+  nanosleep (&ts, NULL);
+}
+
+/*
+ * Columns of the result set: the select list up to FROM, the CALL of the AIR
+ * procedure returns key, OPc and SQN
+ */
+//------------------------------------------------------------------------------
+static int
+hss_db_emu_nb_columns (
+  const char *query)
+{
+  const char                             *from;
+  int                                     nb = 1;
+
+  if (strncmp (query, "CALL", 4) == 0) {
+    return 3;
+  }
+
+  if ((strncmp (query, "SELECT", 6) != 0) || ((from = strstr (query, " FROM ")) == NULL)) {
+    return 0;
+  }
+
+  for (; query < from; query++) {
+    nb += (*query == ',');
+  }
+
+  return nb;
+}
+
+int
+mysql_library_init (
+  int argc,
+  char **argv,
+  char **groups)
+{
+  return 0;
+}
+
+void
+mysql_library_end (
+  void)
+{
+}
+
+MYSQL                                  *
+mysql_init (
+  MYSQL * mysql)
+{
+  return (mysql) ? mysql : calloc (1, sizeof (MYSQL));
+}
+
+MYSQL                                  *
+mysql_real_connect (
+  MYSQL * mysql,
+  const char *host,
+  const char *user,
+  const char *passwd,
+  const char *db,
+  unsigned int port,
+  const char *unix_socket,
+  unsigned long clientflag)
+{
+  hss_db_emu_round_trip ();
+  return mysql;
+}
+
+const char                             *
+mysql_error (
+  MYSQL * mysql)
+{
+  return "";
+}
+
+void
+mysql_close (
+  MYSQL * mysql)
+{
+  free (mysql);
+}
+
+int
+mysql_query (
+  MYSQL * mysql,
+  const char *q)
+{
+  hss_db_emu_round_trip ();
+  return 0;
+}
+
+/* No text query result: the OPc check finds no subscriber */
+MYSQL_RES                              *
+mysql_store_result (
+  MYSQL * mysql)
+{
+  return NULL;
+}
+
+MYSQL_ROW
+mysql_fetch_row (
+  MYSQL_RES * result)
+{
+  return NULL;
+}
+
+unsigned long                          *
+mysql_fetch_lengths (
+  MYSQL_RES * result)
+{
+  return NULL;
+}
+
+void
+mysql_free_result (
+  MYSQL_RES * result)
+{
+}
+
+MYSQL_STMT                             *
+mysql_stmt_init (
+  MYSQL * mysql)
+{
+  return (MYSQL_STMT *) calloc (1, sizeof (hss_db_emu_stmt_t));
+}
+
+int
+mysql_stmt_prepare (
+  MYSQL_STMT * stmt,
+  const char *query,
+  unsigned long length)
+{
+  hss_db_emu_stmt_t                      *emu = (hss_db_emu_stmt_t *) stmt;
+
+  emu->query = query;
+  emu->nb_results = hss_db_emu_nb_columns (query);
+  return 0;
+}
+
+hss_db_bool_t
+mysql_stmt_close (
+  MYSQL_STMT * stmt)
+{
+  free (stmt);
+  return 0;
+}
+
+hss_db_bool_t
+mysql_stmt_bind_param (
+  MYSQL_STMT * stmt,
+  MYSQL_BIND * bnd)
+{
+  return 0;
+}
+
+hss_db_bool_t
+mysql_stmt_bind_result (
+  MYSQL_STMT * stmt,
+  MYSQL_BIND * bnd)
+{
+  ((hss_db_emu_stmt_t *) stmt)->results = bnd;
+  return 0;
+}
+
+int
+mysql_stmt_execute (
+  MYSQL_STMT * stmt)
+{
+  hss_db_emu_stmt_t                      *emu = (hss_db_emu_stmt_t *) stmt;
+
+  hss_db_emu_round_trip ();
+  emu->nb_rows = (emu->nb_results > 0);
+  return 0;
+}
+
+int
+mysql_stmt_store_result (
+  MYSQL_STMT * stmt)
+{
+  return 0;
+}
+
+int
+mysql_stmt_fetch (
+  MYSQL_STMT * stmt)
+{
+  hss_db_emu_stmt_t                      *emu = (hss_db_emu_stmt_t *) stmt;
+  int                                     i;
+
+  if (emu->nb_rows == 0) {
+    return MYSQL_NO_DATA;
+  }
+
+  emu->nb_rows--;
+
+  for (i = 0; (emu->results) && (i < emu->nb_results); i++) {
+    if (emu->results[i].is_null) {
+      *emu->results[i].is_null = 0;
+    }
+
+    if (emu->results[i].length) {
+      *emu->results[i].length = 0;
+    }
+  }
+
+  return 0;
+}
+
+hss_db_bool_t
+mysql_stmt_free_result (
+  MYSQL_STMT * stmt)
+{
+  ((hss_db_emu_stmt_t *) stmt)->nb_rows = 0;
+  return 0;
+}
+
+int
+mysql_stmt_next_result (
+  MYSQL_STMT * stmt)
+{
+  return -1;
+}
+
+my_ulonglong
+mysql_stmt_num_rows (
+  MYSQL_STMT * stmt)
+{
+  return ((hss_db_emu_stmt_t *) stmt)->nb_rows;
+}
+
+my_ulonglong
+mysql_stmt_affected_rows (
+  MYSQL_STMT * stmt)
+{
+  return 1;
+}
+
+my_ulonglong
+mysql_stmt_insert_id (
+  MYSQL_STMT * stmt)
+{
+  return 32;
+}
+
+unsigned int
+mysql_stmt_errno (
+  MYSQL_STMT * stmt)
+{
+  return 0;
+}
+
+const char                             *
+mysql_stmt_error (
+  MYSQL_STMT * stmt)
+{
+  return "";
+}
@@ -59,6 +59,7 @@
 #define HSS_CONFIG_STRING_MYSQL_USER               "MYSQL_user"
 #define HSS_CONFIG_STRING_MYSQL_PASS               "MYSQL_pass"
 #define HSS_CONFIG_STRING_MYSQL_DB                 "MYSQL_db"
+#define HSS_CONFIG_STRING_MYSQL_POOL_SIZE          "MYSQL_pool_size"
 #define HSS_CONFIG_STRING_OPERATOR_KEY             "OPERATOR_key"
 #define HSS_CONFIG_STRING_RANDOM                   "RANDOM"
 #define HSS_CONFIG_STRING_FREEDIAMETER_CONF_FILE   "FD_conf"
@@ -192,6 +193,7 @@ hss_config_display (
   FPRINTF_NOTICE ( "\t- Database .........: %s\n", hss_config_p->mysql_database);
   FPRINTF_NOTICE ( "\t- User .............: %s\n", hss_config_p->mysql_user);
   FPRINTF_NOTICE ( "\t- Password .........: %s\n", (hss_config_p->mysql_password == NULL) ? "None" : "*****");
+  FPRINTF_NOTICE ( "\t- Pool size ........: %d\n", hss_config_p->mysql_pool_size);
   FPRINTF_NOTICE ( "* FreeDiameter:\n");
   FPRINTF_NOTICE ( "\t- Conf file ........: %s\n", hss_config_p->freediameter_config);
   FPRINTF_NOTICE ( "* Security:\n");
@@ -247,6 +249,7 @@ hss_config_parse_file (
   int                                     ret = -1;
   config_t                                cfg;
   const char                             *astring = NULL;
+  int                                     aint = 0;
   config_setting_t                       *setting = NULL;
 
   if (hss_config_p == NULL) {
@@ -295,6 +298,16 @@ hss_config_parse_file (
       return ret;
     }
 
+    if (  (config_setting_lookup_int( setting, HSS_CONFIG_STRING_MYSQL_POOL_SIZE, &aint) )) {
+      if ((aint < 1) || (aint > HSS_MYSQL_POOL_SIZE_MAX)) {
+        FPRINTF_ERROR( "Bad value %d for HSS configuration file token %s, must be in [1..%d]!\n", aint, HSS_CONFIG_STRING_MYSQL_POOL_SIZE, HSS_MYSQL_POOL_SIZE_MAX);
+        return ret;
+      }
+      hss_config_p->mysql_pool_size = aint;
+    } else {
+      hss_config_p->mysql_pool_size = HSS_MYSQL_POOL_SIZE_DEFAULT;
+    }
+
     if (  (config_setting_lookup_string( setting, HSS_CONFIG_STRING_OPERATOR_KEY, (const char **)&astring) )) {
       hss_config_p->operator_key = strdup(astring);
     } else {
@@ -22,11 +22,16 @@
 #ifndef HSS_CONFIG_H_
 #define HSS_CONFIG_H_
 
+#define HSS_MYSQL_POOL_SIZE_DEFAULT (4)
+#define HSS_MYSQL_POOL_SIZE_MAX     (64)
+
 typedef struct hss_config_s {
   char *mysql_server;
   char *mysql_user;
   char *mysql_password;
   char *mysql_database;
+  /* Number of connections to the database, one freeDiameter thread uses one at a time */
+  int   mysql_pool_size;
 
 
   char *operator_key;
@@ -144,6 +144,8 @@ main (
 
   MSC_INIT (MSC_SP_GW, THREAD_MAX + TASK_MAX);
   CHECK_INIT_RETURN (udp_init ());
+  // S11 sends the messages of a session straight to its SPGW_APP shard
+  s11_sgw_set_app_task_cb (sgw_app_task_of_s11_teid);
   CHECK_INIT_RETURN (s11_sgw_init (&spgw_config.sgw_config));
   //CHECK_INIT_RETURN (gtpv1u_init (&spgw_config));
   CHECK_INIT_RETURN (sgw_init (&spgw_config));
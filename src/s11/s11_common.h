@@ -28,6 +28,20 @@
 #ifndef FILE_S11_COMMON_SEEN
 #define FILE_S11_COMMON_SEEN
 
+/*
+ * ULP transaction handles of the requests sent by the MME: the upper byte tells
+ * which module sent the request, so that a response or a failure is never
+ * handed to another module; the rest is the value of this module.
+ */
+#define S11_MME_TRXN_TAG_SHIFT                ((sizeof (nw_gtpv2c_ulp_trxn_handle_t) - 1) * 8)
+#define S11_MME_TRXN_TAG_CREATE_SESSION       0x01  ///< value: EPS bearer id of the default bearer
+#define S11_MME_TRXN_TAG_ECHO                 0x02  ///< value: index of the S-GW in the path manager
+#define S11_MME_TRXN_TAG_RAB_WINDOW           0x03  ///< value: index of the Release Access Bearers window
+
+#define S11_MME_TRXN(tAg, vAlUe)              ((((nw_gtpv2c_ulp_trxn_handle_t) (tAg)) << S11_MME_TRXN_TAG_SHIFT) | ((nw_gtpv2c_ulp_trxn_handle_t) (vAlUe)))
+#define S11_MME_TRXN_TAG(hAnDlE)              ((uint8_t) (((nw_gtpv2c_ulp_trxn_handle_t) (hAnDlE)) >> S11_MME_TRXN_TAG_SHIFT))
+#define S11_MME_TRXN_VALUE(hAnDlE)            (((nw_gtpv2c_ulp_trxn_handle_t) (hAnDlE)) & ((((nw_gtpv2c_ulp_trxn_handle_t) 1) << S11_MME_TRXN_TAG_SHIFT) - 1))
+
 nw_rc_t s11_ie_indication_generic(uint8_t  ieType,
                                 uint8_t  ieLength,
                                 uint8_t  ieInstance,
@@ -27,6 +27,7 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <inttypes.h>
@@ -2023,3 +2024,146 @@ gtpv2c_fqcsid_ie_get (
   OAILOG_DEBUG (LOG_S11, "\t- CSID 0x%04x\n", fq_csid->csid);
   return NW_OK;
 }
+
+//------------------------------------------------------------------------------
+int
+s11_msg_decoder_init (
+  s11_msg_decoder_t * const decoder,
+  const uint8_t msg_type,
+  const s11_msg_decoder_ie_t * const ies,
+  const uint8_t ie_count)
+{
+  nw_gtpv2c_msg_parser_ie_t               parser_ies[NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM];
+
+  DevAssert (decoder);
+  DevAssert (NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM >= ie_count);
+  memset (decoder, 0, sizeof (*decoder));
+
+  for (uint8_t i = 0; i < ie_count; i++) {
+    DevAssert (S11_IE_DECODER_MAX > ies[i].decoder);
+    parser_ies[i].ieType = ies[i].ie_type;
+    parser_ies[i].ieInstance = ies[i].ie_instance;
+    parser_ies[i].iePresence = ies[i].ie_presence;
+    parser_ies[i].ieReadCallback = NULL;
+    parser_ies[i].ieReadCallbackArgOffset = (S11_IE_DECODER_NONE == ies[i].decoder) ? NW_GTPV2C_MSG_PARSER_IE_ARG_NONE : ies[i].offset;
+    // the template keeps the IEs in order, ie[i] of the template is ies[i]
+    decoder->decoder[i] = ies[i].decoder;
+  }
+
+  if (NW_OK != nwGtpv2cMsgParserTemplateInit (&decoder->parser, msg_type, NULL, parser_ies, ie_count)) {
+    OAILOG_ERROR (LOG_S11, "Cannot build the decoder of message %u\n", msg_type);
+    return RETURNerror;
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+nw_rc_t
+s11_msg_decode (
+  const s11_msg_decoder_t * const decoder,
+  nw_gtpv2c_msg_handle_t hMsg,
+  void * const msg,
+  uint8_t * const offending_ie_type,
+  uint8_t * const offending_ie_instance,
+  uint16_t * const offending_ie_length)
+{
+  nw_gtpv2c_msg_parser_walk_t             walk;
+  nw_rc_t                                 rc = NW_OK;
+
+  DevAssert (decoder);
+  DevAssert (msg);
+  nwGtpv2cMsgParserWalkStart (&decoder->parser, hMsg, &walk);
+
+  while ((NW_OK == (rc = nwGtpv2cMsgParserWalkNext (&decoder->parser, &walk, offending_ie_type, offending_ie_instance, offending_ie_length))) && (walk.pIeValue)) {
+    const uint8_t                           ie_type = walk.ieType;
+    const uint16_t                          ie_length = walk.ieLength;
+    const uint8_t                           ie_instance = walk.ieInstance;
+    uint8_t                                *ie_value = walk.pIeValue;
+    void                                   *arg = ((uint8_t *) msg) + decoder->parser.ie[walk.ieIndex].ieReadCallbackArgOffset;
+
+    switch (decoder->decoder[walk.ieIndex]) {
+    case S11_IE_DECODER_NONE:
+      break;
+    case S11_IE_DECODER_IMSI:
+      rc = gtpv2c_imsi_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_MSISDN:
+      rc = gtpv2c_msisdn_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_MEI:
+      rc = gtpv2c_mei_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_ULI:
+      rc = gtpv2c_uli_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_SERVING_NETWORK:
+      rc = gtpv2c_serving_network_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_RAT_TYPE:
+      rc = gtpv2c_rat_type_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_INDICATION_FLAGS:
+      rc = gtpv2c_indication_flags_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_APN:
+      rc = gtpv2c_apn_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_APN_RESTRICTION:
+      rc = gtpv2c_apn_restriction_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_PDN_TYPE:
+      rc = gtpv2c_pdn_type_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_PAA:
+      rc = gtpv2c_paa_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_FTEID:
+      rc = gtpv2c_fteid_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_PCO:
+      rc = gtpv2c_pco_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_AMBR:
+      rc = gtpv2c_ambr_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_EBI:
+      rc = gtpv2c_ebi_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_CAUSE:
+      rc = gtpv2c_cause_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_NODE_TYPE:
+      rc = gtpv2c_node_type_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_DELAY_VALUE:
+      rc = gtpv2c_delay_value_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_FQCSID:
+      rc = gtpv2c_fqcsid_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_SESSION_REQUEST:
+      rc = gtpv2c_bearer_context_to_be_created_within_create_session_request_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_BEARER_REQUEST:
+      rc = gtpv2c_bearer_context_to_be_created_within_create_bearer_request_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_BEARER_CONTEXT_WITHIN_CREATE_BEARER_RESPONSE:
+      rc = gtpv2c_bearer_context_within_create_bearer_response_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_BEARER_CONTEXT_TO_BE_MODIFIED_WITHIN_MODIFY_BEARER_REQUEST:
+      rc = gtpv2c_bearer_context_to_be_modified_within_modify_bearer_request_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    case S11_IE_DECODER_BEARER_CONTEXT_CREATED:
+      rc = gtpv2c_bearer_context_created_ie_get (ie_type, ie_length, ie_instance, ie_value, arg);
+      break;
+    default:
+      AssertFatal (0, "Unknown S11 IE decoder %d\n", decoder->decoder[walk.ieIndex]);
+    }
+
+    if (NW_OK != rc) {
+      OAILOG_ERROR (LOG_S11, "Error while decoding IE %u instance %u length %u in message %u\n", ie_type, ie_instance, ie_length, decoder->parser.msgType);
+      return rc;
+    }
+  }
+  return rc;
+}
@@ -204,4 +204,63 @@ int gtpv2c_indication_flags_ie_set (nw_gtpv2c_msg_handle_t * msg, const indicati
 
 nw_rc_t gtpv2c_fqcsid_ie_get(uint8_t ieType, uint8_t ieLength, uint8_t ieInstance, uint8_t *ieValue, void *arg);
 
+/* Decoders of the IEs received on S11, one per gtpv2c_*_ie_get() above.
+ * Messages are decoded by s11_msg_decode() in a single walk of their IEs
+ * with the nwgtpv2c parser template of the message, the decoder of each IE
+ * is selected with a switch instead of a callback per IE.
+ */
+typedef enum s11_ie_decoder_e {
+  S11_IE_DECODER_NONE = 0,                        ///< IE accepted, value not decoded
+  S11_IE_DECODER_IMSI,
+  S11_IE_DECODER_MSISDN,
+  S11_IE_DECODER_MEI,
+  S11_IE_DECODER_ULI,
+  S11_IE_DECODER_SERVING_NETWORK,
+  S11_IE_DECODER_RAT_TYPE,
+  S11_IE_DECODER_INDICATION_FLAGS,
+  S11_IE_DECODER_APN,
+  S11_IE_DECODER_APN_RESTRICTION,
+  S11_IE_DECODER_PDN_TYPE,
+  S11_IE_DECODER_PAA,
+  S11_IE_DECODER_FTEID,
+  S11_IE_DECODER_PCO,
+  S11_IE_DECODER_AMBR,
+  S11_IE_DECODER_EBI,
+  S11_IE_DECODER_CAUSE,
+  S11_IE_DECODER_NODE_TYPE,
+  S11_IE_DECODER_DELAY_VALUE,
+  S11_IE_DECODER_FQCSID,
+  S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_SESSION_REQUEST,
+  S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_BEARER_REQUEST,
+  S11_IE_DECODER_BEARER_CONTEXT_WITHIN_CREATE_BEARER_RESPONSE,
+  S11_IE_DECODER_BEARER_CONTEXT_TO_BE_MODIFIED_WITHIN_MODIFY_BEARER_REQUEST,
+  S11_IE_DECODER_BEARER_CONTEXT_CREATED,
+  S11_IE_DECODER_MAX
+} s11_ie_decoder_t;
+
+typedef struct s11_msg_decoder_ie_s {
+  uint8_t                     ie_type;
+  uint8_t                     ie_instance;
+  uint8_t                     ie_presence;
+  s11_ie_decoder_t            decoder;
+  size_t                      offset;             ///< Offset of the decoded value in the ITTI message, unused for S11_IE_DECODER_NONE
+} s11_msg_decoder_ie_t;
+
+/* Parser template of a message and the decoder of each of its IEs, built
+ * once at init from the list of IEs of the message.
+ */
+typedef struct s11_msg_decoder_s {
+  nw_gtpv2c_msg_parser_template_t parser;
+  uint8_t                     decoder[NW_GTPV2C_MSG_PARSER_TEMPLATE_IE_MAXIMUM]; ///< s11_ie_decoder_t of parser.ie[i]
+} s11_msg_decoder_t;
+
+int s11_msg_decoder_init (s11_msg_decoder_t * const decoder, const uint8_t msg_type, const s11_msg_decoder_ie_t * const ies, const uint8_t ie_count);
+
+/* Decode the IEs of a received message into the ITTI message msg.
+ * Returns NW_OK, or the error of the IE decoder, NW_GTPV2C_MSG_MALFORMED or
+ * NW_GTPV2C_MANDATORY_IE_MISSING with the offending IE.
+ */
+nw_rc_t s11_msg_decode (const s11_msg_decoder_t * const decoder, nw_gtpv2c_msg_handle_t hMsg, void * const msg,
+                        uint8_t * const offending_ie_type, uint8_t * const offending_ie_instance, uint16_t * const offending_ie_length);
+
 #endif /* FILE_S11_IE_FORMATTER_SEEN */
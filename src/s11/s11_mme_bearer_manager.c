@@ -26,13 +26,17 @@
   \email: lionel.gauthier@eurecom.fr
 */
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <arpa/inet.h>
 
 #include "bstrlib.h"
+#include "queue.h"
 
+#include "dynamic_memory_check.h"
 #include "hashtable.h"
 #include "obj_hashtable.h"
 #include "log.h"
@@ -52,11 +56,69 @@
 
 extern hash_table_ts_t                        *s11_mme_teid_2_gtv2c_teid_handle;
 
+/*
+ * Release Access Bearers Requests in flight are bounded per S-GW: on an
+ * eNB-wide release thousands of requests would otherwise be sent at once and
+ * their responses, retransmissions included, compete with other signalling.
+ * Requests above the window are queued in order and sent as responses come back.
+ */
+#define S11_MME_RAB_PEER_MAX                  8
+
+typedef struct s11_mme_rab_pending_s {
+  itti_s11_release_access_bearers_request_t   request;
+  STAILQ_ENTRY (s11_mme_rab_pending_s)        entries;
+} s11_mme_rab_pending_t;
+
+typedef struct s11_mme_rab_window_s {
+  struct in_addr                              peer_ip;
+  uint32_t                                    outstanding;
+  STAILQ_HEAD (s11_mme_rab_pending_list_s, s11_mme_rab_pending_s) pending;
+} s11_mme_rab_window_t;
+
+// TASK_S11 only
+static s11_mme_rab_window_t                   s11_mme_rab_window[S11_MME_RAB_PEER_MAX];
+static int                                    s11_mme_rab_nb_windows = 0;
+
+static const s11_msg_decoder_ie_t        s11_mme_release_access_bearers_response_ies[] = {
+  {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, offsetof (itti_s11_release_access_bearers_response_t, cause)},
+  // TODO {NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, s11_fteid_ie_get, offsetof (itti_s11_release_access_bearers_response_t, recovery)},
+};
+
+static s11_msg_decoder_t                s11_mme_release_access_bearers_response_decoder;
+
+static const s11_msg_decoder_ie_t        s11_mme_modify_bearer_response_ies[] = {
+  {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, offsetof (itti_s11_modify_bearer_response_t, cause)},
+  // TODO {NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, s11_fteid_ie_get, offsetof (itti_s11_modify_bearer_response_t, recovery)},
+};
+
+static s11_msg_decoder_t                s11_mme_modify_bearer_response_decoder;
+
+static const s11_msg_decoder_ie_t        s11_mme_create_bearer_request_ies[] = {
+  {NW_GTPV2C_IE_EBI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_EBI, offsetof (itti_s11_create_bearer_request_t, linked_eps_bearer_id)},
+  {NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, S11_IE_DECODER_PCO, offsetof (itti_s11_create_bearer_request_t, pco)},
+  {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_BEARER_REQUEST, offsetof (itti_s11_create_bearer_request_t, bearer_contexts)},
+};
+
+static s11_msg_decoder_t                s11_mme_create_bearer_request_decoder;
+
 //------------------------------------------------------------------------------
-int
-s11_mme_release_access_bearers_request (
+void
+s11_mme_bearer_manager_init (void)
+{
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_mme_release_access_bearers_response_decoder, NW_GTP_RELEASE_ACCESS_BEARERS_RSP,
+      s11_mme_release_access_bearers_response_ies, sizeof (s11_mme_release_access_bearers_response_ies) / sizeof (s11_mme_release_access_bearers_response_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_mme_modify_bearer_response_decoder, NW_GTP_MODIFY_BEARER_RSP,
+      s11_mme_modify_bearer_response_ies, sizeof (s11_mme_modify_bearer_response_ies) / sizeof (s11_mme_modify_bearer_response_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_mme_create_bearer_request_decoder, NW_GTP_CREATE_BEARER_REQ,
+      s11_mme_create_bearer_request_ies, sizeof (s11_mme_create_bearer_request_ies) / sizeof (s11_mme_create_bearer_request_ies[0])));
+}
+
+//------------------------------------------------------------------------------
+static int
+s11_mme_release_access_bearers_request_send (
   nw_gtpv2c_stack_handle_t * stack_p,
-  itti_s11_release_access_bearers_request_t * req_p)
+  itti_s11_release_access_bearers_request_t * req_p,
+  nw_gtpv2c_ulp_trxn_handle_t hUlpTrxn)
 {
   nw_gtpv2c_ulp_api_t                         ulp_req;
   nw_rc_t                                   rc;
@@ -72,12 +134,15 @@ s11_mme_release_access_bearers_request (
   rc = nwGtpv2cMsgNew (*stack_p, true, NW_GTP_RELEASE_ACCESS_BEARERS_REQ, req_p->teid, 0, &(ulp_req.hMsg));
   ulp_req.u_api_info.initialReqInfo.peerIp = req_p->peer_ip;
   ulp_req.u_api_info.initialReqInfo.teidLocal  = req_p->local_teid;
+  ulp_req.u_api_info.initialReqInfo.hUlpTrxn = hUlpTrxn;
 
   hashtable_rc_t hash_rc = hashtable_ts_get(s11_mme_teid_2_gtv2c_teid_handle,
       (hash_key_t) ulp_req.u_api_info.initialReqInfo.teidLocal, (void **)(uintptr_t)&ulp_req.u_api_info.initialReqInfo.hTunnel);
 
   if (HASH_TABLE_OK != hash_rc) {
     OAILOG_WARNING (LOG_S11, "Could not get GTPv2-C hTunnel for local teid %X\n", ulp_req.u_api_info.initialReqInfo.teidLocal);
+    rc = nwGtpv2cMsgDelete (*stack_p, (ulp_req.hMsg));
+    DevAssert (NW_OK == rc);
     return RETURNerror;
   }
 
@@ -91,6 +156,130 @@ s11_mme_release_access_bearers_request (
   return RETURNok;
 }
 
+//------------------------------------------------------------------------------
+static s11_mme_rab_window_t *
+s11_mme_rab_window_get (
+  const struct in_addr peer_ip)
+{
+  for (int i = 0; i < s11_mme_rab_nb_windows; i++) {
+    if (s11_mme_rab_window[i].peer_ip.s_addr == peer_ip.s_addr) {
+      return &s11_mme_rab_window[i];
+    }
+  }
+  if (S11_MME_RAB_PEER_MAX == s11_mme_rab_nb_windows) {
+    // no flow control for this S-GW
+    return NULL;
+  }
+  s11_mme_rab_window_t                   *window_p = &s11_mme_rab_window[s11_mme_rab_nb_windows++];
+
+  window_p->peer_ip = peer_ip;
+  window_p->outstanding = 0;
+  STAILQ_INIT (&window_p->pending);
+  return window_p;
+}
+
+//------------------------------------------------------------------------------
+int
+s11_mme_release_access_bearers_request (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  itti_s11_release_access_bearers_request_t * req_p)
+{
+  s11_mme_rab_window_t                   *window_p = s11_mme_rab_window_get (req_p->peer_ip);
+  int                                     rc = RETURNok;
+
+  if (!window_p) {
+    return s11_mme_release_access_bearers_request_send (stack_p, req_p, 0);
+  }
+
+  if (S11_MME_RAB_WINDOW <= window_p->outstanding) {
+    s11_mme_rab_pending_t                  *pending_p = calloc (1, sizeof (s11_mme_rab_pending_t));
+
+    DevAssert (pending_p);
+    pending_p->request = *req_p;
+    STAILQ_INSERT_TAIL (&window_p->pending, pending_p, entries);
+    return RETURNok;
+  }
+  // The window is identified in the transaction, returned with the response or the failure
+  window_p->outstanding += 1;
+  rc = s11_mme_release_access_bearers_request_send (stack_p, req_p, S11_MME_TRXN (S11_MME_TRXN_TAG_RAB_WINDOW, window_p - s11_mme_rab_window));
+  if (RETURNok != rc) {
+    window_p->outstanding -= 1;
+  }
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_release_access_bearers_window_release (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  nw_gtpv2c_ulp_trxn_handle_t hUlpTrxn)
+{
+  s11_mme_rab_window_t                   *window_p = NULL;
+  s11_mme_rab_pending_t                  *pending_p = NULL;
+
+  if ((S11_MME_TRXN_TAG_RAB_WINDOW != S11_MME_TRXN_TAG (hUlpTrxn)) || ((nw_gtpv2c_ulp_trxn_handle_t) s11_mme_rab_nb_windows <= S11_MME_TRXN_VALUE (hUlpTrxn))) {
+    // not a windowed Release Access Bearers Request
+    return;
+  }
+  window_p = &s11_mme_rab_window[S11_MME_TRXN_VALUE (hUlpTrxn)];
+  DevAssert (window_p->outstanding > 0);
+  window_p->outstanding -= 1;
+
+  while ((S11_MME_RAB_WINDOW > window_p->outstanding) && (!STAILQ_EMPTY (&window_p->pending))) {
+    pending_p = STAILQ_FIRST (&window_p->pending);
+    STAILQ_REMOVE_HEAD (&window_p->pending, entries);
+    window_p->outstanding += 1;
+    if (RETURNok != s11_mme_release_access_bearers_request_send (stack_p, &pending_p->request, hUlpTrxn)) {
+      window_p->outstanding -= 1;
+    }
+    free_wrapper ((void **)&pending_p);
+  }
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_release_access_bearers_window_drop (
+  const struct in_addr peer_ip)
+{
+  s11_mme_rab_pending_t                  *pending_p = NULL;
+  uint32_t                                nb_dropped = 0;
+
+  for (int i = 0; i < s11_mme_rab_nb_windows; i++) {
+    if (s11_mme_rab_window[i].peer_ip.s_addr != peer_ip.s_addr) {
+      continue;
+    }
+    while ((pending_p = STAILQ_FIRST (&s11_mme_rab_window[i].pending))) {
+      STAILQ_REMOVE_HEAD (&s11_mme_rab_window[i].pending, entries);
+      free_wrapper ((void **)&pending_p);
+      nb_dropped += 1;
+    }
+  }
+  if (nb_dropped) {
+    OAILOG_WARNING (LOG_S11, "Dropped %u queued Release Access Bearers Requests to S-GW %s\n", nb_dropped, inet_ntoa (peer_ip));
+  }
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_release_access_bearers_window_get (
+  const struct in_addr peer_ip,
+  uint32_t * const outstanding,
+  uint32_t * const pending)
+{
+  s11_mme_rab_pending_t                  *pending_p = NULL;
+
+  *outstanding = 0;
+  *pending = 0;
+  for (int i = 0; i < s11_mme_rab_nb_windows; i++) {
+    if (s11_mme_rab_window[i].peer_ip.s_addr == peer_ip.s_addr) {
+      *outstanding = s11_mme_rab_window[i].outstanding;
+      STAILQ_FOREACH (pending_p, &s11_mme_rab_window[i].pending, entries) {
+        *pending += 1;
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 int
 s11_mme_handle_release_access_bearer_response (
@@ -103,36 +292,18 @@ s11_mme_handle_release_access_bearer_response (
   uint16_t                                offendingIeLength;
   itti_s11_release_access_bearers_response_t  *resp_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_RELEASE_ACCESS_BEARERS_RESPONSE);
   resp_p = &message_p->ittiMsg.s11_release_access_bearers_response;
 
   resp_p->teid = nwGtpv2cMsgGetTeid(pUlpApi->hMsg);
+  s11_mme_release_access_bearers_window_release (stack_p, pUlpApi->u_api_info.triggeredRspIndInfo.hUlpTrxn);
 
   /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_RELEASE_ACCESS_BEARERS_RSP, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Cause IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, gtpv2c_cause_ie_get,
-		  &resp_p->cause);
-  DevAssert (NW_OK == rc);
-  /*
-   * Recovery IE
-   */
-  /*rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, s11_fteid_ie_get,
-		  &resp_p->recovery);
-  DevAssert (NW_OK == rc);*/
-
-  /*
-   * Run the parser
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_mme_release_access_bearers_response_decoder, (pUlpApi->hMsg), resp_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 RELEASE_ACCESS_BEARERS_RESPONSE local S11 teid " TEID_FMT " ", resp_p->teid);
@@ -141,8 +312,6 @@ s11_mme_handle_release_access_bearer_response (
      */
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNerror;
@@ -151,8 +320,6 @@ s11_mme_handle_release_access_bearer_response (
   MSC_LOG_RX_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 RELEASE_ACCESS_BEARERS_RESPONSE local S11 teid " TEID_FMT " cause %u",
     resp_p->teid, resp_p->cause);
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
   return itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
@@ -279,7 +446,6 @@ s11_mme_handle_modify_bearer_response (
   uint16_t                                offendingIeLength;
   itti_s11_modify_bearer_response_t      *resp_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_MODIFY_BEARER_RESPONSE);
@@ -288,27 +454,9 @@ s11_mme_handle_modify_bearer_response (
   resp_p->teid = nwGtpv2cMsgGetTeid(pUlpApi->hMsg);
 
   /*
-   * Create a new message parser
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_MODIFY_BEARER_RSP, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Cause IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, gtpv2c_cause_ie_get,
-      &resp_p->cause);
-  DevAssert (NW_OK == rc);
-  /*
-   * Recovery IE
-   */
-  /*rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, s11_fteid_ie_get,
-		  &resp_p->recovery);
-  DevAssert (NW_OK == rc);*/
-
-  /*
-   * Run the parser
-   */
-  rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_mme_modify_bearer_response_decoder, (pUlpApi->hMsg), resp_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 MODIFY_BEARER_RESPONSE local S11 teid " TEID_FMT " ", resp_p->teid);
@@ -317,8 +465,6 @@ s11_mme_handle_modify_bearer_response (
      */
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNerror;
@@ -326,8 +472,6 @@ s11_mme_handle_modify_bearer_response (
 
   MSC_LOG_RX_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 MODIFY_BEARER_RESPONSE local S11 teid " TEID_FMT " cause %u",
     resp_p->teid, resp_p->cause);
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
   return itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
@@ -345,7 +489,6 @@ s11_mme_handle_create_bearer_request (
   uint16_t                                offendingIeLength;
   itti_s11_create_bearer_request_t       *req_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_BEARER_REQUEST);
@@ -357,28 +500,9 @@ s11_mme_handle_create_bearer_request (
     req_p->trxn = (void *)pUlpApi->u_api_info.initialReqIndInfo.hTrxn;
 
     /*
-     * Create a new message parser
+     * Decode with the dispatch table built at init
      */
-    rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_CREATE_BEARER_REQ, s11_ie_indication_generic, NULL, &pMsgParser);
-    DevAssert (NW_OK == rc);
-
-    rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_EBI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, gtpv2c_ebi_ie_get,
-        &req_p->linked_eps_bearer_id);
-    DevAssert (NW_OK == rc);
-
-    rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, gtpv2c_pco_ie_get,
-        &req_p->pco);
-    DevAssert (NW_OK == rc);
-
-    rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-        gtpv2c_bearer_context_to_be_created_within_create_bearer_request_ie_get,
-        &req_p->bearer_contexts);
-    DevAssert (NW_OK == rc);
-
-    /*
-     * Run the parser
-     */
-    rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+    rc = s11_msg_decode (&s11_mme_create_bearer_request_decoder, (pUlpApi->hMsg), req_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
     if (rc != NW_OK) {
       MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_BEARER_REQUEST local S11 teid " TEID_FMT " ", req_p->teid);
@@ -387,8 +511,6 @@ s11_mme_handle_create_bearer_request (
        */
       itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
       message_p = NULL;
-      rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-      DevAssert (NW_OK == rc);
       rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
       DevAssert (NW_OK == rc);
       return RETURNerror;
@@ -396,8 +518,6 @@ s11_mme_handle_create_bearer_request (
 
     MSC_LOG_RX_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_BEARER_REQUEST local S11 teid " TEID_FMT " lebi %u",
         req_p->teid, req_p->linked_eps_bearer_id);
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
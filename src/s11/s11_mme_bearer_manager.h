@@ -29,10 +29,26 @@
 #ifndef FILE_S11_MME_BEARER_MANAGER_SEEN
 #define FILE_S11_MME_BEARER_MANAGER_SEEN
 
+// Release Access Bearers Requests in flight per S-GW
+#define S11_MME_RAB_WINDOW                    256
 
-/* @brief Create a new Release Access Bearers Request and send it to provided S-GW. */
+/* @brief Build the parsers of the bearer management messages received from S-GW, once at init. */
+void s11_mme_bearer_manager_init (void);
+
+/* @brief Create a new Release Access Bearers Request and send it to provided S-GW,
+ * or queue it if too many Release Access Bearers Requests are outstanding with this S-GW. */
 int s11_mme_release_access_bearers_request(nw_gtpv2c_stack_handle_t *stack_p, itti_s11_release_access_bearers_request_t *release_access_bearers_p);
 
+/* @brief A Release Access Bearers Request transaction ended (response or no response),
+ * send the next queued requests if any. */
+void s11_mme_release_access_bearers_window_release (nw_gtpv2c_stack_handle_t * stack_p, nw_gtpv2c_ulp_trxn_handle_t hUlpTrxn);
+
+/* @brief The path to a S-GW failed, drop the Release Access Bearers Requests queued for it. */
+void s11_mme_release_access_bearers_window_drop (const struct in_addr peer_ip);
+
+/* @brief Release Access Bearers Requests outstanding with and queued for a S-GW. */
+void s11_mme_release_access_bearers_window_get (const struct in_addr peer_ip, uint32_t * const outstanding, uint32_t * const pending);
+
 /* @brief Handle a Release Access Bearer Response received from S-GW. */
 int s11_mme_handle_release_access_bearer_response (nw_gtpv2c_stack_handle_t * stack_p, nw_gtpv2c_ulp_api_t * pUlpApi);
 
@@ -2,9 +2,9 @@
  * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
  * contributor license agreements.  See the NOTICE file distributed with
  * this work for additional information regarding copyright ownership.
- * The OpenAirInterface Software Alliance licenses this file to You under 
+ * The OpenAirInterface Software Alliance licenses this file to You under
  * the Apache License, Version 2.0  (the "License"); you may not use this file
- * except in compliance with the License.  
+ * except in compliance with the License.
  * You may obtain a copy of the License at
  *
  *      http://www.apache.org/licenses/LICENSE-2.0
@@ -19,5 +19,254 @@
  *      contact@openairinterface.org
  */
 
+/*! \file s11_mme_peer_manager.c
+  \brief S11 path management towards S-GWs
+  \company Eurecom
+
+  Echo Requests are sent periodically to each S-GW the MME sent a Create Session
+  Request to (3GPP TS 29.274 7.1). When an Echo Request is not answered after
+  N3 retransmissions, the path is declared down and all requests outstanding
+  with this S-GW are failed at once instead of each one waiting for its own
+  retransmissions; MME_APP is told so that it selects another S-GW.
+  A request other than Echo Request that is not answered triggers an Echo
+  Request right away, the path state is then known after one T3 x N3 period.
+  The restart counter of S-GWs received in Echo Responses is tracked
+  (3GPP TS 23.007 18).
+*/
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bstrlib.h"
+
+#include "log.h"
+#include "assertions.h"
+#include "intertask_interface.h"
+#include "timer.h"
+#include "mme_config.h"
+
+#include "NwGtpv2c.h"
+#include "NwGtpv2cIe.h"
+#include "NwGtpv2cMsg.h"
+
+#include "s11_common.h"
+#include "s11_mme_bearer_manager.h"
+#include "s11_mme_peer_manager.h"
+
+#define S11_MME_PEER_MAX                      MME_CONFIG_MAX_SGW
+
+typedef struct s11_mme_peer_s {
+  struct in_addr                              peer_ip;
+  bool                                        path_up;
+  bool                                        echo_outstanding;
+  bool                                        restart_counter_known;
+  uint8_t                                     restart_counter;
+} s11_mme_peer_t;
+
+// TASK_S11 only
+static s11_mme_peer_t                         s11_mme_peer[S11_MME_PEER_MAX];
+static int                                    s11_mme_nb_peers = 0;
+static long                                   s11_mme_echo_timer_id = 0;
+// identifies the echo timer in TIMER_HAS_EXPIRED
+static int                                    s11_mme_echo_timer_arg = 0;
+
+//------------------------------------------------------------------------------
+static s11_mme_peer_t *
+s11_mme_peer_get (
+  const struct in_addr peer_ip)
+{
+  for (int i = 0; i < s11_mme_nb_peers; i++) {
+    if (s11_mme_peer[i].peer_ip.s_addr == peer_ip.s_addr) {
+      return &s11_mme_peer[i];
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void
+s11_mme_peer_send_path_state_ind (
+  const s11_mme_peer_t * const peer_p,
+  const bool peer_restarted)
+{
+  MessageDef                             *message_p = NULL;
+  itti_s11_path_state_ind_t              *ind_p = NULL;
+
+  message_p = itti_alloc_new_message (TASK_S11, S11_PATH_STATE_IND);
+  ind_p = &message_p->ittiMsg.s11_path_state_ind;
+  ind_p->peer_ip = peer_p->peer_ip;
+  ind_p->path_up = peer_p->path_up;
+  ind_p->peer_restarted = peer_restarted;
+  itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
+}
+
+//------------------------------------------------------------------------------
+static int
+s11_mme_peer_send_echo_request (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  s11_mme_peer_t * const peer_p)
+{
+  nw_gtpv2c_ulp_api_t                     ulp_req;
+  nw_rc_t                                 rc = NW_OK;
+
+  memset (&ulp_req, 0, sizeof (nw_gtpv2c_ulp_api_t));
+  ulp_req.apiType = NW_GTPV2C_ULP_API_INITIAL_REQ;
+  rc = nwGtpv2cMsgNew (*stack_p, false, NW_GTP_ECHO_REQ, 0, 0, &(ulp_req.hMsg));
+  DevAssert (NW_OK == rc);
+  // the Recovery IE is added by the stack
+  ulp_req.u_api_info.initialReqInfo.peerIp = peer_p->peer_ip;
+  ulp_req.u_api_info.initialReqInfo.hUlpTrxn = S11_MME_TRXN (S11_MME_TRXN_TAG_ECHO, peer_p - s11_mme_peer);
+  rc = nwGtpv2cProcessUlpReq (*stack_p, &ulp_req);
+  if (NW_OK != rc) {
+    OAILOG_WARNING (LOG_S11, "Could not send Echo Request to S-GW %s\n", inet_ntoa (peer_p->peer_ip));
+    return RETURNerror;
+  }
+  peer_p->echo_outstanding = true;
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+int
+s11_mme_peer_manager_init (
+  const uint32_t echo_interval_sec)
+{
+  memset (s11_mme_peer, 0, sizeof (s11_mme_peer));
+  s11_mme_nb_peers = 0;
+  s11_mme_echo_timer_id = 0;
+
+  if (0 == echo_interval_sec) {
+    OAILOG_WARNING (LOG_S11, "S-GW path management disabled\n");
+    return RETURNok;
+  }
+
+  if (timer_setup (echo_interval_sec, 0, TASK_S11, INSTANCE_DEFAULT, TIMER_PERIODIC, &s11_mme_echo_timer_arg, &s11_mme_echo_timer_id) < 0) {
+    OAILOG_ERROR (LOG_S11, "Failed to request new timer for S-GW Echo Requests with %us of periodicity\n", echo_interval_sec);
+    s11_mme_echo_timer_id = 0;
+    return RETURNerror;
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_peer_manager_exit (void)
+{
+  void                                   *arg = NULL;
+
+  if (s11_mme_echo_timer_id) {
+    timer_remove (s11_mme_echo_timer_id, &arg);
+    s11_mme_echo_timer_id = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_peer_add (
+  const struct in_addr * const peer_ip)
+{
+  if ((0 == s11_mme_echo_timer_id) || (s11_mme_peer_get (*peer_ip))) {
+    return;
+  }
+  if (S11_MME_PEER_MAX == s11_mme_nb_peers) {
+    OAILOG_WARNING (LOG_S11, "No path management for S-GW %s, too many S-GWs\n", inet_ntoa (*peer_ip));
+    return;
+  }
+
+  s11_mme_peer_t                         *peer_p = &s11_mme_peer[s11_mme_nb_peers++];
+
+  memset (peer_p, 0, sizeof (*peer_p));
+  peer_p->peer_ip = *peer_ip;
+  peer_p->path_up = true;
+  OAILOG_INFO (LOG_S11, "Starting path management for S-GW %s\n", inet_ntoa (*peer_ip));
+}
+
+//------------------------------------------------------------------------------
+bool
+s11_mme_peer_manager_handle_timeout (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  void * arg)
+{
+  if (arg != &s11_mme_echo_timer_arg) {
+    return false;
+  }
+
+  for (int i = 0; i < s11_mme_nb_peers; i++) {
+    // also sent to S-GWs with a path down, to detect the path is back
+    if (!s11_mme_peer[i].echo_outstanding) {
+      s11_mme_peer_send_echo_request (stack_p, &s11_mme_peer[i]);
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+int
+s11_mme_handle_echo_response (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  nw_gtpv2c_ulp_api_t * pUlpApi)
+{
+  nw_gtpv2c_ulp_trxn_handle_t             hUlpTrxn = pUlpApi->u_api_info.triggeredRspIndInfo.hUlpTrxn;
+  s11_mme_peer_t                         *peer_p = NULL;
+  uint8_t                                 restart_counter = 0;
+  bool                                    peer_restarted = false;
+  nw_rc_t                                 rc = NW_OK;
+
+  DevAssert (stack_p );
+
+  if ((S11_MME_TRXN_TAG_ECHO != S11_MME_TRXN_TAG (hUlpTrxn)) || ((nw_gtpv2c_ulp_trxn_handle_t) s11_mme_nb_peers <= S11_MME_TRXN_VALUE (hUlpTrxn))) {
+    OAILOG_WARNING (LOG_S11, "Echo Response for unknown S-GW\n");
+  } else {
+    peer_p = &s11_mme_peer[S11_MME_TRXN_VALUE (hUlpTrxn)];
+    peer_p->echo_outstanding = false;
+
+    if (NW_OK == nwGtpv2cMsgGetIeTV1 (pUlpApi->hMsg, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, &restart_counter)) {
+      peer_restarted = (peer_p->restart_counter_known) && (restart_counter != peer_p->restart_counter);
+      peer_p->restart_counter_known = true;
+      peer_p->restart_counter = restart_counter;
+    }
+
+    if ((!peer_p->path_up) || (peer_restarted)) {
+      OAILOG_WARNING (LOG_S11, "S-GW %s path up%s\n", inet_ntoa (peer_p->peer_ip), (peer_restarted) ? ", S-GW restarted" : "");
+      peer_p->path_up = true;
+      s11_mme_peer_send_path_state_ind (peer_p, peer_restarted);
+    }
+  }
+
+  rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
+  DevAssert (NW_OK == rc);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void
+s11_mme_peer_handle_rsp_failure (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  const nw_gtpv2c_rsp_failure_ind_info_t * const info)
+{
+  s11_mme_peer_t                         *peer_p = s11_mme_peer_get (info->peerIp);
+
+  if (!peer_p) {
+    return;
+  }
+
+  if (NW_GTP_ECHO_REQ == info->msgType) {
+    peer_p->echo_outstanding = false;
+    if (peer_p->path_up) {
+      peer_p->path_up = false;
+      OAILOG_ERROR (LOG_S11, "S-GW %s path failure\n", inet_ntoa (peer_p->peer_ip));
+      /*
+       * MME_APP learns the path is down before the failure of the requests,
+       * so that it does not select this S-GW again when handling them.
+       */
+      s11_mme_peer_send_path_state_ind (peer_p, false);
+      // the queued requests would only be sent to the failed S-GW
+      s11_mme_release_access_bearers_window_drop (peer_p->peer_ip);
+      nwGtpv2cProcessPeerFailure (*stack_p, &peer_p->peer_ip, NULL);
+    }
+  } else if ((peer_p->path_up) && (!peer_p->echo_outstanding)) {
+    // do not wait for the next echo period to check the path
+    s11_mme_peer_send_echo_request (stack_p, peer_p);
+  }
+}
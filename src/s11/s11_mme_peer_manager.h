@@ -0,0 +1,49 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file s11_mme_peer_manager.h
+  \brief S11 path management towards S-GWs
+  \company Eurecom
+*/
+
+#ifndef FILE_S11_MME_PEER_MANAGER_SEEN
+#define FILE_S11_MME_PEER_MANAGER_SEEN
+
+/* @brief Start the periodic Echo Requests to S-GWs, a zero interval disables path management. */
+int s11_mme_peer_manager_init (const uint32_t echo_interval_sec);
+
+/* @brief Stop the periodic Echo Requests to S-GWs. */
+void s11_mme_peer_manager_exit (void);
+
+/* @brief Start path management towards a S-GW, if not already done. */
+void s11_mme_peer_add (const struct in_addr * const peer_ip);
+
+/* @brief Handle a timer expiry, returns false if the timer is not one of the path manager. */
+bool s11_mme_peer_manager_handle_timeout (nw_gtpv2c_stack_handle_t * stack_p, void * arg);
+
+/* @brief Handle an Echo Response received from S-GW. */
+int s11_mme_handle_echo_response (nw_gtpv2c_stack_handle_t * stack_p, nw_gtpv2c_ulp_api_t * pUlpApi);
+
+/* @brief A request sent to a S-GW was not answered: on Echo Request this is a path failure,
+ * all outstanding requests to the S-GW are failed at once; otherwise the path is checked right away. */
+void s11_mme_peer_handle_rsp_failure (nw_gtpv2c_stack_handle_t * stack_p, const nw_gtpv2c_rsp_failure_ind_info_t * const info);
+
+#endif /* FILE_S11_MME_PEER_MANAGER_SEEN */
@@ -26,6 +26,7 @@
   \email: lionel.gauthier@eurecom.fr
 */
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -49,10 +50,41 @@
 
 #include "s11_common.h"
 #include "s11_mme_session_manager.h"
+#include "s11_mme_peer_manager.h"
 #include "s11_ie_formatter.h"
 
 extern hash_table_ts_t                        *s11_mme_teid_2_gtv2c_teid_handle;
 
+static const s11_msg_decoder_ie_t        s11_mme_create_session_response_ies[] = {
+  {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, offsetof (itti_s11_create_session_response_t, cause)},
+  {NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_FTEID, offsetof (itti_s11_create_session_response_t, s11_sgw_fteid)},
+  {NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_FTEID, offsetof (itti_s11_create_session_response_t, s5_s8_pgw_fteid)},
+  {NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PAA, offsetof (itti_s11_create_session_response_t, paa)},
+  {NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_APN_RESTRICTION, offsetof (itti_s11_create_session_response_t, apn_restriction)},
+  {NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PCO, offsetof (itti_s11_create_session_response_t, pco)},
+  {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_BEARER_CONTEXT_CREATED, offsetof (itti_s11_create_session_response_t, bearer_contexts_created)},
+};
+
+static s11_msg_decoder_t                s11_mme_create_session_response_decoder;
+
+static const s11_msg_decoder_ie_t        s11_mme_delete_session_response_ies[] = {
+  {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, offsetof (itti_s11_delete_session_response_t, cause)},
+  // TODO {NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, s11_fteid_ie_get, offsetof (itti_s11_delete_session_response_t, recovery)},
+  {NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PCO, offsetof (itti_s11_delete_session_response_t, pco)},
+};
+
+static s11_msg_decoder_t                s11_mme_delete_session_response_decoder;
+
+//------------------------------------------------------------------------------
+void
+s11_mme_session_manager_init (void)
+{
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_mme_create_session_response_decoder, NW_GTP_CREATE_SESSION_RSP,
+      s11_mme_create_session_response_ies, sizeof (s11_mme_create_session_response_ies) / sizeof (s11_mme_create_session_response_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_mme_delete_session_response_decoder, NW_GTP_DELETE_SESSION_RSP,
+      s11_mme_delete_session_response_ies, sizeof (s11_mme_delete_session_response_ies) / sizeof (s11_mme_delete_session_response_ies[0])));
+}
+
 //------------------------------------------------------------------------------
 int
 s11_mme_create_session_request (
@@ -73,7 +105,9 @@ s11_mme_create_session_request (
   rc = nwGtpv2cMsgNew (*stack_p, true, NW_GTP_CREATE_SESSION_REQ, req_p->teid, 0, &(ulp_req.hMsg));
   ulp_req.u_api_info.initialReqInfo.peerIp     = req_p->peer_ip;
   ulp_req.u_api_info.initialReqInfo.teidLocal  = req_p->sender_fteid_for_cp.teid;
-  ulp_req.u_api_info.initialReqInfo.hUlpTunnel = 0;
+  // given back if the S-GW does not answer
+  ulp_req.u_api_info.initialReqInfo.hUlpTunnel = (nw_gtpv2c_ulp_tunnel_handle_t) req_p->sender_fteid_for_cp.teid;
+  ulp_req.u_api_info.initialReqInfo.hUlpTrxn   = S11_MME_TRXN (S11_MME_TRXN_TAG_CREATE_SESSION, req_p->bearer_contexts_to_be_created.bearer_contexts[0].eps_bearer_id);
   ulp_req.u_api_info.initialReqInfo.hTunnel    = 0;
   /*
    * Add recovery if contacting the peer for the first time
@@ -112,6 +146,7 @@ s11_mme_create_session_request (
   }
   rc = nwGtpv2cProcessUlpReq (*stack_p, &ulp_req);
   DevAssert (NW_OK == rc);
+  s11_mme_peer_add (&req_p->peer_ip);
   MSC_LOG_TX_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_SESSION_REQUEST local S11 teid " TEID_FMT " num bearers ctx %u",
     req_p->sender_fteid_for_cp.teid, req_p->bearer_contexts_to_be_created.num_bearer_context);
 
@@ -137,7 +172,6 @@ s11_mme_handle_create_session_response (
   uint16_t                                offendingIeLength;
   itti_s11_create_session_response_t     *resp_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_SESSION_RESPONSE);
@@ -146,56 +180,9 @@ s11_mme_handle_create_session_response (
   resp_p->teid = nwGtpv2cMsgGetTeid(pUlpApi->hMsg);
 
   /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_CREATE_SESSION_RSP, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Cause IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-      gtpv2c_cause_ie_get, &resp_p->cause);
-  DevAssert (NW_OK == rc);
-  /*
-   * Sender FTEID for CP IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_fteid_ie_get, &resp_p->s11_sgw_fteid);
-  DevAssert (NW_OK == rc);
-  /*
-   * Sender FTEID for PGW S5/S8 IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_fteid_ie_get, &resp_p->s5_s8_pgw_fteid);
-  DevAssert (NW_OK == rc);
-  /*
-   * PAA IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_paa_ie_get, &resp_p->paa);
-  DevAssert (NW_OK == rc);
-  /*
-   * APN RESTRICTION
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_apn_restriction_ie_get, &resp_p->apn_restriction);
-  DevAssert (NW_OK == rc);
-  /*
-   * PCO IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_pco_ie_get, &resp_p->pco);
-  DevAssert (NW_OK == rc);
-  /*
-   * Bearer Contexts Created IE
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_bearer_context_created_ie_get, &resp_p->bearer_contexts_created);
-  DevAssert (NW_OK == rc);
-  /*
-   * Run the parser
-   */
-  rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_mme_create_session_response_decoder, (pUlpApi->hMsg), resp_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_SESSION_RESPONSE local S11 teid " TEID_FMT " ", resp_p->teid);
@@ -204,15 +191,11 @@ s11_mme_handle_create_session_response (
      */
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNerror;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
 
@@ -221,6 +204,50 @@ s11_mme_handle_create_session_response (
   return itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
 }
 
+//------------------------------------------------------------------------------
+int
+s11_mme_handle_create_session_failure (
+  nw_gtpv2c_stack_handle_t * stack_p,
+  const nw_gtpv2c_rsp_failure_ind_info_t * const info)
+{
+  nw_rc_t                                   rc = NW_OK;
+  itti_s11_create_session_response_t     *resp_p;
+  MessageDef                             *message_p;
+  nw_gtpv2c_ulp_api_t                     ulp_req;
+  hashtable_rc_t                          hash_rc = HASH_TABLE_OK;
+  teid_t                                  local_teid = (teid_t) info->hUlpTunnel;
+
+  DevAssert (stack_p );
+  /*
+   * The local tunnel was created for this request only
+   */
+  memset (&ulp_req, 0, sizeof (nw_gtpv2c_ulp_api_t));
+  ulp_req.apiType = NW_GTPV2C_ULP_DELETE_LOCAL_TUNNEL;
+  hash_rc = hashtable_ts_get(s11_mme_teid_2_gtv2c_teid_handle,
+      (hash_key_t) local_teid,
+      (void **)(uintptr_t)&ulp_req.u_api_info.deleteLocalTunnelInfo.hTunnel);
+  if (HASH_TABLE_OK == hash_rc) {
+    rc = nwGtpv2cProcessUlpReq (*stack_p, &ulp_req);
+    DevAssert (NW_OK == rc);
+    hashtable_ts_free(s11_mme_teid_2_gtv2c_teid_handle, (hash_key_t) local_teid);
+  }
+
+  /*
+   * Answer MME_APP as the S-GW would have done if it could not create the session
+   */
+  message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_SESSION_RESPONSE);
+  resp_p = &message_p->ittiMsg.s11_create_session_response;
+  resp_p->teid = local_teid;
+  resp_p->cause.cause_value = REMOTE_PEER_NOT_RESPONDING;
+  resp_p->bearer_contexts_created.num_bearer_context = 1;
+  resp_p->bearer_contexts_created.bearer_contexts[0].eps_bearer_id = (ebi_t) S11_MME_TRXN_VALUE (info->hUlpTrxn);
+  resp_p->bearer_contexts_created.bearer_contexts[0].cause.cause_value = REMOTE_PEER_NOT_RESPONDING;
+  resp_p->peer_ip = info->peerIp;
+  MSC_LOG_EVENT (MSC_S11_MME, "0 CREATE_SESSION_REQUEST local S11 teid " TEID_FMT " no response", local_teid);
+  OAILOG_WARNING (LOG_S11, "No response from S-GW %s to Create Session Request, local teid " TEID_FMT "\n", inet_ntoa (info->peerIp), local_teid);
+  return itti_send_msg_to_task (TASK_MME_APP, INSTANCE_DEFAULT, message_p);
+}
+
 //------------------------------------------------------------------------------
 int
 s11_mme_delete_session_request (
@@ -288,7 +315,6 @@ s11_mme_handle_delete_session_response (
   uint16_t                                offendingIeLength;
   itti_s11_delete_session_response_t     *resp_p = NULL;
   MessageDef                             *message_p = NULL;
-  nw_gtpv2c_msg_parser_t                 *pMsgParser = NULL;
   hashtable_rc_t                          hash_rc = HASH_TABLE_OK;
 
   DevAssert (stack_p );
@@ -298,33 +324,9 @@ s11_mme_handle_delete_session_response (
   resp_p->teid = nwGtpv2cMsgGetTeid(pUlpApi->hMsg);
 
   /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_DELETE_SESSION_RSP, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Cause IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-      gtpv2c_cause_ie_get, &resp_p->cause);
-  DevAssert (NW_OK == rc);
-  /*
-   * Recovery IE
-   */
-  /* TODO rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, s11_fteid_ie_get,
-		  &resp_p->recovery);
-  DevAssert (NW_OK == rc); */
-  /*
-   * PCO IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_pco_ie_get, &resp_p->pco);
-  DevAssert (NW_OK == rc);
-
-  /*
-   * Run the parser
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_mme_delete_session_response_decoder, (pUlpApi->hMsg), resp_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 DELETE_SESSION_RESPONSE local S11 teid " TEID_FMT " ", resp_p->teid);
@@ -333,15 +335,11 @@ s11_mme_handle_delete_session_response (
      */
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNerror;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
 
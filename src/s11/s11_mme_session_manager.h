@@ -29,12 +29,18 @@
 #ifndef FILE_S11_MME_SESSION_MANAGER_SEEN
 #define FILE_S11_MME_SESSION_MANAGER_SEEN
 
+/* @brief Build the parsers of the session management messages received from S-GW, once at init. */
+void s11_mme_session_manager_init (void);
+
 /* @brief Create a new Create Session Request and send it to provided S-GW. */
 int s11_mme_create_session_request(nw_gtpv2c_stack_handle_t *stack_p, itti_s11_create_session_request_t *create_session_p);
 
 /* @brief Handle a Create Session Response received from S-GW. */
 int s11_mme_handle_create_session_response (nw_gtpv2c_stack_handle_t * stack_p, nw_gtpv2c_ulp_api_t * pUlpApi);
 
+/* @brief The S-GW did not answer a Create Session Request, reject it towards MME_APP. */
+int s11_mme_handle_create_session_failure (nw_gtpv2c_stack_handle_t * stack_p, const nw_gtpv2c_rsp_failure_ind_info_t * const info);
+
 /* @brief Create a new Delete Session Request and send it to provided S-GW. */
 int s11_mme_delete_session_request (nw_gtpv2c_stack_handle_t * stack_p, itti_s11_delete_session_request_t * delete_session_p);
 
@@ -50,6 +50,7 @@
 #include "s11_mme.h"
 #include "s11_mme_session_manager.h"
 #include "s11_mme_bearer_manager.h"
+#include "s11_mme_peer_manager.h"
 
 static nw_gtpv2c_stack_handle_t             s11_mme_stack_handle = 0;
 // Store the GTPv2-C teid handle
@@ -98,6 +99,10 @@ s11_mme_ulp_process_stack_req_cb (
         ret = s11_mme_handle_release_access_bearer_response (&s11_mme_stack_handle, pUlpApi);
         break;
 
+      case NW_GTP_ECHO_RSP:
+        ret = s11_mme_handle_echo_response (&s11_mme_stack_handle, pUlpApi);
+        break;
+
       default:
         OAILOG_WARNING (LOG_S11, "Received unhandled TRIGGERED_RSP_IND message type %d\n", pUlpApi->u_api_info.triggeredRspIndInfo.msgType);
       }
@@ -114,6 +119,27 @@ s11_mme_ulp_process_stack_req_cb (
       }
       break;
 
+    case NW_GTPV2C_ULP_API_RSP_FAILURE_IND:
+      switch (pUlpApi->u_api_info.rspFailureInfo.msgType) {
+      case NW_GTP_CREATE_SESSION_REQ:
+        ret = s11_mme_handle_create_session_failure (&s11_mme_stack_handle, &pUlpApi->u_api_info.rspFailureInfo);
+        break;
+
+      case NW_GTP_RELEASE_ACCESS_BEARERS_REQ:
+        s11_mme_release_access_bearers_window_release (&s11_mme_stack_handle, pUlpApi->u_api_info.rspFailureInfo.hUlpTrxn);
+        break;
+
+      case NW_GTP_ECHO_REQ:
+        break;
+
+      default:
+        OAILOG_WARNING (LOG_S11, "No response from S-GW %s to message type %d\n", inet_ntoa (pUlpApi->u_api_info.rspFailureInfo.peerIp),
+            pUlpApi->u_api_info.rspFailureInfo.msgType);
+      }
+      // may fail all other requests outstanding with this S-GW
+      s11_mme_peer_handle_rsp_failure (&s11_mme_stack_handle, &pUlpApi->u_api_info.rspFailureInfo);
+      break;
+
     default:
       OAILOG_WARNING (LOG_S11, "Received unhandled message type %d\n", pUlpApi->apiType);
       break;
@@ -224,6 +250,15 @@ s11_mme_thread (
       }
       break;
 
+    case S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH:{
+        itti_s11_release_access_bearers_request_batch_t *batch_p = &received_message_p->ittiMsg.s11_release_access_bearers_request_batch;
+
+        for (uint32_t i = 0; i < batch_p->nb_requests; i++) {
+          s11_mme_release_access_bearers_request (&s11_mme_stack_handle, &batch_p->request[i]);
+        }
+      }
+      break;
+
     case TERMINATE_MESSAGE:{
         s11_mme_exit();
         OAI_FPRINTF_INFO("TASK_S11 terminated\n");
@@ -233,7 +268,9 @@ s11_mme_thread (
 
     case TIMER_HAS_EXPIRED:{
         OAILOG_DEBUG (LOG_S11, "Processing timeout for timer_id 0x%lx and arg %p\n", received_message_p->ittiMsg.timer_has_expired.timer_id, received_message_p->ittiMsg.timer_has_expired.arg);
-        DevAssert (nwGtpv2cProcessTimeout (received_message_p->ittiMsg.timer_has_expired.arg) == NW_OK);
+        if (!s11_mme_peer_manager_handle_timeout (&s11_mme_stack_handle, received_message_p->ittiMsg.timer_has_expired.arg)) {
+          DevAssert (nwGtpv2cProcessTimeout (received_message_p->ittiMsg.timer_has_expired.arg) == NW_OK);
+        }
       }
       break;
 
@@ -296,6 +333,12 @@ int s11_mme_init (const mme_config_t * const mme_config_p)
     goto fail;
   }
 
+  /*
+   * Parsers of received messages are built once, not for each message
+   */
+  s11_mme_session_manager_init ();
+  s11_mme_bearer_manager_init ();
+
   /*
    * Set ULP entity
    */
@@ -327,6 +370,7 @@ int s11_mme_init (const mme_config_t * const mme_config_p)
   DevAssert (NW_OK == nwGtpv2cSetLogLevel (s11_mme_stack_handle, NW_LOG_LEVEL_DEBG));
   mme_config_read_lock (&mme_config);
   s11_send_init_udp (&mme_config.ipv4.s11, mme_config.ipv4.port_s11);
+  s11_mme_peer_manager_init (mme_config.s11_config.echo_interval_sec);
   mme_config_unlock (&mme_config);
 
   bstring b = bfromcstr("s11_mme_teid_2_gtv2c_teid_handle");
@@ -342,6 +386,7 @@ fail:
 //------------------------------------------------------------------------------
 static void s11_mme_exit (void)
 {
+  s11_mme_peer_manager_exit ();
   if (nwGtpv2cFinalize(s11_mme_stack_handle) != NW_OK) {
     OAI_FPRINTF_ERR ("An error occurred during tear down of nwGtp s11 stack.\n");
   }
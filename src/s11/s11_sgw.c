@@ -56,18 +56,186 @@
 #include "s11_sgw_session_manager.h"
 
 
-static nw_gtpv2c_stack_handle_t             s11_sgw_stack_handle = 0;
+/* Release Access Bearers Requests not yet forwarded to a SPGW_APP shard */
+typedef struct s11_sgw_rab_batch_s {
+  task_id_t                               task_id;
+  MessageDef                             *message_p;
+} s11_sgw_rab_batch_t;
+
+/*
+ * S11 GTPv2-C stack instances, each one owned by its own ITTI task.
+ * Instances share nothing: a session is handled by the instance that received
+ * its Create Session Request (chosen by sequence number), datagrams carrying
+ * a TEID go to the instance that created the local tunnel.
+ */
+typedef struct s11_sgw_instance_s {
+  task_id_t                               task_id;
+  nw_gtpv2c_stack_handle_t                stack_handle;
+  s11_sgw_rab_batch_t                     rab_batches[SGW_SPGW_APP_SHARDS_MAX]; ///< one per SPGW_APP shard
+  int                                     nb_rab_batches;
+} s11_sgw_instance_t;
+
+static s11_sgw_instance_t               s11_sgw_instances[SGW_S11_GTPV2C_INSTANCES_MAX] = {
+  {.task_id = TASK_S11},
+  {.task_id = TASK_S11_1},
+  {.task_id = TASK_S11_2},
+  {.task_id = TASK_S11_3},
+};
+// Messages of a session go straight to the SPGW_APP shard owning it
+static s11_sgw_app_task_cb_t            s11_sgw_app_task_cb = NULL;
+static int                              s11_sgw_nb_instances = 1;
+// Instances not yet terminated, the last one releases the shared tables
+static volatile int                     s11_sgw_nb_running_instances = 0;
 
 hash_table_ts_t                        *s11_sgw_teid_2_gtv2c_teid_handle = NULL;
+// Local TEID to index of the owning instance, used only with several instances
+static hash_table_ts_t                 *s11_sgw_teid_2_instance = NULL;
+
+static void s11_sgw_exit (s11_sgw_instance_t * const instance_p);
+
+//------------------------------------------------------------------------------
+static s11_sgw_instance_t *s11_sgw_instance_of_teid (const teid_t teid)
+{
+  void                                   *index = NULL;
+
+  if ((teid) && (HASH_TABLE_OK == hashtable_ts_get (s11_sgw_teid_2_instance, (hash_key_t) teid, &index))) {
+    return &s11_sgw_instances[(uintptr_t) index];
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static s11_sgw_instance_t *s11_sgw_instance_of_trxn (const void * const trxn)
+{
+  nw_gtpv2c_stack_handle_t                stack_handle = nwGtpv2cTrxnGetStackHandle ((nw_gtpv2c_trxn_handle_t) trxn);
+
+  for (int i = 0; i < s11_sgw_nb_instances; i++) {
+    if (s11_sgw_instances[i].stack_handle == stack_handle) {
+      return &s11_sgw_instances[i];
+    }
+  }
+  return NULL;
+}
+
+/* UDP steering callback, called by the UDP threads for each S11 datagram */
+//------------------------------------------------------------------------------
+static int s11_sgw_steer_udp_msg (const uint8_t * const buffer, const uint32_t length)
+{
+  s11_sgw_instance_t                     *instance_p = NULL;
+  uint32_t                                seq_num = 0;
 
-static void s11_sgw_exit (void);
+  if (length < 8) {
+    return -1;
+  }
+  if (buffer[0] & 0x08) {
+    if (length < 12) {
+      return -1;
+    }
+    instance_p = s11_sgw_instance_of_teid (((uint32_t)buffer[4] << 24) | ((uint32_t)buffer[5] << 16) | ((uint32_t)buffer[6] << 8) | buffer[7]);
+    seq_num = ((uint32_t)buffer[8] << 16) | ((uint32_t)buffer[9] << 8) | buffer[10];
+  } else {
+    seq_num = ((uint32_t)buffer[4] << 16) | ((uint32_t)buffer[5] << 8) | buffer[6];
+  }
+  if (!instance_p) {
+    // Retransmissions of a request keep their sequence number, so reach the same instance
+    instance_p = &s11_sgw_instances[seq_num % s11_sgw_nb_instances];
+  }
+  return instance_p->task_id;
+}
+
+/* Instance that has to process a message received from S-PGW APP, S-PGW APP sends all of them to TASK_S11 */
+//------------------------------------------------------------------------------
+static s11_sgw_instance_t *s11_sgw_instance_of_itti_msg (s11_sgw_instance_t * const instance_p, const MessageDef * const message_p)
+{
+  s11_sgw_instance_t                     *owner_p = NULL;
+
+  if (1 == s11_sgw_nb_instances) {
+    return instance_p;
+  }
+  switch (ITTI_MSG_ID (message_p)) {
+  case S11_CREATE_BEARER_REQUEST:
+    owner_p = s11_sgw_instance_of_teid (message_p->ittiMsg.s11_create_bearer_request.local_teid);
+    break;
+  case S11_CREATE_SESSION_RESPONSE:
+    owner_p = s11_sgw_instance_of_trxn (message_p->ittiMsg.s11_create_session_response.trxn);
+    break;
+  case S11_DELETE_SESSION_RESPONSE:
+    owner_p = s11_sgw_instance_of_trxn (message_p->ittiMsg.s11_delete_session_response.trxn);
+    break;
+  case S11_MODIFY_BEARER_RESPONSE:
+    owner_p = s11_sgw_instance_of_trxn (message_p->ittiMsg.s11_modify_bearer_response.trxn);
+    break;
+  case S11_RELEASE_ACCESS_BEARERS_RESPONSE:
+    owner_p = s11_sgw_instance_of_trxn (message_p->ittiMsg.s11_release_access_bearers_response.trxn);
+    break;
+  default:
+    break;
+  }
+  return (owner_p) ? owner_p : instance_p;
+}
+
+//------------------------------------------------------------------------------
+void s11_sgw_set_app_task_cb (s11_sgw_app_task_cb_t app_task_cb)
+{
+  s11_sgw_app_task_cb = app_task_cb;
+}
+
+//------------------------------------------------------------------------------
+task_id_t s11_sgw_app_task (const teid_t local_teid, const teid_t peer_teid)
+{
+  return (s11_sgw_app_task_cb) ? s11_sgw_app_task_cb (local_teid, peer_teid) : TASK_SPGW_APP;
+}
+
+/* Batch of the requests for a SPGW_APP shard, a shard keeps its slot once used */
+//------------------------------------------------------------------------------
+static s11_sgw_rab_batch_t *s11_sgw_rab_batch_of_task (s11_sgw_instance_t * const instance_p, const task_id_t task_id)
+{
+  for (int i = 0; i < instance_p->nb_rab_batches; i++) {
+    if (instance_p->rab_batches[i].task_id == task_id) {
+      return &instance_p->rab_batches[i];
+    }
+  }
+  DevAssert (SGW_SPGW_APP_SHARDS_MAX > instance_p->nb_rab_batches);
+  instance_p->rab_batches[instance_p->nb_rab_batches].task_id = task_id;
+  return &instance_p->rab_batches[instance_p->nb_rab_batches++];
+}
+
+//------------------------------------------------------------------------------
+static void s11_sgw_flush_rab_batch (s11_sgw_rab_batch_t * const batch_p)
+{
+  if (batch_p->message_p) {
+    itti_send_msg_to_task (batch_p->task_id, INSTANCE_DEFAULT, batch_p->message_p);
+    batch_p->message_p = NULL;
+  }
+}
+
+//------------------------------------------------------------------------------
+static bool s11_sgw_has_rab_batches (const s11_sgw_instance_t * const instance_p)
+{
+  for (int i = 0; i < instance_p->nb_rab_batches; i++) {
+    if (instance_p->rab_batches[i].message_p) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+static void s11_sgw_flush_rab_batches (s11_sgw_instance_t * const instance_p)
+{
+  for (int i = 0; i < instance_p->nb_rab_batches; i++) {
+    s11_sgw_flush_rab_batch (&instance_p->rab_batches[i]);
+  }
+}
 
 /* ULP callback for the GTPv2-C stack */
 //------------------------------------------------------------------------------
 static nw_rc_t s11_sgw_ulp_process_stack_req_cb (nw_gtpv2c_ulp_handle_t hUlp, nw_gtpv2c_ulp_api_t * pUlpApi)
 {
+  s11_sgw_instance_t                     *instance_p = (s11_sgw_instance_t *) hUlp;
   int                                     ret = 0;
 
+  DevAssert (instance_p );
   DevAssert (pUlpApi );
 
   switch (pUlpApi->apiType) {
@@ -76,19 +244,26 @@ static nw_rc_t s11_sgw_ulp_process_stack_req_cb (nw_gtpv2c_ulp_handle_t hUlp, nw
 
       switch (pUlpApi->u_api_info.initialReqIndInfo.msgType) {
         case NW_GTP_CREATE_SESSION_REQ:
-          ret = s11_sgw_handle_create_session_request (&s11_sgw_stack_handle, pUlpApi);
+          ret = s11_sgw_handle_create_session_request (&instance_p->stack_handle, pUlpApi);
           break;
 
         case NW_GTP_MODIFY_BEARER_REQ:
-          ret = s11_sgw_handle_modify_bearer_request (&s11_sgw_stack_handle, pUlpApi);
+          ret = s11_sgw_handle_modify_bearer_request (&instance_p->stack_handle, pUlpApi);
           break;
 
         case NW_GTP_DELETE_SESSION_REQ:
-          ret = s11_sgw_handle_delete_session_request (&s11_sgw_stack_handle, pUlpApi);
+          ret = s11_sgw_handle_delete_session_request (&instance_p->stack_handle, pUlpApi);
           break;
 
-        case NW_GTP_RELEASE_ACCESS_BEARERS_REQ:
-          ret = s11_sgw_handle_release_access_bearers_request (&s11_sgw_stack_handle, pUlpApi);
+        case NW_GTP_RELEASE_ACCESS_BEARERS_REQ:{
+            s11_sgw_rab_batch_t          *batch_p = s11_sgw_rab_batch_of_task (instance_p, s11_sgw_app_task (nwGtpv2cMsgGetTeid (pUlpApi->hMsg), 0));
+
+            ret = s11_sgw_handle_release_access_bearers_request (&instance_p->stack_handle, pUlpApi, &batch_p->message_p);
+            if ((batch_p->message_p) &&
+                (S11_RELEASE_ACCESS_BEARERS_BATCH_MAX == S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (batch_p->message_p).nb_requests)) {
+              s11_sgw_flush_rab_batch (batch_p);
+            }
+          }
           break;
 
         default:
@@ -105,7 +280,7 @@ static nw_rc_t s11_sgw_ulp_process_stack_req_cb (nw_gtpv2c_ulp_handle_t hUlp, nw
         OAILOG_WARNING (LOG_S11, "Received response indication from ULP API\n");
         switch (pUlpApi->u_api_info.triggeredRspIndInfo.msgType) {
         case NW_GTP_CREATE_BEARER_RSP:
-          ret = s11_sgw_handle_create_bearer_response (&s11_sgw_stack_handle, pUlpApi);
+          ret = s11_sgw_handle_create_bearer_response (&instance_p->stack_handle, pUlpApi);
           break;
 
           default:
@@ -166,15 +341,18 @@ static nw_rc_t s11_sgw_start_timer_wrapper (
   void *timeoutArg,
   nw_gtpv2c_timer_handle_t * hTmr)
 {
+  s11_sgw_instance_t                     *instance_p = (s11_sgw_instance_t *) tmrMgrHandle;
   long                                    timer_id;
   int                                     ret = 0;
 
+  // Expiry is processed by the task owning the stack instance
   if (tmrType == NW_GTPV2C_TMR_TYPE_REPETITIVE) {
-    ret = timer_setup (timeoutSec, timeoutUsec, TASK_S11, INSTANCE_DEFAULT, TIMER_PERIODIC, timeoutArg, &timer_id);
+    ret = timer_setup (timeoutSec, timeoutUsec, instance_p->task_id, INSTANCE_DEFAULT, TIMER_PERIODIC, timeoutArg, &timer_id);
   } else {
-    ret = timer_setup (timeoutSec, timeoutUsec, TASK_S11, INSTANCE_DEFAULT, TIMER_ONE_SHOT, timeoutArg, &timer_id);
+    ret = timer_setup (timeoutSec, timeoutUsec, instance_p->task_id, INSTANCE_DEFAULT, TIMER_ONE_SHOT, timeoutArg, &timer_id);
   }
 
+  *hTmr = (nw_gtpv2c_timer_handle_t) timer_id;
   return ret == 0 ? NW_OK : NW_FAILURE;
 }
 
@@ -194,12 +372,29 @@ static nw_rc_t s11_sgw_stop_timer_wrapper (
 //------------------------------------------------------------------------------
 static void *s11_sgw_thread (void *args)
 {
-  itti_mark_task_ready (TASK_S11);
+  s11_sgw_instance_t                     *instance_p = (s11_sgw_instance_t *) args;
+  s11_sgw_instance_t                     *owner_p = NULL;
+
+  itti_mark_task_ready (instance_p->task_id);
 
   while (1) {
     MessageDef                             *received_message_p = NULL;
 
-    itti_receive_msg (TASK_S11, &received_message_p);
+    if (s11_sgw_has_rab_batches (instance_p)) {
+      // Release Access Bearers Requests received in a row go to their SPGW_APP shard in one message once the queue is drained
+      itti_poll_msg (instance_p->task_id, &received_message_p);
+      if (!received_message_p) {
+        s11_sgw_flush_rab_batches (instance_p);
+      }
+    }
+    if (!received_message_p) {
+      itti_receive_msg (instance_p->task_id, &received_message_p);
+    }
+
+    if ((owner_p = s11_sgw_instance_of_itti_msg (instance_p, received_message_p)) != instance_p) {
+      itti_send_msg_to_task (owner_p->task_id, INSTANCE_DEFAULT, received_message_p);
+      continue;
+    }
 
     switch (ITTI_MSG_ID (received_message_p)) {
     case UDP_DATA_IND:{
@@ -211,38 +406,52 @@ static void *s11_sgw_thread (void *args)
 
         udp_data_ind = &received_message_p->ittiMsg.udp_data_ind;
         OAILOG_DEBUG (LOG_S11, "Processing new data indication from UDP\n");
-        rc = nwGtpv2cProcessUdpReq (s11_sgw_stack_handle, udp_data_ind->buffer, udp_data_ind->buffer_length, udp_data_ind->peer_port, &udp_data_ind->peer_address);
+        rc = nwGtpv2cProcessUdpReq (instance_p->stack_handle, udp_data_ind->buffer, udp_data_ind->buffer_length, udp_data_ind->peer_port, &udp_data_ind->peer_address);
         DevAssert (rc == NW_OK);
       }
       break;
 
     case S11_CREATE_BEARER_REQUEST:{
         OAILOG_DEBUG (LOG_S11, "Received S11_CREATE_BEARER_REQUEST from S-PGW APP\n");
-        s11_sgw_handle_create_bearer_request (&s11_sgw_stack_handle, &received_message_p->ittiMsg.s11_create_bearer_request);
+        s11_sgw_handle_create_bearer_request (&instance_p->stack_handle, &received_message_p->ittiMsg.s11_create_bearer_request);
       }
       break;
 
     case S11_CREATE_SESSION_RESPONSE:{
+        itti_s11_create_session_response_t     *create_session_response_p = &received_message_p->ittiMsg.s11_create_session_response;
+        const teid_t                            local_teid = create_session_response_p->s11_sgw_fteid.teid;
+        const bool                              steer = (s11_sgw_teid_2_instance) && (local_teid) &&
+                                                        (REQUEST_ACCEPTED == create_session_response_p->cause.cause_value);
+
         OAILOG_DEBUG (LOG_S11, "Received S11_CREATE_SESSION_RESPONSE from S-PGW APP\n");
-        s11_sgw_handle_create_session_response (&s11_sgw_stack_handle, &received_message_p->ittiMsg.s11_create_session_response);
+        if (steer) {
+          // Before the response is sent: the MME may use the TEID as soon as it gets it
+          hashtable_ts_insert (s11_sgw_teid_2_instance, (hash_key_t) local_teid, (void *)(uintptr_t)(instance_p - s11_sgw_instances));
+        }
+        if ((RETURNok != s11_sgw_handle_create_session_response (&instance_p->stack_handle, create_session_response_p)) && (steer)) {
+          hashtable_ts_free (s11_sgw_teid_2_instance, (hash_key_t) local_teid);
+        }
       }
       break;
 
     case S11_DELETE_SESSION_RESPONSE:{
         OAILOG_DEBUG (LOG_S11, "Received S11_DELETE_SESSION_RESPONSE from S-PGW APP\n");
-        s11_sgw_handle_delete_session_response (&s11_sgw_stack_handle, &received_message_p->ittiMsg.s11_delete_session_response);
+        s11_sgw_handle_delete_session_response (&instance_p->stack_handle, &received_message_p->ittiMsg.s11_delete_session_response);
+        if ((s11_sgw_teid_2_instance) && (received_message_p->ittiMsg.s11_delete_session_response.local_teid)) {
+          hashtable_ts_free (s11_sgw_teid_2_instance, (hash_key_t) received_message_p->ittiMsg.s11_delete_session_response.local_teid);
+        }
       }
       break;
 
     case S11_MODIFY_BEARER_RESPONSE:{
         OAILOG_DEBUG (LOG_S11, "Received S11_MODIFY_BEARER_RESPONSE from S-PGW APP\n");
-        s11_sgw_handle_modify_bearer_response (&s11_sgw_stack_handle, &received_message_p->ittiMsg.s11_modify_bearer_response);
+        s11_sgw_handle_modify_bearer_response (&instance_p->stack_handle, &received_message_p->ittiMsg.s11_modify_bearer_response);
       }
       break;
 
     case S11_RELEASE_ACCESS_BEARERS_RESPONSE:{
         OAILOG_DEBUG (LOG_S11, "Received S11_RELEASE_ACCESS_BEARERS_RESPONSE from S-PGW APP\n");
-        s11_sgw_handle_release_access_bearers_response (&s11_sgw_stack_handle, &received_message_p->ittiMsg.s11_release_access_bearers_response);
+        s11_sgw_handle_release_access_bearers_response (&instance_p->stack_handle, &received_message_p->ittiMsg.s11_release_access_bearers_response);
       }
       break;
 
@@ -254,8 +463,8 @@ static void *s11_sgw_thread (void *args)
       break;
 
     case TERMINATE_MESSAGE:{
-        s11_sgw_exit();
-        OAI_FPRINTF_INFO("TASK_S11 terminated\n");
+        s11_sgw_exit (instance_p);
+        OAI_FPRINTF_INFO("TASK_S11 instance %d terminated\n", (int)(instance_p - s11_sgw_instances));
         itti_exit_task ();
       }
       break;
@@ -275,7 +484,7 @@ static void *s11_sgw_thread (void *args)
 }
 
 //------------------------------------------------------------------------------
-static int s11_send_init_udp (struct in_addr *address, uint16_t port_number)
+static int s11_send_init_udp (struct in_addr *address, uint16_t port_number, udp_steer_cb_t steer)
 {
   MessageDef                             *message_p;
 
@@ -287,6 +496,7 @@ static int s11_send_init_udp (struct in_addr *address, uint16_t port_number)
 
   message_p->ittiMsg.udp_init.port = port_number;
   message_p->ittiMsg.udp_init.address.s_addr = address->s_addr;
+  message_p->ittiMsg.udp_init.steer = steer;
   char ipv4[INET_ADDRSTRLEN];
   inet_ntop (AF_INET, (void*)&message_p->ittiMsg.udp_init.address, ipv4, INET_ADDRSTRLEN);
   OAILOG_DEBUG (LOG_S11, "Tx UDP_INIT IP addr %s:%" PRIu16"\n", ipv4, message_p->ittiMsg.udp_init.port);
@@ -301,51 +511,77 @@ int s11_sgw_init (sgw_config_t * config_p)
   nw_gtpv2c_udp_entity_t                      udp;
   nw_gtpv2c_timer_mgr_entity_t                 tmrMgr;
   nw_gtpv2c_log_mgr_entity_t                   logMgr;
+  uint32_t                                expected_sessions = SGW_EXPECTED_SESSIONS_DEFAULT;
 
   OAILOG_DEBUG (LOG_S11, "Initializing S11 interface\n");
 
-  if (nwGtpv2cInitialize (&s11_sgw_stack_handle) != NW_OK) {
-    OAILOG_ERROR (LOG_S11, "Failed to initialize gtpv2-c stack\n");
-    goto fail;
+  sgw_config_read_lock (config_p);
+  s11_sgw_nb_instances = (int)config_p->s11_gtpv2c_instances;
+  expected_sessions = config_p->expected_sessions;
+  sgw_config_unlock (config_p);
+  if ((s11_sgw_nb_instances < 1) || (s11_sgw_nb_instances > SGW_S11_GTPV2C_INSTANCES_MAX)) {
+    OAILOG_WARNING (LOG_S11, "Bad number of S11 GTPv2-C instances %d, using 1\n", s11_sgw_nb_instances);
+    s11_sgw_nb_instances = 1;
   }
 
   /*
-   * Set ULP entity
-   */
-  ulp.hUlp = (nw_gtpv2c_ulp_handle_t) NULL;
-  ulp.ulpReqCallback = s11_sgw_ulp_process_stack_req_cb;
-  DevAssert (NW_OK == nwGtpv2cSetUlpEntity (s11_sgw_stack_handle, &ulp));
-  /*
-   * Set UDP entity
-   */
-  udp.hUdp = (nw_gtpv2c_udp_handle_t) NULL;
-  udp.udpDataReqCallback = s11_sgw_send_udp_msg;
-  DevAssert (NW_OK == nwGtpv2cSetUdpEntity (s11_sgw_stack_handle, &udp));
-  /*
-   * Set Timer entity
+   * Parsers of received messages are built once, not for each message
    */
-  tmrMgr.tmrMgrHandle = (nw_gtpv2c_timer_mgr_handle_t) NULL;
-  tmrMgr.tmrStartCallback = s11_sgw_start_timer_wrapper;
-  tmrMgr.tmrStopCallback = s11_sgw_stop_timer_wrapper;
-  DevAssert (NW_OK == nwGtpv2cSetTimerMgrEntity (s11_sgw_stack_handle, &tmrMgr));
-  logMgr.logMgrHandle = 0;
-  logMgr.logReqCallback = s11_sgw_log_wrapper;
-  DevAssert (NW_OK == nwGtpv2cSetLogMgrEntity (s11_sgw_stack_handle, &logMgr));
-
+  s11_sgw_session_manager_init ();
+  s11_sgw_bearer_manager_init ();
 
   bstring b = bfromcstr("s11_sgw_teid_2_gtv2c_teid_handle");
-  s11_sgw_teid_2_gtv2c_teid_handle = hashtable_ts_create(256, HASH_TABLE_DEFAULT_HASH_FUNC, hash_free_int_func, b);
+  s11_sgw_teid_2_gtv2c_teid_handle = hashtable_ts_create(expected_sessions, HASH_TABLE_DEFAULT_HASH_FUNC, hash_free_int_func, b);
   bdestroy_wrapper (&b);
+  if (s11_sgw_nb_instances > 1) {
+    b = bfromcstr("s11_sgw_teid_2_instance");
+    s11_sgw_teid_2_instance = hashtable_ts_create(expected_sessions, HASH_TABLE_DEFAULT_HASH_FUNC, hash_free_int_func, b);
+    bdestroy_wrapper (&b);
+  }
 
+  for (int i = 0; i < s11_sgw_nb_instances; i++) {
+    s11_sgw_instance_t                     *instance_p = &s11_sgw_instances[i];
 
-  if (itti_create_task (TASK_S11, &s11_sgw_thread, NULL) < 0) {
-    OAILOG_ERROR (LOG_S11, "S11 pthread_create: %s\n", strerror (errno));
-    goto fail;
+    if (nwGtpv2cInitialize (&instance_p->stack_handle) != NW_OK) {
+      OAILOG_ERROR (LOG_S11, "Failed to initialize gtpv2-c stack instance %d\n", i);
+      goto fail;
+    }
+    /*
+     * Set ULP entity
+     */
+    ulp.hUlp = (nw_gtpv2c_ulp_handle_t) instance_p;
+    ulp.ulpReqCallback = s11_sgw_ulp_process_stack_req_cb;
+    DevAssert (NW_OK == nwGtpv2cSetUlpEntity (instance_p->stack_handle, &ulp));
+    /*
+     * Set UDP entity
+     */
+    udp.hUdp = (nw_gtpv2c_udp_handle_t) NULL;
+    udp.udpDataReqCallback = s11_sgw_send_udp_msg;
+    DevAssert (NW_OK == nwGtpv2cSetUdpEntity (instance_p->stack_handle, &udp));
+    /*
+     * Set Timer entity
+     */
+    tmrMgr.tmrMgrHandle = (nw_gtpv2c_timer_mgr_handle_t) instance_p;
+    tmrMgr.tmrStartCallback = s11_sgw_start_timer_wrapper;
+    tmrMgr.tmrStopCallback = s11_sgw_stop_timer_wrapper;
+    DevAssert (NW_OK == nwGtpv2cSetTimerMgrEntity (instance_p->stack_handle, &tmrMgr));
+    logMgr.logMgrHandle = 0;
+    logMgr.logReqCallback = s11_sgw_log_wrapper;
+    DevAssert (NW_OK == nwGtpv2cSetLogMgrEntity (instance_p->stack_handle, &logMgr));
+    DevAssert (NW_OK == nwGtpv2cSetLogLevel (instance_p->stack_handle, NW_LOG_LEVEL_DEBG));
+  }
+
+  s11_sgw_nb_running_instances = s11_sgw_nb_instances;
+  for (int i = 0; i < s11_sgw_nb_instances; i++) {
+    if (itti_create_task (s11_sgw_instances[i].task_id, &s11_sgw_thread, &s11_sgw_instances[i]) < 0) {
+      OAILOG_ERROR (LOG_S11, "S11 instance %d pthread_create: %s\n", i, strerror (errno));
+      goto fail;
+    }
   }
 
-  DevAssert (NW_OK == nwGtpv2cSetLogLevel (s11_sgw_stack_handle, NW_LOG_LEVEL_DEBG));
   sgw_config_read_lock (config_p);
-  s11_send_init_udp (&config_p->ipv4.S11, 2123);
+  // All instances send on the socket of TASK_S11
+  s11_send_init_udp (&config_p->ipv4.S11, 2123, (s11_sgw_nb_instances > 1) ? s11_sgw_steer_udp_msg : NULL);
   sgw_config_unlock (config_p);
   OAILOG_DEBUG (LOG_S11, "Initializing S11 interface: DONE\n");
   return ret;
@@ -354,9 +590,18 @@ fail:
   return RETURNerror;
 }
 //------------------------------------------------------------------------------
-static void s11_sgw_exit (void)
+static void s11_sgw_exit (s11_sgw_instance_t * const instance_p)
 {
-  nwGtpv2cFinalize (s11_sgw_stack_handle);
-  hashtable_ts_destroy(s11_sgw_teid_2_gtv2c_teid_handle);
+  nwGtpv2cFinalize (instance_p->stack_handle);
+  instance_p->stack_handle = 0;
+  // The UDP steering and the other instances use the tables until the last instance is gone
+  if (0 == __sync_sub_and_fetch (&s11_sgw_nb_running_instances, 1)) {
+    hashtable_ts_destroy(s11_sgw_teid_2_gtv2c_teid_handle);
+    s11_sgw_teid_2_gtv2c_teid_handle = NULL;
+    if (s11_sgw_teid_2_instance) {
+      hashtable_ts_destroy(s11_sgw_teid_2_instance);
+      s11_sgw_teid_2_instance = NULL;
+    }
+  }
 }
 
@@ -29,6 +29,15 @@
 #ifndef FILE_S11_SGW_SEEN
 #define FILE_S11_SGW_SEEN
 
+/* Task of the SPGW_APP shard owning a session, from its local S11 TEID (0 for a
+ * Create Session Request, the S11 TEID is not allocated yet) and the MME S11 TEID */
+typedef task_id_t (*s11_sgw_app_task_cb_t)(const teid_t local_teid, const teid_t peer_teid);
+
 int s11_sgw_init(sgw_config_t *mme_config);
 
+/* To be set before s11_sgw_init(), without it all messages go to TASK_SPGW_APP */
+void s11_sgw_set_app_task_cb(s11_sgw_app_task_cb_t app_task_cb);
+
+task_id_t s11_sgw_app_task(const teid_t local_teid, const teid_t peer_teid);
+
 #endif /* FILE_S11_SGW_SEEN */
@@ -27,6 +27,7 @@
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -44,13 +45,51 @@
 #include "NwGtpv2cMsg.h"
 #include "NwGtpv2cMsgParser.h"
 #include "sgw_ie_defs.h"
+#include "sgw_config.h"
 #include "s11_common.h"
+#include "s11_sgw.h"
 #include "s11_sgw_bearer_manager.h"
 #include "s11_ie_formatter.h"
 #include "log.h"
 
 extern hash_table_ts_t                        *s11_sgw_teid_2_gtv2c_teid_handle;
 
+static const s11_msg_decoder_ie_t        s11_sgw_modify_bearer_request_ies[] = {
+  {NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_INDICATION_FLAGS, offsetof (itti_s11_modify_bearer_request_t, indication_flags)},
+  {NW_GTPV2C_IE_FQ_CSID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_FQCSID, offsetof (itti_s11_modify_bearer_request_t, mme_fq_csid)},
+  {NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_RAT_TYPE, offsetof (itti_s11_modify_bearer_request_t, rat_type)},
+  {NW_GTPV2C_IE_DELAY_VALUE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_DELAY_VALUE, offsetof (itti_s11_modify_bearer_request_t, delay_dl_packet_notif_req)},
+  {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_BEARER_CONTEXT_TO_BE_MODIFIED_WITHIN_MODIFY_BEARER_REQUEST, offsetof (itti_s11_modify_bearer_request_t, bearer_contexts_to_be_modified)},
+};
+
+static s11_msg_decoder_t                s11_sgw_modify_bearer_request_decoder;
+
+static const s11_msg_decoder_ie_t        s11_sgw_release_access_bearers_request_ies[] = {
+  {NW_GTPV2C_IE_NODE_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_NODE_TYPE, offsetof (itti_s11_release_access_bearers_request_t, originating_node)},
+};
+
+static s11_msg_decoder_t                s11_sgw_release_access_bearers_request_decoder;
+
+static const s11_msg_decoder_ie_t        s11_sgw_create_bearer_response_ies[] = {
+  {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, offsetof (itti_s11_create_bearer_response_t, cause)},
+  {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_BEARER_CONTEXT_WITHIN_CREATE_BEARER_RESPONSE, offsetof (itti_s11_create_bearer_response_t, bearer_contexts)},
+  {NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, S11_IE_DECODER_PCO, offsetof (itti_s11_create_bearer_response_t, pco)},
+};
+
+static s11_msg_decoder_t                s11_sgw_create_bearer_response_decoder;
+
+//------------------------------------------------------------------------------
+void
+s11_sgw_bearer_manager_init (void)
+{
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_sgw_modify_bearer_request_decoder, NW_GTP_MODIFY_BEARER_REQ,
+      s11_sgw_modify_bearer_request_ies, sizeof (s11_sgw_modify_bearer_request_ies) / sizeof (s11_sgw_modify_bearer_request_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_sgw_release_access_bearers_request_decoder, NW_GTP_RELEASE_ACCESS_BEARERS_REQ,
+      s11_sgw_release_access_bearers_request_ies, sizeof (s11_sgw_release_access_bearers_request_ies) / sizeof (s11_sgw_release_access_bearers_request_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_sgw_create_bearer_response_decoder, NW_GTP_CREATE_BEARER_RSP,
+      s11_sgw_create_bearer_response_ies, sizeof (s11_sgw_create_bearer_response_ies) / sizeof (s11_sgw_create_bearer_response_ies[0])));
+}
+
 //------------------------------------------------------------------------------
 int
 s11_sgw_handle_modify_bearer_request (
@@ -63,7 +102,6 @@ s11_sgw_handle_modify_bearer_request (
   uint16_t                                offendingIeLength;
   itti_s11_modify_bearer_request_t       *request_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_MODIFY_BEARER_REQUEST);
@@ -71,41 +109,9 @@ s11_sgw_handle_modify_bearer_request (
   request_p->trxn = (void *)pUlpApi->u_api_info.initialReqIndInfo.hTrxn;
   request_p->teid = nwGtpv2cMsgGetTeid (pUlpApi->hMsg);
   /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_MODIFY_BEARER_REQ, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Indication Flags IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_indication_flags_ie_get, &request_p->indication_flags);
-  DevAssert (NW_OK == rc);
-  /*
-   * MME-FQ-CSID IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FQ_CSID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_fqcsid_ie_get, &request_p->mme_fq_csid);
-  DevAssert (NW_OK == rc);
-  /*
-   * RAT Type IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_rat_type_ie_get, &request_p->rat_type);
-  DevAssert (NW_OK == rc);
-  /*
-   * Delay Value IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_DELAY_VALUE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_delay_value_ie_get, &request_p->delay_dl_packet_notif_req);
-  DevAssert (NW_OK == rc);
-  /*
-   * Bearer Context to be modified IE
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_bearer_context_to_be_modified_within_modify_bearer_request_ie_get, &request_p->bearer_contexts_to_be_modified);
-  DevAssert (NW_OK == rc);
-  rc = nwGtpv2cMsgParserRun (pMsgParser, pUlpApi->hMsg, &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_sgw_modify_bearer_request_decoder, pUlpApi->hMsg, request_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     gtpv2c_cause_t                             cause;
@@ -141,18 +147,14 @@ s11_sgw_handle_modify_bearer_request (
     DevAssert (NW_OK == rc);
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return NW_OK;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
-  return itti_send_msg_to_task (TASK_SPGW_APP, INSTANCE_DEFAULT, message_p);
+  return itti_send_msg_to_task (s11_sgw_app_task (request_p->teid, 0), INSTANCE_DEFAULT, message_p);
 }
 
 //------------------------------------------------------------------------------
@@ -194,33 +196,33 @@ s11_sgw_handle_modify_bearer_response (
 int
 s11_sgw_handle_release_access_bearers_request (
   nw_gtpv2c_stack_handle_t * stack_p,
-  nw_gtpv2c_ulp_api_t * pUlpApi)
+  nw_gtpv2c_ulp_api_t * pUlpApi,
+  MessageDef ** const batch_pp)
 {
   nw_rc_t                                   rc = NW_OK;
   uint8_t                                 offendingIeType,
                                           offendingIeInstance;
   uint16_t                                offendingIeLength;
+  itti_s11_release_access_bearers_request_batch_t *batch_p = NULL;
   itti_s11_release_access_bearers_request_t  *request_p = NULL;
-  MessageDef                             *message_p = NULL;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser = NULL;
 
   DevAssert (stack_p );
-  message_p = itti_alloc_new_message (TASK_S11, S11_RELEASE_ACCESS_BEARERS_REQUEST);
-  request_p = &message_p->ittiMsg.s11_release_access_bearers_request;
+  DevAssert (batch_pp );
+  if (!*batch_pp) {
+    *batch_pp = itti_alloc_new_message (TASK_S11, S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH);
+    S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (*batch_pp).nb_requests = 0;
+  }
+  batch_p = &S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH (*batch_pp);
+  DevAssert (S11_RELEASE_ACCESS_BEARERS_BATCH_MAX > batch_p->nb_requests);
+  request_p = &batch_p->request[batch_p->nb_requests];
+  memset (request_p, 0, sizeof (*request_p));
 
   request_p->trxn = (void *)pUlpApi->u_api_info.initialReqIndInfo.hTrxn;
   request_p->teid = nwGtpv2cMsgGetTeid (pUlpApi->hMsg);
   /*
-   * Create a new message parser
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_RELEASE_ACCESS_BEARERS_REQ, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-
-
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_NODE_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_node_type_ie_get, &request_p->originating_node);
-
-  rc = nwGtpv2cMsgParserRun (pMsgParser, pUlpApi->hMsg, &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_sgw_release_access_bearers_request_decoder, pUlpApi->hMsg, request_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     gtpv2c_cause_t                             cause;
@@ -254,21 +256,15 @@ s11_sgw_handle_release_access_bearers_request (
     OAILOG_DEBUG (LOG_S11, "Received NW_GTP_RELEASE_ACCESS_BEARERS_REQ, Sending NW_GTP_RELEASE_ACCESS_BEARERS_RSP!\n");
     rc = nwGtpv2cProcessUlpReq (*stack_p, &ulp_req);
     DevAssert (NW_OK == rc);
-    itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
-    message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNok;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
-
-  return itti_send_msg_to_task (TASK_SPGW_APP, INSTANCE_DEFAULT, message_p);
+  batch_p->nb_requests += 1;
+  return RETURNok;
 }
 
 //------------------------------------------------------------------------------
@@ -375,7 +371,6 @@ s11_sgw_handle_create_bearer_response (
   uint16_t                                offendingIeLength;
   itti_s11_create_bearer_response_t      *resp_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                 *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_BEARER_RESPONSE);
@@ -384,32 +379,9 @@ s11_sgw_handle_create_bearer_response (
   resp_p->teid = nwGtpv2cMsgGetTeid(pUlpApi->hMsg);
 
   /*
-   * Create a new message parser
+   * Decode with the dispatch table built at init
    */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_CREATE_BEARER_RSP, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Cause IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, gtpv2c_cause_ie_get,
-      &resp_p->cause);
-  DevAssert (NW_OK == rc);
-
-
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-      gtpv2c_bearer_context_within_create_bearer_response_ie_get,
-      &resp_p->bearer_contexts);
-  DevAssert (NW_OK == rc);
-
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, gtpv2c_pco_ie_get,
-      &resp_p->pco);
-  DevAssert (NW_OK == rc);
-
-
-  /*
-   * Run the parser
-   */
-  rc = nwGtpv2cMsgParserRun (pMsgParser, (pUlpApi->hMsg), &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  rc = s11_msg_decode (&s11_sgw_create_bearer_response_decoder, (pUlpApi->hMsg), resp_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     MSC_LOG_RX_DISCARDED_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_BEARER_RESPONSE local S11 teid " TEID_FMT " ", resp_p->teid);
@@ -418,8 +390,6 @@ s11_sgw_handle_create_bearer_response (
      */
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNerror;
@@ -428,10 +398,8 @@ s11_sgw_handle_create_bearer_response (
   MSC_LOG_RX_MESSAGE (MSC_S11_MME, MSC_SGW, NULL, 0, "0 CREATE_BEARER_RESPONSE local S11 teid " TEID_FMT " cause %u",
     resp_p->teid, resp_p->cause);
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
-  return itti_send_msg_to_task (TASK_SPGW_APP, INSTANCE_DEFAULT, message_p);
+  return itti_send_msg_to_task (s11_sgw_app_task (resp_p->teid, 0), INSTANCE_DEFAULT, message_p);
 }
 
@@ -30,6 +30,9 @@
 #ifndef FILE_S11_SGW_BEARER_MANAGER_SEEN
 #define FILE_S11_SGW_BEARER_MANAGER_SEEN
 
+/* @brief Build the parsers of the bearer management messages received from MME, once at init. */
+void s11_sgw_bearer_manager_init (void);
+
 int s11_sgw_handle_modify_bearer_request(
   nw_gtpv2c_stack_handle_t *stack_p,
   nw_gtpv2c_ulp_api_t      *pUlpApi);
@@ -38,9 +41,12 @@ int s11_sgw_handle_modify_bearer_response(
   nw_gtpv2c_stack_handle_t    *stack_p,
   itti_s11_modify_bearer_response_t *modify_bearer_response_p);
 
+/* @brief Handle a Release Access Bearers Request received from MME: the request
+ * is appended to *batch_pp (allocated if NULL), the caller forwards the batch to the SPGW_APP shard owning the session. */
 int s11_sgw_handle_release_access_bearers_request (
   nw_gtpv2c_stack_handle_t * stack_p,
-  nw_gtpv2c_ulp_api_t * pUlpApi);
+  nw_gtpv2c_ulp_api_t * pUlpApi,
+  MessageDef ** const batch_pp);
 
 int s11_sgw_handle_release_access_bearers_response (
   nw_gtpv2c_stack_handle_t * stack_p,
@@ -27,6 +27,7 @@
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -44,13 +45,57 @@
 #include "NwGtpv2cMsg.h"
 #include "NwGtpv2cMsgParser.h"
 #include "sgw_ie_defs.h"
+#include "sgw_config.h"
 #include "s11_common.h"
+#include "s11_sgw.h"
 #include "s11_sgw_session_manager.h"
 #include "s11_ie_formatter.h"
 #include "log.h"
 
 extern hash_table_ts_t                        *s11_sgw_teid_2_gtv2c_teid_handle;
 
+static const s11_msg_decoder_ie_t        s11_sgw_create_session_request_ies[] = {
+  {NW_GTPV2C_IE_IMSI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_IMSI, offsetof (itti_s11_create_session_request_t, imsi)},
+  {NW_GTPV2C_IE_MSISDN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_MSISDN, offsetof (itti_s11_create_session_request_t, msisdn)},
+  {NW_GTPV2C_IE_MEI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_MEI, offsetof (itti_s11_create_session_request_t, mei)},
+  {NW_GTPV2C_IE_ULI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_ULI, offsetof (itti_s11_create_session_request_t, uli)},
+  {NW_GTPV2C_IE_SERVING_NETWORK, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_SERVING_NETWORK, offsetof (itti_s11_create_session_request_t, serving_network)},
+  {NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_RAT_TYPE, offsetof (itti_s11_create_session_request_t, rat_type)},
+  {NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_INDICATION_FLAGS, offsetof (itti_s11_create_session_request_t, indication_flags)},
+  {NW_GTPV2C_IE_APN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_APN, offsetof (itti_s11_create_session_request_t, apn)},
+  {NW_GTPV2C_IE_SELECTION_MODE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_NONE, 0},
+  {NW_GTPV2C_IE_PDN_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PDN_TYPE, offsetof (itti_s11_create_session_request_t, pdn_type)},
+  {NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PAA, offsetof (itti_s11_create_session_request_t, paa)},
+  {NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_FTEID, offsetof (itti_s11_create_session_request_t, sender_fteid_for_cp)},
+  {NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_FTEID, offsetof (itti_s11_create_session_request_t, pgw_address_for_cp)},
+  {NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_NONE, 0},
+  {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_BEARER_CONTEXT_TO_BE_CREATED_WITHIN_CREATE_SESSION_REQUEST, offsetof (itti_s11_create_session_request_t, bearer_contexts_to_be_created)},
+  {NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PCO, offsetof (itti_s11_create_session_request_t, pco)},
+  // TODO {NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, s11_bearer_context_to_be_removed_ie_get, offsetof (itti_s11_create_session_request_t, bearer_contexts_to_be_removed)},
+  {NW_GTPV2C_IE_AMBR, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_AMBR, offsetof (itti_s11_create_session_request_t, ambr)},
+  {NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_NONE, 0},
+};
+
+static s11_msg_decoder_t                s11_sgw_create_session_request_decoder;
+
+static const s11_msg_decoder_ie_t        s11_sgw_delete_session_request_ies[] = {
+  {NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, S11_IE_DECODER_FTEID, offsetof (itti_s11_delete_session_request_t, sender_fteid_for_cp)},
+  {NW_GTPV2C_IE_EBI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL, S11_IE_DECODER_EBI, offsetof (itti_s11_delete_session_request_t, lbi)},
+  {NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_INDICATION_FLAGS, offsetof (itti_s11_delete_session_request_t, indication_flags)},
+};
+
+static s11_msg_decoder_t                s11_sgw_delete_session_request_decoder;
+
+//------------------------------------------------------------------------------
+void
+s11_sgw_session_manager_init (void)
+{
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_sgw_create_session_request_decoder, NW_GTP_CREATE_SESSION_REQ,
+      s11_sgw_create_session_request_ies, sizeof (s11_sgw_create_session_request_ies) / sizeof (s11_sgw_create_session_request_ies[0])));
+  DevAssert (RETURNok == s11_msg_decoder_init (&s11_sgw_delete_session_request_decoder, NW_GTP_DELETE_SESSION_REQ,
+      s11_sgw_delete_session_request_ies, sizeof (s11_sgw_delete_session_request_ies) / sizeof (s11_sgw_delete_session_request_ies[0])));
+}
+
 //------------------------------------------------------------------------------
 int
 s11_sgw_handle_create_session_request (
@@ -63,136 +108,17 @@ s11_sgw_handle_create_session_request (
   uint16_t                                offendingIeLength;
   itti_s11_create_session_request_t      *create_session_request_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_SESSION_REQUEST);
   create_session_request_p = &message_p->ittiMsg.s11_create_session_request;
-  /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_CREATE_SESSION_REQ, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * Imsi IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_IMSI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_imsi_ie_get, &create_session_request_p->imsi);
-  DevAssert (NW_OK == rc);
-  /*
-   * MSISDN IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_MSISDN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_msisdn_ie_get, &create_session_request_p->msisdn);
-  DevAssert (NW_OK == rc);
-  /*
-   * MEI IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_MEI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_mei_ie_get, &create_session_request_p->mei);
-  DevAssert (NW_OK == rc);
-  /*
-   * ULI IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_ULI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_uli_ie_get, &create_session_request_p->uli);
-  DevAssert (NW_OK == rc);
-  /*
-   * Serving Network IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_SERVING_NETWORK, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_serving_network_ie_get, &create_session_request_p->serving_network);
-  DevAssert (NW_OK == rc);
-  /*
-   * RAT Type IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-		  gtpv2c_rat_type_ie_get, &create_session_request_p->rat_type);
-  DevAssert (NW_OK == rc);
-  /*
-   * Indication Flags IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_indication_flags_ie_get, &create_session_request_p->indication_flags);
-  DevAssert (NW_OK == rc);
-  /*
-   * APN IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_APN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-		  gtpv2c_apn_ie_get, &create_session_request_p->apn);
-  DevAssert (NW_OK == rc);
-  /*
-   * Selection Mode IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_SELECTION_MODE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  s11_ie_indication_generic, NULL);
-  DevAssert (NW_OK == rc);
-  /*
-   * PDN Type IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PDN_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_pdn_type_ie_get, &create_session_request_p->pdn_type);
-  DevAssert (NW_OK == rc);
-  /*
-   * PAA IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-           gtpv2c_paa_ie_get, &create_session_request_p->paa);
-  DevAssert (NW_OK == rc);
-  /*
-   * Sender FTEID for CP IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-           gtpv2c_fteid_ie_get, &create_session_request_p->sender_fteid_for_cp);
-  DevAssert (NW_OK == rc);
-  /*
-   * PGW FTEID for CP IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-		  gtpv2c_fteid_ie_get, &create_session_request_p->pgw_address_for_cp);
-  DevAssert (NW_OK == rc);
-  /*
-   * APN Restriction IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-           s11_ie_indication_generic, NULL);
-  DevAssert (NW_OK == rc);
-  /*
-   * Bearer Context IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-      gtpv2c_bearer_context_to_be_created_within_create_session_request_ie_get, &create_session_request_p->bearer_contexts_to_be_created);
-  DevAssert (NW_OK == rc);
-
-
-  /*
-   * Protocol Configuration Options IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_pco_ie_get, &create_session_request_p->pco);
-  DevAssert (NW_OK == rc);
-
-
-  /*TODO rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-           s11_bearer_context_to_be_removed_ie_get, &create_session_request_p->bearer_contexts_to_be_removed);
-  DevAssert (NW_OK == rc);*/
-
-  /*
-   * AMBR IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_AMBR, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-           gtpv2c_ambr_ie_get, &create_session_request_p->ambr);
-  DevAssert (NW_OK == rc);
-  /*
-   * Recovery IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY,
-		  s11_ie_indication_generic, NULL);
-  DevAssert (NW_OK == rc);
   create_session_request_p->teid = nwGtpv2cMsgGetTeid (pUlpApi->hMsg);
   create_session_request_p->trxn = (void *)pUlpApi->u_api_info.initialReqIndInfo.hTrxn;
   create_session_request_p->peer_ip = pUlpApi->u_api_info.initialReqIndInfo.peerIp;
-  rc = nwGtpv2cMsgParserRun (pMsgParser, pUlpApi->hMsg, &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  /*
+   * Decode with the dispatch table built at init
+   */
+  rc = s11_msg_decode (&s11_sgw_create_session_request_decoder, pUlpApi->hMsg, create_session_request_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     gtpv2c_cause_t                             cause;
@@ -228,18 +154,14 @@ s11_sgw_handle_create_session_request (
     DevAssert (NW_OK == rc);
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return RETURNok;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
-  return itti_send_msg_to_task (TASK_SPGW_APP, INSTANCE_DEFAULT, message_p);
+  return itti_send_msg_to_task (s11_sgw_app_task (0, create_session_request_p->sender_fteid_for_cp.teid), INSTANCE_DEFAULT, message_p);
 }
 
 //------------------------------------------------------------------------------
@@ -335,42 +257,17 @@ s11_sgw_handle_delete_session_request (
   uint16_t                                offendingIeLength;
   itti_s11_delete_session_request_t      *delete_session_request_p;
   MessageDef                             *message_p;
-  nw_gtpv2c_msg_parser_t                     *pMsgParser;
 
   DevAssert (stack_p );
   message_p = itti_alloc_new_message (TASK_S11, S11_DELETE_SESSION_REQUEST);
   delete_session_request_p = &message_p->ittiMsg.s11_delete_session_request;
-  /*
-   * Create a new message parser
-   */
-  rc = nwGtpv2cMsgParserNew (*stack_p, NW_GTP_DELETE_SESSION_REQ, s11_ie_indication_generic, NULL, &pMsgParser);
-  DevAssert (NW_OK == rc);
-  /*
-   * MME FTEID for CP IE
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL,
-      gtpv2c_fteid_ie_get, &delete_session_request_p->sender_fteid_for_cp);
-  DevAssert (NW_OK == rc);
-  /*
-   * Linked EPS Bearer Id IE
-   * * * * This information element shall not be present for TAU/RAU/Handover with
-   * * * * S-GW relocation procedures.
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_EBI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_OPTIONAL,
-      gtpv2c_ebi_ie_get, &delete_session_request_p->lbi);
-  DevAssert (NW_OK == rc);
-  /*
-   * Indication Flags IE
-   * * * * For a Delete Session Request on S11 interface,
-   * * * * only the Operation Indication flag might be present.
-   */
-  rc = nwGtpv2cMsgParserAddIe (pMsgParser, NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL,
-      gtpv2c_indication_flags_ie_get, &delete_session_request_p->indication_flags);
-  DevAssert (NW_OK == rc);
   delete_session_request_p->teid = nwGtpv2cMsgGetTeid (pUlpApi->hMsg);
   delete_session_request_p->trxn = (void *)pUlpApi->u_api_info.initialReqIndInfo.hTrxn;
   delete_session_request_p->peer_ip = pUlpApi->u_api_info.initialReqIndInfo.peerIp;
-  rc = nwGtpv2cMsgParserRun (pMsgParser, pUlpApi->hMsg, &offendingIeType, &offendingIeInstance, &offendingIeLength);
+  /*
+   * Decode with the dispatch table built at init
+   */
+  rc = s11_msg_decode (&s11_sgw_delete_session_request_decoder, pUlpApi->hMsg, delete_session_request_p, &offendingIeType, &offendingIeInstance, &offendingIeLength);
 
   if (rc != NW_OK) {
     nw_gtpv2c_ulp_api_t                         ulp_req;
@@ -408,18 +305,14 @@ s11_sgw_handle_delete_session_request (
     DevAssert (NW_OK == rc);
     itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
     message_p = NULL;
-    rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-    DevAssert (NW_OK == rc);
     rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
     DevAssert (NW_OK == rc);
     return NW_OK;
   }
 
-  rc = nwGtpv2cMsgParserDelete (*stack_p, pMsgParser);
-  DevAssert (NW_OK == rc);
   rc = nwGtpv2cMsgDelete (*stack_p, (pUlpApi->hMsg));
   DevAssert (NW_OK == rc);
-  return itti_send_msg_to_task (TASK_SPGW_APP, INSTANCE_DEFAULT, message_p);
+  return itti_send_msg_to_task (s11_sgw_app_task (delete_session_request_p->teid, 0), INSTANCE_DEFAULT, message_p);
 }
 
 //------------------------------------------------------------------------------
@@ -29,6 +29,9 @@
 #ifndef FILE_S11_SGW_SESSION_MANAGER_SEEN
 #define FILE_S11_SGW_SESSION_MANAGER_SEEN
 
+/* @brief Build the parsers of the session management messages received from MME, once at init. */
+void s11_sgw_session_manager_init (void);
+
 int s11_sgw_handle_create_session_request(
   nw_gtpv2c_stack_handle_t *stack_p,
   nw_gtpv2c_ulp_api_t      *pUlpApi);
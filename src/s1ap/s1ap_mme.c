@@ -50,9 +50,12 @@
 #include "s1ap_mme_handlers.h"
 #include "s1ap_ies_defs.h"
 #include "s1ap_mme_nas_procedures.h"
+#include "s1ap_mme_overload.h"
+#include "s1ap_mme_template_encoder.h"
 #include "s1ap_mme_retransmission.h"
 #include "s1ap_mme_itti_messaging.h"
 #include "dynamic_memory_check.h"
+#include "sctp_itti_messaging.h"
 #include "mme_config.h"
 #include "timer.h"
 #include "itti_free_defined_msg.h"
@@ -131,11 +134,21 @@ s1ap_mme_thread (
          * * * * Decode and handle it.
          */
         s1ap_message                            message = {0};
+        s1ap_overload_event_t                   overload_event = S1AP_OVERLOAD_EVENT_NONE;
+        bool                                    process = s1ap_mme_overload_dequeued (SCTP_DATA_IND (received_message_p).payload,
+                                                                                      SCTP_DATA_IND (received_message_p).enqueue_time_us,
+                                                                                      s1ap_mme_overload_time_us (), &overload_event);
+
+        if (S1AP_OVERLOAD_EVENT_NONE != overload_event) {
+          s1ap_mme_handle_overload_event (overload_event);
+        }
 
         /*
          * Invoke S1AP message decoder
          */
-        if (s1ap_mme_decode_pdu (&message, SCTP_DATA_IND (received_message_p).payload, &message_id) < 0) {
+        if (!process) {
+          OAILOG_DEBUG (LOG_S1AP, "Overload: discarding InitialUEMessage from assoc id %d\n", SCTP_DATA_IND (received_message_p).assoc_id);
+        } else if (s1ap_mme_decode_pdu (&message, SCTP_DATA_IND (received_message_p).payload, &message_id) < 0) {
           // TODO: Notify eNB of failure with right cause
           OAILOG_ERROR (LOG_S1AP, "Failed to decode new buffer\n");
         } else {
@@ -266,6 +279,11 @@ int s1ap_mme_init(void)
   }
 
   OAILOG_DEBUG (LOG_S1AP, "S1AP Release v10.5\n");
+  mme_config_read_lock (&mme_config);
+  s1ap_mme_overload_init (mme_config.s1ap_config.overload_max_pending, mme_config.s1ap_config.overload_initial_ue_max_pending,
+                          mme_config.s1ap_config.overload_start_latency_ms, mme_config.s1ap_config.overload_stop_latency_ms);
+  mme_config_unlock (&mme_config);
+  sctp_itti_set_admission_control (s1ap_mme_overload_admit, s1ap_mme_overload_cancel);
   // 16 entries for n eNB.
   bstring bs1 = bfromcstr("s1ap_eNB_coll");
   hash_table_ts_t* h = hashtable_ts_init (&g_s1ap_enb_coll, mme_config.max_enbs, NULL, free_wrapper, bs1);
@@ -301,6 +319,7 @@ void s1ap_mme_exit (void)
   if (hashtable_ts_destroy(&g_s1ap_mme_id2assoc_id_coll) != HASH_TABLE_OK) {
     OAI_FPRINTF_ERR("An error occured while destroying assoc_id hash table");
   }
+  s1ap_mme_template_encoder_reset ();
   OAILOG_DEBUG (LOG_S1AP, "Cleaning S1AP: DONE\n");
 }
 
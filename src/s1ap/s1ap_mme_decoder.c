@@ -42,6 +42,7 @@
 #include "s1ap_ies_defs.h"
 #include "s1ap_mme.h"
 #include "s1ap_mme_decoder.h"
+#include "s1ap_mme_fast_decoder.h"
 #include "s1ap_mme_handlers.h"
 #include "dynamic_memory_check.h"
 
@@ -193,7 +194,7 @@ s1ap_mme_decode_unsuccessfull_outcome (
 }
 
 int
-s1ap_mme_decode_pdu (
+s1ap_mme_decode_pdu_asn1c (
   s1ap_message *message,
   const_bstring const raw,
   MessagesIds *message_id) {
@@ -231,6 +232,32 @@ s1ap_mme_decode_pdu (
   return -1;
 }
 
+int
+s1ap_mme_decode_pdu (
+  s1ap_message *message,
+  const_bstring const raw,
+  MessagesIds *message_id) {
+
+#if S1AP_FAST_DECODER
+  /*
+   * The fast path leaves *message_id untouched (MESSAGES_ID_MAX), the decoded
+   * message points inside raw and has nothing to be freed.
+   */
+  if (s1ap_mme_fast_decode_pdu (message, raw)) {
+#  if S1AP_FAST_DECODER_CHECK
+    s1ap_message                            ref = {0};
+    MessagesIds                             ref_id = MESSAGES_ID_MAX;
+
+    AssertFatal (s1ap_mme_decode_pdu_asn1c (&ref, raw, &ref_id) >= 0, "asn1c failed to decode a PDU accepted by the fast decoder\n");
+    AssertFatal (s1ap_mme_fast_decoder_compare (message, &ref), "Fast decoder mismatch with asn1c decoder, procedure code %d\n", (int)message->procedureCode);
+    s1ap_free_mme_decode_pdu (&ref, ref_id);
+#  endif
+    return RETURNok;
+  }
+#endif
+  return s1ap_mme_decode_pdu_asn1c (message, raw, message_id);
+}
+
 int s1ap_free_mme_decode_pdu(
     s1ap_message *message, MessagesIds message_id) {
   switch(message_id) {
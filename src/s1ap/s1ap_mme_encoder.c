@@ -67,6 +67,14 @@ static inline int                       s1ap_mme_encode_e_rab_setup (
   s1ap_message * message_p,
   uint8_t ** buffer,
   uint32_t * length);
+static inline int                       s1ap_mme_encode_overload_start (
+  s1ap_message * message_p,
+  uint8_t ** buffer,
+  uint32_t * length);
+static inline int                       s1ap_mme_encode_overload_stop (
+  s1ap_message * message_p,
+  uint8_t ** buffer,
+  uint32_t * length);
 
 static inline int                       s1ap_mme_encode_initiating (
   s1ap_message * message_p,
@@ -154,6 +162,12 @@ s1ap_mme_encode_initiating (
   case S1ap_ProcedureCode_id_E_RABSetup:
     return s1ap_mme_encode_e_rab_setup (message_p, buffer, length);
 
+  case S1ap_ProcedureCode_id_OverloadStart:
+    return s1ap_mme_encode_overload_start (message_p, buffer, length);
+
+  case S1ap_ProcedureCode_id_OverloadStop:
+    return s1ap_mme_encode_overload_stop (message_p, buffer, length);
+
   default:
     OAILOG_DEBUG (LOG_S1AP, "Unknown procedure ID (%d) for initiating message_p\n", (int)message_p->procedureCode);
     break;
@@ -327,3 +341,41 @@ s1ap_mme_encode_e_rab_setup (
 
   return s1ap_generate_initiating_message (buffer, length, S1ap_ProcedureCode_id_E_RABSetup, message_p->criticality, &asn_DEF_S1ap_E_RABSetupRequest, e_rab_setup_p);
 }
+
+//------------------------------------------------------------------------------
+static inline int
+s1ap_mme_encode_overload_start (
+  s1ap_message * message_p,
+  uint8_t ** buffer,
+  uint32_t * length)
+{
+  S1ap_OverloadStart_t                    overloadStart;
+  S1ap_OverloadStart_t                   *overloadStart_p = &overloadStart;
+
+  memset (overloadStart_p, 0, sizeof (S1ap_OverloadStart_t));
+
+  if (s1ap_encode_s1ap_overloadstarties (overloadStart_p, &message_p->msg.s1ap_OverloadStartIEs) < 0) {
+    return -1;
+  }
+
+  return s1ap_generate_initiating_message (buffer, length, S1ap_ProcedureCode_id_OverloadStart, message_p->criticality, &asn_DEF_S1ap_OverloadStart, overloadStart_p);
+}
+
+//------------------------------------------------------------------------------
+static inline int
+s1ap_mme_encode_overload_stop (
+  s1ap_message * message_p,
+  uint8_t ** buffer,
+  uint32_t * length)
+{
+  S1ap_OverloadStop_t                     overloadStop;
+  S1ap_OverloadStop_t                    *overloadStop_p = &overloadStop;
+
+  memset (overloadStop_p, 0, sizeof (S1ap_OverloadStop_t));
+
+  if (s1ap_encode_s1ap_overloadstopies (overloadStop_p, &message_p->msg.s1ap_OverloadStopIEs) < 0) {
+    return -1;
+  }
+
+  return s1ap_generate_initiating_message (buffer, length, S1ap_ProcedureCode_id_OverloadStop, message_p->criticality, &asn_DEF_S1ap_OverloadStop, overloadStop_p);
+}
@@ -0,0 +1,441 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_fast_decoder.c
+  \brief Zero allocation APER decoder for the most frequent eNB originated S1AP PDUs
+  \company Eurecom
+
+  UplinkNASTransport, InitialUEMessage and UEContextReleaseComplete are the
+  bulk of the S1AP traffic received by the MME. Their IEs are simple enough to
+  be walked directly in the APER byte stream (X.691 aligned variant), the
+  OCTET STRING and BIT STRING fields of the decoded message point inside the
+  received buffer. Anything not strictly expected (extension bits, fragmented
+  lengths, optional IEs not used by the MME handlers) makes the decoder give
+  up, the asn1c decoder then handles the PDU.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bstrlib.h"
+
+#include "log.h"
+#include "assertions.h"
+#include "common_defs.h"
+#include "s1ap_common.h"
+#include "s1ap_ies_defs.h"
+#include "s1ap_mme_fast_decoder.h"
+
+typedef struct s1ap_aper_cursor_s {
+  const uint8_t  *buf;
+  uint32_t        len;
+  uint32_t        off;
+} s1ap_aper_cursor_t;
+
+#define S1AP_APER_REMAINING(cUrSoR) ((cUrSoR)->len - (cUrSoR)->off)
+
+//------------------------------------------------------------------------------
+// X.691 10.9 aligned length determinant, fragmented form (>= 16K) not supported
+static bool s1ap_aper_get_length (s1ap_aper_cursor_t * const c, uint32_t * const length)
+{
+  if (S1AP_APER_REMAINING(c) < 1) return false;
+  uint8_t b = c->buf[c->off++];
+  if (!(b & 0x80)) {
+    *length = b;
+  } else if ((b & 0xC0) == 0x80) {
+    if (S1AP_APER_REMAINING(c) < 1) return false;
+    *length = ((uint32_t)(b & 0x3F) << 8) | c->buf[c->off++];
+  } else {
+    return false;
+  }
+  return (S1AP_APER_REMAINING(c) >= *length);
+}
+
+//------------------------------------------------------------------------------
+// Open type (ANY) content: length determinant followed by the encoding
+static bool s1ap_aper_get_open_type (s1ap_aper_cursor_t * const c, s1ap_aper_cursor_t * const value)
+{
+  uint32_t length = 0;
+  if (!s1ap_aper_get_length(c, &length)) return false;
+  value->buf = &c->buf[c->off];
+  value->len = length;
+  value->off = 0;
+  c->off += length;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Constrained whole number with range > 64K (X.691 10.5.7.4): number of octets
+// on 2 bits, then the octet aligned value. Used by MME-UE-S1AP-ID and ENB-UE-S1AP-ID.
+static bool s1ap_aper_get_ue_id (const s1ap_aper_cursor_t * const value, const uint8_t max_octets, long * const id)
+{
+  if (value->len < 2) return false;
+  uint8_t octets = (value->buf[0] >> 6) + 1;
+  if ((octets > max_octets) || (value->len != (uint32_t)(1 + octets))) return false;
+  uint32_t v = 0;
+  for (int i = 1; i <= octets; i++) {
+    v = (v << 8) | value->buf[i];
+  }
+  *id = v;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static void s1ap_aper_set_octet_string (OCTET_STRING_t * const os, const uint8_t * const buf, const int size)
+{
+  os->buf  = (uint8_t *)buf;
+  os->size = size;
+}
+
+//------------------------------------------------------------------------------
+static void s1ap_aper_set_bit_string (BIT_STRING_t * const bs, const uint8_t * const buf, const int size, const int bits_unused)
+{
+  bs->buf  = (uint8_t *)buf;
+  bs->size = size;
+  bs->bits_unused = bits_unused;
+}
+
+//------------------------------------------------------------------------------
+// NAS-PDU ::= OCTET STRING
+static bool s1ap_aper_get_nas_pdu (const s1ap_aper_cursor_t * const value, OCTET_STRING_t * const nas_pdu)
+{
+  s1ap_aper_cursor_t c = *value;
+  uint32_t length = 0;
+  if (!s1ap_aper_get_length(&c, &length)) return false;
+  if ((c.off + length) != c.len) return false;
+  s1ap_aper_set_octet_string(nas_pdu, &c.buf[c.off], length);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// TAI ::= SEQUENCE { pLMNidentity, tAC, iE-Extensions OPTIONAL, ... }
+static bool s1ap_aper_get_tai (const s1ap_aper_cursor_t * const value, S1ap_TAI_t * const tai)
+{
+  // extension bit, iE-Extensions presence bit, padding
+  if ((value->len != 6) || (value->buf[0] & 0xC0)) return false;
+  s1ap_aper_set_octet_string(&tai->pLMNidentity, &value->buf[1], 3);
+  s1ap_aper_set_octet_string(&tai->tAC, &value->buf[4], 2);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// EUTRAN-CGI ::= SEQUENCE { pLMNidentity, cell-ID BIT STRING (SIZE (28)), iE-Extensions OPTIONAL, ... }
+static bool s1ap_aper_get_eutran_cgi (const s1ap_aper_cursor_t * const value, S1ap_EUTRAN_CGI_t * const cgi)
+{
+  if ((value->len != 8) || (value->buf[0] & 0xC0)) return false;
+  s1ap_aper_set_octet_string(&cgi->pLMNidentity, &value->buf[1], 3);
+  s1ap_aper_set_bit_string(&cgi->cell_ID, &value->buf[4], 4, 4);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// RRC-Establishment-Cause ::= ENUMERATED { 5 root values, ..., delayTolerantAccess }
+static bool s1ap_aper_get_rrc_establishment_cause (const s1ap_aper_cursor_t * const value, S1ap_RRC_Establishment_Cause_t * const cause)
+{
+  if ((value->len != 1) || (value->buf[0] & 0x80)) return false;
+  *cause = (value->buf[0] >> 4) & 0x07;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// S-TMSI ::= SEQUENCE { mMEC OCTET STRING (SIZE (1)), m-TMSI OCTET STRING (SIZE (4)), iE-Extensions OPTIONAL, ... }
+// mMEC is not octet aligned (X.691 16.6), the decoded octet is rebuilt in the
+// caller provided storage, everything else points in the PDU.
+static bool s1ap_aper_get_s_tmsi (const s1ap_aper_cursor_t * const value, S1ap_S_TMSI_t * const s_tmsi, uint8_t * const mmec)
+{
+  if ((value->len != 6) || (value->buf[0] & 0xC0)) return false;
+  *mmec = (uint8_t)((value->buf[0] << 2) | (value->buf[1] >> 6));
+  s1ap_aper_set_octet_string(&s_tmsi->mMEC, mmec, 1);
+  s1ap_aper_set_octet_string(&s_tmsi->m_TMSI, &value->buf[2], 4);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// GUMMEI ::= SEQUENCE { pLMN-Identity, mME-Group-ID, mME-Code, iE-Extensions OPTIONAL, ... }
+static bool s1ap_aper_get_gummei (const s1ap_aper_cursor_t * const value, S1ap_GUMMEI_t * const gummei)
+{
+  if ((value->len != 7) || (value->buf[0] & 0xC0)) return false;
+  s1ap_aper_set_octet_string(&gummei->pLMN_Identity, &value->buf[1], 3);
+  s1ap_aper_set_octet_string(&gummei->mME_Group_ID, &value->buf[4], 2);
+  s1ap_aper_set_octet_string(&gummei->mME_Code, &value->buf[6], 1);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// CSG-Id ::= BIT STRING (SIZE (27))
+static bool s1ap_aper_get_csg_id (const s1ap_aper_cursor_t * const value, S1ap_CSG_Id_t * const csg_id)
+{
+  if (value->len != 4) return false;
+  s1ap_aper_set_bit_string(csg_id, &value->buf[0], 4, 5);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_mme_fast_decode_uplink_nas_transport (s1ap_aper_cursor_t * const c, const uint16_t num_ies, S1ap_UplinkNASTransportIEs_t * const ies)
+{
+  uint32_t                                mandatory = 0;
+
+  for (int i = 0; i < num_ies; i++) {
+    s1ap_aper_cursor_t                      value = {0};
+    if (S1AP_APER_REMAINING(c) < 3) return false;
+    uint16_t id = (c->buf[c->off] << 8) | c->buf[c->off + 1];
+    c->off += 3;  // id + criticality
+    if (!s1ap_aper_get_open_type(c, &value)) return false;
+
+    switch (id) {
+    case S1ap_ProtocolIE_ID_id_MME_UE_S1AP_ID:
+      if (!s1ap_aper_get_ue_id(&value, 4, &ies->mme_ue_s1ap_id)) return false;
+      mandatory |= 1 << 0;
+      break;
+    case S1ap_ProtocolIE_ID_id_eNB_UE_S1AP_ID:
+      if (!s1ap_aper_get_ue_id(&value, 3, &ies->eNB_UE_S1AP_ID)) return false;
+      mandatory |= 1 << 1;
+      break;
+    case S1ap_ProtocolIE_ID_id_NAS_PDU:
+      if (!s1ap_aper_get_nas_pdu(&value, &ies->nas_pdu)) return false;
+      mandatory |= 1 << 2;
+      break;
+    case S1ap_ProtocolIE_ID_id_EUTRAN_CGI:
+      if (!s1ap_aper_get_eutran_cgi(&value, &ies->eutran_cgi)) return false;
+      mandatory |= 1 << 3;
+      break;
+    case S1ap_ProtocolIE_ID_id_TAI:
+      if (!s1ap_aper_get_tai(&value, &ies->tai)) return false;
+      mandatory |= 1 << 4;
+      break;
+    default:
+      // GW-TransportLayerAddress or unknown IE
+      return false;
+    }
+  }
+  return (0x1F == mandatory);
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_mme_fast_decode_initial_ue_message (s1ap_aper_cursor_t * const c, const uint16_t num_ies, S1ap_InitialUEMessageIEs_t * const ies, uint8_t * const mmec)
+{
+  uint32_t                                mandatory = 0;
+
+  for (int i = 0; i < num_ies; i++) {
+    s1ap_aper_cursor_t                      value = {0};
+    if (S1AP_APER_REMAINING(c) < 3) return false;
+    uint16_t id = (c->buf[c->off] << 8) | c->buf[c->off + 1];
+    c->off += 3;
+    if (!s1ap_aper_get_open_type(c, &value)) return false;
+
+    switch (id) {
+    case S1ap_ProtocolIE_ID_id_eNB_UE_S1AP_ID:
+      if (!s1ap_aper_get_ue_id(&value, 3, &ies->eNB_UE_S1AP_ID)) return false;
+      mandatory |= 1 << 0;
+      break;
+    case S1ap_ProtocolIE_ID_id_NAS_PDU:
+      if (!s1ap_aper_get_nas_pdu(&value, &ies->nas_pdu)) return false;
+      mandatory |= 1 << 1;
+      break;
+    case S1ap_ProtocolIE_ID_id_TAI:
+      if (!s1ap_aper_get_tai(&value, &ies->tai)) return false;
+      mandatory |= 1 << 2;
+      break;
+    case S1ap_ProtocolIE_ID_id_EUTRAN_CGI:
+      if (!s1ap_aper_get_eutran_cgi(&value, &ies->eutran_cgi)) return false;
+      mandatory |= 1 << 3;
+      break;
+    case S1ap_ProtocolIE_ID_id_RRC_Establishment_Cause:
+      if (!s1ap_aper_get_rrc_establishment_cause(&value, &ies->rrC_Establishment_Cause)) return false;
+      mandatory |= 1 << 4;
+      break;
+    case S1ap_ProtocolIE_ID_id_S_TMSI:
+      if (!s1ap_aper_get_s_tmsi(&value, &ies->s_tmsi, mmec)) return false;
+      ies->presenceMask |= S1AP_INITIALUEMESSAGEIES_S_TMSI_PRESENT;
+      break;
+    case S1ap_ProtocolIE_ID_id_CSG_Id:
+      if (!s1ap_aper_get_csg_id(&value, &ies->csG_Id)) return false;
+      ies->presenceMask |= S1AP_INITIALUEMESSAGEIES_CSG_ID_PRESENT;
+      break;
+    case S1ap_ProtocolIE_ID_id_GUMMEI_ID:
+      if (!s1ap_aper_get_gummei(&value, &ies->gummei_id)) return false;
+      ies->presenceMask |= S1AP_INITIALUEMESSAGEIES_GUMMEI_ID_PRESENT;
+      break;
+    default:
+      // CellAccessMode, GW-TransportLayerAddress, RelayNode-Indicator or unknown IE
+      return false;
+    }
+  }
+  return (0x1F == mandatory);
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_mme_fast_decode_ue_context_release_complete (s1ap_aper_cursor_t * const c, const uint16_t num_ies, S1ap_UEContextReleaseCompleteIEs_t * const ies)
+{
+  uint32_t                                mandatory = 0;
+
+  for (int i = 0; i < num_ies; i++) {
+    s1ap_aper_cursor_t                      value = {0};
+    if (S1AP_APER_REMAINING(c) < 3) return false;
+    uint16_t id = (c->buf[c->off] << 8) | c->buf[c->off + 1];
+    c->off += 3;
+    if (!s1ap_aper_get_open_type(c, &value)) return false;
+
+    switch (id) {
+    case S1ap_ProtocolIE_ID_id_MME_UE_S1AP_ID:
+      if (!s1ap_aper_get_ue_id(&value, 4, &ies->mme_ue_s1ap_id)) return false;
+      mandatory |= 1 << 0;
+      break;
+    case S1ap_ProtocolIE_ID_id_eNB_UE_S1AP_ID:
+      if (!s1ap_aper_get_ue_id(&value, 3, &ies->eNB_UE_S1AP_ID)) return false;
+      mandatory |= 1 << 1;
+      break;
+    default:
+      // CriticalityDiagnostics or unknown IE
+      return false;
+    }
+  }
+  return (0x03 == mandatory);
+}
+
+//------------------------------------------------------------------------------
+bool s1ap_mme_fast_decode_pdu (s1ap_message *message, const_bstring const raw)
+{
+  // S-TMSI mMEC is the only field that can not point inside the PDU, the
+  // S1AP task is single threaded and the message never outlives the handler.
+  static uint8_t                          s_tmsi_mmec = 0;
+  s1ap_aper_cursor_t                      pdu = {0};
+  s1ap_aper_cursor_t                      value = {0};
+  bool                                    decoded = false;
+
+  DevAssert (raw != NULL);
+  pdu.buf = (const uint8_t *)bdata(raw);
+  pdu.len = blength(raw);
+
+  if (pdu.len < 4) return false;
+  // CHOICE: extension bit, index on 2 bits, padding
+  if (pdu.buf[0] & 0x80) return false;
+  uint8_t present = ((pdu.buf[0] >> 5) & 0x03) + 1;
+  uint8_t procedure_code = pdu.buf[1];
+  uint8_t criticality = pdu.buf[2] >> 6;
+  pdu.off = 3;
+  if (!s1ap_aper_get_open_type(&pdu, &value)) return false;
+  // Message SEQUENCE: extension bit, padding, then number of IEs on 16 bits
+  if ((value.len < 3) || (value.buf[0] & 0x80)) return false;
+  uint16_t num_ies = (value.buf[1] << 8) | value.buf[2];
+  value.off = 3;
+
+  memset (message, 0, sizeof (*message));
+
+  if ((S1AP_PDU_PR_initiatingMessage == present) && (S1ap_ProcedureCode_id_uplinkNASTransport == procedure_code)) {
+    decoded = s1ap_mme_fast_decode_uplink_nas_transport (&value, num_ies, &message->msg.s1ap_UplinkNASTransportIEs);
+  } else if ((S1AP_PDU_PR_initiatingMessage == present) && (S1ap_ProcedureCode_id_initialUEMessage == procedure_code)) {
+    decoded = s1ap_mme_fast_decode_initial_ue_message (&value, num_ies, &message->msg.s1ap_InitialUEMessageIEs, &s_tmsi_mmec);
+  } else if ((S1AP_PDU_PR_successfulOutcome == present) && (S1ap_ProcedureCode_id_UEContextRelease == procedure_code)) {
+    decoded = s1ap_mme_fast_decode_ue_context_release_complete (&value, num_ies, &message->msg.s1ap_UEContextReleaseCompleteIEs);
+  }
+
+  if ((!decoded) || (value.off != value.len)) {
+    memset (message, 0, sizeof (*message));
+    return false;
+  }
+  message->procedureCode = procedure_code;
+  message->criticality = criticality;
+  message->direction = present;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_fast_decoder_octet_string_equal (const OCTET_STRING_t * const a, const OCTET_STRING_t * const b)
+{
+  return ((a->size == b->size) && ((0 == a->size) || (0 == memcmp (a->buf, b->buf, a->size))));
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_fast_decoder_bit_string_equal (const BIT_STRING_t * const a, const BIT_STRING_t * const b)
+{
+  if ((a->size != b->size) || (a->bits_unused != b->bits_unused)) return false;
+  if (0 == a->size) return true;
+  if (memcmp (a->buf, b->buf, a->size - 1)) return false;
+  uint8_t mask = (uint8_t)(0xFF << a->bits_unused);
+  return ((a->buf[a->size - 1] & mask) == (b->buf[b->size - 1] & mask));
+}
+
+//------------------------------------------------------------------------------
+bool s1ap_mme_fast_decoder_compare (const s1ap_message * const fast, const s1ap_message * const ref)
+{
+  if ((fast->procedureCode != ref->procedureCode) || (fast->criticality != ref->criticality) || (fast->direction != ref->direction)) {
+    return false;
+  }
+  switch (fast->procedureCode) {
+  case S1ap_ProcedureCode_id_uplinkNASTransport: {
+      const S1ap_UplinkNASTransportIEs_t *f = &fast->msg.s1ap_UplinkNASTransportIEs;
+      const S1ap_UplinkNASTransportIEs_t *r = &ref->msg.s1ap_UplinkNASTransportIEs;
+      return ((f->presenceMask == r->presenceMask) &&
+          (f->mme_ue_s1ap_id == r->mme_ue_s1ap_id) &&
+          (f->eNB_UE_S1AP_ID == r->eNB_UE_S1AP_ID) &&
+          s1ap_fast_decoder_octet_string_equal (&f->nas_pdu, &r->nas_pdu) &&
+          s1ap_fast_decoder_octet_string_equal (&f->tai.pLMNidentity, &r->tai.pLMNidentity) &&
+          s1ap_fast_decoder_octet_string_equal (&f->tai.tAC, &r->tai.tAC) &&
+          s1ap_fast_decoder_octet_string_equal (&f->eutran_cgi.pLMNidentity, &r->eutran_cgi.pLMNidentity) &&
+          s1ap_fast_decoder_bit_string_equal (&f->eutran_cgi.cell_ID, &r->eutran_cgi.cell_ID));
+    }
+
+  case S1ap_ProcedureCode_id_initialUEMessage: {
+      const S1ap_InitialUEMessageIEs_t *f = &fast->msg.s1ap_InitialUEMessageIEs;
+      const S1ap_InitialUEMessageIEs_t *r = &ref->msg.s1ap_InitialUEMessageIEs;
+      if ((f->presenceMask != r->presenceMask) ||
+          (f->eNB_UE_S1AP_ID != r->eNB_UE_S1AP_ID) ||
+          (f->rrC_Establishment_Cause != r->rrC_Establishment_Cause) ||
+          !s1ap_fast_decoder_octet_string_equal (&f->nas_pdu, &r->nas_pdu) ||
+          !s1ap_fast_decoder_octet_string_equal (&f->tai.pLMNidentity, &r->tai.pLMNidentity) ||
+          !s1ap_fast_decoder_octet_string_equal (&f->tai.tAC, &r->tai.tAC) ||
+          !s1ap_fast_decoder_octet_string_equal (&f->eutran_cgi.pLMNidentity, &r->eutran_cgi.pLMNidentity) ||
+          !s1ap_fast_decoder_bit_string_equal (&f->eutran_cgi.cell_ID, &r->eutran_cgi.cell_ID)) {
+        return false;
+      }
+      if ((f->presenceMask & S1AP_INITIALUEMESSAGEIES_S_TMSI_PRESENT) &&
+          (!s1ap_fast_decoder_octet_string_equal (&f->s_tmsi.mMEC, &r->s_tmsi.mMEC) ||
+           !s1ap_fast_decoder_octet_string_equal (&f->s_tmsi.m_TMSI, &r->s_tmsi.m_TMSI))) {
+        return false;
+      }
+      if ((f->presenceMask & S1AP_INITIALUEMESSAGEIES_CSG_ID_PRESENT) &&
+          !s1ap_fast_decoder_bit_string_equal (&f->csG_Id, &r->csG_Id)) {
+        return false;
+      }
+      if ((f->presenceMask & S1AP_INITIALUEMESSAGEIES_GUMMEI_ID_PRESENT) &&
+          (!s1ap_fast_decoder_octet_string_equal (&f->gummei_id.pLMN_Identity, &r->gummei_id.pLMN_Identity) ||
+           !s1ap_fast_decoder_octet_string_equal (&f->gummei_id.mME_Group_ID, &r->gummei_id.mME_Group_ID) ||
+           !s1ap_fast_decoder_octet_string_equal (&f->gummei_id.mME_Code, &r->gummei_id.mME_Code))) {
+        return false;
+      }
+      return true;
+    }
+
+  case S1ap_ProcedureCode_id_UEContextRelease: {
+      const S1ap_UEContextReleaseCompleteIEs_t *f = &fast->msg.s1ap_UEContextReleaseCompleteIEs;
+      const S1ap_UEContextReleaseCompleteIEs_t *r = &ref->msg.s1ap_UEContextReleaseCompleteIEs;
+      return ((f->presenceMask == r->presenceMask) &&
+          (f->mme_ue_s1ap_id == r->mme_ue_s1ap_id) &&
+          (f->eNB_UE_S1AP_ID == r->eNB_UE_S1AP_ID));
+    }
+
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,52 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_fast_decoder.h
+  \brief Zero allocation APER decoder for the most frequent eNB originated S1AP PDUs
+  \company Eurecom
+*/
+
+#ifndef FILE_S1AP_MME_FAST_DECODER_SEEN
+#define FILE_S1AP_MME_FAST_DECODER_SEEN
+#include <stdbool.h>
+#include "bstrlib.h"
+#include "s1ap_common.h"
+#include "s1ap_ies_defs.h"
+
+/** \brief Try to decode an UplinkNASTransport, InitialUEMessage or
+ * UEContextReleaseComplete PDU without the asn1c runtime.
+ * On success the OCTET/BIT strings of message point inside raw, so message
+ * must not outlive raw and must NOT be released with s1ap_free_mme_decode_pdu().
+ * \param message Message to fill, zeroed by this function
+ * \param raw     Received APER encoded S1AP PDU
+ * @returns true if the PDU has been fully decoded, false if the caller has to
+ * fall back to the asn1c decoder (unknown procedure, extension, optional IE
+ * not handled, fragmented length, malformed PDU).
+ **/
+bool s1ap_mme_fast_decode_pdu(s1ap_message *message, const_bstring const raw);
+
+/** \brief Compare a message decoded by the fast path with the one decoded by asn1c.
+ * @returns true if all IEs consumed by the S1AP handlers are identical.
+ **/
+bool s1ap_mme_fast_decoder_compare(const s1ap_message * const fast, const s1ap_message * const ref);
+
+#endif /* FILE_S1AP_MME_FAST_DECODER_SEEN */
@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <pthread.h>
 
 #include "bstrlib.h"
@@ -47,7 +48,9 @@
 #include "s1ap_common.h"
 #include "s1ap_ies_defs.h"
 #include "s1ap_mme_encoder.h"
+#include "s1ap_mme_template_encoder.h"
 #include "s1ap_mme_nas_procedures.h"
+#include "s1ap_mme_overload.h"
 #include "s1ap_mme_itti_messaging.h"
 #include "s1ap_mme.h"
 #include "s1ap_mme_ta.h"
@@ -242,6 +245,105 @@ s1ap_mme_generate_s1_setup_failure (
   OAILOG_FUNC_RETURN (LOG_S1AP, rc);
 }
 
+//------------------------------------------------------------------------------
+int
+s1ap_mme_generate_overload_start (
+    const sctp_assoc_id_t assoc_id,
+    const S1ap_OverloadAction_t overload_action)
+{
+  uint8_t                                *buffer_p = NULL;
+  uint32_t                                length = 0;
+  s1ap_message                            message = { 0 };
+  S1ap_OverloadStartIEs_t                *overload_start_p = NULL;
+  int                                     rc = RETURNok;
+
+  OAILOG_FUNC_IN (LOG_S1AP);
+  overload_start_p = &message.msg.s1ap_OverloadStartIEs;
+  message.procedureCode = S1ap_ProcedureCode_id_OverloadStart;
+  message.direction = S1AP_PDU_PR_initiatingMessage;
+  message.criticality = S1ap_Criticality_ignore;
+  overload_start_p->overloadResponse.present = S1ap_OverloadResponse_PR_overloadAction;
+  overload_start_p->overloadResponse.choice.overloadAction = overload_action;
+
+  if (s1ap_mme_encode_pdu (&message, &buffer_p, &length) < 0) {
+    OAILOG_ERROR (LOG_S1AP, "Failed to encode overload start\n");
+    OAILOG_FUNC_RETURN (LOG_S1AP, RETURNerror);
+  }
+
+  MSC_LOG_TX_MESSAGE (MSC_S1AP_MME, MSC_S1AP_ENB, NULL, 0, "0 OverloadStart/initiatingMessage assoc_id %u action %ld", assoc_id, overload_action);
+  bstring b = blk2bstr(buffer_p, length);
+  free(buffer_p);
+  rc =  s1ap_mme_itti_send_sctp_request (&b, assoc_id, 0, INVALID_MME_UE_S1AP_ID);
+  OAILOG_FUNC_RETURN (LOG_S1AP, rc);
+}
+
+//------------------------------------------------------------------------------
+int
+s1ap_mme_generate_overload_stop (
+    const sctp_assoc_id_t assoc_id)
+{
+  uint8_t                                *buffer_p = NULL;
+  uint32_t                                length = 0;
+  s1ap_message                            message = { 0 };
+  int                                     rc = RETURNok;
+
+  OAILOG_FUNC_IN (LOG_S1AP);
+  message.procedureCode = S1ap_ProcedureCode_id_OverloadStop;
+  message.direction = S1AP_PDU_PR_initiatingMessage;
+  message.criticality = S1ap_Criticality_reject;
+
+  if (s1ap_mme_encode_pdu (&message, &buffer_p, &length) < 0) {
+    OAILOG_ERROR (LOG_S1AP, "Failed to encode overload stop\n");
+    OAILOG_FUNC_RETURN (LOG_S1AP, RETURNerror);
+  }
+
+  MSC_LOG_TX_MESSAGE (MSC_S1AP_MME, MSC_S1AP_ENB, NULL, 0, "0 OverloadStop/initiatingMessage assoc_id %u", assoc_id);
+  bstring b = blk2bstr(buffer_p, length);
+  free(buffer_p);
+  rc =  s1ap_mme_itti_send_sctp_request (&b, assoc_id, 0, INVALID_MME_UE_S1AP_ID);
+  OAILOG_FUNC_RETURN (LOG_S1AP, rc);
+}
+
+//------------------------------------------------------------------------------
+static bool s1ap_send_overload_event_cb (__attribute__((unused))const hash_key_t keyP,
+               void * const eNB_void,
+               void *parameterP,
+               void __attribute__((unused)) **unused_resultP)
+{
+  const enb_description_t * const enb_ref = (const enb_description_t *)eNB_void;
+  const s1ap_overload_event_t     event = *((s1ap_overload_event_t *)parameterP);
+
+  if ((enb_ref == NULL) || (enb_ref->s1_state != S1AP_READY)) {
+    return false;
+  }
+  if (S1AP_OVERLOAD_EVENT_START == event) {
+    s1ap_mme_generate_overload_start (enb_ref->sctp_assoc_id, S1ap_OverloadAction_reject_rrc_cr_signalling);
+  } else {
+    s1ap_mme_generate_overload_stop (enb_ref->sctp_assoc_id);
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void
+s1ap_mme_handle_overload_event (
+    s1ap_overload_event_t event)
+{
+  s1ap_overload_stats_t                   stats = {0};
+
+  s1ap_mme_overload_get_stats (&stats);
+  if (S1AP_OVERLOAD_EVENT_START == event) {
+    OAILOG_WARNING (LOG_S1AP, "S1AP overload start: queue latency %u ms, %u PDUs pending, shed InitialUEMessage %"PRIu64" UE associated %"PRIu64"\n",
+        stats.latency_ms, stats.pending, stats.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE], stats.shed[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED]);
+  } else if (S1AP_OVERLOAD_EVENT_STOP == event) {
+    OAILOG_NOTICE (LOG_S1AP, "S1AP overload stop: queue latency %u ms, %u PDUs pending, shed InitialUEMessage %"PRIu64" UE associated %"PRIu64"\n",
+        stats.latency_ms, stats.pending, stats.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE], stats.shed[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED]);
+  } else {
+    return;
+  }
+  hashtable_ts_apply_callback_on_elements(&g_s1ap_enb_coll, s1ap_send_overload_event_cb, (void *)&event, NULL);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //************************** Management procedures ***************************//
 ////////////////////////////////////////////////////////////////////////////////
@@ -408,6 +510,9 @@ s1ap_mme_handle_s1_setup_request (
   rc = s1ap_generate_s1_setup_response(enb_association);
   if (rc == RETURNok) {
     update_mme_app_stats_connected_enb_add();
+    if (s1ap_mme_overload_is_active ()) {
+      s1ap_mme_generate_overload_start (assoc_id, S1ap_OverloadAction_reject_rrc_cr_signalling);
+    }
   }
   OAILOG_FUNC_RETURN (LOG_S1AP, rc);
 }
@@ -429,6 +534,18 @@ s1ap_generate_s1_setup_response (
 
   OAILOG_FUNC_IN (LOG_S1AP);
   DevAssert (enb_association != NULL);
+#if S1AP_TEMPLATE_ENCODER
+  /*
+   * The response only depends on the MME configuration, reuse the previous encoding
+   */
+  bstring cached = s1ap_mme_template_get_s1_setup_response ();
+  if (cached) {
+    enb_association->s1_state = S1AP_READY;
+    MSC_LOG_TX_MESSAGE (MSC_S1AP_MME, MSC_S1AP_ENB, NULL, 0, "0 S1Setup/successfulOutcome assoc_id %u", enb_association->sctp_assoc_id);
+    rc = s1ap_mme_itti_send_sctp_request (&cached, enb_association->sctp_assoc_id, 0, INVALID_MME_UE_S1AP_ID);
+    OAILOG_FUNC_RETURN (LOG_S1AP, rc);
+  }
+#endif
   // memset for gcc 4.8.4 instead of {0}, servedGUMMEI.servedPLMNs
   servedGUMMEI = calloc(1, sizeof *servedGUMMEI);
   // Generating response
@@ -495,6 +612,9 @@ s1ap_generate_s1_setup_response (
      * Consider the response as sent. S1AP is ready to accept UE contexts
      */
     enb_association->s1_state = S1AP_READY;
+#if S1AP_TEMPLATE_ENCODER
+    s1ap_mme_template_store_s1_setup_response (buffer, length);
+#endif
   }
 
   MSC_LOG_TX_MESSAGE (MSC_S1AP_MME, MSC_S1AP_ENB, NULL, 0, "0 S1Setup/successfulOutcome assoc_id %u", enb_association->sctp_assoc_id);
@@ -791,19 +911,25 @@ s1ap_mme_generate_ue_context_release_command (
     AssertFatal(false, "Unknown cause for context release");
     break;
   }
-  s1ap_mme_set_cause(&ueContextReleaseCommandIEs_p->cause, cause_type, cause_value);
-
-  if (s1ap_mme_encode_pdu (&message, &buffer, &length) < 0) {
-    MSC_LOG_EVENT (MSC_S1AP_MME, "0 UEContextRelease/initiatingMessage enb_ue_s1ap_id " ENB_UE_S1AP_ID_FMT " mme_ue_s1ap_id " MME_UE_S1AP_ID_FMT " encoding failed",
-            ue_ref_p->enb_ue_s1ap_id, ue_ref_p->mme_ue_s1ap_id);
-    OAILOG_FUNC_RETURN (LOG_S1AP, RETURNerror);
+  bstring b = NULL;
+#if S1AP_TEMPLATE_ENCODER
+  b = s1ap_mme_template_encode_ue_context_release_command (ue_ref_p->mme_ue_s1ap_id, ue_ref_p->enb_ue_s1ap_id, S1ap_Criticality_reject, cause_type, cause_value);
+#endif
+  if (!b) {
+    s1ap_mme_set_cause(&ueContextReleaseCommandIEs_p->cause, cause_type, cause_value);
+
+    if (s1ap_mme_encode_pdu (&message, &buffer, &length) < 0) {
+      MSC_LOG_EVENT (MSC_S1AP_MME, "0 UEContextRelease/initiatingMessage enb_ue_s1ap_id " ENB_UE_S1AP_ID_FMT " mme_ue_s1ap_id " MME_UE_S1AP_ID_FMT " encoding failed",
+              ue_ref_p->enb_ue_s1ap_id, ue_ref_p->mme_ue_s1ap_id);
+      OAILOG_FUNC_RETURN (LOG_S1AP, RETURNerror);
+    }
+    b = blk2bstr(buffer, length);
+    free(buffer);
   }
 
   MSC_LOG_TX_MESSAGE (MSC_S1AP_MME, MSC_S1AP_ENB, NULL, 0, "0 UEContextRelease/initiatingMessage enb_ue_s1ap_id " ENB_UE_S1AP_ID_FMT " mme_ue_s1ap_id " MME_UE_S1AP_ID_FMT "",
           ue_ref_p->enb_ue_s1ap_id, ue_ref_p->mme_ue_s1ap_id);
 
-  bstring b = blk2bstr(buffer, length);
-  free(buffer);
   rc = s1ap_mme_itti_send_sctp_request (&b, ue_ref_p->enb->sctp_assoc_id, ue_ref_p->sctp_stream_send, ue_ref_p->mme_ue_s1ap_id);
   ue_ref_p->s1_ue_state = S1AP_UE_WAITING_CRR;
   
@@ -29,6 +29,7 @@
 
 #ifndef FILE_S1AP_MME_HANDLERS_SEEN
 #define FILE_S1AP_MME_HANDLERS_SEEN
+#include "s1ap_mme_overload.h"
 
 #define MAX_NUM_PARTIAL_S1_CONN_RESET 256
 
@@ -86,6 +87,14 @@ int s1ap_mme_generate_s1_setup_failure(
     const sctp_assoc_id_t assoc_id, const S1ap_Cause_PR cause_type, const long cause_value,
     const long time_to_wait);
 
+int s1ap_mme_generate_overload_start(const sctp_assoc_id_t assoc_id, const S1ap_OverloadAction_t overload_action);
+
+int s1ap_mme_generate_overload_stop(const sctp_assoc_id_t assoc_id);
+
+/** \brief Signal an overload state transition to all eNBs in S1AP_READY state.
+ **/
+void s1ap_mme_handle_overload_event(s1ap_overload_event_t event);
+
 int s1ap_mme_handle_erab_setup_response (const sctp_assoc_id_t assoc_id,
     const sctp_stream_id_t stream, struct s1ap_message_s *message);
 
@@ -43,6 +43,7 @@
 #include "s1ap_common.h"
 #include "s1ap_ies_defs.h"
 #include "s1ap_mme_encoder.h"
+#include "s1ap_mme_template_encoder.h"
 #include "s1ap_mme.h"
 #include "s1ap_mme_handlers.h"
 #include "s1ap_mme_nas_procedures.h"
@@ -385,6 +386,23 @@ s1ap_generate_downlink_nas_transport (
     S1ap_DownlinkNASTransportIEs_t         *downlinkNasTransport = NULL;
     s1ap_message                            message = {0};
 
+#if S1AP_TEMPLATE_ENCODER
+    bstring b = s1ap_mme_template_encode_downlink_nas_transport (ue_ref->mme_ue_s1ap_id, ue_ref->enb_ue_s1ap_id, S1ap_Criticality_reject, *payload);
+
+    if (b) {
+      ue_ref->s1_ue_state = S1AP_UE_CONNECTED;
+      bdestroy_wrapper (payload);
+      OAILOG_NOTICE (LOG_S1AP, "Send S1AP DOWNLINK_NAS_TRANSPORT message ue_id = " MME_UE_S1AP_ID_FMT " MME_UE_S1AP_ID = " MME_UE_S1AP_ID_FMT " eNB_UE_S1AP_ID = " ENB_UE_S1AP_ID_FMT "\n",
+                  ue_id, ue_ref->mme_ue_s1ap_id, ue_ref->enb_ue_s1ap_id);
+      MSC_LOG_TX_MESSAGE (MSC_S1AP_MME,
+                          MSC_S1AP_ENB,
+                          NULL, 0,
+                          "0 downlinkNASTransport/initiatingMessage ue_id " MME_UE_S1AP_ID_FMT " mme_ue_s1ap_id " MME_UE_S1AP_ID_FMT " enb_ue_s1ap_id" ENB_UE_S1AP_ID_FMT " nas length %u",
+                          ue_id, ue_ref->mme_ue_s1ap_id, ue_ref->enb_ue_s1ap_id, blength(b));
+      s1ap_mme_itti_send_sctp_request (&b , ue_ref->enb->sctp_assoc_id, ue_ref->sctp_stream_send, ue_ref->mme_ue_s1ap_id);
+      OAILOG_FUNC_RETURN (LOG_S1AP, RETURNok);
+    }
+#endif
     message.procedureCode = S1ap_ProcedureCode_id_downlinkNASTransport;
     message.direction = S1AP_PDU_PR_initiatingMessage;
     ue_ref->s1_ue_state = S1AP_UE_CONNECTED;
@@ -0,0 +1,204 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_overload.c
+  \brief S1AP overload control
+  \company Eurecom
+
+  Admission is done in the SCTP task, before any ITTI memory is allocated for
+  the PDU: the number of PDUs waiting for the S1AP task is bounded, with a lower
+  bound for InitialUEMessage so that signalling of UEs already connected keeps
+  flowing while new signalling connections are shed. Only InitialUEMessage and
+  UplinkNASTransport start new work and may be shed, responses and the other
+  procedures are always admitted.
+  The S1AP task measures the time spent by each PDU in the queue, a smoothed
+  value above/below the configured thresholds starts/stops the overload state
+  that is signalled to eNBs with OverloadStart/OverloadStop (TS 36.413 8.7.6).
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "bstrlib.h"
+
+#include "s1ap_common.h"
+#include "s1ap_mme_overload.h"
+
+// Weight of a new sample in the smoothed latency is 1/2^S1AP_OVERLOAD_LATENCY_SHIFT
+#define S1AP_OVERLOAD_LATENCY_SHIFT 3
+
+typedef struct s1ap_overload_s {
+  uint32_t          max_pending;
+  uint32_t          initial_ue_max_pending;
+  uint64_t          start_latency_us;
+  uint64_t          stop_latency_us;
+
+  // shared between SCTP and S1AP tasks
+  volatile uint32_t pending;
+  volatile uint64_t admitted[S1AP_OVERLOAD_CLASS_MAX];
+  volatile uint64_t shed[S1AP_OVERLOAD_CLASS_MAX];
+
+  // S1AP task only
+  uint64_t          latency_us;
+  bool              active;
+} s1ap_overload_t;
+
+static s1ap_overload_t s1ap_overload = {0};
+
+//------------------------------------------------------------------------------
+void s1ap_mme_overload_init (const uint32_t max_pending, const uint32_t initial_ue_max_pending,
+                             const uint32_t start_latency_ms, const uint32_t stop_latency_ms)
+{
+  memset (&s1ap_overload, 0, sizeof (s1ap_overload));
+  s1ap_overload.max_pending            = max_pending;
+  s1ap_overload.initial_ue_max_pending = (initial_ue_max_pending < max_pending) ? initial_ue_max_pending : max_pending;
+  s1ap_overload.start_latency_us       = (uint64_t)start_latency_ms * 1000;
+  s1ap_overload.stop_latency_us        = (uint64_t)((stop_latency_ms < start_latency_ms) ? stop_latency_ms : start_latency_ms) * 1000;
+}
+
+//------------------------------------------------------------------------------
+uint64_t s1ap_mme_overload_time_us (void)
+{
+  struct timespec                         ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+s1ap_overload_class_t s1ap_mme_overload_classify (const_bstring const pdu)
+{
+  if ((!pdu) || (blength (pdu) < 2)) {
+    // let the decoder report it
+    return S1AP_OVERLOAD_CLASS_ESSENTIAL;
+  }
+  /*
+   * APER: extension bit and S1AP-PDU CHOICE index on the first octet, procedure code on the second.
+   */
+  const uint8_t                           choice = (bdata (pdu)[0] >> 5) & 0x03;
+  const uint8_t                           procedure_code = bdata (pdu)[1];
+
+  if (0 != choice) {
+    // successful and unsuccessful outcomes complete work the MME already started
+    return S1AP_OVERLOAD_CLASS_ESSENTIAL;
+  }
+
+  switch (procedure_code) {
+  case S1ap_ProcedureCode_id_initialUEMessage:
+    return S1AP_OVERLOAD_CLASS_INITIAL_UE;
+
+  case S1ap_ProcedureCode_id_uplinkNASTransport:
+    return S1AP_OVERLOAD_CLASS_UE_ASSOCIATED;
+
+  default:
+    // shedding the other initiating messages would leak resources or eNBs
+    return S1AP_OVERLOAD_CLASS_ESSENTIAL;
+  }
+}
+
+//------------------------------------------------------------------------------
+bool s1ap_mme_overload_admit (const_bstring const pdu, uint64_t * const enqueue_time_us)
+{
+  const s1ap_overload_class_t             overload_class = s1ap_mme_overload_classify (pdu);
+
+  if (s1ap_overload.max_pending) {
+    const uint32_t                          pending = s1ap_overload.pending;
+
+    if (((S1AP_OVERLOAD_CLASS_INITIAL_UE == overload_class) && (pending >= s1ap_overload.initial_ue_max_pending)) ||
+        ((S1AP_OVERLOAD_CLASS_UE_ASSOCIATED == overload_class) && (pending >= s1ap_overload.max_pending))) {
+      __sync_fetch_and_add (&s1ap_overload.shed[overload_class], 1);
+      return false;
+    }
+  }
+  __sync_fetch_and_add (&s1ap_overload.pending, 1);
+  __sync_fetch_and_add (&s1ap_overload.admitted[overload_class], 1);
+  *enqueue_time_us = s1ap_mme_overload_time_us ();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void s1ap_mme_overload_cancel (void)
+{
+  __sync_fetch_and_sub (&s1ap_overload.pending, 1);
+}
+
+//------------------------------------------------------------------------------
+bool s1ap_mme_overload_dequeued (const_bstring const pdu, const uint64_t enqueue_time_us, const uint64_t now_us,
+                                 s1ap_overload_event_t * const event)
+{
+  const uint32_t                          remaining = __sync_sub_and_fetch (&s1ap_overload.pending, 1);
+  const uint64_t                          sample_us = (now_us > enqueue_time_us) ? now_us - enqueue_time_us : 0;
+
+  *event = S1AP_OVERLOAD_EVENT_NONE;
+  if (0 == s1ap_overload.start_latency_us) {
+    return true;
+  }
+
+  if (0 == remaining) {
+    // queue drained, no backlog to smooth
+    s1ap_overload.latency_us = sample_us;
+  } else if (sample_us > s1ap_overload.latency_us) {
+    s1ap_overload.latency_us += (sample_us - s1ap_overload.latency_us) >> S1AP_OVERLOAD_LATENCY_SHIFT;
+  } else {
+    s1ap_overload.latency_us -= (s1ap_overload.latency_us - sample_us) >> S1AP_OVERLOAD_LATENCY_SHIFT;
+  }
+
+  if ((!s1ap_overload.active) && (s1ap_overload.latency_us >= s1ap_overload.start_latency_us)) {
+    s1ap_overload.active = true;
+    *event = S1AP_OVERLOAD_EVENT_START;
+  } else if ((s1ap_overload.active) && (s1ap_overload.latency_us <= s1ap_overload.stop_latency_us)) {
+    s1ap_overload.active = false;
+    *event = S1AP_OVERLOAD_EVENT_STOP;
+  }
+
+  /*
+   * While overloaded, an InitialUEMessage that already waited longer than the
+   * start threshold is likely to be retried by the UE: spend the time on
+   * signalling of connected UEs instead.
+   */
+  if ((s1ap_overload.active) && (sample_us >= s1ap_overload.start_latency_us) &&
+      (S1AP_OVERLOAD_CLASS_INITIAL_UE == s1ap_mme_overload_classify (pdu))) {
+    __sync_fetch_and_add (&s1ap_overload.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE], 1);
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool s1ap_mme_overload_is_active (void)
+{
+  return s1ap_overload.active;
+}
+
+//------------------------------------------------------------------------------
+void s1ap_mme_overload_get_stats (s1ap_overload_stats_t * const stats)
+{
+  stats->pending    = s1ap_overload.pending;
+  stats->latency_ms = (uint32_t)(s1ap_overload.latency_us / 1000);
+  stats->active     = s1ap_overload.active;
+  for (int i = 0; i < S1AP_OVERLOAD_CLASS_MAX; i++) {
+    stats->admitted[i] = s1ap_overload.admitted[i];
+    stats->shed[i]     = s1ap_overload.shed[i];
+  }
+}
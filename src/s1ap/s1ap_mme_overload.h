@@ -0,0 +1,96 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_overload.h
+  \brief S1AP overload control: bounded SCTP to S1AP queue, prioritisation and
+  OverloadStart/OverloadStop triggering on queue latency
+  \company Eurecom
+*/
+
+#ifndef FILE_S1AP_MME_OVERLOAD_SEEN
+#define FILE_S1AP_MME_OVERLOAD_SEEN
+#include <stdbool.h>
+#include <stdint.h>
+#include "bstrlib.h"
+
+typedef enum s1ap_overload_class_e {
+  S1AP_OVERLOAD_CLASS_ESSENTIAL = 0,   ///< Successful/unsuccessful outcomes and other procedures, never shed
+  S1AP_OVERLOAD_CLASS_UE_ASSOCIATED,   ///< UplinkNASTransport of UEs already having a S1 connection
+  S1AP_OVERLOAD_CLASS_INITIAL_UE,      ///< InitialUEMessage, first shed
+  S1AP_OVERLOAD_CLASS_MAX
+} s1ap_overload_class_t;
+
+typedef enum s1ap_overload_event_e {
+  S1AP_OVERLOAD_EVENT_NONE = 0,
+  S1AP_OVERLOAD_EVENT_START,           ///< OverloadStart has to be sent to eNBs
+  S1AP_OVERLOAD_EVENT_STOP,            ///< OverloadStop has to be sent to eNBs
+} s1ap_overload_event_t;
+
+typedef struct s1ap_overload_stats_s {
+  uint32_t pending;                                 ///< PDUs queued to S1AP task
+  uint32_t latency_ms;                              ///< Smoothed queue latency
+  bool     active;                                  ///< OverloadStart sent, OverloadStop not yet
+  uint64_t admitted[S1AP_OVERLOAD_CLASS_MAX];
+  uint64_t shed[S1AP_OVERLOAD_CLASS_MAX];
+} s1ap_overload_stats_t;
+
+/** \brief Set the thresholds (0 max_pending disables queue bounding).
+ **/
+void s1ap_mme_overload_init(const uint32_t max_pending, const uint32_t initial_ue_max_pending,
+                            const uint32_t start_latency_ms, const uint32_t stop_latency_ms);
+
+/** \brief Monotonic time in microseconds used for queue latency measurement.
+ **/
+uint64_t s1ap_mme_overload_time_us(void);
+
+/** \brief Classify an APER encoded S1AP PDU without decoding it.
+ **/
+s1ap_overload_class_t s1ap_mme_overload_classify(const_bstring const pdu);
+
+/** \brief Called by the SCTP task before queuing a received PDU to the S1AP task.
+ * \param pdu             Received S1AP PDU
+ * \param enqueue_time_us Filled with the enqueue time if the PDU is admitted
+ * @returns false if the PDU has to be dropped (queue bound reached for its class)
+ **/
+bool s1ap_mme_overload_admit(const_bstring const pdu, uint64_t * const enqueue_time_us);
+
+/** \brief Undo s1ap_mme_overload_admit() when the PDU could not be queued.
+ **/
+void s1ap_mme_overload_cancel(void);
+
+/** \brief Called by the S1AP task for each PDU dequeued.
+ * \param pdu             Received S1AP PDU
+ * \param enqueue_time_us Time returned by s1ap_mme_overload_admit()
+ * \param now_us          Current time
+ * \param event           Filled with the overload state transition to signal to eNBs
+ * @returns false if the PDU has to be discarded (InitialUEMessage that waited too long while overloaded)
+ **/
+bool s1ap_mme_overload_dequeued(const_bstring const pdu, const uint64_t enqueue_time_us, const uint64_t now_us,
+                                s1ap_overload_event_t * const event);
+
+/** \brief @returns true between OverloadStart and OverloadStop.
+ **/
+bool s1ap_mme_overload_is_active(void);
+
+void s1ap_mme_overload_get_stats(s1ap_overload_stats_t * const stats);
+
+#endif /* FILE_S1AP_MME_OVERLOAD_SEEN */
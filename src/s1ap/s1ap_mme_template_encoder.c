@@ -0,0 +1,272 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_template_encoder.c
+  \brief Pre-encoded S1AP PDUs for the most frequent MME originated messages
+  \company Eurecom
+
+  The APER encoding of DownlinkNASTransport and UEContextReleaseCommand is a
+  constant skeleton (procedure code, IE ids, criticalities, preambles) in which
+  only the UE S1AP IDs, the cause and the NAS PDU change. The skeletons are kept
+  here as pre-encoded byte strings, the variable fields and the length
+  determinants that depend on them are patched in the output buffer.
+  The S1 Setup Response only depends on the MME configuration, the asn1c
+  encoding is done once and the resulting bytes are reused.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bstrlib.h"
+
+#include "log.h"
+#include "assertions.h"
+#include "common_defs.h"
+#include "s1ap_common.h"
+#include "s1ap_mme_template_encoder.h"
+#include "dynamic_memory_check.h"
+
+// X.691 10.9 length determinant, fragmented form not handled by templates
+#define S1AP_TEMPLATE_MAX_LENGTH            16383
+#define S1AP_TEMPLATE_LENGTH_SIZE(lEnGtH)   (((lEnGtH) < 128) ? 1:2)
+
+// CHOICE index + criticality of the PDU are patched, length too
+static const uint8_t s1ap_template_downlink_nas_transport[] = {
+  0x00, S1ap_ProcedureCode_id_downlinkNASTransport, 0x00 /* criticality */, /* length */
+  0x00, 0x00, 0x03,                                           // extension bit + padding, 3 IEs
+};
+static const uint8_t s1ap_template_ue_context_release_command[] = {
+  0x00, S1ap_ProcedureCode_id_UEContextRelease, 0x00 /* criticality */, /* length */
+  0x00, 0x00, 0x02,                                           // extension bit + padding, 2 IEs
+};
+
+// IE id on 16 bits, criticality on 2 bits + padding, length patched after
+static const uint8_t s1ap_template_ie_mme_ue_s1ap_id[] = {0x00, S1ap_ProtocolIE_ID_id_MME_UE_S1AP_ID, 0x00 /* reject */};
+static const uint8_t s1ap_template_ie_enb_ue_s1ap_id[] = {0x00, S1ap_ProtocolIE_ID_id_eNB_UE_S1AP_ID, 0x00 /* reject */};
+static const uint8_t s1ap_template_ie_nas_pdu[]        = {0x00, S1ap_ProtocolIE_ID_id_NAS_PDU,        0x00 /* reject */};
+static const uint8_t s1ap_template_ie_ue_s1ap_ids[]    = {0x00, S1ap_ProtocolIE_ID_id_UE_S1AP_IDs,    0x00 /* reject */};
+static const uint8_t s1ap_template_ie_cause[]          = {0x00, S1ap_ProtocolIE_ID_id_Cause,          0x40 /* ignore */};
+
+// Root enumeration of each Cause alternative (R10.5): number of values, number of bits
+static const struct {
+  uint8_t root_values;
+  uint8_t bits;
+} s1ap_template_cause_enum[] = {
+  [S1ap_Cause_PR_radioNetwork] = {36, 6},
+  [S1ap_Cause_PR_transport]    = { 2, 1},
+  [S1ap_Cause_PR_nas]          = { 4, 2},
+  [S1ap_Cause_PR_protocol]     = { 7, 3},
+  [S1ap_Cause_PR_misc]         = { 6, 3},
+};
+
+static bstring s1_setup_response_template = NULL;
+
+//------------------------------------------------------------------------------
+static inline uint8_t s1ap_template_criticality (const S1ap_Criticality_t criticality)
+{
+  return (uint8_t)(criticality << 6);
+}
+
+//------------------------------------------------------------------------------
+// Number of octets of a constrained whole number with range > 64K (minimum 1)
+static inline int s1ap_template_id_octets (const uint32_t id)
+{
+  if (id > 0x00FFFFFF) return 4;
+  if (id > 0x0000FFFF) return 3;
+  if (id > 0x000000FF) return 2;
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+static inline uint8_t * s1ap_template_put (uint8_t * p, const uint8_t * const fragment, const int size)
+{
+  memcpy (p, fragment, size);
+  return p + size;
+}
+
+//------------------------------------------------------------------------------
+static inline uint8_t * s1ap_template_put_length (uint8_t * p, const uint32_t length)
+{
+  if (length < 128) {
+    *p++ = (uint8_t)length;
+  } else {
+    *p++ = (uint8_t)(0x80 | (length >> 8));
+    *p++ = (uint8_t)(length & 0xFF);
+  }
+  return p;
+}
+
+//------------------------------------------------------------------------------
+static inline uint8_t * s1ap_template_put_id (uint8_t * p, const uint32_t id, const int octets)
+{
+  for (int i = octets - 1; i >= 0; i--) {
+    *p++ = (uint8_t)(id >> (8 * i));
+  }
+  return p;
+}
+
+//------------------------------------------------------------------------------
+static bstring s1ap_template_alloc (const int length)
+{
+  bstring b = bfromcstralloc (length, "");
+  if (b) {
+    b->slen = length;
+  }
+  return b;
+}
+
+//------------------------------------------------------------------------------
+bstring s1ap_mme_template_encode_downlink_nas_transport (
+    const mme_ue_s1ap_id_t mme_ue_s1ap_id,
+    const enb_ue_s1ap_id_t enb_ue_s1ap_id,
+    const S1ap_Criticality_t criticality,
+    const_bstring const nas_pdu)
+{
+  DevAssert (nas_pdu != NULL);
+  const int                               mme_id_octets = s1ap_template_id_octets (mme_ue_s1ap_id);
+  const int                               enb_id_octets = s1ap_template_id_octets (enb_ue_s1ap_id);
+  const uint32_t                          nas_length = blength (nas_pdu);
+
+  if ((enb_id_octets > 3) || (nas_length > S1AP_TEMPLATE_MAX_LENGTH)) {
+    return NULL;
+  }
+  const uint32_t                          nas_ie_length = S1AP_TEMPLATE_LENGTH_SIZE (nas_length) + nas_length;
+  const uint32_t                          ies_length = 3 +
+      sizeof (s1ap_template_ie_mme_ue_s1ap_id) + 1 + 1 + mme_id_octets +
+      sizeof (s1ap_template_ie_enb_ue_s1ap_id) + 1 + 1 + enb_id_octets +
+      sizeof (s1ap_template_ie_nas_pdu) + S1AP_TEMPLATE_LENGTH_SIZE (nas_ie_length) + nas_ie_length;
+  if (ies_length > S1AP_TEMPLATE_MAX_LENGTH) {
+    return NULL;
+  }
+  const int                               pdu_length = 3 + S1AP_TEMPLATE_LENGTH_SIZE (ies_length) + ies_length;
+  bstring                                 b = s1ap_template_alloc (pdu_length);
+
+  if (!b) return NULL;
+  uint8_t                                *p = b->data;
+
+  p = s1ap_template_put (p, s1ap_template_downlink_nas_transport, 3);
+  p[-1] = s1ap_template_criticality (criticality);
+  p = s1ap_template_put_length (p, ies_length);
+  p = s1ap_template_put (p, &s1ap_template_downlink_nas_transport[3], 3);
+
+  p = s1ap_template_put (p, s1ap_template_ie_mme_ue_s1ap_id, sizeof (s1ap_template_ie_mme_ue_s1ap_id));
+  *p++ = (uint8_t)(1 + mme_id_octets);
+  *p++ = (uint8_t)((mme_id_octets - 1) << 6);
+  p = s1ap_template_put_id (p, mme_ue_s1ap_id, mme_id_octets);
+
+  p = s1ap_template_put (p, s1ap_template_ie_enb_ue_s1ap_id, sizeof (s1ap_template_ie_enb_ue_s1ap_id));
+  *p++ = (uint8_t)(1 + enb_id_octets);
+  *p++ = (uint8_t)((enb_id_octets - 1) << 6);
+  p = s1ap_template_put_id (p, enb_ue_s1ap_id, enb_id_octets);
+
+  p = s1ap_template_put (p, s1ap_template_ie_nas_pdu, sizeof (s1ap_template_ie_nas_pdu));
+  p = s1ap_template_put_length (p, nas_ie_length);
+  p = s1ap_template_put_length (p, nas_length);
+  p = s1ap_template_put (p, bdata (nas_pdu), nas_length);
+
+  DevAssert ((p - b->data) == pdu_length);
+  return b;
+}
+
+//------------------------------------------------------------------------------
+bstring s1ap_mme_template_encode_ue_context_release_command (
+    const mme_ue_s1ap_id_t mme_ue_s1ap_id,
+    const enb_ue_s1ap_id_t enb_ue_s1ap_id,
+    const S1ap_Criticality_t criticality,
+    const S1ap_Cause_PR cause_type,
+    const long cause_value)
+{
+  const int                               mme_id_octets = s1ap_template_id_octets (mme_ue_s1ap_id);
+  const int                               enb_id_octets = s1ap_template_id_octets (enb_ue_s1ap_id);
+
+  if ((enb_id_octets > 3) || (cause_type < S1ap_Cause_PR_radioNetwork) || (cause_type > S1ap_Cause_PR_misc)) {
+    return NULL;
+  }
+  const int                               cause_bits = s1ap_template_cause_enum[cause_type].bits;
+  if ((cause_value < 0) || (cause_value >= s1ap_template_cause_enum[cause_type].root_values)) {
+    // value in the extension part of the enumeration
+    return NULL;
+  }
+  /*
+   * Cause: CHOICE extension bit, index on 3 bits, ENUMERATED extension bit, root value
+   */
+  const uint16_t                          cause = (uint16_t)(((cause_type - 1) << 12) | (cause_value << (11 - cause_bits)));
+  const int                               cause_octets = (5 + cause_bits + 7) / 8;
+  /*
+   * UE-S1AP-IDs: CHOICE extension bit, index on 1 bit, UE-S1AP-ID-pair extension
+   * and optional bits, MME UE S1AP ID length on 2 bits, then eNB UE S1AP ID.
+   */
+  const int                               ids_length = 1 + mme_id_octets + 1 + enb_id_octets;
+  const uint32_t                          ies_length = 3 +
+      sizeof (s1ap_template_ie_ue_s1ap_ids) + 1 + ids_length +
+      sizeof (s1ap_template_ie_cause) + 1 + cause_octets;
+  const int                               pdu_length = 3 + S1AP_TEMPLATE_LENGTH_SIZE (ies_length) + ies_length;
+  bstring                                 b = s1ap_template_alloc (pdu_length);
+
+  if (!b) return NULL;
+  uint8_t                                *p = b->data;
+
+  p = s1ap_template_put (p, s1ap_template_ue_context_release_command, 3);
+  p[-1] = s1ap_template_criticality (criticality);
+  p = s1ap_template_put_length (p, ies_length);
+  p = s1ap_template_put (p, &s1ap_template_ue_context_release_command[3], 3);
+
+  p = s1ap_template_put (p, s1ap_template_ie_ue_s1ap_ids, sizeof (s1ap_template_ie_ue_s1ap_ids));
+  *p++ = (uint8_t)ids_length;
+  *p++ = (uint8_t)((mme_id_octets - 1) << 2);
+  p = s1ap_template_put_id (p, mme_ue_s1ap_id, mme_id_octets);
+  *p++ = (uint8_t)((enb_id_octets - 1) << 6);
+  p = s1ap_template_put_id (p, enb_ue_s1ap_id, enb_id_octets);
+
+  p = s1ap_template_put (p, s1ap_template_ie_cause, sizeof (s1ap_template_ie_cause));
+  *p++ = (uint8_t)cause_octets;
+  *p++ = (uint8_t)(cause >> 8);
+  if (cause_octets > 1) {
+    *p++ = (uint8_t)(cause & 0xFF);
+  }
+
+  DevAssert ((p - b->data) == pdu_length);
+  return b;
+}
+
+//------------------------------------------------------------------------------
+bstring s1ap_mme_template_get_s1_setup_response (void)
+{
+  if (s1_setup_response_template) {
+    return bstrcpy (s1_setup_response_template);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+void s1ap_mme_template_store_s1_setup_response (const uint8_t * const buffer, const uint32_t length)
+{
+  bdestroy_wrapper (&s1_setup_response_template);
+  s1_setup_response_template = blk2bstr (buffer, length);
+}
+
+//------------------------------------------------------------------------------
+void s1ap_mme_template_encoder_reset (void)
+{
+  bdestroy_wrapper (&s1_setup_response_template);
+}
@@ -0,0 +1,68 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+
+/*! \file s1ap_mme_template_encoder.h
+  \brief Pre-encoded S1AP PDUs for the most frequent MME originated messages
+  \company Eurecom
+*/
+
+#ifndef FILE_S1AP_MME_TEMPLATE_ENCODER_SEEN
+#define FILE_S1AP_MME_TEMPLATE_ENCODER_SEEN
+#include "bstrlib.h"
+#include "3gpp_36.401.h"
+#include "s1ap_common.h"
+
+/** \brief Encode a DownlinkNASTransport PDU (MME-UE-S1AP-ID, eNB-UE-S1AP-ID, NAS-PDU only).
+ * The output is byte identical to s1ap_mme_encode_pdu().
+ * \param mme_ue_s1ap_id MME UE S1AP ID
+ * \param enb_ue_s1ap_id eNB UE S1AP ID
+ * \param criticality    Criticality of the procedure
+ * \param nas_pdu        NAS PDU to be transported
+ * @returns a newly allocated bstring, NULL if the message shape is not handled
+ * by the template (caller must then use the asn1c encoder).
+ **/
+bstring s1ap_mme_template_encode_downlink_nas_transport(const mme_ue_s1ap_id_t mme_ue_s1ap_id, const enb_ue_s1ap_id_t enb_ue_s1ap_id,
+    const S1ap_Criticality_t criticality, const_bstring const nas_pdu);
+
+/** \brief Encode a UEContextReleaseCommand PDU with an UE S1AP ID pair.
+ * The output is byte identical to s1ap_mme_encode_pdu().
+ * @returns a newly allocated bstring, NULL if the message shape is not handled
+ * by the template (cause value in the extension part of the enumeration).
+ **/
+bstring s1ap_mme_template_encode_ue_context_release_command(const mme_ue_s1ap_id_t mme_ue_s1ap_id, const enb_ue_s1ap_id_t enb_ue_s1ap_id,
+    const S1ap_Criticality_t criticality, const S1ap_Cause_PR cause_type, const long cause_value);
+
+/** \brief Return a copy of the S1 Setup Response previously stored with
+ * s1ap_mme_template_store_s1_setup_response(), NULL if there is none.
+ **/
+bstring s1ap_mme_template_get_s1_setup_response(void);
+
+/** \brief Keep a copy of the encoded S1 Setup Response, its content only
+ * depends on the MME configuration.
+ **/
+void s1ap_mme_template_store_s1_setup_response(const uint8_t * const buffer, const uint32_t length);
+
+/** \brief Release stored templates (configuration change or exit).
+ **/
+void s1ap_mme_template_encoder_reset(void);
+
+#endif /* FILE_S1AP_MME_TEMPLATE_ENCODER_SEEN */
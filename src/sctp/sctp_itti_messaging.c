@@ -29,9 +29,23 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "dynamic_memory_check.h"
 #include "intertask_interface.h"
 #include "sctp_itti_messaging.h"
 
+static sctp_itti_admit_cb_t  sctp_itti_admit_cb  = NULL;
+static sctp_itti_cancel_cb_t sctp_itti_cancel_cb = NULL;
+
+//------------------------------------------------------------------------------
+void
+sctp_itti_set_admission_control (
+    sctp_itti_admit_cb_t  admit,
+    sctp_itti_cancel_cb_t cancel)
+{
+  sctp_itti_cancel_cb = cancel;
+  sctp_itti_admit_cb  = admit;
+}
+
 //------------------------------------------------------------------------------
 int
 sctp_itti_send_lower_layer_conf (
@@ -80,6 +94,15 @@ int sctp_itti_send_new_message_ind(
     const sctp_stream_id_t instreams,
     const sctp_stream_id_t outstreams)
 {
+  uint64_t                                enqueue_time_us = 0;
+
+  /*
+   * Overload control, drop the PDU before allocating ITTI memory for it
+   */
+  if ((sctp_itti_admit_cb) && (!sctp_itti_admit_cb (*payload, &enqueue_time_us))) {
+    bdestroy_wrapper (payload);
+    return RETURNok;
+  }
   MessageDef                             *message_p = itti_alloc_new_message (TASK_SCTP, SCTP_DATA_IND);
   if (message_p) {
     SCTP_DATA_IND (message_p).payload    = *payload;
@@ -88,8 +111,12 @@ int sctp_itti_send_new_message_ind(
     SCTP_DATA_IND (message_p).assoc_id   = assoc_id;
     SCTP_DATA_IND (message_p).instreams  = instreams;
     SCTP_DATA_IND (message_p).outstreams = outstreams;
+    SCTP_DATA_IND (message_p).enqueue_time_us = enqueue_time_us;
     return itti_send_msg_to_task (TASK_S1AP, INSTANCE_DEFAULT, message_p);
   }
+  if (sctp_itti_cancel_cb) {
+    sctp_itti_cancel_cb ();
+  }
   return RETURNerror;
 }
 
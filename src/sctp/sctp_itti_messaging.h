@@ -30,6 +30,16 @@
 #define FILE_SCTP_ITTI_MESSAGING_SEEN
 #include "common_defs.h"
 
+/*
+ * Admission control of the received PDUs, provided by the upper layer (S1AP overload control).
+ * admit returns false if the PDU has to be dropped, it may stamp the enqueue time of the PDU.
+ * cancel is called if an admitted PDU could not be forwarded.
+ */
+typedef bool (*sctp_itti_admit_cb_t)(const_bstring const pdu, uint64_t * const enqueue_time_us);
+typedef void (*sctp_itti_cancel_cb_t)(void);
+
+void sctp_itti_set_admission_control(sctp_itti_admit_cb_t admit, sctp_itti_cancel_cb_t cancel);
+
 int sctp_itti_send_lower_layer_conf (
     const task_id_t        origin_task_id,
     const sctp_assoc_id_t  assoc_id,
@@ -67,15 +67,13 @@ void pgw_config_init (pgw_config_t * config_pP)
 {
   memset ((char *)config_pP, 0, sizeof (*config_pP));
   pthread_rwlock_init (&config_pP->rw_lock, NULL);
-  STAILQ_INIT (&config_pP->ipv4_pool_list);
+  config_pP->gtp_userspace_workers = 1;
 }
 
 //------------------------------------------------------------------------------
 int pgw_config_process (pgw_config_t * config_pP)
 {
   struct in_addr                          addr_start, addr_mask;
-  uint64_t                                counter64 = 0;
-  conf_ipv4_list_elm_t                   *ip4_ref = NULL;
 
   async_system_command (TASK_ASYNC_SYSTEM, PGW_ABORT_ON_ERROR, "iptables -t mangle -F OUTPUT");
   async_system_command (TASK_ASYNC_SYSTEM, PGW_ABORT_ON_ERROR, "iptables -t mangle -F POSTROUTING");
@@ -150,22 +148,6 @@ int pgw_config_process (pgw_config_t * config_pP)
           inet_ntoa(config_pP->ue_pool_addr[i]), config_pP->ue_pool_mask[i], addr_start.s_addr, addr_mask.s_addr);
     }
 
-    counter64 = 0x00000000FFFFFFFF >> config_pP->ue_pool_mask[i];  // address Prefix_mask/0..0 not valid
-    /* .1 reserved for gateway
-     * the last address is reserved traditionally (.255 in the case of mask 24)
-     */
-    counter64 = counter64 - 2;
-
-    //Any math should be applied onto host byte order i.e. ntohl()
-    addr_start.s_addr = htonl( ntohl(addr_start.s_addr) + 2 );
-    do {
-      ip4_ref = calloc (1, sizeof (conf_ipv4_list_elm_t));
-      ip4_ref->addr.s_addr = addr_start.s_addr;
-      STAILQ_INSERT_TAIL (&config_pP->ipv4_pool_list, ip4_ref, ipv4_entries);
-      counter64 = counter64 - 1;
-      addr_start.s_addr = htonl( ntohl(addr_start.s_addr) + 1 );
-    } while (counter64 > 0);
-
     //---------------
     if (config_pP->masquerade_SGI) {
       async_system_command (TASK_ASYNC_SYSTEM, PGW_ABORT_ON_ERROR, "iptables -t nat -I POSTROUTING -s %s/%d -o %s  ! --protocol sctp -j SNAT --to-source %s",
@@ -222,6 +204,9 @@ int pgw_config_parse_file (pgw_config_t * config_pP)
   struct in_addr                          addr_start;
   bstring                                 system_cmd = NULL;
   libconfig_int                           mtu = 0;
+  libconfig_int                           gtp_userspace_workers = 1;
+  libconfig_int                           gtp_userspace_first_core = 0;
+  libconfig_int                           usage_report_period = 0;
   int                                     prefix_mask = 0;
 
 
@@ -324,6 +309,14 @@ int pgw_config_parse_file (pgw_config_t * config_pP)
         OAILOG_WARNING (LOG_SPGW_APP, "CONFIG POOL ADDR IPV4: NO IPV4 ADDRESS FOUND\n");
       }
 
+      if (config_setting_lookup_string (subsetting, PGW_CONFIG_STRING_STICKY_ALLOCATION, (const char **)&astring)) {
+        if (strcasecmp (astring, "yes") == 0) {
+          config_pP->ue_pool_sticky = true;
+        } else {
+          config_pP->ue_pool_sticky = false;
+        }
+      }
+
       if (config_setting_lookup_string (setting_pgw, PGW_CONFIG_STRING_DEFAULT_DNS_IPV4_ADDRESS, (const char **)&default_dns)
           && config_setting_lookup_string (setting_pgw, PGW_CONFIG_STRING_DEFAULT_DNS_SEC_IPV4_ADDRESS, (const char **)&default_dns_sec)) {
         config_pP->ipv4.if_name_S5_S8 = bfromcstr (if_S5_S8);
@@ -360,8 +353,27 @@ int pgw_config_parse_file (pgw_config_t * config_pP)
       } else if (strcasecmp (astring, PGW_CONFIG_STRING_GTP_KERNEL) == 0) {
         config_pP->use_gtp_kernel_module = true;
         config_pP->enable_loading_gtp_kernel_module = false;
+      } else if (strcasecmp (astring, PGW_CONFIG_STRING_GTP_USERSPACE) == 0) {
+        config_pP->use_gtp_kernel_module = true;
+        config_pP->enable_loading_gtp_kernel_module = false;
+        config_pP->use_gtp_userspace = true;
       }
     }
+    if (config_setting_lookup_int (setting_pgw, PGW_CONFIG_STRING_GTPV1U_USERSPACE_WORKERS, &gtp_userspace_workers)) {
+      AssertFatal ((0 < gtp_userspace_workers) && (PGW_GTPV1U_USERSPACE_WORKERS_MAX >= gtp_userspace_workers),
+          "Bad %s value %d, range is 1..%d\n", PGW_CONFIG_STRING_GTPV1U_USERSPACE_WORKERS, (int)gtp_userspace_workers, PGW_GTPV1U_USERSPACE_WORKERS_MAX);
+      config_pP->gtp_userspace_workers = gtp_userspace_workers;
+    }
+    if (config_setting_lookup_int (setting_pgw, PGW_CONFIG_STRING_GTPV1U_USERSPACE_FIRST_CORE, &gtp_userspace_first_core)) {
+      AssertFatal (0 <= gtp_userspace_first_core, "Bad %s value %d\n", PGW_CONFIG_STRING_GTPV1U_USERSPACE_FIRST_CORE, (int)gtp_userspace_first_core);
+      config_pP->gtp_userspace_first_core = gtp_userspace_first_core;
+    }
+    if ((config_setting_lookup_string (setting_pgw, PGW_CONFIG_STRING_USAGE_REPORT_FILE, (const char **)&astring))
+        && (config_setting_lookup_int (setting_pgw, PGW_CONFIG_STRING_USAGE_REPORT_PERIOD, &usage_report_period))) {
+      AssertFatal (0 <= usage_report_period, "Bad %s value %d\n", PGW_CONFIG_STRING_USAGE_REPORT_PERIOD, (int)usage_report_period);
+      config_pP->usage_report_file = bfromcstr (astring);
+      config_pP->usage_report_period_sec = usage_report_period;
+    }
 
 
     subsetting = config_setting_get_member (setting_pgw, PGW_CONFIG_STRING_PCEF);
@@ -458,7 +470,18 @@ void pgw_config_display (pgw_config_t * config_p)
   OAILOG_INFO (LOG_SPGW_APP, "    SGi MTU (read)........: %u\n", config_p->ipv4.mtu_SGI);
   OAILOG_INFO (LOG_SPGW_APP, "    User TCP MSS clamping : %s\n", config_p->ue_tcp_mss_clamp == 0 ? "false" : "true");
   OAILOG_INFO (LOG_SPGW_APP, "    User IP masquerading  : %s\n", config_p->masquerade_SGI == 0 ? "false" : "true");
-  if (config_p->use_gtp_kernel_module) {
+  OAILOG_INFO (LOG_SPGW_APP, "- UE IP address pools:\n");
+  for (int i = 0; i < config_p->num_ue_pool; i++) {
+    OAILOG_INFO (LOG_SPGW_APP, "    IPv4 pool ............: %s/%u\n", inet_ntoa (config_p->ue_pool_addr[i]), config_p->ue_pool_mask[i]);
+  }
+  OAILOG_INFO (LOG_SPGW_APP, "    Sticky allocation ....: %s\n", config_p->ue_pool_sticky == 0 ? "false" : "true");
+  if (config_p->use_gtp_userspace) {
+    OAILOG_INFO (LOG_SPGW_APP, "- GTPv1U .................: Enabled (userspace)\n");
+    OAILOG_INFO (LOG_SPGW_APP, "    Workers ..............: %u, pinned from core %u\n", config_p->gtp_userspace_workers, config_p->gtp_userspace_first_core);
+    if (config_p->usage_report_period_sec) {
+      OAILOG_INFO (LOG_SPGW_APP, "    Usage report .........: %s every %u s\n", bdata (config_p->usage_report_file), config_p->usage_report_period_sec);
+    }
+  } else if (config_p->use_gtp_kernel_module) {
     OAILOG_INFO (LOG_SPGW_APP, "- GTPv1U .................: Enabled (Linux kernel module)\n");
     OAILOG_INFO (LOG_SPGW_APP, "    Load/unload module....: %s\n", (config_p->enable_loading_gtp_kernel_module) ? "enabled" : "disabled");
   } else {
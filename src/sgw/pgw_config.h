@@ -46,6 +46,7 @@
 #define PGW_CONFIG_STRING_IP_ADDRESS_POOL                       "IP_ADDRESS_POOL"
 #define PGW_CONFIG_STRING_IPV4_ADDRESS_LIST                     "IPV4_LIST"
 #define PGW_CONFIG_STRING_IPV4_PREFIX_DELIMITER                 '/'
+#define PGW_CONFIG_STRING_STICKY_ALLOCATION                     "STICKY_ALLOCATION"
 #define PGW_CONFIG_STRING_DEFAULT_DNS_IPV4_ADDRESS              "DEFAULT_DNS_IPV4_ADDRESS"
 #define PGW_CONFIG_STRING_DEFAULT_DNS_SEC_IPV4_ADDRESS          "DEFAULT_DNS_SEC_IPV4_ADDRESS"
 #define PGW_CONFIG_STRING_UE_MTU                                "UE_MTU"
@@ -53,6 +54,11 @@
 #define PGW_CONFIG_STRING_NO_GTP_KERNEL_AVAILABLE               "NO_GTP_KERNEL_AVAILABLE"
 #define PGW_CONFIG_STRING_GTP_KERNEL_MODULE                     "GTP_KERNEL_MODULE"
 #define PGW_CONFIG_STRING_GTP_KERNEL                            "GTP_KERNEL"
+#define PGW_CONFIG_STRING_GTP_USERSPACE                         "GTP_USERSPACE"
+#define PGW_CONFIG_STRING_GTPV1U_USERSPACE_WORKERS              "GTPV1U_USERSPACE_WORKERS"
+#define PGW_CONFIG_STRING_GTPV1U_USERSPACE_FIRST_CORE           "GTPV1U_USERSPACE_FIRST_CORE"
+#define PGW_CONFIG_STRING_USAGE_REPORT_FILE                     "USAGE_REPORT_FILE"
+#define PGW_CONFIG_STRING_USAGE_REPORT_PERIOD                   "USAGE_REPORT_PERIOD_SEC"
 
 #define PGW_CONFIG_STRING_INTERFACE_DISABLED                    "none"
 
@@ -72,12 +78,8 @@
 // may be more
 #define PGW_MAX_ALLOCATED_PDN_ADDRESSES 1024
 
-
-typedef struct conf_ipv4_list_elm_s {
-  STAILQ_ENTRY(conf_ipv4_list_elm_s) ipv4_entries;
-  struct in_addr  addr;
-} conf_ipv4_list_elm_t;
-
+// threads of the userspace GTP-U fast path
+#define PGW_GTPV1U_USERSPACE_WORKERS_MAX 16
 
 
 #include "pgw_pcef_emulation.h"
@@ -111,11 +113,18 @@ typedef struct pgw_config_s {
 #define PGW_NUM_UE_POOL_MAX 16
   uint8_t          ue_pool_mask[PGW_NUM_UE_POOL_MAX];
   struct in_addr   ue_pool_addr[PGW_NUM_UE_POOL_MAX];
+  // give an IMSI back its previous address if still free
+  bool             ue_pool_sticky;
 
   bool      force_push_pco;
   uint16_t  ue_mtu;
-  bool      use_gtp_kernel_module;
+  bool      use_gtp_kernel_module;    // tunnels are set through gtp_tunnel_ops, kernel module or userspace fast path
   bool      enable_loading_gtp_kernel_module;
+  bool      use_gtp_userspace;        // userspace fast path instead of the gtp kernel module
+  uint32_t  gtp_userspace_workers;    // fast path threads, pinned one per core from gtp_userspace_first_core on
+  uint32_t  gtp_userspace_first_core;
+  bstring   usage_report_file;        // per bearer counters of the userspace fast path, CSV
+  uint32_t  usage_report_period_sec;  // 0 disables the usage report
 
   struct {
     bool      enabled;
@@ -127,8 +136,6 @@ typedef struct pgw_config_s {
     uint64_t  apn_ambr_ul;
     uint64_t  apn_ambr_dl;
   } pcef;
-
-  STAILQ_HEAD(ipv4_pool_head_s, conf_ipv4_list_elm_s) ipv4_pool_list;
 } pgw_config_t;
 
 
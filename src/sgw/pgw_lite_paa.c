@@ -27,117 +27,344 @@
 */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "bstrlib.h"
 
-#include "queue.h"
 #include "dynamic_memory_check.h"
 #include "assertions.h"
-#include "conversions.h"
-#include "hashtable.h"
-#include "obj_hashtable.h"
 #include "common_defs.h"
-#include "intertask_interface.h"
-#include "msc.h"
 #include "log.h"
-#include "sgw_ie_defs.h"
-#include "3gpp_23.401.h"
-#include "sgw_defs.h"
 #include "spgw_config.h"
-#include "sgw.h"
 #include "pgw_lite_paa.h"
 
+#define PGW_PAA_BITS_PER_WORD      64
+#define PGW_PAA_WORD_SHIFT         6
+#define PGW_PAA_BIT_MASK           (PGW_PAA_BITS_PER_WORD - 1)
 
-//#define PGW_LITE_FREE_ADDR_POOL_CONFIG 1
+/*
+ * Each configured pool is cut in one range per SPGW_APP shard, a shard takes
+ * addresses in its own ranges first and only locks ranges of other shards
+ * when its own are exhausted.
+ */
+typedef struct pgw_paa_ipv4_pool_s {
+  pthread_mutex_t  lock;
+  uint32_t         first;   // host byte order
+  uint32_t         shard;
+  pgw_paa_bitmap_t bitmap;
+} pgw_paa_ipv4_pool_t;
 
-extern pgw_app_t                        pgw_app;
+static pgw_paa_ipv4_pool_t  pgw_paa_ipv4_pool[PGW_NUM_UE_POOL_MAX * SGW_SPGW_APP_SHARDS_MAX];
+static int                  pgw_paa_num_ipv4_pool = 0;
+// pool of the last allocation, per shard
+static int                  pgw_paa_ipv4_pool_idx[SGW_SPGW_APP_SHARDS_MAX] = {0};
+// shard of the calling SPGW_APP task
+static __thread uint32_t    pgw_paa_current_shard = 0;
 
+//------------------------------------------------------------------------------
+static inline uint32_t pgw_paa_bitmap_words (const uint32_t nb_bits)
+{
+  return (nb_bits + PGW_PAA_BIT_MASK) >> PGW_PAA_WORD_SHIFT;
+}
 
-// Load in PGW pool, configured PAA address pool
-void
-pgw_load_pool_ip_addresses (
-  void)
+//------------------------------------------------------------------------------
+int pgw_paa_bitmap_init (pgw_paa_bitmap_t * const bitmap, const uint32_t size)
 {
-  struct conf_ipv4_list_elm_s   *conf_ipv4_p = NULL;
-  struct ipv4_list_elm_s        *ipv4_p = NULL;
-  //struct conf_ipv6_list_elm_s   *conf_ipv6_p = NULL;
-  //struct ipv6_list_elm_s        *ipv6_p = NULL;
-  //char                           print_buffer[INET6_ADDRSTRLEN];
+  uint32_t                                nb_bits = size;
 
-  STAILQ_INIT (&pgw_app.ipv4_list_free);
-  STAILQ_INIT (&pgw_app.ipv4_list_allocated);
-  STAILQ_FOREACH (conf_ipv4_p, &spgw_config.pgw_config.ipv4_pool_list, ipv4_entries) {
-    ipv4_p = calloc (1, sizeof (struct ipv4_list_elm_s));
-    ipv4_p->addr.s_addr = conf_ipv4_p->addr.s_addr;
-    STAILQ_INSERT_TAIL (&pgw_app.ipv4_list_free, ipv4_p, ipv4_entries);
-    //SPGW_APP_DEBUG("Loaded IPv4 PAA address in pool: %s\n",
-    //        inet_ntoa(conf_ipv4_p->addr));
+  memset (bitmap, 0, sizeof (*bitmap));
+  if (0 == size) {
+    return RETURNerror;
   }
+  bitmap->size = size;
+  bitmap->nb_free = size;
+  do {
+    const uint32_t                        nb_words = pgw_paa_bitmap_words (nb_bits);
 
-//  STAILQ_FOREACH (conf_ipv6_p, &spgw_config.pgw_config.pgw_lite_ipv6_pool_list, ipv6_entries) {
-//    ipv6_p = calloc (1, sizeof (struct pgw_lite_ipv6_list_elm_s));
-//    ipv6_p->addr = conf_ipv6_p->addr;
-//    ipv6_p->prefix_len = conf_ipv6_p->prefix_len;
-//    ipv6_p->num_allocated = 0;
-//    STAILQ_INSERT_TAIL (&pgw_app.pgw_lite_ipv6_list_free, ipv6_p, ipv6_entries);
-//
-//    if (inet_ntop (AF_INET6, &ipv6_p->addr, print_buffer, INET6_ADDRSTRLEN) == NULL) {
-//      OAILOG_ERROR (LOG_SPGW_APP, "Could not Load IPv6 PAA address in pool: %s\n", strerror (errno));
-//    }                           /*else {
-//                                 *
-//                                 * SPGW_APP_DEBUG("Loaded IPv6 PAA prefix in pool: %s\n",print_buffer);
-//                                 * } */
-//  }
-#if PGW_LITE_FREE_ADDR_POOL_CONFIG
+    AssertFatal (PGW_PAA_BITMAP_LEVELS_MAX > bitmap->nb_levels, "Too many bitmap levels for %u entries", size);
+    bitmap->level[bitmap->nb_levels] = malloc (nb_words * sizeof (uint64_t));
+    if (!bitmap->level[bitmap->nb_levels]) {
+      pgw_paa_bitmap_free (bitmap);
+      return RETURNerror;
+    }
+    // all free, the bits past the last entry stay cleared
+    memset (bitmap->level[bitmap->nb_levels], 0xFF, (nb_bits >> PGW_PAA_WORD_SHIFT) * sizeof (uint64_t));
+    if (nb_bits & PGW_PAA_BIT_MASK) {
+      bitmap->level[bitmap->nb_levels][nb_words - 1] = (UINT64_C(1) << (nb_bits & PGW_PAA_BIT_MASK)) - 1;
+    }
+    bitmap->nb_levels += 1;
+    nb_bits = nb_words;
+  } while (1 < nb_bits);
+  return RETURNok;
+}
 
-  while ((conf_ipv4_p = STAILQ_FIRST (&spgw_config.pgw_config.ipv4_pool_list))) {
-    STAILQ_REMOVE_HEAD (&spgw_config.pgw_config.ipv4_pool_list, ipv4_entries);
-    free_wrapper ((void **) &conf_ipv4_p);
+//------------------------------------------------------------------------------
+void pgw_paa_bitmap_free (pgw_paa_bitmap_t * const bitmap)
+{
+  for (int l = 0; l < PGW_PAA_BITMAP_LEVELS_MAX; l++) {
+    free_wrapper ((void**)&bitmap->level[l]);
   }
+  bitmap->nb_levels = 0;
+  bitmap->size = 0;
+  bitmap->nb_free = 0;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_paa_bitmap_clear (pgw_paa_bitmap_t * const bitmap, uint32_t index)
+{
+  for (int l = 0; l < bitmap->nb_levels; l++) {
+    uint64_t                             *word = &bitmap->level[l][index >> PGW_PAA_WORD_SHIFT];
 
-#endif
+    *word &= ~(UINT64_C(1) << (index & PGW_PAA_BIT_MASK));
+    if (*word) {
+      break;
+    }
+    index >>= PGW_PAA_WORD_SHIFT;
+  }
+  bitmap->nb_free -= 1;
 }
 
+//------------------------------------------------------------------------------
+static void pgw_paa_bitmap_set (pgw_paa_bitmap_t * const bitmap, uint32_t index)
+{
+  for (int l = 0; l < bitmap->nb_levels; l++) {
+    uint64_t                             *word = &bitmap->level[l][index >> PGW_PAA_WORD_SHIFT];
+    const bool                            was_empty = (0 == *word);
 
+    *word |= UINT64_C(1) << (index & PGW_PAA_BIT_MASK);
+    if (!was_empty) {
+      break;
+    }
+    index >>= PGW_PAA_WORD_SHIFT;
+  }
+  bitmap->nb_free += 1;
+}
 
-int
-pgw_get_free_ipv4_paa_address (
-  struct in_addr *const addr_pP)
+//------------------------------------------------------------------------------
+static inline bool pgw_paa_bitmap_is_free (const pgw_paa_bitmap_t * const bitmap, const uint32_t index)
 {
-  struct ipv4_list_elm_s        *ipv4_p = NULL;
+  return (bitmap->level[0][index >> PGW_PAA_WORD_SHIFT] >> (index & PGW_PAA_BIT_MASK)) & 1;
+}
+
+/*
+ * First free index at or after index, climbs the levels until a word has a
+ * candidate, then goes down following the lowest set bits.
+ */
+//------------------------------------------------------------------------------
+static bool pgw_paa_bitmap_find_next (const pgw_paa_bitmap_t * const bitmap, uint32_t index, uint32_t * const found)
+{
+  uint32_t                                nb_bits = bitmap->size;
+  int                                     l = 0;
+
+  for (l = 0; l < bitmap->nb_levels; l++) {
+    const uint32_t                        word_idx = index >> PGW_PAA_WORD_SHIFT;
+    uint64_t                              word = 0;
 
-  if (STAILQ_EMPTY (&pgw_app.ipv4_list_free)) {
-    addr_pP->s_addr = INADDR_ANY;
+    if (word_idx >= pgw_paa_bitmap_words (nb_bits)) {
+      return false;
+    }
+    word = bitmap->level[l][word_idx] & (~UINT64_C(0) << (index & PGW_PAA_BIT_MASK));
+    if (word) {
+      index = (word_idx << PGW_PAA_WORD_SHIFT) + __builtin_ctzll (word);
+      break;
+    }
+    index = word_idx + 1;
+    nb_bits = pgw_paa_bitmap_words (nb_bits);
+  }
+  if (l == bitmap->nb_levels) {
+    return false;
+  }
+  while (0 < l) {
+    l -= 1;
+    index = (index << PGW_PAA_WORD_SHIFT) + __builtin_ctzll (bitmap->level[l][index]);
+  }
+  *found = index;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+int pgw_paa_bitmap_get (pgw_paa_bitmap_t * const bitmap, uint32_t * const index)
+{
+  if (0 == bitmap->nb_free) {
     return RETURNerror;
   }
+  if (!pgw_paa_bitmap_find_next (bitmap, bitmap->cursor, index)) {
+    AssertFatal (pgw_paa_bitmap_find_next (bitmap, 0, index), "Bitmap corrupted, %u free entries not found", bitmap->nb_free);
+  }
+  pgw_paa_bitmap_clear (bitmap, *index);
+  bitmap->cursor = (*index + 1 < bitmap->size) ? *index + 1 : 0;
+  return RETURNok;
+}
 
-  ipv4_p = STAILQ_FIRST (&pgw_app.ipv4_list_free);
-  STAILQ_REMOVE (&pgw_app.ipv4_list_free, ipv4_p, ipv4_list_elm_s, ipv4_entries);
-  STAILQ_INSERT_TAIL (&pgw_app.ipv4_list_allocated, ipv4_p, ipv4_entries);
-  addr_pP->s_addr = ipv4_p->addr.s_addr;
+//------------------------------------------------------------------------------
+int pgw_paa_bitmap_reserve (pgw_paa_bitmap_t * const bitmap, const uint32_t index)
+{
+  if ((index >= bitmap->size) || (!pgw_paa_bitmap_is_free (bitmap, index))) {
+    return RETURNerror;
+  }
+  pgw_paa_bitmap_clear (bitmap, index);
   return RETURNok;
 }
 
+//------------------------------------------------------------------------------
+int pgw_paa_bitmap_release (pgw_paa_bitmap_t * const bitmap, const uint32_t index)
+{
+  if ((index >= bitmap->size) || (pgw_paa_bitmap_is_free (bitmap, index))) {
+    return RETURNerror;
+  }
+  pgw_paa_bitmap_set (bitmap, index);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static pgw_paa_ipv4_pool_t *pgw_paa_find_ipv4_pool (const struct in_addr * const addr_pP, uint32_t * const index)
+{
+  const uint32_t                          addr = ntohl (addr_pP->s_addr);
+
+  for (int i = 0; i < pgw_paa_num_ipv4_pool; i++) {
+    if ((addr >= pgw_paa_ipv4_pool[i].first) && (addr - pgw_paa_ipv4_pool[i].first < pgw_paa_ipv4_pool[i].bitmap.size)) {
+      *index = addr - pgw_paa_ipv4_pool[i].first;
+      return &pgw_paa_ipv4_pool[i];
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+void pgw_paa_set_shard (const uint32_t shard)
+{
+  pgw_paa_current_shard = shard;
+}
+
+// Load in PGW pool, configured PAA address pool
+//------------------------------------------------------------------------------
 int
-pgw_release_free_ipv4_paa_address (
-  const struct in_addr *const addr_pP)
+pgw_load_pool_ip_addresses (
+  const int num_pools,
+  const struct in_addr * const pool_addr,
+  const uint8_t * const pool_mask,
+  const uint32_t nb_shards)
 {
-  struct ipv4_list_elm_s        *ipv4_p = NULL;
+  AssertFatal ((0 < nb_shards) && (SGW_SPGW_APP_SHARDS_MAX >= nb_shards), "Bad number of shards %u", nb_shards);
+  pgw_free_pool_ip_addresses ();
+  for (int i = 0; (i < num_pools) && (i < PGW_NUM_UE_POOL_MAX); i++) {
+    const uint32_t                        nb_addr = (uint32_t)(UINT64_C(0x0000000100000000) >> pool_mask[i]);
+
+    /*
+     * network address, .1 reserved for gateway,
+     * the last address is reserved traditionally (.255 in the case of mask 24)
+     */
+    AssertFatal ((2 <= pool_mask[i]) && (30 >= pool_mask[i]), "Bad UE pool mask %u", pool_mask[i]);
+    for (uint32_t s = 0; s < nb_shards; s++) {
+      pgw_paa_ipv4_pool_t                *pool = &pgw_paa_ipv4_pool[pgw_paa_num_ipv4_pool];
+      const uint32_t                      begin = (uint32_t)((uint64_t)(nb_addr - 3) * s / nb_shards);
+      const uint32_t                      end = (uint32_t)((uint64_t)(nb_addr - 3) * (s + 1) / nb_shards);
 
-  STAILQ_FOREACH (ipv4_p, &pgw_app.ipv4_list_allocated, ipv4_entries) {
-    if (ipv4_p->addr.s_addr == addr_pP->s_addr) {
-      STAILQ_REMOVE (&pgw_app.ipv4_list_allocated, ipv4_p, ipv4_list_elm_s, ipv4_entries);
-      STAILQ_INSERT_HEAD (&pgw_app.ipv4_list_free, ipv4_p, ipv4_entries);
-      return RETURNok;
+      // a small pool may leave some shards without a range of their own
+      if (begin == end) {
+        continue;
+      }
+      pool->first = ntohl (pool_addr[i].s_addr) + 2 + begin;
+      pool->shard = s;
+      if (RETURNok != pgw_paa_bitmap_init (&pool->bitmap, end - begin)) {
+        OAILOG_ERROR (LOG_SPGW_APP, "Could not load IPv4 PAA pool %s/%u\n", inet_ntoa (pool_addr[i]), pool_mask[i]);
+        pgw_free_pool_ip_addresses ();
+        return RETURNerror;
+      }
+      pthread_mutex_init (&pool->lock, NULL);
+      pgw_paa_num_ipv4_pool += 1;
     }
+    OAILOG_DEBUG (LOG_SPGW_APP, "Loaded IPv4 PAA pool %s/%u, %u addresses in %u shards\n", inet_ntoa (pool_addr[i]), pool_mask[i], nb_addr - 3, nb_shards);
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void
+pgw_free_pool_ip_addresses (
+  void)
+{
+  for (int i = 0; i < pgw_paa_num_ipv4_pool; i++) {
+    pgw_paa_bitmap_free (&pgw_paa_ipv4_pool[i].bitmap);
+    pthread_mutex_destroy (&pgw_paa_ipv4_pool[i].lock);
   }
+  pgw_paa_num_ipv4_pool = 0;
+  memset (pgw_paa_ipv4_pool_idx, 0, sizeof (pgw_paa_ipv4_pool_idx));
+}
+
+//------------------------------------------------------------------------------
+int
+pgw_get_free_ipv4_paa_address (
+  struct in_addr *const addr_pP)
+{
+  const uint32_t                          shard = pgw_paa_current_shard;
+  int                                    *pool_idx = &pgw_paa_ipv4_pool_idx[shard];
+
+  // own ranges first, then the ranges of the other shards
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < pgw_paa_num_ipv4_pool; i++) {
+      const int                           idx = (*pool_idx + i) % pgw_paa_num_ipv4_pool;
+      pgw_paa_ipv4_pool_t                *pool = &pgw_paa_ipv4_pool[idx];
+      uint32_t                            index = 0;
+      int                                 rc = RETURNerror;
+
+      if ((0 == pass) != (shard == pool->shard)) {
+        continue;
+      }
+      pthread_mutex_lock (&pool->lock);
+      rc = pgw_paa_bitmap_get (&pool->bitmap, &index);
+      pthread_mutex_unlock (&pool->lock);
+      if (RETURNok == rc) {
+        *pool_idx = (0 == pass) ? idx : *pool_idx;
+        addr_pP->s_addr = htonl (pool->first + index);
+        return RETURNok;
+      }
+    }
+  }
+  addr_pP->s_addr = INADDR_ANY;
   return RETURNerror;
 }
 
+//------------------------------------------------------------------------------
+int
+pgw_reserve_ipv4_paa_address (
+  const struct in_addr *const addr_pP)
+{
+  uint32_t                                index = 0;
+  pgw_paa_ipv4_pool_t                    *pool = pgw_paa_find_ipv4_pool (addr_pP, &index);
+
+  int                                     rc = RETURNerror;
+
+  if (!pool) {
+    return RETURNerror;
+  }
+  pthread_mutex_lock (&pool->lock);
+  rc = pgw_paa_bitmap_reserve (&pool->bitmap, index);
+  pthread_mutex_unlock (&pool->lock);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+int
+pgw_release_free_ipv4_paa_address (
+  const struct in_addr *const addr_pP)
+{
+  uint32_t                                index = 0;
+  pgw_paa_ipv4_pool_t                    *pool = pgw_paa_find_ipv4_pool (addr_pP, &index);
 
+  int                                     rc = RETURNerror;
 
+  if (!pool) {
+    return RETURNerror;
+  }
+  pthread_mutex_lock (&pool->lock);
+  rc = pgw_paa_bitmap_release (&pool->bitmap, index);
+  pthread_mutex_unlock (&pool->lock);
+  return rc;
+}
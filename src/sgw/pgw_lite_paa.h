@@ -28,8 +28,37 @@
 #ifndef FILE_PGW_LITE_PAA_SEEN
 #define FILE_PGW_LITE_PAA_SEEN
 
-void pgw_load_pool_ip_addresses       (void);
-int pgw_get_free_ipv4_paa_address     (struct in_addr * const addr_P);
-int pgw_release_free_ipv4_paa_address (const struct in_addr * const addr_P);
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define PGW_PAA_BITMAP_LEVELS_MAX 6
+
+/*
+ * Hierarchical bitmap over the indexes of a pool, a set bit is a free index.
+ * Bit i of level l+1 is set if word i of level l is not zero, so finding,
+ * taking or returning an index costs one word per level.
+ */
+typedef struct pgw_paa_bitmap_s {
+  uint32_t         size;
+  uint32_t         nb_free;
+  // next fit, a released index is handed out again as late as possible
+  uint32_t         cursor;
+  int              nb_levels;
+  uint64_t        *level[PGW_PAA_BITMAP_LEVELS_MAX];
+} pgw_paa_bitmap_t;
+
+int  pgw_paa_bitmap_init    (pgw_paa_bitmap_t * const bitmap, const uint32_t size);
+void pgw_paa_bitmap_free    (pgw_paa_bitmap_t * const bitmap);
+int  pgw_paa_bitmap_get     (pgw_paa_bitmap_t * const bitmap, uint32_t * const index);
+int  pgw_paa_bitmap_reserve (pgw_paa_bitmap_t * const bitmap, const uint32_t index);
+int  pgw_paa_bitmap_release (pgw_paa_bitmap_t * const bitmap, const uint32_t index);
+
+// The pools are cut in nb_shards ranges, the SPGW_APP shard tasks tell their index once started
+int  pgw_load_pool_ip_addresses        (const int num_pools, const struct in_addr * const pool_addr, const uint8_t * const pool_mask, const uint32_t nb_shards);
+void pgw_paa_set_shard                 (const uint32_t shard);
+void pgw_free_pool_ip_addresses        (void);
+int  pgw_get_free_ipv4_paa_address     (struct in_addr * const addr_P);
+int  pgw_reserve_ipv4_paa_address      (const struct in_addr * const addr_P);
+int  pgw_release_free_ipv4_paa_address (const struct in_addr * const addr_P);
 
 #endif
@@ -0,0 +1,1048 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file pgw_nft.c
+  \brief Packet marking rules programmed in nf_tables over netlink.
+
+  All the rules live in the "oai_pgw" ip table, which is rebuilt from scratch
+  by pgw_nft_init():
+
+    chain postrouting { type filter hook postrouting priority mangle;
+      <SDF rules>
+      oifname "gtp0" meta mark set ip daddr . meta mark map @bearer_mark
+    }
+    chain output { type route hook output priority mangle;
+      <SDF rules>
+    }
+
+  The SDF rules mirror the tuples of the pgw_sdf_classifier: the downlink
+  filters of a tuple with the same precedence become one map from their masked
+  fields to the SDF identifier, for instance
+    ip daddr 10.0.0.0/8 meta mark set ip saddr & 255.255.0.0 . ip protocol . udp sport map @sdf_3
+  so that a packet costs one lookup per map whatever the number of filters.
+  Filters with port ranges get one rule each. The rules go from the worst
+  precedence to the best, the last match sets the mark.
+
+  A dedicated bearer only adds or removes one element of the bearer_mark map,
+  the rule set itself does not change. Changes are queued in a netlink batch
+  and pgw_nft_commit() sends the whole batch in one sendmsg(), the kernel
+  applies it as a single transaction. Each thread has its own batch and
+  netlink socket, the SPGW_APP shards do not wait on each other to queue or
+  commit, the kernel serializes their transactions.
+  \author
+  \company
+  \email:
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include "bstrlib.h"
+
+#include "dynamic_memory_check.h"
+#include "assertions.h"
+#include "common_defs.h"
+#include "log.h"
+#include "pgw_nft.h"
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK                      270
+#endif
+
+#define PGW_NFT_CHAIN_POSTROUTING        "postrouting"
+#define PGW_NFT_CHAIN_OUTPUT             "output"
+#define PGW_NFT_BEARER_MAP_NAME          "bearer_mark"
+#define PGW_NFT_BEARER_MAP_ID            1
+// nft datatypes, only used by the nft tool to display the map
+#define PGW_NFT_TYPE_IPADDR              7
+#define PGW_NFT_TYPE_INET_PROTO          12
+#define PGW_NFT_TYPE_INET_SERVICE        13
+#define PGW_NFT_TYPE_MARK                19
+#define PGW_NFT_TYPE_BITS                6
+#define PGW_NFT_SDF_MAP_NAME_FMT         "sdf_%u"
+#define PGW_NFT_SDF_MAP_ID_FIRST         16
+// NF_IP_PRI_MANGLE
+#define PGW_NFT_PRIORITY_MANGLE          (-150)
+
+// Bounds the size of the error report of a batch
+#define PGW_NFT_BATCH_MSG_MAX            1024
+#define PGW_NFT_BATCH_SIZE               (256 * 1024)
+#define PGW_NFT_MSG_SIZE_MAX             4096
+#define PGW_NFT_RCV_BUFFER_SIZE          (1024 * 1024)
+// Bounds the size of one element of an SDF map in a message
+#define PGW_NFT_SDF_ELEM_SIZE_MAX        64
+// Threads making changes: the SPGW_APP shards and the one that runs the init
+#define PGW_NFT_BATCHES_MAX              8
+
+// The changes queued by one thread, on its own netlink socket
+typedef struct pgw_nft_batch_s {
+  int                 fd;
+  uint32_t            seq;
+  uint8_t            *batch;
+  size_t              batch_len;
+  uint32_t            nb_msg;
+  // seq of the messages rejected by the kernel in the last transaction
+  uint32_t            failed_seq[PGW_NFT_BATCH_MSG_MAX];
+  uint32_t            nb_failed;
+} pgw_nft_batch_t;
+
+typedef struct pgw_nft_s {
+  pthread_mutex_t     lock;              // only taken to open a batch
+  uint32_t            generation;        // bumped by each init, 0 when not initialized
+  char                gtp_if_name[IFNAMSIZ];
+  pgw_nft_batch_t    *batches[PGW_NFT_BATCHES_MAX];
+  uint32_t            nb_batches;
+} pgw_nft_t;
+
+static pgw_nft_t pgw_nft = {.lock = PTHREAD_MUTEX_INITIALIZER};
+// batch of the calling thread, valid while its generation is the current one
+static __thread pgw_nft_batch_t *pgw_nft_batch = NULL;
+static __thread uint32_t         pgw_nft_batch_generation = 0;
+
+// Fields of pgw_sdf_key_t, in the order they are concatenated in the SDF map keys
+typedef enum {
+  PGW_NFT_SDF_REMOTE_ADDR = 0,
+  PGW_NFT_SDF_PROTOCOL,
+  PGW_NFT_SDF_TOS,
+  PGW_NFT_SDF_LOCAL_PORT,
+  PGW_NFT_SDF_REMOTE_PORT,
+  PGW_NFT_SDF_SPI,
+  PGW_NFT_SDF_FIELDS
+} pgw_nft_sdf_field_t;
+
+typedef struct pgw_nft_sdf_field_desc_s {
+  uint32_t            base;
+  uint32_t            offset;
+  uint16_t            len;
+  uint32_t            type;
+} pgw_nft_sdf_field_desc_t;
+
+// Only downlink packets are marked: the remote side is the source
+static const pgw_nft_sdf_field_desc_t pgw_nft_sdf_fields[PGW_NFT_SDF_FIELDS] = {
+  [PGW_NFT_SDF_REMOTE_ADDR] = {NFT_PAYLOAD_NETWORK_HEADER,   12, 4, PGW_NFT_TYPE_IPADDR},
+  [PGW_NFT_SDF_PROTOCOL]    = {NFT_PAYLOAD_NETWORK_HEADER,    9, 1, PGW_NFT_TYPE_INET_PROTO},
+  // no nft datatype of the size of the ToS or of the SPI, shown as marks
+  [PGW_NFT_SDF_TOS]         = {NFT_PAYLOAD_NETWORK_HEADER,    1, 1, PGW_NFT_TYPE_MARK},
+  [PGW_NFT_SDF_LOCAL_PORT]  = {NFT_PAYLOAD_TRANSPORT_HEADER,  2, 2, PGW_NFT_TYPE_INET_SERVICE},
+  [PGW_NFT_SDF_REMOTE_PORT] = {NFT_PAYLOAD_TRANSPORT_HEADER,  0, 2, PGW_NFT_TYPE_INET_SERVICE},
+  [PGW_NFT_SDF_SPI]         = {NFT_PAYLOAD_TRANSPORT_HEADER,  0, 4, PGW_NFT_TYPE_MARK},
+};
+
+// A field per 32 bit register, network byte order, padded with zeros
+typedef uint8_t pgw_nft_sdf_slots_t[PGW_NFT_SDF_FIELDS][sizeof (uint32_t)];
+
+typedef struct pgw_nft_sdf_entry_s {
+  const pgw_sdf_tuple_t *tuple;
+  const pgw_sdf_rule_t  *rule;
+} pgw_nft_sdf_entry_t;
+
+typedef struct pgw_nft_sdf_entries_s {
+  pgw_nft_sdf_entry_t   *entries;
+  uint32_t               nb;
+  uint32_t               max;
+  bool                   failed;
+} pgw_nft_sdf_entries_t;
+
+// Filters of a tuple with the same precedence: one SDF map, or one filter with port ranges
+typedef struct pgw_nft_sdf_group_s {
+  uint32_t               first;
+  uint32_t               nb;
+  uint64_t               rank;        // (precedence << 32) | seq of the first filter added
+} pgw_nft_sdf_group_t;
+
+static int pgw_nft_send_batch (void);
+
+//------------------------------------------------------------------------------
+static struct nlmsghdr *pgw_nft_msg_start (const uint16_t type, const uint16_t flags)
+{
+  struct nlmsghdr                        *nlh = NULL;
+  struct nfgenmsg                        *nfg = NULL;
+
+  if ((PGW_NFT_BATCH_MSG_MAX == pgw_nft_batch->nb_msg) || (PGW_NFT_BATCH_SIZE - pgw_nft_batch->batch_len < PGW_NFT_MSG_SIZE_MAX)) {
+    pgw_nft_commit ();
+  }
+  nlh = (struct nlmsghdr *)&pgw_nft_batch->batch[pgw_nft_batch->batch_len];
+  memset (nlh, 0, NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg)));
+  nlh->nlmsg_len = NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg));
+  nlh->nlmsg_type = (NFNL_SUBSYS_NFTABLES << 8) | type;
+  nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+  nfg = (struct nfgenmsg *)NLMSG_DATA (nlh);
+  nfg->nfgen_family = NFPROTO_IPV4;
+  nfg->version = NFNETLINK_V0;
+  nfg->res_id = 0;
+  return nlh;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_msg_end (struct nlmsghdr *nlh)
+{
+  AssertFatal (nlh->nlmsg_len <= PGW_NFT_MSG_SIZE_MAX, "nf_tables message too long %u", nlh->nlmsg_len);
+  pgw_nft_batch->batch_len += NLMSG_ALIGN (nlh->nlmsg_len);
+  pgw_nft_batch->nb_msg += 1;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put (struct nlmsghdr *nlh, const uint16_t type, const void * const data, const uint16_t len)
+{
+  struct nlattr                          *nla = (struct nlattr *)((uint8_t *)nlh + NLMSG_ALIGN (nlh->nlmsg_len));
+
+  nla->nla_type = type;
+  nla->nla_len = NLA_HDRLEN + len;
+  memcpy ((uint8_t *)nla + NLA_HDRLEN, data, len);
+  memset ((uint8_t *)nla + NLA_HDRLEN + len, 0, NLA_ALIGN (len) - len);
+  nlh->nlmsg_len = NLMSG_ALIGN (nlh->nlmsg_len) + NLA_ALIGN (nla->nla_len);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_u32 (struct nlmsghdr *nlh, const uint16_t type, const uint32_t value)
+{
+  const uint32_t                          be_value = htonl (value);
+
+  pgw_nft_put (nlh, type, &be_value, sizeof (be_value));
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_str (struct nlmsghdr *nlh, const uint16_t type, const char * const str)
+{
+  pgw_nft_put (nlh, type, str, strlen (str) + 1);
+}
+
+//------------------------------------------------------------------------------
+static struct nlattr *pgw_nft_nest_start (struct nlmsghdr *nlh, const uint16_t type)
+{
+  struct nlattr                          *nest = (struct nlattr *)((uint8_t *)nlh + NLMSG_ALIGN (nlh->nlmsg_len));
+
+  nest->nla_type = NLA_F_NESTED | type;
+  nlh->nlmsg_len = NLMSG_ALIGN (nlh->nlmsg_len) + NLA_HDRLEN;
+  return nest;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_nest_end (struct nlmsghdr *nlh, struct nlattr *nest)
+{
+  nest->nla_len = (uint8_t *)nlh + nlh->nlmsg_len - (uint8_t *)nest;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_data (struct nlmsghdr *nlh, const uint16_t type, const void * const data, const uint16_t len)
+{
+  struct nlattr                          *nest = pgw_nft_nest_start (nlh, type);
+
+  pgw_nft_put (nlh, NFTA_DATA_VALUE, data, len);
+  pgw_nft_nest_end (nlh, nest);
+}
+
+//------------------------------------------------------------------------------
+static struct nlattr *pgw_nft_expr_start (struct nlmsghdr *nlh, const char * const name, struct nlattr **data)
+{
+  struct nlattr                          *elem = pgw_nft_nest_start (nlh, NFTA_LIST_ELEM);
+
+  pgw_nft_put_str (nlh, NFTA_EXPR_NAME, name);
+  *data = pgw_nft_nest_start (nlh, NFTA_EXPR_DATA);
+  return elem;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_expr_end (struct nlmsghdr *nlh, struct nlattr *elem, struct nlattr *data)
+{
+  pgw_nft_nest_end (nlh, data);
+  pgw_nft_nest_end (nlh, elem);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_payload (struct nlmsghdr *nlh, const uint32_t base, const uint32_t offset, const uint32_t len, const uint32_t dreg)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "payload", &data);
+
+  pgw_nft_put_u32 (nlh, NFTA_PAYLOAD_DREG, dreg);
+  pgw_nft_put_u32 (nlh, NFTA_PAYLOAD_BASE, base);
+  pgw_nft_put_u32 (nlh, NFTA_PAYLOAD_OFFSET, offset);
+  pgw_nft_put_u32 (nlh, NFTA_PAYLOAD_LEN, len);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_meta (struct nlmsghdr *nlh, const uint32_t key, const uint32_t dreg)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "meta", &data);
+
+  pgw_nft_put_u32 (nlh, NFTA_META_KEY, key);
+  pgw_nft_put_u32 (nlh, NFTA_META_DREG, dreg);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_meta_set (struct nlmsghdr *nlh, const uint32_t key, const uint32_t sreg)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "meta", &data);
+
+  pgw_nft_put_u32 (nlh, NFTA_META_KEY, key);
+  pgw_nft_put_u32 (nlh, NFTA_META_SREG, sreg);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_cmp (struct nlmsghdr *nlh, const uint32_t op, const void * const value, const uint16_t len)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "cmp", &data);
+
+  pgw_nft_put_u32 (nlh, NFTA_CMP_SREG, NFT_REG_1);
+  pgw_nft_put_u32 (nlh, NFTA_CMP_OP, op);
+  pgw_nft_put_data (nlh, NFTA_CMP_DATA, value, len);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_bitwise (struct nlmsghdr *nlh, const uint32_t reg, const void * const mask, const uint16_t len)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "bitwise", &data);
+  const uint8_t                           xor[4] = {0};
+
+  AssertFatal (sizeof (xor) >= len, "Bad bitwise length %u", len);
+  pgw_nft_put_u32 (nlh, NFTA_BITWISE_SREG, reg);
+  pgw_nft_put_u32 (nlh, NFTA_BITWISE_DREG, reg);
+  pgw_nft_put_u32 (nlh, NFTA_BITWISE_LEN, len);
+  pgw_nft_put_data (nlh, NFTA_BITWISE_MASK, mask, len);
+  pgw_nft_put_data (nlh, NFTA_BITWISE_XOR, xor, len);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_immediate (struct nlmsghdr *nlh, const uint32_t value)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "immediate", &data);
+
+  pgw_nft_put_u32 (nlh, NFTA_IMMEDIATE_DREG, NFT_REG_1);
+  // register content is in host byte order for meta keys
+  pgw_nft_put_data (nlh, NFTA_IMMEDIATE_DATA, &value, sizeof (value));
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_expr_lookup (struct nlmsghdr *nlh, const char * const set, const uint32_t set_id, const uint32_t sreg, const uint32_t dreg)
+{
+  struct nlattr                          *data = NULL;
+  struct nlattr                          *elem = pgw_nft_expr_start (nlh, "lookup", &data);
+
+  pgw_nft_put_str (nlh, NFTA_LOOKUP_SET, set);
+  pgw_nft_put_u32 (nlh, NFTA_LOOKUP_SET_ID, set_id);
+  pgw_nft_put_u32 (nlh, NFTA_LOOKUP_SREG, sreg);
+  pgw_nft_put_u32 (nlh, NFTA_LOOKUP_DREG, dreg);
+  pgw_nft_expr_end (nlh, elem, data);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_match (struct nlmsghdr *nlh, const uint32_t base, const uint32_t offset, const void * const value, const void * const mask, const uint16_t len)
+{
+  uint8_t                                 masked[4] = {0};
+  bool                                    full_mask = true;
+
+  AssertFatal (sizeof (masked) >= len, "Bad match length %u", len);
+  for (int i = 0; i < len; i++) {
+    masked[i] = ((const uint8_t *)value)[i] & ((const uint8_t *)mask)[i];
+    full_mask = full_mask && (0xFF == ((const uint8_t *)mask)[i]);
+  }
+  pgw_nft_put_expr_payload (nlh, base, offset, len, NFT_REG_1);
+  if (!full_mask) {
+    pgw_nft_put_expr_bitwise (nlh, NFT_REG_1, mask, len);
+  }
+  pgw_nft_put_expr_cmp (nlh, NFT_CMP_EQ, masked, len);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_port_match (struct nlmsghdr *nlh, const uint32_t offset, const uint16_t low, const uint16_t high)
+{
+  const uint16_t                          be_low = htons (low);
+  const uint16_t                          be_high = htons (high);
+
+  // ports are compared in network byte order, memcmp() order is numeric order
+  pgw_nft_put_expr_payload (nlh, NFT_PAYLOAD_TRANSPORT_HEADER, offset, sizeof (uint16_t), NFT_REG_1);
+  if (low == high) {
+    pgw_nft_put_expr_cmp (nlh, NFT_CMP_EQ, &be_low, sizeof (be_low));
+  } else {
+    pgw_nft_put_expr_cmp (nlh, NFT_CMP_GTE, &be_low, sizeof (be_low));
+    pgw_nft_put_expr_cmp (nlh, NFT_CMP_LTE, &be_high, sizeof (be_high));
+  }
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_table (const uint16_t type)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (type, (NFT_MSG_NEWTABLE == type) ? NLM_F_CREATE : 0);
+
+  pgw_nft_put_str (nlh, NFTA_TABLE_NAME, PGW_NFT_TABLE_NAME);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_chain (const char * const name, const char * const type, const uint32_t hooknum)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWCHAIN, NLM_F_CREATE);
+  struct nlattr                          *hook = NULL;
+
+  pgw_nft_put_str (nlh, NFTA_CHAIN_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_CHAIN_NAME, name);
+  hook = pgw_nft_nest_start (nlh, NFTA_CHAIN_HOOK);
+  pgw_nft_put_u32 (nlh, NFTA_HOOK_HOOKNUM, hooknum);
+  pgw_nft_put_u32 (nlh, NFTA_HOOK_PRIORITY, (uint32_t)PGW_NFT_PRIORITY_MANGLE);
+  pgw_nft_nest_end (nlh, hook);
+  pgw_nft_put_str (nlh, NFTA_CHAIN_TYPE, type);
+  pgw_nft_put_u32 (nlh, NFTA_CHAIN_POLICY, NF_ACCEPT);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_bearer_map (void)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWSET, NLM_F_CREATE);
+
+  pgw_nft_put_str (nlh, NFTA_SET_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_SET_NAME, PGW_NFT_BEARER_MAP_NAME);
+  pgw_nft_put_u32 (nlh, NFTA_SET_FLAGS, NFT_SET_MAP);
+  // ip daddr . meta mark
+  pgw_nft_put_u32 (nlh, NFTA_SET_KEY_TYPE, (PGW_NFT_TYPE_IPADDR << PGW_NFT_TYPE_BITS) | PGW_NFT_TYPE_MARK);
+  pgw_nft_put_u32 (nlh, NFTA_SET_KEY_LEN, 2 * sizeof (uint32_t));
+  pgw_nft_put_u32 (nlh, NFTA_SET_DATA_TYPE, PGW_NFT_TYPE_MARK);
+  pgw_nft_put_u32 (nlh, NFTA_SET_DATA_LEN, sizeof (uint32_t));
+  pgw_nft_put_u32 (nlh, NFTA_SET_ID, PGW_NFT_BEARER_MAP_ID);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_bearer_rule (void)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWRULE, NLM_F_CREATE | NLM_F_APPEND);
+  struct nlattr                          *exprs = NULL;
+
+  pgw_nft_put_str (nlh, NFTA_RULE_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_RULE_CHAIN, PGW_NFT_CHAIN_POSTROUTING);
+  exprs = pgw_nft_nest_start (nlh, NFTA_RULE_EXPRESSIONS);
+  pgw_nft_put_expr_meta (nlh, NFT_META_OIFNAME, NFT_REG_1);
+  pgw_nft_put_expr_cmp (nlh, NFT_CMP_EQ, pgw_nft.gtp_if_name, IFNAMSIZ);
+  // concatenated key: the map key spans two consecutive 32 bit registers
+  pgw_nft_put_expr_payload (nlh, NFT_PAYLOAD_NETWORK_HEADER, 16, sizeof (uint32_t), NFT_REG32_00);
+  pgw_nft_put_expr_meta (nlh, NFT_META_MARK, NFT_REG32_01);
+  pgw_nft_put_expr_lookup (nlh, PGW_NFT_BEARER_MAP_NAME, PGW_NFT_BEARER_MAP_ID, NFT_REG32_00, NFT_REG_1);
+  pgw_nft_put_expr_meta_set (nlh, NFT_META_MARK, NFT_REG_1);
+  pgw_nft_nest_end (nlh, exprs);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_bearer_elem (const uint16_t type, const struct in_addr ue_ip, const uint32_t sdf_mark, const uint32_t bearer_mark)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (type, (NFT_MSG_NEWSETELEM == type) ? NLM_F_CREATE : 0);
+  struct nlattr                          *elems = NULL;
+  struct nlattr                          *elem = NULL;
+  uint32_t                                key[2] = {ue_ip.s_addr, sdf_mark};
+
+  pgw_nft_put_str (nlh, NFTA_SET_ELEM_LIST_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_SET_ELEM_LIST_SET, PGW_NFT_BEARER_MAP_NAME);
+  elems = pgw_nft_nest_start (nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+  elem = pgw_nft_nest_start (nlh, NFTA_LIST_ELEM);
+  pgw_nft_put_data (nlh, NFTA_SET_ELEM_KEY, key, sizeof (key));
+  if (NFT_MSG_NEWSETELEM == type) {
+    pgw_nft_put_data (nlh, NFTA_SET_ELEM_DATA, &bearer_mark, sizeof (bearer_mark));
+  }
+  pgw_nft_nest_end (nlh, elem);
+  pgw_nft_nest_end (nlh, elems);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_sdf_key_slots (const pgw_sdf_key_t * const key, pgw_nft_sdf_slots_t slots)
+{
+  const uint32_t                          remote_addr = htonl (key->remote_addr);
+  const uint32_t                          spi = htonl (key->spi);
+  const uint16_t                          local_port = htons (key->local_port);
+  const uint16_t                          remote_port = htons (key->remote_port);
+
+  memset (slots, 0, sizeof (pgw_nft_sdf_slots_t));
+  memcpy (slots[PGW_NFT_SDF_REMOTE_ADDR], &remote_addr, sizeof (remote_addr));
+  slots[PGW_NFT_SDF_PROTOCOL][0] = key->protocol;
+  slots[PGW_NFT_SDF_TOS][0] = key->tos;
+  memcpy (slots[PGW_NFT_SDF_LOCAL_PORT], &local_port, sizeof (local_port));
+  memcpy (slots[PGW_NFT_SDF_REMOTE_PORT], &remote_port, sizeof (remote_port));
+  memcpy (slots[PGW_NFT_SDF_SPI], &spi, sizeof (spi));
+}
+
+//------------------------------------------------------------------------------
+static inline bool pgw_nft_sdf_field_used (const pgw_nft_sdf_slots_t mask, const pgw_nft_sdf_field_t field)
+{
+  uint32_t                                bits = 0;
+
+  memcpy (&bits, mask[field], sizeof (bits));
+  return (0 != bits);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_put_ue_net_match (struct nlmsghdr *nlh, const struct in_addr ue_net, const uint8_t ue_netmask)
+{
+  if (ue_netmask) {
+    const uint32_t                        mask = htonl (0xFFFFFFFF << (32 - ue_netmask));
+
+    pgw_nft_put_match (nlh, NFT_PAYLOAD_NETWORK_HEADER, 16, &ue_net.s_addr, &mask, sizeof (mask));
+  }
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_sdf_map (const char * const set, const uint32_t set_id, const uint32_t key_type, const uint32_t key_len)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWSET, NLM_F_CREATE);
+
+  pgw_nft_put_str (nlh, NFTA_SET_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_SET_NAME, set);
+  pgw_nft_put_u32 (nlh, NFTA_SET_FLAGS, NFT_SET_MAP);
+  pgw_nft_put_u32 (nlh, NFTA_SET_KEY_TYPE, key_type);
+  pgw_nft_put_u32 (nlh, NFTA_SET_KEY_LEN, key_len);
+  pgw_nft_put_u32 (nlh, NFTA_SET_DATA_TYPE, PGW_NFT_TYPE_MARK);
+  pgw_nft_put_u32 (nlh, NFTA_SET_DATA_LEN, sizeof (uint32_t));
+  pgw_nft_put_u32 (nlh, NFTA_SET_ID, set_id);
+  pgw_nft_msg_end (nlh);
+}
+
+// Entries sorted by key value: a key held by several filters maps to the first one added
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_sdf_elems (const char * const set, const pgw_nft_sdf_entry_t * const entries, const uint32_t nb)
+{
+  struct nlmsghdr                        *nlh = NULL;
+  struct nlattr                          *elems = NULL;
+  pgw_nft_sdf_slots_t                     mask;
+
+  pgw_nft_sdf_key_slots (&entries[0].tuple->mask, mask);
+  for (uint32_t i = 0; i < nb; i++) {
+    const pgw_sdf_rule_t                 *rule = entries[i].rule;
+    struct nlattr                        *elem = NULL;
+    pgw_nft_sdf_slots_t                   value;
+    uint8_t                               key[sizeof (pgw_nft_sdf_slots_t)];
+    uint16_t                              key_len = 0;
+
+    if ((i) && (!memcmp (&rule->value, &entries[i - 1].rule->value, sizeof (rule->value)))) {
+      continue;
+    }
+    if ((nlh) && (nlh->nlmsg_len + PGW_NFT_SDF_ELEM_SIZE_MAX > PGW_NFT_MSG_SIZE_MAX)) {
+      pgw_nft_nest_end (nlh, elems);
+      pgw_nft_msg_end (nlh);
+      nlh = NULL;
+    }
+    if (!nlh) {
+      nlh = pgw_nft_msg_start (NFT_MSG_NEWSETELEM, NLM_F_CREATE);
+      pgw_nft_put_str (nlh, NFTA_SET_ELEM_LIST_TABLE, PGW_NFT_TABLE_NAME);
+      pgw_nft_put_str (nlh, NFTA_SET_ELEM_LIST_SET, set);
+      elems = pgw_nft_nest_start (nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+    }
+    pgw_nft_sdf_key_slots (&rule->value, value);
+    for (int f = 0; f < PGW_NFT_SDF_FIELDS; f++) {
+      if (pgw_nft_sdf_field_used (mask, f)) {
+        memcpy (&key[key_len], value[f], sizeof (uint32_t));
+        key_len += sizeof (uint32_t);
+      }
+    }
+    elem = pgw_nft_nest_start (nlh, NFTA_LIST_ELEM);
+    pgw_nft_put_data (nlh, NFTA_SET_ELEM_KEY, key, key_len);
+    pgw_nft_put_data (nlh, NFTA_SET_ELEM_DATA, &rule->sdf_id, sizeof (rule->sdf_id));
+    pgw_nft_nest_end (nlh, elem);
+  }
+  if (nlh) {
+    pgw_nft_nest_end (nlh, elems);
+    pgw_nft_msg_end (nlh);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_sdf_map_rule (const char * const chain, const char * const set, const uint32_t set_id, const pgw_sdf_tuple_t * const tuple,
+                                        const struct in_addr ue_net, const uint8_t ue_netmask)
+{
+  // inserted at the head of the chain, before the bearer marking
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWRULE, NLM_F_CREATE);
+  struct nlattr                          *exprs = NULL;
+  pgw_nft_sdf_slots_t                     mask;
+  uint32_t                                reg = NFT_REG32_00;
+
+  pgw_nft_sdf_key_slots (&tuple->mask, mask);
+  pgw_nft_put_str (nlh, NFTA_RULE_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_RULE_CHAIN, chain);
+  exprs = pgw_nft_nest_start (nlh, NFTA_RULE_EXPRESSIONS);
+  pgw_nft_put_ue_net_match (nlh, ue_net, ue_netmask);
+  // concatenated key, a field per register
+  for (int f = 0; f < PGW_NFT_SDF_FIELDS; f++) {
+    const uint32_t                        full_mask = 0xFFFFFFFF;
+
+    if (!pgw_nft_sdf_field_used (mask, f)) {
+      continue;
+    }
+    pgw_nft_put_expr_payload (nlh, pgw_nft_sdf_fields[f].base, pgw_nft_sdf_fields[f].offset, pgw_nft_sdf_fields[f].len, reg);
+    if (memcmp (mask[f], &full_mask, pgw_nft_sdf_fields[f].len)) {
+      pgw_nft_put_expr_bitwise (nlh, reg, mask[f], pgw_nft_sdf_fields[f].len);
+    }
+    reg++;
+  }
+  pgw_nft_put_expr_lookup (nlh, set, set_id, NFT_REG32_00, NFT_REG_1);
+  pgw_nft_put_expr_meta_set (nlh, NFT_META_MARK, NFT_REG_1);
+  pgw_nft_nest_end (nlh, exprs);
+  pgw_nft_msg_end (nlh);
+}
+
+// For the filters that do not fit in a map: port ranges, or no field at all
+//------------------------------------------------------------------------------
+static void pgw_nft_queue_sdf_filter_rule (const char * const chain, const pgw_sdf_tuple_t * const tuple, const pgw_sdf_rule_t * const rule,
+                                           const struct in_addr ue_net, const uint8_t ue_netmask)
+{
+  struct nlmsghdr                        *nlh = pgw_nft_msg_start (NFT_MSG_NEWRULE, NLM_F_CREATE);
+  struct nlattr                          *exprs = NULL;
+  pgw_nft_sdf_slots_t                     mask;
+  pgw_nft_sdf_slots_t                     value;
+
+  pgw_nft_sdf_key_slots (&tuple->mask, mask);
+  pgw_nft_sdf_key_slots (&rule->value, value);
+  pgw_nft_put_str (nlh, NFTA_RULE_TABLE, PGW_NFT_TABLE_NAME);
+  pgw_nft_put_str (nlh, NFTA_RULE_CHAIN, chain);
+  exprs = pgw_nft_nest_start (nlh, NFTA_RULE_EXPRESSIONS);
+  pgw_nft_put_ue_net_match (nlh, ue_net, ue_netmask);
+  for (int f = 0; f < PGW_NFT_SDF_FIELDS; f++) {
+    if (pgw_nft_sdf_field_used (mask, f)) {
+      pgw_nft_put_match (nlh, pgw_nft_sdf_fields[f].base, pgw_nft_sdf_fields[f].offset, value[f], mask[f], pgw_nft_sdf_fields[f].len);
+    }
+  }
+  if (tuple->local_port_range) {
+    pgw_nft_put_port_match (nlh, pgw_nft_sdf_fields[PGW_NFT_SDF_LOCAL_PORT].offset, rule->local_port_low, rule->local_port_high);
+  }
+  if (tuple->remote_port_range) {
+    pgw_nft_put_port_match (nlh, pgw_nft_sdf_fields[PGW_NFT_SDF_REMOTE_PORT].offset, rule->remote_port_low, rule->remote_port_high);
+  }
+  pgw_nft_put_expr_immediate (nlh, rule->sdf_id);
+  pgw_nft_put_expr_meta_set (nlh, NFT_META_MARK, NFT_REG_1);
+  pgw_nft_nest_end (nlh, exprs);
+  pgw_nft_msg_end (nlh);
+}
+
+//------------------------------------------------------------------------------
+static void pgw_nft_sdf_collect (const pgw_sdf_tuple_t * const tuple, const pgw_sdf_rule_t * const rule, void *arg)
+{
+  pgw_nft_sdf_entries_t                  *list = (pgw_nft_sdf_entries_t *)arg;
+
+  if ((TRAFFIC_FLOW_TEMPLATE_PRE_REL7_TFT_FILTER != rule->direction) && (!(TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY & rule->direction))) {
+    return;
+  }
+  if (list->nb == list->max) {
+    const uint32_t                        max = (list->max) ? 2 * list->max : 64;
+    pgw_nft_sdf_entry_t                  *entries = realloc (list->entries, max * sizeof (pgw_nft_sdf_entry_t));
+
+    if (!entries) {
+      list->failed = true;
+      return;
+    }
+    list->entries = entries;
+    list->max = max;
+  }
+  list->entries[list->nb].tuple = tuple;
+  list->entries[list->nb].rule = rule;
+  list->nb += 1;
+}
+
+// By tuple, precedence, key value, then in the order the filters were added
+//------------------------------------------------------------------------------
+static int pgw_nft_sdf_entry_cmp (const void *a, const void *b)
+{
+  const pgw_nft_sdf_entry_t              *e1 = (const pgw_nft_sdf_entry_t *)a;
+  const pgw_nft_sdf_entry_t              *e2 = (const pgw_nft_sdf_entry_t *)b;
+  int                                     rc = 0;
+
+  if (e1->tuple != e2->tuple) {
+    return ((uintptr_t)e1->tuple < (uintptr_t)e2->tuple) ? -1 : 1;
+  }
+  if (e1->rule->precedence != e2->rule->precedence) {
+    return (e1->rule->precedence < e2->rule->precedence) ? -1 : 1;
+  }
+  // masked keys have their padding cleared
+  if ((rc = memcmp (&e1->rule->value, &e2->rule->value, sizeof (e1->rule->value)))) {
+    return rc;
+  }
+  return (e1->rule->seq < e2->rule->seq) ? -1 : (e1->rule->seq > e2->rule->seq);
+}
+
+//------------------------------------------------------------------------------
+static int pgw_nft_sdf_group_cmp (const void *a, const void *b)
+{
+  const pgw_nft_sdf_group_t              *g1 = (const pgw_nft_sdf_group_t *)a;
+  const pgw_nft_sdf_group_t              *g2 = (const pgw_nft_sdf_group_t *)b;
+
+  return (g1->rank < g2->rank) ? -1 : (g1->rank > g2->rank);
+}
+
+//------------------------------------------------------------------------------
+static inline bool pgw_nft_sdf_tuple_in_map (const pgw_sdf_tuple_t * const tuple)
+{
+  const pgw_sdf_key_t                     no_field = {0};
+
+  return (!tuple->local_port_range) && (!tuple->remote_port_range) && (memcmp (&tuple->mask, &no_field, sizeof (no_field)));
+}
+
+//------------------------------------------------------------------------------
+static pgw_nft_batch_t *pgw_nft_open_batch (void)
+{
+  pgw_nft_batch_t                        *batch = NULL;
+  struct sockaddr_nl                      addr = {.nl_family = AF_NETLINK};
+  int                                     on = 1;
+  int                                     rcvbuf = PGW_NFT_RCV_BUFFER_SIZE;
+
+  if ((!(batch = calloc (1, sizeof (pgw_nft_batch_t)))) || (!(batch->batch = calloc (1, PGW_NFT_BATCH_SIZE)))) {
+    OAILOG_ERROR (LOG_SPGW_APP, "Cannot allocate nf_tables batch\n");
+    free (batch);
+    return NULL;
+  }
+  batch->fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+  if (0 > batch->fd) {
+    OAILOG_ERROR (LOG_SPGW_APP, "Cannot open netfilter netlink socket: %s\n", strerror (errno));
+    goto fail;
+  }
+  if (0 > bind (batch->fd, (struct sockaddr *)&addr, sizeof (addr))) {
+    OAILOG_ERROR (LOG_SPGW_APP, "Cannot bind netfilter netlink socket: %s\n", strerror (errno));
+    goto fail;
+  }
+  // errors do not need to carry the rejected message
+  setsockopt (batch->fd, SOL_NETLINK, NETLINK_CAP_ACK, &on, sizeof (on));
+  if (0 > setsockopt (batch->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof (rcvbuf))) {
+    setsockopt (batch->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+  }
+  pthread_mutex_lock (&pgw_nft.lock);
+  if (PGW_NFT_BATCHES_MAX == pgw_nft.nb_batches) {
+    pthread_mutex_unlock (&pgw_nft.lock);
+    OAILOG_ERROR (LOG_SPGW_APP, "More than %u threads change nf_tables\n", PGW_NFT_BATCHES_MAX);
+    goto fail;
+  }
+  pgw_nft.batches[pgw_nft.nb_batches++] = batch;
+  pthread_mutex_unlock (&pgw_nft.lock);
+  return batch;
+fail:
+  if (0 <= batch->fd) {
+    close (batch->fd);
+  }
+  free (batch->batch);
+  free (batch);
+  return NULL;
+}
+
+// Batch of the calling thread, opened on its first change
+//------------------------------------------------------------------------------
+static pgw_nft_batch_t *pgw_nft_get_batch (void)
+{
+  if (!pgw_nft.generation) {
+    return NULL;
+  }
+  if (pgw_nft_batch_generation != pgw_nft.generation) {
+    pgw_nft_batch = pgw_nft_open_batch ();
+    pgw_nft_batch_generation = (pgw_nft_batch) ? pgw_nft.generation : 0;
+  }
+  return pgw_nft_batch;
+}
+
+//------------------------------------------------------------------------------
+int pgw_nft_init (const char * const gtp_if_name)
+{
+  static uint32_t                         generation = 0;
+
+  memset (pgw_nft.gtp_if_name, 0, sizeof (pgw_nft.gtp_if_name));
+  strncpy (pgw_nft.gtp_if_name, gtp_if_name, IFNAMSIZ - 1);
+  pgw_nft.generation = ++generation;
+  if (!pgw_nft_get_batch ()) {
+    pgw_nft.generation = 0;
+    return RETURNerror;
+  }
+
+  // drop the rules left by a previous run: create the table if needed, delete it, create it again
+  pgw_nft_queue_table (NFT_MSG_NEWTABLE);
+  pgw_nft_queue_table (NFT_MSG_DELTABLE);
+  pgw_nft_queue_table (NFT_MSG_NEWTABLE);
+  pgw_nft_queue_chain (PGW_NFT_CHAIN_POSTROUTING, "filter", NF_INET_POST_ROUTING);
+  pgw_nft_queue_chain (PGW_NFT_CHAIN_OUTPUT, "route", NF_INET_LOCAL_OUT);
+  pgw_nft_queue_bearer_map ();
+  pgw_nft_queue_bearer_rule ();
+  if (RETURNok != pgw_nft_commit ()) {
+    OAILOG_ERROR (LOG_SPGW_APP, "Cannot create nf_tables table %s\n", PGW_NFT_TABLE_NAME);
+    pgw_nft_exit ();
+    return RETURNerror;
+  }
+  OAILOG_DEBUG (LOG_SPGW_APP, "Created nf_tables table %s for packet marking\n", PGW_NFT_TABLE_NAME);
+  return RETURNok;
+}
+
+// Called once the other threads stopped making changes
+//------------------------------------------------------------------------------
+void pgw_nft_exit (void)
+{
+  if (!pgw_nft_get_batch ()) {
+    return;
+  }
+  pgw_nft_batch->batch_len = 0;
+  pgw_nft_batch->nb_msg = 0;
+  pgw_nft_queue_table (NFT_MSG_DELTABLE);
+  pgw_nft_send_batch ();
+  pgw_nft.generation = 0;
+  for (uint32_t i = 0; i < pgw_nft.nb_batches; i++) {
+    close (pgw_nft.batches[i]->fd);
+    free_wrapper ((void**)&pgw_nft.batches[i]->batch);
+    free_wrapper ((void**)&pgw_nft.batches[i]);
+  }
+  pgw_nft.nb_batches = 0;
+  pgw_nft_batch = NULL;
+  pgw_nft_batch_generation = 0;
+}
+
+//------------------------------------------------------------------------------
+int pgw_nft_add_bearer_mark (const struct in_addr ue_ip, const uint32_t sdf_mark, const uint32_t bearer_mark)
+{
+  if (!pgw_nft_get_batch ()) {
+    return RETURNerror;
+  }
+  pgw_nft_queue_bearer_elem (NFT_MSG_NEWSETELEM, ue_ip, sdf_mark, bearer_mark);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+int pgw_nft_del_bearer_mark (const struct in_addr ue_ip, const uint32_t sdf_mark)
+{
+  if (!pgw_nft_get_batch ()) {
+    return RETURNerror;
+  }
+  pgw_nft_queue_bearer_elem (NFT_MSG_DELSETELEM, ue_ip, sdf_mark, 0);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+int pgw_nft_add_sdf_classifier (pgw_sdf_classifier_t * const classifier, const struct in_addr ue_net, const uint8_t ue_netmask)
+{
+  pgw_nft_sdf_entries_t                   list = {0};
+  pgw_nft_sdf_group_t                    *groups = NULL;
+  uint32_t                                nb_groups = 0;
+
+  if (!pgw_nft_get_batch ()) {
+    return RETURNerror;
+  }
+  pgw_sdf_classifier_walk (classifier, pgw_nft_sdf_collect, &list);
+  if ((list.failed) || ((list.nb) && (!(groups = calloc (list.nb, sizeof (pgw_nft_sdf_group_t)))))) {
+    free (list.entries);
+    return RETURNerror;
+  }
+  qsort (list.entries, list.nb, sizeof (pgw_nft_sdf_entry_t), pgw_nft_sdf_entry_cmp);
+  for (uint32_t i = 0; i < list.nb; i++) {
+    const pgw_nft_sdf_entry_t            *entry = &list.entries[i];
+    const uint64_t                        rank = ((uint64_t)entry->rule->precedence << 32) | entry->rule->seq;
+    pgw_nft_sdf_group_t                  *group = (nb_groups) ? &groups[nb_groups - 1] : NULL;
+
+    if ((!group) || (!pgw_nft_sdf_tuple_in_map (entry->tuple)) || (list.entries[group->first].tuple != entry->tuple) ||
+        (list.entries[group->first].rule->precedence != entry->rule->precedence)) {
+      group = &groups[nb_groups++];
+      group->first = i;
+      group->rank = rank;
+    }
+    group->nb += 1;
+    group->rank = (rank < group->rank) ? rank : group->rank;
+  }
+  // best first, each rule is inserted in front of the previous ones
+  qsort (groups, nb_groups, sizeof (pgw_nft_sdf_group_t), pgw_nft_sdf_group_cmp);
+
+  for (uint32_t g = 0; g < nb_groups; g++) {
+    const pgw_nft_sdf_entry_t            *entries = &list.entries[groups[g].first];
+    const pgw_sdf_tuple_t                *tuple = entries[0].tuple;
+
+    if (pgw_nft_sdf_tuple_in_map (tuple)) {
+      const uint32_t                      set_id = PGW_NFT_SDF_MAP_ID_FIRST + g;
+      char                                set[NFT_SET_MAXNAMELEN];
+      pgw_nft_sdf_slots_t                 mask;
+      uint32_t                            key_type = 0;
+      uint32_t                            key_len = 0;
+
+      snprintf (set, sizeof (set), PGW_NFT_SDF_MAP_NAME_FMT, g);
+      pgw_nft_sdf_key_slots (&tuple->mask, mask);
+      for (int f = 0; f < PGW_NFT_SDF_FIELDS; f++) {
+        if (pgw_nft_sdf_field_used (mask, f)) {
+          key_type = (key_type << PGW_NFT_TYPE_BITS) | pgw_nft_sdf_fields[f].type;
+          key_len += sizeof (uint32_t);
+        }
+      }
+      pgw_nft_queue_sdf_map (set, set_id, key_type, key_len);
+      pgw_nft_queue_sdf_elems (set, entries, groups[g].nb);
+      pgw_nft_queue_sdf_map_rule (PGW_NFT_CHAIN_POSTROUTING, set, set_id, tuple, ue_net, ue_netmask);
+      // for UE <-> PGW traffic
+      pgw_nft_queue_sdf_map_rule (PGW_NFT_CHAIN_OUTPUT, set, set_id, tuple, ue_net, ue_netmask);
+    } else {
+      pgw_nft_queue_sdf_filter_rule (PGW_NFT_CHAIN_POSTROUTING, tuple, entries[0].rule, ue_net, ue_netmask);
+      pgw_nft_queue_sdf_filter_rule (PGW_NFT_CHAIN_OUTPUT, tuple, entries[0].rule, ue_net, ue_netmask);
+    }
+  }
+  OAILOG_DEBUG (LOG_SPGW_APP, "%u downlink SDF filters marked by %u nf_tables rules\n", list.nb, nb_groups);
+  free (groups);
+  free (list.entries);
+  return RETURNok;
+}
+//------------------------------------------------------------------------------
+static void pgw_nft_batch_marker (struct nlmsghdr *nlh, const uint16_t type)
+{
+  struct nfgenmsg                        *nfg = (struct nfgenmsg *)NLMSG_DATA (nlh);
+
+  memset (nlh, 0, NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg)));
+  nlh->nlmsg_len = NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg));
+  nlh->nlmsg_type = type;
+  nlh->nlmsg_flags = NLM_F_REQUEST;
+  nlh->nlmsg_seq = ++pgw_nft_batch->seq;
+  nfg->nfgen_family = AF_UNSPEC;
+  nfg->version = NFNETLINK_V0;
+  nfg->res_id = htons (NFNL_SUBSYS_NFTABLES);
+}
+
+/*
+ * Sends the queued messages in one batch. The kernel processes the batch in
+ * the context of sendmsg() and only reports errors (no NLM_F_ACK), so all the
+ * errors of the transaction are already queued on the socket when sendmsg()
+ * returns. Returns the number of rejected messages, -1 if the batch itself
+ * failed. The seq of the rejected messages are left in failed_seq[].
+ */
+//------------------------------------------------------------------------------
+static int pgw_nft_send_batch (void)
+{
+  uint8_t                                 begin[NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg))];
+  uint8_t                                 end[NLMSG_HDRLEN + NLMSG_ALIGN (sizeof (struct nfgenmsg))];
+  uint8_t                                 rcv[8192];
+  struct sockaddr_nl                      kernel = {.nl_family = AF_NETLINK};
+  struct iovec                            iov[3];
+  struct msghdr                           msg = {.msg_name = &kernel, .msg_namelen = sizeof (kernel), .msg_iov = iov, .msg_iovlen = 3};
+  uint32_t                                begin_seq = 0;
+  int                                     rc = 0;
+
+  pgw_nft_batch->nb_failed = 0;
+  pgw_nft_batch_marker ((struct nlmsghdr *)begin, NFNL_MSG_BATCH_BEGIN);
+  begin_seq = ((struct nlmsghdr *)begin)->nlmsg_seq;
+  for (size_t offset = 0; offset < pgw_nft_batch->batch_len; offset += NLMSG_ALIGN (((struct nlmsghdr *)&pgw_nft_batch->batch[offset])->nlmsg_len)) {
+    ((struct nlmsghdr *)&pgw_nft_batch->batch[offset])->nlmsg_seq = ++pgw_nft_batch->seq;
+  }
+  pgw_nft_batch_marker ((struct nlmsghdr *)end, NFNL_MSG_BATCH_END);
+  iov[0].iov_base = begin;
+  iov[0].iov_len = sizeof (begin);
+  iov[1].iov_base = pgw_nft_batch->batch;
+  iov[1].iov_len = pgw_nft_batch->batch_len;
+  iov[2].iov_base = end;
+  iov[2].iov_len = sizeof (end);
+  if (0 > sendmsg (pgw_nft_batch->fd, &msg, 0)) {
+    OAILOG_ERROR (LOG_SPGW_APP, "Cannot send nf_tables batch: %s\n", strerror (errno));
+    return -1;
+  }
+
+  while (true) {
+    ssize_t                               len = recv (pgw_nft_batch->fd, rcv, sizeof (rcv), MSG_DONTWAIT);
+
+    if (0 > len) {
+      if (EINTR == errno) {
+        continue;
+      }
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+        OAILOG_ERROR (LOG_SPGW_APP, "Cannot receive nf_tables batch status: %s\n", strerror (errno));
+        rc = -1;
+      }
+      break;
+    }
+    for (struct nlmsghdr *nlh = (struct nlmsghdr *)rcv; NLMSG_OK (nlh, len); nlh = NLMSG_NEXT (nlh, len)) {
+      if (NLMSG_ERROR == nlh->nlmsg_type) {
+        const struct nlmsgerr            *err = (const struct nlmsgerr *)NLMSG_DATA (nlh);
+
+        if (0 == err->error) {
+          continue;
+        }
+        if ((begin_seq < nlh->nlmsg_seq) && (begin_seq + pgw_nft_batch->nb_msg >= nlh->nlmsg_seq) && (0 <= rc) && (PGW_NFT_BATCH_MSG_MAX > pgw_nft_batch->nb_failed)) {
+          OAILOG_DEBUG (LOG_SPGW_APP, "nf_tables message %u rejected: %s\n", nlh->nlmsg_seq, strerror (-err->error));
+          pgw_nft_batch->failed_seq[pgw_nft_batch->nb_failed++] = nlh->nlmsg_seq;
+          rc += 1;
+        } else {
+          OAILOG_ERROR (LOG_SPGW_APP, "nf_tables batch rejected: %s\n", strerror (-err->error));
+          rc = -1;
+        }
+      }
+    }
+  }
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+int pgw_nft_commit (void)
+{
+  int                                     rc = 0;
+  uint32_t                                nb_failed = 0;
+
+  // nothing queued by this thread
+  if ((!pgw_nft.generation) || (pgw_nft_batch_generation != pgw_nft.generation) || (0 == pgw_nft_batch->nb_msg)) {
+    return RETURNok;
+  }
+  rc = pgw_nft_send_batch ();
+  if (0 < rc) {
+    /*
+     * The kernel aborted the whole transaction. Typically a bearer released
+     * twice, drop the rejected messages and replay the others.
+     */
+    size_t                                len = 0;
+    uint32_t                              failed_i = 0;
+    uint32_t                              nb_msg = 0;
+
+    for (size_t offset = 0; offset < pgw_nft_batch->batch_len;) {
+      struct nlmsghdr                    *nlh = (struct nlmsghdr *)&pgw_nft_batch->batch[offset];
+      const size_t                        msg_len = NLMSG_ALIGN (nlh->nlmsg_len);
+
+      offset += msg_len;
+      if ((failed_i < pgw_nft_batch->nb_failed) && (pgw_nft_batch->failed_seq[failed_i] == nlh->nlmsg_seq)) {
+        failed_i += 1;
+        continue;
+      }
+      memmove (&pgw_nft_batch->batch[len], nlh, msg_len);
+      len += msg_len;
+      nb_msg += 1;
+    }
+    OAILOG_WARNING (LOG_SPGW_APP, "%u nf_tables changes rejected, %u applied\n", pgw_nft_batch->nb_failed, nb_msg);
+    nb_failed = pgw_nft_batch->nb_failed;
+    pgw_nft_batch->batch_len = len;
+    pgw_nft_batch->nb_msg = nb_msg;
+    rc = (nb_msg) ? pgw_nft_send_batch () : 0;
+  }
+  if (rc) {
+    OAILOG_ERROR (LOG_SPGW_APP, "nf_tables transaction of %u changes failed\n", pgw_nft_batch->nb_msg);
+    nb_failed += pgw_nft_batch->nb_msg;
+  }
+  pgw_nft_batch->batch_len = 0;
+  pgw_nft_batch->nb_msg = 0;
+  return (nb_failed) ? RETURNerror : RETURNok;
+}
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file pgw_nft.h
+* \brief Packet marking rules programmed in nf_tables over netlink
+* \author
+* \company
+* \email:
+*/
+
+#ifndef FILE_PGW_NFT_SEEN
+#define FILE_PGW_NFT_SEEN
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include "3gpp_24.008.h"
+#include "pgw_sdf_classifier.h"
+
+#define PGW_NFT_TABLE_NAME               "oai_pgw"
+
+/*
+ * Changes are queued and sent to the kernel in one nf_tables transaction by
+ * pgw_nft_commit(). Each thread queues in its own batch, a commit only sends
+ * the changes of the calling thread.
+ */
+int  pgw_nft_init (const char * const gtp_if_name);
+void pgw_nft_exit (void);
+
+// Bearer marking: packets sent on the GTP device to ue_ip with mark sdf_mark get mark bearer_mark
+int  pgw_nft_add_bearer_mark (const struct in_addr ue_ip, const uint32_t sdf_mark, const uint32_t bearer_mark);
+int  pgw_nft_del_bearer_mark (const struct in_addr ue_ip, const uint32_t sdf_mark);
+
+/*
+ * SDF marking: downlink packets towards the UE network get the SDF identifier
+ * the classifier would give them as mark. Called once, when the classifier
+ * holds the filters of all the activated PCC rules; the classifier must not
+ * change meanwhile.
+ */
+int  pgw_nft_add_sdf_classifier (pgw_sdf_classifier_t * const classifier, const struct in_addr ue_net, const uint8_t ue_netmask);
+
+int  pgw_nft_commit (void);
+
+#endif /* FILE_PGW_NFT_SEEN */
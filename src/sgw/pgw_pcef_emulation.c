@@ -51,7 +51,7 @@
 #include "sgw_context_manager.h"
 #include "pgw_procedures.h"
 #include "sgw.h"
-#include "async_system.h"
+#include "pgw_nft.h"
 
 extern pgw_app_t                        pgw_app;
 
@@ -67,7 +67,9 @@ int pgw_pcef_emulation_init (const pgw_config_t * const pgw_config_p)
   // Predefined PCC rules
   //--------------------------
   pgw_app.deactivated_predefined_pcc_rules = hashtable_ts_create (32, NULL, free_pcc_rule, NULL);
-
+  if (RETURNok != pgw_sdf_classifier_init (&pgw_app.sdf_classifier)) {
+    return RETURNerror;
+  }
 
   pcc_rule_t * pcc_rule = calloc (1, sizeof (pcc_rule_t));
   pcc_rule->name = bfromcstr("VOLTE_40K_PCC_RULE");
@@ -240,6 +242,12 @@ int pgw_pcef_emulation_init (const pgw_config_t * const pgw_config_p)
     pgw_pcef_emulation_apply_rule(pgw_config_p->pcef.automatic_push_dedicated_bearer_sdf_identifier, pgw_config_p);
   }
 
+#if ENABLE_SDF_MARKING
+  if ((RETURNok != pgw_nft_add_sdf_classifier (&pgw_app.sdf_classifier, pgw_config_p->ue_pool_addr[0], pgw_config_p->ue_pool_mask[0]))
+      || (RETURNok != pgw_nft_commit ())) {
+    rc = RETURNerror;
+  }
+#endif
   return rc;
 }
 
@@ -249,6 +257,7 @@ void pgw_pcef_emulation_exit (void)
   if (pgw_app.deactivated_predefined_pcc_rules) {
     hashtable_ts_destroy (pgw_app.deactivated_predefined_pcc_rules);
   }
+  pgw_sdf_classifier_destroy (&pgw_app.sdf_classifier);
 }
 
 //------------------------------------------------------------------------------
@@ -272,98 +281,10 @@ void pgw_pcef_emulation_apply_rule(const sdf_id_t sdf_id, const pgw_config_t * c
 //------------------------------------------------------------------------------
 void pgw_pcef_emulation_apply_sdf_filter(sdf_filter_t   * const sdf_f, const sdf_id_t sdf_id, const pgw_config_t * const pgw_config_p)
 {
-  if ((TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL == sdf_f->direction)  || (TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY == sdf_f->direction)) {
-    bstring filter = pgw_pcef_emulation_packet_filter_2_iptable_string(&sdf_f->packetfiltercontents, sdf_f->direction);
-
-    bstring marking_command = NULL;
-    if ((TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG | TRAFFIC_FLOW_TEMPLATE_IPV6_REMOTE_ADDR_FLAG) & sdf_f->packetfiltercontents.flags) {
-      marking_command = bformat("iptables -I POSTROUTING -t mangle  %s -j MARK --set-mark %d",  bdata(filter), sdf_id);
-    } else {
-      //marking_command = bformat("iptables -I PREROUTING -t mangle --in-interface %s --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8" %s -j MARK --set-mark %d",
-      marking_command = bformat("iptables -I POSTROUTING -t mangle  --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8" %s -j MARK --set-mark %d",
-          NIPADDR(pgw_config_p->ue_pool_addr[0].s_addr),
-          pgw_config_p->ue_pool_mask[0], bdata(filter), sdf_id);
-    }
-    bdestroy_wrapper(&filter);
-    async_system_command (TASK_ASYNC_SYSTEM, false, bdata(marking_command));
-    bdestroy_wrapper(&marking_command);
-
-    // for UE <-> PGW traffic
-    filter = pgw_pcef_emulation_packet_filter_2_iptable_string(&sdf_f->packetfiltercontents, sdf_f->direction);
-
-    marking_command = NULL;
-    if ((TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG | TRAFFIC_FLOW_TEMPLATE_IPV6_REMOTE_ADDR_FLAG) & sdf_f->packetfiltercontents.flags) {
-      marking_command = bformat("iptables -I OUTPUT -t mangle  %s -j MARK --set-mark %d",  bdata(filter), sdf_id);
-    } else {
-      marking_command = bformat("iptables -I OUTPUT -t mangle  --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8" %s -j MARK --set-mark %d",
-          NIPADDR(pgw_config_p->ue_pool_addr[0].s_addr),
-          pgw_config_p->ue_pool_mask[0], bdata(filter), sdf_id);
-    }
-    bdestroy_wrapper(&filter);
-    async_system_command (TASK_ASYNC_SYSTEM, false, bdata(marking_command));
-    bdestroy_wrapper(&marking_command);
-
-
-  }
-}
-
-//------------------------------------------------------------------------------
-bstring pgw_pcef_emulation_packet_filter_2_iptable_string(packet_filter_contents_t * const packetfiltercontents, uint8_t direction)
-{
-  bstring bstr = bfromcstralloc(64, " ");
-
-  if ((TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY == direction) || (TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL == direction)){
-    if (TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG & packetfiltercontents->flags) {
-      bformata(bstr, "  --destination %d.%d.%d.%d/%d.%d.%d.%d",
-        packetfiltercontents->ipv4remoteaddr[0].addr, packetfiltercontents->ipv4remoteaddr[1].addr,
-        packetfiltercontents->ipv4remoteaddr[2].addr, packetfiltercontents->ipv4remoteaddr[3].addr,
-        packetfiltercontents->ipv4remoteaddr[0].mask, packetfiltercontents->ipv4remoteaddr[1].mask,
-        packetfiltercontents->ipv4remoteaddr[2].mask, packetfiltercontents->ipv4remoteaddr[3].mask);
-    } else {
-      bformata(bstr, " --source %d.%d.%d.%d/%d.%d.%d.%d",
-        packetfiltercontents->ipv4remoteaddr[0].addr, packetfiltercontents->ipv4remoteaddr[1].addr,
-        packetfiltercontents->ipv4remoteaddr[2].addr, packetfiltercontents->ipv4remoteaddr[3].addr,
-        packetfiltercontents->ipv4remoteaddr[0].mask, packetfiltercontents->ipv4remoteaddr[1].mask,
-        packetfiltercontents->ipv4remoteaddr[2].mask, packetfiltercontents->ipv4remoteaddr[3].mask);
-    }
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_IPV6_REMOTE_ADDR_FLAG & packetfiltercontents->flags) {
-    AssertFatal(0, "TODO"); // we have time
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG & packetfiltercontents->flags) {
-    bformata(bstr, " --protocol %u", packetfiltercontents->protocolidentifier_nextheader);
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_LOCAL_PORT_FLAG & packetfiltercontents->flags) {
-    if ((TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY == direction) || (TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL == direction)){
-      bformata(bstr, " --destination-port %" PRIu16" ", packetfiltercontents->singlelocalport);
-    } else if (TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY == direction) {
-      bformata(bstr, " --source-port %" PRIu16" ", packetfiltercontents->singlelocalport);
-    }
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG & packetfiltercontents->flags) {
-    AssertFatal(0, "TODO LOCAL_PORT_RANGE");
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG & packetfiltercontents->flags) {
-    if ((TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY == direction) || (TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL == direction)){
-      bformata(bstr, " --source-port %" PRIu16" ", packetfiltercontents->singleremoteport);
-    } else if (TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY == direction) {
-      bformata(bstr, " --destination-port %" PRIu16" ", packetfiltercontents->singleremoteport);
-    }
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_REMOTE_PORT_RANGE_FLAG & packetfiltercontents->flags) {
-    AssertFatal(0, "TODO REMOTE_PORT_RANGE");
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_SECURITY_PARAMETER_INDEX_FLAG & packetfiltercontents->flags) {
-    bformata(bstr, " -m esp --espspi %" PRIu32" ", packetfiltercontents->securityparameterindex);
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG & packetfiltercontents->flags) {
-    // TODO mask
-    bformata(bstr, " -m tos --tos 0x%02X", packetfiltercontents->typdeofservice_trafficclass.value);
-  }
-  if (TRAFFIC_FLOW_TEMPLATE_FLOW_LABEL_FLAG & packetfiltercontents->flags) {
-    AssertFatal(0, "TODO"); // we have time
+  // mirrored in nf_tables once all the rules are loaded, uplink filters are only used by the classifier
+  if (RETURNok != pgw_sdf_classifier_add (&pgw_app.sdf_classifier, &sdf_f->packetfiltercontents, sdf_f->direction, sdf_f->eval_precedence, sdf_id)) {
+    OAILOG_WARNING (LOG_SPGW_APP, "SDF %u: packet filter not classified\n", sdf_id);
   }
-  return bstr;
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,445 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file pgw_sdf_classifier.c
+  \brief Tuple space search over the SDF filters of the active PCC rules
+  \author
+  \company
+  \email:
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "bstrlib.h"
+
+#include "dynamic_memory_check.h"
+#include "common_defs.h"
+#include "log.h"
+#include "pgw_sdf_classifier.h"
+
+#define PGW_SDF_TUPLE_BUCKETS_MIN        16
+#define PGW_SDF_RANK(rULE)               (((uint64_t)(rULE)->precedence << 32) | (rULE)->seq)
+
+//------------------------------------------------------------------------------
+static inline void pgw_sdf_key_mask (const pgw_sdf_key_t * const key, const pgw_sdf_key_t * const mask, pgw_sdf_key_t * const masked)
+{
+  masked->remote_addr = key->remote_addr & mask->remote_addr;
+  masked->spi         = key->spi & mask->spi;
+  masked->local_port  = key->local_port & mask->local_port;
+  masked->remote_port = key->remote_port & mask->remote_port;
+  masked->protocol    = key->protocol & mask->protocol;
+  masked->tos         = key->tos & mask->tos;
+  masked->pad[0]      = 0;
+  masked->pad[1]      = 0;
+}
+
+//------------------------------------------------------------------------------
+static inline bool pgw_sdf_key_equal (const pgw_sdf_key_t * const k1, const pgw_sdf_key_t * const k2)
+{
+  return (k1->remote_addr == k2->remote_addr) && (k1->spi == k2->spi) && (k1->local_port == k2->local_port) &&
+      (k1->remote_port == k2->remote_port) && (k1->protocol == k2->protocol) && (k1->tos == k2->tos);
+}
+
+//------------------------------------------------------------------------------
+static inline uint32_t pgw_sdf_key_hash (const pgw_sdf_key_t * const key)
+{
+  uint32_t                                h = key->remote_addr * 0x9E3779B1;
+
+  h ^= key->spi * 0x85EBCA77;
+  h ^= (((uint32_t)key->local_port << 16) | key->remote_port) * 0xC2B2AE3D;
+  h ^= ((uint32_t)key->protocol << 8) | key->tos;
+  h ^= h >> 16;
+  h *= 0x7FEB352D;
+  h ^= h >> 15;
+  return h;
+}
+
+//------------------------------------------------------------------------------
+static inline bool pgw_sdf_rule_match (const pgw_sdf_tuple_t * const tuple, const pgw_sdf_rule_t * const rule,
+                                       const pgw_sdf_key_t * const masked, const pgw_sdf_flow_t * const flow)
+{
+  if (!pgw_sdf_key_equal (&rule->value, masked)) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_PRE_REL7_TFT_FILTER != rule->direction) &&
+      (!(rule->direction & ((flow->downlink) ? TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY : TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY)))) {
+    return false;
+  }
+  if ((tuple->local_port_range) && ((flow->key.local_port < rule->local_port_low) || (flow->key.local_port > rule->local_port_high))) {
+    return false;
+  }
+  if ((tuple->remote_port_range) && ((flow->key.remote_port < rule->remote_port_low) || (flow->key.remote_port > rule->remote_port_high))) {
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_sdf_tuple_free (pgw_sdf_tuple_t * const tuple)
+{
+  for (uint32_t b = 0; b < tuple->nb_buckets; b++) {
+    while (tuple->buckets[b]) {
+      pgw_sdf_rule_t                     *rule = tuple->buckets[b];
+
+      tuple->buckets[b] = rule->next;
+      free (rule);
+    }
+  }
+  free (tuple->buckets);
+  free (tuple);
+}
+
+// Chains are sorted by rank, the first match of a chain is the best one of its bucket
+//------------------------------------------------------------------------------
+static void pgw_sdf_tuple_insert (pgw_sdf_tuple_t * const tuple, pgw_sdf_rule_t * const rule)
+{
+  pgw_sdf_rule_t                        **prev = &tuple->buckets[pgw_sdf_key_hash (&rule->value) & (tuple->nb_buckets - 1)];
+
+  while ((*prev) && (PGW_SDF_RANK (*prev) < PGW_SDF_RANK (rule))) {
+    prev = &(*prev)->next;
+  }
+  rule->next = *prev;
+  *prev = rule;
+}
+
+//------------------------------------------------------------------------------
+static int pgw_sdf_tuple_grow (pgw_sdf_tuple_t * const tuple)
+{
+  pgw_sdf_rule_t                        **old_buckets = tuple->buckets;
+  const uint32_t                          old_nb_buckets = tuple->nb_buckets;
+
+  tuple->buckets = calloc (old_nb_buckets << 1, sizeof (pgw_sdf_rule_t *));
+  if (!tuple->buckets) {
+    tuple->buckets = old_buckets;
+    return RETURNerror;
+  }
+  tuple->nb_buckets = old_nb_buckets << 1;
+  for (uint32_t b = 0; b < old_nb_buckets; b++) {
+    while (old_buckets[b]) {
+      pgw_sdf_rule_t                     *rule = old_buckets[b];
+
+      old_buckets[b] = rule->next;
+      pgw_sdf_tuple_insert (tuple, rule);
+    }
+  }
+  free (old_buckets);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+static void pgw_sdf_tuple_update_rank (pgw_sdf_tuple_t * const tuple)
+{
+  tuple->best_rank = UINT64_MAX;
+  for (uint32_t b = 0; b < tuple->nb_buckets; b++) {
+    if ((tuple->buckets[b]) && (PGW_SDF_RANK (tuple->buckets[b]) < tuple->best_rank)) {
+      tuple->best_rank = PGW_SDF_RANK (tuple->buckets[b]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void pgw_sdf_classifier_sort_tuples (pgw_sdf_classifier_t * const classifier)
+{
+  for (uint32_t i = 1; i < classifier->nb_tuples; i++) {
+    pgw_sdf_tuple_t                      *tuple = classifier->tuples[i];
+    uint32_t                              j = i;
+
+    for (; (j > 0) && (classifier->tuples[j - 1]->best_rank > tuple->best_rank); j--) {
+      classifier->tuples[j] = classifier->tuples[j - 1];
+    }
+    classifier->tuples[j] = tuple;
+  }
+}
+
+//------------------------------------------------------------------------------
+static pgw_sdf_tuple_t *pgw_sdf_classifier_get_tuple (pgw_sdf_classifier_t * const classifier, const pgw_sdf_key_t * const mask,
+                                                      const bool local_port_range, const bool remote_port_range)
+{
+  pgw_sdf_tuple_t                        *tuple = NULL;
+
+  for (uint32_t i = 0; i < classifier->nb_tuples; i++) {
+    tuple = classifier->tuples[i];
+    if ((pgw_sdf_key_equal (&tuple->mask, mask)) && (tuple->local_port_range == local_port_range) && (tuple->remote_port_range == remote_port_range)) {
+      return tuple;
+    }
+  }
+  if (PGW_SDF_CLASSIFIER_TUPLES_MAX == classifier->nb_tuples) {
+    OAILOG_WARNING (LOG_SPGW_APP, "No room for another SDF filter tuple, %u tuples\n", classifier->nb_tuples);
+    return NULL;
+  }
+  tuple = calloc (1, sizeof (*tuple));
+  if (!tuple) {
+    return NULL;
+  }
+  tuple->buckets = calloc (PGW_SDF_TUPLE_BUCKETS_MIN, sizeof (pgw_sdf_rule_t *));
+  if (!tuple->buckets) {
+    free (tuple);
+    return NULL;
+  }
+  tuple->nb_buckets = PGW_SDF_TUPLE_BUCKETS_MIN;
+  tuple->mask = *mask;
+  tuple->local_port_range = local_port_range;
+  tuple->remote_port_range = remote_port_range;
+  tuple->best_rank = UINT64_MAX;
+  classifier->tuples[classifier->nb_tuples++] = tuple;
+  return tuple;
+}
+
+//------------------------------------------------------------------------------
+int pgw_sdf_classifier_init (pgw_sdf_classifier_t * const classifier)
+{
+  memset (classifier, 0, sizeof (*classifier));
+  if (pthread_rwlock_init (&classifier->lock, NULL)) {
+    return RETURNerror;
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void pgw_sdf_classifier_destroy (pgw_sdf_classifier_t * const classifier)
+{
+  for (uint32_t i = 0; i < classifier->nb_tuples; i++) {
+    pgw_sdf_tuple_free (classifier->tuples[i]);
+    classifier->tuples[i] = NULL;
+  }
+  classifier->nb_tuples = 0;
+  classifier->nb_rules = 0;
+  pthread_rwlock_destroy (&classifier->lock);
+}
+
+//------------------------------------------------------------------------------
+int pgw_sdf_classifier_add (pgw_sdf_classifier_t * const classifier, const packet_filter_contents_t * const pf,
+                            const uint8_t direction, const uint8_t precedence, const uint32_t sdf_id)
+{
+  pgw_sdf_key_t                           mask = {0};
+  pgw_sdf_key_t                           value = {0};
+  pgw_sdf_tuple_t                        *tuple = NULL;
+  pgw_sdf_rule_t                         *rule = NULL;
+  const bool                              local_port_range = (TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG & pf->flags);
+  const bool                              remote_port_range = (TRAFFIC_FLOW_TEMPLATE_REMOTE_PORT_RANGE_FLAG & pf->flags);
+
+  if ((TRAFFIC_FLOW_TEMPLATE_IPV6_REMOTE_ADDR_FLAG | TRAFFIC_FLOW_TEMPLATE_FLOW_LABEL_FLAG) & pf->flags) {
+    OAILOG_WARNING (LOG_SPGW_APP, "SDF %u: IPv6 SDF filters are not supported by the classifier\n", sdf_id);
+    return RETURNerror;
+  }
+  if (PGW_SDF_NO_MATCH == sdf_id) {
+    return RETURNerror;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG & pf->flags) {
+    for (int i = 0; i < TRAFFIC_FLOW_TEMPLATE_IPV4_ADDR_SIZE; i++) {
+      mask.remote_addr = (mask.remote_addr << 8) | pf->ipv4remoteaddr[i].mask;
+      value.remote_addr = (value.remote_addr << 8) | pf->ipv4remoteaddr[i].addr;
+    }
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG & pf->flags) {
+    mask.protocol = 0xFF;
+    value.protocol = pf->protocolidentifier_nextheader;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_LOCAL_PORT_FLAG & pf->flags) {
+    mask.local_port = 0xFFFF;
+    value.local_port = pf->singlelocalport;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG & pf->flags) {
+    mask.remote_port = 0xFFFF;
+    value.remote_port = pf->singleremoteport;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_SECURITY_PARAMETER_INDEX_FLAG & pf->flags) {
+    mask.protocol = 0xFF;
+    value.protocol = IPPROTO_ESP;
+    mask.spi = 0xFFFFFFFF;
+    value.spi = pf->securityparameterindex;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG & pf->flags) {
+    mask.tos = pf->typdeofservice_trafficclass.mask;
+    value.tos = pf->typdeofservice_trafficclass.value;
+  }
+
+  rule = calloc (1, sizeof (*rule));
+  if (!rule) {
+    return RETURNerror;
+  }
+  rule->sdf_id = sdf_id;
+  rule->direction = direction;
+  rule->precedence = precedence;
+  pgw_sdf_key_mask (&value, &mask, &rule->value);
+  rule->local_port_low = (local_port_range) ? pf->localportrange.lowlimit : 0;
+  rule->local_port_high = (local_port_range) ? pf->localportrange.highlimit : 0xFFFF;
+  rule->remote_port_low = (remote_port_range) ? pf->remoteportrange.lowlimit : 0;
+  rule->remote_port_high = (remote_port_range) ? pf->remoteportrange.highlimit : 0xFFFF;
+
+  pthread_rwlock_wrlock (&classifier->lock);
+  tuple = pgw_sdf_classifier_get_tuple (classifier, &mask, local_port_range, remote_port_range);
+  if ((!tuple) || ((tuple->nb_rules >= tuple->nb_buckets) && (RETURNok != pgw_sdf_tuple_grow (tuple)))) {
+    pthread_rwlock_unlock (&classifier->lock);
+    free (rule);
+    return RETURNerror;
+  }
+  rule->seq = classifier->next_seq++;
+  pgw_sdf_tuple_insert (tuple, rule);
+  tuple->nb_rules += 1;
+  classifier->nb_rules += 1;
+  if (PGW_SDF_RANK (rule) < tuple->best_rank) {
+    tuple->best_rank = PGW_SDF_RANK (rule);
+    pgw_sdf_classifier_sort_tuples (classifier);
+  }
+  pthread_rwlock_unlock (&classifier->lock);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+uint32_t pgw_sdf_classifier_del (pgw_sdf_classifier_t * const classifier, const uint32_t sdf_id)
+{
+  uint32_t                                nb_removed = 0;
+  uint32_t                                nb_tuples = 0;
+
+  pthread_rwlock_wrlock (&classifier->lock);
+  for (uint32_t i = 0; i < classifier->nb_tuples; i++) {
+    pgw_sdf_tuple_t                      *tuple = classifier->tuples[i];
+
+    for (uint32_t b = 0; b < tuple->nb_buckets; b++) {
+      pgw_sdf_rule_t                    **prev = &tuple->buckets[b];
+
+      while (*prev) {
+        pgw_sdf_rule_t                   *rule = *prev;
+
+        if (rule->sdf_id == sdf_id) {
+          *prev = rule->next;
+          free (rule);
+          tuple->nb_rules -= 1;
+          nb_removed += 1;
+        } else {
+          prev = &rule->next;
+        }
+      }
+    }
+    if (0 == tuple->nb_rules) {
+      pgw_sdf_tuple_free (tuple);
+      continue;
+    }
+    pgw_sdf_tuple_update_rank (tuple);
+    classifier->tuples[nb_tuples++] = tuple;
+  }
+  for (uint32_t i = nb_tuples; i < classifier->nb_tuples; i++) {
+    classifier->tuples[i] = NULL;
+  }
+  classifier->nb_tuples = nb_tuples;
+  classifier->nb_rules -= nb_removed;
+  pgw_sdf_classifier_sort_tuples (classifier);
+  pthread_rwlock_unlock (&classifier->lock);
+  return nb_removed;
+}
+
+//------------------------------------------------------------------------------
+uint32_t pgw_sdf_classify (pgw_sdf_classifier_t * const classifier, const pgw_sdf_flow_t * const flow)
+{
+  const pgw_sdf_rule_t                   *best = NULL;
+  uint64_t                                best_rank = UINT64_MAX;
+  uint32_t                                sdf_id = PGW_SDF_NO_MATCH;
+
+  pthread_rwlock_rdlock (&classifier->lock);
+  for (uint32_t i = 0; i < classifier->nb_tuples; i++) {
+    const pgw_sdf_tuple_t                *tuple = classifier->tuples[i];
+    pgw_sdf_key_t                         masked;
+
+    // the following tuples cannot do better
+    if (tuple->best_rank >= best_rank) {
+      break;
+    }
+    pgw_sdf_key_mask (&flow->key, &tuple->mask, &masked);
+    for (const pgw_sdf_rule_t *rule = tuple->buckets[pgw_sdf_key_hash (&masked) & (tuple->nb_buckets - 1)];
+         (rule) && (PGW_SDF_RANK (rule) < best_rank); rule = rule->next) {
+      if (pgw_sdf_rule_match (tuple, rule, &masked, flow)) {
+        best = rule;
+        best_rank = PGW_SDF_RANK (rule);
+        break;
+      }
+    }
+  }
+  if (best) {
+    sdf_id = best->sdf_id;
+  }
+  pthread_rwlock_unlock (&classifier->lock);
+  return sdf_id;
+}
+
+//------------------------------------------------------------------------------
+int pgw_sdf_flow_from_ipv4 (const uint8_t * const pkt, const uint32_t len, const bool downlink, pgw_sdf_flow_t * const flow)
+{
+  uint32_t                                ihl = 0;
+  uint32_t                                remote_addr_offset = (downlink) ? 12 : 16;
+
+  if ((20 > len) || (4 != (pkt[0] >> 4)) || ((ihl = (pkt[0] & 0x0F) << 2) < 20) || (ihl > len)) {
+    return RETURNerror;
+  }
+  memset (flow, 0, sizeof (*flow));
+  flow->downlink = downlink;
+  flow->key.tos = pkt[1];
+  flow->key.protocol = pkt[9];
+  flow->key.remote_addr = ((uint32_t)pkt[remote_addr_offset] << 24) | ((uint32_t)pkt[remote_addr_offset + 1] << 16) |
+      ((uint32_t)pkt[remote_addr_offset + 2] << 8) | pkt[remote_addr_offset + 3];
+  // only the first fragment carries the transport header
+  if ((((pkt[6] & 0x1F) << 8) | pkt[7]) || (ihl + 4 > len)) {
+    return RETURNok;
+  }
+  switch (flow->key.protocol) {
+  case IPPROTO_TCP:
+  case IPPROTO_UDP:
+  case IPPROTO_UDPLITE:
+  case IPPROTO_SCTP: {
+      const uint16_t                      sport = ((uint16_t)pkt[ihl] << 8) | pkt[ihl + 1];
+      const uint16_t                      dport = ((uint16_t)pkt[ihl + 2] << 8) | pkt[ihl + 3];
+
+      flow->key.local_port = (downlink) ? dport : sport;
+      flow->key.remote_port = (downlink) ? sport : dport;
+    }
+    break;
+
+  case IPPROTO_ESP:
+    flow->key.spi = ((uint32_t)pkt[ihl] << 24) | ((uint32_t)pkt[ihl + 1] << 16) | ((uint32_t)pkt[ihl + 2] << 8) | pkt[ihl + 3];
+    break;
+
+  default:
+    break;
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void pgw_sdf_classifier_walk (pgw_sdf_classifier_t * const classifier,
+                              void (*cb)(const pgw_sdf_tuple_t * const tuple, const pgw_sdf_rule_t * const rule, void *arg), void *arg)
+{
+  pthread_rwlock_rdlock (&classifier->lock);
+  for (uint32_t i = 0; i < classifier->nb_tuples; i++) {
+    const pgw_sdf_tuple_t                *tuple = classifier->tuples[i];
+
+    for (uint32_t b = 0; b < tuple->nb_buckets; b++) {
+      for (const pgw_sdf_rule_t *rule = tuple->buckets[b]; rule; rule = rule->next) {
+        cb (tuple, rule, arg);
+      }
+    }
+  }
+  pthread_rwlock_unlock (&classifier->lock);
+}
@@ -0,0 +1,123 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file pgw_sdf_classifier.h
+* \brief Service data flow classification of packets against the active SDF filters
+* \author
+* \company
+* \email:
+*/
+
+#ifndef FILE_PGW_SDF_CLASSIFIER_SEEN
+#define FILE_PGW_SDF_CLASSIFIER_SEEN
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "3gpp_24.008.h"
+
+#define PGW_SDF_CLASSIFIER_TUPLES_MAX    64
+#define PGW_SDF_NO_MATCH                 0
+
+/*
+ * Fields of a packet a filter can look at, host byte order. The remote side is
+ * the source of a downlink packet and the destination of an uplink packet
+ * (3GPP TS 24.008 10.5.6.12).
+ */
+typedef struct pgw_sdf_key_s {
+  uint32_t         remote_addr;
+  uint32_t         spi;
+  uint16_t         local_port;
+  uint16_t         remote_port;
+  uint8_t          protocol;
+  uint8_t          tos;
+  uint8_t          pad[2];
+} pgw_sdf_key_t;
+
+typedef struct pgw_sdf_flow_s {
+  pgw_sdf_key_t    key;
+  bool             downlink;
+} pgw_sdf_flow_t;
+
+typedef struct pgw_sdf_rule_s {
+  uint32_t         sdf_id;
+  uint8_t          direction;        // TRAFFIC_FLOW_TEMPLATE_xxx
+  uint8_t          precedence;       // evaluation precedence, the lowest one wins
+  uint32_t         seq;              // insertion order, breaks the ties of precedence
+  pgw_sdf_key_t    value;            // already masked
+  uint16_t         local_port_low;   // port ranges, only looked at in tuples with ranges
+  uint16_t         local_port_high;
+  uint16_t         remote_port_low;
+  uint16_t         remote_port_high;
+  struct pgw_sdf_rule_s *next;       // same hash bucket, lowest precedence first
+} pgw_sdf_rule_t;
+
+/*
+ * The filters sharing the same masks (remote address prefix, protocol, ToS
+ * mask, exact or ranged ports) form a tuple. A tuple hashes the masked fields
+ * of the packet to the filters with these exact values, so a lookup costs one
+ * probe per tuple whatever the number of filters. Tuples are kept sorted by
+ * the best precedence of their filters, the search stops at the first tuple
+ * that cannot beat the match already found.
+ */
+typedef struct pgw_sdf_tuple_s {
+  pgw_sdf_key_t    mask;
+  bool             local_port_range;
+  bool             remote_port_range;
+  uint64_t         best_rank;        // (precedence << 32) | seq of its best filter
+  uint32_t         nb_rules;
+  uint32_t         nb_buckets;       // power of 2
+  pgw_sdf_rule_t **buckets;
+} pgw_sdf_tuple_t;
+
+typedef struct pgw_sdf_classifier_s {
+  pthread_rwlock_t lock;             // data path threads classify, the SPGW_APP tasks add and remove filters
+  uint32_t         nb_tuples;
+  uint32_t         nb_rules;
+  uint32_t         next_seq;
+  pgw_sdf_tuple_t *tuples[PGW_SDF_CLASSIFIER_TUPLES_MAX];
+} pgw_sdf_classifier_t;
+
+int      pgw_sdf_classifier_init     (pgw_sdf_classifier_t * const classifier);
+void     pgw_sdf_classifier_destroy  (pgw_sdf_classifier_t * const classifier);
+
+// IPv6 remote addresses and flow labels are not supported, these filters are refused
+int      pgw_sdf_classifier_add      (pgw_sdf_classifier_t * const classifier, const packet_filter_contents_t * const pf,
+                                      const uint8_t direction, const uint8_t precedence, const uint32_t sdf_id);
+// Removes all the filters of the SDF, returns the number of filters removed
+uint32_t pgw_sdf_classifier_del      (pgw_sdf_classifier_t * const classifier, const uint32_t sdf_id);
+
+// SDF identifier of the best matching filter, PGW_SDF_NO_MATCH if none
+uint32_t pgw_sdf_classify            (pgw_sdf_classifier_t * const classifier, const pgw_sdf_flow_t * const flow);
+
+// Fills the flow from an IPv4 packet, the ports of a non first fragment are left to 0
+int      pgw_sdf_flow_from_ipv4      (const uint8_t * const pkt, const uint32_t len, const bool downlink, pgw_sdf_flow_t * const flow);
+
+/*
+ * Calls cb for each filter, tuple by tuple: a tuple maps to one verdict map
+ * keyed by the concatenation of its masked fields, for instance to mirror the
+ * classifier in nf_tables sets. Filters with port ranges need interval maps.
+ */
+void     pgw_sdf_classifier_walk     (pgw_sdf_classifier_t * const classifier,
+                                      void (*cb)(const pgw_sdf_tuple_t * const tuple, const pgw_sdf_rule_t * const rule, void *arg), void *arg);
+
+#endif /* FILE_PGW_SDF_CLASSIFIER_SEEN */
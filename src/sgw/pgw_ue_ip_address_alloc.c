@@ -31,20 +31,83 @@
 #include <stdbool.h>
 #include <string.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+
+#include "dynamic_memory_check.h"
+#include "hashtable.h"
+#include "common_types.h"
+#include "common_defs.h"
+#include "log.h"
+#include "spgw_config.h"
 #include "pgw_lite_paa.h"
+#include "pgw_ue_ip_address_alloc.h"
+
+#define PGW_UE_IP_STICKY_HTABLE_SIZE 65536
+
+// IMSI -> last IPv4 address allocated (network byte order), NULL if sticky allocation is disabled
+static hash_table_ts_t                 *pgw_ue_ipv4_sticky_htbl = NULL;
 
-int allocate_ue_ipv4_address(const char *imsi, struct in_addr *addr) {
-  // Call PGW IP Address allocator 
-  return pgw_get_free_ipv4_paa_address (addr); 
+//------------------------------------------------------------------------------
+int allocate_ue_ipv4_address(const imsi64_t imsi64, struct in_addr *addr)
+{
+  void                                   *id = NULL;
+
+  if ((pgw_ue_ipv4_sticky_htbl) && (HASH_TABLE_OK == hashtable_ts_get (pgw_ue_ipv4_sticky_htbl, (const hash_key_t)imsi64, &id))) {
+    addr->s_addr = (in_addr_t)(uintptr_t)id;
+    // Same address as the previous attach if nobody got it in the meantime
+    if (RETURNok == pgw_reserve_ipv4_paa_address (addr)) {
+      return RETURNok;
+    }
+  }
+  // Call PGW IP Address allocator
+  if (RETURNok != pgw_get_free_ipv4_paa_address (addr)) {
+    OAILOG_ERROR (LOG_SPGW_APP, "No IPv4 address left in UE pools for IMSI " IMSI_64_FMT "\n", imsi64);
+    return RETURNerror;
+  }
+  if (pgw_ue_ipv4_sticky_htbl) {
+    hashtable_ts_insert (pgw_ue_ipv4_sticky_htbl, (const hash_key_t)imsi64, (void *)(uintptr_t)addr->s_addr);
+  }
+  return RETURNok;
 }
 
-int release_ue_ipv4_address(const char *imsi, struct in_addr *addr) {
-  // Release IP address back to PGW IP Address allocator 
-  return pgw_release_free_ipv4_paa_address (addr); 
+//------------------------------------------------------------------------------
+int release_ue_ipv4_address(const imsi64_t imsi64, struct in_addr *addr)
+{
+  // Release IP address back to PGW IP Address allocator, the IMSI keeps its sticky address
+  if (RETURNok != pgw_release_free_ipv4_paa_address (addr)) {
+    OAILOG_WARNING (LOG_SPGW_APP, "Could not release IPv4 address %s of IMSI " IMSI_64_FMT "\n", inet_ntoa (*addr), imsi64);
+    return RETURNerror;
+  }
+  return RETURNok;
 }
 
-void pgw_ip_address_pool_init(void) {
-  pgw_load_pool_ip_addresses ();
-  return;
+//------------------------------------------------------------------------------
+int pgw_ip_address_pool_init(const pgw_config_t * const pgw_config_p, const uint32_t nb_shards)
+{
+  if (RETURNok != pgw_load_pool_ip_addresses (pgw_config_p->num_ue_pool, pgw_config_p->ue_pool_addr, pgw_config_p->ue_pool_mask, nb_shards)) {
+    return RETURNerror;
+  }
+  if (pgw_config_p->ue_pool_sticky) {
+    bstring b = bfromcstr ("pgw_ue_ipv4_sticky_htbl");
+
+    pgw_ue_ipv4_sticky_htbl = hashtable_ts_create (PGW_UE_IP_STICKY_HTABLE_SIZE, HASH_TABLE_DEFAULT_HASH_FUNC, hash_free_int_func, b);
+    bdestroy_wrapper (&b);
+    if (!pgw_ue_ipv4_sticky_htbl) {
+      pgw_free_pool_ip_addresses ();
+      return RETURNerror;
+    }
+  }
+  return RETURNok;
 }
 
+//------------------------------------------------------------------------------
+void pgw_ip_address_pool_exit(void)
+{
+  if (pgw_ue_ipv4_sticky_htbl) {
+    hashtable_ts_destroy (pgw_ue_ipv4_sticky_htbl);
+    pgw_ue_ipv4_sticky_htbl = NULL;
+  }
+  pgw_free_pool_ip_addresses ();
+}
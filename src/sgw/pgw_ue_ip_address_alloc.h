@@ -29,8 +29,14 @@
 #ifndef PGW_UE_IP_ADDRESS_ALLOC_SEEN
 #define PGW_UE_IP_ADDRESS_ALLOC_SEEN
 
-int allocate_ue_ipv4_address (const char *imsi, struct in_addr *addr); 
-int release_ue_ipv4_address (const char *imsi, struct in_addr *addr);
-void pgw_ip_address_pool_init (void); 
+#include <netinet/in.h>
+
+#include "common_types.h"
+#include "pgw_config.h"
+
+int allocate_ue_ipv4_address (const imsi64_t imsi64, struct in_addr *addr);
+int release_ue_ipv4_address (const imsi64_t imsi64, struct in_addr *addr);
+int pgw_ip_address_pool_init (const pgw_config_t * const pgw_config_p, const uint32_t nb_shards);
+void pgw_ip_address_pool_exit (void);
 
 #endif /*PGW_UE_IP_ADDRESS_ALLOC_SEEN */
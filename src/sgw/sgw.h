@@ -37,9 +37,33 @@
 
 #include "commonDef.h"
 #include "common_types.h"
+#include "intertask_interface_types.h"
+#include "sgw_config.h"
 #include "sgw_context_manager.h"
 #include "gtpv1u_sgw_defs.h"
 #include "pgw_pcef_emulation.h"
+#include "pgw_sdf_classifier.h"
+
+/*
+ * Sessions are spread over the SPGW application shards by S-GW S11 TEID. A
+ * shard is one ITTI task, it owns its session tables and allocates TEIDs and
+ * UE addresses from its own sub-pools. S11 sends the messages of a session
+ * straight to the shard owning its TEID, a shard shares no state with the
+ * others: tunnel changes, nf_tables changes and held responses are per shard.
+ */
+typedef struct sgw_app_shard_s {
+  task_id_t        task_id;
+
+  // key is S11 S-GW local teid
+  hash_table_ts_t *s11teid2mme_hashtable;
+
+  // the key of this hashtable is the S11 s-gw local teid.
+  hash_table_ts_t *s11_bearer_context_information_hashtable;
+
+  // responses held until the tunnel changes this shard queued before them are acknowledged
+  STAILQ_HEAD (sgw_deferred_msgs_s, sgw_deferred_msg_s) deferred_msgs;
+  uint32_t         tunnel_acked_seq;
+} sgw_app_shard_t;
 
 typedef struct sgw_app_s {
 
@@ -51,30 +75,24 @@ typedef struct sgw_app_s {
 
   struct in_addr sgw_ip_address_S5_S8_up; // unused now
 
-  // key is S11 S-GW local teid
-  hash_table_ts_t *s11teid2mme_hashtable;
-
   // key is S1-U S-GW local teid
   //hash_table_t *s1uteid2enb_hashtable;
 
-  // the key of this hashtable is the S11 s-gw local teid.
-  hash_table_ts_t *s11_bearer_context_information_hashtable;
+  uint32_t         nb_shards;
+  sgw_app_shard_t  shards[SGW_SPGW_APP_SHARDS_MAX];
 
   gtpv1u_data_t    gtpv1u_data;
 } sgw_app_t;
 
-
-struct ipv4_list_elm_s {
-  STAILQ_ENTRY(ipv4_list_elm_s) ipv4_entries;
-  struct in_addr  addr;
-};
+// Shard owning the session of an S-GW S11 TEID
+#define SGW_APP_SHARD_OF_TEID(tEID)  (&sgw_app.shards[sgw_cm_shard_of_teid (tEID)])
 
 
 typedef struct pgw_app_s {
-  STAILQ_HEAD(ipv4_list_free_head_s,     ipv4_list_elm_s)  ipv4_list_free;
-  STAILQ_HEAD(ipv4_list_allocated_head_s, ipv4_list_elm_s) ipv4_list_allocated;
   hash_table_ts_t                                         *deactivated_predefined_pcc_rules;
   hash_table_ts_t                                         *predefined_pcc_rules;
+  // SDF filters of the activated PCC rules, mirrored in nf_tables, looked up by the userspace GTP-U path
+  pgw_sdf_classifier_t                                     sdf_classifier;
 } pgw_app_t;
 
 #endif
@@ -67,6 +67,9 @@ void sgw_config_init (sgw_config_t * config_pP)
 {
   memset(config_pP, 0, sizeof(*config_pP));
   pthread_rwlock_init (&config_pP->rw_lock, NULL);
+  config_pP->s11_gtpv2c_instances = 1;
+  config_pP->spgw_app_shards = 1;
+  config_pP->expected_sessions = SGW_EXPECTED_SESSIONS_DEFAULT;
 }
 //------------------------------------------------------------------------------
 int sgw_config_process (sgw_config_t * config_pP)
@@ -88,6 +91,9 @@ int sgw_config_parse_file (sgw_config_t * config_pP)
   char                                   *sgw_if_name_S11 = NULL;
   char                                   *S11 = NULL;
   libconfig_int                           sgw_udp_port_S1u_S12_S4_up = 2152;
+  libconfig_int                           s11_gtpv2c_instances = 1;
+  libconfig_int                           spgw_app_shards = 1;
+  libconfig_int                           expected_sessions = 0;
   config_setting_t                       *subsetting = NULL;
   const char                             *astring = NULL;
   bstring                                 address = NULL;
@@ -197,6 +203,23 @@ int sgw_config_parse_file (sgw_config_t * config_pP)
     }
     OAILOG_SET_CONFIG(&config_pP->log_config);
 
+    if (config_setting_lookup_int (setting_sgw, SGW_CONFIG_STRING_S11_GTPV2C_INSTANCES, &s11_gtpv2c_instances)) {
+      AssertFatal ((0 < s11_gtpv2c_instances) && (SGW_S11_GTPV2C_INSTANCES_MAX >= s11_gtpv2c_instances),
+          "Bad %s value %d, range is 1..%d\n", SGW_CONFIG_STRING_S11_GTPV2C_INSTANCES, (int)s11_gtpv2c_instances, SGW_S11_GTPV2C_INSTANCES_MAX);
+      config_pP->s11_gtpv2c_instances = s11_gtpv2c_instances;
+    }
+
+    if (config_setting_lookup_int (setting_sgw, SGW_CONFIG_STRING_SPGW_APP_SHARDS, &spgw_app_shards)) {
+      AssertFatal ((0 < spgw_app_shards) && (SGW_SPGW_APP_SHARDS_MAX >= spgw_app_shards),
+          "Bad %s value %d, range is 1..%d\n", SGW_CONFIG_STRING_SPGW_APP_SHARDS, (int)spgw_app_shards, SGW_SPGW_APP_SHARDS_MAX);
+      config_pP->spgw_app_shards = spgw_app_shards;
+    }
+
+    if (config_setting_lookup_int (setting_sgw, SGW_CONFIG_STRING_EXPECTED_SESSIONS, &expected_sessions)) {
+      AssertFatal (0 < expected_sessions, "Bad %s value %d\n", SGW_CONFIG_STRING_EXPECTED_SESSIONS, (int)expected_sessions);
+      config_pP->expected_sessions = expected_sessions;
+    }
+
     subsetting = config_setting_get_member (setting_sgw, SGW_CONFIG_STRING_NETWORK_INTERFACES_CONFIG);
 
     if (subsetting) {
@@ -280,6 +303,9 @@ void sgw_config_display (sgw_config_t * config_p)
   OAILOG_INFO (LOG_SPGW_APP, "- S11:\n");
   OAILOG_INFO (LOG_SPGW_APP, "    S11 iface ............: %s\n", bdata(config_p->ipv4.if_name_S11));
   OAILOG_INFO (LOG_SPGW_APP, "    S11 ip ...............: %s/%u\n", inet_ntoa (config_p->ipv4.S11), config_p->ipv4.netmask_S11);
+  OAILOG_INFO (LOG_SPGW_APP, "    GTPv2-C instances ....: %u\n", config_p->s11_gtpv2c_instances);
+  OAILOG_INFO (LOG_SPGW_APP, "    SPGW-APP shards ......: %u\n", config_p->spgw_app_shards);
+  OAILOG_INFO (LOG_SPGW_APP, "    Expected sessions ....: %u\n", config_p->expected_sessions);
   OAILOG_INFO (LOG_SPGW_APP, "- ITTI:\n");
   OAILOG_INFO (LOG_SPGW_APP, "    queue size .......: %u (bytes)\n", config_p->itti_config.queue_size);
   OAILOG_INFO (LOG_SPGW_APP, "    log file .........: %s\n", bdata(config_p->itti_config.log_file));
@@ -44,6 +44,17 @@
 #define SGW_CONFIG_STRING_SGW_IPV4_ADDRESS_FOR_S5_S8_UP         "SGW_IPV4_ADDRESS_FOR_S5_S8_UP"
 #define SGW_CONFIG_STRING_SGW_INTERFACE_NAME_FOR_S11            "SGW_INTERFACE_NAME_FOR_S11"
 #define SGW_CONFIG_STRING_SGW_IPV4_ADDRESS_FOR_S11              "SGW_IPV4_ADDRESS_FOR_S11"
+#define SGW_CONFIG_STRING_S11_GTPV2C_INSTANCES                  "S11_GTPV2C_INSTANCES"
+#define SGW_CONFIG_STRING_SPGW_APP_SHARDS                       "SPGW_APP_SHARDS"
+#define SGW_CONFIG_STRING_EXPECTED_SESSIONS                     "EXPECTED_SESSIONS"
+
+// One ITTI task per S11 GTPv2-C stack instance: TASK_S11, TASK_S11_1 .. TASK_S11_3
+#define SGW_S11_GTPV2C_INSTANCES_MAX                            4
+
+// One ITTI task per SPGW application shard: TASK_SPGW_APP, TASK_SPGW_APP_1 .. TASK_SPGW_APP_3
+#define SGW_SPGW_APP_SHARDS_MAX                                 4
+
+#define SGW_EXPECTED_SESSIONS_DEFAULT                           4096
 
 #define SPGW_ABORT_ON_ERROR true
 #define SPGW_WARN_ON_ERROR false
@@ -72,6 +83,10 @@ typedef struct sgw_config_s {
   } ipv4;
   uint16_t     udp_port_S1u_S12_S4_up;
 
+  uint32_t     s11_gtpv2c_instances;  // S11 GTPv2-C stacks running in parallel, sessions spread by TEID
+  uint32_t     spgw_app_shards;       // SPGW application tasks running in parallel, sessions spread by S11 TEID
+  uint32_t     expected_sessions;     // initial size of the session tables, they grow beyond
+
   bool         local_to_eNB;
 
   log_config_t log_config;
@@ -42,6 +42,8 @@
 #include "conversions.h"
 #include "hashtable.h"
 #include "obj_hashtable.h"
+#include "mem_slab.h"
+#include "teid_pool.h"
 #include "common_defs.h"
 #include "intertask_interface.h"
 #include "msc.h"
@@ -55,6 +57,127 @@
 
 extern sgw_app_t                        sgw_app;
 
+/*
+ * Session storage, each SPGW_APP shard allocates from its own caches and its
+ * own shard of the TEID pools. The S11 TEID tells the owning shard.
+ */
+typedef struct sgw_cm_shard_s {
+  mem_slab_t                              context_slab;
+  mem_slab_t                              bearer_slab;
+  mem_slab_t                              s11_tunnel_slab;
+} sgw_cm_shard_t;
+
+static sgw_cm_shard_t                   sgw_cm_shards[SGW_SPGW_APP_SHARDS_MAX];
+static uint32_t                         sgw_cm_nb_shards = 1;
+// shard of the calling SPGW_APP task, 0 for any other thread
+static __thread uint32_t                sgw_cm_current_shard = 0;
+static teid_pool_t                      sgw_cm_s11_teid_pool;
+static teid_pool_t                      sgw_cm_s1u_teid_pool;
+
+//-----------------------------------------------------------------------------
+int sgw_cm_init (const uint32_t expected_sessions, const uint32_t nb_shards)
+{
+  uint32_t                                objs_per_chunk = MEM_SLAB_OBJS_PER_CHUNK_DEFAULT;
+  uint32_t                                shard_sessions = 0;
+  size_t                                  session_size = 0;
+  sgw_cm_shard_t                         *shard = NULL;
+
+  if ((0 == nb_shards) || (SGW_SPGW_APP_SHARDS_MAX < nb_shards)) {
+    return RETURNerror;
+  }
+  sgw_cm_nb_shards = nb_shards;
+  shard_sessions = expected_sessions / nb_shards;
+  if (shard_sessions < objs_per_chunk) {
+    objs_per_chunk = (shard_sessions) ? shard_sessions : 1;
+  }
+  for (uint32_t i = 0; i < nb_shards; i++) {
+    shard = &sgw_cm_shards[i];
+    if ((RETURNok != mem_slab_init (&shard->context_slab, "sgw_context", sizeof (s_plus_p_gw_eps_bearer_context_information_t), objs_per_chunk))
+        || (RETURNok != mem_slab_init (&shard->bearer_slab, "sgw_eps_bearer", sizeof (sgw_eps_bearer_ctxt_t), objs_per_chunk))
+        || (RETURNok != mem_slab_init (&shard->s11_tunnel_slab, "sgw_s11_tunnel", sizeof (mme_sgw_tunnel_t), objs_per_chunk))) {
+      return RETURNerror;
+    }
+  }
+  if ((RETURNok != teid_pool_init (&sgw_cm_s11_teid_pool, "sgw_s11_teid", TEID_POOL_INDEX_BITS_DEFAULT, nb_shards))
+      || (RETURNok != teid_pool_init (&sgw_cm_s1u_teid_pool, "sgw_s1u_teid", TEID_POOL_INDEX_BITS_DEFAULT, nb_shards))) {
+    return RETURNerror;
+  }
+  // context, default bearer, S11 tunnel and their hash table entries
+  shard = &sgw_cm_shards[0];
+  session_size = shard->context_slab.obj_size + shard->bearer_slab.obj_size + shard->s11_tunnel_slab.obj_size +
+      2 * (sizeof (hash_node_t) + sizeof (hash_node_t *) + sizeof (pthread_mutex_t));
+  OAILOG_INFO (LOG_SPGW_APP, "Session storage: %zu bytes per session (context %zu, bearer %zu), %zu KB for %u sessions over %u shards\n",
+      session_size, shard->context_slab.obj_size, shard->bearer_slab.obj_size, (session_size * expected_sessions) >> 10, expected_sessions, nb_shards);
+  return RETURNok;
+}
+
+//-----------------------------------------------------------------------------
+void sgw_cm_exit (void)
+{
+  for (uint32_t i = 0; i < sgw_cm_nb_shards; i++) {
+    mem_slab_destroy (&sgw_cm_shards[i].context_slab);
+    mem_slab_destroy (&sgw_cm_shards[i].bearer_slab);
+    mem_slab_destroy (&sgw_cm_shards[i].s11_tunnel_slab);
+  }
+  teid_pool_destroy (&sgw_cm_s11_teid_pool);
+  teid_pool_destroy (&sgw_cm_s1u_teid_pool);
+}
+
+//-----------------------------------------------------------------------------
+void sgw_cm_set_shard (const uint32_t shard)
+{
+  sgw_cm_current_shard = shard;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t sgw_cm_shard_of_teid (const teid_t s11_teid)
+{
+  return (sgw_cm_nb_shards > 1) ? teid_pool_shard_of (&sgw_cm_s11_teid_pool, s11_teid) : 0;
+}
+
+//-----------------------------------------------------------------------------
+void sgw_cm_display_memory_usage (void)
+{
+  teid_pool_t                            *pools[] = {&sgw_cm_s11_teid_pool, &sgw_cm_s1u_teid_pool};
+
+  for (uint32_t s = 0; s < sgw_cm_nb_shards; s++) {
+    const mem_slab_t                     *slabs[] = {&sgw_cm_shards[s].context_slab, &sgw_cm_shards[s].bearer_slab, &sgw_cm_shards[s].s11_tunnel_slab};
+    const hash_table_ts_t                *htbls[] = {sgw_app.shards[s].s11_bearer_context_information_hashtable, sgw_app.shards[s].s11teid2mme_hashtable};
+
+    for (int i = 0; i < sizeof (slabs) / sizeof (slabs[0]); i++) {
+      OAILOG_INFO (LOG_SPGW_APP, "Session storage shard %u %s: %u in use, %zu KB\n", s, slabs[i]->name, slabs[i]->nb_used, mem_slab_footprint (slabs[i]) >> 10);
+    }
+    for (int i = 0; i < sizeof (htbls) / sizeof (htbls[0]); i++) {
+      if (htbls[i]) {
+        OAILOG_INFO (LOG_SPGW_APP, "Session storage shard %u %s: %u entries, %u buckets, %zu KB\n", s, bdata (htbls[i]->name), htbls[i]->num_elements, htbls[i]->size,
+            ((size_t)htbls[i]->num_elements * sizeof (hash_node_t) + (size_t)htbls[i]->size * (sizeof (hash_node_t *) + sizeof (pthread_mutex_t))) >> 10);
+      }
+    }
+  }
+  for (int i = 0; i < sizeof (pools) / sizeof (pools[0]); i++) {
+    if (pools[i]->shards) {
+      OAILOG_INFO (LOG_SPGW_APP, "Session storage %s: %u in use\n", pools[i]->name, teid_pool_nb_used (pools[i]));
+    }
+  }
+}
+
+/*
+ * Double the number of buckets when there are more entries than buckets, the
+ * tables are only touched by the SPGW_APP shard owning them so moving the
+ * entries is safe.
+ */
+//-----------------------------------------------------------------------------
+static void sgw_cm_grow_hashtable (hash_table_ts_t * const htbl)
+{
+  if (htbl->num_elements > htbl->size) {
+    if (HASH_TABLE_OK == hashtable_ts_resize (htbl, htbl->size << 1)) {
+      OAILOG_INFO (LOG_SPGW_APP, "Resized %s to %u buckets\n", bdata (htbl->name), htbl->size);
+    } else {
+      OAILOG_WARNING (LOG_SPGW_APP, "Could not resize %s, %u entries in %u buckets\n", bdata (htbl->name), htbl->num_elements, htbl->size);
+    }
+  }
+}
+
 
 //-----------------------------------------------------------------------------
 static bool
@@ -85,7 +208,9 @@ sgw_display_s11teid2mme_mappings (
   OAILOG_DEBUG (LOG_SPGW_APP, "+--------------------------------------+\n");
   OAILOG_DEBUG (LOG_SPGW_APP, "| MME <--- S11 TE ID MAPPINGS ---> SGW |\n");
   OAILOG_DEBUG (LOG_SPGW_APP, "+--------------------------------------+\n");
-  hashtable_ts_apply_callback_on_elements (sgw_app.s11teid2mme_hashtable, sgw_display_s11teid2mme_mapping, NULL, NULL);
+  for (uint32_t i = 0; i < sgw_cm_nb_shards; i++) {
+    hashtable_ts_apply_callback_on_elements (sgw_app.shards[i].s11teid2mme_hashtable, sgw_display_s11teid2mme_mapping, NULL, NULL);
+  }
   OAILOG_DEBUG (LOG_SPGW_APP, "+--------------------------------------+\n");
 }
 
@@ -146,7 +271,9 @@ sgw_display_s11_bearer_context_information_mapping (
   OAILOG_DEBUG (LOG_SPGW_APP, "+-----------------------------------------+\n");
   OAILOG_DEBUG (LOG_SPGW_APP, "| S11 BEARER CONTEXT INFORMATION MAPPINGS |\n");
   OAILOG_DEBUG (LOG_SPGW_APP, "+-----------------------------------------+\n");
-  hashtable_ts_apply_callback_on_elements (sgw_app.s11_bearer_context_information_hashtable, sgw_display_s11_bearer_context_information, NULL, NULL);
+  for (uint32_t i = 0; i < sgw_cm_nb_shards; i++) {
+    hashtable_ts_apply_callback_on_elements (sgw_app.shards[i].s11_bearer_context_information_hashtable, sgw_display_s11_bearer_context_information, NULL, NULL);
+  }
   OAILOG_DEBUG (LOG_SPGW_APP, "+--------------------------------------+\n");
 }
 
@@ -169,11 +296,13 @@ sgw_get_new_S11_tunnel_id (
   void)
 //-----------------------------------------------------------------------------
 {
-  // TO DO: RANDOM
-  static teid_t                           tunnel_id = 0;
+  return teid_pool_alloc (&sgw_cm_s11_teid_pool, sgw_cm_current_shard);
+}
 
-  tunnel_id += 1;
-  return tunnel_id;
+//-----------------------------------------------------------------------------
+teid_t sgw_get_new_s1u_teid (void)
+{
+  return teid_pool_alloc (&sgw_cm_s1u_teid_pool, sgw_cm_current_shard);
 }
 
 //-----------------------------------------------------------------------------
@@ -185,13 +314,18 @@ sgw_cm_create_s11_tunnel (
 {
   mme_sgw_tunnel_t                       *new_tunnel = NULL;
 
-  new_tunnel = calloc (1, sizeof (mme_sgw_tunnel_t));
+  if (0 == local_teid) {
+    OAILOG_ERROR (LOG_SPGW_APP, "No S11 TEID left for remote_teid " TEID_FMT "\n", remote_teid);
+    return NULL;
+  }
+  new_tunnel = mem_slab_alloc (&sgw_cm_shards[sgw_cm_current_shard].s11_tunnel_slab);
 
   if (new_tunnel == NULL) {
     /*
      * Malloc failed, may be ENOMEM error
      */
     OAILOG_ERROR (LOG_SPGW_APP, "Failed to create tunnel for remote_teid " TEID_FMT "\n", remote_teid);
+    teid_pool_free (&sgw_cm_s11_teid_pool, local_teid);
     return NULL;
   }
 
@@ -201,10 +335,21 @@ sgw_cm_create_s11_tunnel (
    * Trying to insert the new tunnel into the tree.
    * * * * If collision_p is not NULL (0), it means tunnel is already present.
    */
-  hashtable_ts_insert (sgw_app.s11teid2mme_hashtable, local_teid, new_tunnel);
+  hashtable_ts_insert (SGW_APP_SHARD_OF_TEID (local_teid)->s11teid2mme_hashtable, local_teid, new_tunnel);
+  sgw_cm_grow_hashtable (SGW_APP_SHARD_OF_TEID (local_teid)->s11teid2mme_hashtable);
   return new_tunnel;
 }
 
+//-----------------------------------------------------------------------------
+void sgw_cm_free_s11_tunnel (mme_sgw_tunnel_t ** tunnelP)
+{
+  if (*tunnelP) {
+    // TEIDs not taken from the pool are ignored
+    teid_pool_free (&sgw_cm_s11_teid_pool, (*tunnelP)->local_teid);
+  }
+  mem_slab_free (&sgw_cm_shards[sgw_cm_current_shard].s11_tunnel_slab, (void**)tunnelP);
+}
+
 //-----------------------------------------------------------------------------
 int
 sgw_cm_remove_s11_tunnel (
@@ -213,7 +358,7 @@ sgw_cm_remove_s11_tunnel (
 {
   int                                     temp = 0;
 
-  temp = hashtable_ts_free (sgw_app.s11teid2mme_hashtable, local_teid);
+  temp = hashtable_ts_free (SGW_APP_SHARD_OF_TEID (local_teid)->s11teid2mme_hashtable, local_teid);
   return temp;
 }
 
@@ -223,7 +368,7 @@ sgw_eps_bearer_ctxt_t *sgw_cm_create_eps_bearer_context (void)
 {
   sgw_eps_bearer_ctxt_t                 *sgw_eps_bearer_ctxt = NULL;
 
-  sgw_eps_bearer_ctxt = calloc (1, sizeof (sgw_eps_bearer_ctxt_t));
+  sgw_eps_bearer_ctxt = mem_slab_alloc (&sgw_cm_shards[sgw_cm_current_shard].bearer_slab);
 
   if (sgw_eps_bearer_ctxt == NULL) {
     /*
@@ -268,8 +413,10 @@ void sgw_cm_free_pdn_connection (sgw_pdn_connection_t * pdn_connectionP)
 void sgw_free_sgw_eps_bearer_context (sgw_eps_bearer_ctxt_t ** sgw_eps_bearer_ctxt)
 {
   if (*sgw_eps_bearer_ctxt) {
-    // nothing to do actually
-    free_wrapper((void**) sgw_eps_bearer_ctxt);
+    if ((*sgw_eps_bearer_ctxt)->s_gw_teid_S1u_S12_S4_up) {
+      teid_pool_free (&sgw_cm_s1u_teid_pool, (*sgw_eps_bearer_ctxt)->s_gw_teid_S1u_S12_S4_up);
+    }
+    mem_slab_free (&sgw_cm_shards[sgw_cm_current_shard].bearer_slab, (void**) sgw_eps_bearer_ctxt);
   }
 }
 
@@ -279,12 +426,15 @@ void sgw_cm_free_s_plus_p_gw_eps_bearer_context_information (s_plus_p_gw_eps_bea
   if (*contextP) {
 
     sgw_cm_free_pdn_connection(&(*contextP)->sgw_eps_bearer_context_information.pdn_connection);
+    free_wrapper ((void**)&(*contextP)->sgw_eps_bearer_context_information.saved_message);
 
-    if ((*contextP)->pgw_eps_bearer_context_information.apns ) {
-      obj_hashtable_ts_destroy ((*contextP)->pgw_eps_bearer_context_information.apns);
+    for (int i = 0; i < (*contextP)->pgw_eps_bearer_context_information.num_apns; i++) {
+      pgw_apn_t *apn = &(*contextP)->pgw_eps_bearer_context_information.apns[i];
+
+      pgw_lite_cm_free_apn (&apn);
     }
 
-    free_wrapper ((void**)contextP);
+    mem_slab_free (&sgw_cm_shards[sgw_cm_current_shard].context_slab, (void**)contextP);
   }
 }
 
@@ -295,7 +445,7 @@ sgw_cm_create_bearer_context_information_in_collection (
 {
   s_plus_p_gw_eps_bearer_context_information_t *new_bearer_context_information = NULL;
 
-  new_bearer_context_information = calloc (1, sizeof (s_plus_p_gw_eps_bearer_context_information_t));
+  new_bearer_context_information = mem_slab_alloc (&sgw_cm_shards[sgw_cm_current_shard].context_slab);
 
   if (new_bearer_context_information == NULL) {
     /*
@@ -306,31 +456,12 @@ sgw_cm_create_bearer_context_information_in_collection (
   }
 
   OAILOG_DEBUG (LOG_SPGW_APP, "sgw_cm_create_bearer_context_information_in_collection " TEID_FMT "\n", teid);
-  /*
-   * new_bearer_context_information->sgw_eps_bearer_context_information.pdn_connections = obj_hashtable_ts_create(32, NULL, NULL, sgw_cm_free_pdn_connection);
-   * 
-   * if ( new_bearer_context_information->sgw_eps_bearer_context_information.pdn_connections == NULL) {
-   * SPGW_APP_ERROR("Failed to create PDN connections collection object entry for EPS bearer teid %u \n", teid);
-   * sgw_cm_free_s_plus_p_gw_eps_bearer_context_information(new_bearer_context_information);
-   * return NULL;
-   * }
-   */
-  bstring b = bfromcstr("pgw_eps_bearer_ctxt_info_apns");
-  new_bearer_context_information->pgw_eps_bearer_context_information.apns =
-      obj_hashtable_ts_create (32, NULL, NULL, (void (*) (void **))pgw_lite_cm_free_apn, b);
-  bdestroy_wrapper (&b);
-
-  if (new_bearer_context_information->pgw_eps_bearer_context_information.apns == NULL) {
-    OAILOG_ERROR (LOG_SPGW_APP, "Failed to create APN collection object entry for EPS bearer S11 teid " TEID_FMT "\n", teid);
-    sgw_cm_free_s_plus_p_gw_eps_bearer_context_information (&new_bearer_context_information);
-    return NULL;
-  }
-
   /*
    * Trying to insert the new tunnel into the tree.
    * * * * If collision_p is not NULL (0), it means tunnel is already present.
    */
-  hashtable_ts_insert (sgw_app.s11_bearer_context_information_hashtable, teid, new_bearer_context_information);
+  hashtable_ts_insert (SGW_APP_SHARD_OF_TEID (teid)->s11_bearer_context_information_hashtable, teid, new_bearer_context_information);
+  sgw_cm_grow_hashtable (SGW_APP_SHARD_OF_TEID (teid)->s11_bearer_context_information_hashtable);
   OAILOG_DEBUG (LOG_SPGW_APP, "Added new s_plus_p_gw_eps_bearer_context_information_t in s11_bearer_context_information_hashtable key teid " TEID_FMT "\n", teid);
   return new_bearer_context_information;
 }
@@ -342,7 +473,7 @@ sgw_cm_remove_bearer_context_information (
 {
   int                                     temp = 0;
 
-  temp = hashtable_ts_free (sgw_app.s11_bearer_context_information_hashtable, teid);
+  temp = hashtable_ts_free (SGW_APP_SHARD_OF_TEID (teid)->s11_bearer_context_information_hashtable, teid);
   return temp;
 }
 
@@ -359,7 +490,7 @@ sgw_eps_bearer_ctxt_t *sgw_cm_create_eps_bearer_ctxt_in_collection (
   AssertFatal ((eps_bearer_idP >= EPS_BEARER_IDENTITY_FIRST) && (eps_bearer_idP <= EPS_BEARER_IDENTITY_LAST), "Bad parameter ebi %u", eps_bearer_idP);
 
   if (!sgw_pdn_connection->sgw_eps_bearers_array[EBI_TO_INDEX(eps_bearer_idP)]) {
-    new_eps_bearer_entry = calloc (1, sizeof (sgw_eps_bearer_ctxt_t));
+    new_eps_bearer_entry = mem_slab_alloc (&sgw_cm_shards[sgw_cm_current_shard].bearer_slab);
 
     if (new_eps_bearer_entry == NULL) {
       /*
@@ -418,9 +549,8 @@ sgw_cm_remove_eps_bearer_entry (
   if ((ebi < EPS_BEARER_IDENTITY_FIRST) || (ebi > EPS_BEARER_IDENTITY_LAST)) {
     return RETURNerror;
   }
-  sgw_eps_bearer_ctxt_t * sgw_eps_bearer_ctxt = sgw_pdn_connection->sgw_eps_bearers_array[EBI_TO_INDEX(ebi)];
-  if (sgw_eps_bearer_ctxt) {
-    sgw_free_sgw_eps_bearer_context(&sgw_eps_bearer_ctxt);
+  if (sgw_pdn_connection->sgw_eps_bearers_array[EBI_TO_INDEX(ebi)]) {
+    sgw_free_sgw_eps_bearer_context(&sgw_pdn_connection->sgw_eps_bearers_array[EBI_TO_INDEX(ebi)]);
     return RETURNok;
   }
   return RETURNerror;
@@ -55,6 +55,13 @@ typedef struct enb_sgw_s1u_tunnel_s {
 } enb_sgw_s1u_tunnel_t;
 
 
+int                                    sgw_cm_init(const uint32_t expected_sessions, const uint32_t nb_shards);
+void                                   sgw_cm_exit(void);
+// The SPGW_APP shard tasks tell their index once started, allocations are made on behalf of the current shard
+void                                   sgw_cm_set_shard(const uint32_t shard);
+uint32_t                               sgw_cm_shard_of_teid(const teid_t s11_teid);
+void                                   sgw_cm_display_memory_usage(void);
+
 void                                   sgw_display_s11teid2mme_mappings(void);
 void                                   sgw_display_sgw_eps_bearer_context (const sgw_eps_bearer_ctxt_t  * const eps_bearer_ctxt);
 void                                   sgw_display_s11_bearer_context_information_mapping(void);
@@ -62,8 +69,10 @@ void                                   pgw_lite_cm_free_apn(pgw_apn_t **apnP);
 
 
 teid_t                                 sgw_get_new_S11_tunnel_id(void);
+teid_t                                 sgw_get_new_s1u_teid(void);
 mme_sgw_tunnel_t *                     sgw_cm_create_s11_tunnel(teid_t remote_teid, teid_t local_teid);
 int                                    sgw_cm_remove_s11_tunnel(teid_t local_teid);
+void                                   sgw_cm_free_s11_tunnel(mme_sgw_tunnel_t **tunnelP);
 sgw_eps_bearer_ctxt_t *                sgw_cm_create_eps_bearer_context(void);
 sgw_pdn_connection_t *                 sgw_cm_create_pdn_connection(void);
 void                                   sgw_cm_free_pdn_connection(sgw_pdn_connection_t *pdn_connectionP);
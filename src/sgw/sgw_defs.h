@@ -30,5 +30,6 @@
 #define FILE_SGW_DEFS_SEEN
 #include "spgw_config.h"
 int sgw_init(spgw_config_t *spgw_config_pP);
+task_id_t sgw_app_task_of_s11_teid(const teid_t local_teid, const teid_t peer_teid);
 
 #endif /* FILE_SGW_DEFS_SEEN */
@@ -36,6 +36,7 @@
 #include <netinet/in.h>
 
 #include "bstrlib.h"
+#include "queue.h"
 
 #include "dynamic_memory_check.h"
 #include "assertions.h"
@@ -62,20 +63,54 @@
 #include "pgw_pcef_emulation.h"
 #include "sgw_context_manager.h"
 #include "pgw_procedures.h"
-#include "async_system.h"
+#include "pgw_nft.h"
 
 extern sgw_app_t                        sgw_app;
 extern spgw_config_t                    spgw_config;
 extern struct gtp_tunnel_ops           *gtp_tunnel_ops;
-static uint32_t                         g_gtpv1u_teid = 0;
+
+/*
+ * With an asynchronous tunnel implementation, a response is held until the
+ * data path acknowledged the tunnel changes queued before it, so that the MME
+ * does not activate a bearer whose tunnel is not set yet. Each SPGW_APP shard
+ * holds the responses of its sessions, tunnel changes are numbered per shard.
+ */
+typedef struct sgw_deferred_msg_s {
+  MessageDef                             *message_p;
+  uint32_t                                tunnel_seq;
+  STAILQ_ENTRY (sgw_deferred_msg_s)       entries;
+} sgw_deferred_msg_t;
 
 //------------------------------------------------------------------------------
-uint32_t sgw_get_new_s1u_teid (void)
+// QCI of the standardized GBR characteristics (3GPP TS 23.203 table 6.1.7)
+static bool sgw_qci_is_gbr (const uint8_t qci)
 {
-  __sync_fetch_and_add(&g_gtpv1u_teid, 1);
-  return g_gtpv1u_teid;
+  return ((1 <= qci) && (qci <= 4)) || (65 == qci) || (66 == qci) || (67 == qci) || (75 == qci);
 }
 
+/*
+ * Rates of a bearer whose tunnel is set, for the data paths that police the
+ * traffic: a GBR bearer is held to its MBR, the non-GBR bearers of the PDN
+ * connection share its APN-AMBR (3GPP TS 23.401 4.7.3). In kbps, as in the
+ * GTPv2-C IEs.
+ */
+//------------------------------------------------------------------------------
+static void sgw_tunnel_set_qos (const sgw_pdn_connection_t * const pdn_connection, const sgw_eps_bearer_ctxt_t * const eps_bearer_ctxt_p)
+{
+  int                                     rv = RETURNok;
+
+  if (!gtp_tunnel_ops->set_qos) {
+    return;
+  }
+  if (sgw_qci_is_gbr (eps_bearer_ctxt_p->eps_bearer_qos.qci)) {
+    rv = gtp_tunnel_ops->set_qos (eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up, eps_bearer_ctxt_p->eps_bearer_qos.mbr.br_ul, eps_bearer_ctxt_p->eps_bearer_qos.mbr.br_dl, 0, 0);
+  } else {
+    rv = gtp_tunnel_ops->set_qos (eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up, 0, 0, pdn_connection->apn_ambr.br_ul, pdn_connection->apn_ambr.br_dl);
+  }
+  if (rv < 0) {
+    OAILOG_WARNING (LOG_SPGW_APP, "Rates of EPS bearer id %u not enforced on tunnel " TEID_FMT "\n", eps_bearer_ctxt_p->eps_bearer_id, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up);
+  }
+}
 
 //------------------------------------------------------------------------------
 int
@@ -165,7 +200,16 @@ sgw_handle_create_session_request (
     if (session_req_pP->apn) {
       s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_in_use = strdup (session_req_pP->apn);
     } else {
-      s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_in_use = "NO APN";
+      s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_in_use = strdup ("NO APN");
+    }
+    s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.pdn_type = session_req_pP->pdn_type;
+    // APN-AMBR from the subscription, the one of the PCEF otherwise
+    s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_ambr = session_req_pP->ambr;
+    if (!session_req_pP->ambr.br_ul) {
+      s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_ambr.br_ul = spgw_config.pgw_config.pcef.apn_ambr_ul;
+    }
+    if (!session_req_pP->ambr.br_dl) {
+      s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.apn_ambr.br_dl = spgw_config.pgw_config.pcef.apn_ambr_dl;
     }
 
     s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.default_bearer = session_req_pP->bearer_contexts_to_be_created.bearer_contexts[0].eps_bearer_id;
@@ -177,8 +221,6 @@ sgw_handle_create_session_request (
     // TODO several bearers
     eps_bearer_ctxt_p = sgw_cm_create_eps_bearer_ctxt_in_collection (&s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection,
         session_req_pP->bearer_contexts_to_be_created.bearer_contexts[0].eps_bearer_id);
-    sgw_display_s11teid2mme_mappings ();
-    sgw_display_s11_bearer_context_information_mapping ();
 
     if (eps_bearer_ctxt_p == NULL) {
       OAILOG_ERROR (LOG_SPGW_APP, "Failed to create new EPS bearer entry\n");
@@ -194,7 +236,14 @@ sgw_handle_create_session_request (
      * If collision_p is not NULL (0), it means tunnel is already present.
      */
     //s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_informations_gw_ip_address_S11_S4 =
-    memcpy (&s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message, session_req_pP, sizeof (itti_s11_create_session_request_t));
+    s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message = malloc (sizeof (itti_s11_create_session_request_t));
+    if (!s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message) {
+      OAILOG_ERROR (LOG_SPGW_APP, "Failed to save Create Session Request\n");
+      sgw_cm_remove_bearer_context_information (new_endpoint_p->local_teid);
+      sgw_cm_remove_s11_tunnel (new_endpoint_p->local_teid);
+      OAILOG_FUNC_RETURN(LOG_SPGW_APP, RETURNerror);
+    }
+    memcpy (s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message, session_req_pP, sizeof (itti_s11_create_session_request_t));
 
     /*
      * Establishing EPS bearer. Requesting S1-U (GTPV1-U) task to create a
@@ -222,11 +271,17 @@ sgw_handle_create_session_request (
       createTunnelResp.eps_bearer_id = session_req_pP->bearer_contexts_to_be_created.bearer_contexts[0].eps_bearer_id;
       createTunnelResp.status = 0x00;
       createTunnelResp.S1u_teid = sgw_get_new_s1u_teid ();
+      if (0 == createTunnelResp.S1u_teid) {
+        OAILOG_WARNING (LOG_SPGW_APP, "No S1-U TEID left for S-GW S11 teid " TEID_FMT "\n", new_endpoint_p->local_teid);
+        sgw_cm_remove_bearer_context_information (new_endpoint_p->local_teid);
+        sgw_cm_remove_s11_tunnel (new_endpoint_p->local_teid);
+        OAILOG_FUNC_RETURN(LOG_SPGW_APP, RETURNerror);
+      }
       sgw_handle_gtpv1uCreateTunnelResp (&createTunnelResp);
     }
   } else {
     OAILOG_WARNING (LOG_SPGW_APP, "Could not create new transaction for SESSION_CREATE message\n");
-    free_wrapper ((void**) &new_endpoint_p);
+    sgw_cm_remove_s11_tunnel (new_endpoint_p->local_teid);
     new_endpoint_p = NULL;
     OAILOG_FUNC_RETURN(LOG_SPGW_APP, RETURNerror);
   }
@@ -248,7 +303,7 @@ sgw_handle_sgi_endpoint_created (
   int                                     rv = RETURNok;
 
   OAILOG_DEBUG (LOG_SPGW_APP, "Rx SGI_CREATE_ENDPOINT_RESPONSE,Context: S11 teid "TEID_FMT", SGW S1U teid "TEID_FMT" EPS bearer id %u\n", resp_pP->context_teid, resp_pP->sgw_S1u_teid, resp_pP->eps_bearer_id);
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (resp_pP->context_teid)->s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
 
   message_p = itti_alloc_new_message (TASK_SPGW_APP, S11_CREATE_SESSION_RESPONSE);
 
@@ -346,12 +401,12 @@ sgw_handle_gtpv1uCreateTunnelResp (
   struct in_addr                          inaddr;
   itti_sgi_create_end_point_response_t    sgi_create_endpoint_resp = {0};
   int                                     rv = RETURNok;
-  char                                   *imsi = NULL;
+  imsi64_t                                imsi64 = 0;
   gtpv2c_cause_value_t                    cause = REQUEST_ACCEPTED;
 
   OAILOG_DEBUG (LOG_SPGW_APP, "Rx GTPV1U_CREATE_TUNNEL_RESP, Context S-GW S11 teid "TEID_FMT", S-GW S1U teid "TEID_FMT" EPS bearer id %u status %d\n",
                   endpoint_created_pP->context_teid, endpoint_created_pP->S1u_teid, endpoint_created_pP->eps_bearer_id, endpoint_created_pP->status);
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, endpoint_created_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (endpoint_created_pP->context_teid)->s11_bearer_context_information_hashtable, endpoint_created_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p =
@@ -360,13 +415,12 @@ sgw_handle_gtpv1uCreateTunnelResp (
     DevAssert (eps_bearer_ctxt_p);
     OAILOG_DEBUG (LOG_SPGW_APP, "Updated eps_bearer_ctxt_p eps_b_id %u with SGW S1U teid "TEID_FMT"\n", endpoint_created_pP->eps_bearer_id, endpoint_created_pP->S1u_teid);
     eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up = endpoint_created_pP->S1u_teid;
-    sgw_display_s11_bearer_context_information_mapping ();
     memset (&sgi_create_endpoint_resp, 0, sizeof (itti_sgi_create_end_point_response_t));
 
     //--------------------------------------------------------------------------
     // PCO processing
     //--------------------------------------------------------------------------
-    protocol_configuration_options_t *pco_req = &new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message.pco;
+    protocol_configuration_options_t *pco_req = &new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message->pco;
     protocol_configuration_options_t pco_resp = {0};
     protocol_configuration_options_ids_t pco_ids;
     memset(&pco_ids, 0, sizeof pco_ids);
@@ -376,6 +430,8 @@ sgw_handle_gtpv1uCreateTunnelResp (
                  "Error in processing PCO in request");
     copy_protocol_configuration_options (&sgi_create_endpoint_resp.pco, &pco_resp);
     clear_protocol_configuration_options(&pco_resp);
+    // the request is not needed anymore
+    free_wrapper ((void**)&new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message);
 
     //--------------------------------------------------------------------------
     // IP forward will forward packets to this teid
@@ -383,9 +439,9 @@ sgw_handle_gtpv1uCreateTunnelResp (
     sgi_create_endpoint_resp.sgw_S1u_teid = endpoint_created_pP->S1u_teid;
     sgi_create_endpoint_resp.eps_bearer_id = endpoint_created_pP->eps_bearer_id;
     // TO DO NOW
-    sgi_create_endpoint_resp.paa.pdn_type = new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.saved_message.pdn_type;
+    sgi_create_endpoint_resp.paa.pdn_type = new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.pdn_type;
 
-    imsi = (char *) new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.imsi.u.value;
+    imsi64 = imsi_to_imsi64 (&new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.imsi);
     switch (sgi_create_endpoint_resp.paa.pdn_type) {
     case IPv4:
       // Use NAS by default if no preference is set.
@@ -409,7 +465,7 @@ sgw_handle_gtpv1uCreateTunnelResp (
       // and using them here in conditional logic. We will also want to
       // implement different logic between the PDN types.
       if (!pco_ids.ci_ipv4_address_allocation_via_dhcpv4) {
-        if (0 == allocate_ue_ipv4_address(imsi, &inaddr)) {
+        if (0 == allocate_ue_ipv4_address(imsi64, &inaddr)) {
           sgi_create_endpoint_resp.paa.ipv4_address.s_addr = inaddr.s_addr;
           sgi_create_endpoint_resp.status = SGI_STATUS_OK; 
         } else {
@@ -429,7 +485,7 @@ sgw_handle_gtpv1uCreateTunnelResp (
       break;
 
     case IPv4_AND_v6:
-      if (0 == allocate_ue_ipv4_address(imsi, &inaddr)) {
+      if (0 == allocate_ue_ipv4_address(imsi64, &inaddr)) {
         sgi_create_endpoint_resp.paa.ipv4_address.s_addr = inaddr.s_addr;
         sgi_create_endpoint_resp.status = SGI_STATUS_OK;
       } else {
@@ -508,7 +564,7 @@ sgw_handle_gtpv1uUpdateTunnelResp (
 
   OAILOG_DEBUG (LOG_SPGW_APP, "Rx GTPV1U_UPDATE_TUNNEL_RESP, Context teid "TEID_FMT", Tunnel " TEID_FMT " (eNB) <-> (SGW) " TEID_FMT ", EPS bearer id %u, status %d\n",
                   endpoint_updated_pP->context_teid, endpoint_updated_pP->enb_S1u_teid, endpoint_updated_pP->sgw_S1u_teid, endpoint_updated_pP->eps_bearer_id, endpoint_updated_pP->status);
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, endpoint_updated_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (endpoint_updated_pP->context_teid)->s11_bearer_context_information_hashtable, endpoint_updated_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p =
@@ -574,6 +630,50 @@ sgw_handle_gtpv1uUpdateTunnelResp (
   OAILOG_FUNC_RETURN(LOG_SPGW_APP, RETURNerror);
 }
 
+//------------------------------------------------------------------------------
+// Called by the shard owning the session, the tunnel changes it queued are its own
+static int sgw_send_to_s11_after_tunnels (sgw_app_shard_t * const shard_p, MessageDef * const message_p)
+{
+  sgw_deferred_msg_t                     *deferred_p = NULL;
+  uint32_t                                tunnel_seq = 0;
+
+  if ((!gtp_tunnel_ops->last_seq) || (shard_p->tunnel_acked_seq == (tunnel_seq = gtp_tunnel_ops->last_seq ())) ||
+      (!(deferred_p = calloc (1, sizeof (*deferred_p))))) {
+    return itti_send_msg_to_task (TASK_S11, INSTANCE_DEFAULT, message_p);
+  }
+  deferred_p->message_p = message_p;
+  deferred_p->tunnel_seq = tunnel_seq;
+  STAILQ_INSERT_TAIL (&shard_p->deferred_msgs, deferred_p, entries);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void sgw_handle_tunnel_acks (sgw_app_shard_t * const shard_p)
+{
+  sgw_deferred_msg_t                     *deferred_p = NULL;
+
+  if (!gtp_tunnel_ops->process_acks) {
+    return;
+  }
+  // the changes acknowledged while flushing are accounted for here as well
+  gtp_tunnel_ops->process_acks (&shard_p->tunnel_acked_seq);
+  while ((deferred_p = STAILQ_FIRST (&shard_p->deferred_msgs)) && ((int32_t)(shard_p->tunnel_acked_seq - deferred_p->tunnel_seq) >= 0)) {
+    STAILQ_REMOVE_HEAD (&shard_p->deferred_msgs, entries);
+    itti_send_msg_to_task (TASK_S11, INSTANCE_DEFAULT, deferred_p->message_p);
+    free_wrapper ((void**)&deferred_p);
+  }
+}
+
+//------------------------------------------------------------------------------
+void sgw_flush_tunnel_changes (sgw_app_shard_t * const shard_p)
+{
+  if (gtp_tunnel_ops->flush) {
+    gtp_tunnel_ops->flush ();
+    // the kernel applies the changes during the send, the acknowledgements are already there
+    sgw_handle_tunnel_acks (shard_p);
+  }
+}
+
 //------------------------------------------------------------------------------
 int
 sgw_handle_sgi_endpoint_updated (
@@ -599,8 +699,8 @@ sgw_handle_sgi_endpoint_updated (
   }
 
   modify_response_p = &message_p->ittiMsg.s11_modify_bearer_response;
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
-  hash_rc2 = hashtable_ts_get (sgw_app.s11teid2mme_hashtable, resp_pP->context_teid /*local teid*/, (void **)&tun_pair_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (resp_pP->context_teid)->s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
+  hash_rc2 = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (resp_pP->context_teid)->s11teid2mme_hashtable, resp_pP->context_teid /*local teid*/, (void **)&tun_pair_p);
 
   if ((HASH_TABLE_OK == hash_rc) && (HASH_TABLE_OK == hash_rc2)) {
     eps_bearer_ctxt_p =
@@ -645,6 +745,8 @@ sgw_handle_sgi_endpoint_updated (
         rv = gtp_tunnel_ops->add_tunnel(ue, enb, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up, eps_bearer_ctxt_p->enb_teid_S1u);
         if (rv < 0) {
           OAILOG_ERROR (LOG_SPGW_APP, "ERROR in setting up TUNNEL err=%d\n", rv);
+        } else {
+          sgw_tunnel_set_qos (&new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection, eps_bearer_ctxt_p);
         }
       }
 
@@ -661,7 +763,7 @@ sgw_handle_sgi_endpoint_updated (
 
     MSC_LOG_TX_MESSAGE (MSC_SP_GWAPP_MME, MSC_S11_MME, NULL, 0, "0 S11_MODIFY_BEARER_RESPONSE ebi %u  trxn %u",
         modify_response_p->bearer_contexts_modified.bearer_contexts[0].eps_bearer_id, modify_response_p->trxn);
-    rv = itti_send_msg_to_task (TASK_S11, INSTANCE_DEFAULT, message_p);
+    rv = sgw_send_to_s11_after_tunnels (SGW_APP_SHARD_OF_TEID (resp_pP->context_teid), message_p);
     OAILOG_FUNC_RETURN(LOG_SPGW_APP, rv);
   } else {
     if (HASH_TABLE_OK != hash_rc2) {
@@ -693,14 +795,17 @@ sgw_handle_sgi_endpoint_deleted (
   sgw_eps_bearer_ctxt_t                 *eps_bearer_ctxt_p = NULL;
   hashtable_rc_t                          hash_rc = HASH_TABLE_OK;
   int                                     rv = RETURNok;
-  char                                   *imsi = NULL;
+  imsi64_t                                imsi64 = 0;
   struct in_addr                          inaddr;
 
-  imsi = (char *) new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.imsi.u.value;
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (resp_pP->context_teid)->s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
+  if (HASH_TABLE_OK == hash_rc) {
+    imsi64 = imsi_to_imsi64 (&new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.imsi);
+  }
   switch (resp_pP->paa.pdn_type) {
     case IPv4:
       inaddr.s_addr = resp_pP->paa.ipv4_address.s_addr;
-      if (!release_ue_ipv4_address(imsi, &inaddr)) {
+      if (!release_ue_ipv4_address(imsi64, &inaddr)) {
         OAILOG_DEBUG (LOG_SPGW_APP, "Released IPv4 PAA for PDN type IPv4\n");
       } else {
         OAILOG_ERROR (LOG_SPGW_APP, "Failed to release IPv4 PAA for PDN type IPv4\n");
@@ -713,7 +818,7 @@ sgw_handle_sgi_endpoint_deleted (
 
     case IPv4_AND_v6:
       inaddr.s_addr = resp_pP->paa.ipv4_address.s_addr;
-      if (!release_ue_ipv4_address(imsi, &inaddr)) {
+      if (!release_ue_ipv4_address(imsi64, &inaddr)) {
         OAILOG_DEBUG (LOG_SPGW_APP, "Released IPv4 PAA for PDN type IPv4_AND_v6\n");
       } else {
         OAILOG_ERROR (LOG_SPGW_APP, "Failed to release IPv4 PAA for PDN type IPv4_AND_v6\n");
@@ -728,8 +833,6 @@ sgw_handle_sgi_endpoint_deleted (
   OAILOG_DEBUG (LOG_SPGW_APP, "Rx SGI_DELETE_ENDPOINT_REQUEST, Context teid %u, SGW S1U teid %u, EPS bearer id %u\n",
                 resp_pP->context_teid, resp_pP->sgw_S1u_teid, resp_pP->eps_bearer_id);
 
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, resp_pP->context_teid, (void **)&new_bearer_ctxt_info_p);
-
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p =
         sgw_cm_get_eps_bearer_entry(&new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection,
@@ -768,8 +871,7 @@ sgw_handle_modify_bearer_request (
 
 
   OAILOG_DEBUG (LOG_SPGW_APP, "Rx MODIFY_BEARER_REQUEST, teid "TEID_FMT"\n", modify_bearer_pP->teid);
-  sgw_display_s11teid2mme_mappings ();
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, modify_bearer_pP->teid, (void **)&new_bearer_ctxt_info_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (modify_bearer_pP->teid)->s11_bearer_context_information_hashtable, modify_bearer_pP->teid, (void **)&new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.default_bearer =
@@ -870,7 +972,7 @@ sgw_handle_delete_session_request (
   }
 
   hash_rc = hashtable_ts_get (
-      sgw_app.s11_bearer_context_information_hashtable,
+      SGW_APP_SHARD_OF_TEID (delete_session_req_pP->teid)->s11_bearer_context_information_hashtable,
       delete_session_req_pP->teid, (void **)&ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
@@ -888,6 +990,7 @@ sgw_handle_delete_session_request (
     } else {
       delete_session_resp_p->cause.cause_value = REQUEST_ACCEPTED;
       delete_session_resp_p->teid = ctx_p->sgw_eps_bearer_context_information.mme_teid_S11;
+      delete_session_resp_p->local_teid = delete_session_req_pP->teid;
 
       itti_sgi_delete_end_point_request_t       sgi_delete_end_point_request;
       sgw_eps_bearer_ctxt_t                    *eps_bearer_ctxt_p = NULL;
@@ -907,11 +1010,7 @@ sgw_handle_delete_session_request (
 #if ENABLE_SDF_MARKING
             for (int sdfx = 0; sdfx < eps_bearer_ctxt_p->num_sdf; sdfx++) {
               if (eps_bearer_ctxt_p->sdf_id[sdfx]) {
-                bstring marking_command = bformat(
-                    "iptables -D POSTROUTING -t mangle --out-interface gtp0 --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/32 -m mark --mark 0x%04X -j MARK --set-mark %d",
-                    NIPADDR(eps_bearer_ctxt_p->paa.ipv4_address.s_addr), eps_bearer_ctxt_p->sdf_id[sdfx], eps_bearer_ctxt_p->eps_bearer_id);
-                async_system_command (TASK_SPGW_APP, false, bdata(marking_command));
-                bdestroy_wrapper(&marking_command);
+                pgw_nft_del_bearer_mark (eps_bearer_ctxt_p->paa.ipv4_address, eps_bearer_ctxt_p->sdf_id[sdfx]);
               }
             }
 #endif
@@ -929,13 +1028,10 @@ sgw_handle_delete_session_request (
                 eps_bearer_ctxt_p->enb_teid_S1u, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up);
           }
 #if ENABLE_SDF_MARKING
+          // the default SDF of the default bearer is not marked, the kernel would abort the transaction
           for (int sdfx = 0; sdfx < eps_bearer_ctxt_p->num_sdf; sdfx++) {
-            if (eps_bearer_ctxt_p->sdf_id[sdfx]) {
-              bstring marking_command = bformat(
-                  "iptables -D POSTROUTING -t mangle --out-interface gtp0 --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/32 -m mark --mark 0x%04X -j MARK --set-mark %d",
-                  NIPADDR(eps_bearer_ctxt_p->paa.ipv4_address.s_addr), eps_bearer_ctxt_p->sdf_id[sdfx], eps_bearer_ctxt_p->eps_bearer_id);
-              async_system_command (TASK_SPGW_APP, false, bdata(marking_command));
-              bdestroy_wrapper(&marking_command);
+            if ((eps_bearer_ctxt_p->sdf_id[sdfx]) && (SDF_ID_NGBR_DEFAULT != eps_bearer_ctxt_p->sdf_id[sdfx])) {
+              pgw_nft_del_bearer_mark (eps_bearer_ctxt_p->paa.ipv4_address, eps_bearer_ctxt_p->sdf_id[sdfx]);
             }
           }
 #endif
@@ -945,7 +1041,7 @@ sgw_handle_delete_session_request (
         sgi_delete_end_point_request.context_teid = delete_session_req_pP->teid ;
         sgi_delete_end_point_request.sgw_S1u_teid = eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up;
         sgi_delete_end_point_request.eps_bearer_id = delete_session_req_pP->lbi;
-        sgi_delete_end_point_request.pdn_type = ctx_p->sgw_eps_bearer_context_information.saved_message.pdn_type;
+        sgi_delete_end_point_request.pdn_type = ctx_p->sgw_eps_bearer_context_information.pdn_connection.pdn_type;
         memcpy (&sgi_delete_end_point_request.paa, &eps_bearer_ctxt_p->paa, sizeof (paa_t));
 
         sgw_handle_sgi_endpoint_deleted (&sgi_delete_end_point_request);
@@ -1035,7 +1131,7 @@ sgw_handle_release_access_bearers_request (
 
   release_access_bearers_resp_p = &message_p->ittiMsg.s11_release_access_bearers_response;
 
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, release_access_bearers_req_pP->teid, (void **)&ctx_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (release_access_bearers_req_pP->teid)->s11_bearer_context_information_hashtable, release_access_bearers_req_pP->teid, (void **)&ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     release_access_bearers_resp_p->cause.cause_value = REQUEST_ACCEPTED;
@@ -1074,7 +1170,7 @@ int sgw_no_pcef_create_dedicated_bearer(s11_teid_t teid)
   s_plus_p_gw_eps_bearer_context_information_t *s_plus_p_gw_eps_bearer_ctxt_info_p = NULL;
   hashtable_rc_t                          hash_rc = HASH_TABLE_OK;
 
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, teid, (void **)&s_plus_p_gw_eps_bearer_ctxt_info_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (teid)->s11_bearer_context_information_hashtable, teid, (void **)&s_plus_p_gw_eps_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
 
@@ -1092,7 +1188,7 @@ int sgw_no_pcef_create_dedicated_bearer(s11_teid_t teid)
       //s11_create_bearer_request->pti;
       OAILOG_DEBUG (LOG_SPGW_APP, "Creating bearer teid " TEID_FMT " remote teid " TEID_FMT "\n", teid, s11_create_bearer_request->teid);
 
-      sgw_eps_bearer_ctxt_t *eps_bearer_ctxt_p  = calloc (1, sizeof (sgw_eps_bearer_ctxt_t));
+      sgw_eps_bearer_ctxt_t *eps_bearer_ctxt_p  = sgw_cm_create_eps_bearer_context ();
       sgw_eps_bearer_ctxt_t *default_eps_bearer_entry_p =
                 sgw_cm_get_eps_bearer_entry(&s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection,
                     s_plus_p_gw_eps_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection.default_bearer);
@@ -1162,7 +1258,7 @@ sgw_handle_create_bearer_response (
   s_plus_p_gw_eps_bearer_context_information_t *ctx_p = NULL;
   int                                     rv = RETURNok;
 
-  hash_rc = hashtable_ts_get (sgw_app.s11_bearer_context_information_hashtable, create_bearer_response_pP->teid, (void **)&ctx_p);
+  hash_rc = hashtable_ts_get (SGW_APP_SHARD_OF_TEID (create_bearer_response_pP->teid)->s11_bearer_context_information_hashtable, create_bearer_response_pP->teid, (void **)&ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     if ((REQUEST_ACCEPTED == create_bearer_response_pP->cause.cause_value) ||
@@ -1215,20 +1311,22 @@ sgw_handle_create_bearer_response (
                       OAILOG_INFO (LOG_SPGW_APP, "Failed to setup EPS bearer id %u tunnel " TEID_FMT " (eNB) <-> (SGW) " TEID_FMT "\n",
                           eps_bearer_ctxt_p->eps_bearer_id, eps_bearer_ctxt_p->enb_teid_S1u, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up);
                     } else {
+                      sgw_tunnel_set_qos (&ctx_p->sgw_eps_bearer_context_information.pdn_connection, eps_bearer_ctxt_p);
+                      // data paths that classify the downlink themselves, deleting the tunnel undoes it
+                      if ((gtp_tunnel_ops->add_sdf_bearer) &&
+                          (0 > gtp_tunnel_ops->add_sdf_bearer (ue, pgw_ni_cbr_proc->sdf_id, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up))) {
+                        OAILOG_ERROR (LOG_SPGW_APP, "ERROR in steering SDF %u to tunnel " TEID_FMT "\n",
+                            pgw_ni_cbr_proc->sdf_id, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up);
+                      }
 
 #if ENABLE_SDF_MARKING
-                      bstring marking_command = bformat(
-                          "iptables -A POSTROUTING -t mangle --out-interface gtp0 --dest %"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/32 -m mark --mark 0x%04X -j MARK --set-mark %d",
-                          NIPADDR(eps_bearer_ctxt_p->paa.ipv4_address.s_addr), pgw_ni_cbr_proc->sdf_id, eps_bearer_ctxt_p->eps_bearer_id);
-                      async_system_command (TASK_SPGW_APP, false, bdata(marking_command));
+                      pgw_nft_add_bearer_mark (eps_bearer_ctxt_p->paa.ipv4_address, pgw_ni_cbr_proc->sdf_id, eps_bearer_ctxt_p->eps_bearer_id);
 
                       AssertFatal((TRAFFIC_FLOW_TEMPLATE_NB_PACKET_FILTERS_MAX > eps_bearer_ctxt_p->num_sdf), "Too much flows aggregated in this Bearer (should not happen => see MME)");
                       if (TRAFFIC_FLOW_TEMPLATE_NB_PACKET_FILTERS_MAX > eps_bearer_ctxt_p->num_sdf) {
                         eps_bearer_ctxt_p->sdf_id[eps_bearer_ctxt_p->num_sdf] = pgw_ni_cbr_proc->sdf_id;
                         eps_bearer_ctxt_p->num_sdf += 1;
                       }
-
-                      bdestroy_wrapper(&marking_command);
 #endif
                       OAILOG_INFO (LOG_SPGW_APP, "Setup EPS bearer id %u tunnel " TEID_FMT " (eNB) <-> (SGW) " TEID_FMT "\n",
                           eps_bearer_ctxt_p->eps_bearer_id, eps_bearer_ctxt_p->enb_teid_S1u, eps_bearer_ctxt_p->s_gw_teid_S1u_S12_S4_up);
@@ -56,98 +56,169 @@
 #include "sgw.h"
 #include "spgw_config.h"
 #include "pgw_ue_ip_address_alloc.h"
+#include "pgw_lite_paa.h"
 #include "pgw_pcef_emulation.h"
+#include "pgw_nft.h"
+#include "gtpv1u.h"
+
+// Messages processed before the queued tunnel changes are sent
+#define SGW_MSG_BATCH_SIZE                      64
 
 spgw_config_t                           spgw_config;
 sgw_app_t                               sgw_app;
 pgw_app_t                               pgw_app;
 
 extern __pid_t g_pid;
+extern const struct gtp_tunnel_ops     *gtp_tunnel_ops;
+
+static const task_id_t                  sgw_app_shard_task_ids[SGW_SPGW_APP_SHARDS_MAX] = {
+  TASK_SPGW_APP, TASK_SPGW_APP_1, TASK_SPGW_APP_2, TASK_SPGW_APP_3
+};
+// shards not terminated yet, the last one releases what they share
+static uint32_t                         sgw_app_running_shards = 0;
 
-static void sgw_exit(void);
+static void sgw_exit(sgw_app_shard_t * const shard_p);
+
+/*
+ * Called by the S11 tasks to send a message straight to the shard owning its
+ * session. A create session request (no local TEID yet) is spread by the MME
+ * TEID, the S11 TEID allocated then belongs to the shard handling it.
+ */
+//------------------------------------------------------------------------------
+task_id_t sgw_app_task_of_s11_teid (const teid_t local_teid, const teid_t peer_teid)
+{
+  if (1 >= sgw_app.nb_shards) {
+    return TASK_SPGW_APP;
+  }
+  if (!local_teid) {
+    return sgw_app.shards[peer_teid % sgw_app.nb_shards].task_id;
+  }
+  return SGW_APP_SHARD_OF_TEID (local_teid)->task_id;
+}
 
 //------------------------------------------------------------------------------
 static void *sgw_intertask_interface (void *args_p)
 {
-  itti_mark_task_ready (TASK_SPGW_APP);
+  sgw_app_shard_t                        *shard_p = (sgw_app_shard_t *) args_p;
+
+  sgw_cm_set_shard (shard_p - sgw_app.shards);
+  pgw_paa_set_shard (shard_p - sgw_app.shards);
+  itti_mark_task_ready (shard_p->task_id);
+  if ((gtp_tunnel_ops->get_ack_fd) && (0 <= gtp_tunnel_ops->get_ack_fd ())) {
+    itti_subscribe_event_fd (shard_p->task_id, gtp_tunnel_ops->get_ack_fd ());
+  }
 
   while (1) {
     MessageDef                             *received_message_p = NULL;
-
-    itti_receive_msg (TASK_SPGW_APP, &received_message_p);
-
-    switch (ITTI_MSG_ID (received_message_p)) {
-    case GTPV1U_CREATE_TUNNEL_RESP:{
-        OAILOG_DEBUG (LOG_SPGW_APP, "Received teid for S1-U: %u and status: %s\n", received_message_p->ittiMsg.gtpv1uCreateTunnelResp.S1u_teid, received_message_p->ittiMsg.gtpv1uCreateTunnelResp.status == 0 ? "Success" : "Failure");
-        sgw_handle_gtpv1uCreateTunnelResp (&received_message_p->ittiMsg.gtpv1uCreateTunnelResp);
-      }
-      break;
-
-    case GTPV1U_UPDATE_TUNNEL_RESP:{
-        sgw_handle_gtpv1uUpdateTunnelResp (&received_message_p->ittiMsg.gtpv1uUpdateTunnelResp);
-      }
-      break;
-
-    case MESSAGE_TEST:
-      OAILOG_DEBUG (LOG_SPGW_APP, "Received MESSAGE_TEST\n");
-      break;
-
-    case S11_CREATE_BEARER_RESPONSE:{
-        sgw_handle_create_bearer_response (&received_message_p->ittiMsg.s11_create_bearer_response);
-      }
-      break;
-
-    case S11_CREATE_SESSION_REQUEST:{
-        /*
-         * We received a create session request from MME (with GTP abstraction here)
-         * * * * procedures might be:
-         * * * *      E-UTRAN Initial Attach
-         * * * *      UE requests PDN connectivity
-         */
-        sgw_handle_create_session_request (&received_message_p->ittiMsg.s11_create_session_request);
-      }
-      break;
-
-    case S11_DELETE_SESSION_REQUEST:{
-        sgw_handle_delete_session_request (&received_message_p->ittiMsg.s11_delete_session_request);
-      }
-      break;
-
-    case S11_MODIFY_BEARER_REQUEST:{
-        sgw_handle_modify_bearer_request (&received_message_p->ittiMsg.s11_modify_bearer_request);
-      }
-      break;
-
-    case S11_RELEASE_ACCESS_BEARERS_REQUEST:{
-        sgw_handle_release_access_bearers_request (&received_message_p->ittiMsg.s11_release_access_bearers_request);
-      }
-      break;
-
-    case SGI_CREATE_ENDPOINT_RESPONSE:{
-        sgw_handle_sgi_endpoint_created (&received_message_p->ittiMsg.sgi_create_end_point_response);
-      }
-      break;
-
-    case SGI_UPDATE_ENDPOINT_RESPONSE:{
-        sgw_handle_sgi_endpoint_updated (&received_message_p->ittiMsg.sgi_update_end_point_response);
+    struct epoll_event                     *events = NULL;
+    int                                     nb_events = 0;
+    int                                     nb_polled = 0;
+
+    itti_receive_msg (shard_p->task_id, &received_message_p);
+
+    /*
+     * Process the received message and the ones already queued (up to a
+     * batch), the tunnel changes of all of them are sent together.
+     */
+    while (received_message_p != NULL) {
+      switch (ITTI_MSG_ID (received_message_p)) {
+      case GTPV1U_CREATE_TUNNEL_RESP:{
+          OAILOG_DEBUG (LOG_SPGW_APP, "Received teid for S1-U: %u and status: %s\n", received_message_p->ittiMsg.gtpv1uCreateTunnelResp.S1u_teid, received_message_p->ittiMsg.gtpv1uCreateTunnelResp.status == 0 ? "Success" : "Failure");
+          sgw_handle_gtpv1uCreateTunnelResp (&received_message_p->ittiMsg.gtpv1uCreateTunnelResp);
+        }
+        break;
+
+      case GTPV1U_UPDATE_TUNNEL_RESP:{
+          sgw_handle_gtpv1uUpdateTunnelResp (&received_message_p->ittiMsg.gtpv1uUpdateTunnelResp);
+        }
+        break;
+
+      case MESSAGE_TEST:
+        OAILOG_DEBUG (LOG_SPGW_APP, "Received MESSAGE_TEST\n");
+        break;
+
+      case S11_CREATE_BEARER_RESPONSE:{
+          sgw_handle_create_bearer_response (&received_message_p->ittiMsg.s11_create_bearer_response);
+        }
+        break;
+
+      case S11_CREATE_SESSION_REQUEST:{
+          /*
+           * We received a create session request from MME (with GTP abstraction here)
+           * * * * procedures might be:
+           * * * *      E-UTRAN Initial Attach
+           * * * *      UE requests PDN connectivity
+           */
+          sgw_handle_create_session_request (&received_message_p->ittiMsg.s11_create_session_request);
+        }
+        break;
+
+      case S11_DELETE_SESSION_REQUEST:{
+          sgw_handle_delete_session_request (&received_message_p->ittiMsg.s11_delete_session_request);
+        }
+        break;
+
+      case S11_MODIFY_BEARER_REQUEST:{
+          sgw_handle_modify_bearer_request (&received_message_p->ittiMsg.s11_modify_bearer_request);
+        }
+        break;
+
+      case S11_RELEASE_ACCESS_BEARERS_REQUEST:{
+          sgw_handle_release_access_bearers_request (&received_message_p->ittiMsg.s11_release_access_bearers_request);
+        }
+        break;
+
+      case S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH:{
+          const itti_s11_release_access_bearers_request_batch_t * const batch_p = &received_message_p->ittiMsg.s11_release_access_bearers_request_batch;
+
+          // S11 batches the requests per owning shard
+          for (uint32_t i = 0; i < batch_p->nb_requests; i++) {
+            sgw_handle_release_access_bearers_request (&batch_p->request[i]);
+          }
+        }
+        break;
+
+      case SGI_CREATE_ENDPOINT_RESPONSE:{
+          sgw_handle_sgi_endpoint_created (&received_message_p->ittiMsg.sgi_create_end_point_response);
+        }
+        break;
+
+      case SGI_UPDATE_ENDPOINT_RESPONSE:{
+          sgw_handle_sgi_endpoint_updated (&received_message_p->ittiMsg.sgi_update_end_point_response);
+        }
+        break;
+
+      case TERMINATE_MESSAGE:{
+          sgw_exit(shard_p);
+          itti_exit_task ();
+        }
+        break;
+
+      default:{
+          OAILOG_DEBUG (LOG_SPGW_APP, "Unkwnon message ID %d:%s\n", ITTI_MSG_ID (received_message_p), ITTI_MSG_NAME (received_message_p));
+        }
+        break;
       }
-      break;
+#if ENABLE_SDF_MARKING
+      // One nf_tables transaction for all the marking changes of the message
+      pgw_nft_commit ();
+#endif
 
-    case TERMINATE_MESSAGE:{
-        sgw_exit();
-        itti_exit_task ();
+      itti_free_msg_content(received_message_p);
+      itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
+      received_message_p = NULL;
+      if (++nb_polled < SGW_MSG_BATCH_SIZE) {
+        itti_poll_msg (shard_p->task_id, &received_message_p);
       }
-      break;
+    }
+    sgw_flush_tunnel_changes (shard_p);
 
-    default:{
-        OAILOG_DEBUG (LOG_SPGW_APP, "Unkwnon message ID %d:%s\n", ITTI_MSG_ID (received_message_p), ITTI_MSG_NAME (received_message_p));
+    nb_events = itti_get_events (shard_p->task_id, &events);
+    for (int i = 0; (i < nb_events) && (events); i++) {
+      if ((events[i].events & EPOLLIN) && (gtp_tunnel_ops->get_ack_fd) && (events[i].data.fd == gtp_tunnel_ops->get_ack_fd ())) {
+        sgw_handle_tunnel_acks (shard_p);
       }
-      break;
     }
-
-    itti_free_msg_content(received_message_p);
-    itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
-    received_message_p = NULL;
   }
 
   return NULL;
@@ -163,36 +234,53 @@ int sgw_init (spgw_config_t *spgw_config_pP)
     return RETURNerror;
   }
 
-  pgw_ip_address_pool_init (); 
-
-  bstring b = bfromcstr("sgw_s11teid2mme_hashtable");
-  sgw_app.s11teid2mme_hashtable = hashtable_ts_create (512, NULL, NULL, b);
-  btrunc(b, 0);
+  sgw_app.nb_shards = spgw_config_pP->sgw_config.spgw_app_shards;
+  if (RETURNok != pgw_ip_address_pool_init (&spgw_config_pP->pgw_config, sgw_app.nb_shards)) {
+    OAILOG_ALERT (LOG_SPGW_APP, "Initializing UE IP address pools ERROR\n");
+    return RETURNerror;
+  }
 
-  if (sgw_app.s11teid2mme_hashtable == NULL) {
-    perror ("hashtable_ts_create");
-    bdestroy_wrapper (&b);
-    OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
+  if (RETURNok != sgw_cm_init (spgw_config_pP->sgw_config.expected_sessions, sgw_app.nb_shards)) {
+    OAILOG_ALERT (LOG_SPGW_APP, "Initializing session storage ERROR\n");
     return RETURNerror;
   }
 
-  /*sgw_app.s1uteid2enb_hashtable = hashtable_ts_create (512, NULL, NULL, "sgw_s1uteid2enb_hashtable");
+  for (uint32_t i = 0; i < sgw_app.nb_shards; i++) {
+    const uint32_t                        shard_sessions = (spgw_config_pP->sgw_config.expected_sessions + sgw_app.nb_shards - 1) / sgw_app.nb_shards;
+    bstring b = bformat("sgw_s11teid2mme_hashtable_%u", i);
+
+    sgw_app.shards[i].task_id = sgw_app_shard_task_ids[i];
+    STAILQ_INIT (&sgw_app.shards[i].deferred_msgs);
+    sgw_app.shards[i].tunnel_acked_seq = 0;
+    sgw_app.shards[i].s11teid2mme_hashtable = hashtable_ts_create (shard_sessions, NULL,
+            (void (*)(void**))sgw_cm_free_s11_tunnel, b);
+    btrunc(b, 0);
+
+    if (sgw_app.shards[i].s11teid2mme_hashtable == NULL) {
+      perror ("hashtable_ts_create");
+      bdestroy_wrapper (&b);
+      OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
+      return RETURNerror;
+    }
 
-  if (sgw_app.s1uteid2enb_hashtable == NULL) {
-    perror ("hashtable_ts_create");
-    OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
-    return RETURNerror;
-  }*/
+    /*sgw_app.s1uteid2enb_hashtable = hashtable_ts_create (512, NULL, NULL, "sgw_s1uteid2enb_hashtable");
 
-  bassigncstr(b, "sgw_s11_bearer_context_information_hashtable");
-  sgw_app.s11_bearer_context_information_hashtable = hashtable_ts_create (512, NULL,
-          (void (*)(void**))sgw_cm_free_s_plus_p_gw_eps_bearer_context_information,b);
-  bdestroy_wrapper (&b);
+    if (sgw_app.s1uteid2enb_hashtable == NULL) {
+      perror ("hashtable_ts_create");
+      OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
+      return RETURNerror;
+    }*/
 
-  if (sgw_app.s11_bearer_context_information_hashtable == NULL) {
-    perror ("hashtable_ts_create");
-    OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
-    return RETURNerror;
+    bformata(b, "sgw_s11_bearer_context_information_hashtable_%u", i);
+    sgw_app.shards[i].s11_bearer_context_information_hashtable = hashtable_ts_create (shard_sessions, NULL,
+            (void (*)(void**))sgw_cm_free_s_plus_p_gw_eps_bearer_context_information,b);
+    bdestroy_wrapper (&b);
+
+    if (sgw_app.shards[i].s11_bearer_context_information_hashtable == NULL) {
+      perror ("hashtable_ts_create");
+      OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
+      return RETURNerror;
+    }
   }
 
   sgw_app.sgw_if_name_S1u_S12_S4_up    = bstrcpy(spgw_config_pP->sgw_config.ipv4.if_name_S1u_S12_S4_up);
@@ -203,17 +291,24 @@ int sgw_init (spgw_config_t *spgw_config_pP)
   sgw_app.sgw_ip_address_S5_S8_up.s_addr      = spgw_config_pP->sgw_config.ipv4.S5_S8_up.s_addr;
 
 #if ENABLE_SDF_MARKING
+  if (RETURNerror == pgw_nft_init (GTP_DEVNAME)) {
+    return RETURNerror;
+  }
+#endif
+  // the userspace GTP-U path classifies the downlink without the marking
   if (spgw_config_pP->pgw_config.pcef.enabled) {
     if (RETURNerror == pgw_pcef_emulation_init (&spgw_config_pP->pgw_config)) {
       return RETURNerror;
     }
   }
-#endif
 
-  if (itti_create_task (TASK_SPGW_APP, &sgw_intertask_interface, NULL) < 0) {
-    perror ("pthread_create");
-    OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
-    return RETURNerror;
+  sgw_app_running_shards = sgw_app.nb_shards;
+  for (uint32_t i = 0; i < sgw_app.nb_shards; i++) {
+    if (itti_create_task (sgw_app.shards[i].task_id, &sgw_intertask_interface, &sgw_app.shards[i]) < 0) {
+      perror ("pthread_create");
+      OAILOG_ALERT (LOG_SPGW_APP, "Initializing SPGW-APP task interface: ERROR\n");
+      return RETURNerror;
+    }
   }
 
   FILE *fp = NULL;
@@ -229,25 +324,32 @@ int sgw_init (spgw_config_t *spgw_config_pP)
 }
 
 //------------------------------------------------------------------------------
-static void sgw_exit(void)
+static void sgw_exit(sgw_app_shard_t * const shard_p)
 {
 
-  if (sgw_app.s11teid2mme_hashtable) {
-    hashtable_ts_destroy (sgw_app.s11teid2mme_hashtable);
+  // the sessions of a shard go back to its own slabs
+  if (shard_p->s11teid2mme_hashtable) {
+    hashtable_ts_destroy (shard_p->s11teid2mme_hashtable);
+    shard_p->s11teid2mme_hashtable = NULL;
   }
   /*if (sgw_app.s1uteid2enb_hashtable) {
     hashtable_destroy (sgw_app.s1uteid2enb_hashtable);
   }*/
-  if (sgw_app.s11_bearer_context_information_hashtable) {
-    hashtable_ts_destroy (sgw_app.s11_bearer_context_information_hashtable);
+  if (shard_p->s11_bearer_context_information_hashtable) {
+    hashtable_ts_destroy (shard_p->s11_bearer_context_information_hashtable);
+    shard_p->s11_bearer_context_information_hashtable = NULL;
   }
+  if (__sync_sub_and_fetch (&sgw_app_running_shards, 1)) {
+    OAI_FPRINTF_INFO("TASK_SPGW_APP shard %d terminated\n", (int)(shard_p - sgw_app.shards));
+    return;
+  }
+  sgw_cm_display_memory_usage ();
+  sgw_cm_exit ();
 
   //P-GW code
-  struct conf_ipv4_list_elm_s   *conf_ipv4_p = NULL;
-
-  while ((conf_ipv4_p = STAILQ_FIRST (&spgw_config.pgw_config.ipv4_pool_list))) {
-    STAILQ_REMOVE_HEAD (&spgw_config.pgw_config.ipv4_pool_list, ipv4_entries);
-    free_wrapper ((void**)&conf_ipv4_p);
-  }
+#if ENABLE_SDF_MARKING
+  pgw_nft_exit ();
+#endif
+  pgw_ip_address_pool_exit ();
   OAI_FPRINTF_INFO("TASK_SPGW_APP terminated");
 }
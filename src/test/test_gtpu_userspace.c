@@ -0,0 +1,745 @@
+#define _GNU_SOURCE
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "common_defs.h"
+#include "gtpv1u.h"
+#include "gtp_tunnel_userspace.h"
+#include "pgw_sdf_classifier.h"
+
+#define GTPU_BENCH_UES         1024
+#define GTPU_BENCH_PACKETS     4096
+#define GTPU_BENCH_ROUNDS      1000
+#define GTPU_LOOPBACK_BURSTS   64        // paced, the next burst is sent once the previous one came out
+#define GTPU_LOOPBACK_PACKETS  (GTPU_LOOPBACK_BURSTS * GTPU_US_BURST_SIZE)
+#define GTPU_QOS_FLOWS         4
+#define GTPU_QOS_SLOT_NS       200000    // one 1000 bytes packet per flow every 200 us: 40 Mbps
+#define GTPU_QOS_LOOPS         10
+#define GTPU_QOS_BENCH_LOOPS   1000
+
+#define GTPU_ENB_ADDR          "127.0.0.2"
+#define GTPU_SGI_ADDR          "192.168.100.1"
+#define GTPU_SGI_PORT          9000
+#define GTPU_USAGE_FILE        "/tmp/test_gtpu_usage.csv"
+
+// in the order of a pcap file: the GTP-U part of the S1-U datagrams
+typedef struct gtpu_capture_s {
+  uint32_t        nb_pkts;
+  uint64_t        ts_ns[GTPU_BENCH_PACKETS];    // replay time, rate test only
+  uint32_t        len[GTPU_BENCH_PACKETS];
+  struct in_addr  enb[GTPU_BENCH_PACKETS];
+  uint8_t         data[GTPU_BENCH_PACKETS][GTPU_US_BUFFER_SIZE];
+} gtpu_capture_t;
+
+static bool                          netns_enabled = false;
+static const struct gtp_tunnel_ops  *ops = NULL;
+static pgw_sdf_classifier_t          sdf_classifier;
+
+//------------------------------------------------------------------------------
+static uint64_t gtpu_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static struct in_addr gtpu_addr (const char * const addr)
+{
+  struct in_addr in = {0};
+
+  inet_pton (AF_INET, addr, &in);
+  return in;
+}
+
+//------------------------------------------------------------------------------
+static struct in_addr gtpu_ue (const uint32_t i)
+{
+  struct in_addr ue = {.s_addr = htonl (0x0A000002 + i)};
+
+  return ue;
+}
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_ip_packet (uint8_t * const ip, const struct in_addr src, const struct in_addr dst, const uint32_t payload)
+{
+  uint32_t len = 28 + payload;
+  uint32_t sum = 0;
+
+  memset (ip, 0, len);
+  ip[0] = 0x45;
+  ip[2] = len >> 8;
+  ip[3] = len & 0xFF;
+  ip[8] = 64;
+  ip[9] = 17;
+  memcpy (&ip[12], &src, 4);
+  memcpy (&ip[16], &dst, 4);
+  for (int i = 0; i < 20; i += 2) {
+    sum += (ip[i] << 8) | ip[i + 1];
+  }
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = ~((sum & 0xFFFF) + (sum >> 16)) & 0xFFFF;
+  ip[10] = sum >> 8;
+  ip[11] = sum & 0xFF;
+  // UDP without checksum
+  ip[20] = 0x30;
+  ip[21] = 0x39;
+  ip[22] = GTPU_SGI_PORT >> 8;
+  ip[23] = GTPU_SGI_PORT & 0xFF;
+  ip[24] = (8 + payload) >> 8;
+  ip[25] = (8 + payload) & 0xFF;
+  return len;
+}
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_g_pdu (uint8_t * const gtpu, const uint32_t teid, const struct in_addr ue, const uint32_t payload)
+{
+  uint32_t len = gtpu_ip_packet (&gtpu[8], ue, gtpu_addr (GTPU_SGI_ADDR), payload);
+  uint32_t nteid = htonl (teid);
+
+  gtpu[0] = 0x30;
+  gtpu[1] = GTPU_G_PDU;
+  gtpu[2] = len >> 8;
+  gtpu[3] = len & 0xFF;
+  memcpy (&gtpu[4], &nteid, 4);
+  return 8 + len;
+}
+
+//------------------------------------------------------------------------------
+static bool gtpu_usage_find (const uint32_t i_tei, const char * const state, gtpu_us_counters_t * const counters)
+{
+  FILE            *fp = fopen (GTPU_USAGE_FILE, "r");
+  char             line[256];
+  bool             found = false;
+
+  while ((fp) && (!found) && (fgets (line, sizeof (line), fp))) {
+    char           line_state[16] = {0};
+    unsigned int   line_tei = 0;
+
+    found = (6 == sscanf (line, "%*d,%u,%*u,%*[^,],%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%15s", &line_tei,
+        &counters->ul_packets, &counters->ul_bytes, &counters->dl_packets, &counters->dl_bytes, line_state))
+        && (line_tei == i_tei) && (!strcmp (line_state, state));
+  }
+  if (fp) {
+    fclose (fp);
+  }
+  return found;
+}
+
+//------------------------------------------------------------------------------
+static uint16_t gtpu_pcap16 (const uint8_t * const p, const bool swapped)
+{
+  return swapped ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+}
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_pcap32 (const uint8_t * const p, const bool swapped)
+{
+  return swapped ? ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3] : ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_capture_load (gtpu_capture_t * const capture, const char * const path)
+{
+  FILE    *f = fopen (path, "r");
+  uint8_t  hdr[24];
+  uint8_t  frame[65536];
+  bool     swapped = false;
+  uint32_t link_len = 0;
+
+  ck_assert_ptr_ne (f, NULL);
+  ck_assert_int_eq (fread (hdr, 1, sizeof (hdr), f), sizeof (hdr));
+  swapped = (hdr[0] == 0xA1);
+  switch (gtpu_pcap32 (&hdr[20], swapped)) {
+  case 1:   link_len = 14; break;   // Ethernet
+  case 113: link_len = 16; break;   // Linux cooked
+  default:  link_len = 0;  break;   // raw IP
+  }
+  while (capture->nb_pkts < GTPU_BENCH_PACKETS) {
+    uint8_t  rec[16];
+    uint32_t caplen = 0;
+    uint8_t *ip = NULL;
+    uint32_t ihl = 0;
+
+    if ((fread (rec, 1, sizeof (rec), f) != sizeof (rec))) {
+      break;
+    }
+    caplen = gtpu_pcap32 (&rec[8], swapped);
+    ck_assert_int_ge (sizeof (frame), caplen);
+    ck_assert_int_eq (fread (frame, 1, caplen, f), caplen);
+    ip = &frame[link_len];
+    ihl = 4 * (ip[0] & 0x0F);
+    // IPv4 UDP to the GTP-U port, not fragmented
+    if ((caplen < link_len + 28) || ((ip[0] >> 4) != 4) || (ip[9] != 17) || (gtpu_pcap16 (&ip[ihl + 2], true) != 2152)
+        || (caplen - link_len - ihl - 8 > GTPU_US_BUFFER_SIZE)) {
+      continue;
+    }
+    capture->len[capture->nb_pkts] = caplen - link_len - ihl - 8;
+    memcpy (&capture->enb[capture->nb_pkts], &ip[12], 4);
+    memcpy (capture->data[capture->nb_pkts], &ip[ihl + 8], capture->len[capture->nb_pkts]);
+    capture->nb_pkts++;
+  }
+  fclose (f);
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_capture_synthesize (gtpu_capture_t * const capture)
+{
+  for (uint32_t i = 0; i < GTPU_BENCH_PACKETS; i++) {
+    capture->len[i] = gtpu_g_pdu (capture->data[i], 1 + i % GTPU_BENCH_UES, gtpu_ue (i % GTPU_BENCH_UES), 36);
+    capture->enb[i] = gtpu_addr (GTPU_ENB_ADDR);
+  }
+  capture->nb_pkts = GTPU_BENCH_PACKETS;
+}
+
+/*
+ * Uplink of the rate test, 1000 bytes IP packets at 40 Mbps on each flow:
+ * two non-GBR bearers of UE 0 (TEID 1 and 2), a GBR bearer of UE 0 (TEID 3),
+ * a bearer of UE 1 without limits (TEID 4).
+ */
+//------------------------------------------------------------------------------
+static void gtpu_capture_rates (gtpu_capture_t * const capture)
+{
+  for (uint32_t i = 0; i < GTPU_BENCH_PACKETS; i++) {
+    const uint32_t flow = i % GTPU_QOS_FLOWS;
+
+    capture->ts_ns[i] = (uint64_t)(i / GTPU_QOS_FLOWS) * GTPU_QOS_SLOT_NS;
+    capture->len[i] = gtpu_g_pdu (capture->data[i], 1 + flow, gtpu_ue ((flow == 3) ? 1 : 0), 1000 - 28);
+    capture->enb[i] = gtpu_addr (GTPU_ENB_ADDR);
+  }
+  capture->nb_pkts = GTPU_BENCH_PACKETS;
+}
+
+// Bursts as a worker takes them, stamped with the time of their first packet, the capture looped
+//------------------------------------------------------------------------------
+static void gtpu_capture_replay (const gtpu_capture_t * const capture, const uint32_t loops, uint64_t * const bytes, gtpu_us_stats_t * const stats)
+{
+  const uint64_t   duration_ns = capture->ts_ns[capture->nb_pkts - 1] + GTPU_QOS_SLOT_NS;
+  gtpu_us_pkt_t    pkts[GTPU_US_BURST_SIZE];
+
+  for (uint32_t l = 0; l < loops; l++) {
+    for (uint32_t i = 0; i < capture->nb_pkts; i += GTPU_US_BURST_SIZE) {
+      uint32_t nb = (capture->nb_pkts - i < GTPU_US_BURST_SIZE) ? capture->nb_pkts - i : GTPU_US_BURST_SIZE;
+
+      for (uint32_t j = 0; j < nb; j++) {
+        pkts[j].data = (uint8_t *)capture->data[i + j];
+        pkts[j].len = capture->len[i + j];
+      }
+      gtpu_us_uplink_burst (pkts, nb, l * duration_ns + capture->ts_ns[i], stats);
+      for (uint32_t j = 0; (bytes) && (j < nb); j++) {
+        bytes[(i + j) % GTPU_QOS_FLOWS] += (pkts[j].verdict == GTPU_US_TO_SGI) ? pkts[j].len : 0;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_rate_check (const char * const name, const uint64_t bytes, const uint64_t kbps, const uint64_t duration_ns)
+{
+  const double     mbps = (double)bytes * 8 / duration_ns * 1000;
+
+  printf ("GTP-U %s: %.2f Mbps for %.2f Mbps\n", name, mbps, (double)kbps / 1000);
+  // the bucket starts full: one burst depth on top of the rate
+  ck_assert_int_ge (bytes * 8 * 1000000, kbps * duration_ns * 98 / 100);
+  ck_assert_int_le (bytes * 8 * 1000000, kbps * (duration_ns + GTPU_US_QOS_BURST_MS * 1000000) * 102 / 100);
+}
+
+START_TEST(gtpu_codec_test)
+{
+  uint8_t          buffers[6][256] = {{0}};
+  gtpu_us_pkt_t    pkts[6] = {{0}};
+  gtpu_us_stats_t  stats = {0};
+  struct in_addr   enb = gtpu_addr (GTPU_ENB_ADDR);
+  uint32_t         teid = 0;
+
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 1, 0x1001), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (1), enb, 2, 0x1002), RETURNok);
+  // dedicated bearer of UE 0, the downlink stays on the default one
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 3, 0x1003), RETURNok);
+
+  pkts[0].len = gtpu_g_pdu (buffers[0], 1, gtpu_ue (0), 100);
+  pkts[1].len = gtpu_g_pdu (buffers[1], 9, gtpu_ue (0), 100);         // unknown TEID
+  pkts[2].len = gtpu_g_pdu (buffers[2], 2, gtpu_ue (0), 100);         // spoofed source
+  // sequence number and a PDCP PDU number extension header
+  pkts[3].len = 16 + gtpu_ip_packet (&buffers[3][16], gtpu_ue (0), gtpu_addr (GTPU_SGI_ADDR), 10);
+  memcpy (buffers[3], (uint8_t[]){0x36, GTPU_G_PDU, 0, pkts[3].len - 8, 0, 0, 0, 3, 0, 7, 0, 0xC0, 1, 0, 0, 0}, 16);
+  memcpy (buffers[4], (uint8_t[]){0x32, GTPU_ECHO_REQUEST, 0, 4, 0, 0, 0, 0, 0x12, 0x34, 0, 0}, 12);
+  pkts[4].len = 12;
+  pkts[5].len = gtpu_g_pdu (buffers[5], 1, gtpu_ue (0), 100);
+  buffers[5][0] = 0x20;                                               // GTP'
+  for (int i = 0; i < 6; i++) {
+    pkts[i].data = buffers[i];
+  }
+  gtpu_us_uplink_burst (pkts, 6, 0, &stats);
+  ck_assert_int_eq (pkts[0].verdict, GTPU_US_TO_SGI);
+  ck_assert_int_eq (pkts[0].len, 128);
+  ck_assert_ptr_eq (pkts[0].data, &buffers[0][8]);
+  ck_assert_int_eq (pkts[1].verdict, GTPU_US_DROP);
+  ck_assert_int_eq (pkts[2].verdict, GTPU_US_DROP);
+  ck_assert_int_eq (pkts[3].verdict, GTPU_US_TO_SGI);
+  ck_assert_ptr_eq (pkts[3].data, &buffers[3][16]);
+  ck_assert_int_eq (pkts[3].len, 38);
+  ck_assert_int_eq (pkts[4].verdict, GTPU_US_TO_S1U);
+  ck_assert_int_eq (pkts[4].len, 14);
+  ck_assert_int_eq (buffers[4][1], GTPU_ECHO_RESPONSE);
+  ck_assert_int_eq (buffers[4][8], 0x12);
+  ck_assert_int_eq (buffers[4][12], 14);
+  ck_assert_int_eq (pkts[5].verdict, GTPU_US_DROP);
+  ck_assert_int_eq (stats.ul_packets, 2);
+  ck_assert_int_eq (stats.drops, 3);
+
+  // to UE 0: encapsulated in front of the packet, towards its default bearer
+  pkts[0].data = &buffers[0][GTPU_US_HEADROOM];
+  pkts[0].len = gtpu_ip_packet (pkts[0].data, gtpu_addr (GTPU_SGI_ADDR), gtpu_ue (0), 100);
+  gtpu_us_downlink_burst (pkts, 1, 0, &stats);
+  ck_assert_int_eq (pkts[0].verdict, GTPU_US_TO_S1U);
+  ck_assert_ptr_eq (pkts[0].data, &buffers[0][GTPU_US_HEADROOM - 8]);
+  ck_assert_int_eq (pkts[0].len, 136);
+  ck_assert_int_eq (pkts[0].peer.s_addr, enb.s_addr);
+  memcpy (&teid, &pkts[0].data[4], 4);
+  ck_assert_int_eq (ntohl (teid), 0x1001);
+  ck_assert_int_eq (pkts[0].data[3], 128);
+
+  // the default bearer goes away: no more downlink, the dedicated one still carries uplink
+  ck_assert_int_eq (ops->del_tunnel (1, 0x1001), RETURNok);
+  ck_assert_int_eq (ops->del_tunnel (1, 0x1001), RETURNerror);
+  pkts[0].len = gtpu_g_pdu (buffers[0], 3, gtpu_ue (0), 100);
+  pkts[0].data = buffers[0];
+  gtpu_us_uplink_burst (pkts, 1, 0, &stats);
+  ck_assert_int_eq (pkts[0].verdict, GTPU_US_TO_SGI);
+  pkts[0].data = &buffers[0][GTPU_US_HEADROOM];
+  pkts[0].len = gtpu_ip_packet (pkts[0].data, gtpu_addr (GTPU_SGI_ADDR), gtpu_ue (0), 100);
+  gtpu_us_downlink_burst (pkts, 1, 0, &stats);
+  ck_assert_int_eq (pkts[0].verdict, GTPU_US_DROP);
+
+  // tables grow and shrink
+  for (uint32_t i = 2; i < 100000; i++) {
+    ck_assert_int_eq (ops->add_tunnel (gtpu_ue (i), enb, 10 + i, i), RETURNok);
+  }
+  for (uint32_t i = 2; i < 100000; i += 2) {
+    ck_assert_int_eq (ops->del_tunnel (10 + i, i), RETURNok);
+  }
+  for (uint32_t i = 2; i < 100000; i++) {
+    pkts[0].len = gtpu_g_pdu (buffers[0], 10 + i, gtpu_ue (i), 0);
+    pkts[0].data = buffers[0];
+    gtpu_us_uplink_burst (pkts, 1, 0, &stats);
+    ck_assert_int_eq (pkts[0].verdict, (i & 1) ? GTPU_US_TO_SGI : GTPU_US_DROP);
+  }
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static uint32_t gtpu_downlink_o_tei (const struct in_addr src, const struct in_addr ue, const uint16_t sport)
+{
+  uint8_t          buffer[256] = {0};
+  gtpu_us_pkt_t    pkt = {.data = &buffer[GTPU_US_HEADROOM]};
+  gtpu_us_stats_t  stats = {0};
+  uint32_t         teid = 0;
+
+  pkt.len = gtpu_ip_packet (pkt.data, src, ue, 100);
+  pkt.data[20] = sport >> 8;
+  pkt.data[21] = sport & 0xFF;
+  gtpu_us_downlink_burst (&pkt, 1, 0, &stats);
+  if (pkt.verdict != GTPU_US_TO_S1U) {
+    return 0;
+  }
+  memcpy (&teid, &pkt.data[4], 4);
+  return ntohl (teid);
+}
+
+START_TEST(gtpu_sdf_steering_test)
+{
+  packet_filter_contents_t pf = {0};
+  struct in_addr           enb = gtpu_addr (GTPU_ENB_ADDR);
+  struct in_addr           sgi = gtpu_addr (GTPU_SGI_ADDR);
+  struct in_addr           other = gtpu_addr ("172.16.0.1");
+
+  // SDF 5: SIP from anywhere, SDF 6: anything from the SGi network, SIP wins
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG;
+  pf.protocolidentifier_nextheader = 17;
+  pf.singleremoteport = 5060;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&sdf_classifier, &pf, TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY, 10, 5), RETURNok);
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG;
+  memcpy (pf.ipv4remoteaddr, (uint8_t[]){192, 255, 168, 255, 100, 255, 0, 0}, 8);
+  ck_assert_int_eq (pgw_sdf_classifier_add (&sdf_classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 20, 6), RETURNok);
+
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 1, 0x1001), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 3, 0x1003), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 4, 0x1004), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (1), enb, 2, 0x1002), RETURNok);
+  ck_assert_int_eq (ops->add_sdf_bearer (gtpu_ue (0), 5, 3), RETURNok);
+  ck_assert_int_eq (ops->add_sdf_bearer (gtpu_ue (0), 6, 4), RETURNok);
+  ck_assert_int_eq (ops->add_sdf_bearer (gtpu_ue (9), 6, 4), RETURNerror);
+
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 12345), 0x1004);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 5060), 0x1003);
+  ck_assert_int_eq (gtpu_downlink_o_tei (other, gtpu_ue (0), 5060), 0x1003);
+  ck_assert_int_eq (gtpu_downlink_o_tei (other, gtpu_ue (0), 12345), 0x1001);
+  // UE without dedicated bearer
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (1), 5060), 0x1002);
+
+  // the eNB changes, the steering stays
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 1, 0x2001), RETURNok);
+  ck_assert_int_eq (gtpu_downlink_o_tei (other, gtpu_ue (0), 12345), 0x2001);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 5060), 0x1003);
+
+  // SIP is the best match, without its bearer it goes to the first one
+  ck_assert_int_eq (ops->del_sdf_bearer (gtpu_ue (0), 5), RETURNok);
+  ck_assert_int_eq (ops->del_sdf_bearer (gtpu_ue (0), 5), RETURNerror);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 5060), 0x2001);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 12345), 0x1004);
+  // deleting the tunnel of the dedicated bearer drops its steering
+  ck_assert_int_eq (ops->del_tunnel (4, 0x1004), RETURNok);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 12345), 0x2001);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (1), enb, 4, 0x1005), RETURNok);
+  ck_assert_int_eq (gtpu_downlink_o_tei (sgi, gtpu_ue (0), 12345), 0x2001);
+  ck_assert_int_eq (ops->del_sdf_bearer (gtpu_ue (0), 6), RETURNerror);
+}
+END_TEST
+
+START_TEST(gtpu_bench_test)
+{
+  gtpu_capture_t  *capture = calloc (1, sizeof (gtpu_capture_t));
+  uint8_t        (*inner)[GTPU_US_BUFFER_SIZE] = calloc (GTPU_BENCH_PACKETS, GTPU_US_BUFFER_SIZE);
+  uint32_t        *inner_len = calloc (GTPU_BENCH_PACKETS, sizeof (uint32_t));
+  gtpu_us_pkt_t    pkts[GTPU_US_BURST_SIZE];
+  gtpu_us_stats_t  stats = {0};
+  uint64_t         ul_us = 0;
+  uint64_t         dl_us = 0;
+  uint64_t         start_us = 0;
+  const char      *pcap = getenv ("GTPU_BENCH_PCAP");
+
+  ck_assert_ptr_ne (capture, NULL);
+  // per bearer counting as in a worker, counter ids are dense and there are fewer tunnels than packets
+  stats.bearers = calloc (GTPU_BENCH_PACKETS, sizeof (gtpu_us_counters_t));
+  if (pcap) {
+    gtpu_capture_load (capture, pcap);
+  } else {
+    gtpu_capture_synthesize (capture);
+  }
+  ck_assert_int_ge (capture->nb_pkts, 1);
+
+  // one tunnel per TEID found in the capture, the UE is the source of its packets
+  for (uint32_t i = 0; i < capture->nb_pkts; i++) {
+    gtpu_us_pkt_t pkt = {.data = capture->data[i], .len = capture->len[i]};
+    uint32_t      teid = 0;
+    uint32_t      hdr_len = (capture->data[i][0] & 0x07) ? 12 : 8;
+
+    if (capture->data[i][0] & 0x04) {
+      for (uint8_t next = capture->data[i][11]; next && hdr_len < capture->len[i] && capture->data[i][hdr_len]; hdr_len += 4 * capture->data[i][hdr_len]) {
+        next = capture->data[i][hdr_len + 4 * capture->data[i][hdr_len] - 1];
+      }
+    }
+    memcpy (&teid, &capture->data[i][4], 4);
+    if ((capture->data[i][1] == GTPU_G_PDU) && (capture->len[i] > hdr_len + 20)) {
+      struct in_addr ue;
+
+      memcpy (&ue, &capture->data[i][hdr_len + 12], 4);
+      ops->add_tunnel (ue, capture->enb[i], ntohl (teid), ntohl (teid));
+    }
+    gtpu_us_uplink_burst (&pkt, 1, 0, &stats);
+    if (pkt.verdict == GTPU_US_TO_SGI) {
+      // the answer: same packet, addresses swapped
+      memcpy (&inner[i][GTPU_US_HEADROOM], pkt.data, pkt.len);
+      memcpy (&inner[i][GTPU_US_HEADROOM + 12], &pkt.data[16], 4);
+      memcpy (&inner[i][GTPU_US_HEADROOM + 16], &pkt.data[12], 4);
+      inner_len[i] = pkt.len;
+    }
+  }
+
+  start_us = gtpu_time_us ();
+  for (int r = 0; r < GTPU_BENCH_ROUNDS; r++) {
+    for (uint32_t i = 0; i < capture->nb_pkts; i += GTPU_US_BURST_SIZE) {
+      uint32_t nb = (capture->nb_pkts - i < GTPU_US_BURST_SIZE) ? capture->nb_pkts - i : GTPU_US_BURST_SIZE;
+
+      for (uint32_t j = 0; j < nb; j++) {
+        pkts[j].data = capture->data[i + j];
+        pkts[j].len = capture->len[i + j];
+      }
+      gtpu_us_uplink_burst (pkts, nb, 0, &stats);
+    }
+  }
+  ul_us = gtpu_time_us () - start_us + 1;
+
+  start_us = gtpu_time_us ();
+  for (int r = 0; r < GTPU_BENCH_ROUNDS; r++) {
+    for (uint32_t i = 0; i < capture->nb_pkts; i += GTPU_US_BURST_SIZE) {
+      uint32_t nb = (capture->nb_pkts - i < GTPU_US_BURST_SIZE) ? capture->nb_pkts - i : GTPU_US_BURST_SIZE;
+
+      for (uint32_t j = 0; j < nb; j++) {
+        pkts[j].data = &inner[i + j][GTPU_US_HEADROOM];
+        pkts[j].len = inner_len[i + j];
+      }
+      gtpu_us_downlink_burst (pkts, nb, 0, &stats);
+    }
+  }
+  dl_us = gtpu_time_us () - start_us + 1;
+
+  printf ("GTP-U processing, %u packets from %s: UL %.2f Mpps, DL %.2f Mpps per core (%" PRIu64 " dropped)\n",
+      capture->nb_pkts, (pcap) ? pcap : "synthetic traffic",
+      (double)capture->nb_pkts * GTPU_BENCH_ROUNDS / ul_us, (double)capture->nb_pkts * GTPU_BENCH_ROUNDS / dl_us, stats.drops);
+  free (stats.bearers);
+  free (inner_len);
+  free (inner);
+  free (capture);
+}
+END_TEST
+
+START_TEST(gtpu_qos_test)
+{
+  gtpu_capture_t  *capture = calloc (1, sizeof (gtpu_capture_t));
+  uint8_t          buffers[GTPU_US_BURST_SIZE][GTPU_US_HEADROOM + 1000];
+  gtpu_us_pkt_t    pkts[GTPU_US_BURST_SIZE];
+  gtpu_us_stats_t  stats = {0};
+  uint64_t         bytes[GTPU_QOS_FLOWS] = {0};
+  uint64_t         dl_bytes = 0;
+  uint64_t         duration_ns = 0;
+  uint64_t         start_us = 0;
+  uint64_t         metered_us = 0;
+  uint64_t         free_us = 0;
+  struct in_addr   enb = gtpu_addr (GTPU_ENB_ADDR);
+
+  ck_assert_ptr_ne (capture, NULL);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 1, 0x1001), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 2, 0x1002), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (0), enb, 3, 0x1003), RETURNok);
+  ck_assert_int_eq (ops->add_tunnel (gtpu_ue (1), enb, 4, 0x1004), RETURNok);
+  // APN-AMBR 10 Mbps UL 20 Mbps DL shared by TEID 1 and 2, MBR of 2 Mbps on TEID 3
+  ck_assert_int_eq (ops->set_qos (1, 0, 0, 10000, 20000), RETURNok);
+  ck_assert_int_eq (ops->set_qos (2, 0, 0, 10000, 20000), RETURNok);
+  ck_assert_int_eq (ops->set_qos (3, 2000, 2000, 0, 0), RETURNok);
+  ck_assert_int_eq (ops->set_qos (5, 2000, 2000, 0, 0), RETURNerror);
+
+  gtpu_capture_rates (capture);
+  duration_ns = (capture->ts_ns[capture->nb_pkts - 1] + GTPU_QOS_SLOT_NS) * GTPU_QOS_LOOPS;
+  gtpu_capture_replay (capture, GTPU_QOS_LOOPS, bytes, &stats);
+  gtpu_rate_check ("UL APN-AMBR of UE 0", bytes[0] + bytes[1], 10000, duration_ns);
+  gtpu_rate_check ("UL MBR of the GBR bearer", bytes[2], 2000, duration_ns);
+  gtpu_rate_check ("UL of UE 1", bytes[3], 40000, duration_ns);
+  ck_assert_int_gt (bytes[0], bytes[1] / 2);
+  ck_assert_int_gt (bytes[1], bytes[0] / 2);
+  ck_assert_int_eq (stats.policed, stats.drops);
+
+  // downlink of UE 0 at 40 Mbps, on its default bearer
+  for (uint64_t ts_ns = 0; ts_ns < duration_ns; ts_ns += GTPU_US_BURST_SIZE * GTPU_QOS_SLOT_NS) {
+    for (int j = 0; j < GTPU_US_BURST_SIZE; j++) {
+      pkts[j].data = &buffers[j][GTPU_US_HEADROOM];
+      pkts[j].len = gtpu_ip_packet (pkts[j].data, gtpu_addr (GTPU_SGI_ADDR), gtpu_ue (0), 1000 - 28);
+    }
+    gtpu_us_downlink_burst (pkts, GTPU_US_BURST_SIZE, ts_ns, &stats);
+    for (int j = 0; j < GTPU_US_BURST_SIZE; j++) {
+      dl_bytes += (pkts[j].verdict == GTPU_US_TO_S1U) ? pkts[j].len - 8 : 0;
+    }
+  }
+  gtpu_rate_check ("DL APN-AMBR of UE 0", dl_bytes, 20000, duration_ns);
+
+  // cost of the policing, rates high enough for all the packets to pass
+  for (uint32_t teid = 1; teid <= GTPU_QOS_FLOWS; teid++) {
+    ck_assert_int_eq (ops->set_qos (teid, 0, 0, 0, 0), RETURNok);
+  }
+  start_us = gtpu_time_us ();
+  gtpu_capture_replay (capture, GTPU_QOS_BENCH_LOOPS, NULL, &stats);
+  free_us = gtpu_time_us () - start_us;
+  ck_assert_int_eq (ops->set_qos (1, 0, 0, 100000000, 100000000), RETURNok);
+  ck_assert_int_eq (ops->set_qos (2, 0, 0, 100000000, 100000000), RETURNok);
+  ck_assert_int_eq (ops->set_qos (3, 100000000, 100000000, 0, 0), RETURNok);
+  ck_assert_int_eq (ops->set_qos (4, 100000000, 100000000, 100000000, 100000000), RETURNok);
+  stats.policed = 0;
+  start_us = gtpu_time_us ();
+  gtpu_capture_replay (capture, GTPU_QOS_BENCH_LOOPS, NULL, &stats);
+  metered_us = gtpu_time_us () - start_us;
+  ck_assert_int_eq (stats.policed, 0);
+  printf ("GTP-U uplink: %.1f ns per packet without rates, %.1f ns with MBR and APN-AMBR\n",
+      (double)free_us * 1000 / ((uint64_t)capture->nb_pkts * GTPU_QOS_BENCH_LOOPS), (double)metered_us * 1000 / ((uint64_t)capture->nb_pkts * GTPU_QOS_BENCH_LOOPS));
+  free (capture);
+}
+END_TEST
+
+START_TEST(gtpu_loopback_test)
+{
+  struct in_addr      ue_net = gtpu_addr ("10.0.0.0");
+  struct sockaddr_in  enb_addr = {.sin_family = AF_INET, .sin_port = htons (2152), .sin_addr = gtpu_addr (GTPU_ENB_ADDR)};
+  struct sockaddr_in  sgw_addr = {.sin_family = AF_INET, .sin_port = htons (2152), .sin_addr = gtpu_addr ("127.0.0.1")};
+  struct sockaddr_in  sgi_addr = {.sin_family = AF_INET, .sin_port = htons (GTPU_SGI_PORT), .sin_addr = gtpu_addr (GTPU_SGI_ADDR)};
+  struct sockaddr_in  ue_addr = {.sin_family = AF_INET, .sin_port = htons (GTPU_SGI_PORT)};
+  struct sockaddr_in  from_addr = {0};
+  socklen_t           from_len = sizeof (from_addr);
+  struct timeval      tv = {.tv_sec = 1};
+  uint8_t             buffers[GTPU_US_BURST_SIZE][256];
+  struct iovec        iovs[GTPU_US_BURST_SIZE];
+  struct mmsghdr      msgs[GTPU_US_BURST_SIZE];
+  uint8_t             seen[GTPU_LOOPBACK_PACKETS] = {0};
+  int                 fd0 = -1;
+  int                 fd1u = -1;
+  int                 enb_fd = socket (AF_INET, SOCK_DGRAM, 0);
+  int                 sgi_fd = socket (AF_INET, SOCK_DGRAM, 0);
+  int                 bufsize = 16 * 1024 * 1024;
+  uint32_t            teid = 0;
+  uint32_t            seq = 0;
+  uint32_t            received = 0;
+  uint64_t            start_us = 0;
+  uint64_t            elapsed_us = 0;
+  gtpu_us_counters_t  usage = {0};
+
+  if (!netns_enabled) {
+    return;
+  }
+  ck_assert_int_eq (system ("ip link set dev lo up && ip addr add " GTPU_SGI_ADDR "/32 dev lo"), 0);
+  ck_assert_int_eq (ops->init (&ue_net, 8, 1500, &fd0, &fd1u), RETURNok);
+  ck_assert_int_ge (fd1u, 0);
+  ck_assert_int_eq (bind (enb_fd, (struct sockaddr *)&enb_addr, sizeof (enb_addr)), 0);
+  ck_assert_int_eq (bind (sgi_fd, (struct sockaddr *)&sgi_addr, sizeof (sgi_addr)), 0);
+  setsockopt (sgi_fd, SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof (bufsize));
+  setsockopt (enb_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+  setsockopt (sgi_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+  for (uint32_t i = 0; i < GTPU_BENCH_UES; i++) {
+    ck_assert_int_eq (ops->add_tunnel (gtpu_ue (i), enb_addr.sin_addr, 1 + i, 0x10000 + i), RETURNok);
+  }
+
+  // uplink: eNB -> S1-U -> fast path -> TUN -> SGi socket, the payload carries the sequence number
+  for (int i = 0; i < GTPU_US_BURST_SIZE; i++) {
+    iovs[i].iov_base = buffers[i];
+    memset (&msgs[i], 0, sizeof (msgs[i]));
+    msgs[i].msg_hdr.msg_name = &sgw_addr;
+    msgs[i].msg_hdr.msg_namelen = sizeof (sgw_addr);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  start_us = gtpu_time_us ();
+  for (uint32_t burst = 0; burst < GTPU_LOOPBACK_BURSTS; burst++) {
+    for (int i = 0; i < GTPU_US_BURST_SIZE; i++) {
+      seq = htonl (burst * GTPU_US_BURST_SIZE + i);
+      iovs[i].iov_len = gtpu_g_pdu (buffers[i], 1 + ntohl (seq) % GTPU_BENCH_UES, gtpu_ue (ntohl (seq) % GTPU_BENCH_UES), 36);
+      memcpy (&buffers[i][8 + 28], &seq, 4);
+    }
+    ck_assert_int_eq (sendmmsg (enb_fd, msgs, GTPU_US_BURST_SIZE, 0), GTPU_US_BURST_SIZE);
+    for (int i = 0; i < GTPU_US_BURST_SIZE; i++) {
+      from_len = sizeof (from_addr);
+      if (recvfrom (sgi_fd, buffers[0], sizeof (buffers[0]), 0, (struct sockaddr *)&from_addr, &from_len) != 36) {
+        break;
+      }
+      memcpy (&seq, buffers[0], 4);
+      seq = ntohl (seq);
+      ck_assert_int_lt (seq, GTPU_LOOPBACK_PACKETS);
+      ck_assert_int_eq (seen[seq], 0);
+      ck_assert_int_eq (from_addr.sin_addr.s_addr, gtpu_ue (seq % GTPU_BENCH_UES).s_addr);
+      seen[seq] = 1;
+      received++;
+    }
+  }
+  elapsed_us = gtpu_time_us () - start_us;
+  printf ("GTP-U loopback uplink: %u of %u packets in %u us\n", received, GTPU_LOOPBACK_PACKETS, (uint32_t)elapsed_us);
+  ck_assert_int_eq (received, GTPU_LOOPBACK_PACKETS);
+
+  // downlink: SGi socket -> TUN -> fast path -> S1-U -> eNB, one packet to each of the first UEs
+  for (uint32_t i = 0; i < GTPU_US_BURST_SIZE; i++) {
+    ue_addr.sin_addr = gtpu_ue (i);
+    seq = htonl (i);
+    memcpy (buffers[1], "dl", 2);
+    memcpy (&buffers[1][2], &seq, 4);
+    memcpy (&buffers[1][6], "dl", 2);
+    ck_assert_int_eq (sendto (sgi_fd, buffers[1], 8, 0, (struct sockaddr *)&ue_addr, sizeof (ue_addr)), 8);
+    ck_assert_int_eq (recv (enb_fd, buffers[0], sizeof (buffers[0]), 0), 8 + 28 + 8);
+    ck_assert_int_eq (buffers[0][1], GTPU_G_PDU);
+    memcpy (&teid, &buffers[0][4], 4);
+    ck_assert_int_eq (ntohl (teid), 0x10000 + i);
+    ck_assert_int_eq (memcmp (&buffers[0][8 + 16], &ue_addr.sin_addr, 4), 0);
+    ck_assert_int_eq (memcmp (&buffers[0][8 + 28], buffers[1], 8), 0);
+  }
+
+  // echo
+  memcpy (buffers[0], (uint8_t[]){0x32, GTPU_ECHO_REQUEST, 0, 4, 0, 0, 0, 0, 0, 42, 0, 0}, 12);
+  ck_assert_int_eq (sendto (enb_fd, buffers[0], 12, 0, (struct sockaddr *)&sgw_addr, sizeof (sgw_addr)), 12);
+  ck_assert_int_eq (recv (enb_fd, buffers[0], sizeof (buffers[0]), 0), 14);
+  ck_assert_int_eq (buffers[0][1], GTPU_ECHO_RESPONSE);
+  ck_assert_int_eq (buffers[0][9], 42);
+
+  // the packets are counted on the default bearer of each UE, reported when the tunnel goes
+  unlink (GTPU_USAGE_FILE);
+  ck_assert_int_eq (gtpu_us_usage_report_start (GTPU_USAGE_FILE, 1), RETURNok);
+  ck_assert_int_eq (ops->del_tunnel (1, 0x10000), RETURNok);
+  usleep (1500000);
+  ck_assert (gtpu_usage_find (1, "closed", &usage));
+  ck_assert_int_eq (usage.ul_packets, GTPU_LOOPBACK_PACKETS / GTPU_BENCH_UES);
+  ck_assert_int_eq (usage.ul_bytes, (GTPU_LOOPBACK_PACKETS / GTPU_BENCH_UES) * (28 + 36));
+  ck_assert_int_eq (usage.dl_packets, 1);
+  ck_assert_int_eq (usage.dl_bytes, 36);
+  ck_assert (gtpu_usage_find (2, "active", &usage));
+  ck_assert_int_eq (usage.dl_packets, 1);
+  ck_assert (gtpu_usage_find (1 + GTPU_US_BURST_SIZE, "active", &usage));
+  ck_assert_int_eq (usage.dl_packets, 0);
+  unlink (GTPU_USAGE_FILE);
+  close (enb_fd);
+  close (sgi_fd);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void gtpu_setup (void)
+{
+  ck_assert_int_eq (pgw_sdf_classifier_init (&sdf_classifier), RETURNok);
+  ops = gtp_tunnel_ops_userspace_init (gtpu_addr ("127.0.0.1"), 1, 0, &sdf_classifier);
+  ck_assert_ptr_ne (ops, NULL);
+}
+
+//------------------------------------------------------------------------------
+static void gtpu_teardown (void)
+{
+  ck_assert_int_eq (ops->uninit (), RETURNok);
+  ops = NULL;
+  pgw_sdf_classifier_destroy (&sdf_classifier);
+}
+
+Suite * gtpu_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("GTP-U userspace fast path tests");
+
+    tc_core = tcase_create("GTP-U userspace fast path test");
+    tcase_add_checked_fixture(tc_core, gtpu_setup, gtpu_teardown);
+    tcase_add_test(tc_core, gtpu_codec_test);
+    tcase_add_test(tc_core, gtpu_sdf_steering_test);
+    tcase_add_test(tc_core, gtpu_bench_test);
+    tcase_add_test(tc_core, gtpu_qos_test);
+    tcase_add_test(tc_core, gtpu_loopback_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    // The loopback test runs in its own network namespace, needs CAP_SYS_ADMIN
+    netns_enabled = (0 == unshare (CLONE_NEWNET));
+    if (!netns_enabled) {
+      printf ("Cannot create a network namespace, GTP-U loopback test skipped\n");
+    }
+    s = gtpu_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,357 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cIe.h"
+#include "NwGtpv2cMsg.h"
+#include "NwGtpv2cMsgParser.h"
+
+#define PARSER_BENCH_ITERATIONS 100000
+
+// Create Session Request from MME, attach with IMSI, 1 default bearer
+static uint8_t parser_create_session_request[] = {
+  0x48, 0x20, 0x00, 0xc8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x08, 0x00,
+  0x21, 0x43, 0x65, 0x87, 0x09, 0x21, 0x43, 0xf5, 0x4c, 0x00, 0x06, 0x00, 0x33, 0x60, 0x10, 0x32,
+  0x54, 0xf6, 0x4b, 0x00, 0x08, 0x00, 0x53, 0x61, 0x23, 0x45, 0x67, 0x89, 0x01, 0xf2, 0x56, 0x00,
+  0x0d, 0x00, 0x18, 0x02, 0xf8, 0x10, 0x00, 0x01, 0x02, 0xf8, 0x10, 0x00, 0x00, 0x01, 0x01, 0x53,
+  0x00, 0x03, 0x00, 0x02, 0xf8, 0x10, 0x52, 0x00, 0x01, 0x00, 0x06, 0x4d, 0x00, 0x02, 0x00, 0x00,
+  0x00, 0x57, 0x00, 0x09, 0x00, 0x8a, 0x00, 0x00, 0x00, 0x01, 0xc0, 0xa8, 0x0a, 0x01, 0x57, 0x00,
+  0x09, 0x01, 0x87, 0x00, 0x00, 0x00, 0x00, 0xc0, 0xa8, 0x0a, 0x02, 0x47, 0x00, 0x09, 0x00, 0x03,
+  0x6f, 0x61, 0x69, 0x04, 0x69, 0x70, 0x76, 0x34, 0x80, 0x00, 0x01, 0x00, 0x00, 0x63, 0x00, 0x01,
+  0x00, 0x01, 0x4f, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x00, 0x01, 0x00, 0x00,
+  0x48, 0x00, 0x08, 0x00, 0x00, 0x00, 0xc3, 0x50, 0x00, 0x00, 0xc3, 0x50, 0x4e, 0x00, 0x04, 0x00,
+  0x80, 0x00, 0x0d, 0x00, 0x5d, 0x00, 0x1f, 0x00, 0x49, 0x00, 0x01, 0x00, 0x05, 0x50, 0x00, 0x16,
+  0x00, 0x08, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00,
+};
+
+// Create Session Response from S-GW, request accepted
+static uint8_t parser_create_session_response[] = {
+  0x48, 0x21, 0x00, 0x5a, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x02, 0x00,
+  0x10, 0x00, 0x57, 0x00, 0x09, 0x00, 0x8b, 0x00, 0x00, 0x00, 0x01, 0xc0, 0xa8, 0x0a, 0x02, 0x57,
+  0x00, 0x09, 0x01, 0x87, 0x00, 0x00, 0x00, 0x02, 0xc0, 0xa8, 0x0a, 0x03, 0x4f, 0x00, 0x05, 0x00,
+  0x01, 0x0a, 0x00, 0x00, 0x02, 0x7f, 0x00, 0x01, 0x00, 0x00, 0x4e, 0x00, 0x04, 0x00, 0x80, 0x00,
+  0x0d, 0x00, 0x5d, 0x00, 0x18, 0x00, 0x49, 0x00, 0x01, 0x00, 0x05, 0x02, 0x00, 0x02, 0x00, 0x10,
+  0x00, 0x57, 0x00, 0x09, 0x00, 0x81, 0x00, 0x00, 0x00, 0x01, 0xc0, 0xa8, 0x0a, 0x02,
+};
+
+// Same response without its mandatory Cause IE
+static uint8_t parser_create_session_response_no_cause[] = {
+  0x48, 0x21, 0x00, 0x54, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x57, 0x00, 0x09, 0x00,
+  0x8b, 0x00, 0x00, 0x00, 0x01, 0xc0, 0xa8, 0x0a, 0x02, 0x57, 0x00, 0x09, 0x01, 0x87, 0x00, 0x00,
+  0x00, 0x02, 0xc0, 0xa8, 0x0a, 0x03, 0x4f, 0x00, 0x05, 0x00, 0x01, 0x0a, 0x00, 0x00, 0x02, 0x7f,
+  0x00, 0x01, 0x00, 0x00, 0x4e, 0x00, 0x04, 0x00, 0x80, 0x00, 0x0d, 0x00, 0x5d, 0x00, 0x18, 0x00,
+  0x49, 0x00, 0x01, 0x00, 0x05, 0x02, 0x00, 0x02, 0x00, 0x10, 0x00, 0x57, 0x00, 0x09, 0x00, 0x81,
+  0x00, 0x00, 0x00, 0x01, 0xc0, 0xa8, 0x0a, 0x02,
+};
+
+typedef struct parser_ie_rec_s {
+  int      count;
+  uint8_t  type;
+  uint8_t  instance;
+  uint8_t  length;
+} parser_ie_rec_t;
+
+typedef struct parser_ctx_s {
+  parser_ie_rec_t imsi;
+  parser_ie_rec_t msisdn;
+  parser_ie_rec_t mei;
+  parser_ie_rec_t uli;
+  parser_ie_rec_t serving_network;
+  parser_ie_rec_t rat_type;
+  parser_ie_rec_t indication;
+  parser_ie_rec_t apn;
+  parser_ie_rec_t pdn_type;
+  parser_ie_rec_t paa;
+  parser_ie_rec_t sender_fteid;
+  parser_ie_rec_t pgw_fteid;
+  parser_ie_rec_t bearer_context;
+  parser_ie_rec_t pco;
+  parser_ie_rec_t ambr;
+  parser_ie_rec_t cause;
+  parser_ie_rec_t generic;
+} parser_ctx_t;
+
+//------------------------------------------------------------------------------
+static nw_rc_t parser_test_ie_get (uint8_t ieType, uint8_t ieLength, uint8_t ieInstance, uint8_t * ieValue, void *arg)
+{
+  parser_ie_rec_t *rec = (parser_ie_rec_t *) arg;
+
+  if (rec) {
+    rec->count += 1;
+    rec->type = ieType;
+    rec->instance = ieInstance;
+    rec->length = ieLength;
+  }
+  return NW_OK;
+}
+
+#define PARSER_IE(tYpE, iNsT, pReSeNcE, fIeLd) {tYpE, iNsT, pReSeNcE, parser_test_ie_get, offsetof (parser_ctx_t, fIeLd)}
+
+// Same IEs as the S-GW Create Session Request parser
+static const nw_gtpv2c_msg_parser_ie_t parser_create_session_request_ies[] = {
+  PARSER_IE (NW_GTPV2C_IE_IMSI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, imsi),
+  PARSER_IE (NW_GTPV2C_IE_MSISDN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, msisdn),
+  PARSER_IE (NW_GTPV2C_IE_MEI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, mei),
+  PARSER_IE (NW_GTPV2C_IE_ULI, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, uli),
+  PARSER_IE (NW_GTPV2C_IE_SERVING_NETWORK, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, serving_network),
+  PARSER_IE (NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, rat_type),
+  PARSER_IE (NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, indication),
+  PARSER_IE (NW_GTPV2C_IE_APN, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, apn),
+  PARSER_IE (NW_GTPV2C_IE_SELECTION_MODE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, generic),
+  PARSER_IE (NW_GTPV2C_IE_PDN_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, pdn_type),
+  PARSER_IE (NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, paa),
+  PARSER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, sender_fteid),
+  PARSER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, pgw_fteid),
+  PARSER_IE (NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, generic),
+  PARSER_IE (NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, bearer_context),
+  PARSER_IE (NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, pco),
+  PARSER_IE (NW_GTPV2C_IE_AMBR, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, ambr),
+  PARSER_IE (NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, generic),
+};
+
+// Same IEs as the MME Create Session Response parser
+static const nw_gtpv2c_msg_parser_ie_t parser_create_session_response_ies[] = {
+  PARSER_IE (NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, cause),
+  PARSER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, sender_fteid),
+  PARSER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, pgw_fteid),
+  PARSER_IE (NW_GTPV2C_IE_PAA, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, paa),
+  PARSER_IE (NW_GTPV2C_IE_APN_RESTRICTION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, generic),
+  PARSER_IE (NW_GTPV2C_IE_PCO, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, pco),
+  PARSER_IE (NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, bearer_context),
+};
+
+#define PARSER_ARRAY_SIZE(aRrAy) (sizeof (aRrAy) / sizeof (aRrAy[0]))
+
+static nw_gtpv2c_stack_handle_t parser_stack = 0;
+
+//------------------------------------------------------------------------------
+static nw_rc_t parser_legacy_run (const uint8_t msg_type, const nw_gtpv2c_msg_parser_ie_t * const ies, const int ie_count,
+                                  nw_gtpv2c_msg_handle_t hMsg, parser_ctx_t * const ctx, uint8_t * const offending_ie_type)
+{
+  nw_gtpv2c_msg_parser_t *pMsgParser = NULL;
+  uint8_t                 offending_ie_instance = 0;
+  uint16_t                offending_ie_length = 0;
+  nw_rc_t                 rc = NW_OK;
+
+  rc = nwGtpv2cMsgParserNew (parser_stack, msg_type, parser_test_ie_get, &ctx->generic, &pMsgParser);
+  ck_assert_int_eq (rc, NW_OK);
+  for (int i = 0; i < ie_count; i++) {
+    rc = nwGtpv2cMsgParserAddIe (pMsgParser, ies[i].ieType, ies[i].ieInstance, ies[i].iePresence, ies[i].ieReadCallback,
+                                 (uint8_t *) ctx + ies[i].ieReadCallbackArgOffset);
+    ck_assert_int_eq (rc, NW_OK);
+  }
+  rc = nwGtpv2cMsgParserRun (pMsgParser, hMsg, offending_ie_type, &offending_ie_instance, &offending_ie_length);
+  nwGtpv2cMsgParserDelete (parser_stack, pMsgParser);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t parser_template_run (const nw_gtpv2c_msg_parser_template_t * const parser, nw_gtpv2c_msg_handle_t hMsg,
+                                    parser_ctx_t * const ctx, uint8_t * const offending_ie_type)
+{
+  uint8_t                 offending_ie_instance = 0;
+  uint16_t                offending_ie_length = 0;
+
+  return nwGtpv2cMsgParserTemplateRun (parser, hMsg, ctx, offending_ie_type, &offending_ie_instance, &offending_ie_length);
+}
+
+//------------------------------------------------------------------------------
+static uint64_t parser_time_ns (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static void parser_compare (const uint8_t msg_type, const nw_gtpv2c_msg_parser_ie_t * const ies, const int ie_count,
+                            uint8_t * const buffer, const uint32_t length, const nw_rc_t expected_rc)
+{
+  nw_gtpv2c_msg_parser_template_t parser;
+  nw_gtpv2c_msg_handle_t          hMsg = 0;
+  parser_ctx_t                    legacy_ctx;
+  parser_ctx_t                    template_ctx;
+  uint8_t                         legacy_offending_ie_type = 0;
+  uint8_t                         template_offending_ie_type = 0;
+
+  memset (&legacy_ctx, 0, sizeof (legacy_ctx));
+  memset (&template_ctx, 0, sizeof (template_ctx));
+  ck_assert_int_eq (nwGtpv2cMsgParserTemplateInit (&parser, msg_type, parser_test_ie_get, ies, ie_count), NW_OK);
+  ck_assert_int_eq (nwGtpv2cMsgFromBufferNew (parser_stack, buffer, length, &hMsg), NW_OK);
+  ck_assert_int_eq (parser_legacy_run (msg_type, ies, ie_count, hMsg, &legacy_ctx, &legacy_offending_ie_type), expected_rc);
+  ck_assert_int_eq (parser_template_run (&parser, hMsg, &template_ctx, &template_offending_ie_type), expected_rc);
+  ck_assert_int_eq (legacy_offending_ie_type, template_offending_ie_type);
+  if (NW_OK == expected_rc) {
+    ck_assert (memcmp (&legacy_ctx, &template_ctx, sizeof (parser_ctx_t)) == 0);
+    ck_assert_int_eq (template_ctx.bearer_context.count, 1);
+    ck_assert_int_eq (template_ctx.pgw_fteid.instance, NW_GTPV2C_IE_INSTANCE_ONE);
+  }
+  nwGtpv2cMsgDelete (parser_stack, hMsg);
+}
+
+START_TEST(parser_create_session_request_test)
+{
+  parser_compare (NW_GTP_CREATE_SESSION_REQ, parser_create_session_request_ies, PARSER_ARRAY_SIZE (parser_create_session_request_ies),
+                  parser_create_session_request, sizeof (parser_create_session_request), NW_OK);
+}
+END_TEST
+
+START_TEST(parser_create_session_response_test)
+{
+  parser_compare (NW_GTP_CREATE_SESSION_RSP, parser_create_session_response_ies, PARSER_ARRAY_SIZE (parser_create_session_response_ies),
+                  parser_create_session_response, sizeof (parser_create_session_response), NW_OK);
+}
+END_TEST
+
+START_TEST(parser_mandatory_ie_missing_test)
+{
+  nw_gtpv2c_msg_parser_template_t parser;
+  nw_gtpv2c_msg_handle_t          hMsg = 0;
+  parser_ctx_t                    ctx = {{0}};
+  uint8_t                         offending_ie_type = 0;
+
+  parser_compare (NW_GTP_CREATE_SESSION_RSP, parser_create_session_response_ies, PARSER_ARRAY_SIZE (parser_create_session_response_ies),
+                  parser_create_session_response_no_cause, sizeof (parser_create_session_response_no_cause), NW_GTPV2C_MANDATORY_IE_MISSING);
+  ck_assert_int_eq (nwGtpv2cMsgParserTemplateInit (&parser, NW_GTP_CREATE_SESSION_RSP, parser_test_ie_get,
+                                                   parser_create_session_response_ies, PARSER_ARRAY_SIZE (parser_create_session_response_ies)), NW_OK);
+  ck_assert_int_eq (nwGtpv2cMsgFromBufferNew (parser_stack, parser_create_session_response_no_cause,
+                                              sizeof (parser_create_session_response_no_cause), &hMsg), NW_OK);
+  ck_assert_int_eq (parser_template_run (&parser, hMsg, &ctx, &offending_ie_type), NW_GTPV2C_MANDATORY_IE_MISSING);
+  ck_assert_int_eq (offending_ie_type, NW_GTPV2C_IE_CAUSE);
+  nwGtpv2cMsgDelete (parser_stack, hMsg);
+}
+END_TEST
+
+START_TEST(parser_truncated_ie_test)
+{
+  nw_gtpv2c_msg_parser_template_t parser;
+  nw_gtpv2c_msg_handle_t          hMsg = 0;
+  parser_ctx_t                    ctx = {{0}};
+  uint8_t                         buffer[sizeof (parser_create_session_response) + 2];
+  uint8_t                         offending_ie_type = 0;
+  uint8_t                         offending_ie_instance = 0;
+  uint16_t                        offending_ie_length = 0;
+
+  // Trailing IE with only 2 bytes of its 4 bytes header
+  memcpy (buffer, parser_create_session_response, sizeof (parser_create_session_response));
+  buffer[sizeof (parser_create_session_response)] = NW_GTPV2C_IE_RECOVERY;
+  buffer[sizeof (parser_create_session_response) + 1] = 0x00;
+  buffer[3] += 2;
+  ck_assert_int_eq (nwGtpv2cMsgParserTemplateInit (&parser, NW_GTP_CREATE_SESSION_RSP, parser_test_ie_get,
+                                                   parser_create_session_response_ies, PARSER_ARRAY_SIZE (parser_create_session_response_ies)), NW_OK);
+  ck_assert_int_eq (nwGtpv2cMsgFromBufferNew (parser_stack, buffer, sizeof (buffer), &hMsg), NW_OK);
+  ck_assert_int_eq (nwGtpv2cMsgParserTemplateRun (&parser, hMsg, &ctx, &offending_ie_type, &offending_ie_instance, &offending_ie_length),
+                    NW_GTPV2C_MSG_MALFORMED);
+  ck_assert_int_eq (ctx.cause.count, 1);
+  nwGtpv2cMsgDelete (parser_stack, hMsg);
+}
+END_TEST
+
+START_TEST(parser_benchmark_test)
+{
+  const struct {
+    const char                      *name;
+    uint8_t                          msg_type;
+    const nw_gtpv2c_msg_parser_ie_t *ies;
+    int                              ie_count;
+    uint8_t                         *buffer;
+    uint32_t                         length;
+  } messages[] = {
+    {"Create Session Request", NW_GTP_CREATE_SESSION_REQ, parser_create_session_request_ies, PARSER_ARRAY_SIZE (parser_create_session_request_ies),
+     parser_create_session_request, sizeof (parser_create_session_request)},
+    {"Create Session Response", NW_GTP_CREATE_SESSION_RSP, parser_create_session_response_ies, PARSER_ARRAY_SIZE (parser_create_session_response_ies),
+     parser_create_session_response, sizeof (parser_create_session_response)},
+  };
+
+  for (int m = 0; m < PARSER_ARRAY_SIZE (messages); m++) {
+    nw_gtpv2c_msg_parser_template_t parser;
+    nw_gtpv2c_msg_handle_t          hMsg = 0;
+    parser_ctx_t                    ctx;
+    uint8_t                         offending_ie_type = 0;
+    uint64_t                        legacy_ns = 0;
+    uint64_t                        template_ns = 0;
+    uint64_t                        start_ns = 0;
+
+    ck_assert_int_eq (nwGtpv2cMsgParserTemplateInit (&parser, messages[m].msg_type, parser_test_ie_get, messages[m].ies, messages[m].ie_count), NW_OK);
+    ck_assert_int_eq (nwGtpv2cMsgFromBufferNew (parser_stack, messages[m].buffer, messages[m].length, &hMsg), NW_OK);
+
+    start_ns = parser_time_ns ();
+    for (int i = 0; i < PARSER_BENCH_ITERATIONS; i++) {
+      memset (&ctx, 0, sizeof (ctx));
+      ck_assert (NW_OK == parser_legacy_run (messages[m].msg_type, messages[m].ies, messages[m].ie_count, hMsg, &ctx, &offending_ie_type));
+    }
+    legacy_ns = parser_time_ns () - start_ns;
+
+    start_ns = parser_time_ns ();
+    for (int i = 0; i < PARSER_BENCH_ITERATIONS; i++) {
+      memset (&ctx, 0, sizeof (ctx));
+      ck_assert (NW_OK == parser_template_run (&parser, hMsg, &ctx, &offending_ie_type));
+    }
+    template_ns = parser_time_ns () - start_ns;
+
+    // No assertion on timings, they depend on the host
+    printf ("%s: per message parser %lu ns, parser template %lu ns\n", messages[m].name,
+            (unsigned long)(legacy_ns / PARSER_BENCH_ITERATIONS), (unsigned long)(template_ns / PARSER_BENCH_ITERATIONS));
+    nwGtpv2cMsgDelete (parser_stack, hMsg);
+  }
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void parser_setup (void)
+{
+  ck_assert_int_eq (nwGtpv2cInitialize (&parser_stack), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static void parser_teardown (void)
+{
+  nwGtpv2cFinalize (parser_stack);
+  parser_stack = 0;
+}
+
+Suite * parser_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("GTPv2-C message parser tests");
+
+    tc_core = tcase_create("GTPv2-C message parser test");
+    tcase_add_checked_fixture(tc_core, parser_setup, parser_teardown);
+    tcase_add_test(tc_core, parser_create_session_request_test);
+    tcase_add_test(tc_core, parser_create_session_response_test);
+    tcase_add_test(tc_core, parser_mandatory_ie_missing_test);
+    tcase_add_test(tc_core, parser_truncated_ie_test);
+    tcase_add_test(tc_core, parser_benchmark_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = parser_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,346 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cMsg.h"
+#include "NwGtpv2cIe.h"
+#include "NwGtpv2cPrivate.h"
+
+#define PEER_MME              0
+#define PEER_SGW              1
+#define PEER_QUEUE_SIZE       4096
+#define PEER_MAX_REQUESTS     1024
+#define PEER_REQUEST_GAP_MS   20
+#define PEER_PUMP_MS          5
+#define PEER_GTPV2C_PORT      2123
+// stack defaults: T3 2s, N3 2
+#define PEER_T3_N3_MS         (2000 * (2 + 1))
+#define PEER_ECHO_TRXN        0xEC0
+
+typedef struct peer_packet_s {
+  int                      dst;
+  uint32_t                 len;
+  uint8_t                  buf[1024];
+} peer_packet_t;
+
+typedef struct peer_tmr_mgr_s {
+  void                    *tick_arg;
+  bool                     running;
+} peer_tmr_mgr_t;
+
+typedef struct peer_mme_ulp_s {
+  uint32_t                 echo_rsp;
+  uint8_t                  restart_counter;
+  bool                     echo_failed;
+  uint32_t                 bulk_failed;
+  uint32_t                 rsp_failure;
+  uint32_t                 bad_failure;
+  uint64_t                 last_failure_ms;
+  bool                     failed[PEER_MAX_REQUESTS];
+} peer_mme_ulp_t;
+
+static nw_gtpv2c_stack_handle_t peer_stack[2] = {0};
+static peer_tmr_mgr_t           peer_tmr_mgr[2];
+static struct in_addr           peer_addr[2];
+static bool                     peer_sgw_alive = true;
+static uint32_t                 peer_sgw_rx = 0;
+static peer_packet_t            peer_queue[PEER_QUEUE_SIZE];
+static uint32_t                 peer_queue_head = 0;
+static uint32_t                 peer_queue_tail = 0;
+static peer_mme_ulp_t           peer_mme_ulp;
+
+//------------------------------------------------------------------------------
+static uint64_t peer_time_ms (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t peer_udp_data_req (nw_gtpv2c_udp_handle_t udpHandle, uint8_t * dataBuf, uint32_t dataSize, struct in_addr *peerIp, uint16_t peerPort)
+{
+  const int      dst = (PEER_MME == (int) udpHandle) ? PEER_SGW : PEER_MME;
+  peer_packet_t *packet = &peer_queue[peer_queue_tail % PEER_QUEUE_SIZE];
+
+  ck_assert_int_eq (peerIp->s_addr, peer_addr[dst].s_addr);
+  ck_assert (dataSize <= sizeof (packet->buf));
+  ck_assert (peer_queue_tail - peer_queue_head < PEER_QUEUE_SIZE);
+  packet->dst = dst;
+  packet->len = dataSize;
+  memcpy (packet->buf, dataBuf, dataSize);
+  peer_queue_tail += 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t peer_tmr_start (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, uint32_t timeoutSec, uint32_t timeoutUsec, uint32_t tmrType,
+                               void *timeoutArg, nw_gtpv2c_timer_handle_t * hTmr)
+{
+  peer_tmr_mgr_t *tmr_mgr = (peer_tmr_mgr_t *) tmrMgrHandle;
+
+  tmr_mgr->tick_arg = timeoutArg;
+  tmr_mgr->running = true;
+  *hTmr = 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t peer_tmr_stop (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, nw_gtpv2c_timer_handle_t tmrHandle)
+{
+  ((peer_tmr_mgr_t *) tmrMgrHandle)->running = false;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t peer_mme_ulp_req (nw_gtpv2c_ulp_handle_t hUlp, nw_gtpv2c_ulp_api_t * pUlpApi)
+{
+  peer_mme_ulp_t *ulp = (peer_mme_ulp_t *) hUlp;
+
+  switch (pUlpApi->apiType) {
+  case NW_GTPV2C_ULP_API_TRIGGERED_RSP_IND:
+    ck_assert_int_eq (pUlpApi->u_api_info.triggeredRspIndInfo.msgType, NW_GTP_ECHO_RSP);
+    ck_assert_int_eq (pUlpApi->u_api_info.triggeredRspIndInfo.hUlpTrxn, PEER_ECHO_TRXN);
+    ck_assert_int_eq (nwGtpv2cMsgGetIeTV1 (pUlpApi->hMsg, NW_GTPV2C_IE_RECOVERY, NW_GTPV2C_IE_INSTANCE_ZERO, &ulp->restart_counter), NW_OK);
+    ulp->echo_rsp += 1;
+    nwGtpv2cMsgDelete (peer_stack[PEER_MME], pUlpApi->hMsg);
+    break;
+
+  case NW_GTPV2C_ULP_API_RSP_FAILURE_IND:
+    if (pUlpApi->u_api_info.rspFailureInfo.peerIp.s_addr != peer_addr[PEER_SGW].s_addr) {
+      ulp->bad_failure += 1;
+    }
+    if (NW_GTP_ECHO_REQ == pUlpApi->u_api_info.rspFailureInfo.msgType) {
+      // path failure: do not wait for the retransmissions of the other requests
+      ulp->echo_failed = true;
+      ck_assert_int_eq (nwGtpv2cProcessPeerFailure (peer_stack[PEER_MME], &pUlpApi->u_api_info.rspFailureInfo.peerIp, &ulp->bulk_failed), NW_OK);
+    } else {
+      nw_gtpv2c_ulp_trxn_handle_t hUlpTrxn = pUlpApi->u_api_info.rspFailureInfo.hUlpTrxn;
+
+      if ((NW_GTP_MODIFY_BEARER_REQ != pUlpApi->u_api_info.rspFailureInfo.msgType) || (0 == hUlpTrxn) || (PEER_MAX_REQUESTS < hUlpTrxn) ||
+          (ulp->failed[hUlpTrxn - 1]) || (pUlpApi->u_api_info.rspFailureInfo.hUlpTunnel != hUlpTrxn)) {
+        ulp->bad_failure += 1;
+      } else {
+        ulp->failed[hUlpTrxn - 1] = true;
+      }
+      ulp->rsp_failure += 1;
+      ulp->last_failure_ms = peer_time_ms ();
+    }
+    break;
+
+  default:
+    ck_abort_msg ("Unexpected API %u", pUlpApi->apiType);
+  }
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t peer_sgw_ulp_req (nw_gtpv2c_ulp_handle_t hUlp, nw_gtpv2c_ulp_api_t * pUlpApi)
+{
+  // the stand-in S-GW only answers Echo Requests, this is done by the stack
+  if (pUlpApi->hMsg) {
+    nwGtpv2cMsgDelete (peer_stack[PEER_SGW], pUlpApi->hMsg);
+  }
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static void peer_pump (void)
+{
+  struct timespec ts = {.tv_sec = 0, .tv_nsec = PEER_PUMP_MS * 1000000};
+
+  while (peer_queue_head != peer_queue_tail) {
+    peer_packet_t *packet = &peer_queue[peer_queue_head % PEER_QUEUE_SIZE];
+    const int      src = (PEER_MME == packet->dst) ? PEER_SGW : PEER_MME;
+
+    peer_queue_head += 1;
+    if (PEER_SGW == packet->dst) {
+      peer_sgw_rx += 1;
+      if (!peer_sgw_alive) {
+        continue;
+      }
+    }
+    ck_assert_int_eq (nwGtpv2cProcessUdpReq (peer_stack[packet->dst], packet->buf, packet->len, PEER_GTPV2C_PORT, &peer_addr[src]), NW_OK);
+  }
+  nanosleep (&ts, NULL);
+  for (int i = 0; i < 2; i++) {
+    if (peer_tmr_mgr[i].running) {
+      ck_assert_int_eq (nwGtpv2cProcessTimeout (peer_tmr_mgr[i].tick_arg), NW_OK);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void peer_send_echo_request (void)
+{
+  nw_gtpv2c_ulp_api_t ulp_req;
+
+  memset (&ulp_req, 0, sizeof (ulp_req));
+  ulp_req.apiType = NW_GTPV2C_ULP_API_INITIAL_REQ;
+  ck_assert_int_eq (nwGtpv2cMsgNew (peer_stack[PEER_MME], false, NW_GTP_ECHO_REQ, 0, 0, &ulp_req.hMsg), NW_OK);
+  ulp_req.u_api_info.initialReqInfo.peerIp = peer_addr[PEER_SGW];
+  ulp_req.u_api_info.initialReqInfo.hUlpTrxn = PEER_ECHO_TRXN;
+  ck_assert_int_eq (nwGtpv2cProcessUlpReq (peer_stack[PEER_MME], &ulp_req), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static void peer_send_request (const uint32_t id)
+{
+  nw_gtpv2c_ulp_api_t ulp_req;
+
+  memset (&ulp_req, 0, sizeof (ulp_req));
+  ulp_req.apiType = NW_GTPV2C_ULP_API_INITIAL_REQ;
+  ck_assert_int_eq (nwGtpv2cMsgNew (peer_stack[PEER_MME], true, NW_GTP_MODIFY_BEARER_REQ, id, 0, &ulp_req.hMsg), NW_OK);
+  ulp_req.u_api_info.initialReqInfo.peerIp = peer_addr[PEER_SGW];
+  ulp_req.u_api_info.initialReqInfo.teidLocal = id;
+  ulp_req.u_api_info.initialReqInfo.hUlpTunnel = id;
+  ulp_req.u_api_info.initialReqInfo.hUlpTrxn = id;
+  ck_assert_int_eq (nwGtpv2cProcessUlpReq (peer_stack[PEER_MME], &ulp_req), NW_OK);
+}
+
+START_TEST(peer_echo_test)
+{
+  uint64_t end_ms = peer_time_ms () + 1000;
+
+  ((nw_gtpv2c_stack_t *) peer_stack[PEER_SGW])->restartCounter = 7;
+  peer_send_echo_request ();
+  while ((0 == peer_mme_ulp.echo_rsp) && (peer_time_ms () < end_ms)) {
+    peer_pump ();
+  }
+  ck_assert_int_eq (peer_mme_ulp.echo_rsp, 1);
+  ck_assert_int_eq (peer_mme_ulp.restart_counter, 7);
+
+  // S-GW restarted
+  ((nw_gtpv2c_stack_t *) peer_stack[PEER_SGW])->restartCounter = 8;
+  peer_send_echo_request ();
+  while ((1 == peer_mme_ulp.echo_rsp) && (peer_time_ms () < end_ms)) {
+    peer_pump ();
+  }
+  ck_assert_int_eq (peer_mme_ulp.echo_rsp, 2);
+  ck_assert_int_eq (peer_mme_ulp.restart_counter, 8);
+  ck_assert (!peer_tmr_mgr[PEER_MME].running);
+}
+END_TEST
+
+START_TEST(peer_failover_test)
+{
+  uint32_t sent = 0;
+  uint32_t sgw_rx = 0;
+  uint64_t next_ms = 0;
+  uint64_t end_ms = 0;
+  uint64_t failure_ms = 0;
+
+  /*
+   * The S-GW dies, the MME sends an Echo Request and keeps sending requests
+   * to it until the path failure is detected.
+   */
+  peer_sgw_alive = false;
+  failure_ms = peer_time_ms ();
+  end_ms = failure_ms + 2 * PEER_T3_N3_MS;
+  peer_send_echo_request ();
+  while ((!peer_mme_ulp.echo_failed) && (peer_time_ms () < end_ms)) {
+    if ((peer_time_ms () >= next_ms) && (PEER_MAX_REQUESTS > sent)) {
+      peer_send_request (++sent);
+      next_ms = peer_time_ms () + PEER_REQUEST_GAP_MS;
+    }
+    peer_pump ();
+  }
+  ck_assert (peer_mme_ulp.echo_failed);
+  ck_assert (sent > 1);
+
+  /*
+   * All requests still outstanding failed at once, none is retransmitted anymore
+   */
+  ck_assert (peer_mme_ulp.bulk_failed > 0);
+  ck_assert_int_eq (peer_mme_ulp.rsp_failure, sent);
+  ck_assert_int_eq (peer_mme_ulp.bad_failure, 0);
+  // retransmissions queued before the path failure are still delivered
+  sgw_rx = peer_sgw_rx + (peer_queue_tail - peer_queue_head);
+  peer_pump ();
+  peer_pump ();
+  ck_assert_int_eq (peer_sgw_rx, sgw_rx);
+  ck_assert (!peer_tmr_mgr[PEER_MME].running);
+
+  // without bulk failure the last request would fail PEER_T3_N3_MS after it was sent
+  ck_assert (peer_mme_ulp.last_failure_ms - failure_ms < PEER_T3_N3_MS + 1000);
+  printf ("Recovery from S-GW failure: %u requests failed after %u ms, %u failed in bulk (%u ms without)\n",
+          sent, (uint32_t)(peer_mme_ulp.last_failure_ms - failure_ms), peer_mme_ulp.bulk_failed,
+          (uint32_t)(next_ms - PEER_REQUEST_GAP_MS - failure_ms + PEER_T3_N3_MS));
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void peer_setup (void)
+{
+  nw_gtpv2c_ulp_entity_t ulp[2] = {{.hUlp = (nw_gtpv2c_ulp_handle_t) &peer_mme_ulp, .ulpReqCallback = peer_mme_ulp_req},
+                                   {.hUlp = 0, .ulpReqCallback = peer_sgw_ulp_req}};
+
+  memset (&peer_mme_ulp, 0, sizeof (peer_mme_ulp));
+  memset (peer_tmr_mgr, 0, sizeof (peer_tmr_mgr));
+  peer_queue_head = peer_queue_tail = 0;
+  peer_sgw_alive = true;
+  peer_sgw_rx = 0;
+  peer_addr[PEER_MME].s_addr = inet_addr ("127.0.11.1");
+  peer_addr[PEER_SGW].s_addr = inet_addr ("127.0.11.2");
+  for (int i = 0; i < 2; i++) {
+    nw_gtpv2c_udp_entity_t       udp = {.hUdp = (nw_gtpv2c_udp_handle_t) i, .udpDataReqCallback = peer_udp_data_req};
+    nw_gtpv2c_timer_mgr_entity_t tmr_mgr = {.tmrMgrHandle = (nw_gtpv2c_timer_mgr_handle_t) &peer_tmr_mgr[i],
+                                            .tmrStartCallback = peer_tmr_start, .tmrStopCallback = peer_tmr_stop};
+
+    ck_assert_int_eq (nwGtpv2cInitialize (&peer_stack[i]), NW_OK);
+    ck_assert_int_eq (nwGtpv2cSetUlpEntity (peer_stack[i], &ulp[i]), NW_OK);
+    ck_assert_int_eq (nwGtpv2cSetUdpEntity (peer_stack[i], &udp), NW_OK);
+    ck_assert_int_eq (nwGtpv2cSetTimerMgrEntity (peer_stack[i], &tmr_mgr), NW_OK);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void peer_teardown (void)
+{
+  for (int i = 0; i < 2; i++) {
+    nwGtpv2cFinalize (peer_stack[i]);
+    peer_stack[i] = 0;
+  }
+}
+
+Suite * peer_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("GTPv2-C peer failure tests");
+
+    tc_core = tcase_create("GTPv2-C peer failure test");
+    tcase_add_checked_fixture(tc_core, peer_setup, peer_teardown);
+    tcase_add_test(tc_core, peer_echo_test);
+    tcase_add_test(tc_core, peer_failover_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = peer_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
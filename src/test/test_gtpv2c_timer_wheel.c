@@ -0,0 +1,201 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cPrivate.h"
+
+#define WHEEL_TIMERS      10000
+#define WHEEL_MAX_MS      500
+
+typedef struct wheel_timer_s {
+  nw_gtpv2c_timer_handle_t hTimer;
+  uint64_t                 deadline_ms;
+  uint32_t                 fired;
+  bool                     stopped;
+} wheel_timer_t;
+
+typedef struct wheel_tmr_mgr_s {
+  uint32_t                 started;
+  uint32_t                 stopped;
+  void                    *tick_arg;
+} wheel_tmr_mgr_t;
+
+static nw_gtpv2c_stack_handle_t wheel_stack = 0;
+static wheel_tmr_mgr_t          wheel_tmr_mgr = {0};
+static wheel_timer_t            wheel_timers[WHEEL_TIMERS];
+static uint32_t                 wheel_early = 0;
+
+//------------------------------------------------------------------------------
+static uint64_t wheel_time_ms (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t wheel_tmr_start (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, uint32_t timeoutSec, uint32_t timeoutUsec, uint32_t tmrType,
+                                void *timeoutArg, nw_gtpv2c_timer_handle_t * hTmr)
+{
+  wheel_tmr_mgr_t *tmr_mgr = (wheel_tmr_mgr_t *) tmrMgrHandle;
+
+  ck_assert_int_eq (tmrType, NW_GTPV2C_TMR_TYPE_REPETITIVE);
+  tmr_mgr->started += 1;
+  tmr_mgr->tick_arg = timeoutArg;
+  *hTmr = (nw_gtpv2c_timer_handle_t) tmr_mgr->started;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t wheel_tmr_stop (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, nw_gtpv2c_timer_handle_t tmrHandle)
+{
+  wheel_tmr_mgr_t *tmr_mgr = (wheel_tmr_mgr_t *) tmrMgrHandle;
+
+  tmr_mgr->stopped += 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t wheel_timeout (void *arg)
+{
+  wheel_timer_t *timer = (wheel_timer_t *) arg;
+
+  timer->fired += 1;
+  timer->hTimer = 0;
+  if (wheel_time_ms () + 1 < timer->deadline_ms) {
+    wheel_early += 1;
+  }
+  // Stop another timer from the expiry callback, it may be in the slot being processed
+  if ((timer > wheel_timers) && (!(timer - 1)->stopped) && ((timer - 1)->hTimer)) {
+    ck_assert_int_eq (nwGtpv2cStopTimer ((nw_gtpv2c_stack_t *) wheel_stack, (timer - 1)->hTimer), NW_OK);
+    (timer - 1)->stopped = true;
+  }
+  return NW_OK;
+}
+
+START_TEST(wheel_expiry_test)
+{
+  nw_gtpv2c_stack_t *stack = (nw_gtpv2c_stack_t *) wheel_stack;
+  uint32_t           seed = 12345;
+  uint32_t           fired = 0;
+  uint64_t           end_ms = 0;
+
+  for (int i = 0; i < WHEEL_TIMERS; i++) {
+    uint32_t timeout_ms = 0;
+
+    seed = seed * 1103515245 + 12345;
+    timeout_ms = (seed >> 8) % WHEEL_MAX_MS;
+    wheel_timers[i].deadline_ms = wheel_time_ms () + timeout_ms;
+    ck_assert_int_eq (nwGtpv2cStartTimer (stack, timeout_ms / 1000, (timeout_ms % 1000) * 1000, NW_GTPV2C_TMR_TYPE_ONE_SHOT,
+                                          wheel_timeout, &wheel_timers[i], &wheel_timers[i].hTimer), NW_OK);
+  }
+  // One periodic tick for all timers
+  ck_assert_int_eq (wheel_tmr_mgr.started, 1);
+
+  for (int i = 0; i < WHEEL_TIMERS; i += 3) {
+    ck_assert_int_eq (nwGtpv2cStopTimer (stack, wheel_timers[i].hTimer), NW_OK);
+    wheel_timers[i].stopped = true;
+  }
+  // Already stopped
+  ck_assert_int_eq (nwGtpv2cStopTimer (stack, wheel_timers[0].hTimer), NW_FAILURE);
+
+  end_ms = wheel_time_ms () + WHEEL_MAX_MS + 2 * NW_GTPV2C_TMR_WHEEL_TICK_MS;
+  while (wheel_time_ms () < end_ms) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = NW_GTPV2C_TMR_WHEEL_TICK_MS * 1000000};
+
+    nanosleep (&ts, NULL);
+    ck_assert_int_eq (nwGtpv2cProcessTimeout (wheel_tmr_mgr.tick_arg), NW_OK);
+  }
+
+  for (int i = 0; i < WHEEL_TIMERS; i++) {
+    ck_assert_int_eq (wheel_timers[i].fired, (wheel_timers[i].stopped) ? 0 : 1);
+    fired += wheel_timers[i].fired;
+  }
+  ck_assert (fired > 0);
+  ck_assert_int_eq (wheel_early, 0);
+  // Tick stopped once no timer is armed
+  ck_assert_int_eq (wheel_tmr_mgr.stopped, 1);
+  ck_assert_int_eq (stack->tmrWheelCount, 0);
+}
+END_TEST
+
+START_TEST(wheel_long_timer_test)
+{
+  nw_gtpv2c_stack_t *stack = (nw_gtpv2c_stack_t *) wheel_stack;
+  const uint32_t     timeout_ms = NW_GTPV2C_TMR_WHEEL_SLOTS * NW_GTPV2C_TMR_WHEEL_TICK_MS * 3 + NW_GTPV2C_TMR_WHEEL_TICK_MS;
+
+  // Lands in one of the next slots but expires three turns later
+  ck_assert_int_eq (nwGtpv2cStartTimer (stack, timeout_ms / 1000, (timeout_ms % 1000) * 1000,
+                                        NW_GTPV2C_TMR_TYPE_ONE_SHOT, wheel_timeout, &wheel_timers[0], &wheel_timers[0].hTimer), NW_OK);
+  for (int i = 0; i < 3; i++) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 2 * NW_GTPV2C_TMR_WHEEL_TICK_MS * 1000000};
+
+    nanosleep (&ts, NULL);
+    ck_assert_int_eq (nwGtpv2cProcessTimeout (wheel_tmr_mgr.tick_arg), NW_OK);
+  }
+  ck_assert_int_eq (wheel_timers[0].fired, 0);
+  ck_assert_int_eq (stack->tmrWheelCount, 1);
+  ck_assert_int_eq (wheel_tmr_mgr.stopped, 0);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void wheel_setup (void)
+{
+  nw_gtpv2c_timer_mgr_entity_t tmr_mgr = {.tmrMgrHandle = (nw_gtpv2c_timer_mgr_handle_t) &wheel_tmr_mgr,
+                                          .tmrStartCallback = wheel_tmr_start, .tmrStopCallback = wheel_tmr_stop};
+
+  memset (&wheel_tmr_mgr, 0, sizeof (wheel_tmr_mgr));
+  memset (wheel_timers, 0, sizeof (wheel_timers));
+  wheel_early = 0;
+  ck_assert_int_eq (nwGtpv2cInitialize (&wheel_stack), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetTimerMgrEntity (wheel_stack, &tmr_mgr), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static void wheel_teardown (void)
+{
+  nwGtpv2cFinalize (wheel_stack);
+  wheel_stack = 0;
+}
+
+Suite * wheel_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("GTPv2-C timer wheel tests");
+
+    tc_core = tcase_create("GTPv2-C timer wheel test");
+    tcase_add_checked_fixture(tc_core, wheel_setup, wheel_teardown);
+    tcase_add_test(tc_core, wheel_expiry_test);
+    tcase_add_test(tc_core, wheel_long_timer_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = wheel_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,262 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cMsg.h"
+#include "NwGtpv2cMap.h"
+
+#define MAP_BENCH_TUNNELS   1000000
+#define MAP_BENCH_REQUESTS  100000
+
+typedef struct map_elm_s {
+  uint32_t          key;
+  struct map_elm_s *next;
+} map_elm_t;
+
+typedef struct map_ulp_s {
+  uint32_t      initial_req_ind;
+  uint32_t      mismatch;
+} map_ulp_t;
+
+static nw_gtpv2c_stack_handle_t map_stack = 0;
+static map_ulp_t                map_ulp = {0};
+static uint32_t                 map_seq_num = 0;
+
+//------------------------------------------------------------------------------
+static uint32_t map_elm_hash (const void *elm)
+{
+  return nwGtpv2cMapHash64 (((const map_elm_t *)elm)->key);
+}
+
+//------------------------------------------------------------------------------
+static int map_elm_equal (const void *a, const void *b)
+{
+  return ((const map_elm_t *)a)->key == ((const map_elm_t *)b)->key;
+}
+
+//------------------------------------------------------------------------------
+static uint64_t map_time_ns (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t map_ulp_req (nw_gtpv2c_ulp_handle_t hUlp, nw_gtpv2c_ulp_api_t * pUlpApi)
+{
+  map_ulp_t *ulp = (map_ulp_t *) hUlp;
+
+  if (NW_GTPV2C_ULP_API_INITIAL_REQ_IND == pUlpApi->apiType) {
+    ulp->initial_req_ind += 1;
+    // ULP tunnel handle is the TEID of the tunnel
+    if (pUlpApi->u_api_info.initialReqIndInfo.hUlpTunnel != nwGtpv2cMsgGetTeid (pUlpApi->hMsg)) {
+      ulp->mismatch += 1;
+    }
+    nwGtpv2cMsgDelete (map_stack, pUlpApi->hMsg);
+  }
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t map_udp_data_req (nw_gtpv2c_udp_handle_t udpHandle, uint8_t * dataBuf, uint32_t dataSize, struct in_addr *peerIp, uint16_t peerPort)
+{
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static struct in_addr map_peer (const uint32_t teid)
+{
+  struct in_addr peer = {.s_addr = htonl (0x0A000000 | (teid & 0x0F))};
+
+  return peer;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t map_create_tunnel (const uint32_t teid, nw_gtpv2c_tunnel_handle_t * const hTunnel)
+{
+  nw_gtpv2c_ulp_api_t ulp_req;
+  nw_rc_t             rc = NW_FAILURE;
+
+  memset (&ulp_req, 0, sizeof (ulp_req));
+  ulp_req.apiType = NW_GTPV2C_ULP_CREATE_LOCAL_TUNNEL;
+  ulp_req.u_api_info.createLocalTunnelInfo.teidLocal = teid;
+  ulp_req.u_api_info.createLocalTunnelInfo.peerIp = map_peer (teid);
+  ulp_req.u_api_info.createLocalTunnelInfo.hUlpTunnel = teid;
+  rc = nwGtpv2cProcessUlpReq (map_stack, &ulp_req);
+  *hTunnel = ulp_req.u_api_info.createLocalTunnelInfo.hTunnel;
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static void map_delete_tunnel (const nw_gtpv2c_tunnel_handle_t hTunnel)
+{
+  nw_gtpv2c_ulp_api_t ulp_req;
+
+  memset (&ulp_req, 0, sizeof (ulp_req));
+  ulp_req.apiType = NW_GTPV2C_ULP_DELETE_LOCAL_TUNNEL;
+  ulp_req.u_api_info.deleteLocalTunnelInfo.hTunnel = hTunnel;
+  ck_assert_int_eq (nwGtpv2cProcessUlpReq (map_stack, &ulp_req), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static void map_receive_request (const uint32_t teid)
+{
+  // Release Access Bearers Request, header only
+  uint8_t        request[12] = {0x48, 170, 0x00, 0x08};
+  struct in_addr peer = map_peer (teid);
+
+  map_seq_num = (map_seq_num + 1) & 0x00FFFFFF;
+  request[4] = teid >> 24;
+  request[5] = teid >> 16;
+  request[6] = teid >> 8;
+  request[7] = teid;
+  request[8] = map_seq_num >> 16;
+  request[9] = map_seq_num >> 8;
+  request[10] = map_seq_num;
+  ck_assert_int_eq (nwGtpv2cProcessUdpReq (map_stack, request, sizeof (request), 2123, &peer), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static uint64_t map_bench_requests (const uint32_t tunnels)
+{
+  uint32_t seed = 12345;
+  uint64_t start_ns = map_time_ns ();
+
+  for (int i = 0; i < MAP_BENCH_REQUESTS; i++) {
+    seed = seed * 1103515245 + 12345;
+    map_receive_request (1 + (seed >> 8) % tunnels);
+  }
+  return (map_time_ns () - start_ns) / MAP_BENCH_REQUESTS;
+}
+
+START_TEST(map_insert_find_remove_test)
+{
+  static map_elm_t elms[5000];
+  nw_gtpv2c_map_t  map;
+  map_elm_t        key = {0};
+
+  ck_assert_int_eq (nwGtpv2cMapInit (&map, 4, offsetof (map_elm_t, next), map_elm_hash, map_elm_equal), NW_OK);
+  for (int i = 0; i < 5000; i++) {
+    elms[i].key = i * 7919;
+    ck_assert (nwGtpv2cMapInsert (&map, &elms[i]) == NULL);
+  }
+  // grown with the load
+  ck_assert_int_eq (map.count, 5000);
+  ck_assert (map.mask + 1 >= 5000);
+
+  key.key = 10 * 7919;
+  ck_assert (nwGtpv2cMapInsert (&map, &key) == &elms[10]);
+  for (int i = 0; i < 5000; i++) {
+    key.key = i * 7919;
+    ck_assert (nwGtpv2cMapFind (&map, &key) == &elms[i]);
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    ck_assert (nwGtpv2cMapRemove (&map, &elms[i]) == &elms[i]);
+  }
+  ck_assert (nwGtpv2cMapRemove (&map, &elms[0]) == NULL);
+  for (int i = 0; i < 5000; i++) {
+    key.key = i * 7919;
+    ck_assert (nwGtpv2cMapFind (&map, &key) == ((i & 1) ? &elms[i] : NULL));
+  }
+  ck_assert_int_eq (map.count, 2500);
+  nwGtpv2cMapFinalize (&map);
+}
+END_TEST
+
+START_TEST(map_stack_tunnels_test)
+{
+  static nw_gtpv2c_tunnel_handle_t tunnels[MAP_BENCH_TUNNELS];
+  nw_gtpv2c_tunnel_handle_t        hTunnel = 0;
+  uint64_t                         small_ns = 0;
+  uint64_t                         large_ns = 0;
+
+  for (uint32_t teid = 1; teid <= 1000; teid++) {
+    ck_assert_int_eq (map_create_tunnel (teid, &tunnels[teid - 1]), NW_OK);
+  }
+  small_ns = map_bench_requests (1000);
+
+  for (uint32_t teid = 1001; teid <= MAP_BENCH_TUNNELS; teid++) {
+    ck_assert_int_eq (map_create_tunnel (teid, &tunnels[teid - 1]), NW_OK);
+  }
+  // same TEID and peer
+  ck_assert_int_eq (map_create_tunnel (MAP_BENCH_TUNNELS / 2, &hTunnel), NW_FAILURE);
+  large_ns = map_bench_requests (MAP_BENCH_TUNNELS);
+
+  ck_assert_int_eq (map_ulp.initial_req_ind, 2 * MAP_BENCH_REQUESTS);
+  ck_assert_int_eq (map_ulp.mismatch, 0);
+  // No assertion on timings, they depend on the host
+  printf ("Initial request on tunnel: %lu ns with 1000 tunnels, %lu ns with %d tunnels\n",
+          (unsigned long)small_ns, (unsigned long)large_ns, MAP_BENCH_TUNNELS);
+
+  // Requests on deleted tunnels are discarded
+  for (uint32_t teid = 1; teid <= MAP_BENCH_TUNNELS; teid++) {
+    map_delete_tunnel (tunnels[teid - 1]);
+  }
+  map_receive_request (1);
+  map_receive_request (MAP_BENCH_TUNNELS);
+  ck_assert_int_eq (map_ulp.initial_req_ind, 2 * MAP_BENCH_REQUESTS);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void map_setup (void)
+{
+  nw_gtpv2c_ulp_entity_t ulp = {.hUlp = (nw_gtpv2c_ulp_handle_t) &map_ulp, .ulpReqCallback = map_ulp_req};
+  nw_gtpv2c_udp_entity_t udp = {.hUdp = 0, .udpDataReqCallback = map_udp_data_req};
+
+  memset (&map_ulp, 0, sizeof (map_ulp));
+  ck_assert_int_eq (nwGtpv2cInitialize (&map_stack), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetUlpEntity (map_stack, &ulp), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetUdpEntity (map_stack, &udp), NW_OK);
+}
+
+//------------------------------------------------------------------------------
+static void map_teardown (void)
+{
+  nwGtpv2cFinalize (map_stack);
+  map_stack = 0;
+}
+
+Suite * map_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("GTPv2-C tunnel map tests");
+
+    tc_core = tcase_create("GTPv2-C tunnel map test");
+    tcase_add_checked_fixture(tc_core, map_setup, map_teardown);
+    tcase_add_test(tc_core, map_insert_find_remove_test);
+    tcase_add_test(tc_core, map_stack_tunnels_test);
+    tcase_set_timeout(tc_core, 120);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = map_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
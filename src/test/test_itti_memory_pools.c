@@ -0,0 +1,108 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "memory_pools.h"
+
+#define POOLS_ITEMS         64
+#define POOLS_ITEM_SIZE     64
+#define POOLS_THREADS       4
+#define POOLS_BURST         4
+#define POOLS_ROUNDS        1000000
+
+typedef struct pools_worker_s {
+  memory_pools_handle_t pools;
+  uint16_t              id;
+  uint32_t              nb_failures;
+} pools_worker_t;
+
+/*
+ * As the ITTI tasks do, each thread takes a few items and gives them back,
+ * in parallel with the others: every item must come back to the free list.
+ */
+//------------------------------------------------------------------------------
+static void *pools_worker (void *args_p)
+{
+  pools_worker_t                         *worker_p = (pools_worker_t *) args_p;
+  memory_pool_item_handle_t               items[POOLS_BURST];
+
+  for (uint32_t round = 0; round < POOLS_ROUNDS; round++) {
+    for (int i = 0; i < POOLS_BURST; i++) {
+      items[i] = memory_pools_allocate (worker_p->pools, POOLS_ITEM_SIZE, worker_p->id, worker_p->id);
+      if (!items[i]) {
+        worker_p->nb_failures++;
+        continue;
+      }
+      memset (items[i], worker_p->id, POOLS_ITEM_SIZE);
+    }
+    for (int i = 0; i < POOLS_BURST; i++) {
+      if ((items[i]) && (EXIT_SUCCESS != memory_pools_free (worker_p->pools, items[i], worker_p->id))) {
+        worker_p->nb_failures++;
+      }
+    }
+  }
+  return NULL;
+}
+
+START_TEST(pools_threads_test)
+{
+  memory_pools_handle_t                   pools = memory_pools_create (1);
+  pools_worker_t                          workers[POOLS_THREADS];
+  pthread_t                               threads[POOLS_THREADS];
+  memory_pool_item_handle_t               items[POOLS_ITEMS];
+
+  ck_assert_int_eq (memory_pools_add_pool (pools, POOLS_ITEMS, POOLS_ITEM_SIZE), 0);
+  for (int t = 0; t < POOLS_THREADS; t++) {
+    workers[t].pools = pools;
+    workers[t].id = t + 1;
+    workers[t].nb_failures = 0;
+    ck_assert_int_eq (pthread_create (&threads[t], NULL, pools_worker, &workers[t]), 0);
+  }
+  for (int t = 0; t < POOLS_THREADS; t++) {
+    pthread_join (threads[t], NULL);
+    ck_assert_int_eq (workers[t].nb_failures, 0);
+  }
+  // nothing lost: all the items can be taken again
+  for (int i = 0; i < POOLS_ITEMS; i++) {
+    items[i] = memory_pools_allocate (pools, POOLS_ITEM_SIZE, 0, 0);
+    ck_assert_ptr_ne (items[i], NULL);
+  }
+  for (int i = 0; i < POOLS_ITEMS; i++) {
+    ck_assert_int_eq (memory_pools_free (pools, items[i], 0), EXIT_SUCCESS);
+  }
+}
+END_TEST
+
+Suite * pools_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("ITTI memory pools");
+
+    tc_core = tcase_create("ITTI memory pools test");
+    tcase_add_test(tc_core, pools_threads_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = pools_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
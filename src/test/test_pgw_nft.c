@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "common_defs.h"
+#include "3gpp_24.008.h"
+#include "pgw_sdf_classifier.h"
+#include "pgw_nft.h"
+
+#define NFT_BEARERS           10000
+
+static bool nft_enabled = false;
+
+//------------------------------------------------------------------------------
+static uint64_t nft_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static struct in_addr nft_ue_ip (const uint32_t i)
+{
+  struct in_addr ue = {.s_addr = htonl (0x0A000000 | i)};
+
+  return ue;
+}
+
+START_TEST(nft_bearer_mark_test)
+{
+  uint64_t start_us = 0;
+  uint64_t add_us = 0;
+  uint64_t del_us = 0;
+
+  if (!nft_enabled) {
+    return;
+  }
+  start_us = nft_time_us ();
+  for (uint32_t i = 1; i <= NFT_BEARERS; i++) {
+    ck_assert_int_eq (pgw_nft_add_bearer_mark (nft_ue_ip (i), 20, 6), RETURNok);
+  }
+  ck_assert_int_eq (pgw_nft_commit (), RETURNok);
+  add_us = nft_time_us () - start_us;
+
+  start_us = nft_time_us ();
+  for (uint32_t i = 1; i <= NFT_BEARERS; i++) {
+    ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (i), 20), RETURNok);
+  }
+  ck_assert_int_eq (pgw_nft_commit (), RETURNok);
+  del_us = nft_time_us () - start_us;
+  printf ("Bearer marking: %u adds in %u us, %u deletes in %u us\n", NFT_BEARERS, (uint32_t)add_us, NFT_BEARERS, (uint32_t)del_us);
+
+  // Already deleted: the kernel rejects them
+  ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (1), 20), RETURNok);
+  ck_assert_int_eq (pgw_nft_commit (), RETURNerror);
+}
+END_TEST
+
+START_TEST(nft_rejected_change_test)
+{
+  if (!nft_enabled) {
+    return;
+  }
+  // A rejected change does not prevent the others of the transaction
+  ck_assert_int_eq (pgw_nft_add_bearer_mark (nft_ue_ip (1), 20, 6), RETURNok);
+  ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (2), 20), RETURNok);
+  ck_assert_int_eq (pgw_nft_add_bearer_mark (nft_ue_ip (3), 21, 7), RETURNok);
+  ck_assert_int_eq (pgw_nft_commit (), RETURNerror);
+
+  ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (1), 20), RETURNok);
+  ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (3), 21), RETURNok);
+  ck_assert_int_eq (pgw_nft_commit (), RETURNok);
+  // Same UE, other SDF
+  ck_assert_int_eq (pgw_nft_del_bearer_mark (nft_ue_ip (3), 20), RETURNok);
+  ck_assert_int_eq (pgw_nft_commit (), RETURNerror);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static int nft_udp_send (const uint16_t sport)
+{
+  struct sockaddr_in src = {.sin_family = AF_INET, .sin_port = htons (sport)};
+  struct sockaddr_in dst = {.sin_family = AF_INET, .sin_port = htons (9000), .sin_addr = nft_ue_ip (5)};
+  int                fd = socket (AF_INET, SOCK_DGRAM, 0);
+  int                rc = 0;
+
+  ck_assert_int_ge (fd, 0);
+  ck_assert_int_eq (bind (fd, (struct sockaddr *)&src, sizeof (src)), 0);
+  rc = sendto (fd, "sdf", 3, 0, (struct sockaddr *)&dst, sizeof (dst));
+  close (fd);
+  return rc;
+}
+
+START_TEST(nft_sdf_classifier_test)
+{
+  pgw_sdf_classifier_t     classifier;
+  packet_filter_contents_t pf = {0};
+  struct in_addr           ue_net = {.s_addr = htonl (0x0A000000)};
+
+  if (!nft_enabled) {
+    return;
+  }
+  ck_assert_int_eq (pgw_sdf_classifier_init (&classifier), RETURNok);
+  // SIP, in a map
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG;
+  pf.protocolidentifier_nextheader = 17;
+  pf.singleremoteport = 5060;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY, 10, 20), RETURNok);
+  // the same map tuple with a worse precedence, another map
+  pf.singleremoteport = 5063;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 70, 20), RETURNok);
+  // enough elements for several messages
+  for (uint32_t i = 0; i < 1000; i++) {
+    pf.singleremoteport = 10000 + i;
+    ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY, 40, 30 + i % 8), RETURNok);
+  }
+  // uplink only, not marked
+  pf.singleremoteport = 5061;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY, 1, 20), RETURNok);
+  // everything from the host, between the two SIP precedences
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG;
+  pf.ipv4remoteaddr[0].addr = 127;
+  pf.ipv4remoteaddr[0].mask = 255;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 50, 25), RETURNok);
+  // a port range and a ToS mask, in a rule
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG | TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG |
+      TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG;
+  pf.ipv4remoteaddr[0].addr = 192;
+  pf.ipv4remoteaddr[1].addr = 168;
+  pf.ipv4remoteaddr[0].mask = 255;
+  pf.ipv4remoteaddr[1].mask = 255;
+  pf.localportrange.lowlimit = 1000;
+  pf.localportrange.highlimit = 2000;
+  pf.typdeofservice_trafficclass.value = 0xB8;
+  pf.typdeofservice_trafficclass.mask = 0xFC;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 5, 21), RETURNok);
+  // ESP, in a map
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_SECURITY_PARAMETER_INDEX_FLAG;
+  pf.securityparameterindex = 0x1234;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY, 30, 22), RETURNok);
+
+  ck_assert_int_eq (pgw_nft_add_sdf_classifier (&classifier, ue_net, 8), RETURNok);
+  ck_assert_int_eq (pgw_nft_commit (), RETURNok);
+
+  // Packets the host sends to the UE network are marked in the output chain, mark 20 is routed nowhere
+  ck_assert_int_eq (system ("ip link set lo up && ip route add 10.0.0.0/8 dev lo src 127.0.0.1 && "
+      "ip rule add fwmark 20 table 100 && ip route add unreachable 10.0.0.0/8 table 100"), 0);
+  // SIP beats the host filter, which beats the worse SIP filter
+  ck_assert_int_lt (nft_udp_send (5060), 0);
+  ck_assert_int_eq (nft_udp_send (5063), 3);
+  ck_assert_int_eq (nft_udp_send (5061), 3);
+  ck_assert_int_eq (nft_udp_send (5062), 3);
+  pgw_sdf_classifier_destroy (&classifier);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void nft_setup (void)
+{
+  ck_assert_int_eq (pgw_nft_init ("gtp0"), RETURNok);
+}
+
+//------------------------------------------------------------------------------
+static void nft_teardown (void)
+{
+  pgw_nft_exit ();
+}
+
+Suite * nft_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("P-GW nf_tables marking tests");
+
+    tc_core = tcase_create("P-GW nf_tables marking test");
+    if (nft_enabled) {
+      tcase_add_checked_fixture(tc_core, nft_setup, nft_teardown);
+    }
+    tcase_add_test(tc_core, nft_bearer_mark_test);
+    tcase_add_test(tc_core, nft_rejected_change_test);
+    tcase_add_test(tc_core, nft_sdf_classifier_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    // Runs in its own network namespace, needs CAP_SYS_ADMIN
+    nft_enabled = (0 == unshare (CLONE_NEWNET));
+    if (!nft_enabled) {
+      printf ("Cannot create a network namespace, nf_tables tests skipped\n");
+    }
+    s = nft_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,335 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <netinet/in.h>
+
+#include "bstrlib.h"
+#include "common_defs.h"
+#include "3gpp_24.008.h"
+#include "pgw_sdf_classifier.h"
+
+#define SDF_BENCH_RULES        4096
+#define SDF_BENCH_FLOWS        (1 << 20)
+#define SDF_CHECK_FLOWS        (1 << 16)
+
+typedef struct sdf_ref_rule_s {
+  packet_filter_contents_t pf;
+  uint8_t                  direction;
+  uint8_t                  precedence;
+  uint32_t                 sdf_id;
+} sdf_ref_rule_t;
+
+static sdf_ref_rule_t  sdf_ref_rules[SDF_BENCH_RULES];
+static uint32_t        sdf_rand_state = 12345;
+
+//------------------------------------------------------------------------------
+static uint64_t sdf_time_ns (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static uint32_t sdf_rand (void)
+{
+  sdf_rand_state = sdf_rand_state * 1103515245 + 12345;
+  return sdf_rand_state >> 8;
+}
+
+//------------------------------------------------------------------------------
+static void sdf_pf_remote_addr (packet_filter_contents_t * const pf, const uint32_t addr, const uint8_t prefix)
+{
+  const uint32_t mask = (prefix) ? 0xFFFFFFFF << (32 - prefix) : 0;
+
+  pf->flags |= TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG;
+  for (int i = 0; i < TRAFFIC_FLOW_TEMPLATE_IPV4_ADDR_SIZE; i++) {
+    pf->ipv4remoteaddr[i].addr = addr >> (24 - 8 * i);
+    pf->ipv4remoteaddr[i].mask = mask >> (24 - 8 * i);
+  }
+}
+
+// Straight evaluation of a packet filter, reference for the classifier
+//------------------------------------------------------------------------------
+static bool sdf_ref_match (const sdf_ref_rule_t * const rule, const pgw_sdf_flow_t * const flow)
+{
+  const packet_filter_contents_t *pf = &rule->pf;
+
+  if ((TRAFFIC_FLOW_TEMPLATE_PRE_REL7_TFT_FILTER != rule->direction) &&
+      (!(rule->direction & ((flow->downlink) ? TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY : TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY)))) {
+    return false;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG & pf->flags) {
+    for (int i = 0; i < TRAFFIC_FLOW_TEMPLATE_IPV4_ADDR_SIZE; i++) {
+      if (((flow->key.remote_addr >> (24 - 8 * i)) & pf->ipv4remoteaddr[i].mask) != (pf->ipv4remoteaddr[i].addr & pf->ipv4remoteaddr[i].mask)) {
+        return false;
+      }
+    }
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG & pf->flags) && (flow->key.protocol != pf->protocolidentifier_nextheader)) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_SINGLE_LOCAL_PORT_FLAG & pf->flags) && (flow->key.local_port != pf->singlelocalport)) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG & pf->flags) &&
+      ((flow->key.local_port < pf->localportrange.lowlimit) || (flow->key.local_port > pf->localportrange.highlimit))) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG & pf->flags) && (flow->key.remote_port != pf->singleremoteport)) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_REMOTE_PORT_RANGE_FLAG & pf->flags) &&
+      ((flow->key.remote_port < pf->remoteportrange.lowlimit) || (flow->key.remote_port > pf->remoteportrange.highlimit))) {
+    return false;
+  }
+  if ((TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG & pf->flags) &&
+      ((flow->key.tos & pf->typdeofservice_trafficclass.mask) != (pf->typdeofservice_trafficclass.value & pf->typdeofservice_trafficclass.mask))) {
+    return false;
+  }
+  return true;
+}
+
+// Lowest precedence wins, then the first added
+//------------------------------------------------------------------------------
+static uint32_t sdf_ref_classify (const uint32_t nb_rules, const pgw_sdf_flow_t * const flow)
+{
+  const sdf_ref_rule_t *best = NULL;
+
+  for (uint32_t i = 0; i < nb_rules; i++) {
+    if (((!best) || (sdf_ref_rules[i].precedence < best->precedence)) && (sdf_ref_match (&sdf_ref_rules[i], flow))) {
+      best = &sdf_ref_rules[i];
+    }
+  }
+  return (best) ? best->sdf_id : PGW_SDF_NO_MATCH;
+}
+
+/*
+ * Operator like rule set: servers by address and port, subnets by port range,
+ * DSCP classes, a few protocol wide rules.
+ */
+//------------------------------------------------------------------------------
+static void sdf_random_rule (sdf_ref_rule_t * const rule, const uint32_t sdf_id)
+{
+  packet_filter_contents_t *pf = &rule->pf;
+
+  memset (rule, 0, sizeof (*rule));
+  rule->sdf_id = sdf_id;
+  rule->precedence = sdf_rand () & 0xFF;
+  rule->direction = (sdf_rand () & 3) ? TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL : TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY;
+  switch (sdf_rand () % 8) {
+  case 0: case 1: case 2: case 3:
+    sdf_pf_remote_addr (pf, 0xC0A80000 | (sdf_rand () & 0xFFFF), 32);
+    pf->flags |= TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG;
+    pf->protocolidentifier_nextheader = IPPROTO_UDP;
+    pf->singleremoteport = 5000 + (sdf_rand () & 0xFF);
+    break;
+  case 4: case 5:
+    sdf_pf_remote_addr (pf, 0xC0A80000 | (sdf_rand () & 0xFF00), 24);
+    pf->flags |= TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG;
+    pf->protocolidentifier_nextheader = IPPROTO_TCP;
+    pf->localportrange.lowlimit = 1024 + (sdf_rand () & 0x3FFF);
+    pf->localportrange.highlimit = pf->localportrange.lowlimit + (sdf_rand () & 0xFFF);
+    break;
+  case 6:
+    sdf_pf_remote_addr (pf, 0xC0A80000, 16);
+    pf->flags |= TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG;
+    pf->typdeofservice_trafficclass.value = (sdf_rand () & 0x3F) << 2;
+    pf->typdeofservice_trafficclass.mask = 0xFC;
+    break;
+  default:
+    pf->flags |= TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_SINGLE_LOCAL_PORT_FLAG;
+    pf->protocolidentifier_nextheader = (sdf_rand () & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+    pf->singlelocalport = sdf_rand () & 0xFFFF;
+    break;
+  }
+}
+
+// Half of the flows are built to hit a rule, the others are random in the same address space
+//------------------------------------------------------------------------------
+static void sdf_random_flow (const uint32_t nb_rules, pgw_sdf_flow_t * const flow)
+{
+  const packet_filter_contents_t *pf = &sdf_ref_rules[sdf_rand () % nb_rules].pf;
+
+  memset (flow, 0, sizeof (*flow));
+  flow->downlink = (sdf_rand () & 7);
+  flow->key.remote_addr = 0xC0A80000 | (sdf_rand () & 0xFFFF);
+  flow->key.protocol = (sdf_rand () & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+  flow->key.local_port = sdf_rand () & 0xFFFF;
+  flow->key.remote_port = 5000 + (sdf_rand () & 0x1FF);
+  flow->key.tos = sdf_rand () & 0xFF;
+  if (sdf_rand () & 1) {
+    return;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_IPV4_REMOTE_ADDR_FLAG & pf->flags) {
+    flow->key.remote_addr = ((uint32_t)pf->ipv4remoteaddr[0].addr << 24) | ((uint32_t)pf->ipv4remoteaddr[1].addr << 16) |
+        ((uint32_t)pf->ipv4remoteaddr[2].addr << 8) | pf->ipv4remoteaddr[3].addr | (sdf_rand () & ~(((uint32_t)pf->ipv4remoteaddr[0].mask << 24) |
+        ((uint32_t)pf->ipv4remoteaddr[1].mask << 16) | ((uint32_t)pf->ipv4remoteaddr[2].mask << 8) | pf->ipv4remoteaddr[3].mask));
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG & pf->flags) {
+    flow->key.protocol = pf->protocolidentifier_nextheader;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG & pf->flags) {
+    flow->key.remote_port = pf->singleremoteport;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_SINGLE_LOCAL_PORT_FLAG & pf->flags) {
+    flow->key.local_port = pf->singlelocalport;
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG & pf->flags) {
+    flow->key.local_port = pf->localportrange.lowlimit + sdf_rand () % (pf->localportrange.highlimit - pf->localportrange.lowlimit + 1);
+  }
+  if (TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG & pf->flags) {
+    flow->key.tos = pf->typdeofservice_trafficclass.value | (sdf_rand () & 3);
+  }
+}
+
+START_TEST(sdf_classifier_rules_test)
+{
+  pgw_sdf_classifier_t      classifier;
+  packet_filter_contents_t  pf = {0};
+  pgw_sdf_flow_t            flow = {0};
+  // UDP 192.168.1.1:5060 -> UE 45.45.0.2:4000, DSCP EF
+  uint8_t                   pkt[28] = {0x45, 0xB8, 0, 28, 0, 0, 0, 0, 64, IPPROTO_UDP, 0, 0, 192, 168, 1, 1, 45, 45, 0, 2, 0x13, 0xC4, 0x0F, 0xA0, 0, 8, 0, 0};
+
+  ck_assert_int_eq (pgw_sdf_classifier_init (&classifier), RETURNok);
+  ck_assert_int_eq (pgw_sdf_flow_from_ipv4 (pkt, sizeof (pkt), true, &flow), RETURNok);
+  ck_assert_int_eq (flow.key.remote_addr, 0xC0A80101);
+  ck_assert_int_eq (flow.key.remote_port, 5060);
+  ck_assert_int_eq (flow.key.local_port, 4000);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), PGW_SDF_NO_MATCH);
+
+  // the whole subnet, then a better precedence on the server
+  sdf_pf_remote_addr (&pf, 0xC0A80100, 24);
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 10, 1), RETURNok);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 1);
+  pf.flags |= TRAFFIC_FLOW_TEMPLATE_PROTOCOL_NEXT_HEADER_FLAG | TRAFFIC_FLOW_TEMPLATE_SINGLE_REMOTE_PORT_FLAG;
+  pf.protocolidentifier_nextheader = IPPROTO_UDP;
+  pf.singleremoteport = 5060;
+  sdf_pf_remote_addr (&pf, 0xC0A80101, 32);
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 5, 2), RETURNok);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 2);
+
+  // uplink only filter does not apply to downlink packets
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_TYPE_OF_SERVICE_TRAFFIC_CLASS_FLAG;
+  pf.typdeofservice_trafficclass.value = 0xB8;
+  pf.typdeofservice_trafficclass.mask = 0xFC;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_UPLINK_ONLY, 1, 3), RETURNok);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 2);
+  flow.downlink = false;
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 3);
+  flow.downlink = true;
+
+  // local port range, same precedence as the server filter but added later
+  memset (&pf, 0, sizeof (pf));
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_LOCAL_PORT_RANGE_FLAG;
+  pf.localportrange.lowlimit = 3000;
+  pf.localportrange.highlimit = 4000;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_DOWNLINK_ONLY, 5, 4), RETURNok);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 2);
+  ck_assert_int_eq (pgw_sdf_classifier_del (&classifier, 2), 1);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 4);
+  flow.key.local_port = 4001;
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), 1);
+
+  pf.flags = TRAFFIC_FLOW_TEMPLATE_IPV6_REMOTE_ADDR_FLAG;
+  ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &pf, TRAFFIC_FLOW_TEMPLATE_BIDIRECTIONAL, 1, 5), RETURNerror);
+  ck_assert_int_eq (pgw_sdf_classifier_del (&classifier, 1), 1);
+  ck_assert_int_eq (pgw_sdf_classifier_del (&classifier, 3), 1);
+  ck_assert_int_eq (pgw_sdf_classifier_del (&classifier, 4), 1);
+  ck_assert_int_eq (classifier.nb_tuples, 0);
+  ck_assert_int_eq (pgw_sdf_classify (&classifier, &flow), PGW_SDF_NO_MATCH);
+  pgw_sdf_classifier_destroy (&classifier);
+}
+END_TEST
+
+START_TEST(sdf_classifier_bench_test)
+{
+  pgw_sdf_classifier_t      classifier;
+  pgw_sdf_flow_t           *flows = calloc (SDF_BENCH_FLOWS, sizeof (pgw_sdf_flow_t));
+  const uint32_t            nb_rules[] = {16, 256, SDF_BENCH_RULES};
+  uint32_t                  added = 0;
+
+  ck_assert_ptr_ne (flows, NULL);
+  ck_assert_int_eq (pgw_sdf_classifier_init (&classifier), RETURNok);
+  for (int n = 0; n < sizeof (nb_rules) / sizeof (nb_rules[0]); n++) {
+    volatile uint32_t       sink = 0;
+    uint64_t                start_ns = 0;
+    uint64_t                tss_ns = 0;
+    uint64_t                linear_ns = 0;
+    uint32_t                nb_hits = 0;
+
+    for (; added < nb_rules[n]; added++) {
+      sdf_random_rule (&sdf_ref_rules[added], added + 1);
+      ck_assert_int_eq (pgw_sdf_classifier_add (&classifier, &sdf_ref_rules[added].pf, sdf_ref_rules[added].direction,
+          sdf_ref_rules[added].precedence, sdf_ref_rules[added].sdf_id), RETURNok);
+    }
+    for (uint32_t f = 0; f < SDF_BENCH_FLOWS; f++) {
+      sdf_random_flow (added, &flows[f]);
+    }
+    for (uint32_t f = 0; f < SDF_CHECK_FLOWS; f++) {
+      const uint32_t        sdf_id = sdf_ref_classify (added, &flows[f]);
+
+      ck_assert_int_eq (pgw_sdf_classify (&classifier, &flows[f]), sdf_id);
+      nb_hits += (PGW_SDF_NO_MATCH != sdf_id);
+    }
+
+    start_ns = sdf_time_ns ();
+    for (uint32_t f = 0; f < SDF_BENCH_FLOWS; f++) {
+      sink += pgw_sdf_classify (&classifier, &flows[f]);
+    }
+    tss_ns = sdf_time_ns () - start_ns;
+    start_ns = sdf_time_ns ();
+    for (uint32_t f = 0; f < SDF_CHECK_FLOWS; f++) {
+      sink += sdf_ref_classify (added, &flows[f]);
+    }
+    linear_ns = sdf_time_ns () - start_ns;
+    printf ("%u SDF filters in %u tuples: %u ns per packet, linear scan %u ns per packet, %u%% hits\n", added, classifier.nb_tuples,
+        (uint32_t)(tss_ns / SDF_BENCH_FLOWS), (uint32_t)(linear_ns / SDF_CHECK_FLOWS), nb_hits * 100 / SDF_CHECK_FLOWS);
+  }
+  ck_assert_int_eq (classifier.nb_rules, SDF_BENCH_RULES);
+  for (uint32_t r = 0; r < SDF_BENCH_RULES; r++) {
+    ck_assert_int_eq (pgw_sdf_classifier_del (&classifier, r + 1), 1);
+  }
+  ck_assert_int_eq (classifier.nb_rules, 0);
+  pgw_sdf_classifier_destroy (&classifier);
+  free (flows);
+}
+END_TEST
+
+Suite * sdf_classifier_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("P-GW SDF classifier tests");
+
+    tc_core = tcase_create("P-GW SDF classifier test");
+    tcase_add_test(tc_core, sdf_classifier_rules_test);
+    tcase_add_test(tc_core, sdf_classifier_bench_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = sdf_classifier_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
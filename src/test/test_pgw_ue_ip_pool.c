@@ -0,0 +1,216 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "common_defs.h"
+#include "common_types.h"
+#include "pgw_config.h"
+#include "pgw_lite_paa.h"
+#include "pgw_ue_ip_address_alloc.h"
+
+//------------------------------------------------------------------------------
+static uint64_t pool_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static void pool_config (pgw_config_t * const config, const char * const net, const uint8_t mask)
+{
+  inet_pton (AF_INET, net, &config->ue_pool_addr[config->num_ue_pool]);
+  config->ue_pool_mask[config->num_ue_pool] = mask;
+  config->num_ue_pool += 1;
+}
+
+START_TEST(pool_bitmap_test)
+{
+  const uint32_t   sizes[] = {1, 63, 64, 65, 4097, 262145};
+  pgw_paa_bitmap_t bitmap = {0};
+  uint32_t         index = 0;
+
+  for (int s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++) {
+    ck_assert_int_eq (pgw_paa_bitmap_init (&bitmap, sizes[s]), RETURNok);
+    for (uint32_t i = 0; i < sizes[s]; i++) {
+      ck_assert_int_eq (pgw_paa_bitmap_get (&bitmap, &index), RETURNok);
+      ck_assert_int_eq (index, i);
+    }
+    ck_assert_int_eq (pgw_paa_bitmap_get (&bitmap, &index), RETURNerror);
+
+    ck_assert_int_eq (pgw_paa_bitmap_release (&bitmap, sizes[s] / 2), RETURNok);
+    ck_assert_int_eq (pgw_paa_bitmap_release (&bitmap, sizes[s] / 2), RETURNerror);
+    ck_assert_int_eq (pgw_paa_bitmap_release (&bitmap, sizes[s]), RETURNerror);
+    ck_assert_int_eq (pgw_paa_bitmap_get (&bitmap, &index), RETURNok);
+    ck_assert_int_eq (index, sizes[s] / 2);
+
+    ck_assert_int_eq (pgw_paa_bitmap_release (&bitmap, 0), RETURNok);
+    ck_assert_int_eq (pgw_paa_bitmap_reserve (&bitmap, 0), RETURNok);
+    ck_assert_int_eq (pgw_paa_bitmap_reserve (&bitmap, 0), RETURNerror);
+    ck_assert_int_eq (bitmap.nb_free, 0);
+    pgw_paa_bitmap_free (&bitmap);
+  }
+}
+END_TEST
+
+START_TEST(pool_next_fit_test)
+{
+  pgw_config_t   config = {0};
+  struct in_addr addr[3] = {{0}};
+  struct in_addr other = {0};
+
+  pool_config (&config, "10.0.0.0", 29);
+  ck_assert_int_eq (pgw_ip_address_pool_init (&config, 1), RETURNok);
+  // network address, gateway and broadcast are not handed out
+  for (int i = 0; i < 3; i++) {
+    ck_assert_int_eq (allocate_ue_ipv4_address (1 + i, &addr[i]), RETURNok);
+    ck_assert_int_eq (ntohl (addr[i].s_addr), 0x0A000002 + i);
+  }
+  // a released address is reused as late as possible
+  ck_assert_int_eq (release_ue_ipv4_address (1, &addr[0]), RETURNok);
+  ck_assert_int_eq (release_ue_ipv4_address (1, &addr[0]), RETURNerror);
+  ck_assert_int_eq (allocate_ue_ipv4_address (4, &other), RETURNok);
+  ck_assert_int_eq (ntohl (other.s_addr), 0x0A000005);
+  ck_assert_int_eq (allocate_ue_ipv4_address (5, &other), RETURNok);
+  ck_assert_int_eq (ntohl (other.s_addr), 0x0A000006);
+  ck_assert_int_eq (allocate_ue_ipv4_address (6, &other), RETURNok);
+  ck_assert_int_eq (other.s_addr, addr[0].s_addr);
+  ck_assert_int_eq (allocate_ue_ipv4_address (7, &other), RETURNerror);
+
+  other.s_addr = htonl (0x0A000001);
+  ck_assert_int_eq (release_ue_ipv4_address (1, &other), RETURNerror);
+  pgw_ip_address_pool_exit ();
+}
+END_TEST
+
+START_TEST(pool_sticky_test)
+{
+  pgw_config_t   config = {0};
+  struct in_addr first = {0};
+  struct in_addr addr = {0};
+
+  pool_config (&config, "10.0.0.0", 30);
+  pool_config (&config, "10.1.0.0", 24);
+  config.ue_pool_sticky = true;
+  ck_assert_int_eq (pgw_ip_address_pool_init (&config, 1), RETURNok);
+
+  // the /30 pool only has one address
+  ck_assert_int_eq (allocate_ue_ipv4_address (208950000000001, &first), RETURNok);
+  ck_assert_int_eq (ntohl (first.s_addr), 0x0A000002);
+  ck_assert_int_eq (allocate_ue_ipv4_address (208950000000002, &addr), RETURNok);
+  ck_assert_int_eq (ntohl (addr.s_addr), 0x0A010002);
+
+  // same address on re-attach, even if the next fit would give another one
+  ck_assert_int_eq (release_ue_ipv4_address (208950000000001, &first), RETURNok);
+  ck_assert_int_eq (allocate_ue_ipv4_address (208950000000001, &addr), RETURNok);
+  ck_assert_int_eq (addr.s_addr, first.s_addr);
+
+  // taken by somebody else in the meantime
+  ck_assert_int_eq (release_ue_ipv4_address (208950000000001, &first), RETURNok);
+  ck_assert_int_eq (pgw_reserve_ipv4_paa_address (&first), RETURNok);
+  ck_assert_int_eq (allocate_ue_ipv4_address (208950000000001, &addr), RETURNok);
+  ck_assert_int_eq (ntohl (addr.s_addr), 0x0A010003);
+  pgw_ip_address_pool_exit ();
+}
+END_TEST
+
+START_TEST(pool_shards_test)
+{
+  const uint32_t expected[] = {0x0A000004, 0x0A000005, 0x0A000006, 0x0A000002, 0x0A000003};
+  pgw_config_t   config = {0};
+  struct in_addr addr = {0};
+
+  // 5 addresses in ranges of 1, 1, 1 and 2 addresses
+  pool_config (&config, "10.0.0.0", 29);
+  ck_assert_int_eq (pgw_ip_address_pool_init (&config, 4), RETURNok);
+  pgw_paa_set_shard (2);
+  // own range first, then the ranges of the other shards
+  for (int i = 0; i < sizeof (expected) / sizeof (expected[0]); i++) {
+    ck_assert_int_eq (allocate_ue_ipv4_address (1 + i, &addr), RETURNok);
+    ck_assert_int_eq (ntohl (addr.s_addr), expected[i]);
+  }
+  ck_assert_int_eq (allocate_ue_ipv4_address (6, &addr), RETURNerror);
+  addr.s_addr = htonl (expected[1]);
+  ck_assert_int_eq (release_ue_ipv4_address (2, &addr), RETURNok);
+  pgw_paa_set_shard (0);
+  ck_assert_int_eq (allocate_ue_ipv4_address (2, &addr), RETURNok);
+  ck_assert_int_eq (ntohl (addr.s_addr), expected[1]);
+  pgw_ip_address_pool_exit ();
+
+  // the only address of a /30 goes to the last shard
+  config.num_ue_pool = 0;
+  pool_config (&config, "10.0.0.0", 30);
+  ck_assert_int_eq (pgw_ip_address_pool_init (&config, 4), RETURNok);
+  ck_assert_int_eq (allocate_ue_ipv4_address (1, &addr), RETURNok);
+  ck_assert_int_eq (ntohl (addr.s_addr), 0x0A000002);
+  ck_assert_int_eq (allocate_ue_ipv4_address (2, &addr), RETURNerror);
+  pgw_ip_address_pool_exit ();
+}
+END_TEST
+
+START_TEST(pool_startup_test)
+{
+  pgw_config_t   config = {0};
+  struct in_addr addr = {0};
+  uint64_t       start_us = 0;
+  uint64_t       load_us = 0;
+  uint64_t       alloc_us = 0;
+
+  pool_config (&config, "10.0.0.0", 8);
+  start_us = pool_time_us ();
+  ck_assert_int_eq (pgw_ip_address_pool_init (&config, 1), RETURNok);
+  load_us = pool_time_us () - start_us;
+
+  start_us = pool_time_us ();
+  for (uint32_t i = 0; i < (1 << 24) - 3; i++) {
+    ck_assert_int_eq (allocate_ue_ipv4_address (i, &addr), RETURNok);
+  }
+  alloc_us = pool_time_us () - start_us;
+  ck_assert_int_eq (ntohl (addr.s_addr), 0x0AFFFFFE);
+  ck_assert_int_eq (allocate_ue_ipv4_address (0, &addr), RETURNerror);
+  printf ("/8 UE pool: loaded in %u us, %u allocations in %u us\n", (uint32_t)load_us, (1 << 24) - 3, (uint32_t)alloc_us);
+  pgw_ip_address_pool_exit ();
+}
+END_TEST
+
+Suite * pool_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("P-GW UE IP address pool tests");
+
+    tc_core = tcase_create("P-GW UE IP address pool test");
+    tcase_add_test(tc_core, pool_bitmap_test);
+    tcase_add_test(tc_core, pool_next_fit_test);
+    tcase_add_test(tc_core, pool_sticky_test);
+    tcase_add_test(tc_core, pool_shards_test);
+    tcase_add_test(tc_core, pool_startup_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = pool_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,390 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "hashtable.h"
+#include "common_defs.h"
+#include "intertask_interface.h"
+#include "intertask_interface_init.h"
+#include "NwTypes.h"
+#include "NwError.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cMsg.h"
+#include "NwGtpv2cIe.h"
+#include "s11_common.h"
+#include "s11_mme_bearer_manager.h"
+#include "mme_app_ue_context.h"
+#include "mme_app_defs.h"
+
+#define RAB_QUEUED                100
+#define RAB_NB_REQUESTS           (S11_MME_RAB_WINDOW + RAB_QUEUED)
+#define RAB_GTPV2C_PORT           2123
+#define RAB_FIRST_LOCAL_TEID      0x1000
+// eNB reset: all its UEs at once, their requests fit in the TASK_S11 queue once batched
+#define RAB_ENB_RESET_ENB_ID      0x1234
+#define RAB_ENB_RESET_UES         10000
+#define RAB_ENB_RESET_MAX_US      1000000
+#define RAB_MAX_SESSIONS          RAB_ENB_RESET_UES
+
+typedef struct rab_request_s {
+  uint32_t                 seq_num;
+  teid_t                   remote_teid;
+} rab_request_t;
+
+// owned by s11_mme_task.c in the MME
+hash_table_ts_t                *s11_mme_teid_2_gtv2c_teid_handle = NULL;
+
+static nw_gtpv2c_stack_handle_t rab_stack = 0;
+static struct in_addr           rab_sgw_addr;
+// Release Access Bearers Requests sent to the S-GW, not answered yet
+static rab_request_t            rab_sent[RAB_MAX_SESSIONS];
+static uint32_t                 rab_nb_sent = 0;
+static uint32_t                 rab_nb_answered = 0;
+static uint32_t                 rab_nb_rsp = 0;
+// S1 signalling connections of the eNB being reset, as decoded by S1AP
+static mme_ue_s1ap_id_t         rab_mme_ue_s1ap_ids[RAB_ENB_RESET_UES];
+static enb_ue_s1ap_id_t         rab_enb_ue_s1ap_ids[RAB_ENB_RESET_UES];
+
+//------------------------------------------------------------------------------
+static uint64_t rab_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t rab_udp_data_req (nw_gtpv2c_udp_handle_t udpHandle, uint8_t * dataBuf, uint32_t dataSize, struct in_addr *peerIp, uint16_t peerPort)
+{
+  ck_assert_int_eq (peerIp->s_addr, rab_sgw_addr.s_addr);
+  ck_assert (dataSize >= 12);
+  ck_assert_int_eq (dataBuf[1], NW_GTP_RELEASE_ACCESS_BEARERS_REQ);
+  ck_assert (rab_nb_sent < sizeof (rab_sent) / sizeof (rab_sent[0]));
+  rab_sent[rab_nb_sent].remote_teid = ((uint32_t)dataBuf[4] << 24) | ((uint32_t)dataBuf[5] << 16) | ((uint32_t)dataBuf[6] << 8) | dataBuf[7];
+  rab_sent[rab_nb_sent].seq_num = ((uint32_t)dataBuf[8] << 16) | ((uint32_t)dataBuf[9] << 8) | dataBuf[10];
+  rab_nb_sent += 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t rab_tmr_start (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, uint32_t timeoutSec, uint32_t timeoutUsec, uint32_t tmrType,
+                              void *timeoutArg, nw_gtpv2c_timer_handle_t * hTmr)
+{
+  // no retransmission in these tests
+  *hTmr = 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t rab_tmr_stop (nw_gtpv2c_timer_mgr_handle_t tmrMgrHandle, nw_gtpv2c_timer_handle_t tmrHandle)
+{
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static nw_rc_t rab_ulp_req (nw_gtpv2c_ulp_handle_t hUlp, nw_gtpv2c_ulp_api_t * pUlpApi)
+{
+  // what s11_mme_handle_release_access_bearer_response() does with the window, without the ITTI message to MME_APP
+  ck_assert_int_eq (pUlpApi->apiType, NW_GTPV2C_ULP_API_TRIGGERED_RSP_IND);
+  ck_assert_int_eq (pUlpApi->u_api_info.triggeredRspIndInfo.msgType, NW_GTP_RELEASE_ACCESS_BEARERS_RSP);
+  ck_assert_int_eq (S11_MME_TRXN_TAG (pUlpApi->u_api_info.triggeredRspIndInfo.hUlpTrxn), S11_MME_TRXN_TAG_RAB_WINDOW);
+  s11_mme_release_access_bearers_window_release (&rab_stack, pUlpApi->u_api_info.triggeredRspIndInfo.hUlpTrxn);
+  nwGtpv2cMsgDelete (rab_stack, pUlpApi->hMsg);
+  rab_nb_rsp += 1;
+  return NW_OK;
+}
+
+//------------------------------------------------------------------------------
+static void rab_create_sessions (const char * const sgw_addr, const uint32_t nb_sessions)
+{
+  rab_sgw_addr.s_addr = inet_addr (sgw_addr);
+  // local tunnels of the sessions, as created with their Create Session Request
+  for (uint32_t i = 0; i < nb_sessions; i++) {
+    nw_gtpv2c_ulp_api_t  ulp_req;
+
+    memset (&ulp_req, 0, sizeof (ulp_req));
+    ulp_req.apiType = NW_GTPV2C_ULP_CREATE_LOCAL_TUNNEL;
+    ulp_req.u_api_info.createLocalTunnelInfo.teidLocal = RAB_FIRST_LOCAL_TEID + i;
+    ulp_req.u_api_info.createLocalTunnelInfo.peerIp = rab_sgw_addr;
+    ck_assert_int_eq (nwGtpv2cProcessUlpReq (rab_stack, &ulp_req), NW_OK);
+    ck_assert_int_eq (hashtable_ts_insert (s11_mme_teid_2_gtv2c_teid_handle, (hash_key_t) (RAB_FIRST_LOCAL_TEID + i),
+                                           (void *) ulp_req.u_api_info.createLocalTunnelInfo.hTunnel), HASH_TABLE_OK);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void rab_send_requests (const uint32_t nb_requests)
+{
+  for (uint32_t i = 0; i < nb_requests; i++) {
+    itti_s11_release_access_bearers_request_t req;
+
+    memset (&req, 0, sizeof (req));
+    req.local_teid = RAB_FIRST_LOCAL_TEID + i;
+    req.teid = 0x80000000 + i;
+    req.peer_ip = rab_sgw_addr;
+    req.originating_node = NODE_TYPE_MME;
+    ck_assert_int_eq (s11_mme_release_access_bearers_request (&rab_stack, &req), RETURNok);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void rab_answer (const uint32_t nb_responses)
+{
+  for (uint32_t i = 0; i < nb_responses; i++) {
+    // Release Access Bearers Response, Cause Request accepted
+    uint8_t              rsp[] = {0x48, NW_GTP_RELEASE_ACCESS_BEARERS_RSP, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                  NW_GTPV2C_IE_CAUSE, 0x00, 0x02, 0x00, 16, 0x00};
+    const rab_request_t *req_p = &rab_sent[rab_nb_answered++];
+    const teid_t         local_teid = RAB_FIRST_LOCAL_TEID + (req_p->remote_teid - 0x80000000);
+
+    ck_assert (rab_nb_answered <= rab_nb_sent);
+    rsp[4] = local_teid >> 24;
+    rsp[5] = local_teid >> 16;
+    rsp[6] = local_teid >> 8;
+    rsp[7] = local_teid;
+    rsp[8] = req_p->seq_num >> 16;
+    rsp[9] = req_p->seq_num >> 8;
+    rsp[10] = req_p->seq_num;
+    ck_assert_int_eq (nwGtpv2cProcessUdpReq (rab_stack, rsp, sizeof (rsp), RAB_GTPV2C_PORT, &rab_sgw_addr), NW_OK);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void rab_assert_window (const uint32_t outstanding, const uint32_t pending)
+{
+  uint32_t             window_outstanding = 0;
+  uint32_t             window_pending = 0;
+
+  s11_mme_release_access_bearers_window_get (rab_sgw_addr, &window_outstanding, &window_pending);
+  ck_assert_int_eq (window_outstanding, outstanding);
+  ck_assert_int_eq (window_pending, pending);
+  ck_assert_int_eq (rab_nb_sent - rab_nb_answered, outstanding);
+}
+
+START_TEST(rab_window_test)
+{
+  // one window per S-GW, kept from one test to the other
+  rab_create_sessions ("127.0.12.2", RAB_NB_REQUESTS);
+
+  // only the window is sent, the rest is queued
+  rab_send_requests (RAB_NB_REQUESTS);
+  ck_assert_int_eq (rab_nb_sent, S11_MME_RAB_WINDOW);
+  rab_assert_window (S11_MME_RAB_WINDOW, RAB_QUEUED);
+
+  // each response lets one queued request go
+  rab_answer (RAB_QUEUED / 2);
+  ck_assert_int_eq (rab_nb_sent, S11_MME_RAB_WINDOW + RAB_QUEUED / 2);
+  rab_assert_window (S11_MME_RAB_WINDOW, RAB_QUEUED / 2);
+
+  // responses of other modules do not release the window
+  s11_mme_release_access_bearers_window_release (&rab_stack, S11_MME_TRXN (S11_MME_TRXN_TAG_ECHO, 0));
+  s11_mme_release_access_bearers_window_release (&rab_stack, S11_MME_TRXN (S11_MME_TRXN_TAG_CREATE_SESSION, 5));
+  rab_assert_window (S11_MME_RAB_WINDOW, RAB_QUEUED / 2);
+
+  // the queue drains as responses come back
+  while (rab_nb_answered < rab_nb_sent) {
+    rab_answer (rab_nb_sent - rab_nb_answered);
+  }
+  ck_assert_int_eq (rab_nb_sent, RAB_NB_REQUESTS);
+  ck_assert_int_eq (rab_nb_rsp, RAB_NB_REQUESTS);
+  rab_assert_window (0, 0);
+}
+END_TEST
+
+START_TEST(rab_window_path_failure_test)
+{
+  rab_create_sessions ("127.0.12.3", RAB_NB_REQUESTS);
+
+  rab_send_requests (RAB_NB_REQUESTS);
+  rab_assert_window (S11_MME_RAB_WINDOW, RAB_QUEUED);
+
+  // path failure: nothing more is sent to the S-GW, the requests in flight end
+  s11_mme_release_access_bearers_window_drop (rab_sgw_addr);
+  rab_assert_window (S11_MME_RAB_WINDOW, 0);
+  rab_answer (S11_MME_RAB_WINDOW);
+  ck_assert_int_eq (rab_nb_sent, S11_MME_RAB_WINDOW);
+  rab_assert_window (0, 0);
+}
+END_TEST
+
+/*
+ * UE contexts of the MME_APP, connected through the eNB being reset, each
+ * with one PDN on the S-GW of the sessions
+ */
+//------------------------------------------------------------------------------
+static void rab_create_ue_contexts (s1_sig_conn_id_t * const ue_to_reset_list, const uint32_t nb_ues)
+{
+  bstring                      b = bfromcstr ("mme_app_mme_ue_s1ap_id_ue_context_htbl");
+
+  mme_app_desc.mme_ue_contexts.mme_ue_s1ap_id_ue_context_htbl = hashtable_ts_create (nb_ues, NULL, NULL, b);
+  btrunc (b, 0);
+  bassigncstr (b, "mme_app_enb_ue_s1ap_id_ue_context_htbl");
+  mme_app_desc.mme_ue_contexts.enb_ue_s1ap_id_ue_context_htbl = hashtable_uint64_ts_create (nb_ues, NULL, b);
+  btrunc (b, 0);
+  bassigncstr (b, "mme_app_tun11_ue_context_htbl");
+  mme_app_desc.mme_ue_contexts.tun11_ue_context_htbl = hashtable_uint64_ts_create (nb_ues, NULL, b);
+  bdestroy (b);
+
+  for (uint32_t i = 0; i < nb_ues; i++) {
+    ue_mm_context_t     *ue_mm_context = mme_create_new_ue_context ();
+    pdn_context_t       *pdn_context = calloc (1, sizeof (pdn_context_t));
+
+    ck_assert (ue_mm_context != NULL);
+    ck_assert (pdn_context != NULL);
+    ue_mm_context->mme_ue_s1ap_id = i + 1;
+    ue_mm_context->enb_ue_s1ap_id = i;
+    MME_APP_ENB_S1AP_ID_KEY (ue_mm_context->enb_s1ap_id_key, RAB_ENB_RESET_ENB_ID, i);
+    ue_mm_context->mm_state = UE_REGISTERED;
+    ue_mm_context->ecm_state = ECM_CONNECTED;
+    ue_mm_context->mme_teid_s11 = RAB_FIRST_LOCAL_TEID + i;
+    pdn_context->s_gw_teid_s11_s4 = 0x80000000 + i;
+    pdn_context->s_gw_address_s11_s4.pdn_type = IPv4;
+    pdn_context->s_gw_address_s11_s4.address.ipv4_address = rab_sgw_addr;
+    ue_mm_context->pdn_contexts[0] = pdn_context;
+    ck_assert_int_eq (mme_insert_ue_context (&mme_app_desc.mme_ue_contexts, ue_mm_context), RETURNok);
+    unlock_ue_contexts (ue_mm_context);
+
+    rab_mme_ue_s1ap_ids[i] = ue_mm_context->mme_ue_s1ap_id;
+    rab_enb_ue_s1ap_ids[i] = ue_mm_context->enb_ue_s1ap_id;
+    ue_to_reset_list[i].mme_ue_s1ap_id = &rab_mme_ue_s1ap_ids[i];
+    ue_to_reset_list[i].enb_ue_s1ap_id = &rab_enb_ue_s1ap_ids[i];
+  }
+}
+
+/*
+ * eNB reset of RAB_ENB_RESET_UES UEs: the MME_APP batches their Release Access
+ * Bearers Requests, the S11 task hands them to the window, the S-GW answers
+ * each one as soon as it is sent. The clock stops when the last response is in.
+ */
+START_TEST(rab_enb_reset_test)
+{
+  itti_s1ap_enb_initiated_reset_req_t reset_req = {0};
+  MessageDef                  *message_p = NULL;
+  uint32_t                     nb_batches = 0;
+  uint32_t                     nb_requests = 0;
+  uint64_t                     start_us = 0;
+  uint64_t                     clear_us = 0;
+
+  ck_assert_int_eq (itti_init (TASK_MAX, THREAD_MAX, MESSAGES_ID_MAX, tasks_info, messages_info, NULL, NULL), RETURNok);
+  // this thread plays the S11 task and the S1AP task
+  itti_mark_task_ready (TASK_S11);
+  itti_mark_task_ready (TASK_S1AP);
+
+  rab_create_sessions ("127.0.12.4", RAB_ENB_RESET_UES);
+  reset_req.enb_id = RAB_ENB_RESET_ENB_ID;
+  reset_req.s1ap_reset_type = RESET_ALL;
+  reset_req.num_ue = RAB_ENB_RESET_UES;
+  reset_req.ue_to_reset_list = calloc (RAB_ENB_RESET_UES, sizeof (s1_sig_conn_id_t));
+  ck_assert (reset_req.ue_to_reset_list != NULL);
+  rab_create_ue_contexts (reset_req.ue_to_reset_list, RAB_ENB_RESET_UES);
+
+  start_us = rab_time_us ();
+  mme_app_handle_enb_reset_req (&reset_req);
+
+  // what s11_mme_thread() does with the batches
+  for (itti_poll_msg (TASK_S11, &message_p); message_p; itti_poll_msg (TASK_S11, &message_p)) {
+    itti_s11_release_access_bearers_request_batch_t *batch_p = &message_p->ittiMsg.s11_release_access_bearers_request_batch;
+
+    ck_assert_int_eq (ITTI_MSG_ID (message_p), S11_RELEASE_ACCESS_BEARERS_REQUEST_BATCH);
+    for (uint32_t i = 0; i < batch_p->nb_requests; i++) {
+      ck_assert_int_eq (s11_mme_release_access_bearers_request (&rab_stack, &batch_p->request[i]), RETURNok);
+    }
+    nb_requests += batch_p->nb_requests;
+    nb_batches += 1;
+    itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
+  }
+  ck_assert_int_eq (nb_requests, RAB_ENB_RESET_UES);
+  ck_assert_int_eq (nb_batches, (RAB_ENB_RESET_UES + S11_RELEASE_ACCESS_BEARERS_BATCH_MAX - 1) / S11_RELEASE_ACCESS_BEARERS_BATCH_MAX);
+  rab_assert_window (S11_MME_RAB_WINDOW, RAB_ENB_RESET_UES - S11_MME_RAB_WINDOW);
+
+  while (rab_nb_answered < rab_nb_sent) {
+    rab_answer (rab_nb_sent - rab_nb_answered);
+  }
+  clear_us = rab_time_us () - start_us;
+  ck_assert_int_eq (rab_nb_sent, RAB_ENB_RESET_UES);
+  ck_assert_int_eq (rab_nb_rsp, RAB_ENB_RESET_UES);
+  rab_assert_window (0, 0);
+
+  // the reset is acknowledged to S1AP, which frees the list
+  itti_poll_msg (TASK_S1AP, &message_p);
+  ck_assert (message_p != NULL);
+  ck_assert_int_eq (ITTI_MSG_ID (message_p), S1AP_ENB_INITIATED_RESET_ACK);
+  ck_assert_int_eq (S1AP_ENB_INITIATED_RESET_ACK (message_p).num_ue, RAB_ENB_RESET_UES);
+  free (S1AP_ENB_INITIATED_RESET_ACK (message_p).ue_to_reset_list);
+  itti_free (ITTI_MSG_ORIGIN_ID (message_p), message_p);
+
+  printf ("eNB reset of %u UEs: %u S11 batches, bearers released in %" PRIu64 " us\n", RAB_ENB_RESET_UES, nb_batches, clear_us);
+  ck_assert (clear_us < RAB_ENB_RESET_MAX_US);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void rab_setup (void)
+{
+  nw_gtpv2c_ulp_entity_t       ulp = {.hUlp = 0, .ulpReqCallback = rab_ulp_req};
+  nw_gtpv2c_udp_entity_t       udp = {.hUdp = 0, .udpDataReqCallback = rab_udp_data_req};
+  nw_gtpv2c_timer_mgr_entity_t tmr_mgr = {.tmrMgrHandle = 0, .tmrStartCallback = rab_tmr_start, .tmrStopCallback = rab_tmr_stop};
+  bstring                      b = bfromcstr ("s11_mme_teid_2_gtv2c_teid_handle");
+
+  rab_nb_sent = rab_nb_answered = rab_nb_rsp = 0;
+  ck_assert_int_eq (nwGtpv2cInitialize (&rab_stack), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetUlpEntity (rab_stack, &ulp), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetUdpEntity (rab_stack, &udp), NW_OK);
+  ck_assert_int_eq (nwGtpv2cSetTimerMgrEntity (rab_stack, &tmr_mgr), NW_OK);
+  s11_mme_teid_2_gtv2c_teid_handle = hashtable_ts_create (RAB_MAX_SESSIONS, HASH_TABLE_DEFAULT_HASH_FUNC, hash_free_int_func, b);
+  bdestroy (b);
+  ck_assert (s11_mme_teid_2_gtv2c_teid_handle != NULL);
+  s11_mme_bearer_manager_init ();
+
+}
+
+//------------------------------------------------------------------------------
+static void rab_teardown (void)
+{
+  hashtable_ts_destroy (s11_mme_teid_2_gtv2c_teid_handle);
+  s11_mme_teid_2_gtv2c_teid_handle = NULL;
+  nwGtpv2cFinalize (rab_stack);
+  rab_stack = 0;
+}
+
+Suite * rab_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("S11 MME Release Access Bearers window tests");
+
+    tc_core = tcase_create("S11 MME Release Access Bearers window test");
+    tcase_add_checked_fixture(tc_core, rab_setup, rab_teardown);
+    tcase_add_test(tc_core, rab_window_test);
+    tcase_add_test(tc_core, rab_window_path_failure_test);
+    tcase_add_test(tc_core, rab_enb_reset_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = rab_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
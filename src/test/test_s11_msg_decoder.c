@@ -0,0 +1,353 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "bstrlib.h"
+
+#include "common_defs.h"
+#include "log.h"
+#include "assertions.h"
+#include "conversions.h"
+#include "3gpp_33.401.h"
+#include "3gpp_23.003.h"
+#include "3gpp_24.008.h"
+#include "3gpp_24.007.h"
+#include "3gpp_29.274.h"
+#include "3gpp_36.413.h"
+#include "NwGtpv2c.h"
+#include "NwGtpv2cIe.h"
+#include "NwGtpv2cMsg.h"
+#include "NwGtpv2cMsgParser.h"
+#include "s11_common.h"
+#include "security_types.h"
+#include "common_types.h"
+#include "sgw_ie_defs.h"
+#include "s11_ie_formatter.h"
+
+#define DECODER_FUZZ_ITERATIONS  20000
+#define DECODER_MSG_MAX          512
+#define DECODER_BEARER_MAX       2
+
+typedef struct decoder_ctx_s {
+  gtpv2c_cause_t            cause;
+  fteid_t                   sender_fteid;
+  fteid_t                   pgw_fteid;
+  ambr_t                    ambr;
+  rat_type_t                rat_type;
+  pdn_type_t                pdn_type;
+  node_type_t               node_type;
+  indication_flags_t        indication_flags;
+  bearer_contexts_created_t bearer_contexts_created;
+} decoder_ctx_t;
+
+typedef struct decoder_ie_s {
+  uint8_t                   type;
+  uint8_t                   instance;
+  uint8_t                   presence;
+  s11_ie_decoder_t          decoder;
+  nw_rc_t                 (*ie_get) (uint8_t ieType, uint8_t ieLength, uint8_t ieInstance, uint8_t * ieValue, void *arg);
+  size_t                    offset;
+} decoder_ie_t;
+
+typedef struct decoder_msg_s {
+  uint32_t                  length;
+  bool                      truncated_ie_header;
+} decoder_msg_t;
+
+#define DECODER_IE(tYpE, iNsT, pReSeNcE, dEcOdEr, gEt, fIeLd) {tYpE, iNsT, pReSeNcE, dEcOdEr, gEt, offsetof (decoder_ctx_t, fIeLd)}
+
+// Same decoders as the S11 handlers, restricted to IEs whose decoding has no assertion on content.
+// Mandatory IEs sorted by type, nwGtpv2cMsgParserRun() reports the missing one of lowest type.
+static const decoder_ie_t decoder_ies[] = {
+  DECODER_IE (NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, gtpv2c_cause_ie_get, cause),
+  DECODER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_FTEID, gtpv2c_fteid_ie_get, sender_fteid),
+  DECODER_IE (NW_GTPV2C_IE_FTEID, NW_GTPV2C_IE_INSTANCE_ONE, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_FTEID, gtpv2c_fteid_ie_get, pgw_fteid),
+  DECODER_IE (NW_GTPV2C_IE_AMBR, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_AMBR, gtpv2c_ambr_ie_get, ambr),
+  DECODER_IE (NW_GTPV2C_IE_RAT_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_RAT_TYPE, gtpv2c_rat_type_ie_get, rat_type),
+  DECODER_IE (NW_GTPV2C_IE_PDN_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_PDN_TYPE, gtpv2c_pdn_type_ie_get, pdn_type),
+  DECODER_IE (NW_GTPV2C_IE_NODE_TYPE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_NODE_TYPE, gtpv2c_node_type_ie_get, node_type),
+  DECODER_IE (NW_GTPV2C_IE_INDICATION, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_INDICATION_FLAGS, gtpv2c_indication_flags_ie_get, indication_flags),
+  DECODER_IE (NW_GTPV2C_IE_BEARER_CONTEXT, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_BEARER_CONTEXT_CREATED,
+              gtpv2c_bearer_context_created_ie_get, bearer_contexts_created),
+};
+
+#define DECODER_ARRAY_SIZE(aRrAy) (sizeof (aRrAy) / sizeof (aRrAy[0]))
+
+static nw_gtpv2c_stack_handle_t         decoder_stack = 0;
+static s11_msg_decoder_t                decoder;
+static nw_gtpv2c_msg_parser_t          *decoder_parser = NULL;
+static decoder_ctx_t                    decoder_parser_ctx;
+static uint32_t                         decoder_seed = 0;
+
+//------------------------------------------------------------------------------
+static uint32_t decoder_rand (const uint32_t range)
+{
+  decoder_seed = decoder_seed * 1103515245 + 12345;
+  return (decoder_seed >> 8) % range;
+}
+
+//------------------------------------------------------------------------------
+static uint8_t *decoder_ie_put (uint8_t * p, const uint8_t type, const uint16_t length, const uint8_t instance)
+{
+  p[0] = type;
+  p[1] = length >> 8;
+  p[2] = length & 0xFF;
+  p[3] = instance & 0x0F;
+  return p + 4;
+}
+
+//------------------------------------------------------------------------------
+static uint8_t *decoder_value_put (uint8_t * p, const uint16_t length)
+{
+  for (int i = 0; i < length; i++) {
+    *p++ = decoder_rand (256);
+  }
+  return p;
+}
+
+//------------------------------------------------------------------------------
+static uint8_t *decoder_fteid_put (uint8_t * p, const uint8_t instance)
+{
+  p = decoder_ie_put (p, NW_GTPV2C_IE_FTEID, 9, instance);
+  p = decoder_value_put (p, 9);
+  // IPv4 only, the IPv6 flag would make the decoder read past the IE
+  p[-9] = 0x80 | (p[-9] & 0x1F);
+  return p;
+}
+
+//------------------------------------------------------------------------------
+static uint8_t *decoder_bearer_context_put (uint8_t * p)
+{
+  uint8_t                                *ie = p;
+  uint8_t                                *v = p + 4;
+
+  v = decoder_ie_put (v, NW_GTPV2C_IE_EBI, 1, 0);
+  v = decoder_value_put (v, 1);
+  if (decoder_rand (2)) {
+    v = decoder_ie_put (v, NW_GTPV2C_IE_CAUSE, 2, 0);
+    v = decoder_value_put (v, 2);
+  }
+  if (decoder_rand (2)) {
+    v = decoder_fteid_put (v, decoder_rand (2));
+  }
+  decoder_ie_put (ie, NW_GTPV2C_IE_BEARER_CONTEXT, v - ie - 4, 0);
+  return v;
+}
+
+//------------------------------------------------------------------------------
+/*
+ * Random Create Session Response. nwGtpv2cMsgParserRun() counts a mandatory IE
+ * each time it is received and indexes its IE table with the raw instance,
+ * so mandatory IEs are not repeated and instances stay below
+ * NW_GTPV2C_IE_INSTANCE_MAXIMUM: outside of this both parsers differ by design.
+ */
+static decoder_msg_t decoder_msg_build (uint8_t * const buffer)
+{
+  uint8_t                                *p = buffer + 12;
+  uint8_t                                *last_ie = NULL;
+  const int                               ie_count = decoder_rand (12);
+  int                                     bearer_contexts = 0;
+  bool                                    cause = false;
+  bool                                    sender_fteid = false;
+  decoder_msg_t                           msg = {0};
+
+  for (int i = 0; i < ie_count; i++) {
+    last_ie = p;
+    switch (decoder_rand (12)) {
+    case 0:
+    case 1:
+      if (!cause) {
+        const uint16_t length = decoder_rand (2) ? 2 : 6;
+
+        cause = true;
+        p = decoder_ie_put (p, NW_GTPV2C_IE_CAUSE, length, 0);
+        p = decoder_value_put (p, length);
+      }
+      break;
+    case 2:
+    case 3:{
+        const uint8_t instance = decoder_rand (2);
+
+        if (instance || !sender_fteid) {
+          sender_fteid |= (0 == instance);
+          p = decoder_fteid_put (p, instance);
+        }
+      }
+      break;
+    case 4:
+      p = decoder_ie_put (p, NW_GTPV2C_IE_AMBR, 8, 0);
+      p = decoder_value_put (p, 8);
+      break;
+    case 5:
+      p = decoder_ie_put (p, NW_GTPV2C_IE_RAT_TYPE, 1, 0);
+      p = decoder_value_put (p, 1);
+      break;
+    case 6:
+      p = decoder_ie_put (p, NW_GTPV2C_IE_PDN_TYPE, 1, 0);
+      p = decoder_value_put (p, 1);
+      break;
+    case 7:
+      p = decoder_ie_put (p, NW_GTPV2C_IE_NODE_TYPE, 1, 0);
+      p = decoder_value_put (p, 1);
+      break;
+    case 8:
+      p = decoder_ie_put (p, NW_GTPV2C_IE_INDICATION, 3, 0);
+      p = decoder_value_put (p, 3);
+      break;
+    case 9:
+      if (DECODER_BEARER_MAX > bearer_contexts++) {
+        p = decoder_bearer_context_put (p);
+      }
+      break;
+    case 10:
+      // Known type with an instance not in the table
+      p = decoder_ie_put (p, NW_GTPV2C_IE_CAUSE, 2, 2 + decoder_rand (NW_GTPV2C_IE_INSTANCE_MAXIMUM - 2));
+      p = decoder_value_put (p, 2);
+      break;
+    default:{
+        // Unknown type
+        const uint16_t length = decoder_rand (16);
+
+        p = decoder_ie_put (p, NW_GTPV2C_IE_PRIVATE_EXTENSION - 1 - decoder_rand (16), length, decoder_rand (NW_GTPV2C_IE_INSTANCE_MAXIMUM));
+        p = decoder_value_put (p, length);
+      }
+    }
+  }
+  if ((p > buffer + 12) && (0 == decoder_rand (8))) {
+    // Truncated message, last IE overruns it
+    p -= 1;
+    msg.truncated_ie_header = (p - last_ie < 4);
+  }
+
+  msg.length = p - buffer;
+  buffer[0] = 0x48;
+  buffer[1] = NW_GTP_CREATE_SESSION_RSP;
+  buffer[2] = (msg.length - 4) >> 8;
+  buffer[3] = (msg.length - 4) & 0xFF;
+  memset (&buffer[4], 0, 8);
+  return msg;
+}
+
+START_TEST(decoder_fuzz_test)
+{
+  static uint8_t                          buffer[DECODER_MSG_MAX];
+  uint32_t                                results[3] = {0};
+
+  decoder_seed = 2017;
+  for (int n = 0; n < DECODER_FUZZ_ITERATIONS; n++) {
+    const decoder_msg_t                     msg = decoder_msg_build (buffer);
+    nw_gtpv2c_msg_handle_t                  hMsg = 0;
+    decoder_ctx_t                           decoder_ctx;
+    uint8_t                                 parser_ie_type = 0, decoder_ie_type = 0;
+    uint8_t                                 parser_ie_instance = 0, decoder_ie_instance = 0;
+    uint16_t                                parser_ie_length = 0, decoder_ie_length = 0;
+    nw_rc_t                                 parser_rc = NW_OK;
+    nw_rc_t                                 decoder_rc = NW_OK;
+
+    memset (&decoder_parser_ctx, 0, sizeof (decoder_parser_ctx));
+    memset (&decoder_ctx, 0, sizeof (decoder_ctx));
+    ck_assert_int_eq (nwGtpv2cMsgFromBufferNew (decoder_stack, buffer, msg.length, &hMsg), NW_OK);
+    parser_rc = nwGtpv2cMsgParserRun (decoder_parser, hMsg, &parser_ie_type, &parser_ie_instance, &parser_ie_length);
+    decoder_rc = s11_msg_decode (&decoder, hMsg, &decoder_ctx, &decoder_ie_type, &decoder_ie_instance, &decoder_ie_length);
+    ck_assert_int_eq (parser_rc, decoder_rc);
+    // Both stop at the same IE, what was decoded before matches
+    ck_assert (memcmp (&decoder_parser_ctx, &decoder_ctx, sizeof (decoder_ctx_t)) == 0);
+    if (NW_OK == decoder_rc) {
+      results[0] += 1;
+    } else if (NW_GTPV2C_MANDATORY_IE_MISSING == decoder_rc) {
+      ck_assert_int_eq (parser_ie_type, decoder_ie_type);
+      ck_assert_int_eq (parser_ie_instance, decoder_ie_instance);
+      results[1] += 1;
+    } else {
+      // nwGtpv2cMsgParserRun() reads a truncated IE header past the message
+      if (!msg.truncated_ie_header) {
+        ck_assert_int_eq (parser_ie_type, decoder_ie_type);
+        ck_assert_int_eq (parser_ie_instance, decoder_ie_instance);
+        ck_assert_int_eq (parser_ie_length, decoder_ie_length);
+      }
+      results[2] += 1;
+    }
+    nwGtpv2cMsgDelete (decoder_stack, hMsg);
+  }
+  // All outcomes exercised
+  ck_assert (results[0] > 0);
+  ck_assert (results[1] > 0);
+  ck_assert (results[2] > 0);
+}
+END_TEST
+
+START_TEST(decoder_duplicate_ie_test)
+{
+  s11_msg_decoder_ie_t                    ies[2] = {
+    {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_MANDATORY, S11_IE_DECODER_CAUSE, 0},
+    {NW_GTPV2C_IE_CAUSE, NW_GTPV2C_IE_INSTANCE_ZERO, NW_GTPV2C_IE_PRESENCE_CONDITIONAL, S11_IE_DECODER_CAUSE, 0},
+  };
+  s11_msg_decoder_t                       duplicate;
+
+  ck_assert_int_eq (s11_msg_decoder_init (&duplicate, NW_GTP_CREATE_SESSION_RSP, ies, 2), RETURNerror);
+  ies[1].ie_instance = NW_GTPV2C_IE_INSTANCE_ONE;
+  ck_assert_int_eq (s11_msg_decoder_init (&duplicate, NW_GTP_CREATE_SESSION_RSP, ies, 2), RETURNok);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void decoder_setup (void)
+{
+  s11_msg_decoder_ie_t                    ies[DECODER_ARRAY_SIZE (decoder_ies)];
+
+  ck_assert_int_eq (nwGtpv2cInitialize (&decoder_stack), NW_OK);
+  ck_assert_int_eq (nwGtpv2cMsgParserNew (decoder_stack, NW_GTP_CREATE_SESSION_RSP, NULL, NULL, &decoder_parser), NW_OK);
+  for (int i = 0; i < DECODER_ARRAY_SIZE (decoder_ies); i++) {
+    ies[i] = (s11_msg_decoder_ie_t) {decoder_ies[i].type, decoder_ies[i].instance, decoder_ies[i].presence, decoder_ies[i].decoder, decoder_ies[i].offset};
+    ck_assert_int_eq (nwGtpv2cMsgParserAddIe (decoder_parser, decoder_ies[i].type, decoder_ies[i].instance, decoder_ies[i].presence, decoder_ies[i].ie_get,
+                                              ((uint8_t *) &decoder_parser_ctx) + decoder_ies[i].offset), NW_OK);
+  }
+  ck_assert_int_eq (s11_msg_decoder_init (&decoder, NW_GTP_CREATE_SESSION_RSP, ies, DECODER_ARRAY_SIZE (ies)), RETURNok);
+}
+
+//------------------------------------------------------------------------------
+static void decoder_teardown (void)
+{
+  nwGtpv2cMsgParserDelete (decoder_stack, decoder_parser);
+  decoder_parser = NULL;
+  nwGtpv2cFinalize (decoder_stack);
+  decoder_stack = 0;
+}
+
+Suite * decoder_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("S11 message decoder tests");
+
+    tc_core = tcase_create("S11 message decoder test");
+    tcase_add_checked_fixture(tc_core, decoder_setup, decoder_teardown);
+    tcase_add_test(tc_core, decoder_fuzz_test);
+    tcase_add_test(tc_core, decoder_duplicate_ie_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = decoder_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
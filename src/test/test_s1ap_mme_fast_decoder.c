@@ -0,0 +1,152 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bstrlib.h"
+#include "s1ap_common.h"
+#include "s1ap_ies_defs.h"
+#include "s1ap_mme_decoder.h"
+#include "s1ap_mme_fast_decoder.h"
+
+#define FAST_DECODER_MAX_PDU_LENGTH 128
+
+typedef struct fast_decoder_pdu_s {
+  const char *name;
+  uint8_t     buffer[FAST_DECODER_MAX_PDU_LENGTH];
+  int         length;
+  bool        fast_path;    // expected to be handled by the fast decoder
+} fast_decoder_pdu_t;
+
+/*
+ * Corpus of eNB originated PDUs (APER), decoded by both decoders.
+ */
+static const fast_decoder_pdu_t fast_decoder_corpus[] = {
+  {
+    .name = "Uplink NAS transport",
+    .buffer = {
+      0x00, 0x0D, 0x40, 0x41, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00,
+      0x05, 0xC0, 0x01, 0x10, 0xCE, 0xCC, 0x00, 0x08, 0x00, 0x03,
+      0x40, 0x01, 0xB3, 0x00, 0x1A, 0x00, 0x14, 0x13, 0x27, 0xD3,
+      0x77, 0xED, 0x4C, 0x01, 0x02, 0x01, 0xDA, 0x28, 0x08, 0x03,
+      0x69, 0x6D, 0x73, 0x03, 0x70, 0x66, 0x74, 0x00, 0x64, 0x40,
+      0x08, 0x00, 0x02, 0xF8, 0x29, 0x00, 0x00, 0x20, 0x40, 0x00,
+      0x43, 0x40, 0x06, 0x00, 0x02, 0xF8, 0x29, 0x00, 0x04},
+    .length = 69,
+    .fast_path = true,
+  },
+  {
+    .name = "Initial UE message (attach)",
+    .buffer = {
+      0x00, 0x0C, 0x40, 0x2D, 0x00, 0x00, 0x05, 0x00, 0x08, 0x00,
+      0x02, 0x00, 0x01, 0x00, 0x1A, 0x00, 0x05, 0x04, 0x07, 0x41,
+      0x71, 0x08, 0x00, 0x43, 0x00, 0x06, 0x00, 0x02, 0xF8, 0x39,
+      0x00, 0x01, 0x00, 0x64, 0x40, 0x08, 0x00, 0x02, 0xF8, 0x39,
+      0x00, 0x00, 0x10, 0x10, 0x00, 0x86, 0x40, 0x01, 0x30},
+    .length = 49,
+    .fast_path = true,
+  },
+  {
+    .name = "Initial UE message (service request, S-TMSI, GUMMEI)",
+    .buffer = {
+      0x00, 0x0C, 0x40, 0x42, 0x00, 0x00, 0x07, 0x00, 0x08, 0x00,
+      0x02, 0x00, 0x02, 0x00, 0x1A, 0x00, 0x05, 0x04, 0xC7, 0x01,
+      0x23, 0x45, 0x00, 0x43, 0x00, 0x06, 0x00, 0x02, 0xF8, 0x39,
+      0x00, 0x01, 0x00, 0x64, 0x40, 0x08, 0x00, 0x02, 0xF8, 0x39,
+      0x00, 0x00, 0x10, 0x10, 0x00, 0x86, 0x40, 0x01, 0x40, 0x00,
+      0x60, 0x00, 0x06, 0x00, 0x40, 0xC0, 0xA8, 0x01, 0x02, 0x00,
+      0x4B, 0x00, 0x07, 0x00, 0x02, 0xF8, 0x39, 0x80, 0x01, 0x01},
+    .length = 70,
+    .fast_path = true,
+  },
+  {
+    .name = "UE context release complete",
+    .buffer = {
+      0x20, 0x17, 0x00, 0x13, 0x00, 0x00, 0x02, 0x00, 0x00, 0x40,
+      0x05, 0xC0, 0x01, 0x10, 0xCE, 0xCC, 0x00, 0x08, 0x40, 0x03,
+      0x40, 0x01, 0xB3},
+    .length = 23,
+    .fast_path = true,
+  },
+  {
+    .name = "UE capability info indication",
+    .buffer = {
+      0x00, 0x16, 0x40, 0x37, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+      0x05, 0xC0, 0x01, 0x10, 0xCE, 0xCC, 0x00, 0x08, 0x00, 0x03,
+      0x40, 0x01, 0xB3, 0x00, 0x4A, 0x40, 0x20, 0x1F, 0x00, 0xE8,
+      0x01, 0x01, 0xA8, 0x13, 0x80, 0x00, 0x20, 0x83, 0x13, 0x05,
+      0x0B, 0x8B, 0xFC, 0x2E, 0x2F, 0xF0, 0xB8, 0xBF, 0xAF, 0x87,
+      0xFE, 0x40, 0x44, 0x04, 0x07, 0x0C, 0xA7, 0x4A, 0x80},
+    .length = 59,
+    .fast_path = false,
+  },
+};
+
+START_TEST(fast_decoder_corpus_test)
+{
+  for (int i = 0; i < sizeof (fast_decoder_corpus) / sizeof (fast_decoder_corpus[0]); i++) {
+    s1ap_message fast = {0};
+    s1ap_message ref  = {0};
+    MessagesIds  ref_id = MESSAGES_ID_MAX;
+    bstring      raw = blk2bstr (fast_decoder_corpus[i].buffer, fast_decoder_corpus[i].length);
+
+    bool decoded = s1ap_mme_fast_decode_pdu (&fast, raw);
+    ck_assert_msg (decoded == fast_decoder_corpus[i].fast_path, "Fast path selection failed for %s", fast_decoder_corpus[i].name);
+    ck_assert_msg (s1ap_mme_decode_pdu_asn1c (&ref, raw, &ref_id) >= 0, "asn1c failed to decode %s", fast_decoder_corpus[i].name);
+    if (decoded) {
+      ck_assert_msg (s1ap_mme_fast_decoder_compare (&fast, &ref), "Fast decoder mismatch for %s", fast_decoder_corpus[i].name);
+    }
+    if (ref_id != MESSAGES_ID_MAX) {
+      s1ap_free_mme_decode_pdu (&ref, ref_id);
+    }
+    bdestroy (raw);
+  }
+}
+END_TEST
+
+START_TEST(fast_decoder_truncated_test)
+{
+  /*
+   * Every truncation of a valid PDU must be rejected by the fast path
+   */
+  for (int i = 0; i < sizeof (fast_decoder_corpus) / sizeof (fast_decoder_corpus[0]); i++) {
+    for (int length = 0; length < fast_decoder_corpus[i].length; length++) {
+      s1ap_message fast = {0};
+      bstring      raw = blk2bstr (fast_decoder_corpus[i].buffer, length);
+
+      ck_assert_msg (!s1ap_mme_fast_decode_pdu (&fast, raw), "Truncated %s (%d bytes) accepted", fast_decoder_corpus[i].name, length);
+      bdestroy (raw);
+    }
+  }
+}
+END_TEST
+
+Suite * fast_decoder_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("S1AP fast decoder tests");
+
+    tc_core = tcase_create("S1AP fast decoder test");
+    tcase_add_test(tc_core, fast_decoder_corpus_test);
+    tcase_add_test(tc_core, fast_decoder_truncated_test);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = fast_decoder_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
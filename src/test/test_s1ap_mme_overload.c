@@ -0,0 +1,349 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bstrlib.h"
+#include "intertask_interface_init.h"
+#include "dynamic_memory_check.h"
+#include "sctp_itti_messaging.h"
+#include "s1ap_mme_overload.h"
+
+#define OVERLOAD_MAX_PENDING            100
+#define OVERLOAD_INITIAL_UE_MAX_PENDING 20
+#define OVERLOAD_START_LATENCY_MS       200
+#define OVERLOAD_STOP_LATENCY_MS        50
+
+// Only the first 2 octets (CHOICE index, procedure code) are looked at
+static const uint8_t overload_initial_ue_message[]      = {0x00, 0x0C, 0x40, 0x00};
+static const uint8_t overload_uplink_nas_transport[]    = {0x00, 0x0D, 0x40, 0x00};
+static const uint8_t overload_ue_ctxt_release_complete[] = {0x20, 0x17, 0x00, 0x00};
+static const uint8_t overload_s1_setup_request[]        = {0x00, 0x11, 0x00, 0x00};
+static const uint8_t overload_ue_ctxt_release_request[] = {0x00, 0x12, 0x40, 0x00};
+static const uint8_t overload_path_switch_request[]     = {0x00, 0x03, 0x00, 0x00};
+static const uint8_t overload_initial_ctxt_setup_resp[] = {0x20, 0x09, 0x00, 0x00};
+static const uint8_t overload_initial_ctxt_setup_fail[] = {0x40, 0x09, 0x00, 0x00};
+
+/*
+ * Driven through SCTP -> ITTI -> S1AP: the S1AP task spends
+ * OVERLOAD_ITTI_SERVICE_US on each PDU it handles, the storm offers several
+ * times what it can handle
+ */
+#define OVERLOAD_ITTI_MAX_PENDING            100
+#define OVERLOAD_ITTI_INITIAL_UE_MAX_PENDING 20
+#define OVERLOAD_ITTI_START_LATENCY_MS       5
+#define OVERLOAD_ITTI_STOP_LATENCY_MS        1
+#define OVERLOAD_ITTI_SERVICE_US             100
+#define OVERLOAD_ITTI_STORM_ROUNDS           1000
+#define OVERLOAD_ITTI_STORM_BURST            10
+#define OVERLOAD_ITTI_STORM_PERIOD_US        500
+#define OVERLOAD_ITTI_CALM_ROUNDS            100
+#define OVERLOAD_ITTI_CALM_PERIOD_US         2000
+
+typedef struct overload_queued_s {
+  bstring  pdu;
+  uint64_t enqueue_time_us;
+} overload_queued_t;
+
+//------------------------------------------------------------------------------
+static int overload_enqueue (overload_queued_t * const queue, int * const n, const uint8_t * const pdu, const int length)
+{
+  bstring b = blk2bstr (pdu, length);
+
+  if (s1ap_mme_overload_admit (b, &queue[*n].enqueue_time_us)) {
+    queue[(*n)++].pdu = b;
+    return 1;
+  }
+  bdestroy (b);
+  return 0;
+}
+
+typedef struct overload_s1ap_task_s {
+  volatile uint32_t dequeued;
+  volatile uint32_t handled[S1AP_OVERLOAD_CLASS_MAX];
+  volatile uint32_t discarded;
+  volatile uint32_t starts;
+  volatile uint32_t stops;
+} overload_s1ap_task_t;
+
+static overload_s1ap_task_t overload_s1ap_task = {0};
+
+//------------------------------------------------------------------------------
+static void overload_sleep_us (const uint32_t us)
+{
+  struct timespec ts = {.tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000};
+
+  nanosleep (&ts, NULL);
+}
+
+/*
+ * Same overload handling as s1ap_mme_thread(), the decoding and the handling
+ * of a PDU are replaced by a fixed service time
+ */
+//------------------------------------------------------------------------------
+static void *overload_s1ap_task_thread (__attribute__((unused)) void *args)
+{
+  itti_mark_task_ready (TASK_S1AP);
+
+  while (1) {
+    MessageDef                             *received_message_p = NULL;
+
+    itti_receive_msg (TASK_S1AP, &received_message_p);
+    if (SCTP_DATA_IND == ITTI_MSG_ID (received_message_p)) {
+      s1ap_overload_event_t                   event = S1AP_OVERLOAD_EVENT_NONE;
+      bool                                    process = s1ap_mme_overload_dequeued (SCTP_DATA_IND (received_message_p).payload,
+                                                                                    SCTP_DATA_IND (received_message_p).enqueue_time_us,
+                                                                                    s1ap_mme_overload_time_us (), &event);
+
+      overload_s1ap_task.starts += (S1AP_OVERLOAD_EVENT_START == event);
+      overload_s1ap_task.stops  += (S1AP_OVERLOAD_EVENT_STOP == event);
+      if (process) {
+        overload_s1ap_task.handled[s1ap_mme_overload_classify (SCTP_DATA_IND (received_message_p).payload)]++;
+        overload_sleep_us (OVERLOAD_ITTI_SERVICE_US);
+      } else {
+        overload_s1ap_task.discarded++;
+      }
+      bdestroy_wrapper (&SCTP_DATA_IND (received_message_p).payload);
+      __sync_fetch_and_add (&overload_s1ap_task.dequeued, 1);
+    }
+    itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void overload_sctp_ind (const uint8_t * const pdu, const int length, uint32_t * const sent)
+{
+  bstring b = blk2bstr (pdu, length);
+
+  sent[s1ap_mme_overload_classify (b)]++;
+  ck_assert_int_eq (sctp_itti_send_new_message_ind (&b, 1, 1, 2, 2), RETURNok);
+}
+
+// waits for the S1AP task to dequeue all the PDUs admitted by the SCTP side
+//------------------------------------------------------------------------------
+static void overload_wait_drained (void)
+{
+  s1ap_overload_stats_t    stats = {0};
+  uint64_t                 admitted;
+
+  for (int i = 0; i < 10000; i++) {
+    s1ap_mme_overload_get_stats (&stats);
+    admitted = stats.admitted[0] + stats.admitted[1] + stats.admitted[2];
+    if (admitted == overload_s1ap_task.dequeued) {
+      return;
+    }
+    overload_sleep_us (1000);
+  }
+  ck_abort_msg ("S1AP task did not drain its queue");
+}
+
+START_TEST(overload_classify_test)
+{
+  bstring b = blk2bstr (overload_initial_ue_message, sizeof (overload_initial_ue_message));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_INITIAL_UE);
+  bdestroy (b);
+  b = blk2bstr (overload_uplink_nas_transport, sizeof (overload_uplink_nas_transport));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_UE_ASSOCIATED);
+  bdestroy (b);
+  b = blk2bstr (overload_ue_ctxt_release_complete, sizeof (overload_ue_ctxt_release_complete));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+  b = blk2bstr (overload_s1_setup_request, 1);
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+  // only InitialUEMessage and UplinkNASTransport start new work
+  b = blk2bstr (overload_ue_ctxt_release_request, sizeof (overload_ue_ctxt_release_request));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+  b = blk2bstr (overload_path_switch_request, sizeof (overload_path_switch_request));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+  b = blk2bstr (overload_initial_ctxt_setup_resp, sizeof (overload_initial_ctxt_setup_resp));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+  b = blk2bstr (overload_initial_ctxt_setup_fail, sizeof (overload_initial_ctxt_setup_fail));
+  ck_assert_int_eq (s1ap_mme_overload_classify (b), S1AP_OVERLOAD_CLASS_ESSENTIAL);
+  bdestroy (b);
+}
+END_TEST
+
+START_TEST(overload_storm_test)
+{
+  static overload_queued_t queue[4 * OVERLOAD_MAX_PENDING];
+  int                      n = 0;
+  int                      admitted = 0;
+  int                      starts = 0;
+  int                      stops = 0;
+  int                      discarded = 0;
+  s1ap_overload_event_t    event = S1AP_OVERLOAD_EVENT_NONE;
+  s1ap_overload_stats_t    stats = {0};
+
+  s1ap_mme_overload_init (OVERLOAD_MAX_PENDING, OVERLOAD_INITIAL_UE_MAX_PENDING, OVERLOAD_START_LATENCY_MS, OVERLOAD_STOP_LATENCY_MS);
+
+  /*
+   * Attach storm: the S1AP task is stalled, InitialUEMessage are bounded first
+   */
+  for (int i = 0; i < OVERLOAD_MAX_PENDING; i++) {
+    admitted += overload_enqueue (queue, &n, overload_initial_ue_message, sizeof (overload_initial_ue_message));
+  }
+  ck_assert_int_eq (admitted, OVERLOAD_INITIAL_UE_MAX_PENDING);
+
+  // signalling of connected UEs still admitted up to the queue bound
+  admitted = 0;
+  for (int i = 0; i < OVERLOAD_MAX_PENDING; i++) {
+    admitted += overload_enqueue (queue, &n, overload_uplink_nas_transport, sizeof (overload_uplink_nas_transport));
+  }
+  ck_assert_int_eq (admitted, OVERLOAD_MAX_PENDING - OVERLOAD_INITIAL_UE_MAX_PENDING);
+
+  // responses and other procedures never shed
+  admitted = 0;
+  for (int i = 0; i < 5; i++) {
+    admitted += overload_enqueue (queue, &n, overload_ue_ctxt_release_complete, sizeof (overload_ue_ctxt_release_complete));
+    admitted += overload_enqueue (queue, &n, overload_initial_ctxt_setup_fail, sizeof (overload_initial_ctxt_setup_fail));
+    admitted += overload_enqueue (queue, &n, overload_ue_ctxt_release_request, sizeof (overload_ue_ctxt_release_request));
+  }
+  ck_assert_int_eq (admitted, 15);
+
+  s1ap_mme_overload_get_stats (&stats);
+  ck_assert_int_eq (stats.pending, OVERLOAD_MAX_PENDING + 15);
+  ck_assert_int_eq (stats.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE], OVERLOAD_MAX_PENDING - OVERLOAD_INITIAL_UE_MAX_PENDING);
+  ck_assert_int_eq (stats.shed[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED], OVERLOAD_INITIAL_UE_MAX_PENDING);
+
+  /*
+   * The S1AP task drains the queue, each PDU waited 500ms: overload starts once
+   */
+  for (int i = 0; i < n; i++) {
+    if (!s1ap_mme_overload_dequeued (queue[i].pdu, queue[i].enqueue_time_us, queue[i].enqueue_time_us + 500000, &event)) {
+      ck_assert_int_eq (s1ap_mme_overload_classify (queue[i].pdu), S1AP_OVERLOAD_CLASS_INITIAL_UE);
+      discarded += 1;
+    }
+    starts += (S1AP_OVERLOAD_EVENT_START == event);
+    stops  += (S1AP_OVERLOAD_EVENT_STOP == event);
+    bdestroy (queue[i].pdu);
+  }
+  ck_assert_int_eq (starts, 1);
+  ck_assert_int_eq (stops, 0);
+  ck_assert (discarded > 0);
+  ck_assert (s1ap_mme_overload_is_active ());
+
+  /*
+   * Load goes back to normal: overload stops once
+   */
+  for (int i = 0; i < 10; i++) {
+    n = 0;
+    ck_assert (overload_enqueue (queue, &n, overload_initial_ue_message, sizeof (overload_initial_ue_message)));
+    ck_assert (s1ap_mme_overload_dequeued (queue[0].pdu, queue[0].enqueue_time_us, queue[0].enqueue_time_us + 1000, &event));
+    stops += (S1AP_OVERLOAD_EVENT_STOP == event);
+    bdestroy (queue[0].pdu);
+  }
+  ck_assert_int_eq (stops, 1);
+  ck_assert (!s1ap_mme_overload_is_active ());
+  s1ap_mme_overload_get_stats (&stats);
+  ck_assert_int_eq (stats.pending, 0);
+}
+END_TEST
+
+/*
+ * Attach storm offered through the SCTP side to an S1AP task that cannot keep
+ * up: the MME goes into overload, sheds new work only and leaves overload once
+ * the storm is over
+ */
+START_TEST(overload_itti_test)
+{
+  uint32_t                 sent[S1AP_OVERLOAD_CLASS_MAX] = {0};
+  uint32_t                 handled_initial_ue = 0;
+  s1ap_overload_stats_t    stats = {0};
+  uint64_t                 start_us = 0;
+  uint64_t                 storm_us = 0;
+
+  ck_assert_int_eq (itti_init (TASK_MAX, THREAD_MAX, MESSAGES_ID_MAX, tasks_info, messages_info, NULL, NULL), RETURNok);
+  s1ap_mme_overload_init (OVERLOAD_ITTI_MAX_PENDING, OVERLOAD_ITTI_INITIAL_UE_MAX_PENDING,
+                          OVERLOAD_ITTI_START_LATENCY_MS, OVERLOAD_ITTI_STOP_LATENCY_MS);
+  sctp_itti_set_admission_control (s1ap_mme_overload_admit, s1ap_mme_overload_cancel);
+  ck_assert_int_eq (itti_create_task (TASK_S1AP, overload_s1ap_task_thread, NULL), RETURNok);
+  usleep (100000);
+
+  start_us = s1ap_mme_overload_time_us ();
+  for (int round = 0; round < OVERLOAD_ITTI_STORM_ROUNDS; round++) {
+    for (int i = 0; i < OVERLOAD_ITTI_STORM_BURST; i++) {
+      overload_sctp_ind (overload_initial_ue_message, sizeof (overload_initial_ue_message), sent);
+      overload_sctp_ind (overload_uplink_nas_transport, sizeof (overload_uplink_nas_transport), sent);
+    }
+    if (round & 1) {
+      overload_sctp_ind (overload_initial_ctxt_setup_resp, sizeof (overload_initial_ctxt_setup_resp), sent);
+    } else {
+      overload_sctp_ind (overload_initial_ctxt_setup_fail, sizeof (overload_initial_ctxt_setup_fail), sent);
+    }
+    overload_sleep_us (OVERLOAD_ITTI_STORM_PERIOD_US);
+  }
+  overload_wait_drained ();
+  storm_us = s1ap_mme_overload_time_us () - start_us;
+
+  s1ap_mme_overload_get_stats (&stats);
+  printf ("storm: %u PDUs offered in %u ms, %u InitialUEMessage, %u UplinkNASTransport, %u responses handled, "
+          "%u InitialUEMessage and %u UplinkNASTransport shed, %u discarded after queuing\n",
+          sent[0] + sent[1] + sent[2], (uint32_t)(storm_us / 1000),
+          overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_INITIAL_UE], overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED],
+          overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_ESSENTIAL], (uint32_t)stats.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE],
+          (uint32_t)stats.shed[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED], overload_s1ap_task.discarded);
+  ck_assert_int_eq (overload_s1ap_task.starts, 1);
+  ck_assert_int_eq (overload_s1ap_task.stops, 0);
+  ck_assert (s1ap_mme_overload_is_active ());
+  ck_assert (stats.shed[S1AP_OVERLOAD_CLASS_INITIAL_UE] > 0);
+  // responses are never shed
+  ck_assert_int_eq (stats.shed[S1AP_OVERLOAD_CLASS_ESSENTIAL], 0);
+  ck_assert_int_eq (overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_ESSENTIAL], sent[S1AP_OVERLOAD_CLASS_ESSENTIAL]);
+  // connected UEs go first
+  ck_assert (overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_UE_ASSOCIATED] > overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_INITIAL_UE]);
+
+  /*
+   * Storm over: everything is handled again and overload stops
+   */
+  handled_initial_ue = overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_INITIAL_UE];
+  for (int round = 0; round < OVERLOAD_ITTI_CALM_ROUNDS; round++) {
+    overload_sctp_ind (overload_initial_ue_message, sizeof (overload_initial_ue_message), sent);
+    overload_sleep_us (OVERLOAD_ITTI_CALM_PERIOD_US);
+  }
+  overload_wait_drained ();
+  ck_assert_int_eq (overload_s1ap_task.stops, 1);
+  ck_assert (!s1ap_mme_overload_is_active ());
+  ck_assert_int_eq (overload_s1ap_task.handled[S1AP_OVERLOAD_CLASS_INITIAL_UE] - handled_initial_ue, OVERLOAD_ITTI_CALM_ROUNDS);
+}
+END_TEST
+
+Suite * overload_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("S1AP overload control tests");
+
+    tc_core = tcase_create("S1AP overload control test");
+    tcase_add_test(tc_core, overload_classify_test);
+    tcase_add_test(tc_core, overload_storm_test);
+    tcase_add_test(tc_core, overload_itti_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = overload_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,153 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bstrlib.h"
+#include "s1ap_common.h"
+#include "s1ap_ies_defs.h"
+#include "s1ap_mme_encoder.h"
+#include "s1ap_mme_handlers.h"
+#include "s1ap_mme_template_encoder.h"
+
+static const uint32_t template_mme_ids[] = {0, 0x7F, 0xFF, 0x100, 0xFFFF, 0x10000, 0xFFFFFF, 0x1000000, 0x0110CECC, 0xFFFFFFFF};
+static const uint32_t template_enb_ids[] = {0, 0x1B3, 0xFFFF, 0x10000, 0xFFFFFF};
+static const int      template_nas_lengths[] = {0, 1, 9, 121, 122, 126, 127, 128, 1000, 4000};
+
+#define TEMPLATE_ARRAY_SIZE(aRrAy) (sizeof (aRrAy) / sizeof (aRrAy[0]))
+
+//------------------------------------------------------------------------------
+static bool template_equal_asn1c (const_bstring const template, s1ap_message * const message)
+{
+  uint8_t *buffer = NULL;
+  uint32_t length = 0;
+  bool     equal = false;
+
+  if (s1ap_mme_encode_pdu (message, &buffer, &length) < 0) {
+    return false;
+  }
+  equal = (template) && (blength (template) == length) && (memcmp (bdata (template), buffer, length) == 0);
+  free (buffer);
+  return equal;
+}
+
+START_TEST(template_downlink_nas_transport_test)
+{
+  for (int m = 0; m < TEMPLATE_ARRAY_SIZE (template_mme_ids); m++) {
+    for (int e = 0; e < TEMPLATE_ARRAY_SIZE (template_enb_ids); e++) {
+      for (int n = 0; n < TEMPLATE_ARRAY_SIZE (template_nas_lengths); n++) {
+        s1ap_message  message = {0};
+        S1ap_DownlinkNASTransportIEs_t *ies = &message.msg.s1ap_DownlinkNASTransportIEs;
+        bstring       nas = bfromcstralloc (template_nas_lengths[n], "");
+
+        for (int i = 0; i < template_nas_lengths[n]; i++) {
+          nas->data[i] = (uint8_t)(i * 7 + n);
+        }
+        nas->slen = template_nas_lengths[n];
+
+        bstring template = s1ap_mme_template_encode_downlink_nas_transport (template_mme_ids[m], template_enb_ids[e], S1ap_Criticality_reject, nas);
+
+        message.procedureCode = S1ap_ProcedureCode_id_downlinkNASTransport;
+        message.direction = S1AP_PDU_PR_initiatingMessage;
+        ies->mme_ue_s1ap_id = template_mme_ids[m];
+        ies->eNB_UE_S1AP_ID = template_enb_ids[e];
+        OCTET_STRING_fromBuf (&ies->nas_pdu, (char *)bdata (nas), blength (nas));
+
+        ck_assert_msg (template_equal_asn1c (template, &message), "DownlinkNASTransport mismatch mme id %u enb id %u nas length %d",
+                       template_mme_ids[m], template_enb_ids[e], template_nas_lengths[n]);
+        free_s1ap_downlinknastransport (ies);
+        bdestroy (template);
+        bdestroy (nas);
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(template_ue_context_release_command_test)
+{
+  const struct {
+    S1ap_Cause_PR type;
+    long          value;
+  } causes[] = {
+    {S1ap_Cause_PR_nas,          S1ap_CauseNas_detach},
+    {S1ap_Cause_PR_nas,          S1ap_CauseNas_unspecified},
+    {S1ap_Cause_PR_radioNetwork, S1ap_CauseRadioNetwork_unspecified},
+    {S1ap_Cause_PR_radioNetwork, S1ap_CauseRadioNetwork_release_due_to_eutran_generated_reason},
+    {S1ap_Cause_PR_radioNetwork, S1ap_CauseRadioNetwork_x2_handover_triggered},
+    {S1ap_Cause_PR_transport,    S1ap_CauseTransport_unspecified},
+    {S1ap_Cause_PR_protocol,     S1ap_CauseProtocol_unspecified},
+    {S1ap_Cause_PR_misc,         S1ap_CauseMisc_unknown_PLMN},
+  };
+
+  for (int m = 0; m < TEMPLATE_ARRAY_SIZE (template_mme_ids); m++) {
+    for (int e = 0; e < TEMPLATE_ARRAY_SIZE (template_enb_ids); e++) {
+      for (int c = 0; c < TEMPLATE_ARRAY_SIZE (causes); c++) {
+        s1ap_message  message = {0};
+        S1ap_UEContextReleaseCommandIEs_t *ies = &message.msg.s1ap_UEContextReleaseCommandIEs;
+        bstring       template = s1ap_mme_template_encode_ue_context_release_command (template_mme_ids[m], template_enb_ids[e],
+                                                                                        S1ap_Criticality_reject, causes[c].type, causes[c].value);
+
+        message.procedureCode = S1ap_ProcedureCode_id_UEContextRelease;
+        message.direction = S1AP_PDU_PR_initiatingMessage;
+        ies->uE_S1AP_IDs.present = S1ap_UE_S1AP_IDs_PR_uE_S1AP_ID_pair;
+        ies->uE_S1AP_IDs.choice.uE_S1AP_ID_pair.mME_UE_S1AP_ID = template_mme_ids[m];
+        ies->uE_S1AP_IDs.choice.uE_S1AP_ID_pair.eNB_UE_S1AP_ID = template_enb_ids[e];
+        s1ap_mme_set_cause (&ies->cause, causes[c].type, causes[c].value);
+
+        ck_assert_msg (template_equal_asn1c (template, &message), "UEContextReleaseCommand mismatch mme id %u enb id %u cause %d/%ld",
+                       template_mme_ids[m], template_enb_ids[e], causes[c].type, causes[c].value);
+        free_s1ap_uecontextreleasecommand (ies);
+        bdestroy (template);
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(template_fallback_test)
+{
+  // Extension values of the cause enumeration are left to asn1c
+  ck_assert (s1ap_mme_template_encode_ue_context_release_command (1, 1, S1ap_Criticality_reject,
+                                                                   S1ap_Cause_PR_radioNetwork, S1ap_CauseRadioNetwork_redirection_towards_1xRTT) == NULL);
+  ck_assert (s1ap_mme_template_encode_ue_context_release_command (1, 1, S1ap_Criticality_reject,
+                                                                   S1ap_Cause_PR_nas, S1ap_CauseNas_csg_subscription_expiry) == NULL);
+  // Fragmented length determinant is left to asn1c
+  bstring nas = bfromcstralloc (16384, "");
+  nas->slen = 16384;
+  ck_assert (s1ap_mme_template_encode_downlink_nas_transport (1, 1, S1ap_Criticality_reject, nas) == NULL);
+  bdestroy (nas);
+}
+END_TEST
+
+Suite * template_encoder_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("S1AP template encoder tests");
+
+    tc_core = tcase_create("S1AP template encoder test");
+    tcase_add_test(tc_core, template_downlink_nas_transport_test);
+    tcase_add_test(tc_core, template_ue_context_release_command_test);
+    tcase_add_test(tc_core, template_fallback_test);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = template_encoder_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
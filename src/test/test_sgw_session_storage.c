@@ -0,0 +1,566 @@
+#define _GNU_SOURCE
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "hashtable.h"
+#include "obj_hashtable.h"
+#include "common_defs.h"
+#include "intertask_interface_init.h"
+#include "itti_free_defined_msg.h"
+#include "sgw_ie_defs.h"
+#include "3gpp_23.401.h"
+#include "sgw_context_manager.h"
+#include "sgw.h"
+#include "spgw_config.h"
+#include "sgw_defs.h"
+#include "gtpv1u.h"
+
+#define STORAGE_EXPECTED_SESSIONS  1024
+#define STORAGE_SESSIONS           65536
+#define STORAGE_BENCH_SESSIONS     262144
+#define STORAGE_ITTI_SESSIONS      65536
+// sessions in flight, well below the ITTI queue size of the SPGW_APP tasks
+#define STORAGE_ITTI_WINDOW        64
+#define STORAGE_ITTI_EBI           5
+
+extern sgw_app_t                        sgw_app;
+extern spgw_config_t                    spgw_config;
+extern __pid_t                          g_pid;
+const struct gtp_tunnel_ops            *gtp_tunnel_ops;
+#if ENABLE_SDF_MARKING
+static bool                             netns_enabled = true;
+#endif
+
+//------------------------------------------------------------------------------
+static uint64_t storage_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static void storage_create_sessions (const teid_t first, const uint32_t nb_sessions)
+{
+  for (teid_t teid = first; teid < first + nb_sessions; teid++) {
+    s_plus_p_gw_eps_bearer_context_information_t *ctx = NULL;
+
+    ck_assert_ptr_ne (sgw_cm_create_s11_tunnel (teid + 0x10000000, teid), NULL);
+    ctx = sgw_cm_create_bearer_context_information_in_collection (teid);
+    ck_assert_ptr_ne (ctx, NULL);
+    ctx->sgw_eps_bearer_context_information.pdn_connection.apn_in_use = strdup ("oai.ipv4");
+    ctx->sgw_eps_bearer_context_information.pdn_connection.default_bearer = 5;
+    ck_assert_ptr_ne (sgw_cm_create_eps_bearer_ctxt_in_collection (&ctx->sgw_eps_bearer_context_information.pdn_connection, 5), NULL);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void storage_remove_sessions (const teid_t first, const uint32_t nb_sessions)
+{
+  for (teid_t teid = first; teid < first + nb_sessions; teid++) {
+    ck_assert_int_eq (sgw_cm_remove_bearer_context_information (teid), HASH_TABLE_OK);
+    ck_assert_int_eq (sgw_cm_remove_s11_tunnel (teid), HASH_TABLE_OK);
+  }
+}
+
+START_TEST(storage_grow_test)
+{
+  void     *ctx = NULL;
+  uint64_t  start_us = 0;
+  uint64_t  create_us = 0;
+
+  start_us = storage_time_us ();
+  storage_create_sessions (1, STORAGE_SESSIONS);
+  create_us = storage_time_us () - start_us;
+
+  // the tables grew past their configured size
+  ck_assert_int_eq (sgw_app.shards[0].s11_bearer_context_information_hashtable->num_elements, STORAGE_SESSIONS);
+  ck_assert_int_ge (sgw_app.shards[0].s11_bearer_context_information_hashtable->size, STORAGE_SESSIONS);
+  ck_assert_int_ge (sgw_app.shards[0].s11teid2mme_hashtable->size, STORAGE_SESSIONS);
+  for (teid_t teid = 1; teid <= STORAGE_SESSIONS; teid++) {
+    ck_assert_int_eq (hashtable_ts_get (sgw_app.shards[0].s11_bearer_context_information_hashtable, teid, &ctx), HASH_TABLE_OK);
+  }
+  printf ("%u sessions created in %u us\n", STORAGE_SESSIONS, (uint32_t)create_us);
+  sgw_cm_display_memory_usage ();
+
+  storage_remove_sessions (1, STORAGE_SESSIONS);
+  ck_assert_int_eq (sgw_app.shards[0].s11_bearer_context_information_hashtable->num_elements, 0);
+  ck_assert_int_eq (sgw_app.shards[0].s11teid2mme_hashtable->num_elements, 0);
+}
+END_TEST
+
+START_TEST(storage_reuse_test)
+{
+  s_plus_p_gw_eps_bearer_context_information_t *ctx = NULL;
+
+  storage_create_sessions (1, STORAGE_EXPECTED_SESSIONS);
+  storage_remove_sessions (1, STORAGE_EXPECTED_SESSIONS / 2);
+
+  // freed sessions are zeroed when handed out again
+  storage_create_sessions (STORAGE_EXPECTED_SESSIONS + 1, STORAGE_EXPECTED_SESSIONS / 2);
+  ck_assert_int_eq (hashtable_ts_get (sgw_app.shards[0].s11_bearer_context_information_hashtable, STORAGE_EXPECTED_SESSIONS + 1, (void **)&ctx), HASH_TABLE_OK);
+  ck_assert_int_eq (ctx->pgw_eps_bearer_context_information.num_apns, 0);
+  ck_assert_ptr_eq (ctx->sgw_eps_bearer_context_information.saved_message, NULL);
+  ck_assert_ptr_eq (sgw_cm_get_eps_bearer_entry (&ctx->sgw_eps_bearer_context_information.pdn_connection, 6), NULL);
+
+  ck_assert_int_eq (sgw_cm_remove_eps_bearer_entry (&ctx->sgw_eps_bearer_context_information.pdn_connection, 5), RETURNok);
+  ck_assert_ptr_eq (sgw_cm_get_eps_bearer_entry (&ctx->sgw_eps_bearer_context_information.pdn_connection, 5), NULL);
+  ck_assert_int_eq (sgw_cm_remove_eps_bearer_entry (&ctx->sgw_eps_bearer_context_information.pdn_connection, 5), RETURNerror);
+
+  storage_remove_sessions (STORAGE_EXPECTED_SESSIONS / 2 + 1, STORAGE_EXPECTED_SESSIONS);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void storage_init (const uint32_t nb_shards)
+{
+  ck_assert_int_eq (sgw_cm_init (STORAGE_EXPECTED_SESSIONS, nb_shards), RETURNok);
+  sgw_app.nb_shards = nb_shards;
+  for (uint32_t i = 0; i < nb_shards; i++) {
+    bstring b = bformat ("sgw_s11teid2mme_hashtable_%u", i);
+
+    sgw_app.shards[i].s11teid2mme_hashtable = hashtable_ts_create (STORAGE_EXPECTED_SESSIONS, NULL, (void (*)(void**))sgw_cm_free_s11_tunnel, b);
+    bassignformat (b, "sgw_s11_bearer_context_information_hashtable_%u", i);
+    sgw_app.shards[i].s11_bearer_context_information_hashtable = hashtable_ts_create (STORAGE_EXPECTED_SESSIONS, NULL,
+        (void (*)(void**))sgw_cm_free_s_plus_p_gw_eps_bearer_context_information, b);
+    bdestroy (b);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void storage_destroy (void)
+{
+  for (uint32_t i = 0; i < sgw_app.nb_shards; i++) {
+    hashtable_ts_destroy (sgw_app.shards[i].s11teid2mme_hashtable);
+    hashtable_ts_destroy (sgw_app.shards[i].s11_bearer_context_information_hashtable);
+    sgw_app.shards[i].s11teid2mme_hashtable = NULL;
+    sgw_app.shards[i].s11_bearer_context_information_hashtable = NULL;
+  }
+  sgw_cm_exit ();
+}
+
+//------------------------------------------------------------------------------
+static void storage_setup (void)
+{
+  storage_init (1);
+}
+
+//------------------------------------------------------------------------------
+static void storage_teardown (void)
+{
+  storage_destroy ();
+}
+
+/*
+ * One thread per shard creates then removes its share of the sessions with
+ * TEIDs from the pools, as the SPGW_APP shard tasks do. Returns the number of
+ * sessions that could not be created or removed.
+ */
+//------------------------------------------------------------------------------
+static void *storage_bench_thread (void *args)
+{
+  const uint32_t                          shard = (uint32_t)(uintptr_t)args;
+  const uint32_t                          nb_sessions = STORAGE_BENCH_SESSIONS / sgw_app.nb_shards;
+  teid_t                                 *teids = calloc (nb_sessions, sizeof (teid_t));
+  uintptr_t                               nb_errors = 0;
+
+  sgw_cm_set_shard (shard);
+  for (uint32_t i = 0; i < nb_sessions; i++) {
+    s_plus_p_gw_eps_bearer_context_information_t *ctx = NULL;
+
+    teids[i] = sgw_get_new_S11_tunnel_id ();
+    if ((sgw_cm_shard_of_teid (teids[i]) != shard) || (!sgw_cm_create_s11_tunnel (teids[i], teids[i]))
+        || (!(ctx = sgw_cm_create_bearer_context_information_in_collection (teids[i])))) {
+      nb_errors++;
+      continue;
+    }
+    ctx->sgw_eps_bearer_context_information.pdn_connection.default_bearer = 5;
+    if (!sgw_cm_create_eps_bearer_ctxt_in_collection (&ctx->sgw_eps_bearer_context_information.pdn_connection, 5)) {
+      nb_errors++;
+    }
+  }
+  for (uint32_t i = 0; i < nb_sessions; i++) {
+    if ((HASH_TABLE_OK != sgw_cm_remove_bearer_context_information (teids[i])) || (HASH_TABLE_OK != sgw_cm_remove_s11_tunnel (teids[i]))) {
+      nb_errors++;
+    }
+  }
+  free (teids);
+  return (void *)nb_errors;
+}
+
+START_TEST(storage_shards_bench_test)
+{
+  const uint32_t                          shard_counts[] = {1, 2, 4};
+
+  // the fixture set up one shard
+  storage_destroy ();
+  for (int c = 0; c < sizeof (shard_counts) / sizeof (shard_counts[0]); c++) {
+    pthread_t                             threads[SGW_SPGW_APP_SHARDS_MAX];
+    uint64_t                              start_us = 0;
+    uint64_t                              elapsed_us = 0;
+
+    storage_init (shard_counts[c]);
+    start_us = storage_time_us ();
+    for (uint32_t s = 0; s < shard_counts[c]; s++) {
+      ck_assert_int_eq (pthread_create (&threads[s], NULL, storage_bench_thread, (void *)(uintptr_t)s), 0);
+    }
+    for (uint32_t s = 0; s < shard_counts[c]; s++) {
+      void                               *nb_errors = NULL;
+
+      pthread_join (threads[s], &nb_errors);
+      ck_assert_int_eq ((uintptr_t)nb_errors, 0);
+    }
+    elapsed_us = storage_time_us () - start_us;
+    printf ("%u shards: %u sessions created and removed in %u us, %u sessions/s\n", shard_counts[c], STORAGE_BENCH_SESSIONS,
+        (uint32_t)elapsed_us, (uint32_t)((uint64_t)STORAGE_BENCH_SESSIONS * 1000000 / ((elapsed_us) ? elapsed_us : 1)));
+    for (uint32_t s = 0; s < shard_counts[c]; s++) {
+      ck_assert_int_eq (sgw_app.shards[s].s11_bearer_context_information_hashtable->num_elements, 0);
+    }
+    storage_destroy ();
+  }
+  storage_init (1);
+}
+END_TEST
+
+/*
+ * Tunnel operations standing in for the gtp kernel module, which unit tests
+ * cannot load: as with libgtpnl, each shard thread numbers its own changes,
+ * sends them on flush and gets them acknowledged on its own fd.
+ */
+static __thread struct {
+  int                                     ack_fd;
+  uint32_t                                seq;
+  uint32_t                                sent_seq;
+} storage_gtp = {.ack_fd = -1};
+// changes of all the shards, for the report
+static uint32_t                         storage_gtp_nb_changes = 0;
+
+//------------------------------------------------------------------------------
+static int storage_gtp_get_ack_fd (void)
+{
+  if (0 > storage_gtp.ack_fd) {
+    storage_gtp.ack_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 > storage_gtp.ack_fd) {
+      perror ("eventfd");
+    }
+  }
+  return storage_gtp.ack_fd;
+}
+
+//------------------------------------------------------------------------------
+static int storage_gtp_queue_change (void)
+{
+  storage_gtp.seq += 1;
+  __sync_add_and_fetch (&storage_gtp_nb_changes, 1);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+static int storage_gtp_add_tunnel (struct in_addr ue, struct in_addr enb, uint32_t i_tei, uint32_t o_tei)
+{
+  return storage_gtp_queue_change ();
+}
+
+//------------------------------------------------------------------------------
+static int storage_gtp_del_tunnel (uint32_t i_tei, uint32_t o_tei)
+{
+  return storage_gtp_queue_change ();
+}
+
+//------------------------------------------------------------------------------
+static uint32_t storage_gtp_last_seq (void)
+{
+  return storage_gtp.seq;
+}
+
+//------------------------------------------------------------------------------
+static int storage_gtp_flush (void)
+{
+  const uint64_t                          ack = 1;
+
+  if (storage_gtp.sent_seq != storage_gtp.seq) {
+    storage_gtp.sent_seq = storage_gtp.seq;
+    if (sizeof (ack) != write (storage_gtp_get_ack_fd (), &ack, sizeof (ack))) {
+      perror ("write");
+    }
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+static int storage_gtp_process_acks (uint32_t *acked_seq)
+{
+  uint64_t                                nb_acks = 0;
+
+  if ((0 > read (storage_gtp_get_ack_fd (), &nb_acks, sizeof (nb_acks))) && (EAGAIN != errno)) {
+    perror ("read");
+  }
+  *acked_seq = storage_gtp.sent_seq;
+  return (int)nb_acks;
+}
+
+static const struct gtp_tunnel_ops storage_gtp_ops = {
+  .add_tunnel   = storage_gtp_add_tunnel,
+  .del_tunnel   = storage_gtp_del_tunnel,
+  .last_seq     = storage_gtp_last_seq,
+  .flush        = storage_gtp_flush,
+  .get_ack_fd   = storage_gtp_get_ack_fd,
+  .process_acks = storage_gtp_process_acks,
+};
+
+// replaces the GTPV1U task, called by sgw_init()
+//------------------------------------------------------------------------------
+int gtpv1u_init (spgw_config_t *spgw_config)
+{
+  gtp_tunnel_ops = &storage_gtp_ops;
+  return RETURNok;
+}
+
+/*
+ * The S11 side of the bench: keeps STORAGE_ITTI_WINDOW sessions in flight,
+ * each one is created, modified with the eNB F-TEID then deleted. The MME
+ * S11 TEID of a session is its number, starting at 1.
+ */
+static struct {
+  pthread_mutex_t                         lock;
+  pthread_cond_t                          done;
+  uint32_t                                nb_started;
+  uint32_t                                nb_completed;
+  uint32_t                                nb_errors;
+  uint64_t                                start_us;
+  uint64_t                                elapsed_us;
+  teid_t                                  sgw_teid[STORAGE_ITTI_SESSIONS + 1];
+} storage_itti = {.lock = PTHREAD_MUTEX_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+
+//------------------------------------------------------------------------------
+static void storage_itti_create_session (void)
+{
+  const teid_t                            mme_teid = ++storage_itti.nb_started;
+  MessageDef                             *message_p = itti_alloc_new_message (TASK_S11, S11_CREATE_SESSION_REQUEST);
+  itti_s11_create_session_request_t      *req_p = &message_p->ittiMsg.s11_create_session_request;
+
+  req_p->sender_fteid_for_cp.teid = mme_teid;
+  req_p->sender_fteid_for_cp.interface_type = S11_MME_GTP_C;
+  req_p->sender_fteid_for_cp.ipv4 = 1;
+  req_p->sender_fteid_for_cp.ipv4_address.s_addr = htonl (INADDR_LOOPBACK);
+  req_p->rat_type = RAT_EUTRAN;
+  strcpy (req_p->apn, "oai.ipv4");
+  req_p->pdn_type = IPv4;
+  req_p->bearer_contexts_to_be_created.bearer_contexts[0].eps_bearer_id = STORAGE_ITTI_EBI;
+  req_p->bearer_contexts_to_be_created.bearer_contexts[0].bearer_level_qos.qci = 9;
+  req_p->bearer_contexts_to_be_created.num_bearer_context = 1;
+  req_p->trxn = (void *)(uintptr_t)mme_teid;
+  req_p->peer_ip.s_addr = htonl (INADDR_LOOPBACK);
+  // as S11 does, straight to the shard owning the session
+  itti_send_msg_to_task (sgw_app_task_of_s11_teid (0, mme_teid), INSTANCE_DEFAULT, message_p);
+}
+
+//------------------------------------------------------------------------------
+static void storage_itti_modify_bearer (const teid_t mme_teid)
+{
+  MessageDef                             *message_p = itti_alloc_new_message (TASK_S11, S11_MODIFY_BEARER_REQUEST);
+  itti_s11_modify_bearer_request_t       *req_p = &message_p->ittiMsg.s11_modify_bearer_request;
+
+  req_p->teid = storage_itti.sgw_teid[mme_teid];
+  req_p->bearer_contexts_to_be_modified.bearer_contexts[0].eps_bearer_id = STORAGE_ITTI_EBI;
+  req_p->bearer_contexts_to_be_modified.bearer_contexts[0].s1_eNB_fteid.teid = mme_teid;
+  req_p->bearer_contexts_to_be_modified.bearer_contexts[0].s1_eNB_fteid.interface_type = S1_U_ENODEB_GTP_U;
+  req_p->bearer_contexts_to_be_modified.bearer_contexts[0].s1_eNB_fteid.ipv4 = 1;
+  req_p->bearer_contexts_to_be_modified.bearer_contexts[0].s1_eNB_fteid.ipv4_address.s_addr = htonl (INADDR_LOOPBACK);
+  req_p->bearer_contexts_to_be_modified.num_bearer_context = 1;
+  req_p->trxn = (void *)(uintptr_t)mme_teid;
+  req_p->peer_ip.s_addr = htonl (INADDR_LOOPBACK);
+  itti_send_msg_to_task (sgw_app_task_of_s11_teid (req_p->teid, mme_teid), INSTANCE_DEFAULT, message_p);
+}
+
+//------------------------------------------------------------------------------
+static void storage_itti_delete_session (const teid_t mme_teid)
+{
+  MessageDef                             *message_p = itti_alloc_new_message (TASK_S11, S11_DELETE_SESSION_REQUEST);
+  itti_s11_delete_session_request_t      *req_p = &message_p->ittiMsg.s11_delete_session_request;
+
+  req_p->teid = storage_itti.sgw_teid[mme_teid];
+  req_p->lbi = STORAGE_ITTI_EBI;
+  req_p->trxn = (void *)(uintptr_t)mme_teid;
+  req_p->peer_ip.s_addr = htonl (INADDR_LOOPBACK);
+  itti_send_msg_to_task (sgw_app_task_of_s11_teid (req_p->teid, mme_teid), INSTANCE_DEFAULT, message_p);
+}
+
+//------------------------------------------------------------------------------
+static void storage_itti_session_completed (const bool success)
+{
+  storage_itti.nb_errors += (success) ? 0 : 1;
+  if (storage_itti.nb_started < STORAGE_ITTI_SESSIONS) {
+    storage_itti_create_session ();
+  }
+  if (++storage_itti.nb_completed == STORAGE_ITTI_SESSIONS) {
+    pthread_mutex_lock (&storage_itti.lock);
+    storage_itti.elapsed_us = storage_time_us () - storage_itti.start_us;
+    pthread_cond_signal (&storage_itti.done);
+    pthread_mutex_unlock (&storage_itti.lock);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void *storage_itti_s11_task (void *args_p)
+{
+  itti_mark_task_ready (TASK_S11);
+  storage_itti.start_us = storage_time_us ();
+  for (uint32_t i = 0; i < STORAGE_ITTI_WINDOW; i++) {
+    storage_itti_create_session ();
+  }
+
+  while (1) {
+    MessageDef                           *received_message_p = NULL;
+
+    itti_receive_msg (TASK_S11, &received_message_p);
+    switch (ITTI_MSG_ID (received_message_p)) {
+    case S11_CREATE_SESSION_RESPONSE:{
+        const itti_s11_create_session_response_t *rsp_p = &received_message_p->ittiMsg.s11_create_session_response;
+
+        if (REQUEST_ACCEPTED == rsp_p->cause.cause_value) {
+          storage_itti.sgw_teid[rsp_p->teid] = rsp_p->s11_sgw_fteid.teid;
+          storage_itti_modify_bearer (rsp_p->teid);
+        } else {
+          storage_itti_session_completed (false);
+        }
+      }
+      break;
+
+    case S11_MODIFY_BEARER_RESPONSE:{
+        const itti_s11_modify_bearer_response_t *rsp_p = &received_message_p->ittiMsg.s11_modify_bearer_response;
+
+        storage_itti.nb_errors += (REQUEST_ACCEPTED == rsp_p->cause.cause_value) ? 0 : 1;
+        storage_itti_delete_session ((teid_t)(uintptr_t)rsp_p->trxn);
+      }
+      break;
+
+    case S11_DELETE_SESSION_RESPONSE:{
+        storage_itti_session_completed (REQUEST_ACCEPTED == received_message_p->ittiMsg.s11_delete_session_response.cause.cause_value);
+      }
+      break;
+
+    default:
+      break;
+    }
+    itti_free_msg_content (received_message_p);
+    itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
+  }
+  return NULL;
+}
+
+/*
+ * Sessions set up and torn down through the SPGW_APP tasks, from the S11
+ * requests to the S11 responses: routing to the owning shard, per shard tunnel
+ * batches and their acknowledgements, nf_tables transactions when built with SDF marking. The
+ * tasks cannot be stopped, each shard count runs in its own test process.
+ */
+START_TEST(storage_itti_bench_test)
+{
+  const uint32_t                          shard_counts[] = {1, 2, 4};
+  struct timespec                         timeout = {0};
+  bstring                                 filename = NULL;
+
+#if ENABLE_SDF_MARKING
+  if (!netns_enabled) {
+    return;
+  }
+#endif
+  g_pid = getpid ();
+  ck_assert_int_eq (itti_init (TASK_MAX, THREAD_MAX, MESSAGES_ID_MAX, tasks_info, messages_info, NULL, NULL), RETURNok);
+  spgw_config.sgw_config.spgw_app_shards = shard_counts[_i];
+  spgw_config.sgw_config.expected_sessions = STORAGE_EXPECTED_SESSIONS;
+  spgw_config.sgw_config.ipv4.S11.s_addr = htonl (INADDR_LOOPBACK);
+  spgw_config.sgw_config.ipv4.S1u_S12_S4_up.s_addr = htonl (INADDR_LOOPBACK);
+  inet_pton (AF_INET, "10.0.0.0", &spgw_config.pgw_config.ue_pool_addr[0]);
+  spgw_config.pgw_config.ue_pool_mask[0] = 16;
+  spgw_config.pgw_config.num_ue_pool = 1;
+  spgw_config.pgw_config.use_gtp_kernel_module = true;
+  ck_assert_int_eq (sgw_init (&spgw_config), RETURNok);
+  // the shards must be ready before they get requests
+  usleep (200000);
+
+  pthread_mutex_lock (&storage_itti.lock);
+  ck_assert_int_eq (itti_create_task (TASK_S11, storage_itti_s11_task, NULL), RETURNok);
+  clock_gettime (CLOCK_REALTIME, &timeout);
+  timeout.tv_sec += 30;
+  while ((storage_itti.nb_completed < STORAGE_ITTI_SESSIONS) &&
+         (0 == pthread_cond_timedwait (&storage_itti.done, &storage_itti.lock, &timeout)));
+  pthread_mutex_unlock (&storage_itti.lock);
+  ck_assert_int_eq (storage_itti.nb_completed, STORAGE_ITTI_SESSIONS);
+  ck_assert_int_eq (storage_itti.nb_errors, 0);
+  printf ("%u shards: %u sessions set up and torn down through ITTI in %u us, %u sessions/s, %u tunnel changes\n", shard_counts[_i],
+      STORAGE_ITTI_SESSIONS, (uint32_t)storage_itti.elapsed_us,
+      (uint32_t)((uint64_t)STORAGE_ITTI_SESSIONS * 1000000 / ((storage_itti.elapsed_us) ? storage_itti.elapsed_us : 1)),
+      storage_gtp_nb_changes);
+  for (uint32_t s = 0; s < shard_counts[_i]; s++) {
+    ck_assert_int_eq (sgw_app.shards[s].s11_bearer_context_information_hashtable->num_elements, 0);
+  }
+
+  filename = bformat ("/tmp/spgw_%d.status", g_pid);
+  unlink (bdata (filename));
+  bdestroy (filename);
+}
+END_TEST
+
+Suite * storage_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+    TCase *tc_itti;
+
+    s = suite_create("S-GW session storage tests");
+
+    tc_core = tcase_create("S-GW session storage test");
+    tcase_add_checked_fixture(tc_core, storage_setup, storage_teardown);
+    tcase_add_test(tc_core, storage_grow_test);
+    tcase_add_test(tc_core, storage_reuse_test);
+    tcase_add_test(tc_core, storage_shards_bench_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+
+    tc_itti = tcase_create("S-GW session setup bench");
+    tcase_add_loop_test(tc_itti, storage_itti_bench_test, 0, 3);
+    tcase_set_timeout(tc_itti, 60);
+
+    suite_add_tcase(s, tc_itti);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+#if ENABLE_SDF_MARKING
+    // The marking of the bench runs in its own network namespace, needs CAP_SYS_ADMIN
+    netns_enabled = (0 == unshare (CLONE_NEWNET));
+    if (!netns_enabled) {
+      printf ("Cannot create a network namespace, session setup bench skipped\n");
+    }
+#endif
+    s = storage_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
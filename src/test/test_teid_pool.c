@@ -0,0 +1,180 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "common_defs.h"
+#include "teid_pool.h"
+
+#define POOL_ACTIVE_TEIDS   1000000
+#define POOL_SHARDS         4
+#define POOL_SHARD_TEIDS    100000
+#define POOL_SHARD_CHURN    1000000
+
+typedef struct pool_worker_s {
+  teid_pool_t *pool;
+  uint32_t     shard;
+  uint32_t    *teids;
+  bool         ok;
+} pool_worker_t;
+
+//------------------------------------------------------------------------------
+static int pool_cmp_teid (const void *a, const void *b)
+{
+  const uint32_t x = *(const uint32_t *)a;
+  const uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+//------------------------------------------------------------------------------
+static bool pool_all_unique (uint32_t * const teids, const uint32_t nb_teids)
+{
+  qsort (teids, nb_teids, sizeof (uint32_t), pool_cmp_teid);
+  for (uint32_t i = 1; i < nb_teids; i++) {
+    if (teids[i] == teids[i - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+START_TEST(pool_million_test)
+{
+  teid_pool_t  pool;
+  uint32_t    *teids = calloc (POOL_ACTIVE_TEIDS, sizeof (uint32_t));
+
+  ck_assert_int_eq (teid_pool_init (&pool, "million", TEID_POOL_INDEX_BITS_DEFAULT, 1), RETURNok);
+  for (int round = 0; round < 2; round++) {
+    for (uint32_t i = 0; i < POOL_ACTIVE_TEIDS; i++) {
+      teids[i] = teid_pool_alloc (&pool, 0);
+      ck_assert_int_ne (teids[i], 0);
+    }
+    ck_assert_int_eq (teid_pool_nb_used (&pool), POOL_ACTIVE_TEIDS);
+    ck_assert (pool_all_unique (teids, POOL_ACTIVE_TEIDS));
+    // the second round reuses all the indexes with the next generation
+    for (uint32_t i = 0; i < POOL_ACTIVE_TEIDS; i++) {
+      ck_assert (teid_pool_is_allocated (&pool, teids[i]));
+      ck_assert_int_eq (teid_pool_free (&pool, teids[i]), RETURNok);
+    }
+    ck_assert_int_eq (teid_pool_nb_used (&pool), 0);
+  }
+  teid_pool_destroy (&pool);
+  free (teids);
+}
+END_TEST
+
+START_TEST(pool_recycle_test)
+{
+  teid_pool_t  pool = {0};
+  uint32_t     teids[255];
+  uint32_t     teid = 0;
+
+  ck_assert_int_eq (teid_pool_free (&pool, 1), RETURNerror);
+  ck_assert_int_eq (teid_pool_init (&pool, "small", 8, 1), RETURNok);
+  for (int i = 0; i < 255; i++) {
+    teids[i] = teid_pool_alloc (&pool, 0);
+    ck_assert_int_ne (teids[i], 0);
+  }
+  ck_assert_int_eq (teid_pool_alloc (&pool, 0), 0);
+
+  // freed indexes come back oldest first, with a new generation
+  ck_assert_int_eq (teid_pool_free (&pool, teids[10]), RETURNok);
+  ck_assert_int_eq (teid_pool_free (&pool, teids[3]), RETURNok);
+  ck_assert_int_eq (teid_pool_free (&pool, teids[10]), RETURNerror);
+  teid = teid_pool_alloc (&pool, 0);
+  ck_assert_int_eq (teid & 0xff, teids[10] & 0xff);
+  ck_assert_int_ne (teid, teids[10]);
+  ck_assert (!teid_pool_is_allocated (&pool, teids[10]));
+  ck_assert (teid_pool_is_allocated (&pool, teid));
+
+  // a stale TEID does not release the index it shares with a live one
+  ck_assert_int_eq (teid_pool_free (&pool, teids[10]), RETURNerror);
+  ck_assert (teid_pool_is_allocated (&pool, teid));
+  ck_assert_int_eq (teid_pool_alloc (&pool, 0) & 0xff, teids[3] & 0xff);
+  ck_assert_int_eq (teid_pool_alloc (&pool, 0), 0);
+  ck_assert_int_eq (teid_pool_free (&pool, 0), RETURNerror);
+  teid_pool_destroy (&pool);
+}
+END_TEST
+
+//------------------------------------------------------------------------------
+static void *pool_worker (void *arg)
+{
+  pool_worker_t *worker = (pool_worker_t *)arg;
+
+  worker->ok = true;
+  for (uint32_t i = 0; i < POOL_SHARD_TEIDS; i++) {
+    worker->teids[i] = teid_pool_alloc (worker->pool, worker->shard);
+  }
+  for (uint32_t i = 0; i < POOL_SHARD_CHURN; i++) {
+    uint32_t *teid = &worker->teids[i % POOL_SHARD_TEIDS];
+
+    if ((0 == *teid) || (teid_pool_shard_of (worker->pool, *teid) != worker->shard) ||
+        (RETURNok != teid_pool_free (worker->pool, *teid))) {
+      worker->ok = false;
+    }
+    *teid = teid_pool_alloc (worker->pool, worker->shard);
+  }
+  return NULL;
+}
+
+START_TEST(pool_shards_test)
+{
+  teid_pool_t    pool;
+  pool_worker_t  workers[POOL_SHARDS];
+  pthread_t      threads[POOL_SHARDS];
+  uint32_t      *teids = calloc (POOL_SHARDS * POOL_SHARD_TEIDS, sizeof (uint32_t));
+
+  ck_assert_int_eq (teid_pool_init (&pool, "shards", TEID_POOL_INDEX_BITS_DEFAULT, POOL_SHARDS), RETURNok);
+  for (int i = 0; i < POOL_SHARDS; i++) {
+    workers[i].pool = &pool;
+    workers[i].shard = i;
+    workers[i].teids = &teids[i * POOL_SHARD_TEIDS];
+    ck_assert_int_eq (pthread_create (&threads[i], NULL, pool_worker, &workers[i]), 0);
+  }
+  for (int i = 0; i < POOL_SHARDS; i++) {
+    pthread_join (threads[i], NULL);
+    ck_assert (workers[i].ok);
+  }
+  ck_assert_int_eq (teid_pool_nb_used (&pool), POOL_SHARDS * POOL_SHARD_TEIDS);
+  ck_assert (pool_all_unique (teids, POOL_SHARDS * POOL_SHARD_TEIDS));
+  teid_pool_destroy (&pool);
+  free (teids);
+}
+END_TEST
+
+Suite * pool_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("TEID pool tests");
+
+    tc_core = tcase_create("TEID pool test");
+    tcase_add_test(tc_core, pool_million_test);
+    tcase_add_test(tc_core, pool_recycle_test);
+    tcase_add_test(tc_core, pool_shards_test);
+    tcase_set_timeout(tc_core, 30);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = pool_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,260 @@
+#define _GNU_SOURCE             // required for recvmmsg()
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bstrlib.h"
+#include "common_defs.h"
+#include "intertask_interface_init.h"
+#include "itti_free_defined_msg.h"
+#include "udp_primitives_server.h"
+
+/*
+ * S11 messages/s through the UDP task, as the S11 task sees them: UDP_DATA_IND
+ * received from a peer, UDP_DATA_REQ sent to it. The peer keeps at most
+ * UDP_BENCH_WINDOW messages in flight, as a GTPv2-C peer waiting for its
+ * responses, so that neither the sockets nor the ITTI queues overflow.
+ */
+#define UDP_BENCH_LOCAL_PORT     32123
+#define UDP_BENCH_PEER_PORT      32124
+#define UDP_BENCH_MSG_SIZE       200    // Create Session Request sized
+#define UDP_BENCH_MESSAGES       200000
+#define UDP_BENCH_WINDOW         128
+#define UDP_BENCH_TIMEOUT_S      20
+
+typedef struct udp_bench_s {
+  struct sockaddr_in local;
+  struct sockaddr_in peer;
+  // received by the fake S11 task
+  volatile uint32_t  nb_ind;
+  volatile uint32_t  nb_ind_errors;
+  // received by the peer
+  volatile uint32_t  nb_peer;
+  volatile uint32_t  nb_peer_errors;
+  int                peer_sd;
+  uint8_t            req_buffers[UDP_BENCH_WINDOW][UDP_BENCH_MSG_SIZE];
+} udp_bench_t;
+
+static udp_bench_t udp_bench = {0};
+
+//------------------------------------------------------------------------------
+static uint64_t udp_bench_time_us (void)
+{
+  struct timespec ts = {0};
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//------------------------------------------------------------------------------
+static void udp_bench_fill (uint8_t * const buffer, const uint32_t seq)
+{
+  memset (buffer, (uint8_t)seq, UDP_BENCH_MSG_SIZE);
+  memcpy (buffer, &seq, sizeof (seq));
+}
+
+//------------------------------------------------------------------------------
+static bool udp_bench_check (const uint8_t * const buffer, const uint32_t length, const uint32_t seq)
+{
+  uint8_t expected[UDP_BENCH_MSG_SIZE];
+
+  udp_bench_fill (expected, seq);
+  return (UDP_BENCH_MSG_SIZE == length) && (0 == memcmp (buffer, expected, UDP_BENCH_MSG_SIZE));
+}
+
+// waits for the consumer counter to come within window of the number produced
+//------------------------------------------------------------------------------
+static bool udp_bench_wait (volatile uint32_t * const consumed, const uint32_t produced, const uint32_t window, const uint64_t deadline_us)
+{
+  while (produced - *consumed > window) {
+    if (udp_bench_time_us () > deadline_us) {
+      return false;
+    }
+    sched_yield ();
+  }
+  return true;
+}
+
+/*
+ * Replaces the S11 task: owns the UDP endpoint, checks and releases the
+ * UDP_DATA_IND as s11_mme_task does
+ */
+//------------------------------------------------------------------------------
+static void *udp_bench_s11_task (__attribute__((unused)) void *args_p)
+{
+  itti_mark_task_ready (TASK_S11);
+
+  while (1) {
+    MessageDef                             *received_message_p = NULL;
+
+    itti_receive_msg (TASK_S11, &received_message_p);
+    if (UDP_DATA_IND == ITTI_MSG_ID (received_message_p)) {
+      udp_data_ind_t                         *ind_p = &received_message_p->ittiMsg.udp_data_ind;
+
+      if ((!udp_bench_check (ind_p->buffer, ind_p->buffer_length, udp_bench.nb_ind)) ||
+          (ind_p->peer_port != UDP_BENCH_PEER_PORT)) {
+        udp_bench.nb_ind_errors++;
+      }
+      __sync_fetch_and_add (&udp_bench.nb_ind, 1);
+    }
+    itti_free_msg_content (received_message_p);
+    itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void *udp_bench_peer_receiver (__attribute__((unused)) void *args_p)
+{
+  struct mmsghdr                          msgs[UDP_BENCH_WINDOW];
+  struct iovec                            iovecs[UDP_BENCH_WINDOW];
+  static uint8_t                          buffers[UDP_BENCH_WINDOW][2 * UDP_BENCH_MSG_SIZE];
+
+  for (int i = 0; i < UDP_BENCH_WINDOW; i++) {
+    iovecs[i].iov_base = buffers[i];
+    iovecs[i].iov_len = sizeof (buffers[i]);
+    memset (&msgs[i], 0, sizeof (msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  while (1) {
+    int nb_msgs = recvmmsg (udp_bench.peer_sd, msgs, UDP_BENCH_WINDOW, MSG_WAITFORONE, NULL);
+
+    if (nb_msgs <= 0) {
+      break;
+    }
+    for (int i = 0; i < nb_msgs; i++) {
+      if (!udp_bench_check (buffers[i], msgs[i].msg_len, udp_bench.nb_peer)) {
+        udp_bench.nb_peer_errors++;
+      }
+      __sync_fetch_and_add (&udp_bench.nb_peer, 1);
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void udp_bench_setup (void)
+{
+  int                 rcvbuf = 8 << 20;
+  MessageDef         *message_p = NULL;
+  pthread_t           receiver;
+
+  ck_assert_int_eq (itti_init (TASK_MAX, THREAD_MAX, MESSAGES_ID_MAX, tasks_info, messages_info, NULL, NULL), RETURNok);
+  ck_assert_int_eq (udp_init (), 0);
+  ck_assert_int_eq (itti_create_task (TASK_S11, udp_bench_s11_task, NULL), RETURNok);
+  usleep (100000);
+
+  udp_bench.local.sin_family = AF_INET;
+  udp_bench.local.sin_port = htons (UDP_BENCH_LOCAL_PORT);
+  udp_bench.local.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  udp_bench.peer = udp_bench.local;
+  udp_bench.peer.sin_port = htons (UDP_BENCH_PEER_PORT);
+
+  message_p = itti_alloc_new_message (TASK_S11, UDP_INIT);
+  UDP_INIT (message_p).port = UDP_BENCH_LOCAL_PORT;
+  UDP_INIT (message_p).address = udp_bench.local.sin_addr;
+  ck_assert_int_eq (itti_send_msg_to_task (TASK_UDP, INSTANCE_DEFAULT, message_p), RETURNok);
+
+  udp_bench.peer_sd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  ck_assert_int_ge (udp_bench.peer_sd, 0);
+  setsockopt (udp_bench.peer_sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+  ck_assert_int_eq (bind (udp_bench.peer_sd, (struct sockaddr *)&udp_bench.peer, sizeof (udp_bench.peer)), 0);
+  ck_assert_int_eq (pthread_create (&receiver, NULL, udp_bench_peer_receiver, NULL), 0);
+  usleep (100000);
+}
+
+/*
+ * Peer -> UDP task -> S11 task, then S11 task -> UDP task -> peer
+ */
+START_TEST(udp_server_bench_test)
+{
+  uint64_t            start_us = 0;
+  uint64_t            rx_us = 0;
+  uint64_t            tx_us = 0;
+  uint64_t            deadline_us = 0;
+  uint8_t             buffer[UDP_BENCH_MSG_SIZE];
+
+  udp_bench_setup ();
+
+  deadline_us = udp_bench_time_us () + UDP_BENCH_TIMEOUT_S * 1000000;
+  start_us = udp_bench_time_us ();
+  for (uint32_t seq = 0; seq < UDP_BENCH_MESSAGES; seq++) {
+    ck_assert (udp_bench_wait (&udp_bench.nb_ind, seq, UDP_BENCH_WINDOW - 1, deadline_us));
+    udp_bench_fill (buffer, seq);
+    ck_assert_int_eq (sendto (udp_bench.peer_sd, buffer, sizeof (buffer), 0, (struct sockaddr *)&udp_bench.local, sizeof (udp_bench.local)),
+                      sizeof (buffer));
+  }
+  ck_assert (udp_bench_wait (&udp_bench.nb_ind, UDP_BENCH_MESSAGES, 0, deadline_us));
+  rx_us = udp_bench_time_us () - start_us;
+  ck_assert_int_eq (udp_bench.nb_ind_errors, 0);
+
+  start_us = udp_bench_time_us ();
+  for (uint32_t seq = 0; seq < UDP_BENCH_MESSAGES; seq++) {
+    MessageDef                             *message_p = NULL;
+
+    // the buffer of a request is reused once the peer got it
+    ck_assert (udp_bench_wait (&udp_bench.nb_peer, seq, UDP_BENCH_WINDOW - 1, deadline_us));
+    udp_bench_fill (udp_bench.req_buffers[seq % UDP_BENCH_WINDOW], seq);
+    message_p = itti_alloc_new_message (TASK_S11, UDP_DATA_REQ);
+    message_p->ittiMsg.udp_data_req.buffer = udp_bench.req_buffers[seq % UDP_BENCH_WINDOW];
+    message_p->ittiMsg.udp_data_req.buffer_length = UDP_BENCH_MSG_SIZE;
+    message_p->ittiMsg.udp_data_req.buffer_offset = 0;
+    message_p->ittiMsg.udp_data_req.peer_address = udp_bench.peer.sin_addr;
+    message_p->ittiMsg.udp_data_req.peer_port = UDP_BENCH_PEER_PORT;
+    ck_assert_int_eq (itti_send_msg_to_task (TASK_UDP, INSTANCE_DEFAULT, message_p), RETURNok);
+  }
+  ck_assert (udp_bench_wait (&udp_bench.nb_peer, UDP_BENCH_MESSAGES, 0, deadline_us));
+  tx_us = udp_bench_time_us () - start_us;
+  ck_assert_int_eq (udp_bench.nb_peer_errors, 0);
+
+  printf ("%u S11 sized datagrams, window %u: UDP_DATA_IND %u msgs/s, UDP_DATA_REQ %u msgs/s\n",
+          UDP_BENCH_MESSAGES, UDP_BENCH_WINDOW,
+          (uint32_t)((uint64_t)UDP_BENCH_MESSAGES * 1000000 / ((rx_us) ? rx_us : 1)),
+          (uint32_t)((uint64_t)UDP_BENCH_MESSAGES * 1000000 / ((tx_us) ? tx_us : 1)));
+  // the UDP task logs its datagram and system call counters when it exits
+  ck_assert_int_eq (itti_send_msg_to_task (TASK_UDP, INSTANCE_DEFAULT, itti_alloc_new_message (TASK_S11, TERMINATE_MESSAGE)), RETURNok);
+  usleep (100000);
+}
+END_TEST
+
+Suite * udp_server_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("UDP server tests");
+
+    tc_core = tcase_create("UDP server bench");
+    tcase_add_test(tc_core, udp_server_bench_test);
+    tcase_set_timeout(tc_core, 60);
+
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = udp_server_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
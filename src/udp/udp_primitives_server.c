@@ -26,24 +26,26 @@
   \email: lionel.gauthier@eurecom.fr
 */
 
+#define _GNU_SOURCE             // required for recvmmsg()/sendmmsg()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <inttypes.h>
 
 #include "bstrlib.h"
 
 #include "dynamic_memory_check.h"
 #include "assertions.h"
-#include "queue.h"
 #include "log.h"
 #include "msc.h"
 #include "conversions.h"
@@ -52,9 +54,47 @@
 #include "itti_free_defined_msg.h"
 
 
+#define UDP_RECV_BUFFER_SIZE         4096  /* Max size of a received datagram */
+#define UDP_RECV_BATCH_SIZE          32    /* Datagrams read per recvmmsg() */
+#define UDP_RECV_MAX_BATCHES         8     /* recvmmsg() per epoll event, leave room for ITTI messages */
+#define UDP_SEND_BATCH_SIZE          32    /* Datagrams written per sendmmsg() */
+
+/* Datagrams are received directly in buffers that are handed over to the
+ * consumer task in UDP_DATA_IND (released by itti_free_msg_content()),
+ * the slot is refilled before the next recvmmsg().
+ */
+typedef struct udp_recv_batch_s {
+  struct mmsghdr                          msgs[UDP_RECV_BATCH_SIZE];
+  struct iovec                            iovecs[UDP_RECV_BATCH_SIZE];
+  struct sockaddr_in                      addrs[UDP_RECV_BATCH_SIZE];
+  uint8_t                                *buffers[UDP_RECV_BATCH_SIZE];
+} udp_recv_batch_t;
+
+/* The payload of a UDP_DATA_REQ is copied in the batch: the buffer of the
+ * requesting task (ex: a nwgtpv2c message) is released or recycled as soon
+ * as the ITTI message is freed, before the batch is flushed.
+ */
+typedef struct udp_send_batch_s {
+  int                                     sd;
+  unsigned int                            count;
+  struct mmsghdr                          msgs[UDP_SEND_BATCH_SIZE];
+  struct iovec                            iovecs[UDP_SEND_BATCH_SIZE];
+  struct sockaddr_in                      addrs[UDP_SEND_BATCH_SIZE];
+  uint8_t                                 buffers[UDP_SEND_BATCH_SIZE][UDP_RECV_BUFFER_SIZE];
+} udp_send_batch_t;
+
+typedef struct udp_server_stats_s {
+  volatile uint64_t                       rx_datagrams;
+  volatile uint64_t                       rx_syscalls;
+  uint64_t                                tx_datagrams;
+  uint64_t                                tx_syscalls;
+  struct timespec                         start;
+} udp_server_stats_t;
+
 struct udp_socket_desc_s {
-  uint8_t                                 buffer[4096];
+  udp_recv_batch_t                        recv_batch;
   int                                     sd;   /* Socket descriptor to use */
+  bool                                    reuseport_listener; /* Served by listener_thread instead of TASK_UDP */
 
   pthread_t                               listener_thread;      /* Thread affected to recv */
 
@@ -62,69 +102,50 @@ struct udp_socket_desc_s {
   uint16_t                                local_port;   /* Local port to use */
 
   task_id_t                               task_id;      /* Task who has requested the new endpoint */
-
-                                          STAILQ_ENTRY (
-  udp_socket_desc_s)                      entries;
+  udp_steer_cb_t                          steer;        /* Optional dispatching of datagrams over several tasks */
 };
 
-static
-STAILQ_HEAD (
-  udp_socket_list_s,
-  udp_socket_desc_s) udp_socket_list;
-     static pthread_mutex_t                  udp_socket_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Descriptors are created, looked up and released by TASK_UDP only (the
+ * listener threads just use their own descriptor), so no lock is needed:
+ * epoll events carry the descriptor in data.ptr, UDP_DATA_REQ finds it by
+ * the requesting task id, the fd-indexed array owns them.
+ */
+static struct udp_socket_desc_s       **udp_socket_desc_by_sd = NULL;
+static int                              udp_socket_desc_by_sd_size = 0;
+static struct udp_socket_desc_s        *udp_socket_desc_by_task[TASK_MAX] = {NULL};
+
+static udp_send_batch_t                 udp_send_batch = {.sd = -1, .count = 0};
+static udp_server_stats_t               udp_server_stats = {0};
 
 
 static void                             udp_server_receive_and_process (
   struct udp_socket_desc_s *udp_sock_pP);
+static int                              udp_server_recv_batch (
+  struct udp_socket_desc_s *udp_sock_pP,
+  int flags);
 
 
 /* @brief Retrieve the descriptor associated with the task_id
 */
-static
+static inline
 struct udp_socket_desc_s               *
 udp_server_get_socket_desc (
   task_id_t task_id)
 {
-  struct udp_socket_desc_s               *udp_sock_p = NULL;
-
-  OAILOG_DEBUG (LOG_UDP, "Looking for task %d\n", task_id);
-  STAILQ_FOREACH (udp_sock_p, &udp_socket_list, entries) {
-    if (udp_sock_p->task_id == task_id) {
-      OAILOG_DEBUG (LOG_UDP, "Found matching task desc\n");
-      break;
-    }
-  }
-  return udp_sock_p;
-}
-
-static
-struct udp_socket_desc_s               *
-udp_server_get_socket_desc_by_sd (
-  int sdP)
-{
-  struct udp_socket_desc_s               *udp_sock_p = NULL;
-
-  OAILOG_DEBUG (LOG_UDP, "Looking for sd %d\n", sdP);
-  STAILQ_FOREACH (udp_sock_p, &udp_socket_list, entries) {
-    if (udp_sock_p->sd == sdP) {
-      OAILOG_DEBUG (LOG_UDP, "Found matching task desc\n");
-      break;
-    }
-  }
-  return udp_sock_p;
+  return (task_id < TASK_MAX) ? udp_socket_desc_by_task[task_id] : NULL;
 }
 
 static
   int
-udp_server_create_socket (
+udp_server_open_socket (
   uint16_t port,
   struct in_addr *address,
-  task_id_t task_id)
+  bool reuseport,
+  bool nonblocking)
 {
   struct sockaddr_in                      addr;
   int                                     sd;
-  struct udp_socket_desc_s               *socket_desc_p = NULL;
-
+  int                                     on = 1;
 
   /*
    * Create UDP socket
@@ -137,6 +158,12 @@ udp_server_create_socket (
     return sd;
   }
 
+  if ((reuseport) && (setsockopt (sd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on)) < 0)) {
+    OAILOG_ERROR (LOG_UDP, "setsockopt SO_REUSEPORT failed (%s)\n", strerror (errno));
+    close (sd);
+    return -1;
+  }
+
   memset (&addr, 0, sizeof (struct sockaddr_in));
   addr.sin_family = AF_INET;
   addr.sin_port = htons (port);
@@ -155,17 +182,27 @@ udp_server_create_socket (
     return -1;
   }
 
-  /*
-   * Add the socket to list of fd monitored by ITTI
-   */
   /*
    * Mark the socket as non-blocking
    */
-  if (fcntl (sd, F_SETFL, O_NONBLOCK) < 0) {
+  if ((nonblocking) && (fcntl (sd, F_SETFL, O_NONBLOCK) < 0)) {
     OAILOG_ERROR (LOG_UDP, "fcntl F_SETFL O_NONBLOCK failed: %s\n", strerror (errno));
     close (sd);
     return -1;
   }
+  return sd;
+}
+
+static struct udp_socket_desc_s *
+udp_server_new_socket_desc (
+  int sd,
+  uint16_t port,
+  struct in_addr *address,
+  task_id_t task_id,
+  udp_steer_cb_t steer,
+  bool reuseport_listener)
+{
+  struct udp_socket_desc_s               *socket_desc_p = NULL;
 
   socket_desc_p = calloc (1, sizeof (struct udp_socket_desc_s));
   DevAssert (socket_desc_p != NULL);
@@ -173,11 +210,85 @@ udp_server_create_socket (
   socket_desc_p->local_address.s_addr = address->s_addr;
   socket_desc_p->local_port = port;
   socket_desc_p->task_id = task_id;
+  socket_desc_p->steer = steer;
+  socket_desc_p->reuseport_listener = reuseport_listener;
   OAILOG_DEBUG (LOG_UDP, "Inserting new descriptor for task %d, sd %d\n", socket_desc_p->task_id, socket_desc_p->sd);
-  pthread_mutex_lock (&udp_socket_list_mutex);
-  STAILQ_INSERT_TAIL (&udp_socket_list, socket_desc_p, entries);
-  pthread_mutex_unlock (&udp_socket_list_mutex);
-  itti_subscribe_event_fd (TASK_UDP, sd);
+  if (sd >= udp_socket_desc_by_sd_size) {
+    int                                     size = (udp_socket_desc_by_sd_size) ? udp_socket_desc_by_sd_size : 64;
+
+    while (size <= sd) {
+      size *= 2;
+    }
+    udp_socket_desc_by_sd = realloc (udp_socket_desc_by_sd, size * sizeof (struct udp_socket_desc_s *));
+    DevAssert (udp_socket_desc_by_sd != NULL);
+    memset (&udp_socket_desc_by_sd[udp_socket_desc_by_sd_size], 0, (size - udp_socket_desc_by_sd_size) * sizeof (struct udp_socket_desc_s *));
+    udp_socket_desc_by_sd_size = size;
+  }
+  udp_socket_desc_by_sd[sd] = socket_desc_p;
+  if ((!reuseport_listener) && (task_id < TASK_MAX)) {
+    if (udp_socket_desc_by_task[task_id]) {
+      OAILOG_WARNING (LOG_UDP, "Task %d already owns sd %d, UDP_DATA_REQ now sent on sd %d\n", task_id, udp_socket_desc_by_task[task_id]->sd, sd);
+    }
+    udp_socket_desc_by_task[task_id] = socket_desc_p;
+  }
+  return socket_desc_p;
+}
+
+#if UDP_SERVER_REUSEPORT_THREADS
+//------------------------------------------------------------------------------
+static void *udp_server_reuseport_listener (void *args_p)
+{
+  struct udp_socket_desc_s               *udp_sock_p = (struct udp_socket_desc_s *)args_p;
+
+  OAILOG_DEBUG (LOG_UDP, "Listener thread started for task %d, sd %d\n", udp_sock_p->task_id, udp_sock_p->sd);
+  /*
+   * Blocking socket: wait for the first datagram, then take what is already queued
+   */
+  while (udp_server_recv_batch (udp_sock_p, MSG_WAITFORONE) >= 0);
+  return NULL;
+}
+#endif
+
+static
+  int
+udp_server_create_socket (
+  uint16_t port,
+  struct in_addr *address,
+  task_id_t task_id,
+  udp_steer_cb_t steer)
+{
+  int                                     sd;
+
+  sd = udp_server_open_socket (port, address, (UDP_SERVER_REUSEPORT_THREADS > 0), true);
+  if (sd < 0) {
+    return sd;
+  }
+  struct udp_socket_desc_s               *socket_desc_p = udp_server_new_socket_desc (sd, port, address, task_id, steer, false);
+
+  /*
+   * Add the socket to list of fd monitored by ITTI
+   */
+  itti_subscribe_event_fd_ptr (TASK_UDP, sd, socket_desc_p);
+
+#if UDP_SERVER_REUSEPORT_THREADS
+  /*
+   * Additional sockets bound to the same address, the kernel spreads
+   * peers over them, each one is served by its own thread.
+   */
+  for (int i = 0; i < UDP_SERVER_REUSEPORT_THREADS; i++) {
+    int                                     listener_sd = udp_server_open_socket (port, address, true, false);
+
+    if (listener_sd < 0) {
+      OAILOG_WARNING (LOG_UDP, "SO_REUSEPORT socket %d creation failed, continuing with %d sockets\n", i, i + 1);
+      break;
+    }
+    struct udp_socket_desc_s               *listener_p = udp_server_new_socket_desc (listener_sd, port, address, task_id, steer, true);
+
+    if (pthread_create (&listener_p->listener_thread, NULL, udp_server_reuseport_listener, listener_p) != 0) {
+      OAILOG_ERROR (LOG_UDP, "UDP listener pthread_create (%s)\n", strerror (errno));
+    }
+  }
+#endif
   return sd;
 }
 
@@ -187,74 +298,171 @@ udp_server_flush_sockets (
   int nb_events)
 {
   int                                     event;
-  struct udp_socket_desc_s               *udp_sock_p = NULL;
 
   OAILOG_DEBUG (LOG_UDP, "Received %d events\n", nb_events);
 
   for (event = 0; event < nb_events; event++) {
     if (events[event].events != 0) {
       /*
-       * If the event has not been yet been processed (not an itti message)
+       * If the event has not been yet been processed (not an itti message),
+       * it is for a socket subscribed with its descriptor
        */
-      pthread_mutex_lock (&udp_socket_list_mutex);
-      udp_sock_p = udp_server_get_socket_desc_by_sd (events[event].data.fd);
+      udp_server_receive_and_process ((struct udp_socket_desc_s *)events[event].data.ptr);
+    }
+  }
+}
 
-      if (udp_sock_p != NULL) {
-        udp_server_receive_and_process (udp_sock_p);
-      } else {
-        OAILOG_ERROR (LOG_UDP, "Failed to retrieve the udp socket descriptor %d", events[event].data.fd);
-      }
+/* @brief Read up to UDP_RECV_BATCH_SIZE datagrams with one system call and
+ * forward each of them to the task owning the socket, without copy.
+ * @returns the number of datagrams read, -1 on error (EAGAIN included)
+ */
+static int
+udp_server_recv_batch (
+  struct udp_socket_desc_s *udp_sock_pP,
+  int flags)
+{
+  udp_recv_batch_t                       *batch = &udp_sock_pP->recv_batch;
+  int                                     nb_msgs = 0;
 
-      pthread_mutex_unlock (&udp_socket_list_mutex);
+  for (int i = 0; i < UDP_RECV_BATCH_SIZE; i++) {
+    if (batch->buffers[i] == NULL) {
+      batch->buffers[i] = malloc (UDP_RECV_BUFFER_SIZE);
+      DevAssert (batch->buffers[i] != NULL);
     }
+    batch->iovecs[i].iov_base = batch->buffers[i];
+    batch->iovecs[i].iov_len = UDP_RECV_BUFFER_SIZE;
+    batch->msgs[i].msg_hdr.msg_iov = &batch->iovecs[i];
+    batch->msgs[i].msg_hdr.msg_iovlen = 1;
+    batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+    batch->msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+    batch->msgs[i].msg_hdr.msg_control = NULL;
+    batch->msgs[i].msg_hdr.msg_controllen = 0;
+    batch->msgs[i].msg_hdr.msg_flags = 0;
+    batch->msgs[i].msg_len = 0;
   }
+
+  if ((nb_msgs = recvmmsg (udp_sock_pP->sd, batch->msgs, UDP_RECV_BATCH_SIZE, flags, NULL)) <= 0) {
+    if ((nb_msgs < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+      OAILOG_ERROR (LOG_UDP, "recvmmsg failed %s\n", strerror (errno));
+    }
+    return -1;
+  }
+  __sync_fetch_and_add (&udp_server_stats.rx_syscalls, 1);
+  __sync_fetch_and_add (&udp_server_stats.rx_datagrams, nb_msgs);
+
+  for (int i = 0; i < nb_msgs; i++) {
+    MessageDef                             *message_p = NULL;
+    udp_data_ind_t                         *udp_data_ind_p;
+    int                                     task_id = -1;
+
+    if (batch->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      OAILOG_ERROR (LOG_UDP, "Discarding datagram larger than %d bytes from %s\n", UDP_RECV_BUFFER_SIZE, inet_ntoa (batch->addrs[i].sin_addr));
+      continue;
+    }
+    message_p = itti_alloc_new_message (TASK_UDP, UDP_DATA_IND);
+    DevAssert (message_p != NULL);
+    udp_data_ind_p = &message_p->ittiMsg.udp_data_ind;
+    udp_data_ind_p->buffer = batch->buffers[i];
+    udp_data_ind_p->buffer_length = batch->msgs[i].msg_len;
+    udp_data_ind_p->peer_port = htons (batch->addrs[i].sin_port);
+    udp_data_ind_p->peer_address = batch->addrs[i].sin_addr;
+    batch->buffers[i] = NULL;
+    OAILOG_DEBUG (LOG_UDP, "Msg of length %u received from %s:%u\n", batch->msgs[i].msg_len, inet_ntoa (batch->addrs[i].sin_addr), ntohs (batch->addrs[i].sin_port));
+
+    if (udp_sock_pP->steer) {
+      task_id = udp_sock_pP->steer (udp_data_ind_p->buffer, udp_data_ind_p->buffer_length);
+    }
+    if ((task_id < 0) || (task_id >= TASK_MAX)) {
+      task_id = udp_sock_pP->task_id;
+    }
+
+    if (itti_send_msg_to_task (task_id, INSTANCE_DEFAULT, message_p) < 0) {
+      OAILOG_DEBUG (LOG_UDP, "Failed to send message %d to task %d\n", UDP_DATA_IND, task_id);
+    }
+  }
+  return nb_msgs;
 }
 
 static void
 udp_server_receive_and_process (
   struct udp_socket_desc_s *udp_sock_pP)
 {
-  OAILOG_DEBUG (LOG_UDP, "Inserting new descriptor for task %d, sd %d\n", udp_sock_pP->task_id, udp_sock_pP->sd);
-  {
-    int                                     bytes_received = 0;
-    socklen_t                               from_len;
-    struct sockaddr_in                      addr;
+  OAILOG_DEBUG (LOG_UDP, "Receiving on descriptor for task %d, sd %d\n", udp_sock_pP->task_id, udp_sock_pP->sd);
+  /*
+   * Drain the socket, a full batch means more datagrams may be pending
+   */
+  for (int batch = 0; batch < UDP_RECV_MAX_BATCHES; batch++) {
+    if (udp_server_recv_batch (udp_sock_pP, MSG_DONTWAIT) < UDP_RECV_BATCH_SIZE) {
+      break;
+    }
+  }
+}
 
-    from_len = (socklen_t) sizeof (struct sockaddr_in);
+/* @brief Send the datagrams accumulated by udp_server_queue_send() with as
+ * few sendmmsg() as possible.
+ */
+static void
+udp_server_flush_send_batch (void)
+{
+  unsigned int                            sent = 0;
 
-    if ((bytes_received = recvfrom (udp_sock_pP->sd, udp_sock_pP->buffer, sizeof (udp_sock_pP->buffer), 0, (struct sockaddr *)&addr, &from_len)) <= 0) {
-      OAILOG_ERROR (LOG_UDP, "Recvfrom failed %s\n", strerror (errno));
-      //break;
-    } else {
-      MessageDef                             *message_p = NULL;
-      udp_data_ind_t                         *udp_data_ind_p;
-      uint8_t                                *forwarded_buffer = NULL;
-
-      AssertFatal (sizeof (udp_sock_pP->buffer) >= bytes_received, "UDP BUFFER OVERFLOW");
-      forwarded_buffer = itti_malloc (TASK_UDP, udp_sock_pP->task_id, bytes_received);
-      DevAssert (forwarded_buffer != NULL);
-      memcpy (forwarded_buffer, udp_sock_pP->buffer, bytes_received);
-      message_p = itti_alloc_new_message (TASK_UDP, UDP_DATA_IND);
-      DevAssert (message_p != NULL);
-      udp_data_ind_p = &message_p->ittiMsg.udp_data_ind;
-      udp_data_ind_p->buffer = forwarded_buffer;
-      udp_data_ind_p->buffer_length = bytes_received;
-      udp_data_ind_p->peer_port = htons (addr.sin_port);
-      udp_data_ind_p->peer_address = addr.sin_addr;
-      OAILOG_DEBUG (LOG_UDP, "Msg of length %d received from %s:%u\n", bytes_received, inet_ntoa (addr.sin_addr), ntohs (addr.sin_port));
-
-      if (itti_send_msg_to_task (udp_sock_pP->task_id, INSTANCE_DEFAULT, message_p) < 0) {
-        OAILOG_DEBUG (LOG_UDP, "Failed to send message %d to task %d\n", UDP_DATA_IND, udp_sock_pP->task_id);
-        //break;
+  while (sent < udp_send_batch.count) {
+    int                                     rc = sendmmsg (udp_send_batch.sd, &udp_send_batch.msgs[sent], udp_send_batch.count - sent, 0);
+
+    udp_server_stats.tx_syscalls++;
+    if (rc <= 0) {
+      OAILOG_ERROR (LOG_UDP, "There was an error while writing to socket " "(%d:%s)\n", errno, strerror (errno));
+      // skip the datagram that failed
+      sent++;
+      continue;
+    }
+    for (int i = 0; i < rc; i++) {
+      if (udp_send_batch.msgs[sent + i].msg_len != udp_send_batch.iovecs[sent + i].iov_len) {
+        OAILOG_ERROR (LOG_UDP, "Partial write to socket %d (%u/%zu)\n", udp_send_batch.sd, udp_send_batch.msgs[sent + i].msg_len, udp_send_batch.iovecs[sent + i].iov_len);
       }
     }
+    sent += rc;
+    udp_server_stats.tx_datagrams += rc;
   }
-  //close(udp_sock_pP->sd);
-  //udp_sock_pP->sd = -1;
-  //pthread_mutex_lock(&udp_socket_list_mutex);
-  //STAILQ_REMOVE(&udp_socket_list, udp_sock_pP, udp_socket_desc_s, entries);
-  //pthread_mutex_unlock(&udp_socket_list_mutex);
-  //return NULL;
+  udp_send_batch.count = 0;
+  udp_send_batch.sd = -1;
+}
+
+static void
+udp_server_queue_send (
+  int sd,
+  udp_data_req_t * udp_data_req_p)
+{
+  const unsigned int                      i = udp_send_batch.count;
+
+  memset (&udp_send_batch.addrs[i], 0, sizeof (struct sockaddr_in));
+  udp_send_batch.addrs[i].sin_family = AF_INET;
+  udp_send_batch.addrs[i].sin_port = htons (udp_data_req_p->peer_port);
+  udp_send_batch.addrs[i].sin_addr = udp_data_req_p->peer_address;
+
+  if (udp_data_req_p->buffer_length > UDP_RECV_BUFFER_SIZE) {
+    // does not fit in the batch, write it now
+    ssize_t                                 bytes_written = sendto (sd, &udp_data_req_p->buffer[udp_data_req_p->buffer_offset], udp_data_req_p->buffer_length, 0,
+                                                                    (struct sockaddr *)&udp_send_batch.addrs[i], sizeof (struct sockaddr_in));
+
+    udp_server_stats.tx_syscalls++;
+    if (bytes_written != (ssize_t)udp_data_req_p->buffer_length) {
+      OAILOG_ERROR (LOG_UDP, "There was an error while writing to socket %d (%d:%s)\n", sd, errno, strerror (errno));
+    } else {
+      udp_server_stats.tx_datagrams++;
+    }
+    return;
+  }
+  memcpy (udp_send_batch.buffers[i], &udp_data_req_p->buffer[udp_data_req_p->buffer_offset], udp_data_req_p->buffer_length);
+  udp_send_batch.iovecs[i].iov_base = udp_send_batch.buffers[i];
+  udp_send_batch.iovecs[i].iov_len = udp_data_req_p->buffer_length;
+  memset (&udp_send_batch.msgs[i].msg_hdr, 0, sizeof (struct msghdr));
+  udp_send_batch.msgs[i].msg_hdr.msg_name = &udp_send_batch.addrs[i];
+  udp_send_batch.msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+  udp_send_batch.msgs[i].msg_hdr.msg_iov = &udp_send_batch.iovecs[i];
+  udp_send_batch.msgs[i].msg_hdr.msg_iovlen = 1;
+  udp_send_batch.sd = sd;
+  udp_send_batch.count++;
 }
 
 
@@ -269,10 +477,18 @@ static void *udp_intertask_interface (void *args_p)
 
   while (1) {
     MessageDef                             *received_message_p = NULL;
+    int                                     nb_polled = 0;
 
     itti_receive_msg (TASK_UDP, &received_message_p);
 
-    if (received_message_p != NULL) {
+    /*
+     * Process the received message and the ones already queued (up to a
+     * send batch), consecutive UDP_DATA_REQ are written with one sendmmsg().
+     */
+    while (received_message_p != NULL) {
+      if ((udp_send_batch.count) && (ITTI_MSG_ID (received_message_p) != UDP_DATA_REQ)) {
+        udp_server_flush_send_batch ();
+      }
       switch (ITTI_MSG_ID (received_message_p)) {
       case MESSAGE_TEST:{
           OAI_FPRINTF_INFO("TASK_UDP received MESSAGE_TEST\n");
@@ -291,46 +507,36 @@ static void *udp_intertask_interface (void *args_p)
 
       case UDP_INIT:{
           udp_init_t                             *udp_init_p = &received_message_p->ittiMsg.udp_init;
-          rc = udp_server_create_socket (udp_init_p->port, &udp_init_p->address, ITTI_MSG_ORIGIN_ID (received_message_p));
+          rc = udp_server_create_socket (udp_init_p->port, &udp_init_p->address, ITTI_MSG_ORIGIN_ID (received_message_p), udp_init_p->steer);
         }
         break;
 
       case UDP_DATA_REQ:{
           int                                     udp_sd = -1;
-          ssize_t                                 bytes_written;
           struct udp_socket_desc_s               *udp_sock_p = NULL;
           udp_data_req_t                         *udp_data_req_p;
-          struct sockaddr_in                      peer_addr;
 
           udp_data_req_p = &received_message_p->ittiMsg.udp_data_req;
           //UDP_DEBUG("-- UDP_DATA_REQ -----------------------------------------------------\n%s :\n",
           //        __FUNCTION__);
           //udp_print_hex_octets(&udp_data_req_p->buffer[udp_data_req_p->buffer_offset],
           //        udp_data_req_p->buffer_length);
-          memset (&peer_addr, 0, sizeof (struct sockaddr_in));
-          peer_addr.sin_family = AF_INET;
-          peer_addr.sin_port = htons (udp_data_req_p->peer_port);
-          peer_addr.sin_addr = udp_data_req_p->peer_address;
-          pthread_mutex_lock (&udp_socket_list_mutex);
           udp_sock_p = udp_server_get_socket_desc (ITTI_MSG_ORIGIN_ID (received_message_p));
 
           if (udp_sock_p == NULL) {
             OAILOG_ERROR (LOG_UDP, "Failed to retrieve the udp socket descriptor " "associated with task %d\n", ITTI_MSG_ORIGIN_ID (received_message_p));
-            pthread_mutex_unlock (&udp_socket_list_mutex);
             // no free udp_data_req_p->buffer, statically allocated
             goto on_error;
           }
 
           udp_sd = udp_sock_p->sd;
-          pthread_mutex_unlock (&udp_socket_list_mutex);
           OAILOG_DEBUG (LOG_UDP, "[%d] Sending message of size %u to " IN_ADDR_FMT " and port %u\n",
               udp_sd, udp_data_req_p->buffer_length, PRI_IN_ADDR (udp_data_req_p->peer_address), udp_data_req_p->peer_port);
-          bytes_written = sendto (udp_sd, &udp_data_req_p->buffer[udp_data_req_p->buffer_offset], udp_data_req_p->buffer_length, 0, (struct sockaddr *)&peer_addr, sizeof (struct sockaddr_in));
-          // no free udp_data_req_p->buffer, statically allocated
-
-          if (bytes_written != udp_data_req_p->buffer_length) {
-            OAILOG_ERROR (LOG_UDP, "There was an error while writing to socket " "(%d:%s)\n", errno, strerror (errno));
+          if ((udp_send_batch.count == UDP_SEND_BATCH_SIZE) || ((udp_send_batch.count) && (udp_send_batch.sd != udp_sd))) {
+            udp_server_flush_send_batch ();
           }
+          udp_server_queue_send (udp_sd, udp_data_req_p);
+          // no free udp_data_req_p->buffer, statically allocated
         }
         break;
 
@@ -345,6 +551,12 @@ static void *udp_intertask_interface (void *args_p)
       rc = itti_free (ITTI_MSG_ORIGIN_ID (received_message_p), received_message_p);
       AssertFatal (rc == EXIT_SUCCESS, "Failed to free memory (%d)!\n", rc);
       received_message_p = NULL;
+      if (++nb_polled < UDP_SEND_BATCH_SIZE) {
+        itti_poll_msg (TASK_UDP, &received_message_p);
+      }
+    }
+    if (udp_send_batch.count) {
+      udp_server_flush_send_batch ();
     }
 
     nb_events = itti_get_events (TASK_UDP, &events);
@@ -364,7 +576,7 @@ static void *udp_intertask_interface (void *args_p)
 int udp_init (void)
 {
   OAILOG_DEBUG (LOG_UDP, "Initializing UDP task interface\n");
-  STAILQ_INIT (&udp_socket_list);
+  clock_gettime (CLOCK_MONOTONIC, &udp_server_stats.start);
 
   if (itti_create_task (TASK_UDP, &udp_intertask_interface, NULL) < 0) {
     OAILOG_ERROR (LOG_UDP, "udp pthread_create (%s)\n", strerror (errno));
@@ -379,11 +591,33 @@ int udp_init (void)
 void udp_exit (void)
 {
   struct udp_socket_desc_s               *udp_sock_p = NULL;
-  while ((udp_sock_p = STAILQ_FIRST (&udp_socket_list))) {
-    itti_unsubscribe_event_fd(TASK_UDP, udp_sock_p->sd);
+  struct timespec                         now = {0};
+  double                                  elapsed = 0;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - udp_server_stats.start.tv_sec) + (now.tv_nsec - udp_server_stats.start.tv_nsec) / 1e9;
+  OAILOG_INFO (LOG_UDP, "UDP rx %" PRIu64 " datagrams in %" PRIu64 " recvmmsg, tx %" PRIu64 " datagrams in %" PRIu64 " sendmmsg, %.0f datagrams/s\n",
+      udp_server_stats.rx_datagrams, udp_server_stats.rx_syscalls, udp_server_stats.tx_datagrams, udp_server_stats.tx_syscalls,
+      (elapsed > 0) ? (udp_server_stats.rx_datagrams + udp_server_stats.tx_datagrams) / elapsed : 0);
+  for (int sd = 0; sd < udp_socket_desc_by_sd_size; sd++) {
+    if ((udp_sock_p = udp_socket_desc_by_sd[sd]) == NULL) {
+      continue;
+    }
+    if (udp_sock_p->reuseport_listener) {
+      // unblock recvmmsg() of the listener thread
+      shutdown (udp_sock_p->sd, SHUT_RDWR);
+      pthread_join (udp_sock_p->listener_thread, NULL);
+    } else {
+      itti_unsubscribe_event_fd(TASK_UDP, udp_sock_p->sd);
+    }
     close(udp_sock_p->sd);
-    pthread_mutex_destroy(&udp_socket_list_mutex);
-    STAILQ_REMOVE_HEAD (&udp_socket_list, entries);
+    for (int i = 0; i < UDP_RECV_BATCH_SIZE; i++) {
+      free_wrapper ((void**)&udp_sock_p->recv_batch.buffers[i]);
+    }
+    udp_socket_desc_by_sd[sd] = NULL;
     free_wrapper ((void**)&udp_sock_p);
   }
+  free_wrapper ((void**)&udp_socket_desc_by_sd);
+  udp_socket_desc_by_sd_size = 0;
+  memset (udp_socket_desc_by_task, 0, sizeof (udp_socket_desc_by_task));
 }
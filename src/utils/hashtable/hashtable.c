@@ -1124,11 +1124,12 @@ hashtable_ts_resize (
   hash_table_ts_t * const hashtblP,
   const hash_size_t sizeP)
 {
-  hash_table_ts_t                         newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t                             n      = 0;
-  hash_node_t                            *node   = NULL,
-                                         *next   = NULL;
-  void                                   *dummy  = NULL;
+  hash_node_t                           **nodes      = NULL;
+  pthread_mutex_t                        *lock_nodes = NULL;
+  hash_size_t                             n          = 0;
+  hash_size_t                             hash       = 0;
+  hash_node_t                            *node       = NULL,
+                                         *next       = NULL;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
@@ -1152,34 +1153,34 @@ hashtable_ts_resize (
   size |= size >> 16;
   size++;
 
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc (size, sizeof (hash_node_t *))))
+  if (!(nodes = calloc (size, sizeof (hash_node_t *))))
     return HASH_TABLE_SYSTEM_ERROR;
 
-  if (!(newtbl.lock_nodes = calloc (size, sizeof (pthread_mutex_t)))) {
-    free_wrapper ((void**)&newtbl.nodes);
+  if (!(lock_nodes = calloc (size, sizeof (pthread_mutex_t)))) {
+    free_wrapper ((void**)&nodes);
     return HASH_TABLE_SYSTEM_ERROR;
   }
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_init(&newtbl.lock_nodes[n], NULL);
+  for (n = 0; n < size; ++n) {
+    pthread_mutex_init(&lock_nodes[n], NULL);
   }
 
+  // nodes are moved, not copied, readers and writers must be stopped
   pthread_mutex_lock(&hashtblP->mutex);
   for (n = 0; n < hashtblP->size; ++n) {
     for (node = hashtblP->nodes[n]; node; node = next) {
       next = node->next;
-      hashtable_ts_remove (hashtblP, node->key, &dummy);
-      hashtable_ts_insert (&newtbl, node->key, node->data);
+      hash = hashtblP->hashfunc (node->key) % size;
+      node->next = nodes[hash];
+      nodes[hash] = node;
     }
+    pthread_mutex_destroy(&hashtblP->lock_nodes[n]);
   }
 
   free_wrapper ((void**)&hashtblP->nodes);
   free_wrapper ((void**)&hashtblP->lock_nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  hashtblP->lock_nodes = newtbl.lock_nodes;
+  hashtblP->size = size;
+  hashtblP->nodes = nodes;
+  hashtblP->lock_nodes = lock_nodes;
   pthread_mutex_unlock(&hashtblP->mutex);
   return HASH_TABLE_OK;
 }
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file mem_slab.c
+   \brief
+   \author
+   \date 2017
+   \email:
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dynamic_memory_check.h"
+#include "common_defs.h"
+#include "mem_slab.h"
+
+// chunk header, keeps the objects aligned
+#define MEM_SLAB_CHUNK_HEADER_SIZE  (sizeof (void *) > 16 ? sizeof (void *) : 16)
+
+//------------------------------------------------------------------------------
+int mem_slab_init (mem_slab_t * const slab, const char * const name, const size_t obj_size, const uint32_t objs_per_chunk)
+{
+  memset (slab, 0, sizeof (*slab));
+  if ((0 == obj_size) || (0 == objs_per_chunk)) {
+    return RETURNerror;
+  }
+  slab->name = name;
+  slab->obj_size = (obj_size + sizeof (void *) - 1) & ~(sizeof (void *) - 1);
+  slab->objs_per_chunk = objs_per_chunk;
+  slab->chunk_next = objs_per_chunk;
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void mem_slab_destroy (mem_slab_t * const slab)
+{
+  void                                   *chunk = slab->chunks;
+
+  while (chunk) {
+    void                                 *next = *(void **)chunk;
+
+    free_wrapper (&chunk);
+    chunk = next;
+  }
+  slab->chunks = NULL;
+  slab->free_list = NULL;
+  slab->nb_chunks = 0;
+  slab->nb_used = 0;
+  slab->chunk_next = slab->objs_per_chunk;
+}
+
+//------------------------------------------------------------------------------
+void *mem_slab_alloc (mem_slab_t * const slab)
+{
+  void                                   *obj = NULL;
+
+  if (slab->free_list) {
+    obj = slab->free_list;
+    slab->free_list = *(void **)obj;
+  } else {
+    if (slab->chunk_next == slab->objs_per_chunk) {
+      void                               *chunk = malloc (MEM_SLAB_CHUNK_HEADER_SIZE + slab->obj_size * slab->objs_per_chunk);
+
+      if (!chunk) {
+        return NULL;
+      }
+      *(void **)chunk = slab->chunks;
+      slab->chunks = chunk;
+      slab->nb_chunks += 1;
+      slab->chunk_next = 0;
+    }
+    obj = (uint8_t *)slab->chunks + MEM_SLAB_CHUNK_HEADER_SIZE + slab->obj_size * slab->chunk_next;
+    slab->chunk_next += 1;
+  }
+  memset (obj, 0, slab->obj_size);
+  slab->nb_used += 1;
+  return obj;
+}
+
+//------------------------------------------------------------------------------
+void mem_slab_free (mem_slab_t * const slab, void ** obj)
+{
+  if ((obj) && (*obj)) {
+    *(void **)(*obj) = slab->free_list;
+    slab->free_list = *obj;
+    slab->nb_used -= 1;
+    *obj = NULL;
+  }
+}
+
+//------------------------------------------------------------------------------
+size_t mem_slab_footprint (const mem_slab_t * const slab)
+{
+  return (size_t)slab->nb_chunks * (MEM_SLAB_CHUNK_HEADER_SIZE + slab->obj_size * slab->objs_per_chunk);
+}
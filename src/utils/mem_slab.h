@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file mem_slab.h
+   \brief Fixed size object caches, objects are carved out of large chunks
+   \ instead of one malloc each, and recycled through a free list.
+   \author
+   \date 2017
+   \email:
+*/
+#ifndef FILE_MEM_SLAB_SEEN
+#define FILE_MEM_SLAB_SEEN
+#include <stdint.h>
+#include <stddef.h>
+
+#define MEM_SLAB_OBJS_PER_CHUNK_DEFAULT 1024
+
+/*
+ * Not thread safe, a cache is owned by one task.
+ * Chunks are only given back to the system by mem_slab_destroy().
+ */
+typedef struct mem_slab_s {
+  const char *name;
+  size_t      obj_size;        // rounded up to the alignment of pointers
+  uint32_t    objs_per_chunk;
+  uint32_t    nb_chunks;
+  uint32_t    nb_used;
+  uint32_t    chunk_next;      // first never used object in the last chunk
+  void       *free_list;
+  void       *chunks;          // list of chunks, linked through their first word
+} mem_slab_t;
+
+int    mem_slab_init (mem_slab_t * const slab, const char * const name, const size_t obj_size, const uint32_t objs_per_chunk);
+void   mem_slab_destroy (mem_slab_t * const slab);
+
+// returns a zeroed object or NULL
+void  *mem_slab_alloc (mem_slab_t * const slab);
+void   mem_slab_free (mem_slab_t * const slab, void ** obj);
+
+// bytes taken from the system
+size_t mem_slab_footprint (const mem_slab_t * const slab);
+
+#endif /* FILE_MEM_SLAB_SEEN */
@@ -49,6 +49,17 @@
 
 #define S1AP_OUTCOME_TIMER_DEFAULT (5)     ///< S1AP Outcome drop timer (s)
 
+#define S1AP_OVERLOAD_MAX_PENDING_DEFAULT            (4096) ///< Max S1AP PDUs queued between SCTP and S1AP tasks
+#define S1AP_OVERLOAD_INITIAL_UE_MAX_PENDING_DEFAULT (1024) ///< Max queued S1AP PDUs for accepting an InitialUEMessage
+#define S1AP_OVERLOAD_START_LATENCY_DEFAULT          (200)  ///< S1AP queue latency triggering OverloadStart (ms)
+#define S1AP_OVERLOAD_STOP_LATENCY_DEFAULT           (50)   ///< S1AP queue latency triggering OverloadStop (ms)
+
+/*******************************************************************************
+ * S11 Constants
+ ******************************************************************************/
+
+#define S11_ECHO_INTERVAL_DEFAULT (60)  ///< Interval between Echo Requests to a S-GW (s), 0 disables path management
+
 /*******************************************************************************
  * S6A Constants
  ******************************************************************************/
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file teid_pool.c
+   \brief
+   \author
+   \date 2017
+   \email:
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "dynamic_memory_check.h"
+#include "common_defs.h"
+#include "teid_pool.h"
+
+#define TEID_POOL_IN_USE            0x80000000
+
+#define TEID_POOL_INDEX(pOOL, tEID) ((tEID) & ((1U << (pOOL)->index_bits) - 1))
+#define TEID_POOL_GEN(pOOL, tEID)   ((tEID) >> (pOOL)->index_bits)
+#define TEID_POOL_GEN_MASK(pOOL)    ((uint32_t)(((uint64_t)1 << (32 - (pOOL)->index_bits)) - 1))
+
+//------------------------------------------------------------------------------
+int teid_pool_init (teid_pool_t * const pool, const char * const name, const uint32_t index_bits, const uint32_t nb_shards)
+{
+  uint32_t                                nb_indexes = 0;
+
+  memset (pool, 0, sizeof (*pool));
+  if ((TEID_POOL_INDEX_BITS_MIN > index_bits) || (TEID_POOL_INDEX_BITS_MAX < index_bits) ||
+      (0 == nb_shards) || (TEID_POOL_SHARDS_MAX < nb_shards)) {
+    return RETURNerror;
+  }
+  nb_indexes = 1U << index_bits;
+  pool->name = name;
+  pool->index_bits = index_bits;
+  pool->nb_shards = nb_shards;
+  pool->shard_span = nb_indexes / nb_shards;
+  // calloc'ed: pages are only touched when their indexes get used
+  pool->state = calloc (nb_indexes, sizeof (uint32_t));
+  // shards on their own cache lines
+  if ((!pool->state) || (posix_memalign ((void **)&pool->shards, 64, nb_shards * sizeof (teid_pool_shard_t)))) {
+    pool->shards = NULL;
+    teid_pool_destroy (pool);
+    return RETURNerror;
+  }
+  memset (pool->shards, 0, nb_shards * sizeof (teid_pool_shard_t));
+  for (uint32_t i = 0; i < nb_shards; i++) {
+    teid_pool_shard_t                    *shard = &pool->shards[i];
+
+    shard->first = i * pool->shard_span;
+    shard->size = pool->shard_span;
+    if (0 == i) {
+      shard->first = 1;
+      shard->size -= 1;
+    }
+    pthread_spin_init (&shard->lock, PTHREAD_PROCESS_PRIVATE);
+    shard->ring = calloc (shard->size, sizeof (uint32_t));
+    if (!shard->ring) {
+      pool->nb_shards = i + 1;
+      teid_pool_destroy (pool);
+      return RETURNerror;
+    }
+  }
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+void teid_pool_destroy (teid_pool_t * const pool)
+{
+  if (pool->shards) {
+    for (uint32_t i = 0; i < pool->nb_shards; i++) {
+      free_wrapper ((void **)&pool->shards[i].ring);
+      pthread_spin_destroy (&pool->shards[i].lock);
+    }
+    free_wrapper ((void **)&pool->shards);
+  }
+  free_wrapper ((void **)&pool->state);
+  pool->nb_shards = 0;
+}
+
+//------------------------------------------------------------------------------
+uint32_t teid_pool_alloc (teid_pool_t * const pool, const uint32_t shard_id)
+{
+  teid_pool_shard_t                      *shard = NULL;
+  uint32_t                                index = 0;
+  uint32_t                                gen = 0;
+
+  if (!pool->shards) {
+    return 0;
+  }
+  shard = &pool->shards[shard_id % pool->nb_shards];
+  pthread_spin_lock (&shard->lock);
+  if (shard->nb_free) {
+    index = shard->ring[shard->ring_head];
+    shard->ring_head = (shard->ring_head + 1 == shard->size) ? 0 : shard->ring_head + 1;
+    shard->nb_free -= 1;
+  } else if (shard->next < shard->size) {
+    index = shard->first + shard->next;
+    shard->next += 1;
+  } else {
+    pthread_spin_unlock (&shard->lock);
+    return 0;
+  }
+  gen = pool->state[index];
+  pool->state[index] = gen | TEID_POOL_IN_USE;
+  shard->nb_used += 1;
+  pthread_spin_unlock (&shard->lock);
+  return (gen << pool->index_bits) | index;
+}
+
+//------------------------------------------------------------------------------
+int teid_pool_free (teid_pool_t * const pool, const uint32_t teid)
+{
+  teid_pool_shard_t                      *shard = NULL;
+  uint32_t                                index = 0;
+  uint32_t                                gen = 0;
+  uint32_t                                tail = 0;
+
+  if ((!pool->shards) || (0 == teid)) {
+    return RETURNerror;
+  }
+  index = TEID_POOL_INDEX (pool, teid);
+  gen = TEID_POOL_GEN (pool, teid);
+  shard = &pool->shards[teid_pool_shard_of (pool, teid)];
+  if ((index < shard->first) || (index >= shard->first + shard->size)) {
+    return RETURNerror;
+  }
+  pthread_spin_lock (&shard->lock);
+  if (pool->state[index] != (gen | TEID_POOL_IN_USE)) {
+    pthread_spin_unlock (&shard->lock);
+    return RETURNerror;
+  }
+  pool->state[index] = (gen + 1) & TEID_POOL_GEN_MASK (pool);
+  tail = shard->ring_head + shard->nb_free;
+  if (tail >= shard->size) {
+    tail -= shard->size;
+  }
+  shard->ring[tail] = index;
+  shard->nb_free += 1;
+  shard->nb_used -= 1;
+  pthread_spin_unlock (&shard->lock);
+  return RETURNok;
+}
+
+//------------------------------------------------------------------------------
+bool teid_pool_is_allocated (const teid_pool_t * const pool, const uint32_t teid)
+{
+  if ((!pool->state) || (0 == teid)) {
+    return false;
+  }
+  return (pool->state[TEID_POOL_INDEX (pool, teid)] == (TEID_POOL_GEN (pool, teid) | TEID_POOL_IN_USE));
+}
+
+//------------------------------------------------------------------------------
+uint32_t teid_pool_shard_of (const teid_pool_t * const pool, const uint32_t teid)
+{
+  uint32_t                                shard = 0;
+
+  if (!pool->shard_span) {
+    return 0;
+  }
+  shard = TEID_POOL_INDEX (pool, teid) / pool->shard_span;
+  return (shard < pool->nb_shards) ? shard : pool->nb_shards - 1;
+}
+
+//------------------------------------------------------------------------------
+uint32_t teid_pool_nb_used (teid_pool_t * const pool)
+{
+  uint32_t                                nb_used = 0;
+
+  for (uint32_t i = 0; i < pool->nb_shards; i++) {
+    pthread_spin_lock (&pool->shards[i].lock);
+    nb_used += pool->shards[i].nb_used;
+    pthread_spin_unlock (&pool->shards[i].lock);
+  }
+  return nb_used;
+}
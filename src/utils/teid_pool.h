@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file teid_pool.h
+   \brief Tunnel endpoint identifier allocator, TEIDs are recycled in O(1)
+   \ and carry generation bits so that a stale TEID is never taken for a live one.
+   \author
+   \date 2017
+   \email:
+*/
+#ifndef FILE_TEID_POOL_SEEN
+#define FILE_TEID_POOL_SEEN
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define TEID_POOL_INDEX_BITS_DEFAULT    21     // 2M active TEIDs, 11 generation bits
+#define TEID_POOL_INDEX_BITS_MIN        8
+#define TEID_POOL_INDEX_BITS_MAX        24
+#define TEID_POOL_SHARDS_MAX            64
+
+/*
+ * A TEID is (generation << index_bits) | index. Index 0 is never handed out so
+ * a TEID is never 0. The index space is split in nb_shards contiguous
+ * sub-ranges, each with its own lock, FIFO of freed indexes and watermark of
+ * never used indexes: a thread that keeps to its shard does not contend with
+ * the others, and the shard of a TEID is known from its value. The generation
+ * of an index is bumped on each free, freed indexes are reused oldest first.
+ */
+typedef struct teid_pool_shard_s {
+  pthread_spinlock_t lock;
+  uint32_t    first;           // first index of the sub-range
+  uint32_t    size;            // number of indexes in the sub-range
+  uint32_t    next;            // first never used index, relative to first
+  uint32_t    ring_head;
+  uint32_t    nb_free;         // freed indexes in ring
+  uint32_t    nb_used;
+  uint32_t   *ring;            // freed indexes, oldest first
+} __attribute__ ((aligned (64))) teid_pool_shard_t;
+
+typedef struct teid_pool_s {
+  const char *name;
+  uint32_t    index_bits;
+  uint32_t    nb_shards;
+  uint32_t    shard_span;      // indexes per shard, shard 0 skips index 0
+  uint32_t   *state;           // by index, generation and in use flag
+  teid_pool_shard_t *shards;
+} teid_pool_t;
+
+int      teid_pool_init (teid_pool_t * const pool, const char * const name, const uint32_t index_bits, const uint32_t nb_shards);
+void     teid_pool_destroy (teid_pool_t * const pool);
+
+// returns 0 when the shard is exhausted
+uint32_t teid_pool_alloc (teid_pool_t * const pool, const uint32_t shard);
+
+// RETURNerror for a TEID that is not allocated, stale or freed twice
+int      teid_pool_free (teid_pool_t * const pool, const uint32_t teid);
+
+bool     teid_pool_is_allocated (const teid_pool_t * const pool, const uint32_t teid);
+uint32_t teid_pool_shard_of (const teid_pool_t * const pool, const uint32_t teid);
+uint32_t teid_pool_nb_used (teid_pool_t * const pool);
+
+#endif /* FILE_TEID_POOL_SEEN */